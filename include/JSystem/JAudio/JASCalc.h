@@ -5,10 +5,11 @@
 
 namespace JASystem {
     namespace Calc {
-        void initSinfT();
+        void initSinfT(); // also sets up the GQRs imixcopy and imixadd use on the calling thread
         f32 sinfT(f32);
         f32 sinfDolby2(f32);
         void imixcopy(const s16*, const s16*, s16*, s32);
+        void imixadd(const s16*, s16*, s32, f32);
         void bcopyfast(const u32*, u32*, u32);
         void bcopy(const void*, void*, u32);
         void bzerofast(void*, u32);
@@ -27,8 +27,8 @@ class JKRAramArchive : public JKRArchive {
   private:
     /* 0x00 */ // vtable
     /* 0x04 */ // JKRArchive
-    /* 0x64 */ JKRAramBlock* mBlock;
-    /* 0x68 */ JKRFile* mDvdFile;
+    /* 0x68 */ JKRAramBlock* mBlock;
+    /* 0x6C */ JKRFile* mDvdFile;
 }; // Size = 0x6C
 
 #endif /* JKRARAMARCHIVE_H */
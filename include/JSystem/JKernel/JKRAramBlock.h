@@ -22,6 +22,10 @@ class JKRAramBlock {
 
     void newGroupID(u8 groupId) { mGroupId = groupId; }
 
+    // Lets JKRAramHeap::compact move the block; its owner has to be told through the heap's callback
+    bool isMovable() const { return mIsMovable; }
+    void setMovable(bool movable) { mIsMovable = movable; }
+
   public:
     /* 0x00 */ // vtable
     /* 0x04 */ JSULink<JKRAramBlock> mBlockLink;
@@ -30,7 +34,8 @@ class JKRAramBlock {
     /* 0x1C */ u32 mFreeSize;
     /* 0x20 */ u8 mGroupId;
     /* 0x21 */ bool mIsTempMemory;
-    /* 0x22 */ u8 padding[2];
+    /* 0x22 */ bool mIsMovable;
+    /* 0x23 */ u8 padding_0x23;
 };
 
 #endif /* JKRARAMBLOCK_H */
@@ -12,6 +12,19 @@ class JKRAramHeap : public JKRDisposer {
         TAIL = 1,
     };
 
+    // How broken up the free space is, from getFragInfo
+    struct TFragInfo {
+        /* 0x00 */ u32 mTotalFreeSize;
+        /* 0x04 */ u32 mMaxFreeSize;
+        /* 0x08 */ u32 mNumFreeBlocks; // gaps between blocks
+        /* 0x0C */ u32 mNumUsedBlocks;
+        /* 0x10 */ u32 mMovableSize; // used bytes compact is allowed to move
+        /* 0x14 */ u32 mFragmentation; // percent of the free space outside the largest gap
+    };
+
+    // Called by compact for each block it moved, once its data is at block->getAddress()
+    typedef void (*MoveCallback)(JKRAramBlock* block, u32 oldAddress, void* param);
+
   public:
     // TODO: fix type
     static JSUList<JKRAramBlock> sAramList;
@@ -28,6 +41,9 @@ class JKRAramHeap : public JKRDisposer {
     void dump(void);
     void free(JKRAramBlock* block) { delete block; }
 
+    void getFragInfo(TFragInfo* info);
+    u32 compact(u8* buffer, u32 bufferSize, u32 maxBytes, MoveCallback callback, void* param);
+
     u8 getCurrentGroupID() const { return mGroupId; }
 
     JKRHeap* getMgrHeap() const { return mHeap; }
@@ -5,6 +5,23 @@
 
 class JSUFileInputStream;
 
+#define JKR_ARAM_STREAM_MAX_BUFFERS 4
+#define JKR_ARAM_STREAM_MAX_BATCH 4 // the size of the stream thread's queue
+
+// What the stream thread measured for one command, for a caller that passed write_StreamToAram_Async somewhere to
+// put it. The times are OSGetTime values; read them once sync has returned the command.
+struct JKRAramStreamStats {
+    /* 0x00 */ u32 mBytes;
+    /* 0x04 */ u32 mChunks;    // DMAs that carried some of its data
+    /* 0x08 */ u32 mBatchSize; // commands taken off the queue together with it
+    /* 0x0C */ u32 padding_0xc;
+    /* 0x10 */ OSTime mQueueTime; // write_StreamToAram_Async
+    /* 0x18 */ OSTime mStartTime; // the stream thread took it
+    /* 0x20 */ OSTime mEndTime;   // its last DMA was done
+    /* 0x28 */ OSTime mReadTime;  // reading the stream
+    /* 0x30 */ OSTime mWaitTime;  // waiting for a transfer buffer's DMA to finish before reading into it again
+}; // Size = 0x38
+
 class JKRAramStreamCommand {
   public:
     enum Type {
@@ -30,7 +47,7 @@ class JKRAramStreamCommand {
     /* 0x28 */ u32 field_0x2c;
     /* 0x2C */ OSMessageQueue mMessageQueue;
     /* 0x4C */ OSMessage mMessage;
-    /* 0x50 */ u32 field_0x54;
+    /* 0x50 */ JKRAramStreamStats* mStats;
     /* 0x54 */ u32 field_0x58;
 };
 
@@ -46,25 +63,38 @@ class JKRAramStream : public JKRThread {
 
     static s32 readFromAram(void);
     static s32 writeToAram(JKRAramStreamCommand*);
-    static JKRAramStreamCommand* write_StreamToAram_Async(JSUFileInputStream*, u32, u32, u32);
+    static s32 writeToAram(JKRAramStreamCommand**, u32);
+    static JKRAramStreamCommand* write_StreamToAram_Async(JSUFileInputStream*, u32, u32, u32,
+                                                          JKRAramStreamStats* stats = NULL);
     static JKRAramStreamCommand* sync(JKRAramStreamCommand*, BOOL);
     static void setTransBuffer(u8*, u32, JKRHeap*);
+    // The transfer buffer is split in this many, so the stream can be read into one while the others are DMAd
+    static void setTransBufferCount(u32);
+    static u32 getTransBufferCount() { return transCount; }
+    // The most queued commands written in one go; 1 writes each on its own
+    static void setBatchSize(u32);
+    static u32 getBatchSize() { return batchSize; }
+
+    static u32 getKBPerSecond(const JKRAramStreamStats*);
+    static void printStats(const JKRAramStreamStats*);
 
   private:
     static JKRAramStream* sAramStreamObject;
-    static OSMessage sMessageBuffer[4];
+    static OSMessage sMessageBuffer[JKR_ARAM_STREAM_MAX_BATCH];
     static OSMessageQueue sMessageQueue;
 
     static u8* transBuffer;
     static u32 transSize;
     static JKRHeap* transHeap;
+    static u32 transCount;
+    static u32 batchSize;
 };
 
 inline JKRAramStream* JKRCreateAramStreamManager(s32 priority) { return JKRAramStream::create(priority); }
 
 inline JKRAramStreamCommand* JKRStreamToAram_Async(JSUFileInputStream* stream, u32 addr, u32 size, u32 offset,
-                                                   void (*callback)(u32)) {
-    return JKRAramStream::write_StreamToAram_Async(stream, addr, size, offset);
+                                                   void (*callback)(u32), JKRAramStreamStats* stats = NULL) {
+    return JKRAramStream::write_StreamToAram_Async(stream, addr, size, offset, stats);
 }
 
 #endif /* JKRARAMSTREAM_H */
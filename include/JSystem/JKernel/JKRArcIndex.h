@@ -0,0 +1,52 @@
+#ifndef JKRARCINDEX_H
+#define JKRARCINDEX_H
+
+#include "JSystem/JKernel/JKRArchive.h"
+#include "dolphin/types.h"
+
+// Name lookup tables for a mounted archive, built once by JKRArchive::mount so the find functions don't walk every
+// entry of a directory (or of the whole archive, for findNameResource) comparing names:
+//
+//   a hash table keyed on (directory, name hash), for path lookups
+//   a hash table keyed on the name hash alone, for findNameResource
+//   the directories sorted by type, for findResType and so getResource(u32 type, const char*)
+//
+// The RARC name hash is only 16 bits, so a hit is always confirmed against the string table. Chains keep archive
+// order, so the entry found is the one the linear search would have returned. The index lives in one block of
+// getWorkSize bytes and holds no pointers into the heap, only into the archive's own tables.
+
+#define JKR_ARC_INDEX_NONE 0xFFFF
+
+class JKRArcIndex {
+  public:
+    // 0 if the archive has too many entries for the 16-bit links
+    static u32 getWorkSize(const SArcDataInfo* info);
+    static JKRArcIndex* create(void* work, const SArcDataInfo* info, const JKRArchive::SDIDirEntry* nodes,
+                               const JKRArchive::SDIFileEntry* files, const char* stringTable);
+
+    // Each returns a file or node index, or JKR_ARC_INDEX_NONE. name has to be hashed and lowercased the way
+    // JKRArchive::CArcName does it.
+    u32 findFile(u32 directory, const char* name, u16 hash) const;
+    u32 findName(const char* name, u16 hash) const;
+    u32 findType(u32 type) const;
+
+  private:
+    u32 getDirBucket(u32 directory, u16 hash) const;
+    u32 getNameBucket(u16 hash) const;
+    bool isSameName(u32 file, const char* name, u16 hash) const;
+
+    /* 0x00 */ const JKRArchive::SDIDirEntry* mNodes;
+    /* 0x04 */ const JKRArchive::SDIFileEntry* mFiles;
+    /* 0x08 */ const char* mStringTable;
+    /* 0x0C */ u32 mNumNodes;
+    /* 0x10 */ u32 mNumFiles;
+    /* 0x14 */ u32 mBucketShift; // 32 - log2 of the bucket count
+    /* 0x18 */ u16* mDirHead;
+    /* 0x1C */ u16* mDirNext;
+    /* 0x20 */ u16* mNameHead;
+    /* 0x24 */ u16* mNameNext;
+    /* 0x28 */ u32* mTypes;     // sorted
+    /* 0x2C */ u16* mTypeNodes; // node of each mTypes entry, in archive order among equal types
+}; // size = 0x30
+
+#endif /* JKRARCINDEX_H */
@@ -7,6 +7,7 @@
 #include "macros.h"
 
 class JKRArcFinder;
+class JKRArcIndex;
 class JKRHeap;
 
 struct SArcHeader {
@@ -138,6 +139,12 @@ class JKRArchive : public JKRFileLoader {
     SDIFileEntry* findPtrResource(const void*) const;
     SDIFileEntry* findIdResource(u16) const;
 
+    // Name lookup tables for the find functions (see JKRArcIndex.h), JKRArcIndex::getWorkSize bytes from mHeap.
+    // Without them the find functions search linearly.
+    bool createIndex();
+    void destroyIndex();
+    JKRArcIndex* getIndex() const { return mIndex; }
+
   public:
     /* vt[04] */ virtual bool becomeCurrent(const char*); /* override */
     /* vt[05] */ virtual void* getResource(const char*); /* override */
@@ -181,6 +188,7 @@ class JKRArchive : public JKRFileLoader {
     /* 0x58 */ u32 field_0x58;
     /* 0x5C */ JKRCompression mCompression;
     /* 0x60 */ EMountDirection mMountDirection;
+    /* 0x64 */ JKRArcIndex* mIndex;
 
   public:
     static JKRArchive* check_mount_already(s32);
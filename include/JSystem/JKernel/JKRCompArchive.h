@@ -24,13 +24,13 @@ class JKRCompArchive : public JKRArchive {
   private:
     /* 0x00 */ // vtable
     /* 0x04 */ // JKRArchive
-    /* 0x64 */ int field_0x64;
-    /* 0x68 */ JKRAramBlock* mAramPart;
-    /* 0x6C */ int field_0x6c;
-    /* 0x70 */ JKRDvdFile* mDvdFile;
-    /* 0x74 */ u32 mSizeOfMemPart;
-    /* 0x78 */ u32 mSizeOfAramPart;
-    /* 0x7C */ int field_0x7c;
+    /* 0x68 */ int field_0x68;
+    /* 0x6C */ JKRAramBlock* mAramPart;
+    /* 0x70 */ int field_0x70;
+    /* 0x74 */ JKRDvdFile* mDvdFile;
+    /* 0x78 */ u32 mSizeOfMemPart;
+    /* 0x7C */ u32 mSizeOfAramPart;
+    /* 0x80 */ int field_0x80;
 };
 
 #endif /* JKRCOMPARCHIVE_H */
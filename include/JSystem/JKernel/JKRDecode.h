@@ -0,0 +1,32 @@
+#ifndef JKRDECODE_H
+#define JKRDECODE_H
+
+#include "dolphin/types.h"
+
+// Yaz0 (SZS) and Yay0 (SZP) decoders behind JKRDecomp::decodeSZS and JKRDecomp::decodeSZP. They take the same
+// arguments: the compressed data, the destination, how many bytes to write and how many decoded bytes to skip
+// before writing, and give the same output as the original byte-at-a-time loops.
+//
+// Away from the end of the output a whole flag group is decoded without bounds checks: all-literal groups are
+// copied a word at a time, and back-references a word at a time with distances under a word widened first. A
+// match can write up to 3 bytes past itself, which the next output overwrites, so these groups stop while
+// JKR_DECODE_SLACK bytes are still left. Skipping and the last groups use the exact loops.
+
+#define JKR_DECODE_SLACK 8
+
+#define JKR_SZS_HEADER_SIZE 0x10
+#define JKR_SZP_HEADER_SIZE 0x10
+#define JKR_SZ_MAX_MATCH (0xFF + 0x12)
+#define JKR_SZS_MAX_GROUP_SIZE (1 + 8 * 3) // flag byte and eight three-byte back-references
+
+void JKRDecodeSZS(u8* src, u8* dst, u32 size, u32 offset);
+void JKRDecodeSZP(u8* src, u8* dst, u32 size, u32 offset);
+
+// The SZS loop in pieces for decoders that get their input a chunk at a time. Both take the next flag byte at
+// *src, which they advance, and return the new dst. Groups decodes up to numGroups whole groups and stops short
+// of end, as above; Group decodes one group exactly, stopping at end. Back-references may reach up to 0x1000 bytes
+// before dst.
+u8* JKRDecodeSZSGroups(const u8** src, u8* dst, u8* end, u32 numGroups);
+u8* JKRDecodeSZSGroup(const u8** src, u8* dst, u8* end);
+
+#endif /* JKRDECODE_H */
@@ -22,8 +22,8 @@ class JKRDvdArchive : public JKRArchive {
   private:
     /* 0x00 */ // vtable
     /* 0x04 */ // JKRArchive
-    /* 0x64 */ s32 mDataOffset;
-    /* 0x68 */ JKRDvdFile* mDvdFile;
+    /* 0x68 */ s32 mDataOffset;
+    /* 0x6C */ JKRDvdFile* mDvdFile;
 };
 
 #endif /* JKRDVDARCHIVE_H */
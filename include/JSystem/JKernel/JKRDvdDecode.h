@@ -0,0 +1,36 @@
+#ifndef JKRDVDDECODE_H
+#define JKRDVDDECODE_H
+
+#include "dolphin/dvd.h"
+#include "dolphin/os.h"
+
+// Decompress-while-reading for Yaz0 files on the disc, used by JKRDvdRipper::loadToMainRAM. The work buffer holds
+// two chunks of the compressed file: while one is decoded straight into the destination, the next one is being read
+// into the other. Reading and decoding overlap, and only the work buffer is needed instead of the whole compressed
+// file. Every chunk is one DVD command, so a bigger work buffer spends less time on per-command overhead.
+//
+// Each chunk sits behind JKR_DVD_DECODE_LEAD spare bytes, where the unread end of the previous chunk is copied so a
+// flag group never straddles two chunks. Skipping the start of the output (offset) decodes through a
+// JKR_DVD_DECODE_WINDOW byte history, taken from the front of the work buffer only then, until the destination
+// holds a whole window of its own.
+
+#define JKR_DVD_DECODE_LEAD 0x20
+#define JKR_DVD_DECODE_WINDOW 0x1000
+#define JKR_DVD_DECODE_MIN_WORK (JKR_DVD_DECODE_WINDOW + 2 * (JKR_DVD_DECODE_LEAD + 0x20))
+
+typedef struct JKRDvdDecodeStats {
+    /* 0x00 */ u32 numReads;
+    /* 0x04 */ u32 bytesRead;
+    /* 0x08 */ OSTime totalTime;
+    /* 0x10 */ OSTime waitTime; // spent waiting for the drive with nothing left to decode
+} JKRDvdDecodeStats; // size = 0x18
+
+// Decodes the Yaz0 file fileInfo into dst while reading it, skipping the first offset decoded bytes and writing at
+// most size. work has to be 32-byte aligned and at least JKR_DVD_DECODE_MIN_WORK bytes; bigger means fewer, longer
+// reads. Decodes from different threads can run at once. Failed reads are retried while JKRDvdRipper::errorRetry is
+// set. Returns the number of bytes written, 0 if the file isn't Yaz0, offset is past its end or a read failed. stats
+// may be NULL.
+u32 JKRDvdDecodeSZS(DVDFileInfo* fileInfo, u8* dst, u32 size, u32 offset, u8* work, u32 workSize,
+                    JKRDvdDecodeStats* stats);
+
+#endif /* JKRDVDDECODE_H */
@@ -26,6 +26,7 @@ class JKRDvdRipper {
   public:
     static JSUList<JKRDMCommand> sDvdAsyncList;
     static u32 sSzpBufferSize;
+    static bool sStreamSzs; // decode Yaz0 files while reading them instead of after (see JKRDvdDecode.h)
     static bool errorRetry;
 
     enum EAllocDirection {
@@ -35,6 +36,7 @@ class JKRDvdRipper {
     };
 
     static void setSzpBufferSize(u32 size) { sSzpBufferSize = size; }
+    static void setStreamSzs(bool stream) { sStreamSzs = stream; }
 
     static void* loadToMainRAM(char const*, u8*, JKRExpandSwitch, u32, JKRHeap*, EAllocDirection, u32, int*);
     static void* loadToMainRAM(s32, u8*, JKRExpandSwitch, u32, JKRHeap*, EAllocDirection, u32, int*);
@@ -40,6 +40,10 @@ class JKRExpHeap : public JKRHeap {
     }; // Size: 0x10
     friend class CMemBlock;
 
+    // Size-class lists and an address directory over the free list, kept at the start of the heap's memory when
+    // the heap is big enough to be worth it. See JKRExpHeap.cpp.
+    class CFreeBins;
+
   protected:
     JKRExpHeap(void* data, u32 size, JKRHeap* parent, bool errorFlag);
     virtual ~JKRExpHeap();
@@ -56,11 +60,18 @@ class JKRExpHeap : public JKRHeap {
     void joinTwoBlocks(CMemBlock* block);
     bool dump_sort_by_address();
 
+    CFreeBins* getFreeBins() const;
+    void initFreeList();
+    CMemBlock* findFreeBlockAfter(void* ptr) const;
+    CMemBlock* searchFreeBins(CFreeBins* bins, u32 size, int align, u32* offset) const;
+    bool checkFreeBins(CFreeBins* bins) const;
+
   public:
     s32 getUsedSize(u8 groupId) const;
     s32 getTotalUsedSize(void) const;
 
     CMemBlock* getHeadUsedList() const { return mHeadUsedList; }
+    CMemBlock* getHeadFreeList() const { return mHeadFreeList; }
     void setAllocationMode(EAllocMode mode) { mAllocMode = mode; }
 
   public:
@@ -100,6 +111,12 @@ class JKRExpHeap : public JKRHeap {
     static JKRExpHeap* createRoot(int maxHeaps, bool errorFlag);
     static JKRExpHeap* create(u32 size, JKRHeap* parent, bool errorFlag);
     static JKRExpHeap* create(void* ptr, u32 size, JKRHeap* parent, bool errorFlag);
+
+    // Heaps made from now on index their free blocks, if they're large enough, in 0x430 bytes taken from their
+    // space (so getTotalFreeSize reports that much less). Off by default.
+    static void setDefaultFreeBins(bool status) { sDefaultFreeBinsFlag = status; }
+
+    static bool sDefaultFreeBinsFlag;
 };
 
 inline JKRExpHeap* JKRCreateExpHeap(u32 size, JKRHeap* parent, bool errorFlag) {
@@ -186,6 +186,9 @@ void* operator new[](size_t size, JKRHeap* heap, int alignment);
 void operator delete(void* ptr);
 void operator delete[](void* ptr);
 
+// placement new, for the heaps' bookkeeping built in memory they manage
+inline void* operator new(size_t size, void* ptr) { return ptr; }
+
 void JKRDefaultMemoryErrorRoutine(void* heap, u32 size, int alignment);
 
 inline void* JKRAllocFromHeap(JKRHeap* heap, u32 size, int alignment) { return JKRHeap::alloc(size, alignment, heap); }
@@ -0,0 +1,137 @@
+#ifndef JKRHEAPPROFILER_H
+#define JKRHEAPPROFILER_H
+
+#include "JSystem/JKernel/JKRHeap.h"
+#include "dolphin/types.h"
+
+// Counts what every heap hands out, per heap and group ID, while it's started. The heaps call the on* functions from
+// their do_alloc, do_free, do_resize, do_freeAll, do_freeTail and do_destroy (and JKRSolidHeap::rewind); each
+// allocation is also charged to its call site, the return addresses of the stack it was made from. sample, called
+// once a frame, records every group's live bytes for the timeline, and gives the frame number lifetimes are
+// counted in.
+//
+// Everything is written out through OSReport as lines starting "heapprof", which tools/host/heapprof reads back out
+// of a log to resolve call sites against the symbol map and to diff the timelines of two runs.
+//
+// The tables are allocated from the heap passed to start before recording begins, so they aren't counted, and
+// nothing is allocated after that: a block that doesn't fit in the table isn't followed (it's counted as dropped),
+// and neither is one allocated before start.
+
+#define JKR_HEAP_PROFILER_DEPTH 8       // return addresses kept per call site
+#define JKR_HEAP_PROFILER_MAX_HEAPS 16
+#define JKR_HEAP_PROFILER_MAX_STATS 64  // heap and group pairs
+#define JKR_HEAP_PROFILER_NONE 0xFFFF
+
+class JKRHeapProfiler {
+  public:
+    struct THeap {
+        /* 0x00 */ JKRHeap* mHeap; // NULL once destroyed
+        /* 0x04 */ const char* mName;
+        /* 0x08 */ u32 mType;
+        /* 0x0C */ u32 mSize;
+    };
+
+    struct TStat {
+        /* 0x00 */ u8 mHeap; // index in the heap table
+        /* 0x01 */ u8 mGroupId;
+        /* 0x02 */ u8 padding_0x2[2];
+        /* 0x04 */ u32 mAllocCount;
+        /* 0x08 */ u32 mFreeCount;
+        /* 0x0C */ u32 mResizeCount;
+        /* 0x10 */ u32 mFailCount;
+        /* 0x14 */ u32 mAllocBytes;
+        /* 0x18 */ u32 mLiveBlocks;
+        /* 0x1C */ u32 mLiveBytes;
+        /* 0x20 */ u32 mPeakBytes;
+        /* 0x24 */ u32 mLifetimeSum; // in frames, over the blocks freed
+        /* 0x28 */ u32 mLifetimeMax;
+    };
+
+    struct TSite {
+        /* 0x00 */ u32 mStack[JKR_HEAP_PROFILER_DEPTH];
+        /* 0x20 */ u16 mStat;
+        /* 0x22 */ u16 padding_0x22;
+        /* 0x24 */ u32 mAllocCount;
+        /* 0x28 */ u32 mAllocBytes;
+        /* 0x2C */ u32 mLiveBytes;
+        /* 0x30 */ u32 mPeakBytes;
+    };
+
+    struct TBlock {
+        /* 0x00 */ void* mPtr; // NULL if the slot is empty
+        /* 0x04 */ u32 mSize;
+        /* 0x08 */ u32 mFrame;
+        /* 0x0C */ u16 mStat;
+        /* 0x0E */ u16 mSite;
+    };
+
+    struct TSample {
+        /* 0x00 */ u32 mFrame;
+        /* 0x04 */ u16 mStat;
+        /* 0x06 */ u16 padding_0x6;
+        /* 0x08 */ u32 mLiveBlocks;
+        /* 0x0C */ u32 mLiveBytes;
+    };
+
+    // Allocates the tables from heap, which has to outlive the profiler, and starts recording. false if they don't
+    // fit.
+    static bool start(JKRHeap* heap, u32 maxBlocks, u32 maxSites, u32 maxSamples);
+    static void stop();
+    static bool isActive() { return sActive; }
+
+    // Names a heap in the output, instead of its type and index. name isn't copied.
+    static void setHeapName(JKRHeap* heap, const char* name);
+    static void sample(u32 frame);
+
+    // The heaps and groups, then the numSites call sites that allocated the most
+    static void dump(u32 numSites);
+    static void dumpTimeline();
+
+    static u32 getNumStats() { return sNumStats; }
+    static const TStat* getStat(u32 index) { return &sStats[index]; }
+    static const THeap* getHeap(u32 index) { return &sHeaps[index]; }
+    static const TStat* findStat(JKRHeap* heap, u8 groupId);
+
+    static void onAlloc(JKRHeap* heap, void* ptr, u32 size, u8 groupId);
+    static void onAllocFail(JKRHeap* heap, u32 size, u8 groupId);
+    static void onFree(JKRHeap* heap, void* ptr);
+    static void onResize(JKRHeap* heap, void* ptr, u32 size);
+    // Everything in [begin, end) was given back at once
+    static void onFreeRange(JKRHeap* heap, void* begin, void* end);
+    static void onDestroy(JKRHeap* heap);
+
+  private:
+    static u32 getHeapIndex(JKRHeap* heap);
+    static u32 getStatIndex(JKRHeap* heap, u8 groupId);
+    static u32 getSiteIndex(u32 stat, const u32* stack);
+    static TBlock* findBlock(void* ptr);
+    static void removeBlock(TBlock* block);
+    static void printHeap(u32 index);
+
+    static bool sActive;
+    static JKRHeap* sHeap;
+    static u32 sFrame;
+    static u32 sNumHeaps;
+    static u32 sNumStats;
+    static THeap sHeaps[JKR_HEAP_PROFILER_MAX_HEAPS];
+    static TStat sStats[JKR_HEAP_PROFILER_MAX_STATS];
+
+    static TBlock* sBlocks;
+    static u32 sBlockMask; // table size - 1, a power of two
+    static u32 sNumBlocks;
+    static u32 sMaxBlocks;
+    static TSite* sSites;
+    static u16* sSiteTable; // site indices, open addressing
+    static u32 sSiteMask;
+    static u32 sNumSites;
+    static u32 sMaxSites;
+    static TSample* sSamples;
+    static u32 sNumSamples;
+    static u32 sMaxSamples;
+
+    static u32 sDroppedBlocks;
+    static u32 sDroppedSites;
+    static u32 sDroppedSamples;
+};
+
+#endif /* JKRHEAPPROFILER_H */
@@ -34,10 +34,10 @@ class JKRMemArchive : public JKRArchive {
   private:
     /* 0x00 */ // vtable
     /* 0x04 */ // JKRArchive
-    /* 0x64 */ SArcHeader* mArcHeader;
-    /* 0x68 */ u8* mArchiveData;
-    /* 0x6C */ bool mIsOpen;
-    /* 0x6D */ u8 field_0x6d[3];
+    /* 0x68 */ SArcHeader* mArcHeader;
+    /* 0x6C */ u8* mArchiveData;
+    /* 0x70 */ bool mIsOpen;
+    /* 0x71 */ u8 field_0x71[3];
 };
 
 #endif /* JKRMEMARCHIVE_H */
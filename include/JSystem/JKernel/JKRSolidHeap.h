@@ -5,12 +5,30 @@
 
 class JKRSolidHeap : public JKRHeap {
   public:
-    struct Unknown {
-        /* 0x00 */ u32 field_0x0;
-        /* 0x04 */ u32 field_0x4;
-        /* 0x08 */ u32 field_0x8;
-        /* 0x0C */ void* field_0xc;
-        /* 0x10 */ Unknown* mNext;
+    enum EMarkEnd {
+        MARK_HEAD = 1,
+        MARK_TAIL = 2,
+        MARK_BOTH = MARK_HEAD | MARK_TAIL,
+    };
+
+    // Where the head and tail were, to rewind the ends in mEnds back to. Set marks are listed innermost first.
+    struct CMark {
+        /* 0x00 */ u32 mEnds;
+        /* 0x04 */ u32 mDepth;
+        /* 0x08 */ u8* mHead;
+        /* 0x0C */ u8* mTail;
+        /* 0x10 */ CMark* mNext;
+    };
+
+    // Rewinds the heap to where it was when the scope was entered
+    class CScope {
+      public:
+        CScope(JKRSolidHeap* heap, u32 ends = MARK_BOTH) : mHeap(heap) { heap->setMark(&mMark, ends); }
+        ~CScope() { mHeap->rewind(&mMark); }
+
+      private:
+        CMark mMark;
+        JKRSolidHeap* mHeap;
     };
 
   protected:
@@ -48,11 +66,15 @@ class JKRSolidHeap : public JKRHeap {
     /* 0x6C */ u32 mFreeSize;
     /* 0x70 */ u8* mSolidHead;
     /* 0x74 */ u8* mSolidTail;
-    /* 0x78 */ Unknown* field_0x78;
+    /* 0x78 */ CMark* mMarkList;
 
   public:
     s32 adjustSize(void);
 
+    void setMark(CMark* mark, u32 ends);
+    bool rewind(CMark* mark);
+    CMark* getMark() const { return mMarkList; }
+
     static JKRSolidHeap* create(u32, JKRHeap*, bool);
 };
 
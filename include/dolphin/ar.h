@@ -22,7 +22,10 @@ extern "C" {
 
 typedef void (*ARCallback)(void);
 
+ARCallback ARRegisterDMACallback(ARCallback callback);
 u32 ARInit(u32* stack_index_addr, u32 num_entries);
+u32 ARAlloc(u32 length);
+u32 ARGetSize(void);
 u32 ARGetBaseAddress(void);
 u32 ARGetDMAStatus(void);
 void ARStartDMA(u32 type, u32 mainmem_addr, u32 aram_addr, u32 length);
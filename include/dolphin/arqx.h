@@ -0,0 +1,67 @@
+#ifndef ARQX_H
+#define ARQX_H
+
+#include "dolphin/arq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Extended ARQ: N priority levels, merging of contiguous requests and a chunk size that adapts to keep the wait of
+// a new top-priority request under a bound. It takes over the AR DMA callback, so it replaces ARQ rather than
+// running next to it.
+
+#define ARQX_NUM_PRIORITIES 4
+#define ARQX_PRIORITY_LOWEST 0
+#define ARQX_PRIORITY_HIGHEST (ARQX_NUM_PRIORITIES - 1)
+
+#define ARQX_MAX_OWNERS 8
+#define ARQX_CHUNK_SIZE_MIN 0x400
+#define ARQX_CHUNK_SIZE_MAX 0x10000
+#define ARQX_LATENCY_BOUND_DEFAULT 250 // microseconds
+
+typedef struct ARQXRequest {
+    /* 0x00 */ ARQRequest request; // callbacks receive a pointer to this
+    /* 0x20 */ struct ARQXRequest* merged; // requests folded into this transfer, in post order
+    /* 0x24 */ struct ARQXRequest* mergedTail;
+    /* 0x28 */ u32 priority;
+    /* 0x2C */ u32 xferLength; // own length plus everything merged into it
+    /* 0x30 */ u32 offset; // bytes already transferred
+    /* 0x38 */ s64 postTime;
+} ARQXRequest; // size = 0x40
+
+typedef struct ARQXOwnerStats {
+    /* 0x00 */ u32 owner;
+    /* 0x04 */ u32 numRequests;
+    /* 0x08 */ u32 numMerged;
+    /* 0x0C */ u32 bytes[2]; // indexed by ARAM_DIR_*
+    /* 0x14 */ u32 numCompleted; // requests whose callback has run; posted ones may still be in flight
+    /* 0x18 */ s64 totalLatency; // post to callback, over the completed requests
+    /* 0x20 */ s64 maxLatency;
+} ARQXOwnerStats; // size = 0x28
+
+typedef struct ARQXStats {
+    /* 0x00 */ u32 numDMAs;
+    /* 0x04 */ u32 numMerged;
+    /* 0x08 */ u32 chunkSize;
+    /* 0x0C */ u32 numOwners;
+    /* 0x10 */ s64 busyTicks; // time the DMA engine spent on ARQX transfers
+    /* 0x18 */ u64 totalBytes;
+    /* 0x20 */ ARQXOwnerStats owners[ARQX_MAX_OWNERS]; // the last slot also collects owners that didn't fit
+} ARQXStats;
+
+void ARQXInit(u32 latencyBoundUs);
+void ARQXPostRequest(ARQXRequest* request, u32 owner, u32 type, u32 priority, u32 source, u32 dest, u32 length,
+                     ARQCallback callback);
+void ARQXSetLatencyBound(u32 latencyBoundUs);
+u32 ARQXGetChunkSize(void);
+BOOL ARQXGetOwnerStats(u32 owner, ARQXOwnerStats* stats);
+void ARQXGetStats(ARQXStats* stats);
+void ARQXResetStats(void);
+void ARQXReport(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* ARQX_H */
@@ -17,6 +17,31 @@ extern "C" {
 #define AX_SRC_TYPE_4TAP_12K 3
 #define AX_SRC_TYPE_4TAP_16K 4
 
+#define AX_SAMPLE_RATE 32000
+#define AX_SAMPLES_PER_FRAME 160 // 5 ms
+
+#define AX_PB_STATE_STOP 0
+#define AX_PB_STATE_RUN 1
+
+#define AX_PB_TYPE_NORMAL 0
+#define AX_PB_TYPE_STREAM 1 // keeps the ADPCM history when looping
+
+#define AX_PB_FORMAT_ADPCM 0x00
+#define AX_PB_FORMAT_PCM16 0x0A
+#define AX_PB_FORMAT_PCM8 0x19
+
+#define AX_PB_SRCSEL_POLYPHASE 0
+#define AX_PB_SRCSEL_LINEAR 1
+#define AX_PB_SRCSEL_NONE 2
+
+#define AX_PB_COEFSEL_8KHZ 0
+#define AX_PB_COEFSEL_12KHZ 1
+#define AX_PB_COEFSEL_16KHZ 2
+
+#define AX_MODE_STEREO 0
+#define AX_MODE_SURROUND 1
+#define AX_MODE_DPL2 2
+
 // sync flags
 #define AX_SYNC_FLAG_COPYALL (1 << 31)
 #define AX_SYNC_FLAG_UNK1 (1 << 30) // reserved, unused?
@@ -0,0 +1,63 @@
+#ifndef _DOLPHIN_DSPX_H_
+#define _DOLPHIN_DSPX_H_
+
+#include "dolphin/dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Extended DSP task scheduler. It takes over the DSP interrupt from __DSPHandler and speaks the same task switch
+// protocol on the same task list, so DSPAssertTask keeps working, but:
+//  - adding a task appends it in O(1) when nothing of a lower priority is queued, and only boots the DSP when it
+//    is the only task (DSPAddTask reboots it whenever the new task sorts first),
+//  - mail to the DSP is queued and fed to the mailbox from an alarm once it has been full for a few polls, instead
+//    of spinning on DSPCheckMailToDSP after every word inside the interrupt handler; DSPXSendMail turns words away
+//    rather than wait when the queue is full, and the boot waits for the DSP's ready mail on the same alarm,
+//  - every task gets run time and switch latency counters.
+
+#define DSPX_MAIL_QUEUE_SIZE 32
+#define DSPX_MAIL_RESERVED 11 // queue slots DSPXSendMail leaves for a task switch, the longest run of scheduler words
+#define DSPX_MAX_TASKS 8
+#define DSPX_MAIL_RETRY_US 2
+#define DSPX_MAIL_POLLS_DEFAULT 16 // polls of a full mailbox before deferring to the retry alarm
+
+typedef struct DSPXTaskStats {
+    /* 0x00 */ DSPTaskInfo* task;
+    /* 0x04 */ u32 numRuns;
+    /* 0x08 */ u32 numSwitches;
+    /* 0x10 */ OSTime runTicks;       // DSP reports the task running until it yields or is done
+    /* 0x18 */ OSTime maxRunTicks;
+    /* 0x20 */ OSTime switchTicks;    // CPU starts the switch until the DSP reports the task running
+    /* 0x28 */ OSTime maxSwitchTicks;
+} DSPXTaskStats; // size = 0x30
+
+typedef struct DSPXStats {
+    /* 0x00 */ u32 numInterrupts;
+    /* 0x04 */ u32 numSwitches;
+    /* 0x08 */ u32 numMails;
+    /* 0x0C */ u32 numDeferred;       // mails that found the mailbox full and went out from the retry alarm
+    /* 0x10 */ OSTime handlerTicks;   // CPU time in the interrupt handler
+    /* 0x18 */ OSTime maxHandlerTicks;
+    /* 0x20 */ u32 numTasks;
+    /* 0x24 */ u32 numRefused;        // DSPXSendMail calls that found the queue full
+    /* 0x28 */ DSPXTaskStats tasks[DSPX_MAX_TASKS]; // the last slot also collects tasks that didn't fit
+} DSPXStats; // size = 0x1A8
+
+void DSPXInit(void);
+DSPTaskInfo* DSPXAddTask(DSPTaskInfo* task);
+BOOL DSPXSendMail(u32 mail);
+void DSPXSetMailPolls(u32 polls);
+BOOL DSPXIsMailPending(void);
+void __DSPXHandler(__OSInterrupt interrupt, OSContext* context);
+void __DSPX_insert_task(DSPTaskInfo* task);
+BOOL DSPXGetTaskStats(DSPTaskInfo* task, DSPXTaskStats* stats);
+void DSPXGetStats(DSPXStats* stats);
+void DSPXResetStats(void);
+void DSPXReport(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
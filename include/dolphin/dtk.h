@@ -8,6 +8,23 @@
 extern "C" {
 #endif
 
+#define DTK_STATE_STOP 0
+#define DTK_STATE_RUN 1
+#define DTK_STATE_PAUSE 2
+#define DTK_STATE_BUSY 3
+#define DTK_STATE_PREPARE 4
+
+#define DTK_MODE_NOREPEAT 0
+#define DTK_MODE_ALLREPEAT 1
+#define DTK_MODE_REPEAT1 2
+
+#define DTK_EVENT_TRACK_QUEUED 0x01
+#define DTK_EVENT_PLAYBACK_STARTED 0x02
+#define DTK_EVENT_PLAYBACK_STOPPED 0x04
+#define DTK_EVENT_PLAYBACK_PAUSED 0x08
+#define DTK_EVENT_PLAYBACK_RESUMED 0x10
+#define DTK_EVENT_TRACK_ENDED 0x20
+
 typedef void (*DTKCallback)(u32 eventMask);
 typedef void (*DTKFlushCallback)(void);
 
@@ -3,6 +3,20 @@
 
 #include "dolphin/ax.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIX_MODE_AUXA_PREFADER 0x00000001
+#define MIX_MODE_AUXB_PREFADER 0x00000002
+#define MIX_MODE_MUTE 0x00000004
+#define MIX_MODE_UPDATE_MIX 0x10000000
+#define MIX_MODE_UPDATE_INPUT 0x20000000
+#define MIX_MODE_UPDATE_MIX1 0x40000000 // ramping, the next update settles the deltas
+#define MIX_MODE_UPDATE_INPUT1 0x80000000
+
+#define MIX_VOLUME_OFF -960 // in 0.1 dB, like every level passed to MIX
+
 typedef struct MIXChannel {
     /* 0x00 */ AXVPb* axvpb;
     /* 0x04 */ u32 mode;
@@ -74,4 +88,8 @@ void MIXSetDvdStreamFader(int dB);
 int MIXGetDvdStreamFader(void);
 void MIXUpdateSettings(void);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // _DOLPHIN_MIX_H_
@@ -5,7 +5,10 @@
 extern "C" {
 #endif
 
+#include "dolphin/arq.h"
+#include "dolphin/dvd.h"
 #include "dolphin/gx.h"
+#include "dolphin/os.h"
 #include "dolphin/types.h"
 
 typedef struct {
@@ -46,6 +49,62 @@ typedef struct {
 TEXDescriptor* TEXGet(TEXPalette* pal, u32 id);
 void TEXGetGXTexObjFromPalette(TEXPalette* pal, GXTexObj* to, u32 id);
 
+// Streaming TPL loader: only the palette metadata is read and relocated at open time,
+// image and CLUT data is fetched from DVD or ARAM the first time a descriptor is used.
+
+typedef void* (*TEXLoaderAlloc)(u32 size);
+typedef void (*TEXLoaderFree)(void* ptr);
+
+#define TEX_LOADER_SOURCE_DVD 0
+#define TEX_LOADER_SOURCE_ARAM 1
+
+#define TEX_LOADER_ENTRY_RESIDENT (1 << 0)
+#define TEX_LOADER_ENTRY_TEXOBJ (1 << 1)
+
+typedef struct TEXLoaderEntry {
+    /* 0x00 */ GXTexObj texObj;
+    /* 0x20 */ void* imageBuffer;
+    /* 0x24 */ void* clutBuffer;
+    /* 0x28 */ u32 imageOffset;
+    /* 0x2C */ u32 clutOffset;
+    /* 0x30 */ u32 residentSize;
+    /* 0x34 */ u32 flags;
+} TEXLoaderEntry; // size = 0x38
+
+typedef struct TEXLoaderStats {
+    /* 0x00 */ u32 fileSize; // bytes a full-file load would keep resident
+    /* 0x04 */ u32 headerSize;
+    /* 0x08 */ u32 residentSize;
+    /* 0x0C */ u32 peakSize;
+    /* 0x10 */ u32 numFetches;
+    /* 0x14 */ u32 numEvictions;
+    /* 0x18 */ OSTime openTime;
+    /* 0x20 */ OSTime fetchTime;
+} TEXLoaderStats; // size = 0x28
+
+typedef struct TEXLoader {
+    /* 0x00 */ TEXPalette* palette;
+    /* 0x04 */ TEXLoaderEntry* entries;
+    /* 0x08 */ u32 source;
+    /* 0x0C */ DVDFileInfo* fileInfo;
+    /* 0x10 */ u32 aramAddr;
+    /* 0x14 */ TEXLoaderAlloc alloc;
+    /* 0x18 */ TEXLoaderFree free;
+    /* 0x20 */ TEXLoaderStats stats;
+    /* 0x48 */ ARQRequest arqRequest;
+    /* 0x68 */ OSMessageQueue arqQueue;
+    /* 0x88 */ OSMessage arqMessage;
+} TEXLoader; // size = 0x90
+
+BOOL TEXLoaderOpenDVD(TEXLoader* loader, DVDFileInfo* fileInfo, TEXLoaderAlloc alloc, TEXLoaderFree free);
+BOOL TEXLoaderOpenARAM(TEXLoader* loader, u32 aramAddr, u32 length, TEXLoaderAlloc alloc, TEXLoaderFree free);
+void TEXLoaderClose(TEXLoader* loader);
+TEXDescriptor* TEXLoaderGet(TEXLoader* loader, u32 id);
+GXTexObj* TEXLoaderGetGXTexObj(TEXLoader* loader, u32 id);
+void TEXLoaderEvict(TEXLoader* loader, u32 id);
+void TEXLoaderGetStats(TEXLoader* loader, TEXLoaderStats* stats);
+void TEXLoaderReportStats(TEXLoader* loader);
+
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,72 @@
+#ifndef _MENU_DTKQUEUE_HPP
+#define _MENU_DTKQUEUE_HPP
+
+#include "dolphin/dtk.h"
+#include "dolphin/os.h"
+#include "dolphin/types.h"
+
+// Track queue on top of DTK, replacing the fixed array in dtk_stuff.cpp:
+//  - finished tracks are removed from DTK and their slot is reused, and the queue grows through the allocator
+//    when every slot is taken, so there is no 32 track limit,
+//  - once a track starts, the stream of the one after it is prepared on the drive, so DTK finds it ready instead
+//    of seeking after the end of the current one,
+//  - play/stop requests that find DTK busy are applied from the DTK callback or a retry alarm instead of spinning
+//    on DTKGetState.
+// DTK runs in DTK_MODE_NOREPEAT since played tracks are dropped. Only one queue can be active.
+
+#define DTQ_ERROR_FULL 4 // what Add_Track returns when out of tracks
+#define DTQ_RETRY_US 1000
+#define DTQ_STATE_NONE -1
+
+typedef void* (*DTQAlloc)(u32 size);
+typedef void (*DTQFree)(void* ptr);
+
+typedef struct DTQSlot {
+    /* 0x00 */ DTKTrack track;
+    /* 0x50 */ struct DTQSlot* next; // free list, or the list of ended tracks waiting to be removed from DTK
+    /* 0x54 */ DTKCallback callback;
+    /* 0x58 */ u32 eventMask;
+} DTQSlot; // size = 0x5C
+
+typedef struct DTQStats {
+    /* 0x00 */ u32 numQueued;
+    /* 0x04 */ u32 numEnded;
+    /* 0x08 */ u32 numPrepared;
+    /* 0x0C */ u32 numGrown;
+    /* 0x10 */ u32 numFull;
+    /* 0x14 */ u32 numDeferred; // state changes that found DTK busy
+    /* 0x18 */ u32 numGaps;
+    /* 0x20 */ OSTime totalGap; // TRACK_ENDED to the PLAYBACK_STARTED of the next track
+    /* 0x28 */ OSTime maxGap;
+} DTQStats; // size = 0x30
+
+typedef struct DTKQueue {
+    /* 0x00 */ DTQSlot** ring; // tracks in play order; the slots never move since DTK links them
+    /* 0x04 */ u32 capacity;
+    /* 0x08 */ u32 head;
+    /* 0x0C */ u32 count;
+    /* 0x10 */ DTQSlot* freeList;
+    /* 0x14 */ DTQSlot* endedList;
+    /* 0x18 */ DTQAlloc alloc;
+    /* 0x1C */ DTQFree free;
+    /* 0x20 */ BOOL ringAllocated; // ring came from alloc in dtqGrow rather than from dtqInit
+    /* 0x24 */ volatile s32 pendingState;
+    /* 0x28 */ OSAlarm alarm;
+    /* 0x50 */ BOOL alarmSet;
+    /* 0x54 */ BOOL preparing;
+    /* 0x58 */ DVDFileInfo prepareFile; // separate from the track's, DTK uses that command block itself
+    /* 0x98 */ OSTime endTime;
+    /* 0xA0 */ DTQStats stats;
+} DTKQueue; // size = 0xD0
+
+// ring and slots hold count entries each; alloc and free may be NULL for a fixed size queue
+extern void dtqInit(DTKQueue* queue, DTQSlot** ring, DTQSlot* slots, u32 count, DTQAlloc alloc, DTQFree free);
+extern u32 dtqAddTrack(DTKQueue* queue, char* fileName, u32 eventMask, DTKCallback callback);
+extern void dtqSetState(DTKQueue* queue, u32 state);
+extern void dtqGetStats(DTKQueue* queue, DTQStats* stats);
+extern void dtqReport(DTKQueue* queue);
+
+#define dtqPlay(queue) dtqSetState(queue, DTK_STATE_RUN)
+#define dtqStop(queue) dtqSetState(queue, DTK_STATE_STOP)
+
+#endif
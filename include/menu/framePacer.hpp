@@ -0,0 +1,66 @@
+#ifndef _MENU_FRAMEPACER_HPP
+#define _MENU_FRAMEPACER_HPP
+
+#include "dolphin/types.h"
+
+// Frame pacing statistics and buffering policy. The core only consumes timestamps (in OSTime ticks or any other
+// monotonic unit) so the same code runs from the VI/GX callbacks on hardware and from a host simulation.
+
+#define FP_WINDOW_SIZE 64
+#define FP_HISTOGRAM_SIZE 16
+
+// interval histogram buckets are 1/8th of a field each, the last bucket collects everything above two fields
+#define FP_INTERVAL_BUCKET_SHIFT 3
+
+// jitter histogram buckets are 1/64th of a field each, centered on the nominal field period
+#define FP_JITTER_BUCKET_SHIFT 6
+
+// switch to triple buffering once the worst recent frame uses more than 7/8 of a field, back to double buffering
+// once it stays under 5/8
+#define FP_TRIPLE_THRESHOLD(period) ((period) - ((period) >> 3))
+#define FP_DOUBLE_THRESHOLD(period) (((period) >> 1) + ((period) >> 3))
+
+typedef struct FramePacerStats {
+    /* 0x00 */ u32 numFrames;
+    /* 0x04 */ u32 numPresented;
+    /* 0x08 */ u32 numMissed;
+    /* 0x0C */ u32 longestMissRun;
+    /* 0x10 */ u32 numBufferSwitches;
+    /* 0x14 */ u32 intervalHistogram[FP_HISTOGRAM_SIZE];
+    /* 0x54 */ u32 jitterHistogram[FP_HISTOGRAM_SIZE];
+} FramePacerStats; // size = 0x94
+
+// One XFB is always on display. A finished frame waits in the queue for the next retrace to show it, and a new frame
+// can only start drawing when an XFB is free: with double buffering once the queue is empty, with triple buffering
+// while at most one frame waits.
+typedef struct FramePacer {
+    /* 0x00 */ s64 fieldPeriod;
+    /* 0x08 */ s64 lastRetrace;
+    /* 0x10 */ s64 frameStart;
+    /* 0x18 */ s64 window[FP_WINDOW_SIZE];
+    /* 0x218 */ u32 windowCount;
+    /* 0x21C */ u32 windowIndex;
+    /* 0x220 */ u32 numBuffers;
+    /* 0x224 */ u32 numQueued;
+    /* 0x228 */ u32 missRun;
+    /* 0x22C */ BOOL drawPending;
+    /* 0x230 */ FramePacerStats stats;
+} FramePacer; // size = 0x2C8
+
+// Core, timestamps in caller units
+extern void fpInit(FramePacer* pacer, s64 fieldPeriod);
+extern void fpRetrace(FramePacer* pacer, s64 time);
+extern void fpBeginFrame(FramePacer* pacer, s64 time);
+extern void fpDrawDone(FramePacer* pacer, s64 time);
+extern BOOL fpCanBeginFrame(FramePacer* pacer);
+extern u32 fpGetNumBuffers(FramePacer* pacer);
+extern s64 fpGetWorstInterval(FramePacer* pacer);
+extern s64 fpGetStartDelay(FramePacer* pacer, s64 margin);
+extern void fpGetStats(FramePacer* pacer, FramePacerStats* stats);
+
+// Hardware glue: hooks the VI post-retrace and GX draw-done callbacks, chaining to whatever was installed before
+extern void fpInstall(FramePacer* pacer);
+extern void fpRemove(void);
+extern void fpReport(FramePacer* pacer);
+
+#endif
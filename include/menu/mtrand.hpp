@@ -0,0 +1,29 @@
+#ifndef _MENU_MTRAND_HPP
+#define _MENU_MTRAND_HPP
+
+#include "dolphin/types.h"
+
+// MT19937 on the state sgenrand seeds in mtrand.cpp. The whole state is regenerated in one pass every 624 numbers,
+// and genrand_fill tempers straight out of it, so a batch costs no more per number than the generator itself.
+// The sequence is the reference genrand one for the same seed, and an unseeded generator seeds itself with 4357
+// like the reference does.
+
+#define MT_N 0x270
+#define MT_M 0x18D
+#define MT_DEFAULT_SEED 4357
+
+extern u32 mt[MT_N];
+extern s32 mti;
+
+extern u32 sgenrand(u32 seed);
+
+extern u32 genrand(void);
+extern void genrand_fill(u32* out, u32 n);
+
+// 24 random bits in [0, 1), exact in an f32
+extern f32 genrand_float(void);
+
+// Uniform in [min, max] without modulo bias
+extern s32 genrand_range(s32 min, s32 max);
+
+#endif
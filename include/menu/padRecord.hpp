@@ -0,0 +1,67 @@
+#ifndef _MENU_PADRECORD_HPP
+#define _MENU_PADRECORD_HPP
+
+#include "dolphin/pad.h"
+#include "dolphin/types.h"
+
+// Records the PADStatus of all four channels every frame and plays it back exactly, so benchmark runs of two
+// builds see the same input. Input code calls prRead where it called PADRead; with the recorder off it is PADRead.
+// PADRead still runs while replaying, so the SI traffic and its cost are the same as in the recorded run.
+//
+// A recording is a PR_HEADER_SIZE header followed by one entry per frame:
+//  - 0x80 | n: the next n frames (1 to PR_MAX_RUN) are the same as the one before,
+//  - otherwise a mask of the channels that changed, then for each of them a big-endian mask of the fields that
+//    changed (PR_FIELD_*) and the new values in field order, the buttons as a big-endian u16, the rest one byte each.
+// Frames are compared against the one before, all zeroes before the first. The header holds the frame count and a
+// CRC-32 of every field of every frame, which replay checks.
+//
+// Recording goes to a buffer in memory that the caller saves, replay reads a buffer the caller loaded.
+
+#define PR_MAGIC 0x50414452 // 'PADR'
+#define PR_VERSION 1
+#define PR_HEADER_SIZE 0x10
+#define PR_MAX_RUN 0x7F
+#define PR_RUN_FLAG 0x80
+
+#define PR_FIELD_BUTTON (1 << 0)
+#define PR_NUM_FIELDS 10 // the buttons, then the bytes from stickX to err
+
+// largest entry one frame can add, a pending run included
+#define PR_MAX_FRAME_SIZE (1 + 1 + PAD_MAX_CONTROLLERS * (2 + 2 + (PR_NUM_FIELDS - 1)))
+
+typedef enum PRState {
+    PR_STATE_OFF,
+    PR_STATE_RECORDING,
+    PR_STATE_REPLAYING,
+    PR_STATE_RECORD_FULL, // the record buffer filled up, prFinishRecord still has to write the header
+    PR_STATE_REPLAY_DONE, // the recording being replayed ended
+} PRState;
+
+typedef struct PadRecorder {
+    /* 0x00 */ PRState state;
+    /* 0x04 */ u8* buffer;
+    /* 0x08 */ u32 size;
+    /* 0x0C */ u32 position;
+    /* 0x10 */ u32 numFrames; // recorded so far, or in the recording being replayed
+    /* 0x14 */ u32 frame; // frames replayed
+    /* 0x18 */ u32 run; // unchanged frames not written out yet, or still to replay
+    /* 0x1C */ u32 crc;
+    /* 0x20 */ u32 expectedCrc;
+    /* 0x24 */ BOOL overflow;
+    /* 0x28 */ BOOL corrupt;
+    /* 0x2C */ PADStatus last[PAD_MAX_CONTROLLERS];
+} PadRecorder; // size = 0x5C
+
+// Core, works on PADStatus arrays and buffers only
+extern void prInit(PadRecorder* recorder);
+extern void prStartRecord(PadRecorder* recorder, void* buffer, u32 size);
+extern BOOL prRecordFrame(PadRecorder* recorder, const PADStatus* status);
+extern u32 prFinishRecord(PadRecorder* recorder);
+extern BOOL prStartReplay(PadRecorder* recorder, const void* data, u32 size);
+extern BOOL prReplayFrame(PadRecorder* recorder, PADStatus* status);
+extern BOOL prReplayMatched(PadRecorder* recorder);
+
+// PADRead with recording or replay applied
+extern u32 prRead(PadRecorder* recorder, PADStatus* status);
+
+#endif
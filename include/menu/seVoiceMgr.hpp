@@ -0,0 +1,64 @@
+#ifndef _MENU_SEVOICEMGR_HPP
+#define _MENU_SEVOICEMGR_HPP
+
+#include "dolphin/os.h"
+#include "dolphin/sp.h"
+#include "dolphin/types.h"
+#include "menu/soundEffect.hpp"
+
+// Sound effect voice manager: O(1) voice allocation from an intrusive free list, an active list so the AX callback
+// only visits live voices, and priority-based stealing when AX runs out of voices.
+//
+// sevmInitSound, sevmPlayMenuSE and sevmStopAll stand in for seInit, sePlaySE and seQuit: the manager loads its own
+// sound table, registers its own AX callback and maps the four menu sounds to the SEStatus volumes the same way.
+
+#define SEVM_PRIORITY_MIN 1
+#define SEVM_PRIORITY_DEFAULT 0xF
+#define SEVM_PRIORITY_MAX 31
+
+#define SEVM_NUM_MENU_SE 4 // cancel, okai, select, start, in sePlaySE index order
+
+typedef struct SEVoiceNode {
+    /* 0x00 */ SEVoice voice;
+    /* 0x08 */ struct SEVoiceNode* next;
+    /* 0x0C */ struct SEVoiceNode* prev;
+    /* 0x10 */ u32 priority;
+    /* 0x14 */ u32 serial;
+} SEVoiceNode; // size = 0x18
+
+typedef struct SEVoiceMgrTiming {
+    /* 0x00 */ u32 numCalls;
+    /* 0x04 */ OSTick maxTicks;
+    /* 0x08 */ OSTick totalTicks;
+} SEVoiceMgrTiming; // size = 0xC
+
+typedef struct SEVoiceMgrStats {
+    /* 0x00 */ u32 numPlays;
+    /* 0x04 */ u32 numSteals;
+    /* 0x08 */ u32 numDrops;
+    /* 0x0C */ u32 numFailures;
+    /* 0x10 */ SEVoiceMgrTiming play;   // interrupts-disabled time in sevmPlaySE
+    /* 0x1C */ SEVoiceMgrTiming update; // interrupts-disabled time in sevmUpdate
+} SEVoiceMgrStats; // size = 0x28
+
+typedef struct SEVoiceMgr {
+    /* 0x000 */ SEVoiceNode nodes[NUM_VOICE];
+    /* 0x600 */ SEVoiceNode* freeList;
+    /* 0x604 */ SEVoiceNode* activeList;
+    /* 0x608 */ u32 numActive;
+    /* 0x60C */ u32 serial;
+    /* 0x610 */ SPSoundTable* table;
+    /* 0x614 */ s32 menuVolumes[SEVM_NUM_MENU_SE];
+    /* 0x624 */ SEVoiceMgrStats stats;
+} SEVoiceMgr; // size = 0x64C
+
+extern void sevmInitSound(SEVoiceMgr* mgr, SEStatus* status);
+extern void sevmInit(SEVoiceMgr* mgr, SPSoundTable* table);
+extern SEVoiceNode* sevmPlaySE(SEVoiceMgr* mgr, u32 index, s32 volume, u32 priority);
+extern SEVoiceNode* sevmPlayMenuSE(SEVoiceMgr* mgr, u32 index);
+extern void sevmStop(SEVoiceMgr* mgr, SEVoiceNode* node);
+extern void sevmStopAll(SEVoiceMgr* mgr);
+extern void sevmUpdate(SEVoiceMgr* mgr);
+extern void sevmReport(SEVoiceMgr* mgr);
+
+#endif
@@ -22,6 +22,9 @@ typedef struct SEStatus {
     /* 0x10 */ s32 startVolume;
 } SEStatus; // size = 0x14
 
+extern u32 aramMemArray[3];
+extern u8 xfer_buffer[0x4000];
+
 extern void ax_se_callback(void);
 extern void seInit(SEStatus* status);
 extern void sePlaySE(u32 index);
@@ -0,0 +1,84 @@
+#ifndef _MENU_STREAMLOADER_HPP
+#define _MENU_STREAMLOADER_HPP
+
+#include "dolphin/arq.h"
+#include "dolphin/dvd.h"
+#include "dolphin/os.h"
+#include "dolphin/types.h"
+
+// Pipelined DVD to ARAM loader. __AMPushBuffered reads a chunk into its one staging buffer, DMAs it to ARAM and
+// only then reads the next one; with N staging buffers the DVD read of chunk k+1 (and the filter of chunk k, if
+// any) overlaps the ARQ transfer of chunk k. One buffer gives exactly the __AMPushBuffered behaviour.
+//
+// All of a load's state is in the caller's StreamLoader, which the DVD and ARQ callbacks find through the file's
+// userData and their buffer, so loads with their own StreamLoader can run at once from different threads.
+
+#define SL_MAX_BUFFERS 8
+#define SL_ARQ_OWNER 0x534C // 'SL'
+
+// Called in thread context on each chunk before it goes to ARAM, e.g. to decompress it. src is the tail of the
+// staging buffer, so dst and src overlap when the filter expands; it returns the number of bytes written to dst,
+// which has to be a multiple of 32 for every chunk but the last.
+typedef u32 (*SLFilter)(void* dst, u32 dstSize, const void* src, u32 srcLength, void* userData);
+
+typedef enum SLBufferState {
+    SL_BUFFER_FREE,
+    SL_BUFFER_READING,
+    SL_BUFFER_READ,
+    SL_BUFFER_DMA,
+} SLBufferState;
+
+typedef struct SLConfig {
+    /* 0x00 */ u32 numBuffers;
+    /* 0x04 */ u32 bufferSize; // multiple of 32
+    /* 0x08 */ u32 readSize;   // DVD bytes per chunk, at most bufferSize; 0 reads whole buffers
+    /* 0x0C */ SLFilter filter;
+    /* 0x10 */ void* userData;
+} SLConfig; // size = 0x14
+
+typedef struct SLStats {
+    /* 0x00 */ u32 numChunks;
+    /* 0x04 */ u32 bytesRead;
+    /* 0x08 */ u32 bytesWritten;
+    /* 0x10 */ OSTime totalTime;
+    /* 0x18 */ OSTime readTime;   // sum of the DVD reads
+    /* 0x20 */ OSTime filterTime; // sum of the filter calls
+    /* 0x28 */ OSTime dmaTime;    // sum of the ARQ requests, without the time queued behind the previous one
+} SLStats; // size = 0x30
+
+typedef struct SLBuffer {
+    /* 0x00 */ ARQRequest request;
+    /* 0x20 */ u8* data;
+    /* 0x24 */ u32 length;
+    /* 0x28 */ volatile SLBufferState state;
+    /* 0x2C */ struct StreamLoader* loader;
+    /* 0x30 */ OSTime start;
+} SLBuffer; // size = 0x38
+
+typedef struct StreamLoader {
+    /* 0x000 */ SLConfig config;
+    /* 0x018 */ SLBuffer buffers[SL_MAX_BUFFERS];
+    /* 0x1D8 */ DVDFileInfo file;
+    /* 0x214 */ OSThreadQueue queue;
+    /* 0x21C */ u32 readOffset;
+    /* 0x220 */ u32 aramOffset;
+    /* 0x224 */ u32 aramAddr;
+    /* 0x228 */ u32 readSlot;
+    /* 0x22C */ u32 postSlot;
+    /* 0x230 */ volatile BOOL reading;
+    /* 0x234 */ volatile BOOL failed;
+    /* 0x238 */ SLStats stats;
+    /* 0x268 */ OSTime lastDMADone;
+} StreamLoader; // size = 0x270
+
+// work must be 32-byte aligned and hold numBuffers * bufferSize bytes
+extern BOOL slInit(StreamLoader* loader, const SLConfig* config, void* work);
+
+// Blocks the calling thread until the whole file is in ARAM at aramAddr. The last chunk is rounded up to 32 bytes
+// like AM does, so the ARAM area needs that much slack. Returns the number of bytes written, 0 on failure.
+extern u32 slLoad(StreamLoader* loader, char* path, u32 aramAddr);
+
+extern void slGetStats(StreamLoader* loader, SLStats* stats);
+extern void slReport(StreamLoader* loader);
+
+#endif
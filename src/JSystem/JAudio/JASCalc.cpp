@@ -0,0 +1,229 @@
+#include "JSystem/JAudio/JASCalc.h"
+#include "dolphin/os/OSFastCast.h"
+#include "macros.h"
+#include <math.h>
+#include <string.h>
+
+// The sine tables have JASC_TABLE_SIZE intervals and are read with linear interpolation. The error of interpolating
+// sin(x * pi/2) is at most h^2/8 * (pi/2)^2 with h = 1/JASC_TABLE_SIZE, 2.4e-7 here, plus f32 rounding: sinfT stays
+// within 4e-7 of the exact value over all of [0, 1], where a 256-entry table read without interpolation is off by
+// up to 3e-3 (tools/host/jascalc measures both).
+#define JASC_TABLE_SIZE 1024
+
+// Pro Logic II puts a hard-panned surround into the two encoded channels at -1.2 dB and -6.2 dB; sinfDolby2 moves
+// between those two gains at constant power.
+#define JASC_DOL2_NEAR 0.8718
+#define JASC_DOL2_FAR 0.4899
+
+namespace JASystem {
+    namespace Calc {
+        // one extra entry so x == 1.0 can interpolate without a bounds check
+        static f32 sSinTable[JASC_TABLE_SIZE + 2];
+        static f32 sDol2Table[JASC_TABLE_SIZE + 2];
+
+        f32* JASC_SINTABLE = sSinTable;
+        f32* JASC_DOL2TABLE = sDol2Table;
+
+        static inline f32 lookup(const f32* table, f32 x) {
+            f32 position;
+            s32 index;
+
+            if (x <= 0.0f) {
+                return table[0];
+            }
+            if (x >= 1.0f) {
+                return table[JASC_TABLE_SIZE];
+            }
+
+            position = x * JASC_TABLE_SIZE;
+            index = (s32)position;
+            return table[index] + (table[index + 1] - table[index]) * (position - index);
+        }
+
+        void initSinfT() {
+            f32 start;
+            f32 range;
+            s32 i;
+
+            start = atan(JASC_DOL2_FAR / JASC_DOL2_NEAR);
+            range = M_PI / 2 - 2 * start;
+            for (i = 0; i <= JASC_TABLE_SIZE; i++) {
+                sSinTable[i] = sinf((f32)i / JASC_TABLE_SIZE * (f32)(M_PI / 2));
+                sDol2Table[i] = sinf(start + (f32)i / JASC_TABLE_SIZE * range);
+            }
+            sSinTable[JASC_TABLE_SIZE + 1] = sSinTable[JASC_TABLE_SIZE];
+            sDol2Table[JASC_TABLE_SIZE + 1] = sDol2Table[JASC_TABLE_SIZE];
+
+#ifdef __MWERKS__
+            // the mixers below need the s16 GQRs and don't set them up themselves
+            OSInitFastCast();
+#endif
+        }
+
+        // sin(x * pi/2) for x in [0, 1], clamped outside
+        f32 sinfT(f32 x) { return lookup(sSinTable, x); }
+
+        f32 sinfDolby2(f32 x) { return lookup(sDol2Table, x); }
+
+#ifdef __MWERKS__
+        // Interleaves pairs * 2 samples from each source with quantized paired-single loads and stores; GQR5 has
+        // to be set up for s16 by OSInitFastCast, see imixcopy. All three pointers must be 4-byte aligned.
+        static ASM void imixcopyPS(register const s16* left, register const s16* right, register s16* out,
+                                   register s32 pairs) {
+            // clang-format off
+            nofralloc
+            mtctr   pairs
+            subi    left, left, 4
+            subi    right, right, 4
+            subi    out, out, 4
+        @1
+            psq_lu      fp0, 4(left), 0, OS_FASTCAST_S16
+            psq_lu      fp1, 4(right), 0, OS_FASTCAST_S16
+            ps_merge00  fp2, fp0, fp1
+            ps_merge11  fp3, fp0, fp1
+            psq_stu     fp2, 4(out), 0, OS_FASTCAST_S16
+            psq_stu     fp3, 4(out), 0, OS_FASTCAST_S16
+            bdnz        @1
+            blr
+            // clang-format on
+        }
+
+        // dst += src * volume over pairs * 2 samples; the quantized store saturates to s16
+        static ASM void imixaddPS(register const s16* src, register s16* dst, register s32 pairs,
+                                  register f32 volume) {
+            // clang-format off
+            nofralloc
+            mtctr   pairs
+            subi    src, src, 4
+            subi    dst, dst, 4
+        @1
+            psq_lu      fp0, 4(src), 0, OS_FASTCAST_S16
+            psq_l       fp2, 4(dst), 0, OS_FASTCAST_S16
+            ps_madds0   fp0, fp0, volume, fp2
+            psq_stu     fp0, 4(dst), 0, OS_FASTCAST_S16
+            bdnz        @1
+            blr
+            // clang-format on
+        }
+
+        // Copies lines * 32 bytes. Each destination line is claimed with dcbz so it isn't read from memory first;
+        // lfd/stfd move the bits unchanged whatever they are, which paired-single float loads don't promise.
+        static ASM void bcopyDcbz(register const u32* src, register u32* dst, register u32 lines) {
+            // clang-format off
+            nofralloc
+            mtctr   lines
+        @1
+            dcbz    r0, dst
+            lfd     fp0, 0(src)
+            lfd     fp1, 8(src)
+            lfd     fp2, 16(src)
+            lfd     fp3, 24(src)
+            addi    src, src, 32
+            stfd    fp0, 0(dst)
+            stfd    fp1, 8(dst)
+            stfd    fp2, 16(dst)
+            stfd    fp3, 24(dst)
+            addi    dst, dst, 32
+            bdnz    @1
+            blr
+            // clang-format on
+        }
+
+        static ASM void bzeroDcbz(register void* dst, register u32 lines) {
+            // clang-format off
+            nofralloc
+            mtctr   lines
+        @1
+            dcbz    r0, dst
+            addi    dst, dst, 32
+            bdnz    @1
+            blr
+            // clang-format on
+        }
+#endif
+
+        // Interleaves two mono buffers into one stereo buffer. Like imixadd this expects OSInitFastCast to have run
+        // on the calling thread: initSinfT does that for the thread that starts JAudio, and any other thread that
+        // mixes has to call it once itself since new threads start with the GQRs cleared.
+        void imixcopy(const s16* left, const s16* right, s16* out, s32 count) {
+            s32 i;
+
+#ifdef __MWERKS__
+            if (count >= 2 && (((u32)left | (u32)right | (u32)out) & 3) == 0) {
+                imixcopyPS(left, right, out, count / 2);
+                left += count & ~1;
+                right += count & ~1;
+                out += (count & ~1) * 2;
+                count &= 1;
+            }
+#endif
+
+            for (i = 0; i < count; i++) {
+                out[i * 2 + 0] = left[i];
+                out[i * 2 + 1] = right[i];
+            }
+        }
+
+        // Mixes count samples into dst at the given volume, saturating. Voices are interleaved stereo like dst.
+        void imixadd(const s16* src, s16* dst, s32 count, f32 volume) {
+            f32 sample;
+            s32 i;
+
+#ifdef __MWERKS__
+            if (count >= 2 && (((u32)src | (u32)dst) & 3) == 0) {
+                imixaddPS(src, dst, count / 2, volume);
+                src += count & ~1;
+                dst += count & ~1;
+                count &= 1;
+            }
+#endif
+
+            for (i = 0; i < count; i++) {
+                sample = (f32)src[i] * volume;
+                sample = (f32)dst[i] + sample;
+                dst[i] = (s16)CLAMP((s32)sample, -32768, 32767);
+            }
+        }
+
+        // size is in bytes. The fast path needs both pointers 32-byte aligned and size a multiple of 32, which is
+        // how the DSP buffers are laid out; anything else takes the plain word copy.
+        void bcopyfast(const u32* src, u32* dst, u32 size) {
+#ifdef __MWERKS__
+            if (((u32)src & 31) == 0 && ((u32)dst & 31) == 0 && (size & 31) == 0 && size != 0) {
+                bcopyDcbz(src, dst, size / 32);
+                return;
+            }
+#endif
+            bcopy(src, dst, size);
+        }
+
+        void bcopy(const void* src, void* dst, u32 size) {
+            const u8* from;
+            u8* to;
+
+            from = (const u8*)src;
+            to = (u8*)dst;
+            if ((((u32)from | (u32)to) & (sizeof(u32) - 1)) == 0) {
+                for (; size >= sizeof(u32); size -= sizeof(u32), from += sizeof(u32), to += sizeof(u32)) {
+                    *(u32*)to = *(const u32*)from;
+                }
+            }
+            for (; size != 0; size--) {
+                *to++ = *from++;
+            }
+        }
+
+        // Same alignment rules as bcopyfast. dcbz only works on cached memory.
+        void bzerofast(void* dst, u32 size) {
+#ifdef __MWERKS__
+            if (((u32)dst & 31) == 0 && (size & 31) == 0 && size != 0) {
+                bzeroDcbz(dst, size / 32);
+                return;
+            }
+#endif
+            bzero(dst, size);
+        }
+
+        void bzero(void* dst, u32 size) { memset(dst, 0, size); }
+    } // namespace Calc
+} // namespace JASystem
@@ -0,0 +1,47 @@
+#include "JSystem/JKernel/JKRAramBlock.h"
+#include "JSystem/JKernel/JKRAramHeap.h"
+#include "JSystem/JKernel/JKRHeap.h"
+
+// A block owns mSize bytes at mAddress and the mFreeSize bytes after them, up to the next block. The heap's list is
+// in address order and starts with an empty block at the bottom of the heap, so every gap belongs to the block in
+// front of it: allocating splits a block's gap, and freeing a block hands its bytes and its gap to the one before,
+// which joins the free space on both sides of it.
+
+JKRAramBlock::JKRAramBlock(u32 address, u32 size, u32 freeSize, u8 groupId, bool isTempMemory)
+    : mBlockLink(this), mAddress(address), mSize(size), mFreeSize(freeSize), mGroupId(groupId),
+      mIsTempMemory(isTempMemory), mIsMovable(false) {}
+
+JKRAramBlock::~JKRAramBlock() {
+    JSULink<JKRAramBlock>* prev = mBlockLink.getPrev();
+    JSUList<JKRAramBlock>* list = mBlockLink.getSupervisor();
+
+    if (prev != NULL) {
+        JKRAramBlock* prevBlock = prev->getObject();
+        prevBlock->mFreeSize = mSize + mFreeSize + prevBlock->mFreeSize;
+        list->remove(&mBlockLink);
+    } else {
+        mFreeSize += mSize;
+        mSize = 0;
+    }
+}
+
+JKRAramBlock* JKRAramBlock::allocHead(u32 size, u8 groupId, JKRAramHeap* aramHeap) {
+    u32 newAddress = mAddress + mSize;
+    u32 newFreeSize = mFreeSize - size;
+
+    JKRAramBlock* block =
+        new (aramHeap->getMgrHeap(), 0) JKRAramBlock(newAddress, size, newFreeSize, groupId, false);
+    mFreeSize = 0;
+    mBlockLink.getSupervisor()->insert(mBlockLink.getNext(), &block->mBlockLink);
+    return block;
+}
+
+JKRAramBlock* JKRAramBlock::allocTail(u32 size, u8 groupId, JKRAramHeap* aramHeap) {
+    u32 endAddress = mAddress + mSize + mFreeSize;
+    u32 newAddress = endAddress - size;
+
+    JKRAramBlock* block = new (aramHeap->getMgrHeap(), 0) JKRAramBlock(newAddress, size, 0, groupId, true);
+    mFreeSize -= size;
+    mBlockLink.getSupervisor()->insert(mBlockLink.getNext(), &block->mBlockLink);
+    return block;
+}
@@ -0,0 +1,231 @@
+#include "JSystem/JKernel/JKRAramHeap.h"
+#include "JSystem/JKernel/JKRAramPiece.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "dolphin/os.h"
+#include "macros.h"
+
+// Head allocations are best fit: they take the smallest gap the size fits in, the lowest one of those, so the large
+// gaps are kept for large banks. Tail allocations take the highest gap that fits, for data that is only there for a
+// short while.
+//
+// Banks loaded and unloaded in any order still leave the free space in pieces too small for the next big one.
+// compact moves the blocks marked movable down over the gaps in front of them, so the free space collects above
+// them. ARAM can only be copied to and from main memory, so each block goes through a bounce buffer, low end first,
+// which is safe as blocks only ever move down. The callback gets each block as it is moved, for owners that keep
+// copies of its address.
+
+JSUList<JKRAramBlock> JKRAramHeap::sAramList;
+
+JKRAramHeap::JKRAramHeap(u32 startAddress, u32 size) {
+    OSInitMutex(&mMutex);
+    mHeap = JKRHeap::findFromRoot(this);
+    mSize = ALIGN_PREV(size, 0x20);
+    mHeadAddress = ALIGN_NEXT(startAddress, 0x20);
+    mTailAddress = mHeadAddress + mSize;
+    mGroupId = -1;
+
+    JKRAramBlock* block = new (mHeap, 0) JKRAramBlock(mHeadAddress, 0, mSize, -1, false);
+    sAramList.append(&block->mBlockLink);
+}
+
+JKRAramHeap::~JKRAramHeap() {
+    JSUListIterator<JKRAramBlock> iterator(sAramList.getFirst());
+
+    while (iterator != sAramList.getEnd()) {
+        delete (iterator++).getObject();
+    }
+}
+
+JKRAramBlock* JKRAramHeap::alloc(u32 size, EAllocMode allocMode) {
+    JKRAramBlock* block;
+
+    lock();
+    if (allocMode == HEAD) {
+        block = allocFromHead(size);
+    } else {
+        block = allocFromTail(size);
+    }
+    unlock();
+    return block;
+}
+
+JKRAramBlock* JKRAramHeap::allocFromHead(u32 size) {
+    u32 alignedSize = ALIGN_NEXT(size, 0x20);
+    u32 bestFreeSize = 0xFFFFFFFF;
+    JKRAramBlock* bestBlock = NULL;
+
+    for (JSUListIterator<JKRAramBlock> iterator(&sAramList); iterator != sAramList.getEnd(); ++iterator) {
+        JKRAramBlock* block = iterator.getObject();
+        if (block->mFreeSize < alignedSize || block->mFreeSize >= bestFreeSize) {
+            continue;
+        }
+
+        bestFreeSize = block->mFreeSize;
+        bestBlock = block;
+        if (bestFreeSize == alignedSize) {
+            break;
+        }
+    }
+
+    if (bestBlock != NULL) {
+        return bestBlock->allocHead(alignedSize, mGroupId, this);
+    }
+    return NULL;
+}
+
+JKRAramBlock* JKRAramHeap::allocFromTail(u32 size) {
+    u32 alignedSize = ALIGN_NEXT(size, 0x20);
+    JKRAramBlock* tailBlock = NULL;
+
+    for (JSUListIterator<JKRAramBlock> iterator(sAramList.getLast()); iterator != sAramList.getEnd(); --iterator) {
+        JKRAramBlock* block = iterator.getObject();
+        if (block->mFreeSize >= alignedSize) {
+            tailBlock = block;
+            break;
+        }
+    }
+
+    if (tailBlock != NULL) {
+        return tailBlock->allocTail(alignedSize, mGroupId, this);
+    }
+    return NULL;
+}
+
+u32 JKRAramHeap::getFreeSize() {
+    u32 maxFreeSize = 0;
+
+    lock();
+    for (JSUListIterator<JKRAramBlock> iterator(&sAramList); iterator != sAramList.getEnd(); ++iterator) {
+        if (iterator->mFreeSize > maxFreeSize) {
+            maxFreeSize = iterator->mFreeSize;
+        }
+    }
+    unlock();
+    return maxFreeSize;
+}
+
+u32 JKRAramHeap::getTotalFreeSize() {
+    u32 totalFreeSize = 0;
+
+    lock();
+    for (JSUListIterator<JKRAramBlock> iterator(&sAramList); iterator != sAramList.getEnd(); ++iterator) {
+        totalFreeSize += iterator->mFreeSize;
+    }
+    unlock();
+    return totalFreeSize;
+}
+
+void JKRAramHeap::getFragInfo(TFragInfo* info) {
+    info->mTotalFreeSize = 0;
+    info->mMaxFreeSize = 0;
+    info->mNumFreeBlocks = 0;
+    info->mNumUsedBlocks = 0;
+    info->mMovableSize = 0;
+
+    lock();
+    for (JSUListIterator<JKRAramBlock> iterator(&sAramList); iterator != sAramList.getEnd(); ++iterator) {
+        JKRAramBlock* block = iterator.getObject();
+        if (block->mSize != 0) {
+            info->mNumUsedBlocks++;
+            if (block->mIsMovable) {
+                info->mMovableSize += block->mSize;
+            }
+        }
+        if (block->mFreeSize != 0) {
+            info->mNumFreeBlocks++;
+            info->mTotalFreeSize += block->mFreeSize;
+            if (block->mFreeSize > info->mMaxFreeSize) {
+                info->mMaxFreeSize = block->mFreeSize;
+            }
+        }
+    }
+    unlock();
+
+    info->mFragmentation = 0;
+    if (info->mTotalFreeSize != 0) {
+        info->mFragmentation =
+            (u32)((u64)(info->mTotalFreeSize - info->mMaxFreeSize) * 100 / info->mTotalFreeSize);
+    }
+}
+
+// Moves movable blocks down over the gaps in front of them, lowest first, until maxBytes (0 for no limit) have been
+// moved. The bounce buffer is allocated from the manager heap if buffer is NULL. Returns the bytes moved.
+u32 JKRAramHeap::compact(u8* buffer, u32 bufferSize, u32 maxBytes, MoveCallback callback, void* param) {
+    bool allocated;
+    u32 moved;
+    u32 oldAddress;
+    u32 newAddress;
+    u32 offset;
+    u32 length;
+
+    bufferSize = ALIGN_PREV(bufferSize != 0 ? bufferSize : 0x8000, 0x20);
+    allocated = false;
+    if (buffer == NULL) {
+        buffer = (u8*)JKRAllocFromHeap(mHeap, bufferSize, -0x20);
+        if (buffer == NULL) {
+            return 0;
+        }
+        allocated = true;
+    }
+
+    moved = 0;
+    lock();
+    for (JSUListIterator<JKRAramBlock> iterator(&sAramList); iterator != sAramList.getEnd(); ++iterator) {
+        JKRAramBlock* block = iterator.getObject();
+        JSULink<JKRAramBlock>* prev = block->mBlockLink.getPrev();
+        if (prev == NULL || !block->mIsMovable || block->mSize == 0) {
+            continue;
+        }
+
+        JKRAramBlock* prevBlock = prev->getObject();
+        if (prevBlock->mFreeSize == 0) {
+            continue;
+        }
+        if (maxBytes != 0 && moved + block->mSize > maxBytes) {
+            break;
+        }
+
+        oldAddress = block->mAddress;
+        newAddress = prevBlock->mAddress + prevBlock->mSize;
+        for (offset = 0; offset < block->mSize; offset += length) {
+            length = block->mSize - offset < bufferSize ? block->mSize - offset : bufferSize;
+            // Lines of the buffer left dirty by its last use would be written back over what the DMA brings in. The
+            // CPU doesn't touch the data on its way back out, so there's nothing to flush before the second DMA.
+            DCInvalidateRange(buffer, length);
+            JKRAramPcs(ARAM_DIR_ARAM_TO_MRAM, oldAddress + offset, (u32)buffer, length, NULL);
+            JKRAramPcs(ARAM_DIR_MRAM_TO_ARAM, (u32)buffer, newAddress + offset, length, NULL);
+        }
+
+        block->mAddress = newAddress;
+        block->mFreeSize += prevBlock->mFreeSize;
+        prevBlock->mFreeSize = 0;
+        moved += block->mSize;
+        if (callback != NULL) {
+            callback(block, oldAddress, param);
+        }
+    }
+    unlock();
+
+    if (allocated) {
+        JKRFreeToHeap(mHeap, buffer);
+    }
+    return moved;
+}
+
+void JKRAramHeap::dump() {
+    TFragInfo info;
+
+    lock();
+    OSReport("\nJKRAramHeap dump\n");
+    OSReport(" attr  address:   size     free  gid\n");
+    for (JSUListIterator<JKRAramBlock> iterator(&sAramList); iterator != sAramList.getEnd(); ++iterator) {
+        JKRAramBlock* block = iterator.getObject();
+        OSReport("%s%s %08lx: %08lx %08lx %3d\n", block->mIsTempMemory ? " temp" : " used",
+                 block->mIsMovable ? "*" : " ", block->mAddress, block->mSize, block->mFreeSize, block->mGroupId);
+    }
+    unlock();
+
+    getFragInfo(&info);
+    OSReport("%lu blocks, %lu free in %lu gaps, largest %lu, %lu%% fragmented, %lu movable\n", info.mNumUsedBlocks,
+             info.mTotalFreeSize, info.mNumFreeBlocks, info.mMaxFreeSize, info.mFragmentation, info.mMovableSize);
+}
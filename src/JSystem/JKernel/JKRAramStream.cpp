@@ -0,0 +1,375 @@
+#include "JSystem/JKernel/JKRAramStream.h"
+#include "JSystem/JKernel/JKRAramPiece.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "JSystem/JSupport/JSUFileStream.h"
+#include "dolphin/os.h"
+#include "macros.h"
+
+// The stream thread copies a file to ARAM through a transfer buffer cut into transCount chunks. Each chunk is sent
+// to ARAM with its own DMA as soon as it has been read, and the stream is read into the next one meanwhile, so the
+// drive and the DMA work at the same time; a chunk is only waited for when the reads come back around to it.
+//
+// When it wakes up the thread also takes whatever other commands are queued, up to batchSize, and writes them in
+// one pass through the same buffers. Where a command carries on from the previous one in the file and in ARAM, its
+// first bytes go in the same DMA as the last ones of the previous command. Each command is answered when the DMA
+// with its last bytes is done. The batch uses the transfer buffer of the first command.
+
+JKRAramStream* JKRAramStream::sAramStreamObject;
+OSMessage JKRAramStream::sMessageBuffer[JKR_ARAM_STREAM_MAX_BATCH];
+OSMessageQueue JKRAramStream::sMessageQueue;
+
+u8* JKRAramStream::transBuffer;
+u32 JKRAramStream::transSize;
+JKRHeap* JKRAramStream::transHeap;
+u32 JKRAramStream::transCount = 2;
+u32 JKRAramStream::batchSize = JKR_ARAM_STREAM_MAX_BATCH;
+
+// One writeToAram call
+struct JKRAramStreamPipeline {
+    /* 0x00 */ JKRAramStreamCommand** mCommands;
+    /* 0x04 */ u8* mBuffer;
+    /* 0x08 */ u32 mNumBuffers;
+    /* 0x0C */ u32 mChunkSize;
+    /* 0x10 */ JKRAMCommand* mPieces[JKR_ARAM_STREAM_MAX_BUFFERS]; // the DMA of each chunk, NULL if none
+    /* 0x20 */ u32 mPieceDone[JKR_ARAM_STREAM_MAX_BUFFERS];        // mNumRead when it was started
+    /* 0x30 */ u32 mChunk;     // the one being read into
+    /* 0x34 */ u32 mFill;      // bytes read into it so far
+    /* 0x38 */ u32 mFillDst;   // where they go in ARAM
+    /* 0x3C */ u32 mFillFirst; // the commands they belong to
+    /* 0x40 */ u32 mFillLast;
+    /* 0x44 */ u32 mNumRead; // commands completely read
+    /* 0x48 */ u32 mNumDone; // commands answered
+};
+
+static void finishCommands(JKRAramStreamPipeline* pipeline, u32 end) {
+    JKRAramStreamCommand* command;
+
+    while (pipeline->mNumDone < end) {
+        command = pipeline->mCommands[pipeline->mNumDone++];
+        if (command->mStats != NULL) {
+            command->mStats->mBytes = command->mSize;
+            command->mStats->mEndTime = OSGetTime();
+        }
+        OSSendMessage(&command->mMessageQueue, (OSMessage)command->mSize, OS_MESSAGE_NOBLOCK);
+    }
+}
+
+static void startChunk(JKRAramStreamPipeline* pipeline) {
+    JKRAramStreamCommand* command;
+    u32 chunk;
+    u32 i;
+
+    chunk = pipeline->mChunk;
+    pipeline->mPieces[chunk] =
+        JKRAramPiece::orderAsync(ARAM_DIR_MRAM_TO_ARAM, (u32)pipeline->mBuffer + chunk * pipeline->mChunkSize,
+                                 pipeline->mFillDst, pipeline->mFill, NULL, NULL);
+    pipeline->mPieceDone[chunk] = pipeline->mNumRead;
+    for (i = pipeline->mFillFirst; i <= pipeline->mFillLast; i++) {
+        command = pipeline->mCommands[i];
+        if (command->mStats != NULL) {
+            command->mStats->mChunks++;
+        }
+    }
+
+    pipeline->mChunk = chunk + 1 < pipeline->mNumBuffers ? chunk + 1 : 0;
+    pipeline->mFill = 0;
+}
+
+// Waits for the DMA out of the chunk about to be read into, which is charged to reader
+static void waitChunk(JKRAramStreamPipeline* pipeline, JKRAramStreamCommand* reader) {
+    u32 chunk;
+    OSTime start;
+
+    chunk = pipeline->mChunk;
+    if (pipeline->mPieces[chunk] == NULL) {
+        return;
+    }
+
+    start = OSGetTime();
+    JKRAramPiece::sync(pipeline->mPieces[chunk], 0);
+    pipeline->mPieces[chunk] = NULL;
+    if (reader->mStats != NULL) {
+        reader->mStats->mWaitTime += OSGetTime() - start;
+    }
+    finishCommands(pipeline, pipeline->mPieceDone[chunk]);
+}
+
+static bool isContiguous(const JKRAramStreamCommand* prev, const JKRAramStreamCommand* next) {
+    // the reads into the buffer have to stay 32 byte aligned
+    return next->mStream == prev->mStream && next->mOffset == prev->mOffset + prev->mSize &&
+           next->mAddress == prev->mAddress + prev->mSize && (prev->mSize & 0x1F) == 0;
+}
+
+JKRAramStream* JKRAramStream::create(s32 priority) {
+    if (sAramStreamObject == NULL) {
+        sAramStreamObject = new (JKRGetSystemHeap(), 0) JKRAramStream(priority);
+        setTransBuffer(NULL, 0, NULL);
+    }
+    return sAramStreamObject;
+}
+
+JKRAramStream::JKRAramStream(s32 priority) : JKRThread(0x4000, 0x10, priority) { resume(); }
+
+JKRAramStream::~JKRAramStream() {}
+
+void* JKRAramStream::run() {
+    JKRAramStreamCommand* batch[JKR_ARAM_STREAM_MAX_BATCH];
+    JKRAramStreamCommand* command;
+    JKRAramStreamCommand* next;
+    OSMessage message;
+    u32 count;
+
+    OSInitMessageQueue(&sMessageQueue, sMessageBuffer, ARRAY_COUNT(sMessageBuffer));
+    next = NULL;
+    for (;;) {
+        if (next == NULL) {
+            OSReceiveMessage(&sMessageQueue, &message, OS_MESSAGE_BLOCK);
+            command = (JKRAramStreamCommand*)message;
+        } else {
+            command = next;
+            next = NULL;
+        }
+        switch (command->mType) {
+        case JKRAramStreamCommand::READ:
+            readFromAram();
+            break;
+        case JKRAramStreamCommand::WRITE:
+            // the writes queued behind this one, up to the first other command, which is handled after them
+            batch[0] = command;
+            count = 1;
+            while (count < batchSize && OSReceiveMessage(&sMessageQueue, &message, OS_MESSAGE_NOBLOCK)) {
+                next = (JKRAramStreamCommand*)message;
+                if (next->mType != JKRAramStreamCommand::WRITE) {
+                    break;
+                }
+                batch[count++] = next;
+                next = NULL;
+            }
+            writeToAram(batch, count);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+s32 JKRAramStream::readFromAram() { return 1; }
+
+s32 JKRAramStream::writeToAram(JKRAramStreamCommand* command) { return writeToAram(&command, 1); }
+
+s32 JKRAramStream::writeToAram(JKRAramStreamCommand** commands, u32 count) {
+    JKRAramStreamPipeline pipeline;
+    JKRAramStreamCommand* command;
+    JSURandomInputStream* stream;
+    JKRHeap* heap;
+    bool allocated;
+    u8* buffer;
+    u32 bufferSize;
+    u32 remaining;
+    u32 destination;
+    u32 length;
+    u32 written;
+    u32 chunk;
+    u32 i;
+    OSTime start;
+
+    command = commands[0];
+    buffer = command->mTransferBuffer;
+    bufferSize = command->mTransferBufferSize != 0 ? command->mTransferBufferSize : 0x8000;
+    heap = command->mHeap;
+    allocated = false;
+    if (buffer == NULL) {
+        if (heap != NULL) {
+            buffer = (u8*)JKRAllocFromHeap(heap, bufferSize, -0x20);
+        } else {
+            buffer = (u8*)JKRAllocFromSysHeap(bufferSize, -0x20);
+        }
+        allocated = true;
+    }
+    // the first command may be answered before the batch is over, so from here on the flag is only kept locally
+    command->mAllocatedTransferBuffer = allocated;
+    command->mTransferBuffer = buffer;
+    command->mTransferBufferSize = bufferSize;
+
+    if (buffer == NULL) {
+        if (heap == NULL) {
+            JKRGetCurrentHeap()->dump();
+        } else {
+            heap->dump();
+        }
+        OSPanic(__FILE__, __LINE__, ":::Cannot alloc memory\n");
+    }
+
+    pipeline.mCommands = commands;
+    pipeline.mBuffer = buffer;
+    pipeline.mNumBuffers = transCount;
+    pipeline.mChunkSize = ALIGN_PREV(bufferSize / transCount, 0x20);
+    if (pipeline.mChunkSize == 0) {
+        pipeline.mNumBuffers = 1;
+        pipeline.mChunkSize = bufferSize;
+    }
+    for (i = 0; i < pipeline.mNumBuffers; i++) {
+        pipeline.mPieces[i] = NULL;
+    }
+    pipeline.mChunk = 0;
+    pipeline.mFill = 0;
+    pipeline.mNumRead = 0;
+    pipeline.mNumDone = 0;
+
+    written = 0;
+    for (i = 0; i < count; i++) {
+        command = commands[i];
+        if (command->mStats != NULL) {
+            command->mStats->mBatchSize = count;
+            command->mStats->mStartTime = OSGetTime();
+        }
+        if (pipeline.mFill != 0 && !isContiguous(commands[i - 1], command)) {
+            startChunk(&pipeline);
+        }
+
+        stream = (JSURandomInputStream*)command->mStream;
+        stream->seek(command->mOffset, JSUStreamSeekFrom_SET);
+        remaining = command->mSize;
+        destination = command->mAddress;
+        while (remaining != 0) {
+            if (pipeline.mFill == 0) {
+                waitChunk(&pipeline, command);
+                pipeline.mFillDst = destination;
+                pipeline.mFillFirst = i;
+            }
+
+            length = pipeline.mChunkSize - pipeline.mFill;
+            if (length > remaining) {
+                length = remaining;
+            }
+            start = OSGetTime();
+            stream->read(buffer + pipeline.mChunk * pipeline.mChunkSize + pipeline.mFill, length);
+            if (command->mStats != NULL) {
+                command->mStats->mReadTime += OSGetTime() - start;
+            }
+
+            pipeline.mFill += length;
+            pipeline.mFillLast = i;
+            remaining -= length;
+            destination += length;
+            written += length;
+            if (remaining == 0) {
+                pipeline.mNumRead = i + 1;
+            }
+            if (pipeline.mFill == pipeline.mChunkSize) {
+                startChunk(&pipeline);
+            }
+        }
+        pipeline.mNumRead = i + 1;
+    }
+    if (pipeline.mFill != 0) {
+        startChunk(&pipeline);
+    }
+
+    // oldest first, so the commands are still answered in order
+    for (i = 0; i < pipeline.mNumBuffers; i++) {
+        chunk = (pipeline.mChunk + i) % pipeline.mNumBuffers;
+        if (pipeline.mPieces[chunk] != NULL) {
+            JKRAramPiece::sync(pipeline.mPieces[chunk], 0);
+            pipeline.mPieces[chunk] = NULL;
+        }
+    }
+    // freed before the last commands are answered, as their callers may tear down the heap it came from
+    if (allocated) {
+        JKRFree(buffer);
+    }
+    finishCommands(&pipeline, count);
+    return written;
+}
+
+JKRAramStreamCommand* JKRAramStream::write_StreamToAram_Async(JSUFileInputStream* stream, u32 addr, u32 size,
+                                                              u32 offset, JKRAramStreamStats* stats) {
+    JKRAramStreamCommand* command = new (JKRGetSystemHeap(), -4) JKRAramStreamCommand();
+
+    command->mType = JKRAramStreamCommand::WRITE;
+    command->mAddress = addr;
+    command->mSize = size;
+    command->mStream = stream;
+    command->field_0x2c = 0;
+    command->mOffset = offset;
+    command->mTransferBuffer = transBuffer;
+    command->mHeap = transHeap;
+    command->mTransferBufferSize = transSize;
+    command->mStats = stats;
+    if (stats != NULL) {
+        stats->mBytes = 0;
+        stats->mChunks = 0;
+        stats->mBatchSize = 0;
+        stats->mQueueTime = OSGetTime();
+        stats->mStartTime = 0;
+        stats->mEndTime = 0;
+        stats->mReadTime = 0;
+        stats->mWaitTime = 0;
+    }
+
+    OSInitMessageQueue(&command->mMessageQueue, &command->mMessage, 1);
+    OSSendMessage(&sMessageQueue, command, OS_MESSAGE_BLOCK);
+    return command;
+}
+
+JKRAramStreamCommand* JKRAramStream::sync(JKRAramStreamCommand* command, BOOL isNonBlocking) {
+    OSMessage message;
+
+    if (!isNonBlocking) {
+        OSReceiveMessage(&command->mMessageQueue, &message, OS_MESSAGE_BLOCK);
+    } else if (!OSReceiveMessage(&command->mMessageQueue, &message, OS_MESSAGE_NOBLOCK)) {
+        return NULL;
+    }
+    return message != NULL ? command : NULL;
+}
+
+void JKRAramStream::setTransBuffer(u8* buffer, u32 bufferSize, JKRHeap* heap) {
+    transBuffer = NULL;
+    transSize = 0x8000;
+    transHeap = NULL;
+
+    if (buffer != NULL) {
+        transBuffer = (u8*)ALIGN_NEXT((u32)buffer, 0x20);
+    }
+    if (bufferSize != 0) {
+        transSize = ALIGN_PREV(bufferSize, 0x20);
+    }
+    if (heap != NULL && buffer == NULL) {
+        transHeap = heap;
+    }
+}
+
+void JKRAramStream::setTransBufferCount(u32 count) {
+    if (count < 1) {
+        count = 1;
+    } else if (count > JKR_ARAM_STREAM_MAX_BUFFERS) {
+        count = JKR_ARAM_STREAM_MAX_BUFFERS;
+    }
+    transCount = count;
+}
+
+void JKRAramStream::setBatchSize(u32 count) {
+    if (count < 1) {
+        count = 1;
+    } else if (count > JKR_ARAM_STREAM_MAX_BATCH) {
+        count = JKR_ARAM_STREAM_MAX_BATCH;
+    }
+    batchSize = count;
+}
+
+u32 JKRAramStream::getKBPerSecond(const JKRAramStreamStats* stats) {
+    s64 time = OSTicksToMicroseconds(stats->mEndTime - stats->mStartTime);
+
+    return time > 0 ? (u32)((s64)stats->mBytes * 1000000 / 1024 / time) : 0;
+}
+
+void JKRAramStream::printStats(const JKRAramStreamStats* stats) {
+    OSReport("JKRAramStream: %lu KB in %lu DMAs, batch of %lu: queued %lu us, took %lu us, %lu KB/s\n",
+             stats->mBytes / 1024, stats->mChunks, stats->mBatchSize,
+             (u32)OSTicksToMicroseconds(stats->mStartTime - stats->mQueueTime),
+             (u32)OSTicksToMicroseconds(stats->mEndTime - stats->mStartTime), getKBPerSecond(stats));
+    OSReport("JKRAramStream: read %lu us, waited for DMA %lu us\n", (u32)OSTicksToMicroseconds(stats->mReadTime),
+             (u32)OSTicksToMicroseconds(stats->mWaitTime));
+}
+
+JKRAramStreamCommand::JKRAramStreamCommand() { mAllocatedTransferBuffer = false; }
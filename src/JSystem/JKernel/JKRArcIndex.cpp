@@ -0,0 +1,159 @@
+#include "JSystem/JKernel/JKRArcIndex.h"
+#include <string.h>
+
+#define MIN_BUCKET_BITS 4
+
+static u32 JKRArcIndexBucketBits(u32 numFiles) {
+    u32 bits;
+
+    // no more entries than buckets, so chains stay around one long
+    for (bits = MIN_BUCKET_BITS; ((u32)1 << bits) < numFiles; bits++) {
+    }
+    return bits;
+}
+
+u32 JKRArcIndex::getWorkSize(const SArcDataInfo* info) {
+    u32 numBuckets;
+
+    if (info->num_file_entries >= JKR_ARC_INDEX_NONE || info->num_nodes >= JKR_ARC_INDEX_NONE) {
+        return 0;
+    }
+    numBuckets = 1 << JKRArcIndexBucketBits(info->num_file_entries);
+    return ALIGN_NEXT(sizeof(JKRArcIndex), 4) + info->num_nodes * sizeof(u32) +
+           ALIGN_NEXT((numBuckets * 2 + info->num_file_entries * 2 + info->num_nodes) * sizeof(u16), 4);
+}
+
+JKRArcIndex* JKRArcIndex::create(void* work, const SArcDataInfo* info, const JKRArchive::SDIDirEntry* nodes,
+                                 const JKRArchive::SDIFileEntry* files, const char* stringTable) {
+    JKRArcIndex* index = (JKRArcIndex*)work;
+    u16* links;
+    u32 numBuckets;
+    u32 bucket;
+    u32 first;
+    u32 end;
+    u32 type;
+    u32 i;
+    u32 j;
+
+    if (getWorkSize(info) == 0) {
+        return NULL;
+    }
+
+    index->mNodes = nodes;
+    index->mFiles = files;
+    index->mStringTable = stringTable;
+    index->mNumNodes = info->num_nodes;
+    index->mNumFiles = info->num_file_entries;
+    index->mBucketShift = 32 - JKRArcIndexBucketBits(index->mNumFiles);
+    numBuckets = 1 << (32 - index->mBucketShift);
+
+    index->mTypes = (u32*)((u8*)work + ALIGN_NEXT(sizeof(JKRArcIndex), 4));
+    links = (u16*)(index->mTypes + index->mNumNodes);
+    index->mDirHead = links;
+    index->mNameHead = links + numBuckets;
+    index->mDirNext = links + numBuckets * 2;
+    index->mNameNext = index->mDirNext + index->mNumFiles;
+    index->mTypeNodes = index->mNameNext + index->mNumFiles;
+
+    for (i = 0; i < numBuckets; i++) {
+        index->mDirHead[i] = JKR_ARC_INDEX_NONE;
+        index->mNameHead[i] = JKR_ARC_INDEX_NONE;
+    }
+
+    // Pushed from the back, so every chain runs in archive order
+    for (i = index->mNumFiles; i-- != 0;) {
+        bucket = index->getNameBucket(files[i].getNameHash());
+        index->mNameNext[i] = index->mNameHead[bucket];
+        index->mNameHead[bucket] = i;
+        index->mDirNext[i] = JKR_ARC_INDEX_NONE;
+    }
+    for (i = 0; i < index->mNumNodes; i++) {
+        first = nodes[i].first_file_index;
+        end = first + nodes[i].num_entries;
+        if (end > index->mNumFiles) {
+            continue;
+        }
+        for (j = end; j-- != first;) {
+            bucket = index->getDirBucket(i, files[j].getNameHash());
+            index->mDirNext[j] = index->mDirHead[bucket];
+            index->mDirHead[bucket] = j;
+        }
+    }
+
+    // Insertion sort, stable so the first directory of a type stays first. Archives have few directories.
+    for (i = 0; i < index->mNumNodes; i++) {
+        type = nodes[i].type;
+        for (j = i; j != 0 && index->mTypes[j - 1] > type; j--) {
+            index->mTypes[j] = index->mTypes[j - 1];
+            index->mTypeNodes[j] = index->mTypeNodes[j - 1];
+        }
+        index->mTypes[j] = type;
+        index->mTypeNodes[j] = i;
+    }
+    return index;
+}
+
+u32 JKRArcIndex::getDirBucket(u32 directory, u16 hash) const {
+    return ((directory << 16 | hash) * 0x9E3779B1) >> mBucketShift;
+}
+
+u32 JKRArcIndex::getNameBucket(u16 hash) const { return (hash * 0x9E3779B1) >> mBucketShift; }
+
+bool JKRArcIndex::isSameName(u32 file, const char* name, u16 hash) const {
+    if (mFiles[file].getNameHash() != hash) {
+        return false;
+    }
+    return strcmp(mStringTable + mFiles[file].getNameOffset(), name) == 0;
+}
+
+u32 JKRArcIndex::findFile(u32 directory, const char* name, u16 hash) const {
+    u32 first;
+    u32 end;
+    u32 i;
+
+    if (directory >= mNumNodes) {
+        return JKR_ARC_INDEX_NONE;
+    }
+    first = mNodes[directory].first_file_index;
+    end = first + mNodes[directory].num_entries;
+    for (i = mDirHead[getDirBucket(directory, hash)]; i != JKR_ARC_INDEX_NONE; i = mDirNext[i]) {
+        // other directories can share the bucket
+        if (i >= first && i < end && isSameName(i, name, hash)) {
+            return i;
+        }
+    }
+    return JKR_ARC_INDEX_NONE;
+}
+
+u32 JKRArcIndex::findName(const char* name, u16 hash) const {
+    u32 i;
+
+    for (i = mNameHead[getNameBucket(hash)]; i != JKR_ARC_INDEX_NONE; i = mNameNext[i]) {
+        if (isSameName(i, name, hash)) {
+            return i;
+        }
+    }
+    return JKR_ARC_INDEX_NONE;
+}
+
+u32 JKRArcIndex::findType(u32 type) const {
+    u32 low;
+    u32 high;
+    u32 middle;
+
+    // the first of the equal types
+    low = 0;
+    high = mNumNodes;
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (mTypes[middle] < type) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == mNumNodes || mTypes[low] != type) {
+        return JKR_ARC_INDEX_NONE;
+    }
+    return mTypeNodes[low];
+}
@@ -0,0 +1,320 @@
+#include "JSystem/JKernel/JKRArchive.h"
+#include "JSystem/JKernel/JKRArcIndex.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include <ctype.h>
+#include <string.h>
+
+u32 JKRArchive::sCurrentDirID;
+
+JKRArchive::JKRArchive() {
+    mIsMounted = false;
+    mMountDirection = MOUNT_DIRECTION_HEAD;
+    mIndex = NULL;
+}
+
+JKRArchive::JKRArchive(s32 entryNum, EMountMode mountMode) {
+    mIsMounted = false;
+    mMountMode = mountMode;
+    mMountCount = 1;
+    field_0x58 = 1;
+
+    mHeap = JKRHeap::findFromRoot(this);
+    if (mHeap == NULL) {
+        mHeap = JKRHeap::getCurrentHeap();
+    }
+
+    mEntryNum = entryNum;
+    mIndex = NULL;
+    if (getCurrentVolume() == NULL) {
+        setCurrentDirID(0);
+        setCurrentVolume(this);
+    }
+}
+
+JKRArchive::~JKRArchive() { destroyIndex(); }
+
+bool JKRArchive::createIndex() {
+    void* work;
+    u32 size;
+
+    if (mIndex != NULL) {
+        return true;
+    }
+
+    // Lookups fall back to the linear search, so an archive that can't spare the memory still works
+    size = JKRArcIndex::getWorkSize(mArcInfoBlock);
+    if (size == 0 || (u32)mHeap->getFreeSize() < size) {
+        return false;
+    }
+    work = JKRAllocFromHeap(mHeap, size, mMountDirection == MOUNT_DIRECTION_TAIL ? -4 : 4);
+    if (work == NULL) {
+        return false;
+    }
+
+    mIndex = JKRArcIndex::create(work, mArcInfoBlock, mNodes, mFiles, mStringTable);
+    return true;
+}
+
+void JKRArchive::destroyIndex() {
+    if (mIndex != NULL) {
+        JKRFreeToHeap(mHeap, mIndex);
+        mIndex = NULL;
+    }
+}
+
+bool JKRArchive::isSameName(CArcName& name, u32 nameOffset, u16 nameHash) const {
+    if (name.getHash() != nameHash) {
+        return false;
+    }
+    return strcmp(mStringTable + nameOffset, name.getString()) == 0;
+}
+
+JKRArchive::SDIDirEntry* JKRArchive::findResType(u32 type) const {
+    JKRArcIndex* index;
+    SDIDirEntry* node;
+    u32 count;
+    u32 i;
+
+    index = mIndex;
+    if (index != NULL) {
+        i = index->findType(type);
+        return i != JKR_ARC_INDEX_NONE ? mNodes + i : NULL;
+    }
+
+    node = mNodes;
+    for (count = 0; count < mArcInfoBlock->num_nodes; count++) {
+        if (node->type == type) {
+            return node;
+        }
+        node++;
+    }
+    return NULL;
+}
+
+JKRArchive::SDIDirEntry* JKRArchive::findDirectory(const char* name, u32 directoryId) const {
+    JKRArcIndex* index;
+    SDIDirEntry* dirEntry;
+    SDIFileEntry* fileEntry;
+    u32 i;
+
+    if (name == NULL) {
+        return mNodes + directoryId;
+    }
+
+    CArcName arcName(&name, '/');
+    index = mIndex;
+    if (index != NULL) {
+        i = index->findFile(directoryId, arcName.getString(), arcName.getHash());
+        if (i != JKR_ARC_INDEX_NONE && mFiles[i].isDirectory()) {
+            return findDirectory(name, mFiles[i].data_offset);
+        }
+        return NULL;
+    }
+
+    dirEntry = mNodes + directoryId;
+    fileEntry = mFiles + dirEntry->first_file_index;
+    for (i = 0; i < dirEntry->num_entries; fileEntry++, i++) {
+        if (isSameName(arcName, fileEntry->getNameOffset(), fileEntry->getNameHash())) {
+            if (fileEntry->isDirectory()) {
+                return findDirectory(name, fileEntry->data_offset);
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+JKRArchive::SDIFileEntry* JKRArchive::findTypeResource(u32 type, const char* name) const {
+    JKRArcIndex* index;
+    SDIDirEntry* dirEntry;
+    SDIFileEntry* fileEntry;
+    u32 i;
+
+    if (type == 0) {
+        return NULL;
+    }
+
+    CArcName arcName(name);
+    dirEntry = findResType(type);
+    if (dirEntry == NULL) {
+        return NULL;
+    }
+
+    index = mIndex;
+    if (index != NULL) {
+        i = index->findFile(dirEntry - mNodes, arcName.getString(), arcName.getHash());
+        return i != JKR_ARC_INDEX_NONE ? mFiles + i : NULL;
+    }
+
+    fileEntry = mFiles + dirEntry->first_file_index;
+    for (i = 0; i < dirEntry->num_entries; fileEntry++, i++) {
+        if (isSameName(arcName, fileEntry->getNameOffset(), fileEntry->getNameHash())) {
+            return fileEntry;
+        }
+    }
+    return NULL;
+}
+
+JKRArchive::SDIFileEntry* JKRArchive::findFsResource(const char* name, u32 directoryId) const {
+    JKRArcIndex* index;
+    SDIDirEntry* dirEntry;
+    SDIFileEntry* fileEntry;
+    u32 i;
+
+    if (name == NULL) {
+        return NULL;
+    }
+
+    CArcName arcName(&name, '/');
+    index = mIndex;
+    if (index != NULL) {
+        i = index->findFile(directoryId, arcName.getString(), arcName.getHash());
+        if (i == JKR_ARC_INDEX_NONE) {
+            return NULL;
+        }
+        fileEntry = mFiles + i;
+    } else {
+        dirEntry = mNodes + directoryId;
+        fileEntry = mFiles + dirEntry->first_file_index;
+        for (i = 0; i < dirEntry->num_entries; fileEntry++, i++) {
+            if (isSameName(arcName, fileEntry->getNameOffset(), fileEntry->getNameHash())) {
+                break;
+            }
+        }
+        if (i == dirEntry->num_entries) {
+            return NULL;
+        }
+    }
+
+    if (fileEntry->isDirectory()) {
+        return findFsResource(name, fileEntry->data_offset);
+    }
+    if (name == NULL) {
+        return fileEntry;
+    }
+    return NULL;
+}
+
+JKRArchive::SDIFileEntry* JKRArchive::findIdxResource(u32 index) const {
+    if (index < mArcInfoBlock->num_file_entries) {
+        return mFiles + index;
+    }
+    return NULL;
+}
+
+JKRArchive::SDIFileEntry* JKRArchive::findNameResource(const char* name) const {
+    JKRArcIndex* index;
+    SDIFileEntry* fileEntry;
+    u32 i;
+
+    CArcName arcName(name);
+    index = mIndex;
+    if (index != NULL) {
+        i = index->findName(arcName.getString(), arcName.getHash());
+        return i != JKR_ARC_INDEX_NONE ? mFiles + i : NULL;
+    }
+
+    fileEntry = mFiles;
+    for (i = 0; i < mArcInfoBlock->num_file_entries; fileEntry++, i++) {
+        if (isSameName(arcName, fileEntry->getNameOffset(), fileEntry->getNameHash())) {
+            return fileEntry;
+        }
+    }
+    return NULL;
+}
+
+JKRArchive::SDIFileEntry* JKRArchive::findPtrResource(const void* resource) const {
+    SDIFileEntry* fileEntry;
+    u32 i;
+
+    fileEntry = mFiles;
+    for (i = 0; i < mArcInfoBlock->num_file_entries; fileEntry++, i++) {
+        if (fileEntry->data == resource) {
+            return fileEntry;
+        }
+    }
+    return NULL;
+}
+
+JKRArchive::SDIFileEntry* JKRArchive::findIdResource(u16 id) const {
+    SDIFileEntry* fileEntry;
+    u32 i;
+
+    if (id == 0xFFFF) {
+        return NULL;
+    }
+
+    if (id < mArcInfoBlock->num_file_entries) {
+        fileEntry = mFiles + id;
+        if (fileEntry->getFileID() == id && fileEntry->isUnknownFlag1()) {
+            return fileEntry;
+        }
+    }
+
+    fileEntry = mFiles;
+    for (i = 0; i < mArcInfoBlock->num_file_entries; fileEntry++, i++) {
+        if (fileEntry->getFileID() == id && fileEntry->isUnknownFlag1()) {
+            return fileEntry;
+        }
+    }
+    return NULL;
+}
+
+void JKRArchive::CArcName::store(const char* data) {
+    s32 length;
+    s32 ch;
+
+    mHash = 0;
+    length = 0;
+    while (*data != '\0') {
+        ch = tolower(*data);
+        mHash = ch + mHash * 3;
+        if (length < ARRAY_COUNT(mData) - 1) {
+            mData[length++] = ch;
+        }
+        data++;
+    }
+    mLength = length;
+    mData[length] = '\0';
+}
+
+const char* JKRArchive::CArcName::store(const char* data, char endChar) {
+    s32 length;
+    s32 ch;
+
+    mHash = 0;
+    length = 0;
+    while (*data != '\0' && *data != endChar) {
+        ch = tolower(*data);
+        mHash = ch + mHash * 3;
+        if (length < ARRAY_COUNT(mData) - 1) {
+            mData[length++] = ch;
+        }
+        data++;
+    }
+    mLength = length;
+    mData[length] = '\0';
+
+    if (*data == '\0') {
+        return NULL;
+    }
+    return data + 1;
+}
+
+void JKRArchive::setExpandSize(SDIFileEntry* fileEntry, u32 expandSize) {
+    u32 index = fileEntry - mFiles;
+
+    if (mExpandedSize == NULL || index >= mArcInfoBlock->num_file_entries) {
+        return;
+    }
+    mExpandedSize[index] = expandSize;
+}
+
+u32 JKRArchive::getExpandSize(SDIFileEntry* fileEntry) const {
+    u32 index = fileEntry - mFiles;
+
+    if (mExpandedSize == NULL || index >= mArcInfoBlock->num_file_entries) {
+        return 0;
+    }
+    return mExpandedSize[index];
+}
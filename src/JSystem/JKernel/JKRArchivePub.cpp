@@ -0,0 +1,75 @@
+#include "JSystem/JKernel/JKRArchive.h"
+#include "JSystem/JKernel/JKRAramArchive.h"
+#include "JSystem/JKernel/JKRCompArchive.h"
+#include "JSystem/JKernel/JKRDvdArchive.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "JSystem/JKernel/JKRMemArchive.h"
+#include "dolphin/dvd.h"
+
+JKRArchive* JKRArchive::check_mount_already(s32 entryNum) {
+    JSUList<JKRFileLoader>& volumeList = getVolumeList();
+    JSUListIterator<JKRFileLoader> iterator;
+    JKRArchive* archive;
+
+    for (iterator = volumeList.getFirst(); iterator != volumeList.getEnd(); ++iterator) {
+        if (iterator.getObject()->getVolumeType() == 'RARC') {
+            archive = (JKRArchive*)iterator.getObject();
+            if (archive->mEntryNum == entryNum) {
+                archive->mMountCount++;
+                return archive;
+            }
+        }
+    }
+    return NULL;
+}
+
+JKRArchive* JKRArchive::mount(const char* path, EMountMode mountMode, JKRHeap* heap,
+                              EMountDirection mountDirection) {
+    s32 entryNum;
+
+    entryNum = DVDConvertPathToEntrynum(path);
+    if (entryNum < 0) {
+        return NULL;
+    }
+    return mount(entryNum, mountMode, heap, mountDirection);
+}
+
+JKRArchive* JKRArchive::mount(s32 entryNum, EMountMode mountMode, JKRHeap* heap, EMountDirection mountDirection) {
+    JKRArchive* archive;
+    int alignment;
+
+    archive = check_mount_already(entryNum);
+    if (archive != NULL) {
+        return archive;
+    }
+
+    alignment = mountDirection == MOUNT_DIRECTION_HEAD ? 4 : -4;
+    archive = NULL;
+    switch (mountMode) {
+    case MOUNT_MEM:
+        archive = new (heap, alignment) JKRMemArchive(entryNum, mountDirection);
+        break;
+    case MOUNT_ARAM:
+        archive = new (heap, alignment) JKRAramArchive(entryNum, mountDirection);
+        break;
+    case MOUNT_DVD:
+        archive = new (heap, alignment) JKRDvdArchive(entryNum, mountDirection);
+        break;
+    case MOUNT_COMP:
+        archive = new (heap, alignment) JKRCompArchive(entryNum, mountDirection);
+        break;
+    }
+
+    if (archive == NULL) {
+        return NULL;
+    }
+    if (archive->getMountMode() == UNKNOWN_MOUNT_MODE) {
+        delete archive;
+        return NULL;
+    }
+
+    // The directory and file tables don't change after this, so the index is built once per mount, next to the
+    // archive in heap
+    archive->createIndex();
+    return archive;
+}
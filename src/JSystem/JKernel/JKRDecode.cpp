@@ -0,0 +1,274 @@
+#include "JSystem/JKernel/JKRDecode.h"
+#include "string.h"
+
+static inline u32 JKRDecodeRead32(const u8* data) {
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | data[3];
+}
+
+static inline void JKRDecodeCopyWord(u8* dst, const u8* src) {
+#ifdef __MWERKS__
+    // Gekko handles misaligned integer loads and stores to cached memory in hardware
+    *(u32*)dst = *(const u32*)src;
+#else
+    memcpy(dst, src, 4);
+#endif
+}
+
+// Copies count bytes from distance bytes back. Closer than a word, the bytes repeat every distance, so they also
+// repeat every 4 (distance 1 or 2) or 6 (distance 3): those first bytes go one at a time and the rest are word
+// copies from that far back. Writes up to 3 bytes past the match.
+static inline u8* JKRDecodeMatch(u8* dst, u32 distance, u32 count) {
+    u8* end;
+    u32 widened;
+    u32 i;
+
+    end = dst + count;
+    if (distance < 4) {
+        widened = distance == 3 ? 6 : 4;
+        for (i = 0; i < widened; i++) {
+            dst[i] = dst[(s32)i - (s32)distance];
+        }
+        dst += widened;
+        distance = widened;
+    }
+
+    for (; dst < end; dst += 4) {
+        JKRDecodeCopyWord(dst, dst - distance);
+    }
+    return end;
+}
+
+// Decodes up to numGroups whole flag groups while even eight of the longest matches can't reach end
+u8* JKRDecodeSZSGroups(const u8** src, u8* dst, u8* end, u32 numGroups) {
+    const u8* in;
+    u32 flags;
+    u32 bit;
+    u32 code;
+    u32 distance;
+    u32 count;
+
+    in = *src;
+    for (; numGroups != 0 && end - dst >= 8 * JKR_SZ_MAX_MATCH + JKR_DECODE_SLACK; numGroups--) {
+        flags = *in++;
+        if (flags == 0xFF) {
+            JKRDecodeCopyWord(dst, in);
+            JKRDecodeCopyWord(dst + 4, in + 4);
+            dst += 8;
+            in += 8;
+            continue;
+        }
+
+        for (bit = 0x80; bit != 0; bit >>= 1) {
+            if (flags & bit) {
+                *dst++ = *in++;
+            } else {
+                code = in[0];
+                distance = (((code & 0xF) << 8) | in[1]) + 1;
+                in += 2;
+                count = (code >> 4) != 0 ? (code >> 4) + 2 : *in++ + 0x12;
+                dst = JKRDecodeMatch(dst, distance, count);
+            }
+        }
+    }
+
+    *src = in;
+    return dst;
+}
+
+// Decodes one flag group a byte at a time, stopping at end
+u8* JKRDecodeSZSGroup(const u8** src, u8* dst, u8* end) {
+    const u8* in;
+    u8* from;
+    u32 flags;
+    u32 code;
+    u32 count;
+    s32 i;
+
+    in = *src;
+    flags = *in++;
+    for (i = 0; i < 8 && dst != end; i++, flags <<= 1) {
+        if (flags & 0x80) {
+            *dst++ = *in++;
+            continue;
+        }
+
+        code = in[0];
+        from = dst - ((((code & 0xF) << 8) | in[1]) + 1);
+        in += 2;
+        count = (code >> 4) != 0 ? (code >> 4) + 2 : *in++ + 0x12;
+        if (count > (u32)(end - dst)) {
+            count = end - dst;
+        }
+        for (; count != 0; count--) {
+            *dst++ = *from++;
+        }
+    }
+
+    *src = in;
+    return dst;
+}
+
+void JKRDecodeSZS(u8* src, u8* dst, u32 size, u32 offset) {
+    const u8* in;
+    u8* start;
+    u8* end;
+    u8* from;
+    u32 expandSize;
+    u32 flags;
+    u32 code;
+    u32 count;
+    s32 bitsLeft;
+
+    expandSize = JKRDecodeRead32(src + 4);
+    if (size == 0 || offset >= expandSize) {
+        return;
+    }
+
+    start = dst;
+    end = dst + (size < expandSize - offset ? size : expandSize - offset);
+    in = src + JKR_SZS_HEADER_SIZE;
+    if (offset == 0) {
+        dst = JKRDecodeSZSGroups(&in, dst, end, 0xFFFFFFFF);
+        while (dst != end) {
+            dst = JKRDecodeSZSGroup(&in, dst, end);
+        }
+        return;
+    }
+
+    // One byte at a time, skipping the first offset bytes
+    bitsLeft = 0;
+    flags = 0;
+    while (dst != end) {
+        if (bitsLeft == 0) {
+            flags = *in++;
+            bitsLeft = 8;
+        }
+
+        if (flags & 0x80) {
+            if (offset == 0) {
+                *dst++ = *in;
+            } else {
+                offset--;
+            }
+            in++;
+        } else {
+            code = in[0];
+            from = dst - ((((code & 0xF) << 8) | in[1]) + 1);
+            in += 2;
+            count = (code >> 4) != 0 ? (code >> 4) + 2 : *in++ + 0x12;
+            if (count > expandSize - (dst - start)) {
+                count = expandSize - (dst - start);
+            }
+
+            for (; count != 0; count--) {
+                if (offset == 0) {
+                    *dst++ = *from;
+                    if (dst == end) {
+                        return;
+                    }
+                } else {
+                    offset--;
+                }
+                from++;
+            }
+        }
+
+        flags <<= 1;
+        bitsLeft--;
+    }
+}
+
+void JKRDecodeSZP(u8* src, u8* dst, u32 size, u32 offset) {
+    u8* start;
+    u8* end;
+    u8* from;
+    const u8* in;
+    const u8* link;
+    const u8* chunk;
+    u32 expandSize;
+    u32 flags;
+    u32 bit;
+    u32 code;
+    u32 count;
+    s32 bitsLeft;
+    s32 i;
+
+    expandSize = JKRDecodeRead32(src + 4);
+    if (size == 0 || offset >= expandSize) {
+        return;
+    }
+
+    start = dst;
+    end = dst + (size < expandSize - offset ? size : expandSize - offset);
+    in = src + JKR_SZP_HEADER_SIZE;
+    link = src + JKRDecodeRead32(src + 8);
+    chunk = src + JKRDecodeRead32(src + 12);
+
+    // Whole 32-bit groups while they can't reach the end
+    while (offset == 0 && end - dst >= 32 * JKR_SZ_MAX_MATCH + JKR_DECODE_SLACK) {
+        flags = JKRDecodeRead32(in);
+        in += 4;
+        if (flags == 0xFFFFFFFF) {
+            for (i = 0; i < 32; i += 4) {
+                JKRDecodeCopyWord(dst + i, chunk + i);
+            }
+            dst += 32;
+            chunk += 32;
+            continue;
+        }
+
+        for (bit = 0x80000000; bit != 0; bit >>= 1) {
+            if (flags & bit) {
+                *dst++ = *chunk++;
+            } else {
+                code = (link[0] << 8) | link[1];
+                link += 2;
+                count = (code >> 12) != 0 ? (code >> 12) + 2 : *chunk++ + 0x12;
+                dst = JKRDecodeMatch(dst, (code & 0xFFF) + 1, count);
+            }
+        }
+    }
+
+    // One byte at a time for the rest, skipping the first offset bytes
+    bitsLeft = 0;
+    flags = 0;
+    while (dst != end) {
+        if (bitsLeft == 0) {
+            flags = JKRDecodeRead32(in);
+            in += 4;
+            bitsLeft = 32;
+        }
+
+        if (flags & 0x80000000) {
+            if (offset == 0) {
+                *dst++ = *chunk;
+            } else {
+                offset--;
+            }
+            chunk++;
+        } else {
+            code = (link[0] << 8) | link[1];
+            link += 2;
+            from = dst - ((code & 0xFFF) + 1);
+            count = (code >> 12) != 0 ? (code >> 12) + 2 : *chunk++ + 0x12;
+            if (count > expandSize - (dst - start)) {
+                count = expandSize - (dst - start);
+            }
+
+            for (; count != 0; count--) {
+                if (offset == 0) {
+                    *dst++ = *from;
+                    if (dst == end) {
+                        return;
+                    }
+                } else {
+                    offset--;
+                }
+                from++;
+            }
+        }
+
+        flags <<= 1;
+        bitsLeft--;
+    }
+}
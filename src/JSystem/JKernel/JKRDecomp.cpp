@@ -0,0 +1,134 @@
+#include "JSystem/JKernel/JKRDecomp.h"
+#include "JSystem/JKernel/JKRAramPiece.h"
+#include "JSystem/JKernel/JKRDecode.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "macros.h"
+
+JKRDecomp* JKRDecomp::sDecompObject;
+OSMessage JKRDecomp::sMessageBuffer[4];
+OSMessageQueue JKRDecomp::sMessageQueue;
+
+JKRDecomp* JKRDecomp::create(s32 priority) {
+    if (sDecompObject == NULL) {
+        sDecompObject = new (JKRGetSystemHeap(), 0) JKRDecomp(priority);
+    }
+    return sDecompObject;
+}
+
+JKRDecomp::JKRDecomp(s32 priority) : JKRThread(0x800, 0x10, priority) { resume(); }
+
+JKRDecomp::~JKRDecomp() {}
+
+void* JKRDecomp::run() {
+    OSMessage message;
+    JKRDecompCommand* command;
+
+    OSInitMessageQueue(&sMessageQueue, sMessageBuffer, ARRAY_COUNT(sMessageBuffer));
+    while (true) {
+        OSReceiveMessage(&sMessageQueue, &message, OS_MESSAGE_BLOCK);
+        command = (JKRDecompCommand*)message;
+        decode(command->mSrcBuffer, command->mDstBuffer, command->mSrcLength, command->mDstLength);
+
+        if (command->field_0x20 != 0) {
+            if (command->field_0x20 == 1) {
+                JKRAramPiece::sendCommand(command->mAMCommand);
+            }
+            continue;
+        }
+
+        if (command->mCallback != NULL) {
+            command->mCallback((u32)command);
+        } else if (command->field_0x1c != NULL) {
+            OSSendMessage(command->field_0x1c, (OSMessage)1, OS_MESSAGE_NOBLOCK);
+        } else {
+            OSSendMessage(&command->mMessageQueue, (OSMessage)1, OS_MESSAGE_NOBLOCK);
+        }
+    }
+}
+
+JKRDecompCommand* JKRDecomp::prepareCommand(u8* srcBuffer, u8* dstBuffer, u32 srcLength, u32 dstLength,
+                                             JKRDecompCommand::AsyncCallback callback) {
+    JKRDecompCommand* command;
+
+    command = new (JKRGetSystemHeap(), -4) JKRDecompCommand();
+    command->mSrcBuffer = srcBuffer;
+    command->mDstBuffer = dstBuffer;
+    command->mSrcLength = srcLength;
+    command->mDstLength = dstLength;
+    command->mCallback = callback;
+    return command;
+}
+
+void JKRDecomp::sendCommand(JKRDecompCommand* command) {
+    OSSendMessage(&sMessageQueue, (OSMessage)command, OS_MESSAGE_NOBLOCK);
+}
+
+JKRDecompCommand* JKRDecomp::orderAsync(u8* srcBuffer, u8* dstBuffer, u32 srcLength, u32 dstLength,
+                                        JKRDecompCommand::AsyncCallback callback) {
+    JKRDecompCommand* command;
+
+    command = prepareCommand(srcBuffer, dstBuffer, srcLength, dstLength, callback);
+    sendCommand(command);
+    return command;
+}
+
+bool JKRDecomp::sync(JKRDecompCommand* command, int isNonBlocking) {
+    OSMessage message;
+
+    if (isNonBlocking == JKRDECOMP_SYNC_BLOCKING) {
+        OSReceiveMessage(&command->mMessageQueue, &message, OS_MESSAGE_BLOCK);
+        return true;
+    }
+    return OSReceiveMessage(&command->mMessageQueue, &message, OS_MESSAGE_NOBLOCK) != 0;
+}
+
+bool JKRDecomp::orderSync(u8* srcBuffer, u8* dstBuffer, u32 srcLength, u32 dstLength) {
+    JKRDecompCommand* command;
+    bool result;
+
+    command = orderAsync(srcBuffer, dstBuffer, srcLength, dstLength, NULL);
+    result = sync(command, JKRDECOMP_SYNC_BLOCKING);
+    delete command;
+    return result;
+}
+
+// srcLength is how many decoded bytes to write and dstLength how many to skip first
+void JKRDecomp::decode(u8* srcBuffer, u8* dstBuffer, u32 srcLength, u32 dstLength) {
+    JKRCompression compression;
+
+    compression = checkCompressed(srcBuffer);
+    if (compression == COMPRESSION_YAY0) {
+        decodeSZP(srcBuffer, dstBuffer, srcLength, dstLength);
+    } else if (compression == COMPRESSION_YAZ0) {
+        decodeSZS(srcBuffer, dstBuffer, srcLength, dstLength);
+    }
+}
+
+void JKRDecomp::decodeSZP(u8* src, u8* dst, u32 size, u32 offset) { JKRDecodeSZP(src, dst, size, offset); }
+
+void JKRDecomp::decodeSZS(u8* src, u8* dst, u32 size, u32 offset) { JKRDecodeSZS(src, dst, size, offset); }
+
+JKRCompression JKRDecomp::checkCompressed(u8* buffer) {
+    if (buffer[0] == 'Y' && buffer[1] == 'a' && buffer[3] == '0') {
+        if (buffer[2] == 'y') {
+            return COMPRESSION_YAY0;
+        }
+        if (buffer[2] == 'z') {
+            return COMPRESSION_YAZ0;
+        }
+    }
+    if (buffer[0] == 'A' && buffer[1] == 'S' && buffer[2] == 'R') {
+        return COMPRESSION_ASR;
+    }
+    return COMPRESSION_NONE;
+}
+
+JKRDecompCommand::JKRDecompCommand() {
+    OSInitMessageQueue(&mMessageQueue, &mMessage, 1);
+    mCallback = NULL;
+    field_0x1c = NULL;
+    mThis = this;
+    field_0x20 = 0;
+}
+
+JKRDecompCommand::~JKRDecompCommand() {}
@@ -0,0 +1,228 @@
+#include "JSystem/JKernel/JKRDvdDecode.h"
+#include "JSystem/JKernel/JKRDecode.h"
+#include "JSystem/JKernel/JKRDvdRipper.h"
+#include "dolphin/vi.h"
+#include "string.h"
+
+// Each decode has its own, with a copy of the caller's file first so the read callback can get back to it
+typedef struct JKRDvdDecoder {
+    DVDFileInfo fileInfo;
+    u8* chunks[2];
+    u32 lengths[2];
+    u32 chunkSize;
+    u32 readPos;
+    s32 readChunk; // chunk being read, from readStart
+    u32 readStart;
+    s32 current; // chunk being decoded
+    BOOL pending; // the other chunk has been or is being read and isn't decoded yet
+    volatile BOOL reading;
+    volatile BOOL failed;
+    OSThreadQueue queue;
+    JKRDvdDecodeStats stats;
+} JKRDvdDecoder;
+
+static void JKRDvdDecodeCallback(s32 result, DVDFileInfo* fileInfo) {
+    JKRDvdDecoder* decoder = (JKRDvdDecoder*)fileInfo;
+
+    if (result < 0) {
+        decoder->failed = true;
+    }
+    decoder->reading = false;
+    OSWakeupThread(&decoder->queue);
+}
+
+static void JKRDvdDecodeIssueRead(JKRDvdDecoder* decoder) {
+    u32 length;
+
+    length = decoder->lengths[decoder->readChunk];
+    decoder->failed = false;
+    decoder->reading = true;
+    decoder->stats.numReads++;
+    decoder->stats.bytesRead += length;
+    DCInvalidateRange(decoder->chunks[decoder->readChunk], OSRoundUp32B(length));
+
+    // DVD transfers are whole 32-byte blocks; reading up to the next one past the end of the file is allowed
+    if (!DVDReadAsyncPrio(&decoder->fileInfo, decoder->chunks[decoder->readChunk], OSRoundUp32B(length),
+                          decoder->readStart, JKRDvdDecodeCallback, 2)) {
+        decoder->reading = false;
+        decoder->failed = true;
+    }
+}
+
+// Starts reading the next chunk of the file into chunk
+static void JKRDvdDecodeStartRead(JKRDvdDecoder* decoder, s32 chunk) {
+    u32 length;
+
+    length = decoder->fileInfo.length - decoder->readPos;
+    if (length > decoder->chunkSize) {
+        length = decoder->chunkSize;
+    }
+
+    decoder->lengths[chunk] = length;
+    decoder->readChunk = chunk;
+    decoder->readStart = decoder->readPos;
+    decoder->pending = true;
+    JKRDvdDecodeIssueRead(decoder);
+    decoder->readPos += length;
+}
+
+// Waits for the read in flight; a failed one is read again as long as JKRDvdRipper::errorRetry is set, the way
+// JKRDvdRipper's own reads are
+static BOOL JKRDvdDecodeWait(JKRDvdDecoder* decoder) {
+    OSTime start;
+    BOOL enabled;
+
+    start = OSGetTime();
+    while (true) {
+        enabled = OSDisableInterrupts();
+        while (decoder->reading) {
+            OSSleepThread(&decoder->queue);
+        }
+        OSRestoreInterrupts(enabled);
+        if (!decoder->failed || !JKRDvdRipper::isErrorRetry()) {
+            break;
+        }
+        VIWaitForRetrace();
+        JKRDvdDecodeIssueRead(decoder);
+    }
+    decoder->stats.waitTime += OSGetTime() - start;
+    return !decoder->failed;
+}
+
+// Once fewer than a group's worth of bytes are left in the current chunk, moves them in front of the next one, which
+// has been read meanwhile, and starts reading the one after into the chunk just finished
+static BOOL JKRDvdDecodeRefill(JKRDvdDecoder* decoder, const u8** in, const u8** inEnd) {
+    u32 left;
+    s32 next;
+
+    left = *inEnd - *in;
+    if (left >= JKR_SZS_MAX_GROUP_SIZE || !decoder->pending) {
+        return true;
+    }
+    if (!JKRDvdDecodeWait(decoder)) {
+        return false;
+    }
+
+    next = decoder->current ^ 1;
+    memcpy(decoder->chunks[next] - left, *in, left);
+    *in = decoder->chunks[next] - left;
+    *inEnd = decoder->chunks[next] + decoder->lengths[next];
+    decoder->current = next;
+    decoder->pending = false;
+    if (decoder->readPos < decoder->fileInfo.length) {
+        JKRDvdDecodeStartRead(decoder, next ^ 1);
+    }
+    return true;
+}
+
+u32 JKRDvdDecodeSZS(DVDFileInfo* fileInfo, u8* dst, u32 size, u32 offset, u8* work, u32 workSize,
+                    JKRDvdDecodeStats* stats) {
+    JKRDvdDecoder decoder;
+    const u8* in;
+    const u8* inEnd;
+    u8* window;
+    u32 windowSize;
+    u8* start;
+    u8* end;
+    u8* next;
+    u32 expandSize;
+    u32 flags;
+    u32 code;
+    u32 distance;
+    u32 count;
+    u32 pos;
+    u32 numGroups;
+    u8 value;
+    s32 i;
+    BOOL ok;
+
+    memset(&decoder, 0, sizeof(JKRDvdDecoder));
+    decoder.stats.totalTime = OSGetTime();
+    if (workSize < JKR_DVD_DECODE_MIN_WORK) {
+        return 0;
+    }
+
+    window = work;
+    windowSize = offset != 0 ? JKR_DVD_DECODE_WINDOW : 0;
+    decoder.fileInfo = *fileInfo;
+    decoder.chunkSize = ((workSize - windowSize) / 2 - JKR_DVD_DECODE_LEAD) & ~0x1F;
+    decoder.chunks[0] = work + windowSize + JKR_DVD_DECODE_LEAD;
+    decoder.chunks[1] = decoder.chunks[0] + decoder.chunkSize + JKR_DVD_DECODE_LEAD;
+    OSInitThreadQueue(&decoder.queue);
+
+    start = dst;
+    ok = false;
+    JKRDvdDecodeStartRead(&decoder, 0);
+    if (!JKRDvdDecodeWait(&decoder) || decoder.lengths[0] < JKR_SZS_HEADER_SIZE) {
+        goto done;
+    }
+
+    in = decoder.chunks[0];
+    inEnd = in + decoder.lengths[0];
+    expandSize = ((u32)in[4] << 24) | ((u32)in[5] << 16) | ((u32)in[6] << 8) | in[7];
+    if (in[0] != 'Y' || in[1] != 'a' || in[2] != 'z' || in[3] != '0' || size == 0 || offset >= expandSize) {
+        goto done;
+    }
+
+    decoder.pending = false;
+    if (decoder.readPos < fileInfo->length) {
+        JKRDvdDecodeStartRead(&decoder, 1);
+    }
+    in += JKR_SZS_HEADER_SIZE;
+    end = dst + (size < expandSize - offset ? size : expandSize - offset);
+
+    // Through the window while skipping, and until dst has a window of its own behind it
+    pos = 0;
+    while (offset != 0 && pos < offset + JKR_DVD_DECODE_WINDOW && dst != end) {
+        if (!JKRDvdDecodeRefill(&decoder, &in, &inEnd) || in == inEnd) {
+            goto done;
+        }
+
+        flags = *in++;
+        for (i = 0; i < 8 && dst != end; i++, flags <<= 1) {
+            if (flags & 0x80) {
+                distance = 0;
+                count = 1;
+            } else {
+                code = in[0];
+                distance = (((code & 0xF) << 8) | in[1]) + 1;
+                in += 2;
+                count = (code >> 4) != 0 ? (code >> 4) + 2 : *in++ + 0x12;
+            }
+
+            for (; count != 0 && dst != end; count--, pos++) {
+                value = distance == 0 ? *in++ : window[(pos - distance) & (JKR_DVD_DECODE_WINDOW - 1)];
+                window[pos & (JKR_DVD_DECODE_WINDOW - 1)] = value;
+                if (pos >= offset) {
+                    *dst++ = value;
+                }
+            }
+        }
+    }
+
+    // Straight into dst; whole groups at a time while the chunk can't run out in the middle of one
+    while (dst != end) {
+        if (!JKRDvdDecodeRefill(&decoder, &in, &inEnd) || in == inEnd) {
+            goto done;
+        }
+
+        numGroups = decoder.pending ? (inEnd - in) / JKR_SZS_MAX_GROUP_SIZE : 0xFFFFFFFF;
+        next = JKRDecodeSZSGroups(&in, dst, end, numGroups);
+        if (next == dst) {
+            next = JKRDecodeSZSGroup(&in, dst, end);
+        }
+        dst = next;
+    }
+    ok = true;
+
+done:
+    // the drive may still be reading past what was needed
+    if (!JKRDvdDecodeWait(&decoder)) {
+        ok = false;
+    }
+    decoder.stats.totalTime = OSGetTime() - decoder.stats.totalTime;
+    if (stats != NULL) {
+        *stats = decoder.stats;
+    }
+    return ok ? dst - start : 0;
+}
@@ -0,0 +1,183 @@
+#include "JSystem/JKernel/JKRDvdRipper.h"
+#include "JSystem/JKernel/JKRDecomp.h"
+#include "JSystem/JKernel/JKRDvdDecode.h"
+#include "JSystem/JKernel/JKRDvdFile.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "dolphin/os.h"
+#include "dolphin/vi.h"
+#include <string.h>
+
+JSUList<JKRDMCommand> JKRDvdRipper::sDvdAsyncList;
+// big enough that streamed Yaz0 loads aren't dominated by the cost of each DVD command
+u32 JKRDvdRipper::sSzpBufferSize = 0x10000;
+bool JKRDvdRipper::sStreamSzs = true;
+bool JKRDvdRipper::errorRetry = true;
+
+void* JKRDvdRipper::loadToMainRAM(const char* name, u8* dst, JKRExpandSwitch expandSwitch, u32 dstLength,
+                                  JKRHeap* heap, EAllocDirection allocDirection, u32 offset, int* returnSize) {
+    JKRDvdFile file;
+
+    if (!file.open(name)) {
+        return NULL;
+    }
+    return loadToMainRAM(&file, dst, expandSwitch, dstLength, heap, allocDirection, offset, returnSize);
+}
+
+void* JKRDvdRipper::loadToMainRAM(s32 entryNum, u8* dst, JKRExpandSwitch expandSwitch, u32 dstLength,
+                                  JKRHeap* heap, EAllocDirection allocDirection, u32 offset, int* returnSize) {
+    JKRDvdFile file;
+
+    if (!file.open(entryNum)) {
+        return NULL;
+    }
+    return loadToMainRAM(&file, dst, expandSwitch, dstLength, heap, allocDirection, offset, returnSize);
+}
+
+static bool JKRDvdRipperRead(JKRDvdFile* file, void* dst, u32 length, u32 position) {
+    s32 result;
+
+    DCInvalidateRange(dst, length);
+    while (true) {
+        result = DVDReadPrio(file->getFileInfo(), dst, length, position, 2);
+        if (result >= 0) {
+            return true;
+        }
+        if (!JKRDvdRipper::isErrorRetry()) {
+            return false;
+        }
+        VIWaitForRetrace();
+    }
+}
+
+// The two-pass load: the whole compressed file goes into a buffer from the tail of heap, then gets decoded
+static u32 JKRDvdRipperDecompress(JKRDvdFile* file, u8* dst, u32 size, u32 offset, JKRHeap* heap) {
+    u8* compressed;
+    u32 fileSize;
+
+    fileSize = OSRoundUp32B(file->getFileSize());
+    compressed = (u8*)JKRAllocFromHeap(heap, fileSize, -32);
+    if (compressed == NULL) {
+        return 0;
+    }
+
+    if (!JKRDvdRipperRead(file, compressed, fileSize, 0)) {
+        JKRFreeToHeap(heap, compressed);
+        return 0;
+    }
+    JKRDecompress(compressed, dst, size, offset);
+    JKRFreeToHeap(heap, compressed);
+    return size;
+}
+
+// Yaz0 files with sStreamSzs set are decoded while they're read, in sSzpBufferSize bytes of the system heap
+static u32 JKRDvdRipperStream(JKRDvdFile* file, u8* dst, u32 size, u32 offset) {
+    u8* work;
+    u32 result;
+
+    work = (u8*)JKRAllocFromSysHeap(JKRDvdRipper::getSzpBufferSize(), -32);
+    if (work == NULL) {
+        return 0;
+    }
+
+    result = JKRDvdDecodeSZS(file->getFileInfo(), dst, size, offset, work, JKRDvdRipper::getSzpBufferSize(), NULL);
+
+    JKRFreeToSysHeap(work);
+    return result;
+}
+
+// DVD reads start on a word, so an uncompressed load from anywhere else reads from the word before into a buffer from
+// the tail of heap and copies the part that was asked for
+static u32 JKRDvdRipperReadUnaligned(JKRDvdFile* file, u8* dst, u32 size, u32 offset, JKRHeap* heap) {
+    u8* bounce;
+    u32 skip;
+
+    skip = offset & 3;
+    bounce = (u8*)JKRAllocFromHeap(heap, OSRoundUp32B(skip + size), -32);
+    if (bounce == NULL) {
+        return 0;
+    }
+
+    if (!JKRDvdRipperRead(file, bounce, OSRoundUp32B(skip + size), offset - skip)) {
+        JKRFreeToHeap(heap, bounce);
+        return 0;
+    }
+    memcpy(dst, bounce + skip, size);
+    JKRFreeToHeap(heap, bounce);
+    return size;
+}
+
+// EXPAND_SWITCH_UNKNOWN1 decompresses Yaz0 and Yay0 files, anything else is loaded as it is. offset skips that
+// many bytes of the (decompressed) file; dstLength, if not 0, limits how much is loaded. dst NULL allocates the
+// destination from heap, at its head or tail per allocDirection.
+void* JKRDvdRipper::loadToMainRAM(JKRDvdFile* file, u8* dst, JKRExpandSwitch expandSwitch, u32 dstLength,
+                                  JKRHeap* heap, EAllocDirection allocDirection, u32 offset, int* returnSize) {
+    u8 buffer[0x40];
+    u8* header;
+    JKRCompression compression;
+    u32 expandSize;
+    u32 size;
+    u32 loaded;
+    bool allocated;
+
+    if (returnSize != NULL) {
+        *returnSize = 0;
+    }
+    if (heap == NULL) {
+        heap = JKRGetCurrentHeap();
+    }
+
+    compression = COMPRESSION_NONE;
+    expandSize = file->getFileSize();
+    if (expandSwitch == EXPAND_SWITCH_UNKNOWN1) {
+        header = (u8*)OSRoundUp32B(buffer);
+        if (!JKRDvdRipperRead(file, header, 0x20, 0)) {
+            return NULL;
+        }
+        compression = JKRCheckCompressed(header);
+        if (compression == COMPRESSION_YAY0 || compression == COMPRESSION_YAZ0) {
+            expandSize = JKRDecompExpandSize(header);
+        } else {
+            compression = COMPRESSION_NONE;
+        }
+    }
+
+    if (offset >= expandSize) {
+        return NULL;
+    }
+    size = expandSize - offset;
+    if (dstLength != 0 && dstLength < size) {
+        size = dstLength;
+    }
+
+    allocated = false;
+    if (dst == NULL) {
+        dst = (u8*)JKRAllocFromHeap(heap, OSRoundUp32B(size),
+                                    allocDirection == ALLOC_DIRECTION_BACKWARD ? -32 : 32);
+        if (dst == NULL) {
+            return NULL;
+        }
+        allocated = true;
+    }
+
+    if (compression == COMPRESSION_NONE && (offset & 3) != 0) {
+        loaded = JKRDvdRipperReadUnaligned(file, dst, size, offset, heap);
+    } else if (compression == COMPRESSION_NONE) {
+        // DVD reads are whole 32-byte blocks
+        loaded = JKRDvdRipperRead(file, dst, OSRoundUp32B(size), offset) ? size : 0;
+    } else if (compression == COMPRESSION_YAZ0 && sStreamSzs) {
+        loaded = JKRDvdRipperStream(file, dst, size, offset);
+    } else {
+        loaded = JKRDvdRipperDecompress(file, dst, size, offset, heap);
+    }
+
+    if (loaded == 0) {
+        if (allocated) {
+            JKRFreeToHeap(heap, dst);
+        }
+        return NULL;
+    }
+    if (returnSize != NULL) {
+        *returnSize = loaded;
+    }
+    return dst;
+}
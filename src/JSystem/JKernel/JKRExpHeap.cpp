@@ -0,0 +1,1233 @@
+#include "JSystem/JKernel/JKRExpHeap.h"
+#include "JSystem/JKernel/JKRHeapProfiler.h"
+#include "dolphin/os.h"
+#include "macros.h"
+#include <string.h>
+
+// A heap of at least JKR_EXP_HEAP_BINS_MIN_SIZE bytes made after setDefaultFreeBins(true) keeps a CFreeBins at its
+// start, ahead of the first block, and has JKR_EXP_HEAP_BINS_SIZE (0x430) bytes less to give out. The free list
+// itself stays what it always was, every free block in address order, so tail allocation, first fit, check and the
+// dumps don't change. The bins are a second view of it:
+//
+//   each free block with room for a JKRExpFreeLink is also on the list of its size class, linked through its own
+//   (unused) contents, and a bitmap says which classes have any, so the best fit in ALLOC_MODE_0 is found by looking
+//   at the blocks of the first class with one that fits instead of at every free block
+//
+//   the heap is cut into JKR_EXP_HEAP_REGION_COUNT equal regions and each remembers its lowest free block, so the
+//   free blocks either side of a block being freed (which it may be merged with) are found without walking the
+//   free list from the head
+//
+// Other heaps, smaller ones included as they aren't worth the space, work exactly as before.
+
+#define JKR_EXP_HEAP_BINS_MAGIC 0x4642494E // 'FBIN'
+#define JKR_EXP_HEAP_BINS_MIN_SIZE 0x20000
+#define JKR_EXP_HEAP_BIN_COUNT 128
+#define JKR_EXP_HEAP_REGION_COUNT 128
+#define JKR_EXP_HEAP_BINS_SIZE ALIGN_NEXT(sizeof(JKRExpHeap::CFreeBins), 0x10)
+
+class JKRExpHeap::CFreeBins {
+  public:
+    /* 0x000 */ u32 mMagic;
+    /* 0x004 */ u32 mRegionShift;
+    /* 0x008 */ u8* mBase;
+    /* 0x00C */ u32 mClassMap[JKR_EXP_HEAP_BIN_COUNT / 32];
+    /* 0x01C */ u32 mRegionMap[JKR_EXP_HEAP_REGION_COUNT / 32];
+    /* 0x02C */ CMemBlock* mClassHead[JKR_EXP_HEAP_BIN_COUNT];
+    /* 0x22C */ CMemBlock* mRegionHead[JKR_EXP_HEAP_REGION_COUNT];
+}; // size = 0x42C
+
+// A free block's links on its size class list, in place of its contents
+struct JKRExpFreeLink {
+    JKRExpHeap::CMemBlock* mPrev;
+    JKRExpHeap::CMemBlock* mNext;
+};
+
+bool JKRExpHeap::sDefaultFreeBinsFlag = false;
+
+static inline JKRExpFreeLink* getFreeLink(JKRExpHeap::CMemBlock* block) {
+    return (JKRExpFreeLink*)block->getContent();
+}
+
+static inline bool isBinned(JKRExpHeap::CMemBlock* block) { return block->getSize() >= sizeof(JKRExpFreeLink); }
+
+static inline u32 getLowestBit(u32 bits) {
+#ifdef __MWERKS__
+    return 31 - __cntlzw(bits & -bits);
+#else
+    return __builtin_ctz((unsigned int)bits);
+#endif
+}
+
+static inline u32 getHighestBit(u32 bits) {
+#ifdef __MWERKS__
+    return 31 - __cntlzw(bits);
+#else
+    return 31 - __builtin_clz((unsigned int)bits);
+#endif
+}
+
+// The first bit at or after start that is set, or count if there's none
+static u32 findBit(const u32* map, u32 start, u32 count) {
+    u32 word;
+    u32 bits;
+
+    if (start >= count) {
+        return count;
+    }
+    word = start >> 5;
+    bits = map[word] & ((u32)0xFFFFFFFF << (start & 31));
+    while (bits == 0) {
+        if (++word == count >> 5) {
+            return count;
+        }
+        bits = map[word];
+    }
+    return (word << 5) + getLowestBit(bits);
+}
+
+// 16-byte classes up to 0x80, then four per power of two
+static u32 getSizeClass(u32 size) {
+    u32 log;
+
+    if (size < 0x80) {
+        return size >> 4;
+    }
+    log = getHighestBit(size);
+    return 8 + (log - 7) * 4 + ((size >> (log - 2)) & 3);
+}
+
+static inline u32 getRegion(JKRExpHeap::CFreeBins* bins, void* ptr) {
+    return ((u32)ptr - (u32)bins->mBase) >> bins->mRegionShift;
+}
+
+static inline u32 getAlignOffset(JKRExpHeap::CMemBlock* block, int align) {
+    u32 content = (u32)block->getContent();
+
+    return ALIGN_NEXT(content, align) - content;
+}
+
+static inline bool canHold(JKRExpHeap::CMemBlock* block, u32 size, u32 offset) {
+    return block->getSize() >= size && block->getSize() - size >= offset;
+}
+
+JKRExpHeap* JKRExpHeap::createRoot(int maxHeaps, bool errorFlag) {
+    JKRExpHeap* heap;
+    void* memory;
+    u32 memorySize;
+    u32 headerSize;
+
+    heap = NULL;
+    if (sRootHeap == NULL) {
+        initArena((char**)&memory, &memorySize, maxHeaps);
+        headerSize = ALIGN_NEXT(sizeof(JKRExpHeap), 0x10);
+        heap = new (memory) JKRExpHeap((u8*)memory + headerSize, memorySize - headerSize, NULL, errorFlag);
+        sRootHeap = heap;
+    }
+    heap->field_0x6e = true;
+    return heap;
+}
+
+JKRExpHeap* JKRExpHeap::create(u32 size, JKRHeap* parent, bool errorFlag) {
+    JKRExpHeap* heap;
+    u8* memory;
+    u32 headerSize;
+
+    if (parent == NULL) {
+        parent = sRootHeap;
+    }
+    if (size == 0xFFFFFFFF) {
+        size = parent->getMaxAllocatableSize(0x10);
+    }
+
+    size = ALIGN_PREV(size, 0x10);
+    headerSize = ALIGN_NEXT(sizeof(JKRExpHeap), 0x10);
+    if (size < headerSize + sizeof(CMemBlock) * 2) {
+        return NULL;
+    }
+
+    memory = (u8*)JKRAllocFromHeap(parent, size, 0x10);
+    if (memory == NULL) {
+        return NULL;
+    }
+    heap = new (memory) JKRExpHeap(memory + headerSize, size - headerSize, parent, errorFlag);
+    heap->field_0x6e = false;
+    return heap;
+}
+
+JKRExpHeap* JKRExpHeap::create(void* ptr, u32 size, JKRHeap* parent, bool errorFlag) {
+    JKRExpHeap* heap;
+    u8* data;
+    u32 headerSize;
+
+    if (parent == NULL) {
+        parent = sRootHeap->find(ptr);
+        if (parent == NULL) {
+            return NULL;
+        }
+    }
+
+    headerSize = ALIGN_NEXT(sizeof(JKRExpHeap), 0x10);
+    if (ptr == NULL || size < headerSize + sizeof(CMemBlock) * 2) {
+        return NULL;
+    }
+    data = (u8*)ptr + headerSize;
+    heap = new (ptr) JKRExpHeap(data, ALIGN_PREV((u32)ptr + size - (u32)data, 0x10), parent, errorFlag);
+    heap->field_0x6e = true;
+    heap->field_0x70 = ptr;
+    heap->field_0x74 = size;
+    return heap;
+}
+
+JKRExpHeap::JKRExpHeap(void* data, u32 size, JKRHeap* parent, bool errorFlag)
+    : JKRHeap(data, size, parent, errorFlag) {
+    mAllocMode = 0;
+    mCurrentGroupId = 0xFF;
+    mHeadUsedList = NULL;
+    mTailUsedList = NULL;
+
+    // memory handed back by an earlier heap could still start with a magic
+    if (sDefaultFreeBinsFlag && size >= JKR_EXP_HEAP_BINS_MIN_SIZE) {
+        ((CFreeBins*)data)->mMagic = JKR_EXP_HEAP_BINS_MAGIC;
+    } else {
+        ((CFreeBins*)data)->mMagic = 0;
+    }
+    initFreeList();
+}
+
+JKRExpHeap::~JKRExpHeap() { dispose(); }
+
+JKRExpHeap::CFreeBins* JKRExpHeap::getFreeBins() const {
+    CFreeBins* bins = (CFreeBins*)mStart;
+
+    return bins->mMagic == JKR_EXP_HEAP_BINS_MAGIC ? bins : NULL;
+}
+
+void JKRExpHeap::initFreeList() {
+    CFreeBins* bins;
+    CMemBlock* block;
+    u32 size;
+
+    bins = getFreeBins();
+    block = (CMemBlock*)mStart;
+    size = mSize;
+    if (bins != NULL) {
+        memset(bins, 0, sizeof(CFreeBins));
+        bins->mMagic = JKR_EXP_HEAP_BINS_MAGIC;
+        block = (CMemBlock*)(mStart + JKR_EXP_HEAP_BINS_SIZE);
+        size -= JKR_EXP_HEAP_BINS_SIZE;
+        bins->mBase = (u8*)block;
+        while ((size - 1) >> bins->mRegionShift >= JKR_EXP_HEAP_REGION_COUNT) {
+            bins->mRegionShift++;
+        }
+    }
+
+    mHeadFreeList = NULL;
+    mTailFreeList = NULL;
+    block->initiate(NULL, NULL, size - sizeof(CMemBlock), 0, 0);
+    setFreeBlock(block, NULL, NULL);
+}
+
+void* JKRExpHeap::do_alloc(u32 size, int alignment) {
+    void* ptr;
+
+    lock();
+    if (size < 4) {
+        size = 4;
+    }
+
+    if (alignment >= 0) {
+        if (alignment <= 4) {
+            ptr = allocFromHead(size);
+        } else {
+            ptr = allocFromHead(size, alignment);
+        }
+    } else {
+        if (-alignment <= 4) {
+            ptr = allocFromTail(size);
+        } else {
+            ptr = allocFromTail(size, -alignment);
+        }
+    }
+
+    if (JKRHeapProfiler::isActive()) {
+        if (ptr != NULL) {
+            JKRHeapProfiler::onAlloc(this, ptr, size, mCurrentGroupId);
+        } else {
+            JKRHeapProfiler::onAllocFail(this, size, mCurrentGroupId);
+        }
+    }
+    if (ptr == NULL) {
+        OSReport(":::cannot alloc memory (0x%x byte).\n", size);
+        if (getErrorFlag() == true) {
+            callErrorHandler(this, size, alignment);
+        }
+    }
+    unlock();
+    return ptr;
+}
+
+void* JKRExpHeap::allocFromHead(u32 size, int align) {
+    CMemBlock* foundBlock;
+    CMemBlock* usedBlock;
+    CMemBlock* freeBlock;
+    CMemBlock* block;
+    CMemBlock* prev;
+    CMemBlock* next;
+    CFreeBins* bins;
+    u32 foundOffset;
+    u32 foundSize;
+    u32 offset;
+
+    size = ALIGN_NEXT(size, 4);
+    foundBlock = NULL;
+    foundOffset = 0;
+
+    // blocks smaller than a link aren't binned and only requests that small can be best fit by one
+    bins = getFreeBins();
+    if (bins != NULL && mAllocMode == 0 && size >= sizeof(JKRExpFreeLink)) {
+        foundBlock = searchFreeBins(bins, size, align, &foundOffset);
+    }
+
+    // the best fit, or the first in ALLOC_MODE_1; also what finds the blocks too small to be binned
+    if (foundBlock == NULL) {
+        foundSize = 0xFFFFFFFF;
+        for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+            offset = getAlignOffset(block, align);
+            if (!canHold(block, size, offset) || block->size >= foundSize) {
+                continue;
+            }
+            foundBlock = block;
+            foundSize = block->size;
+            foundOffset = offset;
+            if (mAllocMode != 0 || foundSize == size) {
+                break;
+            }
+        }
+        if (foundBlock == NULL) {
+            return NULL;
+        }
+    }
+
+    prev = foundBlock->mPrev;
+    next = foundBlock->mNext;
+    removeFreeBlock(foundBlock);
+
+    if (foundOffset >= sizeof(CMemBlock)) {
+        // the space in front stays free as a block of its own
+        usedBlock = foundBlock->allocFore(foundOffset - sizeof(CMemBlock), 0, 0, 0, 0);
+        freeBlock = usedBlock->allocFore(size, mCurrentGroupId, 0, 0, 0);
+        setFreeBlock(foundBlock, prev, next);
+        if (freeBlock != NULL) {
+            setFreeBlock(freeBlock, foundBlock, next);
+        }
+    } else if (foundOffset != 0) {
+        // too little in front for a block; it's padding until this one is freed
+        usedBlock = (CMemBlock*)((u32)foundBlock + foundOffset);
+        usedBlock->size = foundBlock->size - foundOffset;
+        freeBlock = usedBlock->allocFore(size, mCurrentGroupId, foundOffset, 0, 0);
+        if (freeBlock != NULL) {
+            setFreeBlock(freeBlock, prev, next);
+        }
+    } else {
+        usedBlock = foundBlock;
+        freeBlock = usedBlock->allocFore(size, mCurrentGroupId, 0, 0, 0);
+        if (freeBlock != NULL) {
+            setFreeBlock(freeBlock, prev, next);
+        }
+    }
+
+    appendUsedList(usedBlock);
+    return usedBlock->getContent();
+}
+
+void* JKRExpHeap::allocFromHead(u32 size) { return allocFromHead(size, 4); }
+
+void* JKRExpHeap::allocFromTail(u32 size, int align) {
+    CMemBlock* foundBlock;
+    CMemBlock* usedBlock;
+    CMemBlock* prev;
+    CMemBlock* next;
+    u32 content;
+    u32 start;
+    u32 usedSize;
+    u32 offset;
+
+    size = ALIGN_NEXT(size, 4);
+    for (foundBlock = mTailFreeList; foundBlock != NULL; foundBlock = foundBlock->mPrev) {
+        if (foundBlock->size < size) {
+            continue;
+        }
+        content = (u32)foundBlock->getContent();
+        start = ALIGN_PREV(content + foundBlock->size - size, align);
+        if (start >= content) {
+            break;
+        }
+    }
+    if (foundBlock == NULL) {
+        return NULL;
+    }
+
+    usedSize = content + foundBlock->size - start;
+    offset = foundBlock->size - usedSize;
+    usedBlock = (CMemBlock*)start - 1;
+
+    prev = foundBlock->mPrev;
+    next = foundBlock->mNext;
+    removeFreeBlock(foundBlock);
+    if (offset >= sizeof(CMemBlock)) {
+        foundBlock->size = offset - sizeof(CMemBlock);
+        setFreeBlock(foundBlock, prev, next);
+        usedBlock->initiate(NULL, NULL, usedSize, mCurrentGroupId, 0x80);
+    } else {
+        usedBlock->initiate(NULL, NULL, usedSize, mCurrentGroupId, offset | 0x80);
+    }
+
+    appendUsedList(usedBlock);
+    return usedBlock->getContent();
+}
+
+void* JKRExpHeap::allocFromTail(u32 size) {
+    CMemBlock* foundBlock;
+    CMemBlock* usedBlock;
+    CMemBlock* prev;
+    CMemBlock* next;
+
+    size = ALIGN_NEXT(size, 4);
+    for (foundBlock = mTailFreeList; foundBlock != NULL; foundBlock = foundBlock->mPrev) {
+        if (foundBlock->size >= size) {
+            break;
+        }
+    }
+    if (foundBlock == NULL) {
+        return NULL;
+    }
+
+    prev = foundBlock->mPrev;
+    next = foundBlock->mNext;
+    removeFreeBlock(foundBlock);
+    usedBlock = foundBlock->allocBack(size, 0, 0, mCurrentGroupId, 0);
+    if (usedBlock != NULL) {
+        setFreeBlock(foundBlock, prev, next);
+    } else {
+        usedBlock = foundBlock;
+    }
+
+    appendUsedList(usedBlock);
+    return usedBlock->getContent();
+}
+
+// The best fit the linear search finds: the smallest block that holds size bytes once aligned, the lowest of equals.
+// The request's own class also holds blocks smaller than the request and alignment can rule blocks out, so each class
+// is looked at whole, and the first one with a block that fits has the best.
+JKRExpHeap::CMemBlock* JKRExpHeap::searchFreeBins(CFreeBins* bins, u32 size, int align, u32* offset) const {
+    CMemBlock* bestBlock;
+    CMemBlock* block;
+    u32 bestOffset;
+    u32 blockOffset;
+    u32 sizeClass;
+
+    for (sizeClass = getSizeClass(size); sizeClass < JKR_EXP_HEAP_BIN_COUNT;
+         sizeClass = findBit(bins->mClassMap, sizeClass + 1, JKR_EXP_HEAP_BIN_COUNT)) {
+        bestBlock = NULL;
+        bestOffset = 0;
+        for (block = bins->mClassHead[sizeClass]; block != NULL; block = getFreeLink(block)->mNext) {
+            blockOffset = getAlignOffset(block, align);
+            if (!canHold(block, size, blockOffset)) {
+                continue;
+            }
+            if (bestBlock == NULL || block->size < bestBlock->size ||
+                (block->size == bestBlock->size && block < bestBlock)) {
+                bestBlock = block;
+                bestOffset = blockOffset;
+            }
+        }
+        if (bestBlock != NULL) {
+            *offset = bestOffset;
+            return bestBlock;
+        }
+    }
+    return NULL;
+}
+
+// The first free block at or after ptr, or NULL
+JKRExpHeap::CMemBlock* JKRExpHeap::findFreeBlockAfter(void* ptr) const {
+    CFreeBins* bins;
+    CMemBlock* block;
+    u32 region;
+
+    bins = getFreeBins();
+    if (bins == NULL) {
+        for (block = mHeadFreeList; block != NULL && block < ptr; block = block->mNext) {
+        }
+        return block;
+    }
+
+    if (ptr >= mEnd) {
+        return NULL;
+    }
+    region = getRegion(bins, ptr);
+    block = bins->mRegionHead[region];
+    if (block == NULL) {
+        region = findBit(bins->mRegionMap, region + 1, JKR_EXP_HEAP_REGION_COUNT);
+        return region < JKR_EXP_HEAP_REGION_COUNT ? bins->mRegionHead[region] : NULL;
+    }
+    while (block != NULL && block < ptr) {
+        block = block->mNext;
+    }
+    return block;
+}
+
+void JKRExpHeap::do_free(void* ptr) {
+    CMemBlock* block;
+
+    lock();
+    if (getStartAddr() <= ptr && ptr <= getEndAddr()) {
+        block = CMemBlock::getHeapBlock(ptr);
+        if (block != NULL) {
+            if (JKRHeapProfiler::isActive()) {
+                JKRHeapProfiler::onFree(this, ptr);
+            }
+            block->free(this);
+        }
+    } else {
+        OSReport(":::cannot free memory (0x%x byte).\n", ptr);
+    }
+    unlock();
+}
+
+void JKRExpHeap::do_freeAll() {
+    lock();
+    JKRHeap::callAllDisposer();
+    if (JKRHeapProfiler::isActive()) {
+        JKRHeapProfiler::onFreeRange(this, mStart, mEnd);
+    }
+    mHeadUsedList = NULL;
+    mTailUsedList = NULL;
+    initFreeList();
+    unlock();
+}
+
+void JKRExpHeap::do_freeTail() {
+    CMemBlock* block;
+    CMemBlock* next;
+
+    lock();
+    for (block = mHeadUsedList; block != NULL; block = next) {
+        next = block->mNext;
+        if (block->_isTempMemBlock()) {
+            dispose(block->getContent(), block->getSize());
+            if (JKRHeapProfiler::isActive()) {
+                JKRHeapProfiler::onFree(this, block->getContent());
+            }
+            block->free(this);
+        }
+    }
+    unlock();
+}
+
+void JKRExpHeap::do_freeFill() {}
+
+s32 JKRExpHeap::do_changeGroupID(u8 newGroupID) {
+    u8 oldGroupID;
+
+    lock();
+    oldGroupID = mCurrentGroupId;
+    mCurrentGroupId = newGroupID;
+    unlock();
+    return oldGroupID;
+}
+
+u8 JKRExpHeap::do_getCurrentGroupId() { return mCurrentGroupId; }
+
+s32 JKRExpHeap::do_resize(void* ptr, u32 size) {
+    CMemBlock* block;
+    CMemBlock* freeBlock;
+    CMemBlock* next;
+
+    lock();
+    block = CMemBlock::getHeapBlock(ptr);
+    if (block == NULL || ptr < mStart || mEnd < ptr) {
+        unlock();
+        return -1;
+    }
+
+    size = ALIGN_NEXT(size, 4);
+    if (size == block->size) {
+        unlock();
+        return size;
+    }
+
+    if (size > block->size) {
+        // only into a free block right behind it
+        next = findFreeBlockAfter((u8*)block->getContent() + block->size);
+        if (next != (CMemBlock*)((u8*)block->getContent() + block->size) ||
+            size > block->size + sizeof(CMemBlock) + next->size) {
+            unlock();
+            return -1;
+        }
+        removeFreeBlock(next);
+        block->size += next->size + sizeof(CMemBlock);
+    }
+
+    if (block->size - size > sizeof(CMemBlock)) {
+        freeBlock = block->allocFore(size, block->mGroupId, block->mFlags, 0, 0);
+        if (freeBlock != NULL) {
+            recycleFreeBlock(freeBlock);
+        }
+    }
+    if (JKRHeapProfiler::isActive()) {
+        JKRHeapProfiler::onResize(this, ptr, size);
+    }
+    unlock();
+    return block->size;
+}
+
+s32 JKRExpHeap::do_getSize(void* ptr) {
+    CMemBlock* block;
+
+    lock();
+    block = CMemBlock::getHeapBlock(ptr);
+    if (block == NULL || ptr < mStart || mEnd < ptr) {
+        unlock();
+        return -1;
+    }
+    unlock();
+    return block->size;
+}
+
+s32 JKRExpHeap::do_getFreeSize() {
+    CMemBlock* block;
+    s32 size;
+
+    lock();
+    block = (CMemBlock*)do_getMaxFreeBlock();
+    size = block != NULL ? block->size : 0;
+    unlock();
+    return size;
+}
+
+void* JKRExpHeap::do_getMaxFreeBlock() {
+    CFreeBins* bins;
+    CMemBlock* maxBlock;
+    CMemBlock* block;
+    u32 sizeClass;
+
+    lock();
+    maxBlock = NULL;
+
+    // the biggest is in the highest class there is; only the tiny unbinned blocks need the whole list
+    bins = getFreeBins();
+    if (bins != NULL) {
+        for (sizeClass = JKR_EXP_HEAP_BIN_COUNT; sizeClass-- != 0;) {
+            if (bins->mClassMap[sizeClass >> 5] == 0) {
+                sizeClass &= ~31;
+                continue;
+            }
+            if (bins->mClassHead[sizeClass] != NULL) {
+                break;
+            }
+        }
+        if (sizeClass < JKR_EXP_HEAP_BIN_COUNT) {
+            for (block = bins->mClassHead[sizeClass]; block != NULL; block = getFreeLink(block)->mNext) {
+                if (maxBlock == NULL || block->size > maxBlock->size) {
+                    maxBlock = block;
+                }
+            }
+            unlock();
+            return maxBlock;
+        }
+    }
+
+    for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+        if (maxBlock == NULL || block->size > maxBlock->size) {
+            maxBlock = block;
+        }
+    }
+    unlock();
+    return maxBlock;
+}
+
+s32 JKRExpHeap::do_getTotalFreeSize() {
+    CMemBlock* block;
+    u32 size;
+
+    lock();
+    size = 0;
+    for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+        size += block->size;
+    }
+    unlock();
+    return size;
+}
+
+s32 JKRExpHeap::getUsedSize(u8 groupId) const {
+    JKRExpHeap* heap = const_cast<JKRExpHeap*>(this);
+    CMemBlock* block;
+    u32 size;
+
+    heap->lock();
+    size = 0;
+    for (block = mHeadUsedList; block != NULL; block = block->mNext) {
+        if (block->getGroupId() == groupId) {
+            size += block->size + sizeof(CMemBlock);
+        }
+    }
+    heap->unlock();
+    return size;
+}
+
+s32 JKRExpHeap::getTotalUsedSize() const {
+    JKRExpHeap* heap = const_cast<JKRExpHeap*>(this);
+    CMemBlock* block;
+    u32 size;
+
+    heap->lock();
+    size = 0;
+    for (block = mHeadUsedList; block != NULL; block = block->mNext) {
+        size += block->size + sizeof(CMemBlock);
+    }
+    heap->unlock();
+    return size;
+}
+
+void JKRExpHeap::appendUsedList(CMemBlock* newBlock) {
+    CMemBlock* block;
+
+    if (newBlock == NULL) {
+        OSPanic(__FILE__, __LINE__, "bad appendUsedList\n");
+    }
+
+    block = mTailUsedList;
+    newBlock->mMagic = 'HM';
+    if (block != NULL) {
+        block->mNext = newBlock;
+        newBlock->mPrev = block;
+    } else {
+        newBlock->mPrev = NULL;
+    }
+    mTailUsedList = newBlock;
+    if (mHeadUsedList == NULL) {
+        mHeadUsedList = newBlock;
+    }
+    newBlock->mNext = NULL;
+}
+
+// Links block into the free list between prev and next, which have to be neighbours there, and into its size
+// class and region
+void JKRExpHeap::setFreeBlock(CMemBlock* block, CMemBlock* prev, CMemBlock* next) {
+    CFreeBins* bins;
+    JKRExpFreeLink* link;
+    u32 sizeClass;
+    u32 region;
+
+    if (prev == NULL) {
+        mHeadFreeList = block;
+        block->mPrev = NULL;
+    } else {
+        prev->mNext = block;
+        block->mPrev = prev;
+    }
+    if (next == NULL) {
+        mTailFreeList = block;
+        block->mNext = NULL;
+    } else {
+        next->mPrev = block;
+        block->mNext = next;
+    }
+    block->mMagic = 0;
+
+    bins = getFreeBins();
+    if (bins == NULL) {
+        return;
+    }
+
+    if (isBinned(block)) {
+        sizeClass = getSizeClass(block->size);
+        link = getFreeLink(block);
+        link->mPrev = NULL;
+        link->mNext = bins->mClassHead[sizeClass];
+        if (link->mNext != NULL) {
+            getFreeLink(link->mNext)->mPrev = block;
+        }
+        bins->mClassHead[sizeClass] = block;
+        bins->mClassMap[sizeClass >> 5] |= (u32)1 << (sizeClass & 31);
+    }
+
+    region = getRegion(bins, block);
+    if (bins->mRegionHead[region] == NULL || block < bins->mRegionHead[region]) {
+        bins->mRegionHead[region] = block;
+        bins->mRegionMap[region >> 5] |= (u32)1 << (region & 31);
+    }
+}
+
+// Takes block out of the free list, and its size class and region; its size mustn't have changed since it went in
+void JKRExpHeap::removeFreeBlock(CMemBlock* block) {
+    CFreeBins* bins;
+    JKRExpFreeLink* link;
+    CMemBlock* prev;
+    CMemBlock* next;
+    u32 sizeClass;
+    u32 region;
+
+    prev = block->mPrev;
+    next = block->mNext;
+    if (prev == NULL) {
+        mHeadFreeList = next;
+    } else {
+        prev->mNext = next;
+    }
+    if (next == NULL) {
+        mTailFreeList = prev;
+    } else {
+        next->mPrev = prev;
+    }
+
+    bins = getFreeBins();
+    if (bins == NULL) {
+        return;
+    }
+
+    if (isBinned(block)) {
+        sizeClass = getSizeClass(block->size);
+        link = getFreeLink(block);
+        if (link->mPrev == NULL) {
+            bins->mClassHead[sizeClass] = link->mNext;
+            if (link->mNext == NULL) {
+                bins->mClassMap[sizeClass >> 5] &= ~((u32)1 << (sizeClass & 31));
+            }
+        } else {
+            getFreeLink(link->mPrev)->mNext = link->mNext;
+        }
+        if (link->mNext != NULL) {
+            getFreeLink(link->mNext)->mPrev = link->mPrev;
+        }
+    }
+
+    region = getRegion(bins, block);
+    if (bins->mRegionHead[region] == block) {
+        if (next != NULL && getRegion(bins, next) == region) {
+            bins->mRegionHead[region] = next;
+        } else {
+            bins->mRegionHead[region] = NULL;
+            bins->mRegionMap[region >> 5] &= ~((u32)1 << (region & 31));
+        }
+    }
+}
+
+void JKRExpHeap::removeUsedBlock(CMemBlock* block) {
+    CMemBlock* prev = block->mPrev;
+    CMemBlock* next = block->mNext;
+
+    if (prev == NULL) {
+        mHeadUsedList = next;
+    } else {
+        prev->mNext = next;
+    }
+    if (next == NULL) {
+        mTailUsedList = prev;
+    } else {
+        next->mPrev = prev;
+    }
+}
+
+void JKRExpHeap::recycleFreeBlock(CMemBlock* block) {
+    CMemBlock* newBlock;
+    CMemBlock* prev;
+    CMemBlock* next;
+    u32 size;
+
+    // the padding in front of an aligned block comes back with it
+    size = block->size + block->getAlignment();
+    newBlock = (CMemBlock*)((u32)block - block->getAlignment());
+    newBlock->mFlags = 0;
+    newBlock->mGroupId = 0;
+    newBlock->size = size;
+
+    next = findFreeBlockAfter(newBlock);
+    prev = next != NULL ? next->mPrev : mTailFreeList;
+    setFreeBlock(newBlock, prev, next);
+    joinTwoBlocks(newBlock);
+    if (prev != NULL) {
+        joinTwoBlocks(prev);
+    }
+}
+
+// Merges block with the next free block if nothing lies between them
+void JKRExpHeap::joinTwoBlocks(CMemBlock* block) {
+    CMemBlock* next;
+    CMemBlock* prev;
+    CMemBlock* after;
+    u32 endAddr;
+    u32 nextAddr;
+
+    next = block->mNext;
+    if (next == NULL) {
+        return;
+    }
+
+    endAddr = (u32)block->getContent() + block->size;
+    nextAddr = (u32)next - next->getAlignment();
+    if (endAddr > nextAddr) {
+        OSReport(":::Heap may be broken. (block = %x)", block);
+        OSPanic(__FILE__, __LINE__, "Bad Block\n");
+    }
+
+    if (endAddr == nextAddr) {
+        prev = block->mPrev;
+        after = next->mNext;
+        removeFreeBlock(block);
+        removeFreeBlock(next);
+        block->size += next->size + sizeof(CMemBlock) + next->getAlignment();
+        setFreeBlock(block, prev, after);
+    }
+}
+
+bool JKRExpHeap::check() {
+    CFreeBins* bins;
+    CMemBlock* block;
+    u32 totalBytes;
+    bool ok;
+
+    lock();
+    ok = true;
+    bins = getFreeBins();
+    totalBytes = bins != NULL ? JKR_EXP_HEAP_BINS_SIZE : 0;
+
+    for (block = mHeadUsedList; block != NULL; block = block->mNext) {
+        if (!block->isValid()) {
+            ok = false;
+            OSReport(":::addr %08x: bad heap signature. (%c%c)\n", block, block->mMagic >> 8, block->mMagic & 0xFF);
+        }
+        if (block->mNext != NULL) {
+            if (!block->mNext->isValid()) {
+                ok = false;
+                OSReport(":::addr %08x: bad next pointer (%08x)\nabort\n", block, block->mNext);
+                break;
+            }
+            if (block->mNext->mPrev != block) {
+                ok = false;
+                OSReport(":::addr %08x: bad previous pointer (%08x)\n", block->mNext, block->mNext->mPrev);
+            }
+        } else if (mTailUsedList != block) {
+            ok = false;
+            OSReport(":::addr %08x: bad used list(REV) (%08x)\n", block, mTailUsedList);
+        }
+        totalBytes += sizeof(CMemBlock) + block->size + block->getAlignment();
+    }
+
+    for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+        totalBytes += sizeof(CMemBlock) + block->size;
+        if (block->mNext != NULL) {
+            if (block->mNext->mPrev != block) {
+                ok = false;
+                OSReport(":::addr %08x: bad previous pointer (%08x)\n", block->mNext, block->mNext->mPrev);
+            }
+            if ((u32)block->getContent() + block->size > (u32)block->mNext) {
+                ok = false;
+                OSReport(":::addr %08x: bad block size (%08x)\n", block->mNext, block->size);
+            }
+        } else if (mTailFreeList != block) {
+            ok = false;
+            OSReport(":::addr %08x: bad used list(REV) (%08x)\n", block, mTailFreeList);
+        }
+    }
+
+    if (totalBytes != mSize) {
+        ok = false;
+        OSReport(":::bad total memory block size (%08X, %08X)\n", mSize, totalBytes);
+    }
+    if (bins != NULL && !checkFreeBins(bins)) {
+        ok = false;
+    }
+
+    if (!ok) {
+        OSReport(":::there is some error in this heap!\n");
+    }
+    unlock();
+    return ok;
+}
+
+// The size classes and regions against the free list
+bool JKRExpHeap::checkFreeBins(CFreeBins* bins) const {
+    CMemBlock* block;
+    u32 numBinned;
+    u32 numListed;
+    u32 sizeClass;
+    u32 region;
+    bool hasBit;
+    bool ok;
+
+    ok = true;
+    numBinned = 0;
+    for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+        if (isBinned(block)) {
+            numBinned++;
+        }
+        region = getRegion(bins, block);
+        if ((block->mPrev == NULL || getRegion(bins, block->mPrev) != region) && bins->mRegionHead[region] != block) {
+            ok = false;
+            OSReport(":::addr %08x: not the head of region %d\n", block, region);
+        }
+    }
+
+    for (region = 0; region < JKR_EXP_HEAP_REGION_COUNT; region++) {
+        block = bins->mRegionHead[region];
+        hasBit = (bins->mRegionMap[region >> 5] >> (region & 31)) & 1;
+        if (hasBit != (block != NULL) || (block != NULL && getRegion(bins, block) != region)) {
+            ok = false;
+            OSReport(":::bad head of region %d (%08x)\n", region, block);
+        }
+    }
+
+    numListed = 0;
+    for (sizeClass = 0; sizeClass < JKR_EXP_HEAP_BIN_COUNT; sizeClass++) {
+        block = bins->mClassHead[sizeClass];
+        hasBit = (bins->mClassMap[sizeClass >> 5] >> (sizeClass & 31)) & 1;
+        if (hasBit != (block != NULL)) {
+            ok = false;
+            OSReport(":::bad map bit of size class %d\n", sizeClass);
+        }
+        for (; block != NULL; block = getFreeLink(block)->mNext) {
+            if (getSizeClass(block->size) != sizeClass || (getFreeLink(block)->mNext != NULL &&
+                                                           getFreeLink(getFreeLink(block)->mNext)->mPrev != block)) {
+                ok = false;
+                OSReport(":::addr %08x: bad link in size class %d\n", block, sizeClass);
+                break;
+            }
+            numListed++;
+        }
+    }
+    if (numListed != numBinned) {
+        ok = false;
+        OSReport(":::%d free blocks in size classes, %d expected\n", numListed, numBinned);
+    }
+    return ok;
+}
+
+bool JKRExpHeap::dump() {
+    CMemBlock* block;
+    u32 usedBytes;
+    u32 usedCount;
+    u32 freeCount;
+    bool result;
+
+    lock();
+    result = check();
+    usedBytes = 0;
+    usedCount = 0;
+    freeCount = 0;
+
+    OSReport(" attr  address:   size    gid aln   prev_ptr next_ptr\n");
+    OSReport("(Used Blocks)\n");
+    if (mHeadUsedList == NULL) {
+        OSReport(" NONE\n");
+    }
+    for (block = mHeadUsedList; block != NULL; block = block->mNext) {
+        if (!block->isValid()) {
+            OSReport("xxxxx %08x: --------  --- ---  (-------- --------)\n", block);
+            break;
+        }
+        OSReport("%s %08x: %08x  %3d %3d  (%08x %08x)\n", block->_isTempMemBlock() ? " temp" : "alloc",
+                 block->getContent(), block->size, block->getGroupId(), block->getAlignment(),
+                 block->mPrev, block->mNext);
+        usedBytes += sizeof(CMemBlock) + block->size + block->getAlignment();
+        usedCount++;
+    }
+
+    OSReport("(Free Blocks)\n");
+    if (mHeadFreeList == NULL) {
+        OSReport(" NONE\n");
+    }
+    for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+        OSReport("%s %08x: %08x  %3d %3d  (%08x %08x)\n", " free", block->getContent(), block->size,
+                 block->getGroupId(), block->getAlignment(), block->mPrev, block->mNext);
+        freeCount++;
+    }
+
+    OSReport("%d / %d bytes (%6.2f%%) used (U:%d F:%d)\n", usedBytes, mSize,
+             (f32)usedBytes / (f32)mSize * 100.0f, usedCount, freeCount);
+    unlock();
+    return result;
+}
+
+bool JKRExpHeap::dump_sort() { return dump_sort_by_address(); }
+
+// Like dump, with the used blocks in address order rather than in the order they were allocated
+bool JKRExpHeap::dump_sort_by_address() {
+    CMemBlock* block;
+    CMemBlock* lastBlock;
+    CMemBlock* iterBlock;
+    u32 usedBytes;
+    u32 usedCount;
+    u32 freeCount;
+    bool result;
+
+    lock();
+    result = check();
+    usedBytes = 0;
+    usedCount = 0;
+    freeCount = 0;
+
+    OSReport(" attr  address:   size    gid aln   prev_ptr next_ptr\n");
+    OSReport("(Used Blocks)\n");
+    if (mHeadUsedList == NULL) {
+        OSReport(" NONE\n");
+    } else {
+        lastBlock = NULL;
+        while (true) {
+            block = NULL;
+            for (iterBlock = mHeadUsedList; iterBlock != NULL; iterBlock = iterBlock->mNext) {
+                if (lastBlock < iterBlock && (block == NULL || iterBlock < block)) {
+                    block = iterBlock;
+                }
+            }
+            if (block == NULL) {
+                break;
+            }
+            if (!block->isValid()) {
+                OSReport("xxxxx %08x: --------  --- ---  (-------- --------)\n", block);
+                break;
+            }
+            OSReport("%s %08x: %08x  %3d %3d  (%08x %08x)\n", block->_isTempMemBlock() ? " temp" : "alloc",
+                     block->getContent(), block->size, block->getGroupId(), block->getAlignment(),
+                     block->mPrev, block->mNext);
+            usedBytes += sizeof(CMemBlock) + block->size + block->getAlignment();
+            usedCount++;
+            lastBlock = block;
+        }
+    }
+
+    OSReport("(Free Blocks)\n");
+    if (mHeadFreeList == NULL) {
+        OSReport(" NONE\n");
+    }
+    for (block = mHeadFreeList; block != NULL; block = block->mNext) {
+        OSReport("%s %08x: %08x  %3d %3d  (%08x %08x)\n", " free", block->getContent(), block->size,
+                 block->getGroupId(), block->getAlignment(), block->mPrev, block->mNext);
+        freeCount++;
+    }
+
+    OSReport("%d / %d bytes (%6.2f%%) used (U:%d F:%d)\n", usedBytes, mSize,
+             (f32)usedBytes / (f32)mSize * 100.0f, usedCount, freeCount);
+    unlock();
+    return result;
+}
+
+void JKRExpHeap::do_destroy() {
+    JKRHeap* parent;
+
+    if (JKRHeapProfiler::isActive()) {
+        JKRHeapProfiler::onDestroy(this);
+    }
+    if (!field_0x6e) {
+        parent = mChildTree.getParent()->getObject();
+        if (parent != NULL) {
+            this->~JKRExpHeap();
+            JKRHeap::free(this, parent);
+        }
+    } else {
+        this->~JKRExpHeap();
+    }
+}
+
+u32 JKRExpHeap::getHeapType() { return 'EXPH'; }
+
+void JKRExpHeap::state_register(JKRHeap::TState* p, u32 id) const {
+    CMemBlock* block;
+    u32 checkCode;
+
+    setState_u32ID_(p, id);
+    if (id <= 0xFF) {
+        setState_uUsedSize_(p, getUsedSize(id));
+    } else {
+        setState_uUsedSize_(p, getTotalUsedSize());
+    }
+
+    checkCode = 0;
+    for (block = mHeadUsedList; block != NULL; block = block->mNext) {
+        if (id > 0xFF || block->getGroupId() == id) {
+            checkCode += (u32)block * 3;
+        }
+    }
+    setState_u32CheckCode_(p, checkCode);
+}
+
+bool JKRExpHeap::state_compare(JKRHeap::TState const& r1, JKRHeap::TState const& r2) const {
+    bool result = true;
+
+    if (r1.getCheckCode() != r2.getCheckCode()) {
+        result = false;
+    }
+    if (r1.getUsedSize() != r2.getUsedSize()) {
+        result = false;
+    }
+    return result;
+}
+
+void JKRExpHeap::CMemBlock::initiate(CMemBlock* prev, CMemBlock* next, u32 size, u8 groupId, u8 alignment) {
+    mMagic = 'HM';
+    mFlags = alignment;
+    mGroupId = groupId;
+    this->size = size;
+    mPrev = prev;
+    mNext = next;
+}
+
+// Keeps the first size bytes and returns what's left behind them as a block of its own, or NULL if that isn't
+// enough for one
+JKRExpHeap::CMemBlock* JKRExpHeap::CMemBlock::allocFore(u32 size, u8 groupId1, u8 alignment1, u8 groupId2,
+                                                        u8 alignment2) {
+    CMemBlock* block;
+
+    block = NULL;
+    mGroupId = groupId1;
+    mFlags = alignment1;
+    if (this->size >= size + sizeof(CMemBlock)) {
+        block = (CMemBlock*)((u32)getContent() + size);
+        block->mGroupId = groupId2;
+        block->mFlags = alignment2;
+        block->size = this->size - (size + sizeof(CMemBlock));
+        this->size = size;
+    }
+    return block;
+}
+
+// Returns the last size bytes as a temporary block of their own, or NULL if the rest wouldn't hold a block, in
+// which case this whole block becomes the temporary one
+JKRExpHeap::CMemBlock* JKRExpHeap::CMemBlock::allocBack(u32 size, u8 groupId1, u8 alignment1, u8 groupId2,
+                                                        u8 alignment2) {
+    CMemBlock* block;
+
+    block = NULL;
+    if (this->size >= size + sizeof(CMemBlock)) {
+        block = (CMemBlock*)((u32)this + this->size - size);
+        block->mGroupId = groupId2;
+        block->mFlags = alignment2 | 0x80;
+        block->size = size;
+        mGroupId = groupId1;
+        mFlags = alignment1;
+        this->size -= size + sizeof(CMemBlock);
+    } else {
+        mGroupId = groupId2;
+        mFlags = 0x80;
+    }
+    return block;
+}
+
+int JKRExpHeap::CMemBlock::free(JKRExpHeap* heap) {
+    heap->removeUsedBlock(this);
+    heap->recycleFreeBlock(this);
+    return 0;
+}
+
+JKRExpHeap::CMemBlock* JKRExpHeap::CMemBlock::getHeapBlock(void* ptr) {
+    CMemBlock* block;
+
+    if (ptr != NULL) {
+        block = (CMemBlock*)ptr - 1;
+        if (block->isValid()) {
+            return block;
+        }
+    }
+    return NULL;
+}
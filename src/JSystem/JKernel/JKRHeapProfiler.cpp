@@ -0,0 +1,607 @@
+#include "JSystem/JKernel/JKRHeapProfiler.h"
+#include "dolphin/os.h"
+#include "macros.h"
+
+// Live blocks are found by address in an open-addressed table, call sites by their stack in another. Both are
+// linear probing, and a block table slot is emptied by moving the rest of its run back so nothing else has to
+// know about deleted slots.
+//
+// The call stack is taken from the back chain, from the frame of onAlloc's caller on. Which of the frames after that
+// are still inside the heaps depends on how the caller got there, so they're all kept and left for the host to skip
+// by name.
+
+bool JKRHeapProfiler::sActive;
+JKRHeap* JKRHeapProfiler::sHeap;
+u32 JKRHeapProfiler::sFrame;
+u32 JKRHeapProfiler::sNumHeaps;
+u32 JKRHeapProfiler::sNumStats;
+JKRHeapProfiler::THeap JKRHeapProfiler::sHeaps[JKR_HEAP_PROFILER_MAX_HEAPS];
+JKRHeapProfiler::TStat JKRHeapProfiler::sStats[JKR_HEAP_PROFILER_MAX_STATS];
+
+JKRHeapProfiler::TBlock* JKRHeapProfiler::sBlocks;
+u32 JKRHeapProfiler::sBlockMask;
+u32 JKRHeapProfiler::sNumBlocks;
+u32 JKRHeapProfiler::sMaxBlocks;
+JKRHeapProfiler::TSite* JKRHeapProfiler::sSites;
+u16* JKRHeapProfiler::sSiteTable;
+u32 JKRHeapProfiler::sSiteMask;
+u32 JKRHeapProfiler::sNumSites;
+u32 JKRHeapProfiler::sMaxSites;
+JKRHeapProfiler::TSample* JKRHeapProfiler::sSamples;
+u32 JKRHeapProfiler::sNumSamples;
+u32 JKRHeapProfiler::sMaxSamples;
+
+u32 JKRHeapProfiler::sDroppedBlocks;
+u32 JKRHeapProfiler::sDroppedSites;
+u32 JKRHeapProfiler::sDroppedSamples;
+
+// at least 4/3 of count, so the tables are never more than 3/4 full
+static u32 getTableSize(u32 count) {
+    u32 size = 16;
+
+    while (size - size / 4 < count) {
+        size <<= 1;
+    }
+    return size;
+}
+
+static inline u32 hashPtr(void* ptr) { return ((u32)ptr >> 2) * 0x9E3779B1; }
+
+// Each frame starts with the one before it, and the word after that is where the function it called saved its return
+// address. The first address is the one into onAlloc, which isn't kept.
+static void getCallStack(u32* stack) {
+    u32* frame;
+    u32 i;
+
+    frame = (u32*)OSGetStackPointer();
+    if (frame != NULL && (u32)frame != 0xFFFFFFFF) {
+        frame = (u32*)frame[0];
+    }
+    for (i = 0; i < JKR_HEAP_PROFILER_DEPTH; i++) {
+        if (frame == NULL || (u32)frame == 0xFFFFFFFF) {
+            stack[i] = 0;
+            continue;
+        }
+        frame = (u32*)frame[0];
+        stack[i] = (frame == NULL || (u32)frame == 0xFFFFFFFF) ? 0 : frame[1];
+    }
+}
+
+static u32 hashStack(const u32* stack, u32 stat) {
+    u32 hash;
+    u32 i;
+
+    hash = stat;
+    for (i = 0; i < JKR_HEAP_PROFILER_DEPTH; i++) {
+        hash = (hash ^ stack[i]) * 0x01000193;
+    }
+    return hash ^ (hash >> 15);
+}
+
+bool JKRHeapProfiler::start(JKRHeap* heap, u32 maxBlocks, u32 maxSites, u32 maxSamples) {
+    u32 blockTableSize;
+    u32 siteTableSize;
+    u32 i;
+
+    if (sActive || maxSites >= JKR_HEAP_PROFILER_NONE) {
+        return false;
+    }
+
+    blockTableSize = getTableSize(maxBlocks);
+    siteTableSize = getTableSize(maxSites);
+    sBlocks = (TBlock*)JKRAllocFromHeap(heap, blockTableSize * sizeof(TBlock), 4);
+    sSites = (TSite*)JKRAllocFromHeap(heap, maxSites * sizeof(TSite), 4);
+    sSiteTable = (u16*)JKRAllocFromHeap(heap, siteTableSize * sizeof(u16), 4);
+    sSamples = (TSample*)JKRAllocFromHeap(heap, maxSamples * sizeof(TSample), 4);
+    sHeap = heap;
+    if (sBlocks == NULL || sSites == NULL || sSiteTable == NULL || sSamples == NULL) {
+        stop();
+        return false;
+    }
+
+    for (i = 0; i < blockTableSize; i++) {
+        sBlocks[i].mPtr = NULL;
+    }
+    for (i = 0; i < siteTableSize; i++) {
+        sSiteTable[i] = JKR_HEAP_PROFILER_NONE;
+    }
+    sBlockMask = blockTableSize - 1;
+    sSiteMask = siteTableSize - 1;
+    sMaxBlocks = maxBlocks;
+    sMaxSites = maxSites;
+    sMaxSamples = maxSamples;
+    sNumBlocks = 0;
+    sNumSites = 0;
+    sNumSamples = 0;
+    sNumHeaps = 0;
+    sNumStats = 0;
+    sFrame = 0;
+    sDroppedBlocks = 0;
+    sDroppedSites = 0;
+    sDroppedSamples = 0;
+    sActive = true;
+    return true;
+}
+
+void JKRHeapProfiler::stop() {
+    BOOL enable;
+
+    enable = OSDisableInterrupts();
+    sActive = false;
+    OSRestoreInterrupts(enable);
+
+    if (sBlocks != NULL) {
+        JKRFreeToHeap(sHeap, sBlocks);
+    }
+    if (sSites != NULL) {
+        JKRFreeToHeap(sHeap, sSites);
+    }
+    if (sSiteTable != NULL) {
+        JKRFreeToHeap(sHeap, sSiteTable);
+    }
+    if (sSamples != NULL) {
+        JKRFreeToHeap(sHeap, sSamples);
+    }
+    sBlocks = NULL;
+    sSites = NULL;
+    sSiteTable = NULL;
+    sSamples = NULL;
+}
+
+u32 JKRHeapProfiler::getHeapIndex(JKRHeap* heap) {
+    u32 i;
+
+    for (i = 0; i < sNumHeaps; i++) {
+        if (sHeaps[i].mHeap == heap) {
+            return i;
+        }
+    }
+    if (sNumHeaps == JKR_HEAP_PROFILER_MAX_HEAPS) {
+        return JKR_HEAP_PROFILER_NONE;
+    }
+
+    sHeaps[i].mHeap = heap;
+    sHeaps[i].mName = NULL;
+    sHeaps[i].mType = heap->getHeapType();
+    sHeaps[i].mSize = heap->getSize();
+    sNumHeaps++;
+    return i;
+}
+
+u32 JKRHeapProfiler::getStatIndex(JKRHeap* heap, u8 groupId) {
+    static u32 sLastStat;
+    TStat* stat;
+    u32 heapIndex;
+    u32 i;
+
+    // runs of allocations mostly come from one heap and group
+    if (sLastStat < sNumStats && sHeaps[sStats[sLastStat].mHeap].mHeap == heap &&
+        sStats[sLastStat].mGroupId == groupId) {
+        return sLastStat;
+    }
+
+    heapIndex = getHeapIndex(heap);
+    if (heapIndex == JKR_HEAP_PROFILER_NONE) {
+        return JKR_HEAP_PROFILER_NONE;
+    }
+    for (i = 0; i < sNumStats; i++) {
+        if (sStats[i].mHeap == heapIndex && sStats[i].mGroupId == groupId) {
+            sLastStat = i;
+            return i;
+        }
+    }
+    if (sNumStats == JKR_HEAP_PROFILER_MAX_STATS) {
+        return JKR_HEAP_PROFILER_NONE;
+    }
+
+    stat = &sStats[i];
+    stat->mHeap = heapIndex;
+    stat->mGroupId = groupId;
+    stat->mAllocCount = 0;
+    stat->mFreeCount = 0;
+    stat->mResizeCount = 0;
+    stat->mFailCount = 0;
+    stat->mAllocBytes = 0;
+    stat->mLiveBlocks = 0;
+    stat->mLiveBytes = 0;
+    stat->mPeakBytes = 0;
+    stat->mLifetimeSum = 0;
+    stat->mLifetimeMax = 0;
+    sNumStats++;
+    sLastStat = i;
+    return i;
+}
+
+const JKRHeapProfiler::TStat* JKRHeapProfiler::findStat(JKRHeap* heap, u8 groupId) {
+    u32 i;
+
+    for (i = 0; i < sNumStats; i++) {
+        if (sHeaps[sStats[i].mHeap].mHeap == heap && sStats[i].mGroupId == groupId) {
+            return &sStats[i];
+        }
+    }
+    return NULL;
+}
+
+u32 JKRHeapProfiler::getSiteIndex(u32 stat, const u32* stack) {
+    TSite* site;
+    u32 slot;
+    u32 i;
+
+    for (slot = hashStack(stack, stat) & sSiteMask; sSiteTable[slot] != JKR_HEAP_PROFILER_NONE;
+         slot = (slot + 1) & sSiteMask) {
+        site = &sSites[sSiteTable[slot]];
+        if (site->mStat != stat) {
+            continue;
+        }
+        for (i = 0; i < JKR_HEAP_PROFILER_DEPTH && site->mStack[i] == stack[i]; i++) {
+        }
+        if (i == JKR_HEAP_PROFILER_DEPTH) {
+            return sSiteTable[slot];
+        }
+    }
+    if (sNumSites == sMaxSites) {
+        sDroppedSites++;
+        return JKR_HEAP_PROFILER_NONE;
+    }
+
+    site = &sSites[sNumSites];
+    for (i = 0; i < JKR_HEAP_PROFILER_DEPTH; i++) {
+        site->mStack[i] = stack[i];
+    }
+    site->mStat = stat;
+    site->mAllocCount = 0;
+    site->mAllocBytes = 0;
+    site->mLiveBytes = 0;
+    site->mPeakBytes = 0;
+    sSiteTable[slot] = sNumSites;
+    return sNumSites++;
+}
+
+JKRHeapProfiler::TBlock* JKRHeapProfiler::findBlock(void* ptr) {
+    u32 slot;
+
+    for (slot = hashPtr(ptr) & sBlockMask; sBlocks[slot].mPtr != NULL; slot = (slot + 1) & sBlockMask) {
+        if (sBlocks[slot].mPtr == ptr) {
+            return &sBlocks[slot];
+        }
+    }
+    return NULL;
+}
+
+// Takes block's lifetime and bytes off its group and site, and closes the gap it leaves in its run
+void JKRHeapProfiler::removeBlock(TBlock* block) {
+    TStat* stat;
+    u32 lifetime;
+    u32 hole;
+    u32 slot;
+    u32 home;
+
+    stat = &sStats[block->mStat];
+    lifetime = sFrame - block->mFrame;
+    stat->mFreeCount++;
+    stat->mLiveBlocks--;
+    stat->mLiveBytes -= block->mSize;
+    stat->mLifetimeSum += lifetime;
+    if (lifetime > stat->mLifetimeMax) {
+        stat->mLifetimeMax = lifetime;
+    }
+    if (block->mSite != JKR_HEAP_PROFILER_NONE) {
+        sSites[block->mSite].mLiveBytes -= block->mSize;
+    }
+    sNumBlocks--;
+
+    hole = block - sBlocks;
+    for (slot = (hole + 1) & sBlockMask; sBlocks[slot].mPtr != NULL; slot = (slot + 1) & sBlockMask) {
+        // a block can fill the hole if the hole lies between its home slot and where it is
+        home = hashPtr(sBlocks[slot].mPtr) & sBlockMask;
+        if (((slot - home) & sBlockMask) >= ((slot - hole) & sBlockMask)) {
+            sBlocks[hole] = sBlocks[slot];
+            hole = slot;
+        }
+    }
+    sBlocks[hole].mPtr = NULL;
+}
+
+void JKRHeapProfiler::setHeapName(JKRHeap* heap, const char* name) {
+    BOOL enable;
+    u32 index;
+
+    enable = OSDisableInterrupts();
+    if (sActive) {
+        index = getHeapIndex(heap);
+        if (index != JKR_HEAP_PROFILER_NONE) {
+            sHeaps[index].mName = name;
+        }
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::sample(u32 frame) {
+    BOOL enable;
+    TSample* sample;
+    u32 i;
+
+    enable = OSDisableInterrupts();
+    if (!sActive) {
+        OSRestoreInterrupts(enable);
+        return;
+    }
+
+    sFrame = frame;
+    for (i = 0; i < sNumStats; i++) {
+        if (sNumSamples == sMaxSamples) {
+            sDroppedSamples += sNumStats - i;
+            break;
+        }
+        sample = &sSamples[sNumSamples++];
+        sample->mFrame = frame;
+        sample->mStat = i;
+        sample->mLiveBlocks = sStats[i].mLiveBlocks;
+        sample->mLiveBytes = sStats[i].mLiveBytes;
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::onAlloc(JKRHeap* heap, void* ptr, u32 size, u8 groupId) {
+    u32 stack[JKR_HEAP_PROFILER_DEPTH];
+    BOOL enable;
+    TStat* stat;
+    TSite* site;
+    TBlock* block;
+    u32 statIndex;
+    u32 siteIndex;
+    u32 slot;
+
+    enable = OSDisableInterrupts();
+    if (!sActive) {
+        OSRestoreInterrupts(enable);
+        return;
+    }
+
+    statIndex = getStatIndex(heap, groupId);
+    if (statIndex == JKR_HEAP_PROFILER_NONE || sNumBlocks == sMaxBlocks) {
+        sDroppedBlocks++;
+        OSRestoreInterrupts(enable);
+        return;
+    }
+
+    stat = &sStats[statIndex];
+    stat->mAllocCount++;
+    stat->mAllocBytes += size;
+    stat->mLiveBlocks++;
+    stat->mLiveBytes += size;
+    if (stat->mLiveBytes > stat->mPeakBytes) {
+        stat->mPeakBytes = stat->mLiveBytes;
+    }
+
+    getCallStack(stack);
+    siteIndex = getSiteIndex(statIndex, stack);
+    if (siteIndex != JKR_HEAP_PROFILER_NONE) {
+        site = &sSites[siteIndex];
+        site->mAllocCount++;
+        site->mAllocBytes += size;
+        site->mLiveBytes += size;
+        if (site->mLiveBytes > site->mPeakBytes) {
+            site->mPeakBytes = site->mLiveBytes;
+        }
+    }
+
+    // a block still in the table here was given back some way the heap didn't report
+    block = findBlock(ptr);
+    if (block != NULL) {
+        removeBlock(block);
+    }
+    for (slot = hashPtr(ptr) & sBlockMask; sBlocks[slot].mPtr != NULL; slot = (slot + 1) & sBlockMask) {
+    }
+    block = &sBlocks[slot];
+    block->mPtr = ptr;
+    block->mSize = size;
+    block->mFrame = sFrame;
+    block->mStat = statIndex;
+    block->mSite = siteIndex;
+    sNumBlocks++;
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::onAllocFail(JKRHeap* heap, u32 size, u8 groupId) {
+    BOOL enable;
+    u32 statIndex;
+
+    enable = OSDisableInterrupts();
+    if (sActive) {
+        statIndex = getStatIndex(heap, groupId);
+        if (statIndex != JKR_HEAP_PROFILER_NONE) {
+            sStats[statIndex].mFailCount++;
+        }
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::onFree(JKRHeap* heap, void* ptr) {
+    BOOL enable;
+    TBlock* block;
+
+    enable = OSDisableInterrupts();
+    if (sActive) {
+        block = findBlock(ptr);
+        if (block != NULL) {
+            removeBlock(block);
+        }
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::onResize(JKRHeap* heap, void* ptr, u32 size) {
+    BOOL enable;
+    TBlock* block;
+    TStat* stat;
+    TSite* site;
+
+    enable = OSDisableInterrupts();
+    if (!sActive) {
+        OSRestoreInterrupts(enable);
+        return;
+    }
+
+    block = findBlock(ptr);
+    if (block != NULL) {
+        stat = &sStats[block->mStat];
+        stat->mResizeCount++;
+        stat->mLiveBytes += size - block->mSize;
+        if (stat->mLiveBytes > stat->mPeakBytes) {
+            stat->mPeakBytes = stat->mLiveBytes;
+        }
+        if (block->mSite != JKR_HEAP_PROFILER_NONE) {
+            site = &sSites[block->mSite];
+            site->mLiveBytes += size - block->mSize;
+            if (site->mLiveBytes > site->mPeakBytes) {
+                site->mPeakBytes = site->mLiveBytes;
+            }
+        }
+        block->mSize = size;
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::onFreeRange(JKRHeap* heap, void* begin, void* end) {
+    BOOL enable;
+    TBlock* block;
+    u32 heapIndex;
+    u32 slot;
+
+    enable = OSDisableInterrupts();
+    if (!sActive || begin == end) {
+        OSRestoreInterrupts(enable);
+        return;
+    }
+
+    for (heapIndex = 0; heapIndex < sNumHeaps && sHeaps[heapIndex].mHeap != heap; heapIndex++) {
+    }
+    // removeBlock moves later blocks back into the slot, so it's looked at again
+    for (slot = 0; slot <= sBlockMask && heapIndex < sNumHeaps;) {
+        block = &sBlocks[slot];
+        if (block->mPtr != NULL && sStats[block->mStat].mHeap == heapIndex && begin <= block->mPtr &&
+            block->mPtr < end) {
+            removeBlock(block);
+        } else {
+            slot++;
+        }
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::onDestroy(JKRHeap* heap) {
+    BOOL enable;
+    u32 i;
+
+    onFreeRange(heap, heap->getStartAddr(), heap->getEndAddr());
+
+    // a heap made later at the same address is a new one
+    enable = OSDisableInterrupts();
+    for (i = 0; i < sNumHeaps; i++) {
+        if (sHeaps[i].mHeap == heap) {
+            sHeaps[i].mHeap = NULL;
+        }
+    }
+    OSRestoreInterrupts(enable);
+}
+
+void JKRHeapProfiler::printHeap(u32 index) {
+    THeap* heap = &sHeaps[index];
+
+    if (heap->mName != NULL) {
+        OSReport("heapprof heap %d %s %c%c%c%c %08x\n", index, heap->mName, heap->mType >> 24, heap->mType >> 16,
+                 heap->mType >> 8, heap->mType, heap->mSize);
+    } else {
+        OSReport("heapprof heap %d %c%c%c%c#%d %c%c%c%c %08x\n", index, heap->mType >> 24, heap->mType >> 16,
+                 heap->mType >> 8, heap->mType, index, heap->mType >> 24, heap->mType >> 16, heap->mType >> 8,
+                 heap->mType, heap->mSize);
+    }
+}
+
+// heapprof heap <index> <name> <type> <size>
+// heapprof group <heap> <group> <allocs> <frees> <resizes> <fails> <bytes> <live blocks> <live bytes> <peak bytes>
+//                <average lifetime> <longest lifetime>
+// heapprof site <heap> <group> <allocs> <bytes> <live bytes> <peak bytes> <return addresses...>
+// heapprof dropped <blocks> <sites> <samples>
+void JKRHeapProfiler::dump(u32 numSites) {
+    TStat* stat;
+    TSite* site;
+    TSite* best;
+    u32 minBytes;
+    u32 lastBytes;
+    u32 lastIndex;
+    u32 i;
+    u32 j;
+
+    if (sBlocks == NULL) {
+        return;
+    }
+
+    OSReport("heapprof frame %d\n", sFrame);
+    for (i = 0; i < sNumHeaps; i++) {
+        printHeap(i);
+    }
+    for (i = 0; i < sNumStats; i++) {
+        stat = &sStats[i];
+        OSReport("heapprof group %d %d %d %d %d %d %d %d %d %d %d %d\n", stat->mHeap, stat->mGroupId,
+                 stat->mAllocCount, stat->mFreeCount, stat->mResizeCount, stat->mFailCount, stat->mAllocBytes,
+                 stat->mLiveBlocks, stat->mLiveBytes, stat->mPeakBytes,
+                 stat->mFreeCount != 0 ? stat->mLifetimeSum / stat->mFreeCount : 0, stat->mLifetimeMax);
+    }
+
+    // the sites by bytes allocated, most first, ties in the order they were first seen; picked one at a time as
+    // the tables aren't to be reordered
+    lastBytes = 0xFFFFFFFF;
+    lastIndex = 0xFFFFFFFF;
+    for (i = 0; i < numSites && i < sNumSites; i++) {
+        best = NULL;
+        minBytes = 0;
+        for (j = 0; j < sNumSites; j++) {
+            site = &sSites[j];
+            if (site->mAllocBytes > lastBytes || (site->mAllocBytes == lastBytes && j <= lastIndex)) {
+                continue;
+            }
+            if (best == NULL || site->mAllocBytes > minBytes) {
+                best = site;
+                minBytes = site->mAllocBytes;
+            }
+        }
+        if (best == NULL) {
+            break;
+        }
+        lastBytes = best->mAllocBytes;
+        lastIndex = best - sSites;
+
+        stat = &sStats[best->mStat];
+        OSReport("heapprof site %d %d %d %d %d %d", stat->mHeap, stat->mGroupId, best->mAllocCount,
+                 best->mAllocBytes, best->mLiveBytes, best->mPeakBytes);
+        for (j = 0; j < JKR_HEAP_PROFILER_DEPTH && best->mStack[j] != 0; j++) {
+            OSReport(" %08x", best->mStack[j]);
+        }
+        OSReport("\n");
+    }
+    OSReport("heapprof dropped %d %d %d\n", sDroppedBlocks, sDroppedSites, sDroppedSamples);
+}
+
+// heapprof sample <frame> <heap> <group> <live blocks> <live bytes>
+void JKRHeapProfiler::dumpTimeline() {
+    TSample* sample;
+    TStat* stat;
+    u32 i;
+
+    if (sSamples == NULL) {
+        return;
+    }
+
+    for (i = 0; i < sNumHeaps; i++) {
+        printHeap(i);
+    }
+    for (i = 0; i < sNumSamples; i++) {
+        sample = &sSamples[i];
+        stat = &sStats[sample->mStat];
+        OSReport("heapprof sample %d %d %d %d %d\n", sample->mFrame, stat->mHeap, stat->mGroupId, sample->mLiveBlocks,
+                 sample->mLiveBytes);
+    }
+}
@@ -0,0 +1,352 @@
+#include "JSystem/JKernel/JKRSolidHeap.h"
+#include "JSystem/JKernel/JKRHeapProfiler.h"
+#include "dolphin/os.h"
+#include "macros.h"
+
+// Marks let a solid heap be given back in layers instead of all at once. setMark saves where the head and tail are
+// and rewind moves the ends it was set for back there, so a frame's or a scene's scratch memory is one mark:
+//
+//     JKRSolidHeap::CScope frame(heap, JKRSolidHeap::MARK_TAIL);
+//
+// and is released in one step however much was allocated in it. Marks nest. Rewinding one also drops any set after
+// it that are still set, which is reported, as they should have been rewound first.
+//
+// With the heap's debug fill on, free memory is kept filled with JKR_SOLID_HEAP_FILL. With its memory check on as
+// well, allocating memory that doesn't hold the fill any more is reported: something wrote through a pointer into
+// memory it had already given back.
+
+#define JKR_SOLID_HEAP_FILL 0xDD
+
+JKRSolidHeap* JKRSolidHeap::create(u32 size, JKRHeap* parent, bool errorFlag) {
+    u8* memory;
+    u32 headerSize;
+
+    if (parent == NULL) {
+        parent = getRootHeap();
+    }
+    if (size == 0xFFFFFFFF) {
+        size = parent->getMaxAllocatableSize(0x10);
+    }
+
+    size = ALIGN_PREV(size, 0x10);
+    headerSize = ALIGN_NEXT(sizeof(JKRSolidHeap), 0x10);
+    if (size < headerSize) {
+        return NULL;
+    }
+
+    memory = (u8*)JKRAllocFromHeap(parent, size, 0x10);
+    if (memory == NULL) {
+        return NULL;
+    }
+    return new (memory) JKRSolidHeap(memory + headerSize, size - headerSize, parent, errorFlag);
+}
+
+void JKRSolidHeap::do_destroy(void) {
+    JKRHeap* parent = getParent();
+
+    if (JKRHeapProfiler::isActive()) {
+        JKRHeapProfiler::onDestroy(this);
+    }
+    if (parent != NULL) {
+        this->~JKRSolidHeap();
+        JKRHeap::free(this, parent);
+    }
+}
+
+JKRSolidHeap::JKRSolidHeap(void* data, u32 size, JKRHeap* parent, bool errorFlag)
+    : JKRHeap(data, size, parent, errorFlag) {
+    mFreeSize = mSize;
+    mSolidHead = mStart;
+    mSolidTail = mEnd;
+    mMarkList = NULL;
+    if (getDebugFill()) {
+        do_freeFill();
+    }
+}
+
+JKRSolidHeap::~JKRSolidHeap(void) { dispose(); }
+
+s32 JKRSolidHeap::adjustSize(void) {
+    JKRHeap* parent;
+    CMark* mark;
+    u32 headerSize;
+    u32 newSize;
+
+    parent = getParent();
+    if (parent == NULL) {
+        return -1;
+    }
+
+    lock();
+    headerSize = (u32)mStart - (u32)this;
+    newSize = ALIGN_NEXT(mSolidHead - mStart, 0x20);
+    if (parent->resize(this, headerSize + newSize) != -1) {
+        mFreeSize = 0;
+        mSize = newSize;
+        mEnd = mStart + mSize;
+        mSolidHead = mEnd;
+        mSolidTail = mEnd;
+        for (mark = mMarkList; mark != NULL; mark = mark->mNext) {
+            mark->mTail = mEnd;
+        }
+    }
+    unlock();
+    return headerSize + newSize;
+}
+
+void* JKRSolidHeap::do_alloc(u32 size, int alignment) {
+    void* ptr;
+
+    lock();
+    if (size < 4) {
+        size = 4;
+    }
+
+    if (alignment >= 0) {
+        ptr = allocFromHead(size, alignment < 4 ? 4 : alignment);
+    } else {
+        ptr = allocFromTail(size, -alignment < 4 ? 4 : -alignment);
+    }
+    if (JKRHeapProfiler::isActive()) {
+        if (ptr != NULL) {
+            JKRHeapProfiler::onAlloc(this, ptr, size, mGroupId);
+        } else {
+            JKRHeapProfiler::onAllocFail(this, size, mGroupId);
+        }
+    }
+    unlock();
+    return ptr;
+}
+
+void* JKRSolidHeap::allocFromHead(u32 size, int alignment) {
+    u32 start;
+    u32 totalSize;
+
+    size = ALIGN_NEXT(size, alignment);
+    start = ALIGN_NEXT((u32)mSolidHead, alignment);
+    totalSize = size + (start - (u32)mSolidHead);
+    if (totalSize > mFreeSize) {
+        OSReport("allocFromHead: cannot alloc memory (0x%x byte).\n", totalSize);
+        if (getErrorFlag() == true) {
+            callErrorHandler(this, size, alignment);
+        }
+        return NULL;
+    }
+
+    if (getDebugFill() && mCheckMemoryFilled && !checkMemoryFilled(mSolidHead, totalSize, JKR_SOLID_HEAP_FILL)) {
+        OSReport(":::addr %08x: written after it was given back\n", mSolidHead);
+    }
+    mSolidHead += totalSize;
+    mFreeSize -= totalSize;
+    return (void*)start;
+}
+
+void* JKRSolidHeap::allocFromTail(u32 size, int alignment) {
+    u32 start;
+    u32 totalSize;
+
+    size = ALIGN_NEXT(size, alignment);
+    start = ALIGN_PREV((u32)mSolidTail - size, alignment);
+    totalSize = (u32)mSolidTail - start;
+    if (size > mFreeSize || totalSize > mFreeSize) {
+        OSReport("allocFromTail: cannot alloc memory (0x%x byte).\n", totalSize);
+        if (getErrorFlag() == true) {
+            callErrorHandler(this, size, alignment);
+        }
+        return NULL;
+    }
+
+    if (getDebugFill() && mCheckMemoryFilled && !checkMemoryFilled((void*)start, totalSize, JKR_SOLID_HEAP_FILL)) {
+        OSReport(":::addr %08x: written after it was given back\n", start);
+    }
+    mSolidTail -= totalSize;
+    mFreeSize -= totalSize;
+    return (void*)start;
+}
+
+void JKRSolidHeap::do_free(void* ptr) { OSReport("free: cannot free memory block (%08x)\n", ptr); }
+
+void JKRSolidHeap::do_freeAll(void) {
+    lock();
+    JKRHeap::callAllDisposer();
+    if (JKRHeapProfiler::isActive()) {
+        JKRHeapProfiler::onFreeRange(this, mStart, mEnd);
+    }
+    mFreeSize = mSize;
+    mSolidHead = mStart;
+    mSolidTail = mEnd;
+    mMarkList = NULL;
+    if (getDebugFill()) {
+        do_freeFill();
+    }
+    unlock();
+}
+
+void JKRSolidHeap::do_freeTail(void) {
+    CMark* mark;
+
+    lock();
+    if (mSolidTail != mEnd) {
+        dispose(mSolidTail, mEnd);
+    }
+    if (JKRHeapProfiler::isActive()) {
+        JKRHeapProfiler::onFreeRange(this, mSolidTail, mEnd);
+    }
+    if (getDebugFill()) {
+        fillMemory(mSolidTail, mEnd - mSolidTail, JKR_SOLID_HEAP_FILL);
+    }
+    mFreeSize += mEnd - mSolidTail;
+    mSolidTail = mEnd;
+    for (mark = mMarkList; mark != NULL; mark = mark->mNext) {
+        mark->mTail = mEnd;
+    }
+    unlock();
+}
+
+void JKRSolidHeap::do_freeFill(void) {
+    lock();
+    fillMemory(mSolidHead, mFreeSize, JKR_SOLID_HEAP_FILL);
+    unlock();
+}
+
+s32 JKRSolidHeap::do_resize(void* ptr, u32 size) {
+    OSReport("resize: cannot resize memory block (%08x: %d)\n", ptr, size);
+    return -1;
+}
+
+s32 JKRSolidHeap::do_getSize(void* ptr) {
+    OSReport("getSize: cannot get memory block size (%08x)\n", ptr);
+    return -1;
+}
+
+// Saves where the head and tail are, for rewind to go back to. mark belongs to the caller and has to stay put until
+// it's rewound or the heap is freed.
+void JKRSolidHeap::setMark(CMark* mark, u32 ends) {
+    lock();
+    mark->mEnds = ends & MARK_BOTH;
+    mark->mDepth = mMarkList != NULL ? mMarkList->mDepth + 1 : 0;
+    mark->mHead = mSolidHead;
+    mark->mTail = mSolidTail;
+    mark->mNext = mMarkList;
+    mMarkList = mark;
+    unlock();
+}
+
+// Gives back everything allocated from mark's ends since it was set, and unsets it and any marks set after it.
+// false if it isn't set, which it won't be after freeAll or after an outer mark was rewound.
+bool JKRSolidHeap::rewind(CMark* mark) {
+    CMark* inner;
+    u8* end;
+
+    lock();
+    for (inner = mMarkList; inner != NULL && inner != mark; inner = inner->mNext) {
+    }
+    if (inner == NULL) {
+        OSReport("rewind: mark %08x is not set\n", mark);
+        unlock();
+        return false;
+    }
+    for (inner = mMarkList; inner != mark; inner = inner->mNext) {
+        OSReport(":::mark %08x (depth %d) still set when rewinding %08x\n", inner, inner->mDepth, mark);
+    }
+    mMarkList = mark->mNext;
+
+    if ((mark->mEnds & MARK_HEAD) && mSolidHead != mark->mHead) {
+        end = mSolidHead;
+        dispose(mark->mHead, end);
+        if (JKRHeapProfiler::isActive()) {
+            JKRHeapProfiler::onFreeRange(this, mark->mHead, end);
+        }
+        mFreeSize += end - mark->mHead;
+        mSolidHead = mark->mHead;
+        if (getDebugFill()) {
+            fillMemory(mSolidHead, end - mSolidHead, JKR_SOLID_HEAP_FILL);
+        }
+    }
+    if ((mark->mEnds & MARK_TAIL) && mSolidTail != mark->mTail) {
+        end = mSolidTail;
+        dispose(end, mark->mTail);
+        if (JKRHeapProfiler::isActive()) {
+            JKRHeapProfiler::onFreeRange(this, end, mark->mTail);
+        }
+        mFreeSize += mark->mTail - end;
+        mSolidTail = mark->mTail;
+        if (getDebugFill()) {
+            fillMemory(end, mSolidTail - end, JKR_SOLID_HEAP_FILL);
+        }
+    }
+    unlock();
+    return true;
+}
+
+bool JKRSolidHeap::check(void) {
+    CMark* mark;
+    u8* head;
+    u8* tail;
+    u32 totalSize;
+    bool result;
+
+    lock();
+    result = true;
+    totalSize = (mSolidHead - mStart) + mFreeSize + (mEnd - mSolidTail);
+    if (totalSize != mSize) {
+        result = false;
+        OSReport("check: bad total memory block size (%08X, %08X)\n", mSize, totalSize);
+    }
+
+    // each mark lies within the one set before it
+    head = mSolidHead;
+    tail = mSolidTail;
+    for (mark = mMarkList; mark != NULL; mark = mark->mNext) {
+        if (mark->mHead < mStart || mark->mHead > head || mark->mTail < tail || mark->mTail > mEnd ||
+            mark->mDepth != (mark->mNext != NULL ? mark->mNext->mDepth + 1 : 0)) {
+            result = false;
+            OSReport("check: bad mark %08x (head %08x, tail %08x)\n", mark, mark->mHead, mark->mTail);
+            break;
+        }
+        head = mark->mHead;
+        tail = mark->mTail;
+    }
+    unlock();
+    return result;
+}
+
+bool JKRSolidHeap::dump(void) {
+    CMark* mark;
+    u32 headSize;
+    u32 tailSize;
+    bool result;
+
+    result = check();
+    lock();
+    headSize = mSolidHead - mStart;
+    tailSize = mEnd - mSolidTail;
+    OSReport("head %08x: %08x\n", mStart, headSize);
+    OSReport("tail %08x: %08x\n", mSolidTail, tailSize);
+    for (mark = mMarkList; mark != NULL; mark = mark->mNext) {
+        OSReport("mark %08x: %c%c %08x %08x  (depth %d)\n", mark, (mark->mEnds & MARK_HEAD) ? 'h' : '-',
+                 (mark->mEnds & MARK_TAIL) ? 't' : '-', mark->mHead, mark->mTail, mark->mDepth);
+    }
+    OSReport("%d / %d bytes (%6.2f%%) used\n", headSize + tailSize, mSize,
+             (f32)(headSize + tailSize) / (f32)mSize * 100.0f);
+    unlock();
+    return result;
+}
+
+void JKRSolidHeap::state_register(JKRHeap::TState* p, u32 id) const {
+    setState_u32ID_(p, id);
+    setState_uUsedSize_(p, getUsedSize((JKRSolidHeap*)this));
+    setState_u32CheckCode_(p, (u32)mSolidHead + (u32)mSolidTail * 3);
+}
+
+bool JKRSolidHeap::state_compare(JKRHeap::TState const& r1, JKRHeap::TState const& r2) const {
+    bool result = true;
+
+    if (r1.getCheckCode() != r2.getCheckCode()) {
+        result = false;
+    }
+    if (r1.getUsedSize() != r2.getUsedSize()) {
+        result = false;
+    }
+    return result;
+}
@@ -0,0 +1,313 @@
+#include "dolphin/arqx.h"
+#include "dolphin/ar.h"
+#include "dolphin/os.h"
+#include "macros.h"
+#include "string.h"
+
+static ARQXRequest* __ARQXQueue[ARQX_NUM_PRIORITIES];
+static ARQXRequest* __ARQXTail[ARQX_NUM_PRIORITIES];
+static ARQXRequest* __ARQXPending;
+static u32 __ARQXPendingLength;
+static OSTime __ARQXDMAStart;
+static OSTime __ARQXLatencyBound;
+static u32 __ARQXChunkSize;
+static u32 __ARQXCost; // running average of DMA ticks per KB, overhead included
+static ARQXStats __ARQXStats;
+static BOOL __ARQX_init_flag;
+
+static void __ARQXCallbackHack(u32 unused) {}
+
+// The chunk size is the amount the engine moves within the latency bound at the measured cost. Since the cost
+// includes the per-DMA overhead at the current size, repeated updates settle on the size that just fits.
+static void __ARQXUpdateChunkSize(void) {
+    u32 size;
+
+    if (__ARQXCost == 0) {
+        return;
+    }
+
+    size = (u32)((u64)__ARQXLatencyBound * 1024 / __ARQXCost);
+    size = ALIGN_PREV(size, 32);
+    __ARQXChunkSize = CLAMP(size, ARQX_CHUNK_SIZE_MIN, ARQX_CHUNK_SIZE_MAX);
+}
+
+static ARQXOwnerStats* __ARQXGetOwner(u32 owner) {
+    u32 i;
+
+    for (i = 0; i < __ARQXStats.numOwners; i++) {
+        if (__ARQXStats.owners[i].owner == owner) {
+            return &__ARQXStats.owners[i];
+        }
+    }
+
+    if (__ARQXStats.numOwners < ARQX_MAX_OWNERS) {
+        __ARQXStats.owners[__ARQXStats.numOwners].owner = owner;
+        return &__ARQXStats.owners[__ARQXStats.numOwners++];
+    }
+
+    return &__ARQXStats.owners[ARQX_MAX_OWNERS - 1];
+}
+
+static void __ARQXStartNext(void) {
+    ARQXRequest* request;
+    u32 length;
+    s32 priority;
+
+    request = NULL;
+    for (priority = ARQX_PRIORITY_HIGHEST; priority >= ARQX_PRIORITY_LOWEST; priority--) {
+        if (__ARQXQueue[priority] != NULL) {
+            request = __ARQXQueue[priority];
+            break;
+        }
+    }
+
+    __ARQXPending = request;
+    if (request == NULL) {
+        return;
+    }
+
+    // every transfer is cut at the chunk size, so a newly posted higher priority request waits at most one chunk
+    length = request->xferLength - request->offset;
+    if (length > __ARQXChunkSize) {
+        length = __ARQXChunkSize;
+    }
+
+    __ARQXPendingLength = length;
+    __ARQXDMAStart = OSGetTime();
+    if (request->request.type == ARAM_DIR_MRAM_TO_ARAM) {
+        ARStartDMA(request->request.type, request->request.source + request->offset,
+                   request->request.dest + request->offset, length);
+    } else {
+        ARStartDMA(request->request.type, request->request.dest + request->offset,
+                   request->request.source + request->offset, length);
+    }
+}
+
+static void __ARQXComplete(ARQXRequest* request, OSTime now) {
+    ARQXOwnerStats* owner;
+    OSTime latency;
+
+    owner = __ARQXGetOwner(request->request.owner);
+    latency = now - request->postTime;
+    owner->numCompleted++;
+    owner->totalLatency += latency;
+    if (latency > owner->maxLatency) {
+        owner->maxLatency = latency;
+    }
+
+    request->request.callback((u32)&request->request);
+}
+
+static void __ARQXInterruptServiceRoutine(void) {
+    ARQXRequest* request;
+    ARQXRequest* next;
+    ARQXOwnerStats* owner;
+    OSTime now;
+    OSTime elapsed;
+    u32 length;
+    u32 priority;
+    s32 cost;
+
+    request = __ARQXPending;
+    if (request == NULL) {
+        return;
+    }
+
+    now = OSGetTime();
+    elapsed = now - __ARQXDMAStart;
+    length = __ARQXPendingLength;
+
+    __ARQXStats.numDMAs++;
+    __ARQXStats.busyTicks += elapsed;
+    __ARQXStats.totalBytes += length;
+    owner = __ARQXGetOwner(request->request.owner);
+    owner->bytes[request->request.type & 1] += length;
+
+    if (length != 0) {
+        cost = (s32)(elapsed * 1024 / length);
+        __ARQXCost += (cost - (s32)__ARQXCost) >> 3;
+        __ARQXUpdateChunkSize();
+    }
+
+    request->offset += length;
+    __ARQXPending = NULL;
+    priority = request->priority;
+
+    // Complete every request whose own range is done. The first merged request takes over the queue slot and the
+    // rest of the transfer before the callback runs, so callbacks are free to repost their request.
+    while (request != NULL && request->offset >= request->request.length) {
+        next = request->merged;
+
+        if (next != NULL) {
+            next->request.next = request->request.next;
+            next->mergedTail = request->mergedTail != next ? request->mergedTail : NULL;
+            next->xferLength = request->xferLength - request->request.length;
+            next->offset = request->offset - request->request.length;
+            __ARQXQueue[priority] = next;
+            if (__ARQXTail[priority] == request) {
+                __ARQXTail[priority] = next;
+            }
+        } else {
+            __ARQXQueue[priority] = (ARQXRequest*)request->request.next;
+            if (__ARQXQueue[priority] == NULL) {
+                __ARQXTail[priority] = NULL;
+            }
+        }
+
+        __ARQXComplete(request, now);
+        request = next;
+    }
+
+    // a callback may already have started the next transfer
+    if (__ARQXPending == NULL) {
+        __ARQXStartNext();
+    }
+}
+
+void ARQXInit(u32 latencyBoundUs) {
+    s32 i;
+
+    if (__ARQX_init_flag == true) {
+        return;
+    }
+
+    for (i = 0; i < ARQX_NUM_PRIORITIES; i++) {
+        __ARQXQueue[i] = NULL;
+        __ARQXTail[i] = NULL;
+    }
+
+    __ARQXPending = NULL;
+    __ARQXChunkSize = ARQ_CHUNK_SIZE_DEFAULT;
+    memset(&__ARQXStats, 0, sizeof(__ARQXStats));
+    ARQXSetLatencyBound(latencyBoundUs != 0 ? latencyBoundUs : ARQX_LATENCY_BOUND_DEFAULT);
+
+    ARRegisterDMACallback(__ARQXInterruptServiceRoutine);
+    __ARQX_init_flag = true;
+}
+
+void ARQXPostRequest(ARQXRequest* request, u32 owner, u32 type, u32 priority, u32 source, u32 dest, u32 length,
+                     ARQCallback callback) {
+    ARQXRequest* tail;
+    ARQXOwnerStats* stats;
+    BOOL level;
+
+    request->request.next = NULL;
+    request->request.owner = owner;
+    request->request.type = type;
+    request->request.priority = priority;
+    request->request.source = source;
+    request->request.dest = dest;
+    request->request.length = length;
+    request->request.callback = callback != NULL ? callback : __ARQXCallbackHack;
+    request->merged = NULL;
+    request->mergedTail = NULL;
+    request->priority = priority < ARQX_NUM_PRIORITIES ? priority : ARQX_PRIORITY_HIGHEST;
+    request->xferLength = length;
+    request->offset = 0;
+
+    level = OSDisableInterrupts();
+    request->postTime = OSGetTime();
+    stats = __ARQXGetOwner(owner);
+    stats->numRequests++;
+
+    // a transfer that continues the last queued one of the same owner and direction extends it instead
+    tail = __ARQXTail[request->priority];
+    if (tail != NULL && tail->request.owner == owner && tail->request.type == type &&
+        tail->request.source + tail->xferLength == source && tail->request.dest + tail->xferLength == dest) {
+        tail->xferLength += length;
+        if (tail->mergedTail != NULL) {
+            tail->mergedTail->merged = request;
+        } else {
+            tail->merged = request;
+        }
+        tail->mergedTail = request;
+
+        stats->numMerged++;
+        __ARQXStats.numMerged++;
+    } else {
+        if (tail != NULL) {
+            tail->request.next = &request->request;
+        } else {
+            __ARQXQueue[request->priority] = request;
+        }
+        __ARQXTail[request->priority] = request;
+    }
+
+    if (__ARQXPending == NULL) {
+        __ARQXStartNext();
+    }
+    OSRestoreInterrupts(level);
+}
+
+void ARQXSetLatencyBound(u32 latencyBoundUs) {
+    BOOL level;
+
+    level = OSDisableInterrupts();
+    __ARQXLatencyBound = OSMicrosecondsToTicks((OSTime)latencyBoundUs);
+
+    // until a transfer has been measured, assume the current chunk size fits the bound exactly
+    if (__ARQXStats.numDMAs == 0) {
+        __ARQXCost = (u32)(__ARQXLatencyBound * 1024 / __ARQXChunkSize);
+    }
+    __ARQXUpdateChunkSize();
+    OSRestoreInterrupts(level);
+}
+
+u32 ARQXGetChunkSize(void) { return __ARQXChunkSize; }
+
+BOOL ARQXGetOwnerStats(u32 owner, ARQXOwnerStats* stats) {
+    BOOL level;
+    u32 i;
+
+    level = OSDisableInterrupts();
+    for (i = 0; i < __ARQXStats.numOwners; i++) {
+        if (__ARQXStats.owners[i].owner == owner) {
+            *stats = __ARQXStats.owners[i];
+            OSRestoreInterrupts(level);
+            return true;
+        }
+    }
+    OSRestoreInterrupts(level);
+
+    return false;
+}
+
+void ARQXGetStats(ARQXStats* stats) {
+    BOOL level;
+
+    level = OSDisableInterrupts();
+    *stats = __ARQXStats;
+    stats->chunkSize = __ARQXChunkSize;
+    OSRestoreInterrupts(level);
+}
+
+void ARQXResetStats(void) {
+    BOOL level;
+
+    level = OSDisableInterrupts();
+    memset(&__ARQXStats, 0, sizeof(__ARQXStats));
+    OSRestoreInterrupts(level);
+}
+
+void ARQXReport(void) {
+    ARQXStats stats;
+    ARQXOwnerStats* owner;
+    u32 busyUs;
+    u32 i;
+
+    ARQXGetStats(&stats);
+    busyUs = (u32)OSTicksToMicroseconds(stats.busyTicks);
+
+    OSReport("ARQX: %lu DMAs, %lu merged requests, chunk %lu bytes, %lu KB/s while busy\n", stats.numDMAs,
+             stats.numMerged, stats.chunkSize, busyUs != 0 ? (u32)(stats.totalBytes * 1000000 / 1024 / busyUs) : 0);
+
+    for (i = 0; i < stats.numOwners; i++) {
+        owner = &stats.owners[i];
+        OSReport("ARQX: owner %08lX: %lu requests (%lu merged, %lu completed), %lu KB to ARAM, %lu KB from ARAM, "
+                 "latency avg %lu us max %lu us\n",
+                 owner->owner, owner->numRequests, owner->numMerged, owner->numCompleted,
+                 owner->bytes[ARAM_DIR_MRAM_TO_ARAM] / 1024, owner->bytes[ARAM_DIR_ARAM_TO_MRAM] / 1024,
+                 owner->numCompleted != 0 ? (u32)OSTicksToMicroseconds(owner->totalLatency / owner->numCompleted) : 0,
+                 (u32)OSTicksToMicroseconds(owner->maxLatency));
+    }
+}
@@ -0,0 +1,477 @@
+#include "dolphin/dspx.h"
+#include "dolphin/hw_regs.h"
+#include "dolphin/os.h"
+#include "string.h"
+
+#define DSP_MAIL_INIT 0xDCD10000
+#define DSP_MAIL_RESUME 0xDCD10001
+#define DSP_MAIL_YIELD 0xDCD10002
+#define DSP_MAIL_DONE 0xDCD10003
+#define DSP_MAIL_REQUEST 0xDCD10004
+
+#define CPU_MAIL_SWITCH 0xCDD10001
+#define CPU_MAIL_HALT 0xCDD10002
+#define CPU_MAIL_CONTINUE 0xCDD10003
+
+#define MSG_BASE 0x80F30000
+
+static u32 __DSPXMail[DSPX_MAIL_QUEUE_SIZE];
+static u32 __DSPXMailHead;
+static u32 __DSPXMailCount;
+static u32 __DSPXMailPolls;
+static OSAlarm __DSPXMailAlarm;
+static BOOL __DSPXMailAlarmSet;
+static DSPTaskInfo* __DSPXBootTask; // waiting for the DSP's ready mail
+
+static OSTime __DSPXSwitchStart;
+static OSTime __DSPXRunStart;
+static DSPXStats __DSPXStats;
+static BOOL __DSPX_init_flag;
+
+static DSPXTaskStats* __DSPXGetTask(DSPTaskInfo* task) {
+    u32 i;
+
+    for (i = 0; i < __DSPXStats.numTasks; i++) {
+        if (__DSPXStats.tasks[i].task == task) {
+            return &__DSPXStats.tasks[i];
+        }
+    }
+
+    if (__DSPXStats.numTasks < DSPX_MAX_TASKS) {
+        __DSPXStats.tasks[__DSPXStats.numTasks].task = task;
+        return &__DSPXStats.tasks[__DSPXStats.numTasks++];
+    }
+
+    return &__DSPXStats.tasks[DSPX_MAX_TASKS - 1];
+}
+
+static void __DSPXPumpMail(void);
+static void __DSPX_boot_task(DSPTaskInfo* task);
+
+static void __DSPXMailAlarmHandler(OSAlarm* alarm, OSContext* context) {
+    __DSPXMailAlarmSet = false;
+    if (__DSPXBootTask != NULL) {
+        __DSPX_boot_task(__DSPXBootTask);
+    }
+    __DSPXPumpMail();
+}
+
+static void __DSPXSetMailAlarm(void) {
+    if (!__DSPXMailAlarmSet) {
+        __DSPXMailAlarmSet = true;
+        OSSetAlarm(&__DSPXMailAlarm, OSMicrosecondsToTicks(DSPX_MAIL_RETRY_US), __DSPXMailAlarmHandler);
+    }
+}
+
+// Feeds queued words to the mailbox while the DSP keeps taking them. Called with interrupts disabled.
+static void __DSPXPumpMail(void) {
+    u32 polls;
+
+    while (__DSPXMailCount != 0) {
+        for (polls = 0; DSPCheckMailToDSP() != 0; polls++) {
+            if (polls >= __DSPXMailPolls) {
+                if (!__DSPXMailAlarmSet) {
+                    __DSPXStats.numDeferred++;
+                    __DSPXSetMailAlarm();
+                }
+                return;
+            }
+        }
+
+        DSPSendMailToDSP(__DSPXMail[__DSPXMailHead]);
+        __DSPXMailHead = (__DSPXMailHead + 1) % DSPX_MAIL_QUEUE_SIZE;
+        __DSPXMailCount--;
+    }
+}
+
+// Called with interrupts disabled. The words of a task switch or boot always fit, DSPXSendMail leaves room for them
+// and the DSP takes them all before it asks for the next switch.
+static void __DSPXQueueMail(u32 mail) {
+    __DSPXMail[(__DSPXMailHead + __DSPXMailCount) % DSPX_MAIL_QUEUE_SIZE] = mail;
+    __DSPXMailCount++;
+    __DSPXStats.numMails++;
+
+    // words queued behind a pending alarm go out with it, in order
+    if (!__DSPXMailAlarmSet) {
+        __DSPXPumpMail();
+    }
+}
+
+// Returns false without queuing the word when only the room kept for the scheduler is left; the caller sends it
+// again once DSPXIsMailPending says the DSP has caught up.
+BOOL DSPXSendMail(u32 mail) {
+    BOOL old;
+
+    old = OSDisableInterrupts();
+    if (__DSPXMailCount >= DSPX_MAIL_QUEUE_SIZE - DSPX_MAIL_RESERVED) {
+        __DSPXStats.numRefused++;
+        OSRestoreInterrupts(old);
+        return false;
+    }
+
+    __DSPXQueueMail(mail);
+    OSRestoreInterrupts(old);
+    return true;
+}
+
+void DSPXSetMailPolls(u32 polls) { __DSPXMailPolls = polls; }
+
+BOOL DSPXIsMailPending(void) { return __DSPXMailCount != 0 || DSPCheckMailToDSP() != 0; }
+
+static void __DSPXTaskStarted(DSPTaskInfo* task, OSTime now) {
+    DSPXTaskStats* stats;
+    OSTime ticks;
+
+    stats = __DSPXGetTask(task);
+    if (__DSPXSwitchStart != 0) {
+        ticks = now - __DSPXSwitchStart;
+        stats->switchTicks += ticks;
+        if (ticks > stats->maxSwitchTicks) {
+            stats->maxSwitchTicks = ticks;
+        }
+        stats->numSwitches++;
+        __DSPXStats.numSwitches++;
+        __DSPXSwitchStart = 0;
+    }
+
+    stats->numRuns++;
+    __DSPXRunStart = now;
+}
+
+static void __DSPXTaskStopped(DSPTaskInfo* task, OSTime now) {
+    DSPXTaskStats* stats;
+    OSTime ticks;
+
+    if (__DSPXRunStart == 0) {
+        return;
+    }
+
+    stats = __DSPXGetTask(task);
+    ticks = now - __DSPXRunStart;
+    stats->runTicks += ticks;
+    if (ticks > stats->maxRunTicks) {
+        stats->maxRunTicks = ticks;
+    }
+    __DSPXRunStart = 0;
+}
+
+// __DSP_exec_task, queued
+static void __DSPX_exec_task(DSPTaskInfo* curr, DSPTaskInfo* next, OSTime now) {
+    __DSPXSwitchStart = now;
+
+    if (curr != NULL) {
+        __DSPXQueueMail((u32)curr->dram_mmem_addr);
+        __DSPXQueueMail(curr->dram_length);
+        __DSPXQueueMail(curr->dram_addr);
+    } else {
+        __DSPXQueueMail(0);
+        __DSPXQueueMail(0);
+        __DSPXQueueMail(0);
+    }
+
+    __DSPXQueueMail((u32)next->iram_mmem_addr);
+    __DSPXQueueMail(next->iram_length);
+    __DSPXQueueMail(next->iram_addr);
+
+    if (next->state == DSP_TASK_STATE_INIT) {
+        __DSPXQueueMail(next->dsp_init_vector);
+        __DSPXQueueMail(0);
+        __DSPXQueueMail(0);
+        __DSPXQueueMail(0);
+    } else {
+        __DSPXQueueMail(next->dsp_resume_vector);
+        __DSPXQueueMail((u32)next->dram_mmem_addr);
+        __DSPXQueueMail(next->dram_length);
+        __DSPXQueueMail(next->dram_addr);
+    }
+}
+
+// __DSP_boot_task, queued. Until the DSP has posted its ready mail, the retry alarm checks for it again instead of
+// the caller spinning on it.
+static void __DSPX_boot_task(DSPTaskInfo* task) {
+    if (!DSPCheckMailFromDSP()) {
+        __DSPXBootTask = task;
+        __DSPXSetMailAlarm();
+        return;
+    }
+    __DSPXBootTask = NULL;
+    DSPReadMailFromDSP();
+
+    __DSPXSwitchStart = OSGetTime();
+    __DSPXQueueMail(MSG_BASE | 0xA001);
+    __DSPXQueueMail((u32)task->iram_mmem_addr);
+    __DSPXQueueMail(MSG_BASE | 0xC002);
+    __DSPXQueueMail(task->iram_addr & 0xFFFF);
+    __DSPXQueueMail(MSG_BASE | 0xA002);
+    __DSPXQueueMail(task->iram_length);
+    __DSPXQueueMail(MSG_BASE | 0xB002);
+    __DSPXQueueMail(0);
+    __DSPXQueueMail(MSG_BASE | 0xD001);
+    __DSPXQueueMail((u32)(0xFFFF & task->dsp_init_vector));
+}
+
+static void __DSPXYield(DSPTaskInfo* task, OSTime now) {
+    DSPTaskInfo* next;
+
+    __DSPXTaskStopped(task, now);
+
+    if (__DSP_rude_task_pending) {
+        if (task == __DSP_rude_task) {
+            next = NULL;
+        } else {
+            next = __DSP_rude_task;
+        }
+        __DSP_rude_task = NULL;
+        __DSP_rude_task_pending = 0;
+    } else if (task->next != NULL) {
+        next = task->next;
+    } else if (task != __DSP_first_task) {
+        next = __DSP_first_task;
+    } else {
+        next = NULL;
+    }
+
+    // nothing else to run, the DSP carries on with the current task
+    if (next == NULL) {
+        __DSPXQueueMail(CPU_MAIL_CONTINUE);
+        __DSPXTaskStarted(task, now);
+        if (task->res_cb != NULL) {
+            task->res_cb(task);
+        }
+        return;
+    }
+
+    __DSPXQueueMail(CPU_MAIL_SWITCH);
+    __DSPX_exec_task(task, next, now);
+    task->state = DSP_TASK_STATE_YIELD;
+    __DSP_curr_task = next;
+}
+
+static void __DSPXDone(DSPTaskInfo* task, OSTime now) {
+    DSPTaskInfo* next;
+
+    __DSPXTaskStopped(task, now);
+
+    if (task->done_cb != NULL) {
+        task->done_cb(task);
+    }
+
+    if (__DSP_rude_task_pending) {
+        __DSPXQueueMail(CPU_MAIL_SWITCH);
+        __DSPX_exec_task(NULL, __DSP_rude_task, now);
+        __DSP_remove_task(task);
+        __DSP_curr_task = __DSP_rude_task;
+        __DSP_rude_task = NULL;
+        __DSP_rude_task_pending = 0;
+        return;
+    }
+
+    if (task->next == NULL && task == __DSP_first_task) {
+        __DSPXQueueMail(CPU_MAIL_HALT);
+        task->state = DSP_TASK_STATE_DONE;
+        __DSP_remove_task(task);
+        return;
+    }
+
+    next = task->next != NULL ? task->next : __DSP_first_task;
+    __DSPXQueueMail(CPU_MAIL_SWITCH);
+    task->state = DSP_TASK_STATE_DONE;
+    __DSPX_exec_task(NULL, next, now);
+    __DSP_remove_task(task);
+    __DSP_curr_task = next;
+}
+
+void __DSPXHandler(__OSInterrupt interrupt, OSContext* context) {
+    OSContext exceptionContext;
+    DSPTaskInfo* task;
+    OSTime start;
+    OSTime ticks;
+    u16 tmp;
+    u32 mail;
+
+    start = OSGetTime();
+
+    tmp = __DSPRegs[DSP_CONTROL_STATUS];
+    tmp = (tmp & ~0x28) | 0x80;
+    __DSPRegs[DSP_CONTROL_STATUS] = tmp;
+    OSClearContext(&exceptionContext);
+    OSSetCurrentContext(&exceptionContext);
+
+    // the DSP posts its mail before raising the interrupt, so this doesn't wait
+    while (DSPCheckMailFromDSP() == 0)
+        ;
+    mail = DSPReadMailFromDSP();
+
+    task = __DSP_curr_task;
+    if ((task->flags & DSP_TASK_FLAG_CANCEL) && mail == DSP_MAIL_YIELD) {
+        mail = DSP_MAIL_DONE;
+    }
+
+    switch (mail) {
+        case DSP_MAIL_INIT:
+            task->state = DSP_TASK_STATE_RUN;
+            __DSPXTaskStarted(task, start);
+            if (task->init_cb != NULL) {
+                task->init_cb(task);
+            }
+            break;
+        case DSP_MAIL_RESUME:
+            task->state = DSP_TASK_STATE_RUN;
+            __DSPXTaskStarted(task, start);
+            if (task->res_cb != NULL) {
+                task->res_cb(task);
+            }
+            break;
+        case DSP_MAIL_YIELD:
+            __DSPXYield(task, start);
+            break;
+        case DSP_MAIL_DONE:
+            __DSPXDone(task, start);
+            break;
+        case DSP_MAIL_REQUEST:
+            if (task->req_cb != NULL) {
+                task->req_cb(task);
+            }
+            break;
+    }
+
+    OSClearContext(&exceptionContext);
+    OSSetCurrentContext(context);
+
+    ticks = OSGetTime() - start;
+    __DSPXStats.numInterrupts++;
+    __DSPXStats.handlerTicks += ticks;
+    if (ticks > __DSPXStats.maxHandlerTicks) {
+        __DSPXStats.maxHandlerTicks = ticks;
+    }
+}
+
+void __DSPX_insert_task(DSPTaskInfo* task) {
+    DSPTaskInfo* temp;
+
+    if (__DSP_first_task == NULL) {
+        __DSP_first_task = __DSP_last_task = __DSP_curr_task = task;
+        task->next = task->prev = NULL;
+        return;
+    }
+
+    // tasks mostly come in at the same or a lower priority than the last one; skip the walk for them
+    if (task->priority >= __DSP_last_task->priority) {
+        __DSP_last_task->next = task;
+        task->next = NULL;
+        task->prev = __DSP_last_task;
+        __DSP_last_task = task;
+        return;
+    }
+
+    for (temp = __DSP_first_task; task->priority >= temp->priority; temp = temp->next)
+        ;
+
+    task->prev = temp->prev;
+    task->next = temp;
+    temp->prev = task;
+    if (task->prev == NULL) {
+        __DSP_first_task = task;
+    } else {
+        task->prev->next = task;
+    }
+}
+
+void DSPXInit(void) {
+    BOOL old;
+
+    if (__DSPX_init_flag == true) {
+        return;
+    }
+
+    DSPInit();
+
+    old = OSDisableInterrupts();
+    __OSSetInterruptHandler(__OS_INTERRUPT_DSP_DSP, __DSPXHandler);
+
+    __DSPXMailHead = 0;
+    __DSPXMailCount = 0;
+    __DSPXMailPolls = DSPX_MAIL_POLLS_DEFAULT;
+    __DSPXMailAlarmSet = false;
+    __DSPXBootTask = NULL;
+    OSCreateAlarm(&__DSPXMailAlarm);
+
+    __DSPXSwitchStart = 0;
+    __DSPXRunStart = 0;
+    memset(&__DSPXStats, 0, sizeof(__DSPXStats));
+    __DSPX_init_flag = true;
+    OSRestoreInterrupts(old);
+}
+
+DSPTaskInfo* DSPXAddTask(DSPTaskInfo* task) {
+    BOOL old;
+
+    old = OSDisableInterrupts();
+    __DSPX_insert_task(task);
+    task->state = DSP_TASK_STATE_INIT;
+    task->flags = DSP_TASK_FLAG_ATTACHED;
+
+    // a task that sorts first while another one runs is picked up at the next yield
+    if (task == __DSP_first_task && task == __DSP_last_task) {
+        __DSPX_boot_task(task);
+    }
+
+    OSRestoreInterrupts(old);
+    return task;
+}
+
+BOOL DSPXGetTaskStats(DSPTaskInfo* task, DSPXTaskStats* stats) {
+    BOOL old;
+    u32 i;
+
+    old = OSDisableInterrupts();
+    for (i = 0; i < __DSPXStats.numTasks; i++) {
+        if (__DSPXStats.tasks[i].task == task) {
+            *stats = __DSPXStats.tasks[i];
+            OSRestoreInterrupts(old);
+            return true;
+        }
+    }
+    OSRestoreInterrupts(old);
+
+    return false;
+}
+
+void DSPXGetStats(DSPXStats* stats) {
+    BOOL old;
+
+    old = OSDisableInterrupts();
+    *stats = __DSPXStats;
+    OSRestoreInterrupts(old);
+}
+
+void DSPXResetStats(void) {
+    BOOL old;
+
+    old = OSDisableInterrupts();
+    memset(&__DSPXStats, 0, sizeof(__DSPXStats));
+    OSRestoreInterrupts(old);
+}
+
+void DSPXReport(void) {
+    DSPXStats stats;
+    DSPXTaskStats* task;
+    u32 i;
+
+    DSPXGetStats(&stats);
+
+    OSReport("DSPX: %lu interrupts, %lu switches, %lu mails (%lu deferred, %lu refused), "
+             "handler avg %lu us max %lu us\n",
+             stats.numInterrupts, stats.numSwitches, stats.numMails, stats.numDeferred, stats.numRefused,
+             stats.numInterrupts != 0 ? (u32)OSTicksToMicroseconds(stats.handlerTicks / stats.numInterrupts) : 0,
+             (u32)OSTicksToMicroseconds(stats.maxHandlerTicks));
+
+    for (i = 0; i < stats.numTasks; i++) {
+        task = &stats.tasks[i];
+        OSReport("DSPX: task %08lX: %lu runs, %lu us running (max %lu us), switch in avg %lu us max %lu us\n",
+                 (u32)task->task, task->numRuns, (u32)OSTicksToMicroseconds(task->runTicks),
+                 (u32)OSTicksToMicroseconds(task->maxRunTicks),
+                 task->numSwitches != 0 ? (u32)OSTicksToMicroseconds(task->switchTicks / task->numSwitches) : 0,
+                 (u32)OSTicksToMicroseconds(task->maxSwitchTicks));
+    }
+}
@@ -0,0 +1,367 @@
+#include "dolphin/ar.h"
+#include "dolphin/dvd.h"
+#include "dolphin/gx.h"
+#include "dolphin/os.h"
+#include "dolphin/tex.h"
+#include "macros.h"
+#include "string.h"
+
+#define PALETTE_VERSION 0x20AF30
+
+// Guess for the metadata block size: palette header, descriptor array and one texture and CLUT header per
+// descriptor. This is the layout TexConv emits, other layouts cost one extra read.
+#define TEX_LOADER_HEADER_GUESS(n) \
+    ALIGN_NEXT(sizeof(TEXPalette) + (n) * (sizeof(TEXDescriptor) + sizeof(TEXHeader) + sizeof(CLUTHeader)), 32)
+
+// Runs from the ARAM interrupt; the loader waiting in __TEXLoaderRead sleeps on its own queue until then
+static void __TEXLoaderARQCallback(u32 request) {
+    TEXLoader* loader = (TEXLoader*)((ARQRequest*)request)->owner;
+
+    OSSendMessage(&loader->arqQueue, (OSMessage)request, OS_MESSAGE_NOBLOCK);
+}
+
+static BOOL __TEXLoaderRead(TEXLoader* loader, void* dst, u32 length, u32 offset) {
+    OSMessage message;
+
+    // both DVD and ARAM DMA work on 32-byte granules
+    length = ALIGN_NEXT(length, 32);
+    DCInvalidateRange(dst, length);
+
+    if (loader->source == TEX_LOADER_SOURCE_DVD) {
+        return DVDReadPrio(loader->fileInfo, dst, length, offset, 2) >= 0;
+    }
+
+    ARQPostRequest(&loader->arqRequest, (u32)loader, ARAM_DIR_ARAM_TO_MRAM, ARQ_PRIORITY_HIGH,
+                   loader->aramAddr + offset, (u32)dst, length, __TEXLoaderARQCallback);
+    OSReceiveMessage(&loader->arqQueue, &message, OS_MESSAGE_BLOCK);
+    return true;
+}
+
+static void* __TEXLoaderAllocTracked(TEXLoader* loader, u32 size) {
+    void* ptr = loader->alloc(size);
+
+    if (ptr != NULL) {
+        loader->stats.residentSize += size;
+        if (loader->stats.residentSize > loader->stats.peakSize) {
+            loader->stats.peakSize = loader->stats.residentSize;
+        }
+    }
+
+    return ptr;
+}
+
+static void __TEXLoaderFreeTracked(TEXLoader* loader, void* ptr, u32 size) {
+    if (ptr != NULL) {
+        loader->free(ptr);
+        loader->stats.residentSize -= size;
+    }
+}
+
+static u32 __TEXLoaderImageSize(TEXHeader* header) {
+    u32 size;
+    u32 level;
+    u32 numLevels;
+    u16 width;
+    u16 height;
+    u32 tilesX;
+    u32 tilesY;
+    u32 cacheLines;
+
+    size = 0;
+    width = header->width;
+    height = header->height;
+    numLevels = header->maxLOD - header->minLOD + 1;
+
+    for (level = 0; level < numLevels; level++) {
+        __GetImageTileCount((GXTexFmt)header->format, width, height, &tilesX, &tilesY, &cacheLines);
+        size += tilesX * tilesY * cacheLines * 32;
+
+        if (width > 1) {
+            width >>= 1;
+        }
+        if (height > 1) {
+            height >>= 1;
+        }
+    }
+
+    return size;
+}
+
+// Relocates the descriptor array and headers in place. Data pointers are left as file offsets until the
+// descriptor is made resident. Returns false if a header lies outside the loaded block.
+static BOOL __TEXLoaderRelocate(TEXLoader* loader, u32 headerSize) {
+    TEXPalette* pal;
+    TEXDescriptor* tdp;
+    TEXLoaderEntry* entry;
+    u32 i;
+
+    pal = loader->palette;
+
+    for (i = 0; i < pal->numDescriptors; i++) {
+        tdp = &pal->descriptorArray[i];
+        entry = &loader->entries[i];
+
+        if (tdp->textureHeader != NULL) {
+            if ((u32)tdp->textureHeader + sizeof(TEXHeader) > headerSize) {
+                return false;
+            }
+
+            tdp->textureHeader = (TEXHeader*)((u32)tdp->textureHeader + (u32)pal);
+            entry->imageOffset = (u32)tdp->textureHeader->data;
+            tdp->textureHeader->data = NULL;
+            tdp->textureHeader->unpacked = false;
+        }
+
+        if (tdp->CLUTHeader != NULL) {
+            if ((u32)tdp->CLUTHeader + sizeof(CLUTHeader) > headerSize) {
+                return false;
+            }
+
+            tdp->CLUTHeader = (CLUTHeader*)((u32)tdp->CLUTHeader + (u32)pal);
+            entry->clutOffset = (u32)tdp->CLUTHeader->data;
+            tdp->CLUTHeader->data = NULL;
+            tdp->CLUTHeader->unpacked = false;
+        }
+    }
+
+    return true;
+}
+
+static BOOL __TEXLoaderOpen(TEXLoader* loader, u32 length) {
+    u8 header[32] ATTRIBUTE_ALIGN(32);
+    TEXPalette* pal;
+    OSTime start;
+    u32 numDescriptors;
+    u32 descOffset;
+    u32 headerSize;
+    u32 i;
+
+    start = OSGetTime();
+    loader->palette = NULL;
+    loader->entries = NULL;
+    loader->stats.fileSize = ALIGN_NEXT(length, 32);
+    loader->stats.residentSize = 0;
+    loader->stats.peakSize = 0;
+    loader->stats.numFetches = 0;
+    loader->stats.numEvictions = 0;
+    loader->stats.fetchTime = 0;
+
+    if (!__TEXLoaderRead(loader, header, sizeof(header), 0)) {
+        return false;
+    }
+
+    pal = (TEXPalette*)header;
+    if (pal->versionNumber != PALETTE_VERSION) {
+        OSReport("TEXLoader: invalid version number for texture palette\n");
+        return false;
+    }
+
+    // both come from the file, check them before they size any allocation
+    numDescriptors = pal->numDescriptors;
+    descOffset = (u32)pal->descriptorArray;
+    if (descOffset < sizeof(TEXPalette) || descOffset > loader->stats.fileSize ||
+        numDescriptors > (loader->stats.fileSize - descOffset) / sizeof(TEXDescriptor)) {
+        OSReport("TEXLoader: descriptor array lies outside the file\n");
+        return false;
+    }
+
+    headerSize = MAX(TEX_LOADER_HEADER_GUESS(numDescriptors),
+                     ALIGN_NEXT(descOffset + numDescriptors * sizeof(TEXDescriptor), 32));
+
+    loader->entries = __TEXLoaderAllocTracked(loader, numDescriptors * sizeof(TEXLoaderEntry));
+    if (loader->entries == NULL) {
+        return false;
+    }
+
+    for (i = 0; i < 2; i++) {
+        headerSize = MIN(headerSize, loader->stats.fileSize);
+        loader->palette = __TEXLoaderAllocTracked(loader, headerSize);
+        if (loader->palette == NULL) {
+            break;
+        }
+
+        if (!__TEXLoaderRead(loader, loader->palette, headerSize, 0)) {
+            break;
+        }
+
+        loader->palette->descriptorArray = (TEXDescriptor*)(descOffset + (u32)loader->palette);
+        memset(loader->entries, 0, numDescriptors * sizeof(TEXLoaderEntry));
+
+        if (__TEXLoaderRelocate(loader, headerSize)) {
+            loader->stats.headerSize = headerSize;
+            loader->stats.openTime = OSGetTime() - start;
+            return true;
+        }
+
+        // headers are not packed behind the descriptor array, fall back to loading the whole file
+        __TEXLoaderFreeTracked(loader, loader->palette, headerSize);
+        loader->palette = NULL;
+        headerSize = loader->stats.fileSize;
+    }
+
+    __TEXLoaderFreeTracked(loader, loader->palette, headerSize);
+    __TEXLoaderFreeTracked(loader, loader->entries, numDescriptors * sizeof(TEXLoaderEntry));
+    loader->palette = NULL;
+    loader->entries = NULL;
+    return false;
+}
+
+BOOL TEXLoaderOpenDVD(TEXLoader* loader, DVDFileInfo* fileInfo, TEXLoaderAlloc alloc, TEXLoaderFree free) {
+    loader->source = TEX_LOADER_SOURCE_DVD;
+    loader->fileInfo = fileInfo;
+    loader->aramAddr = 0;
+    loader->alloc = alloc;
+    loader->free = free;
+    return __TEXLoaderOpen(loader, fileInfo->length);
+}
+
+BOOL TEXLoaderOpenARAM(TEXLoader* loader, u32 aramAddr, u32 length, TEXLoaderAlloc alloc, TEXLoaderFree free) {
+    loader->source = TEX_LOADER_SOURCE_ARAM;
+    loader->fileInfo = NULL;
+    loader->aramAddr = aramAddr;
+    loader->alloc = alloc;
+    loader->free = free;
+    OSInitMessageQueue(&loader->arqQueue, &loader->arqMessage, 1);
+    return __TEXLoaderOpen(loader, length);
+}
+
+void TEXLoaderClose(TEXLoader* loader) {
+    u32 i;
+
+    if (loader->palette == NULL) {
+        return;
+    }
+
+    for (i = 0; i < loader->palette->numDescriptors; i++) {
+        TEXLoaderEvict(loader, i);
+    }
+
+    __TEXLoaderFreeTracked(loader, loader->entries, loader->palette->numDescriptors * sizeof(TEXLoaderEntry));
+    __TEXLoaderFreeTracked(loader, loader->palette, loader->stats.headerSize);
+    loader->palette = NULL;
+    loader->entries = NULL;
+}
+
+TEXDescriptor* TEXLoaderGet(TEXLoader* loader, u32 id) {
+    TEXDescriptor* tdp;
+    TEXLoaderEntry* entry;
+    OSTime start;
+    u32 offset;
+    u32 size;
+    u32 clutSize;
+
+    tdp = TEXGet(loader->palette, id);
+    entry = &loader->entries[id];
+
+    if (entry->flags & TEX_LOADER_ENTRY_RESIDENT) {
+        return tdp;
+    }
+
+    start = OSGetTime();
+
+    if (tdp->textureHeader != NULL) {
+        offset = entry->imageOffset & 0x1F;
+        size = ALIGN_NEXT(offset + __TEXLoaderImageSize(tdp->textureHeader), 32);
+        entry->imageBuffer = __TEXLoaderAllocTracked(loader, size);
+
+        if (entry->imageBuffer == NULL ||
+            !__TEXLoaderRead(loader, entry->imageBuffer, size, entry->imageOffset - offset)) {
+            OSReport("TEXLoader: failed to fetch image %d\n", id);
+            __TEXLoaderFreeTracked(loader, entry->imageBuffer, size);
+            entry->imageBuffer = NULL;
+            return NULL;
+        }
+
+        entry->residentSize = size;
+        tdp->textureHeader->data = (char*)entry->imageBuffer + offset;
+        tdp->textureHeader->unpacked = true;
+    }
+
+    if (tdp->CLUTHeader != NULL) {
+        offset = entry->clutOffset & 0x1F;
+        clutSize = ALIGN_NEXT(offset + tdp->CLUTHeader->numEntries * sizeof(u16), 32);
+        entry->clutBuffer = __TEXLoaderAllocTracked(loader, clutSize);
+
+        if (entry->clutBuffer == NULL ||
+            !__TEXLoaderRead(loader, entry->clutBuffer, clutSize, entry->clutOffset - offset)) {
+            OSReport("TEXLoader: failed to fetch CLUT %d\n", id);
+            __TEXLoaderFreeTracked(loader, entry->clutBuffer, clutSize);
+            entry->clutBuffer = NULL;
+            entry->flags |= TEX_LOADER_ENTRY_RESIDENT;
+            TEXLoaderEvict(loader, id);
+            return NULL;
+        }
+
+        entry->residentSize += clutSize;
+        tdp->CLUTHeader->data = (char*)entry->clutBuffer + offset;
+        tdp->CLUTHeader->unpacked = true;
+    }
+
+    entry->flags |= TEX_LOADER_ENTRY_RESIDENT;
+    loader->stats.numFetches++;
+    loader->stats.fetchTime += OSGetTime() - start;
+    return tdp;
+}
+
+GXTexObj* TEXLoaderGetGXTexObj(TEXLoader* loader, u32 id) {
+    TEXLoaderEntry* entry = &loader->entries[id];
+
+    // CLUT-only descriptors have no texture to make an object of
+    if (TEXGet(loader->palette, id)->textureHeader == NULL) {
+        return NULL;
+    }
+
+    if (!(entry->flags & TEX_LOADER_ENTRY_TEXOBJ)) {
+        if (TEXLoaderGet(loader, id) == NULL) {
+            return NULL;
+        }
+
+        TEXGetGXTexObjFromPalette(loader->palette, &entry->texObj, id);
+        entry->flags |= TEX_LOADER_ENTRY_TEXOBJ;
+    }
+
+    return &entry->texObj;
+}
+
+void TEXLoaderEvict(TEXLoader* loader, u32 id) {
+    TEXDescriptor* tdp;
+    TEXLoaderEntry* entry;
+
+    tdp = TEXGet(loader->palette, id);
+    entry = &loader->entries[id];
+
+    if (!(entry->flags & TEX_LOADER_ENTRY_RESIDENT)) {
+        return;
+    }
+
+    if (entry->imageBuffer != NULL) {
+        loader->free(entry->imageBuffer);
+        tdp->textureHeader->data = NULL;
+        tdp->textureHeader->unpacked = false;
+    }
+
+    if (entry->clutBuffer != NULL) {
+        loader->free(entry->clutBuffer);
+        tdp->CLUTHeader->data = NULL;
+        tdp->CLUTHeader->unpacked = false;
+    }
+
+    loader->stats.residentSize -= entry->residentSize;
+    loader->stats.numEvictions++;
+    entry->imageBuffer = NULL;
+    entry->clutBuffer = NULL;
+    entry->residentSize = 0;
+    entry->flags = 0;
+}
+
+void TEXLoaderGetStats(TEXLoader* loader, TEXLoaderStats* stats) { *stats = loader->stats; }
+
+void TEXLoaderReportStats(TEXLoader* loader) {
+    TEXLoaderStats* stats = &loader->stats;
+
+    OSReport("TEXLoader: open %lu us, %lu fetches in %lu us, %lu evictions\n",
+             (u32)OSTicksToMicroseconds(stats->openTime), stats->numFetches,
+             (u32)OSTicksToMicroseconds(stats->fetchTime), stats->numEvictions);
+    OSReport("TEXLoader: header %lu bytes, resident %lu bytes, peak %lu bytes (full load %lu bytes)\n",
+             stats->headerSize, stats->residentSize, stats->peakSize, stats->fileSize);
+}
@@ -0,0 +1,297 @@
+#include "menu/dtkQueue.hpp"
+#include "macros.h"
+#include "string.h"
+
+static DTKQueue* sQueue;
+
+static void dtqAlarmHandler(OSAlarm* alarm, OSContext* context);
+
+static inline DTQSlot* dtqGetTrack(DTKQueue* queue, u32 index) {
+    return queue->ring[(queue->head + index) % queue->capacity];
+}
+
+static void dtqArmAlarm(DTKQueue* queue) {
+    if (!queue->alarmSet) {
+        queue->alarmSet = true;
+        OSSetAlarm(&queue->alarm, OSMicrosecondsToTicks(DTQ_RETRY_US), dtqAlarmHandler);
+    }
+}
+
+// called with interrupts disabled
+static void dtqApplyState(DTKQueue* queue) {
+    if (queue->pendingState == DTQ_STATE_NONE) {
+        return;
+    }
+
+    if (DTKGetState() == DTK_STATE_BUSY) {
+        dtqArmAlarm(queue);
+        return;
+    }
+
+    if (DTKGetCurrentTrack() != NULL) {
+        DTKSetState(queue->pendingState);
+    }
+    queue->pendingState = DTQ_STATE_NONE;
+}
+
+// DTK still links ended tracks until they are removed, which can't be done from inside its callback
+static void dtqReap(DTKQueue* queue) {
+    DTQSlot* slot;
+
+    while (queue->endedList != NULL) {
+        slot = queue->endedList;
+        queue->endedList = slot->next;
+
+        DTKRemoveTrack(&slot->track);
+        slot->next = queue->freeList;
+        queue->freeList = slot;
+    }
+}
+
+static void dtqAlarmHandler(OSAlarm* alarm, OSContext* context) {
+    DTKQueue* queue = sQueue;
+
+    queue->alarmSet = false;
+    dtqReap(queue);
+    dtqApplyState(queue);
+}
+
+static void dtqPrepareCallback(s32 result, DVDFileInfo* fileInfo) { sQueue->preparing = false; }
+
+// Puts the stream after the current one on the drive while the current one plays
+static void dtqPrepareNext(DTKQueue* queue) {
+    DTQSlot* next;
+
+    if (queue->count < 2 || queue->preparing) {
+        return;
+    }
+
+    next = dtqGetTrack(queue, 1);
+    queue->prepareFile.startAddr = next->track.dvdFileInfo.startAddr;
+    queue->prepareFile.length = next->track.dvdFileInfo.length;
+    queue->preparing = true;
+    if (DVDPrepareStreamAsync(&queue->prepareFile, 0, 0, dtqPrepareCallback)) {
+        queue->stats.numPrepared++;
+    } else {
+        queue->preparing = false;
+    }
+}
+
+static void dtqEventCallback(u32 eventMask) {
+    DTKQueue* queue = sQueue;
+    DTQSlot* slot;
+    OSTime gap;
+
+    slot = queue->count != 0 ? dtqGetTrack(queue, 0) : NULL;
+
+    if (eventMask & DTK_EVENT_TRACK_ENDED) {
+        queue->endTime = OSGetTime();
+        queue->stats.numEnded++;
+
+        if (slot != NULL) {
+            queue->head = (queue->head + 1) % queue->capacity;
+            queue->count--;
+            slot->next = queue->endedList;
+            queue->endedList = slot;
+            dtqArmAlarm(queue);
+
+            if (slot->callback != NULL && (slot->eventMask & DTK_EVENT_TRACK_ENDED)) {
+                slot->callback(DTK_EVENT_TRACK_ENDED);
+            }
+        }
+
+        eventMask &= ~DTK_EVENT_TRACK_ENDED;
+        slot = queue->count != 0 ? dtqGetTrack(queue, 0) : NULL;
+    }
+
+    if (eventMask & DTK_EVENT_PLAYBACK_STARTED) {
+        if (queue->endTime != 0) {
+            gap = OSGetTime() - queue->endTime;
+            queue->stats.numGaps++;
+            queue->stats.totalGap += gap;
+            if (gap > queue->stats.maxGap) {
+                queue->stats.maxGap = gap;
+            }
+            queue->endTime = 0;
+        }
+        dtqPrepareNext(queue);
+    }
+
+    if (slot != NULL && slot->callback != NULL && (slot->eventMask & eventMask)) {
+        slot->callback(slot->eventMask & eventMask);
+    }
+
+    dtqApplyState(queue);
+}
+
+// Doubles the number of slots from capacity, unless the queue grew in the meantime. The old slots stay where they are
+// since DTK links them, so the new slots come in an allocation of their own that is never freed; only the ring of
+// pointers is copied, and a ring dtqGrow allocated itself is freed once it's replaced. The heap is only used with
+// interrupts enabled, so it's called without them disabled.
+static void dtqGrow(DTKQueue* queue, u32 capacity) {
+    DTQSlot** ring;
+    DTQSlot** oldRing;
+    DTQSlot* slots;
+    BOOL level;
+    u32 i;
+
+    if (queue->alloc == NULL) {
+        return;
+    }
+
+    ring = (DTQSlot**)queue->alloc(capacity * 2 * sizeof(DTQSlot*));
+    if (ring == NULL) {
+        return;
+    }
+
+    slots = (DTQSlot*)queue->alloc(capacity * sizeof(DTQSlot));
+    if (slots == NULL) {
+        if (queue->free != NULL) {
+            queue->free(ring);
+        }
+        return;
+    }
+
+    level = OSDisableInterrupts();
+    if (queue->capacity != capacity) {
+        OSRestoreInterrupts(level);
+        if (queue->free != NULL) {
+            queue->free(slots);
+            queue->free(ring);
+        }
+        return;
+    }
+
+    for (i = 0; i < queue->count; i++) {
+        ring[i] = dtqGetTrack(queue, i);
+    }
+    for (i = 0; i < capacity; i++) {
+        slots[i].next = queue->freeList;
+        queue->freeList = &slots[i];
+    }
+
+    oldRing = queue->ringAllocated ? queue->ring : NULL;
+    queue->ring = ring;
+    queue->head = 0;
+    queue->capacity = capacity * 2;
+    queue->ringAllocated = true;
+    queue->stats.numGrown++;
+    OSRestoreInterrupts(level);
+
+    if (oldRing != NULL && queue->free != NULL) {
+        queue->free(oldRing);
+    }
+}
+
+void dtqInit(DTKQueue* queue, DTQSlot** ring, DTQSlot* slots, u32 count, DTQAlloc alloc, DTQFree free) {
+    u32 i;
+
+    queue->ring = ring;
+    queue->capacity = count;
+    queue->head = 0;
+    queue->count = 0;
+    queue->freeList = NULL;
+    queue->endedList = NULL;
+    queue->alloc = alloc;
+    queue->free = free;
+    queue->ringAllocated = false;
+    queue->pendingState = DTQ_STATE_NONE;
+    queue->alarmSet = false;
+    queue->preparing = false;
+    queue->endTime = 0;
+    memset(&queue->prepareFile, 0, sizeof(queue->prepareFile));
+    memset(&queue->stats, 0, sizeof(queue->stats));
+    OSCreateAlarm(&queue->alarm);
+
+    for (i = 0; i < count; i++) {
+        slots[i].next = queue->freeList;
+        queue->freeList = &slots[i];
+    }
+
+    sQueue = queue;
+    DTKSetRepeatMode(DTK_MODE_NOREPEAT);
+}
+
+u32 dtqAddTrack(DTKQueue* queue, char* fileName, u32 eventMask, DTKCallback callback) {
+    DTQSlot* slot;
+    BOOL level;
+    BOOL full;
+    u32 capacity;
+    u32 ret;
+
+    level = OSDisableInterrupts();
+    dtqReap(queue);
+    full = queue->freeList == NULL;
+    capacity = queue->capacity;
+    OSRestoreInterrupts(level);
+
+    if (full) {
+        dtqGrow(queue, capacity);
+    }
+
+    level = OSDisableInterrupts();
+    if (queue->freeList == NULL) {
+        queue->stats.numFull++;
+        OSRestoreInterrupts(level);
+        return DTQ_ERROR_FULL;
+    }
+
+    slot = queue->freeList;
+    queue->freeList = slot->next;
+    slot->callback = callback;
+    slot->eventMask = eventMask;
+
+    ret = DTKQueueTrack(fileName, &slot->track, DTK_EVENT_TRACK_QUEUED | DTK_EVENT_PLAYBACK_STARTED |
+                                                     DTK_EVENT_PLAYBACK_STOPPED | DTK_EVENT_PLAYBACK_PAUSED |
+                                                     DTK_EVENT_PLAYBACK_RESUMED | DTK_EVENT_TRACK_ENDED,
+                        dtqEventCallback);
+    if (ret != 0) {
+        slot->next = queue->freeList;
+        queue->freeList = slot;
+        OSRestoreInterrupts(level);
+        return ret;
+    }
+
+    queue->ring[(queue->head + queue->count) % queue->capacity] = slot;
+    queue->count++;
+    queue->stats.numQueued++;
+
+    // the track after the playing one just arrived
+    if (queue->count == 2 && DTKGetState() == DTK_STATE_RUN) {
+        dtqPrepareNext(queue);
+    }
+
+    OSRestoreInterrupts(level);
+    return 0;
+}
+
+void dtqSetState(DTKQueue* queue, u32 state) {
+    BOOL level;
+
+    level = OSDisableInterrupts();
+    queue->pendingState = state;
+    if (DTKGetState() == DTK_STATE_BUSY) {
+        queue->stats.numDeferred++;
+    }
+    dtqApplyState(queue);
+    OSRestoreInterrupts(level);
+}
+
+void dtqGetStats(DTKQueue* queue, DTQStats* stats) {
+    BOOL level;
+
+    level = OSDisableInterrupts();
+    *stats = queue->stats;
+    OSRestoreInterrupts(level);
+}
+
+void dtqReport(DTKQueue* queue) {
+    DTQStats stats;
+
+    dtqGetStats(queue, &stats);
+    OSReport("DTQ: %lu queued, %lu ended, %lu prepared ahead, grown %lu times, %lu full, %lu deferred state changes\n",
+             stats.numQueued, stats.numEnded, stats.numPrepared, stats.numGrown, stats.numFull, stats.numDeferred);
+    OSReport("DTQ: gap between tracks avg %lu ms max %lu ms over %lu transitions\n",
+             stats.numGaps != 0 ? (u32)OSTicksToMilliseconds(stats.totalGap / stats.numGaps) : 0,
+             (u32)OSTicksToMilliseconds(stats.maxGap), stats.numGaps);
+}
@@ -0,0 +1,129 @@
+#include "menu/framePacer.hpp"
+#include "macros.h"
+
+static void fpClearStats(FramePacerStats* stats) {
+    s32 i;
+
+    stats->numFrames = 0;
+    stats->numPresented = 0;
+    stats->numMissed = 0;
+    stats->longestMissRun = 0;
+    stats->numBufferSwitches = 0;
+
+    for (i = 0; i < FP_HISTOGRAM_SIZE; i++) {
+        stats->intervalHistogram[i] = 0;
+        stats->jitterHistogram[i] = 0;
+    }
+}
+
+void fpInit(FramePacer* pacer, s64 fieldPeriod) {
+    pacer->fieldPeriod = fieldPeriod;
+    pacer->lastRetrace = -1;
+    pacer->frameStart = 0;
+    pacer->windowCount = 0;
+    pacer->windowIndex = 0;
+    pacer->numBuffers = 2;
+    pacer->numQueued = 0;
+    pacer->missRun = 0;
+    pacer->drawPending = false;
+    fpClearStats(&pacer->stats);
+}
+
+void fpRetrace(FramePacer* pacer, s64 time) {
+    s64 bucket;
+
+    if (pacer->lastRetrace >= 0) {
+        bucket = (((time - pacer->lastRetrace - pacer->fieldPeriod) << FP_JITTER_BUCKET_SHIFT) / pacer->fieldPeriod) +
+                 (FP_HISTOGRAM_SIZE / 2);
+        pacer->stats.jitterHistogram[CLAMP(bucket, 0, FP_HISTOGRAM_SIZE - 1)]++;
+    }
+
+    pacer->lastRetrace = time;
+
+    // the oldest finished frame goes on display; with none finished the field shows the previous frame again
+    if (pacer->numQueued != 0) {
+        pacer->numQueued--;
+        pacer->stats.numPresented++;
+        pacer->missRun = 0;
+    } else if (pacer->drawPending) {
+        pacer->stats.numMissed++;
+        pacer->missRun++;
+
+        if (pacer->missRun > pacer->stats.longestMissRun) {
+            pacer->stats.longestMissRun = pacer->missRun;
+        }
+    }
+}
+
+BOOL fpCanBeginFrame(FramePacer* pacer) { return !pacer->drawPending && pacer->numQueued + 2 <= pacer->numBuffers; }
+
+void fpBeginFrame(FramePacer* pacer, s64 time) {
+    pacer->frameStart = time;
+    pacer->drawPending = true;
+}
+
+void fpDrawDone(FramePacer* pacer, s64 time) {
+    s64 interval;
+    s64 worst;
+    s64 bucket;
+
+    if (!pacer->drawPending) {
+        return;
+    }
+
+    interval = time - pacer->frameStart;
+    pacer->drawPending = false;
+    pacer->numQueued++;
+    pacer->stats.numFrames++;
+
+    bucket = (interval << FP_INTERVAL_BUCKET_SHIFT) / pacer->fieldPeriod;
+    pacer->stats.intervalHistogram[CLAMP(bucket, 0, FP_HISTOGRAM_SIZE - 1)]++;
+
+    pacer->window[pacer->windowIndex] = interval;
+    pacer->windowIndex = (pacer->windowIndex + 1) % FP_WINDOW_SIZE;
+    if (pacer->windowCount < FP_WINDOW_SIZE) {
+        pacer->windowCount++;
+    }
+
+    worst = fpGetWorstInterval(pacer);
+
+    if (pacer->numBuffers == 2 && worst > FP_TRIPLE_THRESHOLD(pacer->fieldPeriod)) {
+        pacer->numBuffers = 3;
+        pacer->stats.numBufferSwitches++;
+    } else if (pacer->numBuffers == 3 && pacer->windowCount == FP_WINDOW_SIZE &&
+               worst < FP_DOUBLE_THRESHOLD(pacer->fieldPeriod)) {
+        pacer->numBuffers = 2;
+        pacer->stats.numBufferSwitches++;
+    }
+}
+
+u32 fpGetNumBuffers(FramePacer* pacer) { return pacer->numBuffers; }
+
+s64 fpGetWorstInterval(FramePacer* pacer) {
+    s64 worst;
+    u32 i;
+
+    worst = 0;
+    for (i = 0; i < pacer->windowCount; i++) {
+        if (pacer->window[i] > worst) {
+            worst = pacer->window[i];
+        }
+    }
+
+    return worst;
+}
+
+// How long after the retrace GX work can start and still finish in the same field, given the worst frame of the
+// recent window plus a safety margin.
+s64 fpGetStartDelay(FramePacer* pacer, s64 margin) {
+    s64 delay;
+
+    if (pacer->windowCount == 0) {
+        return 0;
+    }
+
+    delay = pacer->fieldPeriod - fpGetWorstInterval(pacer) - margin;
+    return delay > 0 ? delay : 0;
+}
+
+void fpGetStats(FramePacer* pacer, FramePacerStats* stats) { *stats = pacer->stats; }
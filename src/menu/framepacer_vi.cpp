@@ -0,0 +1,86 @@
+#include "dolphin.h"
+#include "menu/framePacer.hpp"
+
+static FramePacer* sPacer;
+static VIRetraceCallback sPrevPostRetraceCB;
+static GXDrawDoneCallback sPrevDrawDoneCB;
+
+static void fpPostRetraceCallback(u32 retraceCount) {
+    OSTime time = OSGetTime();
+
+    fpRetrace(sPacer, time);
+    if (fpCanBeginFrame(sPacer)) {
+        fpBeginFrame(sPacer, time);
+    }
+
+    if (sPrevPostRetraceCB != NULL) {
+        sPrevPostRetraceCB(retraceCount);
+    }
+}
+
+static void fpDrawDoneCallback(void) {
+    OSTime time = OSGetTime();
+
+    // with a third XFB free the next frame starts drawing without waiting for the retrace
+    fpDrawDone(sPacer, time);
+    if (fpCanBeginFrame(sPacer)) {
+        fpBeginFrame(sPacer, time);
+    }
+
+    if (sPrevDrawDoneCB != NULL) {
+        sPrevDrawDoneCB();
+    }
+}
+
+void fpInstall(FramePacer* pacer) {
+    BOOL interrupts;
+    OSTime period;
+
+    if (VIGetTvFormat() == VI_PAL) {
+        period = OS_TIMER_CLOCK / 50;
+    } else {
+        period = (OSTime)OS_TIMER_CLOCK * 1001 / 60000;
+    }
+
+    interrupts = OSDisableInterrupts();
+    fpInit(pacer, period);
+    sPacer = pacer;
+    sPrevPostRetraceCB = VISetPostRetraceCallback(fpPostRetraceCallback);
+    sPrevDrawDoneCB = GXSetDrawDoneCallback(fpDrawDoneCallback);
+    OSRestoreInterrupts(interrupts);
+}
+
+void fpRemove(void) {
+    BOOL interrupts;
+
+    interrupts = OSDisableInterrupts();
+    VISetPostRetraceCallback(sPrevPostRetraceCB);
+    GXSetDrawDoneCallback(sPrevDrawDoneCB);
+    sPrevPostRetraceCB = NULL;
+    sPrevDrawDoneCB = NULL;
+    sPacer = NULL;
+    OSRestoreInterrupts(interrupts);
+}
+
+void fpReport(FramePacer* pacer) {
+    FramePacerStats* stats = &pacer->stats;
+    s32 i;
+
+    OSReport("FramePacer: %lu frames, %lu presented, %lu missed fields (longest run %lu), %lu buffers, %lu switches\n",
+             stats->numFrames, stats->numPresented, stats->numMissed, stats->longestMissRun, pacer->numBuffers,
+             stats->numBufferSwitches);
+    OSReport("FramePacer: worst interval %lu us, start delay %lu us\n",
+             (u32)OSTicksToMicroseconds(fpGetWorstInterval(pacer)),
+             (u32)OSTicksToMicroseconds(fpGetStartDelay(pacer, 0)));
+
+    OSReport("FramePacer: interval (1/8 field)");
+    for (i = 0; i < FP_HISTOGRAM_SIZE; i++) {
+        OSReport(" %lu", stats->intervalHistogram[i]);
+    }
+
+    OSReport("\nFramePacer: jitter (1/64 field)");
+    for (i = 0; i < FP_HISTOGRAM_SIZE; i++) {
+        OSReport(" %lu", stats->jitterHistogram[i]);
+    }
+    OSReport("\n");
+}
@@ -0,0 +1,99 @@
+#include "menu/mtrand.hpp"
+
+#define MT_MATRIX_A 0x9908B0DF
+#define MT_UPPER_MASK 0x80000000
+#define MT_LOWER_MASK 0x7FFFFFFF
+
+#define MT_TEMPERING_MASK_B 0x9D2C5680
+#define MT_TEMPERING_MASK_C 0xEFC60000
+
+static inline u32 genrand_twist(u32 upper, u32 lower, u32 shifted) {
+    u32 y;
+
+    y = (upper & MT_UPPER_MASK) | (lower & MT_LOWER_MASK);
+    return (shifted ^ (y >> 1) ^ (-(y & 1) & MT_MATRIX_A));
+}
+
+static inline u32 genrand_temper(u32 y) {
+    y ^= y >> 11;
+    y ^= (y << 7) & MT_TEMPERING_MASK_B;
+    y ^= (y << 15) & MT_TEMPERING_MASK_C;
+    y ^= y >> 18;
+    return y;
+}
+
+// Regenerates all MT_N words. The first MT_N - MT_M read words that haven't been replaced yet, the rest read the
+// ones the first loop just wrote, so neither loop needs the wraparound index of the one-word-at-a-time version.
+static void genrand_next_state(void) {
+    int kk;
+
+    if (mti == MT_N + 1) {
+        sgenrand(MT_DEFAULT_SEED);
+    }
+
+    for (kk = 0; kk < MT_N - MT_M; kk++) {
+        mt[kk] = genrand_twist(mt[kk], mt[kk + 1], mt[kk + MT_M]);
+    }
+    for (; kk < MT_N - 1; kk++) {
+        mt[kk] = genrand_twist(mt[kk], mt[kk + 1], mt[kk + MT_M - MT_N]);
+    }
+    mt[MT_N - 1] = genrand_twist(mt[MT_N - 1], mt[0], mt[MT_M - 1]);
+
+    mti = 0;
+}
+
+u32 genrand(void) {
+    if (mti >= MT_N) {
+        genrand_next_state();
+    }
+    return genrand_temper(mt[mti++]);
+}
+
+// Same numbers as n calls to genrand, a state's worth at a time
+void genrand_fill(u32* out, u32 n) {
+    const u32* state;
+    u32 count;
+    u32 i;
+
+    while (n != 0) {
+        if (mti >= MT_N) {
+            genrand_next_state();
+        }
+
+        count = MT_N - mti;
+        if (count > n) {
+            count = n;
+        }
+
+        state = &mt[mti];
+        for (i = 0; i < count; i++) {
+            out[i] = genrand_temper(state[i]);
+        }
+
+        mti += count;
+        out += count;
+        n -= count;
+    }
+}
+
+f32 genrand_float(void) { return (genrand() >> 8) * (1.0f / 16777216.0f); }
+
+// The high word of random * range is uniform except for the first 2^32 % range low words, which are thrown away.
+// All the arithmetic is unsigned so the full s32 range (where max - min + 1 wraps to 0) can't overflow.
+s32 genrand_range(s32 min, s32 max) {
+    u32 range;
+    u32 threshold;
+    u64 product;
+
+    range = (u32)max - (u32)min + 1;
+    if (range == 0) {
+        return genrand();
+    }
+
+    // (2^32 - range) % range is 2^32 % range
+    threshold = (0 - range) % range;
+    do {
+        product = (u64)genrand() * range;
+    } while ((u32)product < threshold);
+    return (u32)min + (u32)(product >> 32);
+}
@@ -0,0 +1,257 @@
+#include "menu/padRecord.hpp"
+#include "string.h"
+
+// offset in PADStatus of each field, PR_FIELD_BUTTON being bit 0: stickX to analogB, then err
+static const u8 sFieldOffsets[PR_NUM_FIELDS] = {0x00, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A};
+
+static inline void prPut32(u8* data, u32 value) {
+    data[0] = (u8)(value >> 24);
+    data[1] = (u8)(value >> 16);
+    data[2] = (u8)(value >> 8);
+    data[3] = (u8)value;
+}
+
+static inline u32 prGet32(const u8* data) {
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | data[3];
+}
+
+static u32 prCrcByte(u32 crc, u8 value) {
+    s32 i;
+
+    crc ^= value;
+    for (i = 0; i < 8; i++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return crc;
+}
+
+// CRC of the fields only, so padding never matters
+static u32 prCrcFrame(u32 crc, const PADStatus* status) {
+    s32 chan;
+    s32 i;
+
+    for (chan = 0; chan < PAD_MAX_CONTROLLERS; chan++) {
+        crc = prCrcByte(crc, (u8)(status[chan].button >> 8));
+        crc = prCrcByte(crc, (u8)status[chan].button);
+        for (i = 1; i < PR_NUM_FIELDS; i++) {
+            crc = prCrcByte(crc, ((const u8*)&status[chan])[sFieldOffsets[i]]);
+        }
+    }
+    return crc;
+}
+
+static u32 prChangedFields(const PADStatus* status, const PADStatus* last) {
+    u32 fields;
+    s32 i;
+
+    fields = status->button != last->button ? PR_FIELD_BUTTON : 0;
+    for (i = 1; i < PR_NUM_FIELDS; i++) {
+        if (((const u8*)status)[sFieldOffsets[i]] != ((const u8*)last)[sFieldOffsets[i]]) {
+            fields |= 1 << i;
+        }
+    }
+    return fields;
+}
+
+static void prFlushRun(PadRecorder* recorder) {
+    if (recorder->run != 0) {
+        recorder->buffer[recorder->position++] = (u8)(PR_RUN_FLAG | recorder->run);
+        recorder->run = 0;
+    }
+}
+
+void prInit(PadRecorder* recorder) {
+    memset(recorder, 0, sizeof(PadRecorder));
+    recorder->state = PR_STATE_OFF;
+}
+
+void prStartRecord(PadRecorder* recorder, void* buffer, u32 size) {
+    prInit(recorder);
+    recorder->buffer = (u8*)buffer;
+    recorder->size = size;
+    recorder->position = PR_HEADER_SIZE;
+    recorder->crc = 0xFFFFFFFF;
+    recorder->state = PR_STATE_RECORDING;
+}
+
+// Returns false once the buffer can't be sure to hold another frame; the recording then ends at the frame before
+BOOL prRecordFrame(PadRecorder* recorder, const PADStatus* status) {
+    u32 channels;
+    u32 fields;
+    s32 chan;
+    s32 i;
+    u8* out;
+
+    if (recorder->state != PR_STATE_RECORDING) {
+        return false;
+    }
+    if (recorder->position + PR_MAX_FRAME_SIZE > recorder->size) {
+        recorder->overflow = true;
+        recorder->state = PR_STATE_RECORD_FULL;
+        return false;
+    }
+
+    channels = 0;
+    for (chan = 0; chan < PAD_MAX_CONTROLLERS; chan++) {
+        if (prChangedFields(&status[chan], &recorder->last[chan]) != 0) {
+            channels |= 1 << chan;
+        }
+    }
+
+    recorder->crc = prCrcFrame(recorder->crc, status);
+    recorder->numFrames++;
+
+    if (channels == 0) {
+        if (++recorder->run == PR_MAX_RUN) {
+            prFlushRun(recorder);
+        }
+        return true;
+    }
+
+    prFlushRun(recorder);
+    out = recorder->buffer + recorder->position;
+    *out++ = (u8)channels;
+    for (chan = 0; chan < PAD_MAX_CONTROLLERS; chan++) {
+        if (!(channels & (1 << chan))) {
+            continue;
+        }
+
+        fields = prChangedFields(&status[chan], &recorder->last[chan]);
+        *out++ = (u8)(fields >> 8);
+        *out++ = (u8)fields;
+        if (fields & PR_FIELD_BUTTON) {
+            *out++ = (u8)(status[chan].button >> 8);
+            *out++ = (u8)status[chan].button;
+        }
+        for (i = 1; i < PR_NUM_FIELDS; i++) {
+            if (fields & (1 << i)) {
+                *out++ = ((const u8*)&status[chan])[sFieldOffsets[i]];
+            }
+        }
+        recorder->last[chan] = status[chan];
+    }
+    recorder->position = out - recorder->buffer;
+    return true;
+}
+
+// Writes the header and returns the size of the recording; does nothing unless a recording is in progress or full,
+// since a replay buffer may well be read-only
+u32 prFinishRecord(PadRecorder* recorder) {
+    if (recorder->state != PR_STATE_RECORDING && recorder->state != PR_STATE_RECORD_FULL) {
+        return 0;
+    }
+
+    prFlushRun(recorder);
+    prPut32(&recorder->buffer[0x00], PR_MAGIC);
+    recorder->buffer[0x04] = 0;
+    recorder->buffer[0x05] = PR_VERSION;
+    recorder->buffer[0x06] = 0;
+    recorder->buffer[0x07] = PAD_MAX_CONTROLLERS;
+    prPut32(&recorder->buffer[0x08], recorder->numFrames);
+    prPut32(&recorder->buffer[0x0C], ~recorder->crc);
+    recorder->state = PR_STATE_OFF;
+    return recorder->position;
+}
+
+BOOL prStartReplay(PadRecorder* recorder, const void* data, u32 size) {
+    const u8* header;
+
+    prInit(recorder);
+    header = (const u8*)data;
+    if (size < PR_HEADER_SIZE || prGet32(header) != PR_MAGIC || header[0x05] != PR_VERSION ||
+        header[0x07] != PAD_MAX_CONTROLLERS) {
+        return false;
+    }
+
+    recorder->buffer = (u8*)data;
+    recorder->size = size;
+    recorder->position = PR_HEADER_SIZE;
+    recorder->numFrames = prGet32(&header[0x08]);
+    recorder->expectedCrc = prGet32(&header[0x0C]);
+    recorder->crc = 0xFFFFFFFF;
+    recorder->state = PR_STATE_REPLAYING;
+    return true;
+}
+
+// Fills status with the next recorded frame; returns false, leaving status alone, once the recording is over
+BOOL prReplayFrame(PadRecorder* recorder, PADStatus* status) {
+    const u8* in;
+    const u8* end;
+    u32 channels;
+    u32 fields;
+    s32 chan;
+    s32 i;
+
+    if (recorder->state != PR_STATE_REPLAYING) {
+        return false;
+    }
+    if (recorder->frame == recorder->numFrames) {
+        recorder->state = PR_STATE_REPLAY_DONE;
+        return false;
+    }
+
+    in = recorder->buffer + recorder->position;
+    end = recorder->buffer + recorder->size;
+    if (recorder->run != 0) {
+        recorder->run--;
+    } else if (in < end && (*in & PR_RUN_FLAG)) {
+        recorder->run = (*in++ & PR_MAX_RUN) - 1;
+    } else if (in < end) {
+        channels = *in++;
+        for (chan = 0; chan < PAD_MAX_CONTROLLERS; chan++) {
+            if (!(channels & (1 << chan))) {
+                continue;
+            }
+            if (end - in < 2) {
+                recorder->corrupt = true;
+                break;
+            }
+
+            fields = (in[0] << 8) | in[1];
+            in += 2;
+            if (fields & PR_FIELD_BUTTON) {
+                if (end - in < 2) {
+                    recorder->corrupt = true;
+                    break;
+                }
+                recorder->last[chan].button = (u16)((in[0] << 8) | in[1]);
+                in += 2;
+            }
+            for (i = 1; i < PR_NUM_FIELDS; i++) {
+                if (!(fields & (1 << i))) {
+                    continue;
+                }
+                if (in == end) {
+                    recorder->corrupt = true;
+                    break;
+                }
+                ((u8*)&recorder->last[chan])[sFieldOffsets[i]] = *in++;
+            }
+        }
+    } else {
+        recorder->corrupt = true;
+    }
+
+    recorder->position = in - recorder->buffer;
+    memcpy(status, recorder->last, sizeof(recorder->last));
+    recorder->crc = prCrcFrame(recorder->crc, status);
+    recorder->frame++;
+    return true;
+}
+
+// Whether the whole recording has been replayed and came out exactly as it went in
+BOOL prReplayMatched(PadRecorder* recorder) {
+    return recorder->frame == recorder->numFrames && !recorder->corrupt && ~recorder->crc == recorder->expectedCrc;
+}
+
+u32 prRead(PadRecorder* recorder, PADStatus* status) {
+    u32 motor;
+
+    motor = PADRead(status);
+    if (recorder->state == PR_STATE_RECORDING) {
+        prRecordFrame(recorder, status);
+    } else if (recorder->state == PR_STATE_REPLAYING) {
+        prReplayFrame(recorder, status);
+    }
+    return motor;
+}
@@ -0,0 +1,289 @@
+#include "menu/seVoiceMgr.hpp"
+#include "JSystem/JKernel/JKRAram.h"
+#include "dolphin.h"
+#include "macros.h"
+#include "string.h"
+
+static SEVoiceMgr* sVoiceMgr;
+
+static inline void sevmRecordTiming(SEVoiceMgrTiming* timing, OSTick ticks) {
+    timing->numCalls++;
+    timing->totalTicks += ticks;
+    if (ticks > timing->maxTicks) {
+        timing->maxTicks = ticks;
+    }
+}
+
+static inline void sevmPushFree(SEVoiceMgr* mgr, SEVoiceNode* node) {
+    node->voice.axvpb = NULL;
+    node->voice.pSoundEntry = NULL;
+    node->prev = NULL;
+    node->next = mgr->freeList;
+    mgr->freeList = node;
+}
+
+static inline SEVoiceNode* sevmPopFree(SEVoiceMgr* mgr) {
+    SEVoiceNode* node = mgr->freeList;
+
+    if (node != NULL) {
+        mgr->freeList = node->next;
+    }
+
+    return node;
+}
+
+static inline void sevmLinkActive(SEVoiceMgr* mgr, SEVoiceNode* node) {
+    node->prev = NULL;
+    node->next = mgr->activeList;
+    if (mgr->activeList != NULL) {
+        mgr->activeList->prev = node;
+    }
+    mgr->activeList = node;
+    mgr->numActive++;
+}
+
+static inline void sevmUnlinkActive(SEVoiceMgr* mgr, SEVoiceNode* node) {
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        mgr->activeList = node->next;
+    }
+
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    }
+
+    mgr->numActive--;
+}
+
+// Called by AX when it takes the voice away for a higher priority request. AX frees the voice itself.
+static void sevmDropCallback(void* p) {
+    AXVPb* axvpb = (AXVPb*)p;
+    SEVoiceNode* node = (SEVoiceNode*)axvpb->userContext;
+
+    if (sVoiceMgr == NULL || node == NULL || node->voice.axvpb != axvpb) {
+        return;
+    }
+
+    MIXReleaseChannel(axvpb);
+    sevmUnlinkActive(sVoiceMgr, node);
+    sevmPushFree(sVoiceMgr, node);
+    sVoiceMgr->stats.numDrops++;
+}
+
+static void sevmRelease(SEVoiceMgr* mgr, SEVoiceNode* node) {
+    MIXReleaseChannel(node->voice.axvpb);
+    AXFreeVoice(node->voice.axvpb);
+    sevmUnlinkActive(mgr, node);
+    sevmPushFree(mgr, node);
+}
+
+// Lowest priority first, oldest first among equals. Only voices the request outranks or ties with qualify.
+static SEVoiceNode* sevmFindVictim(SEVoiceMgr* mgr, u32 priority) {
+    SEVoiceNode* node;
+    SEVoiceNode* victim;
+
+    victim = NULL;
+    for (node = mgr->activeList; node != NULL; node = node->next) {
+        if (node->priority > priority) {
+            continue;
+        }
+
+        if (victim == NULL || node->priority < victim->priority ||
+            (node->priority == victim->priority && (s32)(node->serial - victim->serial) < 0)) {
+            victim = node;
+        }
+    }
+
+    return victim;
+}
+
+// Registered in place of ax_se_callback; runs from the AX interrupt every audio frame
+static void sevmAXCallback(void) {
+    if (sVoiceMgr != NULL) {
+        sevmUpdate(sVoiceMgr);
+    }
+}
+
+void sevmInit(SEVoiceMgr* mgr, SPSoundTable* table) {
+    s32 i;
+
+    mgr->freeList = NULL;
+    mgr->activeList = NULL;
+    mgr->numActive = 0;
+    mgr->serial = 0;
+    mgr->table = table;
+    memset(mgr->menuVolumes, 0, sizeof(mgr->menuVolumes));
+    memset(&mgr->stats, 0, sizeof(mgr->stats));
+
+    for (i = NUM_VOICE - 1; i >= 0; i--) {
+        sevmPushFree(mgr, &mgr->nodes[i]);
+    }
+
+    sVoiceMgr = mgr;
+    AXRegisterCallback(sevmAXCallback);
+}
+
+// seInit with the manager in place of se_voice: same hardware setup and sound bank, volumes kept in the manager. seInit
+// can't be called for the setup, it keeps the sound table to itself, but this shares its ARAM array and buffer.
+void sevmInitSound(SEVoiceMgr* mgr, SEStatus* status) {
+    u32 aramZeroBase;
+    u32 aramUserBase;
+    SPSoundTable* table;
+
+    DVDInit();
+    ARInit(aramMemArray, ARRAY_COUNT(aramMemArray));
+    ARQInit();
+    AIInit(NULL);
+    AXInit();
+    MIXInit();
+
+    aramUserBase = (u32)JKRAllocFromAram(0x800000, JKRAramHeap::HEAD);
+
+    AMInit(aramUserBase, 0x800000);
+    aramZeroBase = AMGetZeroBuffer();
+    table = (SPSoundTable*)AMLoadFile((char*)"multiple_se.spt", NULL);
+    aramUserBase = __AMPushBuffered((char*)"multiple_se.spd", xfer_buffer, sizeof(xfer_buffer), NULL, false);
+    SPInitSoundTable(table, aramUserBase, aramZeroBase);
+
+    sevmInit(mgr, table);
+    mgr->menuVolumes[0] = status->cancelVolume;
+    mgr->menuVolumes[1] = status->okaiVolume;
+    mgr->menuVolumes[2] = status->selectVolume;
+    mgr->menuVolumes[3] = status->startVolume;
+}
+
+SEVoiceNode* sevmPlaySE(SEVoiceMgr* mgr, u32 index, s32 volume, u32 priority) {
+    SEVoiceNode* node;
+    SEVoiceNode* victim;
+    AXVPb* axvpb;
+    BOOL interrupts;
+    OSTick start;
+
+    priority = CLAMP(priority, SEVM_PRIORITY_MIN, SEVM_PRIORITY_MAX);
+
+    interrupts = OSDisableInterrupts();
+    start = OSGetTick();
+
+    node = sevmPopFree(mgr);
+    if (node == NULL) {
+        victim = sevmFindVictim(mgr, priority);
+        if (victim != NULL) {
+            AXSetVoiceState(victim->voice.axvpb, 0);
+            sevmRelease(mgr, victim);
+            node = sevmPopFree(mgr);
+            mgr->stats.numSteals++;
+        }
+    }
+
+    axvpb = NULL;
+    if (node != NULL) {
+        axvpb = AXAcquireVoice(priority, sevmDropCallback, (u32)node);
+
+        if (axvpb == NULL) {
+            victim = sevmFindVictim(mgr, priority);
+            if (victim != NULL) {
+                AXSetVoiceState(victim->voice.axvpb, 0);
+                sevmRelease(mgr, victim);
+                mgr->stats.numSteals++;
+                axvpb = AXAcquireVoice(priority, sevmDropCallback, (u32)node);
+            }
+        }
+
+        if (axvpb == NULL) {
+            sevmPushFree(mgr, node);
+            node = NULL;
+        }
+    }
+
+    if (node != NULL) {
+        node->voice.axvpb = axvpb;
+        node->voice.pSoundEntry = SPGetSoundEntry(mgr->table, index);
+        node->priority = priority;
+        node->serial = mgr->serial++;
+
+        SPPrepareSound(node->voice.pSoundEntry, axvpb, node->voice.pSoundEntry->sampleRate);
+        MIXInitChannel(axvpb, 0, volume, -0x3C0, -0x3C0, 0x40, 0x7F, 0);
+        AXSetVoiceState(axvpb, 1);
+
+        sevmLinkActive(mgr, node);
+        mgr->stats.numPlays++;
+    } else {
+        mgr->stats.numFailures++;
+    }
+
+    sevmRecordTiming(&mgr->stats.play, OSGetTick() - start);
+    OSRestoreInterrupts(interrupts);
+    return node;
+}
+
+// sePlaySE's volume for each menu sound, at the default priority
+SEVoiceNode* sevmPlayMenuSE(SEVoiceMgr* mgr, u32 index) {
+    return sevmPlaySE(mgr, index, index < SEVM_NUM_MENU_SE ? mgr->menuVolumes[index] : 0, SEVM_PRIORITY_DEFAULT);
+}
+
+// The voice is reclaimed by the next sevmUpdate. Nodes of another manager and voices that already went back to the
+// free list are ignored.
+void sevmStop(SEVoiceMgr* mgr, SEVoiceNode* node) {
+    BOOL interrupts;
+
+    if (node < &mgr->nodes[0] || node >= &mgr->nodes[NUM_VOICE]) {
+        return;
+    }
+
+    interrupts = OSDisableInterrupts();
+    if (node->voice.axvpb != NULL) {
+        AXSetVoiceState(node->voice.axvpb, 0);
+    }
+    OSRestoreInterrupts(interrupts);
+}
+
+void sevmStopAll(SEVoiceMgr* mgr) {
+    SEVoiceNode* node;
+    BOOL interrupts;
+
+    interrupts = OSDisableInterrupts();
+    for (node = mgr->activeList; node != NULL; node = node->next) {
+        AXSetVoiceState(node->voice.axvpb, 0);
+    }
+    OSRestoreInterrupts(interrupts);
+}
+
+// AX frame callback body: reclaims finished voices, touching only the active list. sevmInit registers it.
+void sevmUpdate(SEVoiceMgr* mgr) {
+    SEVoiceNode* node;
+    SEVoiceNode* next;
+    BOOL interrupts;
+    OSTick start;
+
+    interrupts = OSDisableInterrupts();
+    start = OSGetTick();
+
+    for (node = mgr->activeList; node != NULL; node = next) {
+        next = node->next;
+        if (node->voice.axvpb->pb.state == 0) {
+            sevmRelease(mgr, node);
+        }
+    }
+
+    sevmRecordTiming(&mgr->stats.update, OSGetTick() - start);
+    OSRestoreInterrupts(interrupts);
+}
+
+static void sevmReportTiming(const char* name, SEVoiceMgrTiming* timing) {
+    if (timing->numCalls == 0) {
+        OSReport("SEVoiceMgr: %s: no calls\n", name);
+        return;
+    }
+
+    OSReport("SEVoiceMgr: %s: %lu calls, avg %lu ns, max %lu ns with interrupts disabled\n", name, timing->numCalls,
+             (u32)OSTicksToNanoseconds((u64)(timing->totalTicks / timing->numCalls)),
+             (u32)OSTicksToNanoseconds((u64)timing->maxTicks));
+}
+
+void sevmReport(SEVoiceMgr* mgr) {
+    OSReport("SEVoiceMgr: %lu active, %lu plays, %lu steals, %lu dropped by AX, %lu failures\n", mgr->numActive,
+             mgr->stats.numPlays, mgr->stats.numSteals, mgr->stats.numDrops, mgr->stats.numFailures);
+    sevmReportTiming("play", &mgr->stats.play);
+    sevmReportTiming("update", &mgr->stats.update);
+}
@@ -0,0 +1,239 @@
+#include "menu/streamLoader.hpp"
+#include "macros.h"
+#include "string.h"
+
+static void slReadCallback(s32 result, DVDFileInfo* fileInfo) {
+    StreamLoader* loader = (StreamLoader*)fileInfo->cb.userData;
+    SLBuffer* buffer = &loader->buffers[loader->readSlot];
+
+    if (result < 0) {
+        buffer->state = SL_BUFFER_FREE;
+        loader->failed = true;
+    } else {
+        loader->stats.readTime += OSGetTime() - buffer->start;
+        buffer->state = SL_BUFFER_READ;
+    }
+
+    loader->readSlot = (loader->readSlot + 1) % loader->config.numBuffers;
+    loader->reading = false;
+    OSWakeupThread(&loader->queue);
+}
+
+static void slDMACallback(u32 ptrToRequest) {
+    SLBuffer* buffer = (SLBuffer*)ptrToRequest;
+    StreamLoader* loader = buffer->loader;
+    OSTime now = OSGetTime();
+
+    loader->stats.dmaTime += now - (buffer->start > loader->lastDMADone ? buffer->start : loader->lastDMADone);
+    loader->lastDMADone = now;
+    buffer->state = SL_BUFFER_FREE;
+    OSWakeupThread(&loader->queue);
+}
+
+// chunks are read into the tail of their buffer, so a filter can expand them towards the head
+static inline u8* slGetReadAddr(StreamLoader* loader, SLBuffer* buffer) {
+    return buffer->data + loader->config.bufferSize - loader->config.readSize;
+}
+
+// called with interrupts disabled
+static void slStartRead(StreamLoader* loader) {
+    SLBuffer* buffer = &loader->buffers[loader->readSlot];
+    u32 length;
+
+    length = loader->file.length - loader->readOffset;
+    if (length > loader->config.readSize) {
+        length = loader->config.readSize;
+    }
+
+    buffer->length = length;
+    buffer->state = SL_BUFFER_READING;
+    buffer->start = OSGetTime();
+    loader->reading = true;
+
+    // DVD transfers are whole 32-byte blocks; reading up to the next one past the end of the file is allowed
+    if (!DVDReadAsync(&loader->file, slGetReadAddr(loader, buffer), OSRoundUp32B(length), loader->readOffset,
+                      slReadCallback)) {
+        buffer->state = SL_BUFFER_FREE;
+        loader->reading = false;
+        loader->failed = true;
+        return;
+    }
+
+    loader->readOffset += length;
+    loader->stats.bytesRead += length;
+}
+
+// called with interrupts enabled, the filter may take a while
+static void slPost(StreamLoader* loader, SLBuffer* buffer) {
+    u8* source;
+    OSTime start;
+    u32 length;
+
+    source = slGetReadAddr(loader, buffer);
+    length = buffer->length;
+    loader->postSlot = (loader->postSlot + 1) % loader->config.numBuffers;
+
+    if (loader->config.filter != NULL) {
+        start = OSGetTime();
+        length = loader->config.filter(buffer->data, loader->config.bufferSize, source, length,
+                                       loader->config.userData);
+        loader->stats.filterTime += OSGetTime() - start;
+
+        if (length > loader->config.bufferSize) {
+            buffer->state = SL_BUFFER_FREE;
+            loader->failed = true;
+            return;
+        }
+
+        source = buffer->data;
+        DCFlushRange(source, length);
+    }
+
+    if (length == 0) {
+        buffer->state = SL_BUFFER_FREE;
+        return;
+    }
+
+    length = OSRoundUp32B(length);
+    loader->stats.numChunks++;
+    loader->stats.bytesWritten += length;
+
+    buffer->state = SL_BUFFER_DMA;
+    buffer->start = OSGetTime();
+    ARQPostRequest(&buffer->request, SL_ARQ_OWNER, ARAM_DIR_MRAM_TO_ARAM, ARQ_PRIORITY_LOW, (u32)source,
+                   loader->aramAddr + loader->aramOffset, length, slDMACallback);
+    loader->aramOffset += length;
+}
+
+static BOOL slIsDone(StreamLoader* loader) {
+    u32 i;
+
+    if (loader->reading) {
+        return false;
+    }
+
+    for (i = 0; i < loader->config.numBuffers; i++) {
+        switch (loader->buffers[i].state) {
+            case SL_BUFFER_DMA:
+                return false;
+            case SL_BUFFER_READ:
+                // after a failure, chunks that were already read are dropped
+                if (!loader->failed) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return loader->failed || loader->readOffset >= loader->file.length;
+}
+
+BOOL slInit(StreamLoader* loader, const SLConfig* config, void* work) {
+    u32 i;
+
+    if (config->numBuffers == 0 || config->numBuffers > SL_MAX_BUFFERS || config->bufferSize == 0 ||
+        (config->bufferSize & 0x1F) || ((u32)work & 0x1F)) {
+        return false;
+    }
+
+    loader->config = *config;
+    if (loader->config.readSize == 0) {
+        loader->config.readSize = loader->config.bufferSize;
+    }
+
+    if (loader->config.readSize > loader->config.bufferSize || (loader->config.readSize & 0x1F)) {
+        return false;
+    }
+
+    for (i = 0; i < SL_MAX_BUFFERS; i++) {
+        loader->buffers[i].data = i < config->numBuffers ? (u8*)work + i * config->bufferSize : NULL;
+        loader->buffers[i].length = 0;
+        loader->buffers[i].state = SL_BUFFER_FREE;
+        loader->buffers[i].loader = loader;
+    }
+
+    OSInitThreadQueue(&loader->queue);
+    memset(&loader->stats, 0, sizeof(loader->stats));
+    return true;
+}
+
+u32 slLoad(StreamLoader* loader, char* path, u32 aramAddr) {
+    SLBuffer* buffer;
+    OSTime start;
+    BOOL level;
+
+    if (!DVDOpen(path, &loader->file)) {
+        return 0;
+    }
+
+    loader->file.cb.userData = loader;
+    loader->readOffset = 0;
+    loader->aramOffset = 0;
+    loader->aramAddr = aramAddr;
+    loader->readSlot = 0;
+    loader->postSlot = 0;
+    loader->reading = false;
+    loader->failed = false;
+    loader->lastDMADone = 0;
+    memset(&loader->stats, 0, sizeof(loader->stats));
+
+    start = OSGetTime();
+    level = OSDisableInterrupts();
+    while (!slIsDone(loader)) {
+        if (!loader->failed) {
+            // keep the drive busy first, so the next read overlaps the filter and the DMA below
+            if (!loader->reading && loader->readOffset < loader->file.length &&
+                loader->buffers[loader->readSlot].state == SL_BUFFER_FREE) {
+                slStartRead(loader);
+                continue;
+            }
+
+            buffer = &loader->buffers[loader->postSlot];
+            if (buffer->state == SL_BUFFER_READ) {
+                OSRestoreInterrupts(level);
+                slPost(loader, buffer);
+                level = OSDisableInterrupts();
+                continue;
+            }
+        }
+
+        OSSleepThread(&loader->queue);
+    }
+    OSRestoreInterrupts(level);
+
+    loader->stats.totalTime = OSGetTime() - start;
+    DVDClose(&loader->file);
+
+    return loader->failed ? 0 : loader->aramOffset;
+}
+
+void slGetStats(StreamLoader* loader, SLStats* stats) {
+    BOOL level;
+
+    level = OSDisableInterrupts();
+    *stats = loader->stats;
+    OSRestoreInterrupts(level);
+}
+
+void slReport(StreamLoader* loader) {
+    SLStats stats;
+    s64 totalUs;
+    u32 serialMs;
+    u32 totalMs;
+
+    slGetStats(loader, &stats);
+
+    // a single buffer does every read, filter and DMA in turn, so their sum is what __AMPushBuffered would take
+    serialMs = (u32)OSTicksToMilliseconds(stats.readTime + stats.filterTime + stats.dmaTime);
+    totalMs = (u32)OSTicksToMilliseconds(stats.totalTime);
+    totalUs = OSTicksToMicroseconds(stats.totalTime);
+
+    OSReport("SL: %lu KB to ARAM in %lu chunks, %lu x %lu KB buffers: %lu ms, %lu KB/s\n", stats.bytesWritten / 1024,
+             stats.numChunks, loader->config.numBuffers, loader->config.bufferSize / 1024, totalMs,
+             totalUs != 0 ? (u32)((s64)stats.bytesWritten * 1000000 / 1024 / totalUs) : 0);
+    OSReport("SL: DVD %lu ms, filter %lu ms, DMA %lu ms; serial load ~%lu ms, %ld ms saved\n",
+             (u32)OSTicksToMilliseconds(stats.readTime), (u32)OSTicksToMilliseconds(stats.filterTime),
+             (u32)OSTicksToMilliseconds(stats.dmaTime), serialMs, (s32)serialMs - (s32)totalMs);
+}
@@ -0,0 +1,358 @@
+#include "aramemu.h"
+#include "dolphin/os.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+#define AREMU_BUS_CLOCK 162000000
+
+// DSP_CONTROL_STATUS bits the AR code looks at
+#define DSP_STATUS_ARAM_INT 0x0020
+#define DSP_STATUS_ARAM_DMA_BUSY 0x0200
+
+typedef struct AREmuTransfer {
+    u32 type;
+    u8* mram;
+    u32 aram;
+    u32 length;
+    Clock::time_point due;
+} AREmuTransfer;
+
+static AREmuConfig sConfig;
+static AREmuStats sStats;
+static u8* sARAM;
+static Clock::time_point sStartTime;
+
+static std::mutex sEngineLock;
+static std::condition_variable sEngineCond;
+static std::deque<AREmuTransfer> sQueue;
+static std::thread sEngine;
+static bool sRunning;
+static bool sDelivering;
+static Clock::time_point sLastDue;
+static std::atomic<u16> sDSPStatus;
+
+// Emulated interrupts: disabling them takes a process-wide lock that interrupt delivery also needs
+static std::mutex sInterruptLock;
+static thread_local bool sInterruptsDisabled;
+static __OSInterruptHandler sInterruptHandlers[__OS_INTERRUPT_MAX];
+static OSInterruptMask sInterruptMask = ~0u;
+static std::condition_variable_any sWakeup;
+
+extern "C" {
+BOOL OSDisableInterrupts(void) {
+    if (sInterruptsDisabled) {
+        return false;
+    }
+
+    sInterruptLock.lock();
+    sInterruptsDisabled = true;
+    return true;
+}
+
+BOOL OSEnableInterrupts(void) {
+    BOOL enabled = !sInterruptsDisabled;
+
+    if (sInterruptsDisabled) {
+        sInterruptsDisabled = false;
+        sInterruptLock.unlock();
+    }
+    return enabled;
+}
+
+BOOL OSRestoreInterrupts(BOOL level) {
+    if (level) {
+        return OSEnableInterrupts();
+    }
+    return !OSDisableInterrupts();
+}
+
+__OSInterruptHandler __OSSetInterruptHandler(__OSInterrupt interrupt, __OSInterruptHandler handler) {
+    __OSInterruptHandler old = sInterruptHandlers[interrupt];
+
+    sInterruptHandlers[interrupt] = handler;
+    return old;
+}
+
+OSInterruptMask __OSMaskInterrupts(OSInterruptMask global) {
+    OSInterruptMask old = sInterruptMask;
+
+    sInterruptMask |= global;
+    return old;
+}
+
+OSInterruptMask __OSUnmaskInterrupts(OSInterruptMask global) {
+    OSInterruptMask old = sInterruptMask;
+
+    sInterruptMask &= ~global;
+    return old;
+}
+
+void OSInitThreadQueue(OSThreadQueue* queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
+}
+
+// Any wakeup wakes every sleeper; like on hardware, callers recheck their condition after OSSleepThread returns
+void OSSleepThread(OSThreadQueue*) {
+    BOOL enabled;
+
+    enabled = OSDisableInterrupts();
+    sWakeup.wait(sInterruptLock);
+    OSRestoreInterrupts(enabled);
+}
+
+void OSWakeupThread(OSThreadQueue*) { sWakeup.notify_all(); }
+
+OSTime OSGetTime(void) {
+    return (OSTime)(std::chrono::duration<double>(Clock::now() - sStartTime).count() * (AREMU_BUS_CLOCK / 4));
+}
+
+OSTick OSGetTick(void) { return (OSTick)OSGetTime(); }
+
+void OSRegisterVersion(const char*) {}
+
+void OSReport(const char* msg, ...) {
+    va_list args;
+
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+}
+}
+
+// ar.c, with the register pokes replaced by the DMA engine
+
+static ARCallback __AR_Callback;
+static u32 __AR_Size;
+static u32 __AR_StackPointer;
+static u32 __AR_FreeBlocks;
+static u32* __AR_BlockLength;
+static volatile BOOL __AR_init_flag = false;
+
+static void __ARHandler(__OSInterrupt, OSContext*) {
+    // acknowledge the interrupt, as the write of 0x20 to DSP_CONTROL_STATUS does on hardware
+    sDSPStatus &= ~DSP_STATUS_ARAM_INT;
+
+    if (__AR_Callback) {
+        (*__AR_Callback)();
+    }
+}
+
+ARCallback ARRegisterDMACallback(ARCallback callback) {
+    ARCallback old_callback;
+    BOOL old;
+
+    old_callback = __AR_Callback;
+    old = OSDisableInterrupts();
+    __AR_Callback = callback;
+    OSRestoreInterrupts(old);
+    return old_callback;
+}
+
+u32 ARGetDMAStatus(void) {
+    std::lock_guard<std::mutex> lock(sEngineLock);
+
+    return sDSPStatus & DSP_STATUS_ARAM_DMA_BUSY;
+}
+
+void ARStartDMA(u32 type, u32 mainmem_addr, u32 aram_addr, u32 length) {
+    AREmuTransfer transfer;
+    Clock::time_point start;
+    BOOL enabled;
+
+    enabled = OSDisableInterrupts();
+
+    transfer.type = type & 1;
+    transfer.mram = (u8*)mainmem_addr;
+    transfer.aram = aram_addr;
+    transfer.length = length;
+    if ((u64)aram_addr + length > AREMU_ARAM_SIZE) {
+        transfer.length = aram_addr < AREMU_ARAM_SIZE ? AREMU_ARAM_SIZE - aram_addr : 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sEngineLock);
+
+        if ((mainmem_addr | aram_addr | length) & 0x1F) {
+            sStats.numMisaligned++;
+        }
+        if (transfer.length != length) {
+            sStats.numOutOfRange++;
+        }
+
+        // the hardware has a single channel; starting another transfer before the interrupt is a bug in the caller.
+        // It is counted and then serialized so the run can go on.
+        if (!sQueue.empty()) {
+            sStats.numOverlaps++;
+        }
+
+        start = Clock::now();
+        if (!sQueue.empty() && sLastDue > start) {
+            start = sLastDue;
+        }
+        transfer.due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                                   sConfig.latencyUs / 1e6 + length / sConfig.bytesPerSecond));
+        sLastDue = transfer.due;
+
+        sQueue.push_back(transfer);
+        sDSPStatus |= DSP_STATUS_ARAM_DMA_BUSY;
+    }
+    sEngineCond.notify_all();
+
+    OSRestoreInterrupts(enabled);
+}
+
+u32 ARAlloc(u32 length) {
+    u32 tmp;
+    BOOL old;
+
+    old = OSDisableInterrupts();
+    tmp = __AR_StackPointer;
+    __AR_StackPointer += length;
+    *__AR_BlockLength = length;
+    __AR_BlockLength += 1;
+    __AR_FreeBlocks -= 1;
+    OSRestoreInterrupts(old);
+    return tmp;
+}
+
+u32 ARInit(u32* stack_index_addr, u32 num_entries) {
+    BOOL old;
+
+    if (__AR_init_flag == true) {
+        return __AR_ARAM_USR_BASE_ADDR;
+    }
+
+    old = OSDisableInterrupts();
+
+    __AR_Callback = NULL;
+
+    __OSSetInterruptHandler(__OS_INTERRUPT_DSP_ARAM, __ARHandler);
+    __OSUnmaskInterrupts(OS_INTERRUPTMASK_DSP_ARAM);
+
+    __AR_StackPointer = __AR_ARAM_USR_BASE_ADDR;
+    __AR_FreeBlocks = num_entries;
+    __AR_BlockLength = stack_index_addr;
+
+    // __ARChecksize probes the size with test DMAs; the emulated ARAM is always the full internal 16 MiB
+    __AR_Size = AREMU_ARAM_SIZE;
+
+    __AR_init_flag = true;
+
+    OSRestoreInterrupts(old);
+
+    return __AR_StackPointer;
+}
+
+u32 ARGetSize(void) { return __AR_Size; }
+
+u32 ARGetBaseAddress(void) { return __AR_ARAM_USR_BASE_ADDR; }
+
+// DMA engine
+
+static void AREmuDeliverInterrupt(void) {
+    __OSInterruptHandler handler;
+
+    // waits for the CPU side to enable interrupts, exactly like an external interrupt would
+    OSDisableInterrupts();
+    sDSPStatus |= DSP_STATUS_ARAM_INT;
+    handler = sInterruptHandlers[__OS_INTERRUPT_DSP_ARAM];
+    if (handler != NULL && !(sInterruptMask & OS_INTERRUPTMASK_DSP_ARAM)) {
+        handler(__OS_INTERRUPT_DSP_ARAM, NULL);
+    }
+    OSEnableInterrupts();
+}
+
+static void AREmuEngine(void) {
+    std::unique_lock<std::mutex> lock(sEngineLock);
+    AREmuTransfer transfer;
+
+    while (true) {
+        sEngineCond.wait(lock, [] { return !sRunning || !sQueue.empty(); });
+        if (!sRunning && sQueue.empty()) {
+            break;
+        }
+
+        transfer = sQueue.front();
+        lock.unlock();
+        std::this_thread::sleep_until(transfer.due);
+
+        if (transfer.type == ARAM_DIR_MRAM_TO_ARAM) {
+            memcpy(&sARAM[transfer.aram], transfer.mram, transfer.length);
+        } else {
+            memcpy(transfer.mram, &sARAM[transfer.aram], transfer.length);
+        }
+
+        lock.lock();
+        sQueue.pop_front();
+        sStats.numDMAs++;
+        sStats.bytes[transfer.type] += transfer.length;
+        sStats.busySeconds += sConfig.latencyUs / 1e6 + transfer.length / sConfig.bytesPerSecond;
+        if (sQueue.empty()) {
+            sDSPStatus &= ~DSP_STATUS_ARAM_DMA_BUSY;
+        }
+        sStats.numInterrupts++;
+        sDelivering = true;
+        lock.unlock();
+
+        AREmuDeliverInterrupt();
+
+        lock.lock();
+        sDelivering = false;
+        sEngineCond.notify_all();
+    }
+}
+
+void AREmuInit(const AREmuConfig* config) {
+    sConfig = *config;
+    memset(&sStats, 0, sizeof(sStats));
+    sARAM = (u8*)calloc(AREMU_ARAM_SIZE, 1);
+    sStartTime = Clock::now();
+    __OSBusClock = AREMU_BUS_CLOCK;
+
+    sRunning = true;
+    sEngine = std::thread(AREmuEngine);
+}
+
+void AREmuShutdown(void) {
+    {
+        std::lock_guard<std::mutex> lock(sEngineLock);
+        sRunning = false;
+    }
+    sEngineCond.notify_all();
+    sEngine.join();
+
+    free(sARAM);
+    sARAM = NULL;
+}
+
+void AREmuWaitIdle(void) {
+    std::unique_lock<std::mutex> lock(sEngineLock);
+
+    sEngineCond.wait(lock, [] { return sQueue.empty() && !sDelivering; });
+}
+
+void AREmuGetStats(AREmuStats* stats) {
+    std::lock_guard<std::mutex> lock(sEngineLock);
+
+    *stats = sStats;
+}
+
+void AREmuResetStats(void) {
+    std::lock_guard<std::mutex> lock(sEngineLock);
+
+    memset(&sStats, 0, sizeof(sStats));
+}
+
+u8* AREmuGetARAM(void) { return sARAM; }
@@ -0,0 +1,49 @@
+#ifndef _ARAMEMU_ARAMEMU_H
+#define _ARAMEMU_ARAMEMU_H
+
+#include "dolphin/ar.h"
+
+// Host replacement for src/dolphin/ar/ar.c. Instead of poking the DSP registers, ARStartDMA hands the transfer to
+// a DMA engine thread that completes it after a bandwidth/latency model and then raises the ARAM interrupt through
+// the handler ARInit installed with __OSSetInterruptHandler, the way the hardware ends up in __ARHandler.
+//
+// Main memory addresses are host pointers; u32 is `long` in dolphin/types.h, so they fit on LP64 hosts.
+// Interrupts are emulated with a process-wide lock: OSDisableInterrupts takes it, interrupt delivery waits for it.
+// OSSleepThread releases it while waiting, so interrupt handlers can call OSWakeupThread as usual.
+
+#define AREMU_ARAM_SIZE (16 * 1024 * 1024)
+
+typedef struct AREmuConfig {
+    double bytesPerSecond;
+    double latencyUs; // fixed cost per transfer, on top of the bandwidth
+} AREmuConfig;
+
+typedef struct AREmuStats {
+    unsigned long numDMAs;
+    unsigned long long bytes[2]; // indexed by ARAM_DIR_*
+    unsigned long numOverlaps; // ARStartDMA while a transfer was still in flight
+    unsigned long numMisaligned; // address or length not a multiple of 32 bytes
+    unsigned long numOutOfRange; // ARAM range beyond the end of ARAM
+    unsigned long numInterrupts;
+    double busySeconds;
+} AREmuStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Must be called before ARInit; starts the DMA engine thread
+void AREmuInit(const AREmuConfig* config);
+void AREmuShutdown(void);
+void AREmuGetStats(AREmuStats* stats);
+void AREmuResetStats(void);
+u8* AREmuGetARAM(void);
+
+// Blocks until the engine is idle and the last interrupt has been delivered
+void AREmuWaitIdle(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
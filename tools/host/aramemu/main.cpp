@@ -0,0 +1,193 @@
+// Benchmarks ARAM upload strategies on the emulated AR backend: synchronous DMAs polled with ARGetDMAStatus, and
+// ARQ at several chunk sizes while a high priority 1 KB read is posted every millisecond, the pattern of streamed
+// audio running next to a bulk load. Every upload is verified against the source buffer.
+
+#include "aramemu.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct HiRead {
+    ARQRequest request;
+    Clock::time_point posted;
+} HiRead;
+
+static std::atomic<bool> sUploadDone;
+static std::atomic<u32> sHiDone;
+static double sHiTotalUs;
+static double sHiMaxUs;
+
+static void uploadCallback(u32 request) { sUploadDone = true; }
+
+// runs in the emulated interrupt handler
+static void hiReadCallback(u32 request) {
+    HiRead* read = (HiRead*)request;
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - read->posted).count();
+
+    sHiTotalUs += us;
+    if (us > sHiMaxUs) {
+        sHiMaxUs = us;
+    }
+    sHiDone++;
+}
+
+static bool verify(const std::vector<u8>& source, u32 aram) {
+    return memcmp(AREmuGetARAM() + aram, source.data(), source.size()) == 0;
+}
+
+static void report(const char* name, double seconds, u32 size, bool ok) {
+    AREmuStats stats;
+
+    AREmuGetStats(&stats);
+    printf("%-14s %7.1f MB/s, %5lu DMAs, %lu overlaps%s", name, size / seconds / (1024 * 1024), stats.numDMAs,
+           stats.numOverlaps, ok ? "" : ", DATA MISMATCH");
+}
+
+static bool benchSync(const std::vector<u8>& source, u32 aram, u32 chunk) {
+    Clock::time_point start;
+    double seconds;
+    u32 offset;
+    u32 length;
+    char name[32];
+    bool ok;
+
+    memset(AREmuGetARAM() + aram, 0, source.size());
+    AREmuResetStats();
+    start = Clock::now();
+    for (offset = 0; offset < source.size(); offset += chunk) {
+        length = (u32)source.size() - offset < chunk ? (u32)source.size() - offset : chunk;
+        ARStartDMAWrite((u32)&source[offset], aram + offset, length);
+        while (ARGetDMAStatus()) {
+            std::this_thread::yield();
+        }
+    }
+    AREmuWaitIdle();
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    ok = verify(source, aram);
+    snprintf(name, sizeof(name), "sync %luK", chunk / 1024);
+    report(name, seconds, (u32)source.size(), ok);
+    printf("\n");
+    return ok;
+}
+
+static bool benchARQ(const std::vector<u8>& source, u32 aram, u32 chunk, u32 hiAram) {
+    ARQRequest upload;
+    std::vector<HiRead> reads(4096);
+    std::vector<u8> hiBuffer(1024 * reads.size());
+    Clock::time_point start;
+    Clock::time_point nextRead;
+    double seconds;
+    u32 numReads;
+    char name[32];
+    bool ok;
+
+    memset(AREmuGetARAM() + aram, 0, source.size());
+    AREmuResetStats();
+    ARQSetChunkSize(chunk);
+    sUploadDone = false;
+    sHiDone = 0;
+    sHiTotalUs = 0.0;
+    sHiMaxUs = 0.0;
+    numReads = 0;
+
+    start = Clock::now();
+    nextRead = start;
+    ARQPostRequest(&upload, 1, ARAM_DIR_MRAM_TO_ARAM, ARQ_PRIORITY_LOW, (u32)source.data(), aram,
+                   (u32)source.size(), uploadCallback);
+
+    while (!sUploadDone) {
+        if (Clock::now() >= nextRead && numReads < reads.size()) {
+            reads[numReads].posted = Clock::now();
+            ARQPostRequest(&reads[numReads].request, 2, ARAM_DIR_ARAM_TO_MRAM, ARQ_PRIORITY_HIGH, hiAram,
+                           (u32)&hiBuffer[numReads * 1024], 1024, hiReadCallback);
+            numReads++;
+            nextRead += std::chrono::milliseconds(1);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    while (sHiDone != numReads) {
+        std::this_thread::yield();
+    }
+    AREmuWaitIdle();
+
+    ok = verify(source, aram);
+    snprintf(name, sizeof(name), "arq %luK", chunk / 1024);
+    report(name, seconds, (u32)source.size(), ok);
+    printf(", %lu hi reads: latency avg %.0f us max %.0f us\n", numReads, numReads ? sHiTotalUs / numReads : 0.0,
+           sHiMaxUs);
+    return ok;
+}
+
+// Two DMAs without waiting for the interrupt in between: the emulator has to flag the second one. The first one is
+// long enough that it is certainly still in flight when the second is started.
+static bool checkOverlap(const std::vector<u8>& source, u32 aram) {
+    AREmuStats stats;
+    u32 length;
+
+    length = (u32)source.size() / 2;
+    AREmuResetStats();
+    ARStartDMAWrite((u32)source.data(), aram, length);
+    ARStartDMAWrite((u32)source.data() + length, aram + length, length);
+    AREmuWaitIdle();
+    AREmuGetStats(&stats);
+
+    printf("overlap check: %lu overlapping DMA flagged\n", stats.numOverlaps);
+    return stats.numOverlaps == 1 && verify(source, aram);
+}
+
+int main(int argc, char** argv) {
+    static u32 stack[16];
+    static const u32 chunks[] = {0x1000, 0x4000, 0x10000};
+    AREmuConfig config;
+    std::vector<u8> source;
+    u32 aram;
+    u32 hiAram;
+    u32 size;
+    u32 i;
+    bool ok;
+
+    config.bytesPerSecond = (argc > 1 ? atof(argv[1]) : 80.0) * 1024 * 1024;
+    config.latencyUs = argc > 2 ? atof(argv[2]) : 2.0;
+    size = (argc > 3 ? (u32)atoi(argv[3]) : 4) * 1024 * 1024;
+    if (config.bytesPerSecond <= 0.0 || size == 0 || size > AREMU_ARAM_SIZE / 2) {
+        fprintf(stderr, "usage: aramemu [MB/s] [per-DMA latency us] [upload MB, up to 8]\n");
+        return 1;
+    }
+
+    AREmuInit(&config);
+    ARInit(stack, 16);
+    ARQInit();
+
+    aram = ARAlloc(size);
+    hiAram = ARAlloc(0x10000);
+
+    source.resize(size);
+    srand(1);
+    for (i = 0; i < size; i++) {
+        source[i] = (u8)rand();
+    }
+
+    printf("DMA model: %.1f MB/s, %.1f us per transfer, %lu MB upload\n", config.bytesPerSecond / (1024 * 1024),
+           config.latencyUs, size / (1024 * 1024));
+
+    ok = true;
+    for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        ok &= benchSync(source, aram, chunks[i]);
+    }
+    for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        ok &= benchARQ(source, aram, chunks[i], hiAram);
+    }
+    ok &= checkOverlap(source, aram);
+
+    AREmuShutdown();
+    return !ok;
+}
@@ -0,0 +1,340 @@
+// Host test and simulation of JKRAramHeap (src/JSystem/JKernel/JKRAramHeap.cpp) on the aramemu backend. The test
+// checks best fit placement, coalescing, the fragmentation numbers and compaction; the simulation loads and unloads
+// sound banks scene after scene the way a long session does, with no compaction, with compaction when a bank
+// doesn't fit, and with a little compaction every scene as well.
+
+#include "../aramemu/aramemu.h"
+#include "JSystem/JKernel/JKRAramHeap.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "dolphin/arq.h"
+#include "dolphin/os.h"
+#include "../common/test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HEAP_SIZE (10 * 1024 * 1024)
+#define NUM_BANKS 48
+#define NUM_RESIDENT 3 // loaded first and never moved or unloaded
+#define MAX_SCENE_BANKS 12
+#define SCENE_BUDGET (512 * 1024)
+#define MODEL_DMA_BYTES_PER_SECOND (80.0 * 1024 * 1024)
+
+typedef struct Bank {
+    u32 id;
+    u32 size;
+    JKRAramBlock* block; // NULL if not loaded
+    u32 aramAddress;     // the owner's copy, patched by onMove
+} Bank;
+
+typedef struct SimResult {
+    u32 loads;
+    u32 failures;
+    u32 avoidable; // failures with enough free space in total
+    u32 compactions;
+    double moved;
+    double fragmentation;
+    double gaps;
+    bool ok;
+} SimResult;
+
+static Bank sBanks[NUM_BANKS];
+static u32 sAram;
+static u32 sNumMoves;
+
+// u32 is 64 bits wide on LP64 hosts, so the banks are filled with unsigned ints
+static unsigned int pattern(u32 id, u32 word) { return (id + 1) * 0x9E3779B9 ^ word * 0x85EBCA6B; }
+
+// "Loads" a bank straight into emulated ARAM; only compaction goes through the DMA engine
+static void fillBlock(u32 id, u32 address, u32 size) {
+    unsigned int* words = (unsigned int*)(AREmuGetARAM() + address);
+    u32 i;
+
+    for (i = 0; i < size / 4; i++) {
+        words[i] = pattern(id, i);
+    }
+}
+
+static bool checkBlock(u32 id, u32 address, u32 size) {
+    const unsigned int* words = (const unsigned int*)(AREmuGetARAM() + address);
+    unsigned int bad;
+    u32 i;
+
+    bad = 0;
+    for (i = 0; i < size / 4; i++) {
+        bad |= words[i] ^ pattern(id, i);
+    }
+    return bad == 0;
+}
+
+static void onMove(JKRAramBlock* block, u32 oldAddress, void* param) {
+    Bank* banks = (Bank*)param;
+    u32 i;
+
+    sNumMoves++;
+    for (i = 0; i < NUM_BANKS; i++) {
+        if (banks[i].block == block) {
+            banks[i].aramAddress = block->getAddress();
+            return;
+        }
+    }
+}
+
+// Test blocks are identified by their order of allocation
+static void onTestMove(JKRAramBlock* block, u32 oldAddress, void* param) {
+    u32* oldAddresses = (u32*)param;
+
+    oldAddresses[sNumMoves++] = oldAddress;
+}
+
+static int test(void) {
+    static const u32 sizes[] = {0x10000, 0x8000, 0x10000, 0x8000, 0x20000};
+    JKRAramHeap* heap;
+    JKRAramBlock* blocks[5];
+    JKRAramBlock* fit;
+    JKRAramBlock* temp;
+    JKRAramHeap::TFragInfo info;
+    u32 oldAddresses[8];
+    u32 address;
+    u32 moved;
+    u32 i;
+    bool ok;
+
+    heap = new (JKRGetSystemHeap(), 0) JKRAramHeap(sAram, 0x100000);
+    ok = true;
+
+    for (i = 0; i < 5; i++) {
+        blocks[i] = heap->alloc(sizes[i], JKRAramHeap::HEAD);
+    }
+    ok &= expect(blocks[0]->getAddress() == sAram && blocks[4]->getAddress() == sAram + 0x30000, "packed from head");
+    temp = heap->alloc(0x1000, JKRAramHeap::TAIL);
+    ok &= expect(temp->getAddress() == sAram + 0x100000 - 0x1000 && temp->isTempMemory(), "tail");
+
+    // gaps of 0x10000 at the head and 0x8000 in the middle: best fit takes the smaller one
+    heap->free(blocks[0]);
+    heap->free(blocks[3]);
+    fit = heap->alloc(0x7F00, JKRAramHeap::HEAD);
+    ok &= expect(fit->getAddress() == sAram + 0x28000 && fit->getSize() == 0x7F00, "best fit");
+    heap->free(fit);
+
+    // freeing the block between two gaps joins all three
+    heap->free(blocks[2]);
+    heap->getFragInfo(&info);
+    ok &= expect(info.mNumFreeBlocks == 3 && info.mNumUsedBlocks == 3, "coalesced gaps");
+    ok &= expect(info.mTotalFreeSize == 0x100000 - 0x8000 - 0x20000 - 0x1000, "free size");
+    ok &= expect(info.mMaxFreeSize == 0x100000 - 0x50000 - 0x1000 && heap->getFreeSize() == info.mMaxFreeSize,
+                 "largest gap");
+    ok &= expect(info.mFragmentation == (0x28000 * 100) / info.mTotalFreeSize, "fragmentation");
+
+    // compaction moves the movable blocks down and leaves the rest where they are
+    fillBlock(1, blocks[1]->getAddress(), blocks[1]->getSize());
+    fillBlock(4, blocks[4]->getAddress(), blocks[4]->getSize());
+    blocks[1]->setMovable(true);
+    blocks[4]->setMovable(true);
+    address = temp->getAddress();
+    sNumMoves = 0;
+    moved = heap->compact(NULL, 0x2000, 0x10000, onTestMove, oldAddresses);
+    ok &= expect(moved == 0x8000 && sNumMoves == 1 && blocks[4]->getAddress() == sAram + 0x30000, "budget");
+    moved += heap->compact(NULL, 0x2000, 0, onTestMove, oldAddresses);
+    ok &= expect(moved == 0x28000 && sNumMoves == 2, "bytes moved");
+    ok &= expect(oldAddresses[0] == sAram + 0x10000 && oldAddresses[1] == sAram + 0x30000, "old addresses");
+    ok &= expect(blocks[1]->getAddress() == sAram && blocks[4]->getAddress() == sAram + 0x8000, "new addresses");
+    ok &= expect(temp->getAddress() == address, "fixed block stays");
+    ok &= expect(checkBlock(1, blocks[1]->getAddress(), blocks[1]->getSize()) &&
+                     checkBlock(4, blocks[4]->getAddress(), blocks[4]->getSize()),
+                 "moved data");
+    heap->getFragInfo(&info);
+    ok &= expect(info.mNumFreeBlocks == 1 && info.mFragmentation == 0 && info.mMovableSize == 0x28000,
+                 "compacted");
+
+    heap->free(blocks[1]);
+    heap->free(blocks[4]);
+    heap->free(temp);
+    ok &= expect(heap->getTotalFreeSize() == 0x100000 && heap->getFreeSize() == 0x100000, "all free");
+    delete heap;
+
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
+
+static u32 nextRandom(u32* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+// Scene after scene: unload the banks the scene doesn't use, maybe compact, load the ones it does in a random order
+static SimResult simulate(u32 numScenes, int policy) {
+    JKRAramHeap* heap;
+    JKRAramHeap::TFragInfo info;
+    SimResult result;
+    bool wanted[NUM_BANKS];
+    u32 order[NUM_BANKS];
+    u32 numWanted;
+    u32 seed;
+    u32 scene;
+    u32 swap;
+    u32 i;
+    u32 j;
+    Bank* bank;
+
+    memset(&result, 0, sizeof(result));
+    result.ok = true;
+    heap = new (JKRGetSystemHeap(), 0) JKRAramHeap(sAram, HEAP_SIZE);
+    seed = 1;
+    for (i = 0; i < NUM_BANKS; i++) {
+        sBanks[i].id = i;
+        // mostly a few hundred KB, a few of up to 2 MB
+        sBanks[i].size = nextRandom(&seed) % 8 == 0 ? 0x100000 + nextRandom(&seed) * 32
+                                                    : 0x10000 + (nextRandom(&seed) % 0x3000) * 0x80;
+        sBanks[i].block = NULL;
+    }
+    for (i = 0; i < NUM_RESIDENT; i++) {
+        bank = &sBanks[i];
+        bank->block = heap->alloc(bank->size, JKRAramHeap::HEAD);
+        bank->aramAddress = bank->block->getAddress();
+        fillBlock(bank->id, bank->aramAddress, bank->size);
+    }
+
+    for (scene = 0; scene < numScenes; scene++) {
+        memset(wanted, 0, sizeof(wanted));
+        numWanted = 4 + nextRandom(&seed) % (MAX_SCENE_BANKS - 3);
+        for (i = 0; i < numWanted; i++) {
+            wanted[NUM_RESIDENT + nextRandom(&seed) % (NUM_BANKS - NUM_RESIDENT)] = true;
+        }
+
+        for (i = NUM_RESIDENT; i < NUM_BANKS; i++) {
+            if (!wanted[i] && sBanks[i].block != NULL) {
+                heap->free(sBanks[i].block);
+                sBanks[i].block = NULL;
+            }
+        }
+        if (policy == 2) {
+            heap->compact(NULL, 0x8000, SCENE_BUDGET, onMove, sBanks);
+        }
+
+        for (i = 0; i < NUM_BANKS; i++) {
+            order[i] = i;
+        }
+        for (i = NUM_BANKS - 1; i > 0; i--) {
+            j = nextRandom(&seed) % (i + 1);
+            swap = order[i];
+            order[i] = order[j];
+            order[j] = swap;
+        }
+        for (i = 0; i < NUM_BANKS; i++) {
+            bank = &sBanks[order[i]];
+            if (!wanted[bank->id] || bank->block != NULL) {
+                continue;
+            }
+
+            result.loads++;
+            bank->block = heap->alloc(bank->size, JKRAramHeap::HEAD);
+            if (bank->block == NULL && policy != 0 && heap->getTotalFreeSize() >= ALIGN_NEXT(bank->size, 0x20)) {
+                heap->compact(NULL, 0x8000, 0, onMove, sBanks);
+                result.compactions++;
+                bank->block = heap->alloc(bank->size, JKRAramHeap::HEAD);
+            }
+            if (bank->block == NULL) {
+                result.failures++;
+                result.avoidable += heap->getTotalFreeSize() >= ALIGN_NEXT(bank->size, 0x20);
+                continue;
+            }
+            bank->block->setMovable(bank->id >= NUM_RESIDENT);
+            bank->aramAddress = bank->block->getAddress();
+            fillBlock(bank->id, bank->aramAddress, bank->size);
+        }
+
+        heap->getFragInfo(&info);
+        result.fragmentation += info.mFragmentation;
+        result.gaps += info.mNumFreeBlocks;
+        for (i = 0; i < NUM_BANKS; i++) {
+            bank = &sBanks[i];
+            if (bank->block != NULL) {
+                result.ok &= expect(bank->aramAddress == bank->block->getAddress(), "owner patched");
+                result.ok &= expect(checkBlock(bank->id, bank->aramAddress, bank->size), "bank data");
+            }
+        }
+    }
+
+    result.fragmentation /= numScenes;
+    result.gaps /= numScenes;
+    delete heap;
+    return result;
+}
+
+static int sim(u32 numScenes) {
+    static const char* policies[] = {"none", "on failure", "every scene"};
+    AREmuStats stats[2];
+    SimResult result;
+    double seconds;
+    struct timespec start;
+    struct timespec end;
+    int policy;
+    bool ok;
+
+    printf("%lu scenes, %d banks (%d resident) in a %d MB ARAM heap, %d KB compaction budget a scene\n", numScenes,
+           NUM_BANKS, NUM_RESIDENT, HEAP_SIZE / (1024 * 1024), SCENE_BUDGET / 1024);
+    printf("policy       loads  failed  avoidable  compactions  frag%%  gaps  moved MB  DMA ms/scene  run ms\n");
+    ok = true;
+    for (policy = 0; policy < 3; policy++) {
+        sNumMoves = 0;
+        AREmuGetStats(&stats[0]);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        result = simulate(numScenes, policy);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        AREmuGetStats(&stats[1]);
+        seconds = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        // every byte moved is copied out to main memory and back in
+        result.moved = (double)(stats[1].bytes[ARAM_DIR_MRAM_TO_ARAM] - stats[0].bytes[ARAM_DIR_MRAM_TO_ARAM]);
+        printf("%-11s %6lu %7lu %10lu %12lu %6.1f %5.1f %9.1f %13.2f %7.1f\n", policies[policy], result.loads,
+               result.failures, result.avoidable, result.compactions, result.fragmentation, result.gaps,
+               result.moved / (1024 * 1024), result.moved * 2 / MODEL_DMA_BYTES_PER_SECOND * 1000.0 / numScenes,
+               seconds * 1000.0);
+        ok &= result.ok;
+    }
+    printf("(DMA time modeled at %.0f MB/s; run ms is how long the policy took to simulate on the host)\n",
+           MODEL_DMA_BYTES_PER_SECOND / (1024 * 1024));
+    return ok ? 0 : 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: aramheap test\n"
+                    "       aramheap sim [scenes]\n");
+}
+
+int main(int argc, char** argv) {
+    static u32 stack[4];
+    AREmuConfig config;
+    u32 numScenes;
+    int result;
+
+    if (argc < 2 || (strcmp(argv[1], "test") != 0 && strcmp(argv[1], "sim") != 0)) {
+        usage();
+        return 2;
+    }
+    numScenes = argc > 2 ? (u32)atoi(argv[2]) : 500;
+    if (numScenes == 0) {
+        usage();
+        return 2;
+    }
+
+    // fast, so the simulation doesn't take as long as the transfers would
+    config.bytesPerSecond = 64.0 * 1024 * 1024 * 1024;
+    config.latencyUs = 0.0;
+    AREmuInit(&config);
+    ARInit(stack, 4);
+    ARQInit();
+    sAram = ARAlloc(HEAP_SIZE);
+
+    if (strcmp(argv[1], "test") == 0) {
+        result = test();
+    } else {
+        result = sim(numScenes);
+    }
+
+    AREmuShutdown();
+    return result;
+}
@@ -0,0 +1,290 @@
+// Host simulation of the AR DMA engine driving ARQ (src/dolphin/ar/arq.c) and the extended ARQX scheduler
+// (src/dolphin/ar/arqx.c) with the same mixed workload. Time is virtual and measured in OS timer ticks; every
+// transfer really moves bytes between simulated main memory and ARAM and is checked when its callback fires.
+
+#include "dolphin/ar.h"
+#include "dolphin/arqx.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_BUS_CLOCK 162000000
+#define SIM_TIMER_CLOCK (SIM_BUS_CLOCK / 4)
+#define SIM_MRAM_SIZE (24 * 1024 * 1024)
+#define SIM_ARAM_SIZE (16 * 1024 * 1024)
+
+// The OS functions the schedulers link against. __OSBusClock is defined by os.h in arqx.c and set in main.
+extern "C" {
+extern u32 __OSBusClock;
+
+static s64 sNow;
+
+s64 OSGetTime(void) { return sNow; }
+BOOL OSDisableInterrupts(void) { return 1; }
+BOOL OSRestoreInterrupts(BOOL level) { return level; }
+void OSRegisterVersion(const char* id) {}
+
+void OSReport(const char* msg, ...) {
+    va_list args;
+
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+}
+}
+
+static u8* sMram;
+static u8* sAram;
+static ARCallback sDMACallback;
+static bool sDMABusy;
+static s64 sDMADone;
+static u32 sNumOverlaps;
+static u32 sNumDMAs;
+static f64 sBytesPerTick;
+static s64 sDMALatency;
+
+extern "C" ARCallback ARRegisterDMACallback(ARCallback callback) {
+    ARCallback old = sDMACallback;
+
+    sDMACallback = callback;
+    return old;
+}
+
+extern "C" void ARStartDMA(u32 type, u32 mainmem_addr, u32 aram_addr, u32 length) {
+    if (sDMABusy) {
+        sNumOverlaps++;
+    }
+
+    if (type == ARAM_DIR_MRAM_TO_ARAM) {
+        memcpy(&sAram[aram_addr], &sMram[mainmem_addr], length);
+    } else {
+        memcpy(&sMram[mainmem_addr], &sAram[aram_addr], length);
+    }
+
+    sNumDMAs++;
+    sDMABusy = true;
+    sDMADone = sNow + sDMALatency + (s64)(length / sBytesPerTick);
+}
+
+typedef struct SimOwner {
+    const char* name;
+    u32 id;
+    u32 arqPriority;
+    u32 arqxPriority;
+    u32 type;
+    u32 length;
+    u32 numJobs;
+    s64 period; // 0 posts everything at once
+    u32 mramBase;
+    u32 aramBase;
+    bool contiguous;
+} SimOwner;
+
+// The ARQXRequest must come first: ARQ callbacks get a pointer to its leading ARQRequest
+typedef struct SimJob {
+    ARQXRequest request;
+    const SimOwner* owner;
+    s64 postTime;
+    s64 postAt;
+    u32 mram;
+    u32 aram;
+    bool done;
+} SimJob;
+
+typedef struct SimResult {
+    s64 totalLatency;
+    s64 maxLatency;
+    u32 numDone;
+    u32 numBad;
+} SimResult;
+
+static const SimOwner sOwners[] = {
+    // bulk sound/texture upload, posted in 16 KB pieces the way __AMPushBuffered does
+    {"stream", 1, ARQ_PRIORITY_LOW, 0, ARAM_DIR_MRAM_TO_ARAM, 0x4000, 256, 0, 0, 0, true},
+    // texture fetches every 20 ms
+    {"texture", 2, ARQ_PRIORITY_LOW, 2, ARAM_DIR_ARAM_TO_MRAM, 0x10000, 16, 810000, 0x800000, 0x800000, false},
+    // audio streaming reads every 5 ms
+    {"audio", 3, ARQ_PRIORITY_HIGH, 3, ARAM_DIR_ARAM_TO_MRAM, 0x400, 64, 202500, 0x1000000, 0xC00000, false},
+};
+
+#define SIM_NUM_OWNERS (s32)(sizeof(sOwners) / sizeof(sOwners[0]))
+
+static std::vector<SimJob> sJobs;
+static SimResult sResults[SIM_NUM_OWNERS];
+
+static void simCallback(u32 ptrToRequest) {
+    SimJob* job = (SimJob*)ptrToRequest;
+    const SimOwner* owner = job->owner;
+    SimResult* result = &sResults[owner - sOwners];
+    s64 latency = sNow - job->postTime;
+    bool ok;
+
+    if (owner->type == ARAM_DIR_MRAM_TO_ARAM) {
+        ok = memcmp(&sAram[job->aram], &sMram[job->mram], owner->length) == 0;
+    } else {
+        ok = memcmp(&sMram[job->mram], &sAram[job->aram], owner->length) == 0;
+    }
+
+    job->done = true;
+    result->numDone++;
+    result->numBad += !ok;
+    result->totalLatency += latency;
+    if (latency > result->maxLatency) {
+        result->maxLatency = latency;
+    }
+}
+
+static void buildJobs(void) {
+    SimJob job;
+    s32 i;
+    u32 j;
+
+    sJobs.clear();
+    for (i = 0; i < SIM_NUM_OWNERS; i++) {
+        for (j = 0; j < sOwners[i].numJobs; j++) {
+            memset(&job, 0, sizeof(job));
+            job.owner = &sOwners[i];
+            job.postAt = sOwners[i].period * j;
+
+            // reads cycle through a small buffer the way a streaming voice would
+            job.mram = sOwners[i].mramBase + (sOwners[i].contiguous ? j * sOwners[i].length : 0);
+            job.aram = sOwners[i].aramBase + (sOwners[i].contiguous ? j : j % 8) * sOwners[i].length;
+            sJobs.push_back(job);
+        }
+    }
+}
+
+static s64 run(bool extended, u32 boundUs) {
+    s64 end;
+    s64 next;
+    size_t i;
+    SimJob* job;
+
+    memset(sResults, 0, sizeof(sResults));
+    buildJobs();
+    sNow = 0;
+    sDMABusy = false;
+    sNumOverlaps = 0;
+    sNumDMAs = 0;
+    end = 0;
+
+    if (extended) {
+        ARQXInit(boundUs);
+    } else {
+        ARQReset();
+        ARQInit();
+    }
+
+    while (true) {
+        // jobs are ordered by owner, not by time, so find the earliest unposted one
+        next = -1;
+        job = NULL;
+        for (i = 0; i < sJobs.size(); i++) {
+            if (sJobs[i].postTime == 0 && !sJobs[i].done && (job == NULL || sJobs[i].postAt < job->postAt)) {
+                job = &sJobs[i];
+            }
+        }
+        if (job != NULL) {
+            next = job->postAt;
+        }
+
+        if (sDMABusy && (next < 0 || sDMADone <= next)) {
+            sNow = sDMADone;
+            sDMABusy = false;
+            sDMACallback();
+            end = sNow;
+            continue;
+        }
+
+        if (job == NULL) {
+            break;
+        }
+
+        sNow = job->postAt;
+        job->postTime = sNow != 0 ? sNow : 1;
+        if (extended) {
+            ARQXPostRequest(&job->request, job->owner->id, job->owner->type, job->owner->arqxPriority,
+                            job->owner->type == ARAM_DIR_MRAM_TO_ARAM ? job->mram : job->aram,
+                            job->owner->type == ARAM_DIR_MRAM_TO_ARAM ? job->aram : job->mram, job->owner->length,
+                            simCallback);
+        } else {
+            ARQPostRequest(&job->request.request, job->owner->id, job->owner->type, job->owner->arqPriority,
+                           job->owner->type == ARAM_DIR_MRAM_TO_ARAM ? job->mram : job->aram,
+                           job->owner->type == ARAM_DIR_MRAM_TO_ARAM ? job->aram : job->mram, job->owner->length,
+                           simCallback);
+        }
+    }
+
+    return end;
+}
+
+static void report(const char* name, s64 end) {
+    s32 i;
+
+    printf("%s: finished after %.2f ms, %lu DMAs, %lu overlapping\n", name, end * 1000.0 / SIM_TIMER_CLOCK, sNumDMAs,
+           sNumOverlaps);
+    for (i = 0; i < SIM_NUM_OWNERS; i++) {
+        printf("  %-8s %4lu/%4lu done, %lu corrupt, latency avg %8.1f us max %8.1f us\n", sOwners[i].name,
+               sResults[i].numDone, sOwners[i].numJobs, sResults[i].numBad,
+               sResults[i].numDone ? sResults[i].totalLatency * 1e6 / SIM_TIMER_CLOCK / sResults[i].numDone : 0.0,
+               sResults[i].maxLatency * 1e6 / SIM_TIMER_CLOCK);
+    }
+}
+
+int main(int argc, char** argv) {
+    ARQXStats stats;
+    f64 mbPerSec;
+    f64 latencyUs;
+    u32 boundUs;
+    s64 end;
+    s32 i;
+    s32 bad;
+
+    mbPerSec = argc > 1 ? atof(argv[1]) : 80.0;
+    latencyUs = argc > 2 ? atof(argv[2]) : 2.0;
+    boundUs = argc > 3 ? (u32)atoi(argv[3]) : ARQX_LATENCY_BOUND_DEFAULT;
+    if (mbPerSec <= 0.0) {
+        fprintf(stderr, "usage: arqsim [MB/s] [per-DMA latency us] [ARQX latency bound us]\n");
+        return 1;
+    }
+
+    __OSBusClock = SIM_BUS_CLOCK;
+    sBytesPerTick = mbPerSec * 1024 * 1024 / SIM_TIMER_CLOCK;
+    sDMALatency = (s64)(latencyUs * SIM_TIMER_CLOCK / 1e6);
+    sMram = (u8*)malloc(SIM_MRAM_SIZE);
+    sAram = (u8*)malloc(SIM_ARAM_SIZE);
+    srand(1);
+    for (i = 0; i < SIM_MRAM_SIZE; i++) {
+        sMram[i] = (u8)rand();
+    }
+    for (i = 0; i < SIM_ARAM_SIZE; i++) {
+        sAram[i] = (u8)rand();
+    }
+
+    printf("DMA model: %.1f MB/s, %.1f us per transfer\n", mbPerSec, latencyUs);
+    end = run(false, 0);
+    report("ARQ", end);
+
+    bad = sNumOverlaps;
+    for (i = 0; i < SIM_NUM_OWNERS; i++) {
+        bad += sResults[i].numBad + (sResults[i].numDone != sOwners[i].numJobs);
+    }
+
+    end = run(true, boundUs);
+    report("ARQX", end);
+    ARQXGetStats(&stats);
+    printf("  adapted chunk %lu bytes for a %lu us bound\n", stats.chunkSize, boundUs);
+    ARQXReport();
+
+    for (i = 0; i < SIM_NUM_OWNERS; i++) {
+        bad += sResults[i].numBad + (sResults[i].numDone != sOwners[i].numJobs);
+    }
+    bad += sNumOverlaps;
+
+    free(sMram);
+    free(sAram);
+    return bad != 0;
+}
@@ -0,0 +1,734 @@
+#include "axmix.h"
+
+#include <chrono>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef std::chrono::steady_clock Clock;
+
+#define AXEMU_DSP_CLOCK 81000000 // AXGetDspCycles reports host time in DSP cycles
+#define AXEMU_MAX_INPUT (AX_SAMPLES_PER_FRAME * AXEMU_MAX_SRC_RATIO + 1)
+
+enum {
+    AXEMU_BUS_L,
+    AXEMU_BUS_R,
+    AXEMU_BUS_S,
+    AXEMU_BUS_AL,
+    AXEMU_BUS_AR,
+    AXEMU_BUS_AS,
+    AXEMU_BUS_BL,
+    AXEMU_BUS_BR,
+    AXEMU_BUS_BS,
+    AXEMU_NUM_BUSES,
+};
+
+typedef struct AXEmuMixSlot {
+    u32 offset; // of the volume in AXPbMix, the delta follows it
+    u32 bus;
+} AXEmuMixSlot;
+
+static const AXEmuMixSlot sMixSlots[] = {
+    {offsetof(AXPbMix, vL), AXEMU_BUS_L},      {offsetof(AXPbMix, vR), AXEMU_BUS_R},
+    {offsetof(AXPbMix, vS), AXEMU_BUS_S},      {offsetof(AXPbMix, vAuxAL), AXEMU_BUS_AL},
+    {offsetof(AXPbMix, vAuxAR), AXEMU_BUS_AR}, {offsetof(AXPbMix, vAuxAS), AXEMU_BUS_AS},
+    {offsetof(AXPbMix, vAuxBL), AXEMU_BUS_BL}, {offsetof(AXPbMix, vAuxBR), AXEMU_BUS_BR},
+    {offsetof(AXPbMix, vAuxBS), AXEMU_BUS_BS},
+};
+
+typedef void (*AXEmuGainFunc)(int32_t* samples, int32_t volume, int32_t delta);
+typedef void (*AXEmuMixFunc)(const int32_t* samples, int32_t* bus, int32_t volume, int32_t delta);
+typedef void (*AXEmuLinearFunc)(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio);
+typedef void (*AXEmuPolyphaseFunc)(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio,
+                                   const int32_t* coefs);
+
+static AXVPb sVoices[AX_MAX_VOICES];
+static const u8* sARAM;
+static u32 sARAMSize;
+
+static AXEmuGainFunc sGain = AXEmuGainScalar;
+static AXEmuMixFunc sMix = AXEmuMixScalar;
+static AXEmuLinearFunc sSrcLinear = AXEmuSrcLinearScalar;
+static AXEmuPolyphaseFunc sSrcPolyphase = AXEmuSrcPolyphaseScalar;
+
+static AXUserCallback sUserCallback;
+static AXAuxCallback sAuxACallback;
+static void* sAuxAContext;
+static AXAuxCallback sAuxBCallback;
+static void* sAuxBContext;
+static u32 sMode;
+static u32 sMaxDspCycles;
+static u32 sDspCycles;
+
+static AXProfile* sProfiles;
+static u32 sMaxProfiles;
+static u32 sNumProfiles;
+
+static AXEmuStats sStats;
+static Clock::time_point sStartTime;
+
+// Indexed by AX_PB_COEFSEL_*
+static int32_t sSrcCoefs[3][AXEMU_SRC_PHASES * 4];
+static int32_t sBuses[AXEMU_NUM_BUSES][AX_SAMPLES_PER_FRAME];
+
+static inline u32 AXEmuGetAddr(u16 hi, u16 lo) { return ((u32)hi << 16) | lo; }
+
+static inline void AXEmuSetAddr(u16* hi, u16* lo, u32 address) {
+    *hi = (u16)(address >> 16);
+    *lo = (u16)address;
+}
+
+static inline u8 AXEmuReadByte(u32 offset) { return offset < sARAMSize ? sARAM[offset] : 0; }
+
+static inline s32 AXEmuClamp16(s64 value) {
+    if (value > 32767) {
+        return 32767;
+    }
+    if (value < -32768) {
+        return -32768;
+    }
+    return (s32)value;
+}
+
+// Profile timestamps are host nanoseconds since AXInit
+static OSTime AXEmuNow(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sStartTime).count();
+}
+
+// 4-tap windowed sinc per phase, normalized to unity gain at DC. The three tables cut off at 8, 12 and 16 kHz
+// relative to the 32 kHz output, like the DSP's.
+static void AXEmuInitSrcCoefs(void) {
+    static const double cutoffs[3] = {0.5, 0.75, 1.0};
+    double weights[4];
+    double sum;
+    double x;
+    int32_t* coefs;
+    s32 total;
+    u32 table;
+    u32 phase;
+    u32 k;
+
+    for (table = 0; table < 3; table++) {
+        for (phase = 0; phase < AXEMU_SRC_PHASES; phase++) {
+            coefs = &sSrcCoefs[table][phase * 4];
+            sum = 0.0;
+
+            // the taps sit at -1, 0, 1 and 2 around the output position
+            for (k = 0; k < 4; k++) {
+                x = ((double)k - 1.0 - (double)phase / AXEMU_SRC_PHASES) * cutoffs[table];
+                weights[k] = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+                x = (double)k - 1.0 - (double)phase / AXEMU_SRC_PHASES;
+                weights[k] *= 0.5 + 0.5 * cos(M_PI * x / 2.0);
+                sum += weights[k];
+            }
+
+            total = 0;
+            for (k = 0; k < 4; k++) {
+                coefs[k] = (int32_t)lrint(weights[k] / sum * 32768.0);
+                total += coefs[k];
+            }
+            coefs[1] += 32768 - total;
+        }
+    }
+}
+
+static void AXEmuResetVoice(AXVPb* voice) {
+    u32 index;
+
+    index = voice->index;
+    memset(voice, 0, sizeof(*voice));
+    voice->index = index;
+    voice->pb.srcSelect = AX_PB_SRCSEL_POLYPHASE;
+    voice->pb.coefSelect = AX_PB_COEFSEL_16KHZ;
+    voice->pb.ve.currentVolume = 0x8000;
+    voice->pb.src.ratioHi = 1;
+    voice->sync = AX_SYNC_FLAG_COPYALL;
+}
+
+// Keeps a one-frame ramp inside 0..0xFFFF and returns the volume it ends on
+static s32 AXEmuClampRamp(s32 volume, s32* delta) {
+    s32 end;
+
+    end = volume + *delta * AX_SAMPLES_PER_FRAME;
+    if (end < 0) {
+        *delta = -volume / AX_SAMPLES_PER_FRAME;
+    } else if (end > 0xFFFF) {
+        *delta = (0xFFFF - volume) / AX_SAMPLES_PER_FRAME;
+    }
+    return volume + *delta * AX_SAMPLES_PER_FRAME;
+}
+
+// Decodes count samples from the voice's buffer and moves it along, looping or stopping at the end address.
+// Returns false once a one-shot sound has ended; the rest of out is silence then.
+static BOOL AXEmuDecode(AXPb* pb, int32_t* out, u32 count) {
+    const u16* coefs;
+    u32 address;
+    u32 loopAddress;
+    u32 endAddress;
+    u32 predScale;
+    s32 yn1;
+    s32 yn2;
+    s32 nibble;
+    s32 sample;
+    s64 acc;
+    u32 i;
+    BOOL running;
+
+    address = AXEmuGetAddr(pb->addr.currentAddressHi, pb->addr.currentAddressLo);
+    loopAddress = AXEmuGetAddr(pb->addr.loopAddressHi, pb->addr.loopAddressLo);
+    endAddress = AXEmuGetAddr(pb->addr.endAddressHi, pb->addr.endAddressLo);
+    predScale = pb->adpcm.pred_scale;
+    yn1 = (s16)pb->adpcm.yn1;
+    yn2 = (s16)pb->adpcm.yn2;
+    running = true;
+
+    for (i = 0; i < count; i++) {
+        switch (pb->addr.format) {
+            case AX_PB_FORMAT_ADPCM:
+                // every 16 nibbles start with a predictor/scale byte
+                if ((address & 0xF) == 0) {
+                    predScale = AXEmuReadByte(address >> 1);
+                    address += 2;
+                }
+                nibble = AXEmuReadByte(address >> 1);
+                nibble = (address & 1) ? (nibble & 0xF) : (nibble >> 4);
+                nibble = nibble >= 8 ? nibble - 16 : nibble;
+                coefs = pb->adpcm.a[(predScale >> 4) & 7];
+                acc = (((s64)nibble << (predScale & 0xF)) << 11) + (s16)coefs[0] * (s64)yn1 + (s16)coefs[1] * (s64)yn2;
+                sample = AXEmuClamp16((acc + 1024) >> 11);
+                yn2 = yn1;
+                yn1 = sample;
+                break;
+            case AX_PB_FORMAT_PCM16:
+                sample = (s16)((AXEmuReadByte(address * 2) << 8) | AXEmuReadByte(address * 2 + 1));
+                break;
+            case AX_PB_FORMAT_PCM8:
+                sample = (s8)AXEmuReadByte(address) << 8;
+                break;
+            default:
+                sample = 0;
+                break;
+        }
+        out[i] = sample;
+
+        if (address != endAddress) {
+            address++;
+        } else if (pb->addr.loopFlag) {
+            address = loopAddress;
+            // streams keep decoding with the history they have, sounds restart from the loop context
+            if (pb->addr.format == AX_PB_FORMAT_ADPCM && pb->type == AX_PB_TYPE_NORMAL) {
+                predScale = pb->adpcmLoop.loop_pred_scale;
+                yn1 = (s16)pb->adpcmLoop.loop_yn1;
+                yn2 = (s16)pb->adpcmLoop.loop_yn2;
+            }
+        } else {
+            running = false;
+            memset(&out[i + 1], 0, (count - i - 1) * sizeof(int32_t));
+            break;
+        }
+    }
+
+    AXEmuSetAddr(&pb->addr.currentAddressHi, &pb->addr.currentAddressLo, address);
+    pb->adpcm.pred_scale = (u16)predScale;
+    pb->adpcm.yn1 = (u16)yn1;
+    pb->adpcm.yn2 = (u16)yn2;
+    return running;
+}
+
+static void AXEmuProcessVoice(AXVPb* voice) {
+    AXPb* pb;
+    int32_t in[4 + AXEMU_MAX_INPUT];
+    int32_t out[AX_SAMPLES_PER_FRAME];
+    u16* volume;
+    s32 start;
+    s32 delta;
+    s32 yn1;
+    u32 ratio;
+    u32 frac;
+    u32 count;
+    u32 i;
+    BOOL running;
+
+    pb = &voice->pb;
+    ratio = AXEmuGetAddr(pb->src.ratioHi, pb->src.ratioLo);
+    if (ratio > AXEMU_MAX_SRC_RATIO << 16) {
+        ratio = AXEMU_MAX_SRC_RATIO << 16;
+    }
+    frac = pb->src.currentAddressFrac;
+
+    if (pb->srcSelect == AX_PB_SRCSEL_NONE) {
+        count = AX_SAMPLES_PER_FRAME;
+    } else {
+        count = (frac + ratio * AX_SAMPLES_PER_FRAME) >> 16;
+    }
+
+    for (i = 0; i < 4; i++) {
+        in[i] = (s16)pb->src.last_samples[i];
+    }
+    running = AXEmuDecode(pb, &in[4], count);
+
+    switch (pb->srcSelect) {
+        case AX_PB_SRCSEL_NONE:
+            memcpy(out, &in[4], sizeof(out));
+            break;
+        case AX_PB_SRCSEL_LINEAR:
+            sSrcLinear(in, out, frac, ratio);
+            break;
+        default:
+            sSrcPolyphase(in, out, frac, ratio, sSrcCoefs[pb->coefSelect <= AX_PB_COEFSEL_16KHZ ? pb->coefSelect : 2]);
+            break;
+    }
+
+    for (i = 0; i < 4; i++) {
+        pb->src.last_samples[i] = (u16)in[count + i];
+    }
+    if (pb->srcSelect != AX_PB_SRCSEL_NONE) {
+        pb->src.currentAddressFrac = (u16)(frac + ratio * AX_SAMPLES_PER_FRAME);
+    }
+
+    delta = pb->ve.currentDelta;
+    if (pb->ve.currentVolume != 0x8000 || delta != 0) {
+        start = pb->ve.currentVolume;
+        pb->ve.currentVolume = (u16)AXEmuClampRamp(start, &delta);
+        sGain(out, start, delta);
+    }
+
+    if (pb->lpf.on) {
+        yn1 = (s16)pb->lpf.yn1;
+        for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+            yn1 = AXEmuClamp16(((s64)pb->lpf.a0 * out[i] + (s64)pb->lpf.b0 * yn1) >> 15);
+            out[i] = yn1;
+        }
+        pb->lpf.yn1 = (u16)yn1;
+    }
+
+    for (i = 0; i < sizeof(sMixSlots) / sizeof(sMixSlots[0]); i++) {
+        volume = (u16*)((u8*)&pb->mix + sMixSlots[i].offset);
+        delta = (s16)volume[1];
+        if (volume[0] == 0 && delta == 0) {
+            continue;
+        }
+
+        start = volume[0];
+        volume[0] = (u16)AXEmuClampRamp(start, &delta);
+        sMix(out, sBuses[sMixSlots[i].bus], start, delta);
+    }
+
+    if (!running) {
+        pb->state = AX_PB_STATE_STOP;
+    }
+}
+
+static void AXEmuRunAux(AXAuxCallback callback, void* context, u32 firstBus) {
+    int32_t* data[3];
+    u32 i;
+    u32 j;
+
+    if (callback == NULL) {
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {
+        data[i] = sBuses[firstBus + i];
+    }
+    callback(data, context);
+
+    // the callback returns its output in place, it goes back into the main mix
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < AX_SAMPLES_PER_FRAME; j++) {
+            sBuses[AXEMU_BUS_L + i][j] += data[i][j];
+        }
+    }
+}
+
+extern "C" {
+void AXEmuGainScalar(int32_t* samples, int32_t volume, int32_t delta) {
+    uint32_t i;
+
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+        samples[i] = AXEmuClamp16((samples[i] * (volume + delta * (int32_t)i)) >> 15);
+    }
+}
+
+void AXEmuMixScalar(const int32_t* samples, int32_t* bus, int32_t volume, int32_t delta) {
+    uint32_t i;
+
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+        bus[i] += (samples[i] * (volume + delta * (int32_t)i)) >> 15;
+    }
+}
+
+// Interpolates between the middle two taps; the fraction drops to 15 bits so the product fits in 32 bits
+void AXEmuSrcLinearScalar(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio) {
+    const int32_t* taps;
+    uint32_t position;
+    uint32_t i;
+
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+        position = frac + ratio * i;
+        taps = &in[position >> 16];
+        out[i] = taps[1] + (((taps[2] - taps[1]) * (int32_t)((position & 0xFFFF) >> 1)) >> 15);
+    }
+}
+
+void AXEmuSrcPolyphaseScalar(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio, const int32_t* coefs) {
+    const int32_t* taps;
+    const int32_t* c;
+    uint32_t position;
+    uint32_t i;
+
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+        position = frac + ratio * i;
+        taps = &in[position >> 16];
+        c = &coefs[((position & 0xFFFF) >> 9) * 4];
+        out[i] = AXEmuClamp16((taps[0] * c[0] + taps[1] * c[1] + taps[2] * c[2] + taps[3] * c[3] + 0x4000) >> 15);
+    }
+}
+
+void AXInit(void) { AXInitEx(0); }
+
+void AXInitEx(u32 outputBufferMode) {
+    u32 i;
+
+    (void)outputBufferMode;
+    sStartTime = Clock::now();
+    AXEmuInitSrcCoefs();
+
+    for (i = 0; i < AX_MAX_VOICES; i++) {
+        sVoices[i].index = i;
+        AXEmuResetVoice(&sVoices[i]);
+    }
+
+    sUserCallback = NULL;
+    sAuxACallback = NULL;
+    sAuxBCallback = NULL;
+    sMode = AX_MODE_STEREO;
+    sMaxDspCycles = AXEMU_DSP_CLOCK / 200;
+    sDspCycles = 0;
+    sProfiles = NULL;
+    AXEmuSetImpl(AXEMU_IMPL_AUTO);
+    AXEmuResetStats();
+}
+
+void AXQuit(void) {
+    u32 i;
+
+    for (i = 0; i < AX_MAX_VOICES; i++) {
+        AXEmuResetVoice(&sVoices[i]);
+    }
+    sUserCallback = NULL;
+}
+
+AXUserCallback AXRegisterCallback(AXUserCallback callback) {
+    AXUserCallback old;
+
+    old = sUserCallback;
+    sUserCallback = callback;
+    return old;
+}
+
+void AXSetMode(u32 mode) { sMode = mode; }
+
+u32 AXGetMode(void) { return sMode; }
+
+void AXSetMaxDspCycles(u32 cycles) { sMaxDspCycles = cycles; }
+
+u32 AXGetMaxDspCycles(void) { return sMaxDspCycles; }
+
+u32 AXGetDspCycles(void) { return sDspCycles; }
+
+void AXRegisterAuxACallback(AXAuxCallback callback, void* context) {
+    sAuxACallback = callback;
+    sAuxAContext = context;
+}
+
+void AXRegisterAuxBCallback(AXAuxCallback callback, void* context) {
+    sAuxBCallback = callback;
+    sAuxBContext = context;
+}
+
+AXVPb* AXAcquireVoice(u32 priority, AXVoiceCallback callback, u32 userContext) {
+    AXVPb* voice;
+    u32 i;
+
+    voice = NULL;
+    for (i = 0; i < AX_MAX_VOICES; i++) {
+        if (sVoices[i].priority == 0) {
+            voice = &sVoices[i];
+            break;
+        }
+    }
+
+    // otherwise take the lowest priority voice below the caller's
+    if (voice == NULL) {
+        for (i = 0; i < AX_MAX_VOICES; i++) {
+            if (sVoices[i].priority < priority && (voice == NULL || sVoices[i].priority < voice->priority)) {
+                voice = &sVoices[i];
+            }
+        }
+
+        if (voice == NULL) {
+            sStats.numStarved++;
+            return NULL;
+        }
+
+        sStats.numDropped++;
+        if (voice->callback != NULL) {
+            voice->callback(voice);
+        }
+    }
+
+    AXEmuResetVoice(voice);
+    voice->priority = priority;
+    voice->callback = callback;
+    voice->userContext = userContext;
+    return voice;
+}
+
+void AXFreeVoice(AXVPb* p) { AXEmuResetVoice(p); }
+
+void AXSetVoicePriority(AXVPb* p, u32 priority) { p->priority = priority; }
+
+void AXSetVoiceSrcType(AXVPb* p, u32 type) {
+    switch (type) {
+        case AX_SRC_TYPE_NONE:
+            p->pb.srcSelect = AX_PB_SRCSEL_NONE;
+            break;
+        case AX_SRC_TYPE_LINEAR:
+            p->pb.srcSelect = AX_PB_SRCSEL_LINEAR;
+            break;
+        case AX_SRC_TYPE_4TAP_8K:
+            p->pb.srcSelect = AX_PB_SRCSEL_POLYPHASE;
+            p->pb.coefSelect = AX_PB_COEFSEL_8KHZ;
+            break;
+        case AX_SRC_TYPE_4TAP_12K:
+            p->pb.srcSelect = AX_PB_SRCSEL_POLYPHASE;
+            p->pb.coefSelect = AX_PB_COEFSEL_12KHZ;
+            break;
+        case AX_SRC_TYPE_4TAP_16K:
+            p->pb.srcSelect = AX_PB_SRCSEL_POLYPHASE;
+            p->pb.coefSelect = AX_PB_COEFSEL_16KHZ;
+            break;
+    }
+    p->sync |= AX_SYNC_FLAG_COPYSELECT;
+}
+
+void AXSetVoiceState(AXVPb* p, u16 state) {
+    p->pb.state = state;
+    p->sync |= AX_SYNC_FLAG_COPYSTATE;
+}
+
+void AXSetVoiceType(AXVPb* p, u16 type) {
+    p->pb.type = type;
+    p->sync |= AX_SYNC_FLAG_COPYTYPE;
+}
+
+void AXSetVoiceMix(AXVPb* p, AXPbMix* mix) {
+    p->pb.mix = *mix;
+    p->sync |= AX_SYNC_FLAG_COPYAXPBMIX;
+}
+
+void AXSetVoiceItdOn(AXVPb* p) { p->sync |= AX_SYNC_FLAG_COPYITD; }
+
+void AXSetVoiceItdTarget(AXVPb* p, u16 lShift, u16 rShift) {
+    p->pb.itd.targetShiftL = lShift;
+    p->pb.itd.targetShiftR = rShift;
+    p->sync |= AX_SYNC_FLAG_COPYTSHIFT;
+}
+
+void AXSetVoiceUpdateIncrement(AXVPb* p) { p->sync |= AX_SYNC_FLAG_COPYUPDATE; }
+
+void AXSetVoiceUpdateWrite(AXVPb* p, u16 param, u16 data) {
+    (void)param;
+    (void)data;
+    p->sync |= AX_SYNC_FLAG_COPYUPDATE;
+}
+
+void AXSetVoiceDpop(AXVPb* p, AXPbDPop* dpop) {
+    p->pb.dpop = *dpop;
+    p->sync |= AX_SYNC_FLAG_COPYDPOP;
+}
+
+void AXSetVoiceVe(AXVPb* p, AXPbVe* ve) {
+    p->pb.ve = *ve;
+    p->sync |= AX_SYNC_FLAG_COPYVOL;
+}
+
+void AXSetVoiceVeDelta(AXVPb* p, s16 delta) {
+    p->pb.ve.currentDelta = delta;
+    p->sync |= AX_SYNC_FLAG_COPYVOL;
+}
+
+void AXSetVoiceFir(AXVPb* p, AXPbFir* fir) {
+    p->pb.fir = *fir;
+    p->sync |= AX_SYNC_FLAG_COPYFIR;
+}
+
+void AXSetVoiceAddr(AXVPb* p, AXPbAddr* addr) {
+    p->pb.addr = *addr;
+    p->sync |= AX_SYNC_FLAG_COPYADDR;
+}
+
+void AXSetVoiceLoop(AXVPb* p, u16 loop) {
+    p->pb.addr.loopFlag = loop;
+    p->sync |= AX_SYNC_FLAG_COPYLOOP;
+}
+
+void AXSetVoiceLoopAddr(AXVPb* p, u32 address) {
+    AXEmuSetAddr(&p->pb.addr.loopAddressHi, &p->pb.addr.loopAddressLo, address);
+    p->sync |= AX_SYNC_FLAG_COPYLOOPADDR;
+}
+
+void AXSetVoiceEndAddr(AXVPb* p, u32 address) {
+    AXEmuSetAddr(&p->pb.addr.endAddressHi, &p->pb.addr.endAddressLo, address);
+    p->sync |= AX_SYNC_FLAG_COPYENDADDR;
+}
+
+void AXSetVoiceCurrentAddr(AXVPb* p, u32 address) {
+    AXEmuSetAddr(&p->pb.addr.currentAddressHi, &p->pb.addr.currentAddressLo, address);
+    p->sync |= AX_SYNC_FLAG_COPYCURADDR;
+}
+
+void AXSetVoiceAdpcm(AXVPb* p, AXPbADPCM* adpcm) {
+    p->pb.adpcm = *adpcm;
+    p->sync |= AX_SYNC_FLAG_COPYADPCM;
+}
+
+void AXSetVoiceSrc(AXVPb* p, AXPbSrc* src) {
+    p->pb.src = *src;
+    p->sync |= AX_SYNC_FLAG_COPYSRC;
+}
+
+void AXSetVoiceSrcRatio(AXVPb* p, f32 ratio) {
+    u32 fixed;
+
+    fixed = (u32)(ratio * 0x10000);
+    AXEmuSetAddr(&p->pb.src.ratioHi, &p->pb.src.ratioLo, fixed);
+    p->sync |= AX_SYNC_FLAG_COPYRATIO;
+}
+
+void AXSetVoiceAdpcmLoop(AXVPb* p, AXPbADPCMLoop* adpcmloop) {
+    p->pb.adpcmLoop = *adpcmloop;
+    p->sync |= AX_SYNC_FLAG_COPYADPCMLOOP;
+}
+
+void AXSetVoiceLpf(AXVPb* p, AXPbLPF* lpf) { p->pb.lpf = *lpf; }
+
+void AXSetVoiceLpfCoefs(AXVPb* p, u16 a0, u16 b0) {
+    p->pb.lpf.a0 = a0;
+    p->pb.lpf.b0 = b0;
+}
+
+// One-pole filter: y = a0 * x + b0 * y', with a0 + b0 = 1.0 so the passband stays at unity
+void AXGetLpfCoefs(u16 freq, u16* a0, u16* b0) {
+    *b0 = (u16)lrint(exp(-2.0 * M_PI * freq / AX_SAMPLE_RATE) * 32768.0);
+    *a0 = (u16)(0x8000 - *b0);
+}
+
+void AXInitProfile(AXProfile* profile, u32 maxProfiles) {
+    sProfiles = profile;
+    sMaxProfiles = maxProfiles;
+    sNumProfiles = 0;
+}
+
+// Returns the number of frames profiled since the last call and starts over at the beginning of the buffer
+u32 AXGetProfile(void) {
+    u32 count;
+
+    count = sNumProfiles;
+    sNumProfiles = 0;
+    return count;
+}
+
+void AXSetCompressor(u32) {}
+
+void AXSetStepMode(u32) {}
+
+void AXEmuSetARAM(const u8* aram, u32 size) {
+    sARAM = aram;
+    sARAMSize = size;
+}
+
+BOOL AXEmuHaveAVX2(void) { return __builtin_cpu_supports("avx2") ? true : false; }
+
+void AXEmuSetImpl(AXEmuImpl impl) {
+    if (impl == AXEMU_IMPL_AUTO) {
+        impl = AXEmuHaveAVX2() ? AXEMU_IMPL_AVX2 : AXEMU_IMPL_SCALAR;
+    }
+
+    if (impl == AXEMU_IMPL_AVX2) {
+        sGain = AXEmuGainAVX2;
+        sMix = AXEmuMixAVX2;
+        sSrcLinear = AXEmuSrcLinearAVX2;
+        sSrcPolyphase = AXEmuSrcPolyphaseAVX2;
+    } else {
+        sGain = AXEmuGainScalar;
+        sMix = AXEmuMixScalar;
+        sSrcLinear = AXEmuSrcLinearScalar;
+        sSrcPolyphase = AXEmuSrcPolyphaseScalar;
+    }
+}
+
+void AXEmuRenderFrame(s16* out) {
+    AXProfile* profile;
+    Clock::time_point start;
+    double seconds;
+    s32 surround;
+    u32 numVoices;
+    u32 i;
+
+    start = Clock::now();
+    profile = sProfiles != NULL && sNumProfiles < sMaxProfiles ? &sProfiles[sNumProfiles++] : NULL;
+    if (profile != NULL) {
+        profile->axFrameStart = AXEmuNow();
+    }
+
+    memset(sBuses, 0, sizeof(sBuses));
+    numVoices = 0;
+    for (i = 0; i < AX_MAX_VOICES; i++) {
+        if (sVoices[i].priority != 0 && sVoices[i].pb.state == AX_PB_STATE_RUN) {
+            AXEmuProcessVoice(&sVoices[i]);
+            numVoices++;
+        }
+        sVoices[i].sync = 0;
+    }
+
+    if (profile != NULL) {
+        profile->auxProcessingStart = AXEmuNow();
+    }
+    AXEmuRunAux(sAuxACallback, sAuxAContext, AXEMU_BUS_AL);
+    AXEmuRunAux(sAuxBCallback, sAuxBContext, AXEMU_BUS_BL);
+    if (profile != NULL) {
+        profile->auxProcessingEnd = AXEmuNow();
+    }
+
+    // the surround channel goes to both sides at -3 dB, a plain matrix downmix
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+        surround = sMode == AX_MODE_STEREO ? 0 : (s32)(((s64)sBuses[AXEMU_BUS_S][i] * 23170) >> 15);
+        out[i * 2 + 0] = (s16)AXEmuClamp16((s64)sBuses[AXEMU_BUS_L][i] + surround);
+        out[i * 2 + 1] = (s16)AXEmuClamp16((s64)sBuses[AXEMU_BUS_R][i] + surround);
+    }
+
+    if (profile != NULL) {
+        profile->userCallbackStart = AXEmuNow();
+    }
+    if (sUserCallback != NULL) {
+        sUserCallback();
+    }
+    if (profile != NULL) {
+        profile->userCallbackEnd = AXEmuNow();
+        profile->axFrameEnd = profile->userCallbackEnd;
+        profile->axNumVoices = numVoices;
+    }
+
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    sDspCycles = (u32)(seconds * AXEMU_DSP_CLOCK);
+    sStats.numFrames++;
+    sStats.numVoiceFrames += numVoices;
+    sStats.renderSeconds += seconds;
+}
+
+void AXEmuGetStats(AXEmuStats* stats) { *stats = sStats; }
+
+void AXEmuResetStats(void) { memset(&sStats, 0, sizeof(sStats)); }
+}
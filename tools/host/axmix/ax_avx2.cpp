@@ -0,0 +1,97 @@
+#include "axmix.h"
+
+#include <immintrin.h>
+
+// AVX2 versions of the per-voice kernels, eight output samples at a time. They do the same 32-bit integer
+// arithmetic as the scalar kernels in ax.cpp, so the rendered output is identical.
+
+// Volume of each of the next eight samples of a ramp starting at volume
+__attribute__((target("avx2"))) static inline __m256i AXEmuRamp(int32_t volume, int32_t delta) {
+    return _mm256_add_epi32(_mm256_set1_epi32(volume),
+                            _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(delta)));
+}
+
+__attribute__((target("avx2"))) static inline __m256i AXEmuClamp16(__m256i value) {
+    return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_set1_epi32(-32768)), _mm256_set1_epi32(32767));
+}
+
+// Positions of the next eight output samples in 16.16 input samples
+__attribute__((target("avx2"))) static inline __m256i AXEmuPositions(uint32_t frac, uint32_t ratio) {
+    return _mm256_add_epi32(_mm256_set1_epi32((int32_t)frac),
+                            _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(ratio)));
+}
+
+extern "C" {
+__attribute__((target("avx2"))) void AXEmuGainAVX2(int32_t* samples, int32_t volume, int32_t delta) {
+    const __m256i step = _mm256_set1_epi32(delta * 8);
+    __m256i ramp;
+    __m256i x;
+    uint32_t i;
+
+    ramp = AXEmuRamp(volume, delta);
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i += 8) {
+        x = _mm256_loadu_si256((const __m256i*)&samples[i]);
+        x = AXEmuClamp16(_mm256_srai_epi32(_mm256_mullo_epi32(x, ramp), 15));
+        _mm256_storeu_si256((__m256i*)&samples[i], x);
+        ramp = _mm256_add_epi32(ramp, step);
+    }
+}
+
+__attribute__((target("avx2"))) void AXEmuMixAVX2(const int32_t* samples, int32_t* bus, int32_t volume,
+                                                  int32_t delta) {
+    const __m256i step = _mm256_set1_epi32(delta * 8);
+    __m256i ramp;
+    __m256i x;
+    uint32_t i;
+
+    ramp = AXEmuRamp(volume, delta);
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i += 8) {
+        x = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)&samples[i]), ramp), 15);
+        _mm256_storeu_si256((__m256i*)&bus[i], _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)&bus[i]), x));
+        ramp = _mm256_add_epi32(ramp, step);
+    }
+}
+
+__attribute__((target("avx2"))) void AXEmuSrcLinearAVX2(const int32_t* in, int32_t* out, uint32_t frac,
+                                                        uint32_t ratio) {
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+    __m256i position;
+    __m256i index;
+    __m256i b;
+    __m256i c;
+    uint32_t i;
+
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i += 8) {
+        position = AXEmuPositions(frac + ratio * i, ratio);
+        index = _mm256_srli_epi32(position, 16);
+        b = _mm256_i32gather_epi32((const int*)&in[1], index, 4);
+        c = _mm256_i32gather_epi32((const int*)&in[2], index, 4);
+        c = _mm256_mullo_epi32(_mm256_sub_epi32(c, b), _mm256_srli_epi32(_mm256_and_si256(position, mask), 1));
+        _mm256_storeu_si256((__m256i*)&out[i], _mm256_add_epi32(b, _mm256_srai_epi32(c, 15)));
+    }
+}
+
+__attribute__((target("avx2"))) void AXEmuSrcPolyphaseAVX2(const int32_t* in, int32_t* out, uint32_t frac,
+                                                           uint32_t ratio, const int32_t* coefs) {
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+    __m256i position;
+    __m256i index;
+    __m256i phase;
+    __m256i sum;
+    uint32_t i;
+    uint32_t k;
+
+    for (i = 0; i < AX_SAMPLES_PER_FRAME; i += 8) {
+        position = AXEmuPositions(frac + ratio * i, ratio);
+        index = _mm256_srli_epi32(position, 16);
+        phase = _mm256_slli_epi32(_mm256_srli_epi32(_mm256_and_si256(position, mask), 9), 2);
+
+        sum = _mm256_set1_epi32(0x4000);
+        for (k = 0; k < 4; k++) {
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_i32gather_epi32((const int*)&in[k], index, 4),
+                                                           _mm256_i32gather_epi32((const int*)&coefs[k], phase, 4)));
+        }
+        _mm256_storeu_si256((__m256i*)&out[i], AXEmuClamp16(_mm256_srai_epi32(sum, 15)));
+    }
+}
+}
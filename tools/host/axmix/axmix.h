@@ -0,0 +1,78 @@
+#ifndef _AXMIX_AXMIX_H
+#define _AXMIX_AXMIX_H
+
+#include "dolphin/ax.h"
+#include "dolphin/mix.h"
+#include "dolphin/sp.h"
+
+#include <stdint.h>
+
+// Host replacement for the AX, MIX and SP libraries. The voice parameter blocks are processed on the CPU the way
+// the AX DSP microcode processes them: every 5 ms frame each running voice decodes its samples from ARAM (DSP ADPCM,
+// big-endian PCM16 or PCM8), goes through the sample rate converter, the volume envelope and the low-pass filter,
+// and is mixed into the main, aux A and aux B buses with per-sample volume ramps. The aux callbacks and the user
+// callback run at the end of the frame, like they do from the AX interrupt.
+//
+// The DSP coefficient tables aren't in the tree: the 4-tap SRC tables, the MIX dB and pan tables and the LPF
+// coefficients are computed at init with the same units and ranges, so levels match but the filters are not
+// bit-exact with the console. ITD, FIR, depop and the update lists are accepted and ignored.
+//
+// ARAM is a host buffer registered with AXEmuSetARAM. Nothing is threaded: AXEmuRenderFrame renders one frame when
+// it's called, which lets offline rendering go as fast as the CPU allows.
+
+#define AXEMU_MAX_SRC_RATIO 8 // ratios above this are clamped
+
+typedef enum AXEmuImpl {
+    AXEMU_IMPL_AUTO,
+    AXEMU_IMPL_SCALAR,
+    AXEMU_IMPL_AVX2,
+} AXEmuImpl;
+
+typedef struct AXEmuStats {
+    unsigned long numFrames;
+    unsigned long numVoiceFrames; // running voices summed over all frames
+    unsigned long numDropped; // voices taken away from a lower priority owner by AXAcquireVoice
+    unsigned long numStarved; // AXAcquireVoice calls that found nothing to take
+    double renderSeconds; // host time spent inside AXEmuRenderFrame, callbacks included
+} AXEmuStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void AXEmuSetARAM(const u8* aram, u32 size);
+void AXEmuSetImpl(AXEmuImpl impl);
+BOOL AXEmuHaveAVX2(void);
+
+// Renders AX_SAMPLES_PER_FRAME interleaved left/right samples. Surround output is folded down to stereo.
+void AXEmuRenderFrame(s16* out);
+
+void AXEmuGetStats(AXEmuStats* stats);
+void AXEmuResetStats(void);
+
+// Builds a host SPSoundTable from the big-endian .spt file contents; the addresses are still relative to the .spd
+// until SPInitSoundTable relocates them. Returns NULL on a malformed table. Free the result with free().
+SPSoundTable* SPEmuLoadTable(const u8* data, u32 size);
+u32 SPEmuGetNumEntries(const SPSoundTable* table);
+
+// Internal kernels, shared between the scalar and AVX2 translation units. They take int32_t rather than s32, which
+// is `long` in dolphin/types.h. Sample buffers hold s16 values in 32-bit slots so the AVX2 versions can gather from
+// them. Volumes are 1.15 fixed point ramped by delta per sample; the caller keeps every ramp inside 0..0xFFFF, so
+// both versions give identical output.
+void AXEmuGainScalar(int32_t* samples, int32_t volume, int32_t delta);
+void AXEmuGainAVX2(int32_t* samples, int32_t volume, int32_t delta);
+void AXEmuMixScalar(const int32_t* samples, int32_t* bus, int32_t volume, int32_t delta);
+void AXEmuMixAVX2(const int32_t* samples, int32_t* bus, int32_t volume, int32_t delta);
+// in[0..3] is the history; output i reads the four taps starting at in[(frac + ratio * i) >> 16]
+void AXEmuSrcLinearScalar(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio);
+void AXEmuSrcLinearAVX2(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio);
+void AXEmuSrcPolyphaseScalar(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio, const int32_t* coefs);
+void AXEmuSrcPolyphaseAVX2(const int32_t* in, int32_t* out, uint32_t frac, uint32_t ratio, const int32_t* coefs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define AXEMU_SRC_PHASES 128 // coefs holds 4 taps per phase, 1.15 fixed point
+
+#endif
@@ -0,0 +1,700 @@
+#include "axmix.h"
+#include "../common/file.h"
+#include "../common/test.h"
+#include "menu/soundEffect.hpp"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define ARAM_SIZE (16 * 1024 * 1024)
+#define ARAM_ZERO_BASE 0x0000 // 256 bytes of silence the one-shots loop into
+#define ARAM_USER_BASE 0x1000 // the .spd goes here
+
+#define MAX_RENDER_SECONDS 600
+#define DEFAULT_TAIL_MS 2000 // looped sounds are let go this long after the last start
+#define ECHO_SAMPLES 3200 // 100 ms
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct PlayEvent {
+    u32 index;
+    u32 frame;
+} PlayEvent;
+
+typedef struct SoundBank {
+    std::vector<u8> spt;
+    std::vector<u8> spd;
+} SoundBank;
+
+typedef struct Echo {
+    int32_t delay[3][ECHO_SAMPLES];
+    u32 position;
+} Echo;
+
+static SEVoice sVoices[NUM_VOICE];
+static SPSoundTable* sTable;
+static std::vector<u8> sARAM;
+
+static void usage(void) {
+    fprintf(stderr, "usage: axmix render <table.spt> <data.spd> <out.wav> <index[@ms]>... [--length ms] [--scalar]\n"
+                    "       axmix bank <out.spt> <out.spd>\n"
+                    "       axmix bench [frames]\n"
+                    "       axmix test\n");
+}
+
+static void putLE(std::vector<u8>& data, u32 value, u32 size) {
+    u32 i;
+
+    for (i = 0; i < size; i++) {
+        data.push_back((u8)(value >> (i * 8)));
+    }
+}
+
+static void putBE(std::vector<u8>& data, u32 value, u32 size) {
+    u32 i;
+
+    for (i = size; i > 0; i--) {
+        data.push_back((u8)(value >> ((i - 1) * 8)));
+    }
+}
+
+static bool writeWAV(const char* path, const std::vector<s16>& samples) {
+    std::vector<u8> data;
+    u32 bytes;
+    u32 i;
+
+    bytes = (u32)(samples.size() * sizeof(s16));
+    data.insert(data.end(), (const u8*)"RIFF", (const u8*)"RIFF" + 4);
+    putLE(data, 36 + bytes, 4);
+    data.insert(data.end(), (const u8*)"WAVEfmt ", (const u8*)"WAVEfmt " + 8);
+    putLE(data, 16, 4);
+    putLE(data, 1, 2);
+    putLE(data, 2, 2);
+    putLE(data, AX_SAMPLE_RATE, 4);
+    putLE(data, AX_SAMPLE_RATE * 4, 4);
+    putLE(data, 4, 2);
+    putLE(data, 16, 2);
+    data.insert(data.end(), (const u8*)"data", (const u8*)"data" + 4);
+    putLE(data, bytes, 4);
+    for (i = 0; i < samples.size(); i++) {
+        putLE(data, (u16)samples[i], 2);
+    }
+    return writeFile(path, data);
+}
+
+// Loads the table and sample data the way seInit does: the .spd goes to the user area of ARAM and the table is
+// relocated to it
+static bool loadBank(const SoundBank* bank) {
+    free(sTable);
+    sTable = SPEmuLoadTable(bank->spt.data(), (u32)bank->spt.size());
+    if (sTable == NULL || ARAM_USER_BASE + bank->spd.size() > ARAM_SIZE) {
+        return false;
+    }
+
+    sARAM.assign(ARAM_SIZE, 0);
+    memcpy(&sARAM[ARAM_USER_BASE], bank->spd.data(), bank->spd.size());
+    AXEmuSetARAM(sARAM.data(), ARAM_SIZE);
+    SPInitSoundTable(sTable, ARAM_USER_BASE, ARAM_ZERO_BASE);
+    return true;
+}
+
+// ax_se_callback: voices that stopped go back to AX
+static void seCallback(void) {
+    u32 i;
+
+    for (i = 0; i < NUM_VOICE; i++) {
+        if (sVoices[i].axvpb != NULL && sVoices[i].axvpb->pb.state == AX_PB_STATE_STOP) {
+            MIXReleaseChannel(sVoices[i].axvpb);
+            AXFreeVoice(sVoices[i].axvpb);
+            sVoices[i].axvpb = NULL;
+        }
+    }
+    MIXUpdateSettings();
+}
+
+static void dropCallback(void* p) {
+    u32 i;
+
+    for (i = 0; i < NUM_VOICE; i++) {
+        if (sVoices[i].axvpb == p) {
+            MIXReleaseChannel(sVoices[i].axvpb);
+            sVoices[i].axvpb = NULL;
+        }
+    }
+}
+
+static void startAudio(AXEmuImpl impl) {
+    AXInit();
+    MIXInit();
+    AXEmuSetImpl(impl);
+    memset(sVoices, 0, sizeof(sVoices));
+    AXRegisterCallback(seCallback);
+}
+
+// sePlaySE with a settable pitch, pan and aux send
+static AXVPb* playSound(u32 index, f32 pitch, int input, int auxA, int pan) {
+    SPSoundEntry* sound;
+    AXVPb* voice;
+    u32 slot;
+
+    sound = SPGetSoundEntry(sTable, index);
+    for (slot = 0; slot < NUM_VOICE && sVoices[slot].axvpb != NULL; slot++) {}
+    if (sound == NULL || slot == NUM_VOICE) {
+        return NULL;
+    }
+
+    voice = AXAcquireVoice(0xF, dropCallback, 0);
+    if (voice == NULL) {
+        return NULL;
+    }
+
+    sVoices[slot].axvpb = voice;
+    sVoices[slot].pSoundEntry = sound;
+    SPPrepareSound(sound, voice, (u32)(sound->sampleRate * pitch));
+    MIXInitChannel(voice, 0, input, auxA, MIX_VOLUME_OFF, pan, 0x7F, 0);
+    AXSetVoiceState(voice, AX_PB_STATE_RUN);
+    return voice;
+}
+
+static u32 countVoices(void) {
+    u32 count;
+    u32 i;
+
+    count = 0;
+    for (i = 0; i < NUM_VOICE; i++) {
+        count += sVoices[i].axvpb != NULL;
+    }
+    return count;
+}
+
+static int render(int argc, char** argv) {
+    std::vector<PlayEvent> events;
+    std::vector<s16> output;
+    SoundBank bank;
+    PlayEvent event;
+    AXEmuStats stats;
+    AXEmuImpl impl;
+    const char* at;
+    u32 endFrame;
+    u32 next;
+    u32 frame;
+    u32 peak;
+    u32 i;
+    int arg;
+
+    if (argc < 6) {
+        usage();
+        return 1;
+    }
+
+    impl = AXEMU_IMPL_AUTO;
+    endFrame = ~0u;
+    for (arg = 5; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--scalar") == 0) {
+            impl = AXEMU_IMPL_SCALAR;
+            continue;
+        }
+        if (strcmp(argv[arg], "--length") == 0 && arg + 1 < argc) {
+            endFrame = (u32)(atof(argv[++arg]) / 5.0);
+            continue;
+        }
+        at = strchr(argv[arg], '@');
+        event.index = (u32)atoi(argv[arg]);
+        event.frame = at != NULL ? (u32)(atof(at + 1) / 5.0) : 0;
+        for (i = 0; i < events.size() && events[i].frame <= event.frame; i++) {}
+        events.insert(events.begin() + i, event);
+    }
+    if (endFrame == ~0u) {
+        endFrame = (events.empty() ? 0 : events.back().frame) + DEFAULT_TAIL_MS / 5;
+    }
+
+    if (!readFile(argv[2], bank.spt) || !readFile(argv[3], bank.spd)) {
+        fprintf(stderr, "axmix: can't read %s or %s\n", argv[2], argv[3]);
+        return 1;
+    }
+
+    startAudio(impl);
+    if (!loadBank(&bank)) {
+        fprintf(stderr, "axmix: %s is not a sound table or the sample data doesn't fit in ARAM\n", argv[2]);
+        return 1;
+    }
+    for (i = 0; i < events.size(); i++) {
+        if (events[i].index >= SPEmuGetNumEntries(sTable)) {
+            fprintf(stderr, "axmix: no sound %lu, the table has %lu\n", events[i].index,
+                    SPEmuGetNumEntries(sTable));
+            return 1;
+        }
+    }
+
+    next = 0;
+    peak = 0;
+    for (frame = 0; frame < MAX_RENDER_SECONDS * 200; frame++) {
+        while (next < events.size() && events[next].frame <= frame) {
+            if (playSound(events[next].index, 1.0f, 0, MIX_VOLUME_OFF, 0x40) == NULL) {
+                printf("frame %lu: no voice for sound %lu\n", frame, events[next].index);
+            }
+            next++;
+        }
+        if (next == events.size() && countVoices() == 0) {
+            break;
+        }
+
+        // loops play out to the end of their sample instead of stopping dead
+        if (frame >= endFrame) {
+            for (i = 0; i < NUM_VOICE; i++) {
+                if (sVoices[i].axvpb != NULL) {
+                    SPPrepareEnd(sVoices[i].pSoundEntry, sVoices[i].axvpb);
+                }
+            }
+        }
+
+        peak = countVoices() > peak ? countVoices() : peak;
+        output.resize(output.size() + AX_SAMPLES_PER_FRAME * 2);
+        AXEmuRenderFrame(&output[output.size() - AX_SAMPLES_PER_FRAME * 2]);
+    }
+
+    AXEmuGetStats(&stats);
+    printf("%lu frames (%.2f s), peak %lu voices, rendered in %.3f s (%.0fx realtime)\n", stats.numFrames,
+           stats.numFrames / 200.0, peak, stats.renderSeconds,
+           stats.renderSeconds > 0.0 ? stats.numFrames / 200.0 / stats.renderSeconds : 0.0);
+    if (!writeWAV(argv[4], output)) {
+        fprintf(stderr, "axmix: can't write %s\n", argv[4]);
+        return 1;
+    }
+    return 0;
+}
+
+// DSP ADPCM with a small fixed set of predictors; every 14-sample frame picks the predictor and scale that encode
+// it best. Good enough for test sounds.
+static void encodeAdpcm(const std::vector<s16>& pcm, std::vector<u8>& out, const s16 coefs[8][2]) {
+    s32 bestError;
+    s32 error;
+    s32 yn1;
+    s32 yn2;
+    s32 tryYn1;
+    s32 tryYn2;
+    s32 nibble;
+    s32 sample;
+    s64 prediction;
+    u8 nibbles[14];
+    u8 best[14];
+    u32 bestHeader;
+    u32 frame;
+    u32 numFrames;
+    u32 predictor;
+    u32 scale;
+    u32 i;
+
+    yn1 = 0;
+    yn2 = 0;
+    numFrames = (u32)(pcm.size() + 13) / 14;
+    for (frame = 0; frame < numFrames; frame++) {
+        bestError = 0x7FFFFFFF;
+        bestHeader = 0;
+        for (predictor = 0; predictor < 4; predictor++) {
+            for (scale = 0; scale <= 12; scale++) {
+                tryYn1 = yn1;
+                tryYn2 = yn2;
+                error = 0;
+                for (i = 0; i < 14; i++) {
+                    sample = frame * 14 + i < pcm.size() ? pcm[frame * 14 + i] : 0;
+                    prediction = (s64)coefs[predictor][0] * tryYn1 + (s64)coefs[predictor][1] * tryYn2;
+                    nibble = (s32)lrint(((s64)sample * 2048 - prediction) / (double)(2048 << scale));
+                    nibble = nibble < -8 ? -8 : nibble > 7 ? 7 : nibble;
+                    nibbles[i] = (u8)(nibble & 0xF);
+                    tryYn2 = tryYn1;
+                    tryYn1 = (s32)(((((s64)nibble << scale) << 11) + prediction + 1024) >> 11);
+                    tryYn1 = tryYn1 < -32768 ? -32768 : tryYn1 > 32767 ? 32767 : tryYn1;
+                    error += abs(tryYn1 - sample) < 0x7FFFFFFF / 14 ? abs(tryYn1 - sample) : 0x7FFFFFFF / 14;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestHeader = (predictor << 4) | scale;
+                    memcpy(best, nibbles, sizeof(best));
+                }
+            }
+        }
+
+        out.push_back((u8)bestHeader);
+        for (i = 0; i < 14; i += 2) {
+            out.push_back((u8)((best[i] << 4) | best[i + 1]));
+        }
+
+        // replay the chosen encoding to carry the decoder's history into the next frame
+        for (i = 0; i < 14; i++) {
+            nibble = best[i] >= 8 ? best[i] - 16 : best[i];
+            prediction = (s64)coefs[bestHeader >> 4][0] * yn1 + (s64)coefs[bestHeader >> 4][1] * yn2;
+            yn2 = yn1;
+            yn1 = (s32)(((((s64)nibble << (bestHeader & 0xF)) << 11) + prediction + 1024) >> 11);
+            yn1 = yn1 < -32768 ? -32768 : yn1 > 32767 ? 32767 : yn1;
+        }
+    }
+}
+
+typedef struct BankSound {
+    u32 type;
+    u32 sampleRate;
+    std::vector<s16> pcm;
+} BankSound;
+
+// Builds a .spt/.spd pair in the disc format: an ADPCM one-shot, an ADPCM loop, a PCM16 loop and a PCM8 one-shot
+// at four different sample rates
+static void buildBank(SoundBank* bank) {
+    static const s16 coefs[8][2] = {{0, 0}, {2048, 0}, {3840, -1792}, {3072, -1024}};
+    BankSound sounds[4];
+    std::vector<u8> adpcm;
+    u32 offsets[4];
+    u32 lengths[4];
+    u32 adpcmBase;
+    u32 noise;
+    u32 start;
+    u32 end;
+    double t;
+    u32 i;
+    u32 k;
+
+    sounds[0].type = 0;
+    sounds[0].sampleRate = 32000;
+    for (i = 0; i < 19200; i++) {
+        t = i / 32000.0;
+        sounds[0].pcm.push_back((s16)(exp(-t * 6.0) * (9000.0 * sin(2 * M_PI * 880 * t) +
+                                                       6000.0 * sin(2 * M_PI * 1320 * t))));
+    }
+
+    // whole numbers of cycles, so the loops are seamless
+    sounds[1].type = 1;
+    sounds[1].sampleRate = 22050;
+    for (i = 0; i < 22050; i++) {
+        t = i / 22050.0;
+        sounds[1].pcm.push_back((s16)(8000.0 * sin(2 * M_PI * 220 * t) + 5000.0 * sin(2 * M_PI * 330 * t)));
+    }
+
+    sounds[2].type = 3;
+    sounds[2].sampleRate = 48000;
+    for (i = 0; i < 24000; i++) {
+        sounds[2].pcm.push_back((s16)(((s32)((i % 320) * 65536 / 320) - 32768) / 3));
+    }
+
+    sounds[3].type = 4;
+    sounds[3].sampleRate = 16000;
+    noise = 1;
+    for (i = 0; i < 1600; i++) {
+        noise = (noise * 1103515245 + 12345) & 0xFFFFFFFF;
+        sounds[3].pcm.push_back((s16)(((s32)((noise >> 8) & 0xFF00) - 0x8000) * (1600 - (s32)i) / 1600));
+    }
+
+    bank->spd.clear();
+    for (i = 0; i < 4; i++) {
+        offsets[i] = (u32)bank->spd.size();
+        lengths[i] = (u32)sounds[i].pcm.size();
+        switch (sounds[i].type) {
+            case 0:
+            case 1:
+                encodeAdpcm(sounds[i].pcm, bank->spd, coefs);
+                break;
+            case 3:
+                for (k = 0; k < lengths[i]; k++) {
+                    putBE(bank->spd, (u16)sounds[i].pcm[k], 2);
+                }
+                break;
+            default:
+                for (k = 0; k < lengths[i]; k++) {
+                    bank->spd.push_back((u8)(sounds[i].pcm[k] >> 8));
+                }
+                break;
+        }
+        bank->spd.resize((bank->spd.size() + 31) & ~31);
+    }
+
+    bank->spt.clear();
+    putBE(bank->spt, 4, 4);
+    adpcmBase = 4 + 4 * 0x1C;
+    for (i = 0; i < 4; i++) {
+        switch (sounds[i].type) {
+            case 0:
+            case 1:
+                // nibble addresses; the first sample follows the frame header
+                start = offsets[i] * 2;
+                end = start + (lengths[i] - 1) / 14 * 16 + 2 + (lengths[i] - 1) % 14;
+                break;
+            case 3:
+                start = offsets[i] / 2;
+                end = start + lengths[i] - 1;
+                break;
+            default:
+                start = offsets[i];
+                end = start + lengths[i] - 1;
+                break;
+        }
+        putBE(bank->spt, sounds[i].type, 4);
+        putBE(bank->spt, sounds[i].sampleRate, 4);
+        putBE(bank->spt, start, 4);
+        putBE(bank->spt, end, 4);
+        putBE(bank->spt, end, 4);
+        putBE(bank->spt, start, 4);
+        putBE(bank->spt, sounds[i].type <= 1 ? adpcmBase + i * 0x2E : 0, 4);
+    }
+
+    for (i = 0; i < 4; i++) {
+        for (k = 0; k < 16; k++) {
+            putBE(bank->spt, (u16)coefs[k / 2][k % 2], 2);
+        }
+        putBE(bank->spt, 0, 2); // gain
+        putBE(bank->spt, sounds[i].type <= 1 ? bank->spd[offsets[i]] : 0, 2);
+        putBE(bank->spt, 0, 4); // yn1, yn2
+        putBE(bank->spt, sounds[i].type <= 1 ? bank->spd[offsets[i]] : 0, 2);
+        putBE(bank->spt, 0, 4); // loop yn1, yn2
+    }
+}
+
+static int bank(int argc, char** argv) {
+    SoundBank soundBank;
+
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+
+    buildBank(&soundBank);
+    if (!writeFile(argv[2], soundBank.spt) || !writeFile(argv[3], soundBank.spd)) {
+        fprintf(stderr, "axmix: can't write %s or %s\n", argv[2], argv[3]);
+        return 1;
+    }
+    printf("4 sounds, %lu bytes of sample data\n", (u32)soundBank.spd.size());
+    return 0;
+}
+
+// A 100 ms feedback echo on aux A, the usual kind of menu reverb send
+static void echoCallback(void* data, void* context) {
+    int32_t** buffers = (int32_t**)data;
+    Echo* echo = (Echo*)context;
+    int32_t delayed;
+    u32 channel;
+    u32 position;
+    u32 i;
+
+    for (channel = 0; channel < 3; channel++) {
+        position = echo->position;
+        for (i = 0; i < AX_SAMPLES_PER_FRAME; i++) {
+            delayed = echo->delay[channel][position];
+            echo->delay[channel][position] = buffers[channel][i] + delayed * 3 / 8;
+            buffers[channel][i] = delayed;
+            position = position + 1 < ECHO_SAMPLES ? position + 1 : 0;
+        }
+    }
+    echo->position = (echo->position + AX_SAMPLES_PER_FRAME) % ECHO_SAMPLES;
+}
+
+typedef struct BenchResult {
+    double msPerFrame;
+    double usPerVoice; // voice processing only, from the AX profile
+    u32 crc;
+} BenchResult;
+
+// Keeps numVoices voices playing for numFrames: one-shots are restarted as they end, pitches and pans are spread
+// out, every other voice sends to an echo on aux A, and one voice has its pan moved every frame
+static void benchOnce(u32 numVoices, u32 numFrames, AXEmuImpl impl, BenchResult* result) {
+    static AXProfile profiles[64];
+    static Echo echo;
+    std::vector<s16> frame;
+    AXEmuStats stats;
+    AXVPb* moving;
+    double voiceSeconds;
+    u32 numProfiled;
+    u32 numProfiles;
+    u32 crc;
+    u32 i;
+    u32 n;
+
+    startAudio(impl);
+    AXEmuSetARAM(sARAM.data(), ARAM_SIZE);
+    memset(&echo, 0, sizeof(echo));
+    AXRegisterAuxACallback(echoCallback, &echo);
+    AXInitProfile(profiles, 64);
+
+    frame.resize(AX_SAMPLES_PER_FRAME * 2);
+    crc = 0;
+    n = 0;
+    moving = NULL;
+    voiceSeconds = 0.0;
+    numProfiled = 0;
+
+    for (i = 0; i < numFrames; i++) {
+        while (countVoices() < numVoices) {
+            moving = playSound(n % 4, 0.8f + 0.05f * (n % 9), -60, (n & 1) ? MIX_VOLUME_OFF : -120,
+                               (int)(n * 37 % 128));
+            n++;
+        }
+        MIXSetPan(moving, (int)(i % 128));
+
+        AXEmuRenderFrame(frame.data());
+        crc ^= crc32((const u8*)frame.data(), frame.size() * sizeof(s16)) + i;
+
+        if ((i & 63) == 63) {
+            numProfiles = AXGetProfile();
+            while (numProfiles > 0) {
+                numProfiles--;
+                voiceSeconds += (profiles[numProfiles].auxProcessingStart - profiles[numProfiles].axFrameStart) * 1e-9;
+                numProfiled += profiles[numProfiles].axNumVoices;
+            }
+        }
+    }
+
+    AXEmuGetStats(&stats);
+    result->msPerFrame = stats.renderSeconds * 1000.0 / stats.numFrames;
+    result->usPerVoice = numProfiled > 0 ? voiceSeconds * 1e6 / numProfiled : 0.0;
+    result->crc = crc;
+    AXRegisterAuxACallback(NULL, NULL);
+}
+
+static int bench(int argc, char** argv) {
+    static const u32 voiceCounts[] = {16, 32, 48, 64};
+    SoundBank soundBank;
+    BenchResult scalar;
+    BenchResult avx2;
+    BenchResult best;
+    u32 numFrames;
+    u32 i;
+    bool ok;
+
+    numFrames = argc > 2 ? (u32)atoi(argv[2]) : 2000;
+    if (numFrames == 0) {
+        numFrames = 1;
+    }
+
+    buildBank(&soundBank);
+    startAudio(AXEMU_IMPL_AUTO);
+    loadBank(&soundBank);
+    printf("%lu frames (%.1f s of audio) per run, 5 ms budget per frame\n", numFrames, numFrames / 200.0);
+    printf("voices  scalar ms/frame  avx2 ms/frame  realtime  us/voice\n");
+
+    ok = true;
+    for (i = 0; i < sizeof(voiceCounts) / sizeof(voiceCounts[0]); i++) {
+        benchOnce(voiceCounts[i], numFrames, AXEMU_IMPL_SCALAR, &scalar);
+        best = scalar;
+        if (AXEmuHaveAVX2()) {
+            benchOnce(voiceCounts[i], numFrames, AXEMU_IMPL_AVX2, &avx2);
+            ok &= avx2.crc == scalar.crc;
+            best = avx2;
+            printf("%6lu  %15.4f  %13.4f  %7.0fx  %8.2f\n", voiceCounts[i], scalar.msPerFrame, avx2.msPerFrame,
+                   5.0 / avx2.msPerFrame, avx2.usPerVoice);
+        } else {
+            printf("%6lu  %15.4f  %13s  %7.0fx  %8.2f\n", voiceCounts[i], scalar.msPerFrame, "-",
+                   5.0 / scalar.msPerFrame, scalar.usPerVoice);
+        }
+    }
+
+    // AX can't go past AX_MAX_VOICES; this is how far the per-voice cost alone would allow
+    printf("voice budget at %.2f us per voice: %.0f voices per 5 ms frame\n", best.usPerVoice,
+           best.usPerVoice > 0.0 ? 5000.0 / best.usPerVoice : 0.0);
+
+    if (!ok) {
+        printf("rendered output differs between the implementations\n");
+        return 1;
+    }
+    printf("all implementations render identical output\n");
+    return 0;
+}
+
+static double measureRMS(u32 channel, u32 skipFrames, u32 numFrames) {
+    std::vector<s16> frame;
+    double sum;
+    u32 i;
+    u32 k;
+
+    frame.resize(AX_SAMPLES_PER_FRAME * 2);
+    sum = 0.0;
+    for (i = 0; i < skipFrames + numFrames; i++) {
+        AXEmuRenderFrame(frame.data());
+        for (k = 0; i >= skipFrames && k < AX_SAMPLES_PER_FRAME; k++) {
+            sum += (double)frame[k * 2 + channel] * frame[k * 2 + channel];
+        }
+    }
+    return sqrt(sum / (numFrames * AX_SAMPLES_PER_FRAME));
+}
+
+static int test(int argc, char** argv) {
+    static const u32 srcTypes[] = {AX_SRC_TYPE_NONE, AX_SRC_TYPE_LINEAR, AX_SRC_TYPE_4TAP_16K};
+    static const char* srcNames[] = {"none", "linear", "4-tap"};
+    SoundBank soundBank;
+    BenchResult scalar;
+    BenchResult avx2;
+    AXEmuStats stats;
+    AXVPb* voice;
+    AXVPb* held[AX_MAX_VOICES];
+    double expected;
+    double rms;
+    u32 frames;
+    bool ok;
+    u32 i;
+
+    ok = true;
+    buildBank(&soundBank);
+    startAudio(AXEMU_IMPL_AUTO);
+    if (!loadBank(&soundBank)) {
+        printf("bank doesn't load\n");
+        return 1;
+    }
+
+    // the PCM16 saw loop at its own rate, centered at 0 dB: each side gets it 3 dB down
+    expected = 0.0;
+    for (i = 0; i < 320; i++) {
+        expected += pow(((s32)(i * 65536 / 320) - 32768) / 3 * 0.70795, 2.0);
+    }
+    expected = sqrt(expected / 320);
+    for (i = 0; i < 3; i++) {
+        startAudio(AXEMU_IMPL_AUTO);
+        voice = playSound(2, 32000.0f / 48000.0f, 0, MIX_VOLUME_OFF, 0x40);
+        AXSetVoiceSrcType(voice, srcTypes[i]);
+        rms = measureRMS(0, 4, 200);
+        printf("src %-6s: level %+.2f dB\n", srcNames[i], 20.0 * log10(rms / expected));
+        ok &= fabs(20.0 * log10(rms / expected)) < 0.5;
+    }
+
+    // a one-shot stops on its own and the callback frees it; the ADPCM chime lasts 600 ms
+    startAudio(AXEMU_IMPL_AUTO);
+    playSound(0, 1.0f, 0, MIX_VOLUME_OFF, 0x40);
+    for (frames = 0; frames < 400 && countVoices() != 0; frames++) {
+        measureRMS(0, 0, 1);
+    }
+    printf("one-shot ended after %lu frames\n", frames);
+    ok &= frames >= 119 && frames <= 122;
+
+    // priorities: a full voice table gives up its lowest voice to a higher priority request only
+    startAudio(AXEMU_IMPL_AUTO);
+    for (i = 0; i < AX_MAX_VOICES; i++) {
+        held[i] = AXAcquireVoice(10 + (i == 5 ? 0 : 1), NULL, i);
+        ok &= held[i] != NULL;
+    }
+    ok &= AXAcquireVoice(10, NULL, 0) == NULL;
+    voice = AXAcquireVoice(20, NULL, 0);
+    AXEmuGetStats(&stats);
+    printf("voice stealing: %s, %lu dropped, %lu starved\n", voice == held[5] ? "lowest priority taken" : "WRONG",
+           stats.numDropped, stats.numStarved);
+    ok &= voice == held[5] && stats.numDropped == 1 && stats.numStarved == 1;
+
+    if (AXEmuHaveAVX2()) {
+        loadBank(&soundBank);
+        benchOnce(AX_MAX_VOICES, 400, AXEMU_IMPL_SCALAR, &scalar);
+        benchOnce(AX_MAX_VOICES, 400, AXEMU_IMPL_AVX2, &avx2);
+        printf("scalar and avx2 output %s\n", scalar.crc == avx2.crc ? "identical" : "DIFFER");
+        ok &= scalar.crc == avx2.crc;
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"render", render},
+    {"bank", bank},
+    {"bench", bench},
+    {"test", test},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
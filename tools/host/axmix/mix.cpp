@@ -0,0 +1,356 @@
+#include "axmix.h"
+
+#include <math.h>
+#include <string.h>
+
+// MIX keeps every level in 0.1 dB. Volumes are looked up in a table covering -90.4 dB to +6.0 dB; anything lower is
+// silence. Pan and span go through a constant power table of attenuations indexed 0..127.
+
+#define MIX_VOLUME_MIN -904
+#define MIX_VOLUME_MAX 60
+
+static MIXChannel sChannels[AX_MAX_VOICES];
+static u16 sVolumeTable[MIX_VOLUME_MAX - MIX_VOLUME_MIN + 1];
+static int sPanTable[128];
+static int sDvdStreamFader;
+
+static u16 MIXGetVolume(int dB) {
+    if (dB <= MIX_VOLUME_MIN) {
+        return 0;
+    }
+    if (dB >= MIX_VOLUME_MAX) {
+        return sVolumeTable[MIX_VOLUME_MAX - MIX_VOLUME_MIN];
+    }
+    return sVolumeTable[dB - MIX_VOLUME_MIN];
+}
+
+static int MIXClampPan(int pan) {
+    if (pan < 0) {
+        return 0;
+    }
+    if (pan > 127) {
+        return 127;
+    }
+    return pan;
+}
+
+// Splits pan and span into the left/right and front/back attenuations
+static void MIXSetPanAttenuation(MIXChannel* channel) {
+    channel->pan = MIXClampPan(channel->pan);
+    channel->span = MIXClampPan(channel->span);
+    channel->l = sPanTable[channel->pan];
+    channel->r = sPanTable[127 - channel->pan];
+    channel->f = sPanTable[127 - channel->span];
+    channel->b = sPanTable[channel->span];
+}
+
+// Computes the volumes the channel's settings ask for. Without surround output the span is ignored and nothing
+// goes to the S buses.
+static void MIXComputeVolumes(MIXChannel* channel) {
+    BOOL surround;
+    int fader;
+    int auxA;
+    int auxB;
+    int l;
+    int r;
+
+    surround = AXGetMode() != AX_MODE_STEREO;
+    l = channel->l + (surround ? channel->f : 0);
+    r = channel->r + (surround ? channel->f : 0);
+
+    channel->v = MIXGetVolume(channel->input);
+
+    if (channel->mode & MIX_MODE_MUTE) {
+        channel->vL = channel->vR = channel->vS = 0;
+        channel->vAL = channel->vAR = channel->vAS = 0;
+        channel->vBL = channel->vBR = channel->vBS = 0;
+        return;
+    }
+
+    fader = channel->fader;
+    auxA = channel->auxA + ((channel->mode & MIX_MODE_AUXA_PREFADER) ? 0 : fader);
+    auxB = channel->auxB + ((channel->mode & MIX_MODE_AUXB_PREFADER) ? 0 : fader);
+
+    channel->vL = MIXGetVolume(fader + l);
+    channel->vR = MIXGetVolume(fader + r);
+    channel->vS = surround ? MIXGetVolume(fader + channel->b) : 0;
+    channel->vAL = MIXGetVolume(auxA + l);
+    channel->vAR = MIXGetVolume(auxA + r);
+    channel->vAS = surround ? MIXGetVolume(auxA + channel->b) : 0;
+    channel->vBL = MIXGetVolume(auxB + l);
+    channel->vBR = MIXGetVolume(auxB + r);
+    channel->vBS = surround ? MIXGetVolume(auxB + channel->b) : 0;
+}
+
+static s16 MIXGetDelta(u16 from, u16 to) { return (s16)(((s32)to - (s32)from) / AX_SAMPLES_PER_FRAME); }
+
+// Writes the mix with each volume ramping from vX1 to vX over the next frame
+static void MIXWriteMix(MIXChannel* channel, BOOL ramp) {
+    AXPbMix mix;
+
+    mix.vL = ramp ? channel->vL1 : channel->vL;
+    mix.vDeltaL = ramp ? MIXGetDelta(channel->vL1, channel->vL) : 0;
+    mix.vR = ramp ? channel->vR1 : channel->vR;
+    mix.vDeltaR = ramp ? MIXGetDelta(channel->vR1, channel->vR) : 0;
+    mix.vS = ramp ? channel->vS1 : channel->vS;
+    mix.vDeltaS = ramp ? MIXGetDelta(channel->vS1, channel->vS) : 0;
+    mix.vAuxAL = ramp ? channel->vAL1 : channel->vAL;
+    mix.vDeltaAuxAL = ramp ? MIXGetDelta(channel->vAL1, channel->vAL) : 0;
+    mix.vAuxAR = ramp ? channel->vAR1 : channel->vAR;
+    mix.vDeltaAuxAR = ramp ? MIXGetDelta(channel->vAR1, channel->vAR) : 0;
+    mix.vAuxAS = ramp ? channel->vAS1 : channel->vAS;
+    mix.vDeltaAuxAS = ramp ? MIXGetDelta(channel->vAS1, channel->vAS) : 0;
+    mix.vAuxBL = ramp ? channel->vBL1 : channel->vBL;
+    mix.vDeltaAuxBL = ramp ? MIXGetDelta(channel->vBL1, channel->vBL) : 0;
+    mix.vAuxBR = ramp ? channel->vBR1 : channel->vBR;
+    mix.vDeltaAuxBR = ramp ? MIXGetDelta(channel->vBR1, channel->vBR) : 0;
+    mix.vAuxBS = ramp ? channel->vBS1 : channel->vBS;
+    mix.vDeltaAuxBS = ramp ? MIXGetDelta(channel->vBS1, channel->vBS) : 0;
+
+    AXSetVoiceMix(channel->axvpb, &mix);
+}
+
+static void MIXWriteInput(MIXChannel* channel, BOOL ramp) {
+    AXPbVe ve;
+
+    ve.currentVolume = ramp ? channel->v1 : channel->v;
+    ve.currentDelta = ramp ? MIXGetDelta(channel->v1, channel->v) : 0;
+    AXSetVoiceVe(channel->axvpb, &ve);
+}
+
+static void MIXSaveVolumes(MIXChannel* channel) {
+    channel->v1 = channel->v;
+    channel->vL1 = channel->vL;
+    channel->vR1 = channel->vR;
+    channel->vS1 = channel->vS;
+    channel->vAL1 = channel->vAL;
+    channel->vAR1 = channel->vAR;
+    channel->vAS1 = channel->vAS;
+    channel->vBL1 = channel->vBL;
+    channel->vBR1 = channel->vBR;
+    channel->vBS1 = channel->vBS;
+}
+
+static MIXChannel* MIXGetChannel(AXVPb* p) { return &sChannels[p->index]; }
+
+extern "C" {
+void MIXInit(void) {
+    u32 i;
+
+    for (i = 0; i < sizeof(sVolumeTable) / sizeof(sVolumeTable[0]); i++) {
+        sVolumeTable[i] = (u16)lrint(32768.0 * pow(10.0, (MIX_VOLUME_MIN + (s32)i) / 200.0));
+    }
+
+    for (i = 0; i < 128; i++) {
+        sPanTable[i] = i == 127 ? MIX_VOLUME_OFF : (int)lrint(200.0 * log10(cos(i / 127.0 * M_PI / 2.0)));
+        if (sPanTable[i] < MIX_VOLUME_OFF) {
+            sPanTable[i] = MIX_VOLUME_OFF;
+        }
+    }
+
+    memset(sChannels, 0, sizeof(sChannels));
+    sDvdStreamFader = 0;
+}
+
+void MIXQuit(void) {}
+
+void MIXInitChannel(AXVPb* axvpb, u32 mode, int input, int auxA, int auxB, int pan, int span, int fader) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(axvpb);
+    channel->axvpb = axvpb;
+    channel->mode = mode & (MIX_MODE_AUXA_PREFADER | MIX_MODE_AUXB_PREFADER | MIX_MODE_MUTE);
+    channel->input = input;
+    channel->auxA = auxA;
+    channel->auxB = auxB;
+    channel->pan = pan;
+    channel->span = span;
+    channel->fader = fader;
+    MIXSetPanAttenuation(channel);
+    MIXComputeVolumes(channel);
+    MIXSaveVolumes(channel);
+
+    MIXWriteInput(channel, false);
+    MIXWriteMix(channel, false);
+}
+
+void MIXReleaseChannel(AXVPb* axvpb) { MIXGetChannel(axvpb)->axvpb = NULL; }
+
+void MIXResetControls(AXVPb* p) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->mode &= ~(MIX_MODE_AUXA_PREFADER | MIX_MODE_AUXB_PREFADER | MIX_MODE_MUTE);
+    channel->input = 0;
+    channel->auxA = MIX_VOLUME_OFF;
+    channel->auxB = MIX_VOLUME_OFF;
+    channel->pan = 64;
+    channel->span = 127;
+    channel->fader = 0;
+    MIXSetPanAttenuation(channel);
+    channel->mode |= MIX_MODE_UPDATE_INPUT | MIX_MODE_UPDATE_MIX;
+}
+
+void MIXSetInput(AXVPb* p, int dB) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->input = dB;
+    channel->mode |= MIX_MODE_UPDATE_INPUT;
+}
+
+void MIXAdjustInput(AXVPb* p, int dB) { MIXSetInput(p, MIXGetInput(p) + dB); }
+
+int MIXGetInput(AXVPb* p) { return MIXGetChannel(p)->input; }
+
+void MIXAuxAPostFader(AXVPb* p) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->mode &= ~MIX_MODE_AUXA_PREFADER;
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAuxAPreFader(AXVPb* p) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->mode |= MIX_MODE_AUXA_PREFADER | MIX_MODE_UPDATE_MIX;
+}
+
+int MIXAuxAIsPostFader(AXVPb* p) { return (MIXGetChannel(p)->mode & MIX_MODE_AUXA_PREFADER) ? false : true; }
+
+void MIXSetAuxA(AXVPb* p, int dB) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->auxA = dB;
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAdjustAuxA(AXVPb* p, int dB) { MIXSetAuxA(p, MIXGetAuxA(p) + dB); }
+
+int MIXGetAuxA(AXVPb* p) { return MIXGetChannel(p)->auxA; }
+
+void MIXAuxBPostFader(AXVPb* p) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->mode &= ~MIX_MODE_AUXB_PREFADER;
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAuxBPreFader(AXVPb* p) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->mode |= MIX_MODE_AUXB_PREFADER | MIX_MODE_UPDATE_MIX;
+}
+
+int MIXAuxBIsPostFader(AXVPb* p) { return (MIXGetChannel(p)->mode & MIX_MODE_AUXB_PREFADER) ? false : true; }
+
+void MIXSetAuxB(AXVPb* p, int dB) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->auxB = dB;
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAdjustAuxB(AXVPb* p, int dB) { MIXSetAuxB(p, MIXGetAuxB(p) + dB); }
+
+int MIXGetAuxB(AXVPb* p) { return MIXGetChannel(p)->auxB; }
+
+void MIXSetPan(AXVPb* p, int pan) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->pan = pan;
+    MIXSetPanAttenuation(channel);
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAdjustPan(AXVPb* p, int pan) { MIXSetPan(p, MIXGetPan(p) + pan); }
+
+int MIXGetPan(AXVPb* p) { return MIXGetChannel(p)->pan; }
+
+void MIXSetSPan(AXVPb* p, int span) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->span = span;
+    MIXSetPanAttenuation(channel);
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAdjustSPan(AXVPb* p, int span) { MIXSetSPan(p, MIXGetSPan(p) + span); }
+
+int MIXGetSPan(AXVPb* p) { return MIXGetChannel(p)->span; }
+
+void MIXMute(AXVPb* p) { MIXGetChannel(p)->mode |= MIX_MODE_MUTE | MIX_MODE_UPDATE_MIX; }
+
+void MIXUnMute(AXVPb* p) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->mode &= ~MIX_MODE_MUTE;
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+int MIXIsMute(AXVPb* p) { return (MIXGetChannel(p)->mode & MIX_MODE_MUTE) ? true : false; }
+
+void MIXSetFader(AXVPb* p, int dB) {
+    MIXChannel* channel;
+
+    channel = MIXGetChannel(p);
+    channel->fader = dB;
+    channel->mode |= MIX_MODE_UPDATE_MIX;
+}
+
+void MIXAdjustFader(AXVPb* p, int dB) { MIXSetFader(p, MIXGetFader(p) + dB); }
+
+int MIXGetFader(AXVPb* p) { return MIXGetChannel(p)->fader; }
+
+// The console sets the AI stream volume from this; the host has no DTK output, it only remembers the level
+void MIXSetDvdStreamFader(int dB) { sDvdStreamFader = dB; }
+
+int MIXGetDvdStreamFader(void) { return sDvdStreamFader; }
+
+// Call once per frame from the AX user callback. A change ramps over one frame; the update after that settles the
+// volume on its target and clears the delta, so rounding in the delta never accumulates.
+void MIXUpdateSettings(void) {
+    MIXChannel* channel;
+    u32 i;
+
+    for (i = 0; i < AX_MAX_VOICES; i++) {
+        channel = &sChannels[i];
+        if (channel->axvpb == NULL) {
+            continue;
+        }
+
+        if (channel->mode & MIX_MODE_UPDATE_INPUT1) {
+            channel->mode &= ~MIX_MODE_UPDATE_INPUT1;
+            MIXWriteInput(channel, false);
+        }
+        if (channel->mode & MIX_MODE_UPDATE_MIX1) {
+            channel->mode &= ~MIX_MODE_UPDATE_MIX1;
+            MIXWriteMix(channel, false);
+        }
+
+        if (channel->mode & (MIX_MODE_UPDATE_INPUT | MIX_MODE_UPDATE_MIX)) {
+            MIXSaveVolumes(channel);
+            MIXComputeVolumes(channel);
+
+            if (channel->mode & MIX_MODE_UPDATE_INPUT) {
+                MIXWriteInput(channel, true);
+                channel->mode |= MIX_MODE_UPDATE_INPUT1;
+            }
+            if (channel->mode & MIX_MODE_UPDATE_MIX) {
+                MIXWriteMix(channel, true);
+                channel->mode |= MIX_MODE_UPDATE_MIX1;
+            }
+            channel->mode &= ~(MIX_MODE_UPDATE_INPUT | MIX_MODE_UPDATE_MIX);
+        }
+    }
+}
+}
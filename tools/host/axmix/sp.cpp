@@ -0,0 +1,197 @@
+#include "axmix.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// On disc a table is a big-endian entry count followed by 0x1C-byte entries; the adpcm field is an offset from the
+// start of the table to a 0x2E-byte block of coefficients, initial context and loop context.
+
+#define SP_TYPE_ADPCM_ONESHOT 0
+#define SP_TYPE_ADPCM_LOOPED 1
+#define SP_TYPE_PCM16_ONESHOT 2
+#define SP_TYPE_PCM16_LOOPED 3
+#define SP_TYPE_PCM8_ONESHOT 4
+#define SP_TYPE_PCM8_LOOPED 5
+
+#define SP_DISC_SOUND_SIZE 0x1C
+#define SP_DISC_ADPCM_SIZE 0x2E
+
+static u32 sZeroBase;
+
+static inline u16 SPEmuRead16(const u8* data) { return (u16)((data[0] << 8) | data[1]); }
+
+static inline u32 SPEmuRead32(const u8* data) {
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | data[3];
+}
+
+static void SPEmuParseAdpcm(const u8* data, SPAdpcmEntry* entry) {
+    u32 i;
+
+    for (i = 0; i < 16; i++) {
+        entry->adpcm.a[i / 2][i % 2] = SPEmuRead16(&data[i * 2]);
+    }
+    entry->adpcm.gain = SPEmuRead16(&data[0x20]);
+    entry->adpcm.pred_scale = SPEmuRead16(&data[0x22]);
+    entry->adpcm.yn1 = SPEmuRead16(&data[0x24]);
+    entry->adpcm.yn2 = SPEmuRead16(&data[0x26]);
+    entry->adpcmloop.loop_pred_scale = SPEmuRead16(&data[0x28]);
+    entry->adpcmloop.loop_yn1 = SPEmuRead16(&data[0x2A]);
+    entry->adpcmloop.loop_yn2 = SPEmuRead16(&data[0x2C]);
+}
+
+extern "C" {
+SPSoundTable* SPEmuLoadTable(const u8* data, u32 size) {
+    SPSoundTable* table;
+    SPSoundEntry* sound;
+    SPAdpcmEntry* adpcm;
+    const u8* entry;
+    u32 numEntries;
+    u32 offset;
+    u32 i;
+
+    if (size < 4) {
+        return NULL;
+    }
+    numEntries = SPEmuRead32(data);
+    if ((u64)numEntries * SP_DISC_SOUND_SIZE + 4 > size) {
+        return NULL;
+    }
+
+    // entries, then one ADPCM block per entry, in a single allocation like the loaded file on the console
+    table = (SPSoundTable*)calloc(1, offsetof(SPSoundTable, sound) + (numEntries + 1) * sizeof(SPSoundEntry) +
+                                         numEntries * sizeof(SPAdpcmEntry));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->entries = numEntries;
+    adpcm = (SPAdpcmEntry*)(&table->sound + numEntries + 1);
+
+    for (i = 0; i < numEntries; i++) {
+        entry = &data[4 + i * SP_DISC_SOUND_SIZE];
+        sound = &(&table->sound)[i];
+        sound->type = SPEmuRead32(&entry[0x00]);
+        sound->sampleRate = SPEmuRead32(&entry[0x04]);
+        sound->loopAddr = SPEmuRead32(&entry[0x08]);
+        sound->loopEndAddr = SPEmuRead32(&entry[0x0C]);
+        sound->endAddr = SPEmuRead32(&entry[0x10]);
+        sound->currentAddr = SPEmuRead32(&entry[0x14]);
+        sound->adpcm = &adpcm[i];
+
+        if (sound->type > SP_TYPE_PCM8_LOOPED) {
+            free(table);
+            return NULL;
+        }
+
+        if (sound->type <= SP_TYPE_ADPCM_LOOPED) {
+            offset = SPEmuRead32(&entry[0x18]);
+            if ((u64)offset + SP_DISC_ADPCM_SIZE > size) {
+                free(table);
+                return NULL;
+            }
+            SPEmuParseAdpcm(&data[offset], sound->adpcm);
+        }
+    }
+
+    return table;
+}
+
+u32 SPEmuGetNumEntries(const SPSoundTable* table) { return table->entries; }
+
+void SPInitSoundTable(SPSoundTable* table, u32 aramBase, u32 zeroBase) {
+    SPSoundEntry* sound;
+    u32 base;
+    u32 i;
+
+    for (i = 0; i < table->entries; i++) {
+        sound = &(&table->sound)[i];
+
+        // sample addresses count nibbles for ADPCM, samples for PCM16 and bytes for PCM8
+        switch (sound->type) {
+            case SP_TYPE_ADPCM_ONESHOT:
+            case SP_TYPE_ADPCM_LOOPED:
+                base = aramBase * 2;
+                break;
+            case SP_TYPE_PCM16_ONESHOT:
+            case SP_TYPE_PCM16_LOOPED:
+                base = aramBase / 2;
+                break;
+            default:
+                base = aramBase;
+                break;
+        }
+
+        sound->loopAddr += base;
+        sound->loopEndAddr += base;
+        sound->endAddr += base;
+        sound->currentAddr += base;
+    }
+
+    sZeroBase = zeroBase;
+}
+
+SPSoundEntry* SPGetSoundEntry(SPSoundTable* table, u32 index) {
+    if (index >= table->entries) {
+        return NULL;
+    }
+    return &(&table->sound)[index];
+}
+
+// One-shots loop into the zero buffer, so a voice that runs past its end before the stop lands on silence
+void SPPrepareSound(SPSoundEntry* sound, AXVPb* axvpb, u32 sampleRate) {
+    AXPbAddr addr;
+    AXPbADPCM adpcm;
+    AXPbSrc src;
+    u32 ratio;
+    u32 address;
+
+    memset(&adpcm, 0, sizeof(adpcm));
+    memset(&src, 0, sizeof(src));
+    ratio = (u32)(0x10000 * ((f32)sampleRate / AX_SAMPLE_RATE));
+    src.ratioHi = (u16)(ratio >> 16);
+    src.ratioLo = (u16)ratio;
+
+    addr.loopFlag = sound->type & 1;
+    switch (sound->type) {
+        case SP_TYPE_ADPCM_ONESHOT:
+        case SP_TYPE_ADPCM_LOOPED:
+            addr.format = AX_PB_FORMAT_ADPCM;
+            adpcm = sound->adpcm->adpcm;
+            address = addr.loopFlag ? sound->loopAddr : sZeroBase * 2;
+            break;
+        case SP_TYPE_PCM16_ONESHOT:
+        case SP_TYPE_PCM16_LOOPED:
+            addr.format = AX_PB_FORMAT_PCM16;
+            adpcm.gain = 0x0800;
+            address = addr.loopFlag ? sound->loopAddr : sZeroBase / 2;
+            break;
+        default:
+            addr.format = AX_PB_FORMAT_PCM8;
+            adpcm.gain = 0x0100;
+            address = addr.loopFlag ? sound->loopAddr : sZeroBase;
+            break;
+    }
+
+    addr.loopAddressHi = (u16)(address >> 16);
+    addr.loopAddressLo = (u16)address;
+    address = addr.loopFlag ? sound->loopEndAddr : sound->endAddr;
+    addr.endAddressHi = (u16)(address >> 16);
+    addr.endAddressLo = (u16)address;
+    addr.currentAddressHi = (u16)(sound->currentAddr >> 16);
+    addr.currentAddressLo = (u16)sound->currentAddr;
+
+    AXSetVoiceType(axvpb, AX_PB_TYPE_NORMAL);
+    AXSetVoiceAddr(axvpb, &addr);
+    AXSetVoiceAdpcm(axvpb, &adpcm);
+    AXSetVoiceSrc(axvpb, &src);
+    if (sound->type == SP_TYPE_ADPCM_LOOPED) {
+        AXSetVoiceAdpcmLoop(axvpb, &sound->adpcm->adpcmloop);
+    }
+}
+
+// Lets a looped sound play out: the loop is switched off and the voice runs on to the real end of the sample
+void SPPrepareEnd(SPSoundEntry* sound, AXVPb* axvpb) {
+    AXSetVoiceLoop(axvpb, 0);
+    AXSetVoiceEndAddr(axvpb, sound->endAddr);
+}
+}
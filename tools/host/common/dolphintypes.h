@@ -0,0 +1,48 @@
+#ifndef _HOST_DOLPHINTYPES_H
+#define _HOST_DOLPHINTYPES_H
+
+// dolphin/types.h with the console's type widths (see common/types.h), for the tools whose console code is plain
+// 32-bit arithmetic: forced in with -include common/dolphintypes.h, it takes that header's include guard. Code that
+// keeps pointers in a u32, like the heaps, doesn't build with it and stays on the `long` types.
+
+#define _DOLPHIN_TYPES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t s8;
+typedef uint8_t u8;
+typedef int16_t s16;
+typedef uint16_t u16;
+typedef int32_t s32;
+typedef uint32_t u32;
+typedef int64_t s64;
+typedef uint64_t u64;
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+typedef volatile s8 vs8;
+typedef volatile s16 vs16;
+typedef volatile s32 vs32;
+typedef volatile s64 vs64;
+
+typedef float f32;
+typedef double f64;
+
+typedef volatile f32 vf32;
+typedef volatile f64 vf64;
+
+typedef int BOOL;
+typedef unsigned int uint;
+
+#ifndef __cplusplus
+#define false 0
+#define true 1
+#endif
+
+#define NULL_PTR (void*)0
+
+#endif
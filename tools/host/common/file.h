@@ -0,0 +1,45 @@
+#ifndef _HOST_FILE_H
+#define _HOST_FILE_H
+
+// Whole-file reads and writes for the tools' commands. Apart from common/test.h because it needs <vector>.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// false if path can't be opened or read in full
+static inline bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file;
+    long size;
+    bool ok;
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    ok = size >= 0;
+    if (ok) {
+        data.resize(size);
+        ok = size == 0 || fread(data.data(), 1, size, file) == (size_t)size;
+    }
+    fclose(file);
+    return ok;
+}
+
+static inline bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* file;
+    bool ok;
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok &= fclose(file) == 0;
+    return ok;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _HOST_HOSTMACROS_H
+#define _HOST_HOSTMACROS_H
+
+// Forced into every translation unit (-include common/hostmacros.h) of the tools that link several files including
+// the SDK headers, or build SDK C files. Off MWCC, AT_ADDRESS leaves the hardware registers and OS globals those
+// headers declare as plain definitions, one per file; weak ones let the linker fold them into a single object.
+
+#include "macros.h"
+
+#undef AT_ADDRESS
+#define AT_ADDRESS(xyz) __attribute__((weak))
+
+// arq.c calls these without including dolphin/os.h, which MWCC lets through; C99 compilers warn about it
+#ifndef __cplusplus
+#include "dolphin/types.h"
+
+void OSRegisterVersion(const char* id);
+BOOL OSDisableInterrupts(void);
+BOOL OSRestoreInterrupts(BOOL level);
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+
+// What the tools' test and bench commands share: checks, a checksum for comparing outputs, a repeatable generator
+// for test data, and the command dispatch of their mains. Only C headers are included, so the tools whose files
+// include JKRHeap.h, whose operator new and delete clash with the C++ library headers, can use it too. Types are
+// the fixed-width ones, which agree with both common/types.h and dolphin/types.h.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct HostCommand {
+    const char* name;
+    int (*run)(int argc, char** argv);
+} HostCommand;
+
+static uint32_t sRandomSeed = 1;
+
+// Prints what failed and passes cond through, so a test can go on and report every failure
+static inline bool expect(bool cond, const char* what) {
+    if (!cond) {
+        printf("FAIL: %s\n", what);
+    }
+    return cond;
+}
+
+// CRC-32 (zlib's); pass the last result as crc to continue it over another block
+static inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    uint32_t value;
+    uint32_t i;
+    uint32_t k;
+
+    if (table[1] == 0) {
+        for (i = 0; i < 256; i++) {
+            value = i;
+            for (k = 0; k < 8; k++) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320 : value >> 1;
+            }
+            table[i] = value;
+        }
+    }
+
+    crc = ~crc;
+    while (size-- > 0) {
+        crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// 24 random bits from an LCG; the same seed gives the same data on every host
+static inline void seedRandom32(uint32_t seed) { sRandomSeed = seed; }
+
+static inline uint32_t random32(void) {
+    sRandomSeed = sRandomSeed * 1103515245 + 12345;
+    return sRandomSeed >> 8;
+}
+
+// Runs the command argv[1] names from commands, which ends in a NULL name, or calls usage and returns 1
+static inline int runCommand(const HostCommand* commands, int argc, char** argv, void (*usage)(void)) {
+    const HostCommand* command;
+
+    if (argc >= 2) {
+        for (command = commands; command->name != NULL; command++) {
+            if (strcmp(argv[1], command->name) == 0) {
+                return command->run(argc, argv);
+            }
+        }
+    }
+    usage();
+    return 1;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _HOST_TYPES_H
+#define _HOST_TYPES_H
+
+// Host-side equivalent of dolphin/types.h. That header spells the 32-bit types `long`, which is 64 bits wide on LP64
+// hosts, so host code that lays out or parses console data uses these fixed-width typedefs instead. Tools that build
+// console sources either force in common/dolphintypes.h, which gives dolphin/types.h these widths too, or, where the
+// console code keeps pointers in a u32 (the heaps, aramemu), stay on the `long` types and keep the console headers in
+// files of their own, with fixed-width types only on the host side.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t s8;
+typedef uint8_t u8;
+typedef int16_t s16;
+typedef uint16_t u16;
+typedef int32_t s32;
+typedef uint32_t u32;
+typedef int64_t s64;
+typedef uint64_t u64;
+
+typedef float f32;
+typedef double f64;
+
+#define ALIGN_PREV(X, N) ((X) & ~((N) - 1))
+#define ALIGN_NEXT(X, N) ALIGN_PREV(((X) + (N) - 1), N)
+
+#define ARRAY_COUNT(arr) (s32)(sizeof(arr) / sizeof(arr[0]))
+
+static inline u16 host_be16(const u8* p) { return (u16)((p[0] << 8) | p[1]); }
+static inline u32 host_be32(const u8* p) { return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3]; }
+
+static inline void host_put_be16(u8* p, u16 v) {
+    p[0] = (u8)(v >> 8);
+    p[1] = (u8)v;
+}
+
+static inline void host_put_be32(u8* p, u32 v) {
+    p[0] = (u8)(v >> 24);
+    p[1] = (u8)(v >> 16);
+    p[2] = (u8)(v >> 8);
+    p[3] = (u8)v;
+}
+
+#endif
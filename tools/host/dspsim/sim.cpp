@@ -0,0 +1,522 @@
+// Host simulation of the DSP task switch protocol, driving the SDK scheduler (src/dolphin/dsp/dsp_task.c) and the
+// extended one (src/dolphin/dsp/dspx.c) with the same task set. Time is virtual and measured in OS timer ticks.
+// The mailbox stub charges every DSPCheckMailToDSP poll to the CPU and lets the modeled DSP pick a word up a fixed
+// time after it was written, so the cost of spinning in the interrupt handler shows up as CPU time.
+
+#include "dolphin/dspx.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define SIM_BUS_CLOCK 162000000
+#define SIM_TIMER_CLOCK (SIM_BUS_CLOCK / 4)
+#define SIM_US(us) ((s64)((us) * (SIM_TIMER_CLOCK / 1000000.0)))
+#define SIM_NEVER 0x7FFFFFFFFFFFFFFFLL
+
+#define SIM_DSP_READY_MAIL 0x8071FEED
+
+extern "C" {
+void __DSP_insert_task(DSPTaskInfo* task);
+void __DSP_boot_task(DSPTaskInfo* task);
+}
+
+typedef enum SimDSPState {
+    SIM_DSP_RESET, // ready mail posted, collecting the boot words
+    SIM_DSP_LOADING,
+    SIM_DSP_RUNNING,
+    SIM_DSP_WAIT_ACK,
+    SIM_DSP_WAIT_EXEC,
+    SIM_DSP_HALTED,
+} SimDSPState;
+
+typedef struct SimTask {
+    DSPTaskInfo info;
+    const char* name;
+    u32 priority;
+    s64 addAt;
+    s64 slice;
+    s64 work;
+    s64 remaining;
+    s64 ran;
+    bool started;
+    u32 numDone;
+    u16 iram; // its address identifies the task in the exec words
+} SimTask;
+
+typedef struct SimResult {
+    s64 end;
+    s64 cpuTicks;
+    s64 idleTicks;
+    s64 maxIdleTicks;
+    u32 numSwitches;
+    u32 numInterrupts;
+    u32 numAlarms;
+    u32 numPolls;
+} SimResult;
+
+// cost model
+static s64 sPollTicks;
+static s64 sMailReadTicks;
+static s64 sInterruptTicks;
+static f64 sDMABytesPerTick;
+
+static s64 sNow;
+static SimResult sResult;
+static __OSInterruptHandler sHandler;
+static u32 sProtocolErrors;
+
+// mailboxes
+static bool sToDSPFull;
+static u32 sToDSP;
+static s64 sToDSPWritten;
+static bool sFromDSPFull;
+static u32 sFromDSP;
+static bool sInterruptPending;
+static s64 sInterruptAt;
+
+// DSP side
+static SimDSPState sDSPState;
+static s64 sDSPEventAt;
+static s64 sDSPIdleSince;
+static s64 sDSPRunStart;
+static SimTask* sDSPTask;
+static u32 sWords[10];
+static u32 sNumWords;
+
+static OSAlarm* sAlarm;
+
+static std::vector<SimTask> sTasks;
+
+extern "C" {
+s64 OSGetTime(void) { return sNow; }
+OSTick OSGetTick(void) { return (OSTick)sNow; }
+BOOL OSDisableInterrupts(void) { return 1; }
+BOOL OSRestoreInterrupts(BOOL level) { return level; }
+void OSClearContext(OSContext* context) {}
+void OSSetCurrentContext(OSContext* context) {}
+void OSRegisterVersion(const char* id) {}
+void DSPInit(void) {}
+void __DSP_debug_printf(const char* fmt, ...) {}
+
+void OSReport(const char* msg, ...) {
+    va_list args;
+
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+}
+
+__OSInterruptHandler __OSSetInterruptHandler(__OSInterrupt interrupt, __OSInterruptHandler handler) {
+    __OSInterruptHandler old = sHandler;
+
+    sHandler = handler;
+    return old;
+}
+
+void OSCreateAlarm(OSAlarm* alarm) { alarm->handler = NULL; }
+
+void OSSetAlarm(OSAlarm* alarm, OSTime tick, OSAlarmHandler handler) {
+    alarm->handler = handler;
+    alarm->fire = sNow + tick;
+    sAlarm = alarm;
+}
+
+void OSCancelAlarm(OSAlarm* alarm) {
+    if (sAlarm == alarm) {
+        sAlarm = NULL;
+    }
+}
+}
+
+static void simPostMail(u32 mail, s64 time) {
+    if (sFromDSPFull && sFromDSP != SIM_DSP_READY_MAIL) {
+        sProtocolErrors++;
+    }
+
+    sFromDSP = mail;
+    sFromDSPFull = true;
+    sInterruptPending = true;
+    sInterruptAt = time;
+}
+
+static SimTask* simFindTask(u32 iram) {
+    size_t i;
+
+    for (i = 0; i < sTasks.size(); i++) {
+        if ((u32)&sTasks[i].iram == iram) {
+            return &sTasks[i];
+        }
+    }
+
+    sProtocolErrors++;
+    return NULL;
+}
+
+static s64 simDMATicks(u32 bytes) { return (s64)(bytes / sDMABytesPerTick); }
+
+static void simRun(SimTask* task, s64 time) {
+    s64 run = task->remaining < task->slice ? task->remaining : task->slice;
+
+    if (sDSPIdleSince >= 0) {
+        sResult.idleTicks += time - sDSPIdleSince;
+        if (time - sDSPIdleSince > sResult.maxIdleTicks) {
+            sResult.maxIdleTicks = time - sDSPIdleSince;
+        }
+        sDSPIdleSince = -1;
+    }
+
+    sDSPTask = task;
+    sDSPState = SIM_DSP_RUNNING;
+    sDSPRunStart = time;
+    sDSPEventAt = time + run;
+}
+
+static void simReceive(u32 word, s64 time) {
+    SimTask* next;
+    u32 bytes;
+
+    switch (sDSPState) {
+        case SIM_DSP_RESET:
+            sWords[sNumWords++] = word;
+            if (sNumWords == 10) {
+                sNumWords = 0;
+                sDSPTask = simFindTask(sWords[1]);
+                sDSPState = SIM_DSP_LOADING;
+                sDSPEventAt = time + simDMATicks(sDSPTask != NULL ? sDSPTask->info.iram_length : 0);
+            }
+            break;
+        case SIM_DSP_WAIT_ACK:
+            if (word == 0xCDD10001) {
+                sDSPState = SIM_DSP_WAIT_EXEC;
+            } else if (word == 0xCDD10003) {
+                simRun(sDSPTask, time);
+            } else if (word == 0xCDD10002) {
+                sDSPState = SIM_DSP_HALTED;
+                sResult.end = time;
+            } else {
+                sProtocolErrors++;
+            }
+            break;
+        case SIM_DSP_WAIT_EXEC:
+            sWords[sNumWords++] = word;
+            if (sNumWords == 10) {
+                sNumWords = 0;
+                next = simFindTask(sWords[3]);
+                bytes = sWords[1] + sWords[4] + (next != NULL && next->started ? next->info.dram_length : 0);
+                sResult.numSwitches++;
+                sDSPTask = next;
+                sDSPState = SIM_DSP_LOADING;
+                sDSPEventAt = time + simDMATicks(bytes);
+            }
+            break;
+        default:
+            sProtocolErrors++;
+            break;
+    }
+}
+
+static void simEvent(s64 time) {
+    SimTask* task = sDSPTask;
+
+    if (sDSPState == SIM_DSP_LOADING) {
+        if (task == NULL) {
+            sDSPState = SIM_DSP_HALTED;
+            return;
+        }
+        simPostMail(task->started ? 0xDCD10001 : 0xDCD10000, time);
+        task->started = true;
+        simRun(task, time);
+        return;
+    }
+
+    // SIM_DSP_RUNNING: the slice is over, yield or report the task done
+    task->ran += time - sDSPRunStart;
+    task->remaining -= time - sDSPRunStart;
+    simPostMail(task->remaining == 0 ? 0xDCD10003 : 0xDCD10002, time);
+    sDSPState = SIM_DSP_WAIT_ACK;
+    sDSPIdleSince = time;
+}
+
+static bool simExpectsWords(void) {
+    return sDSPState == SIM_DSP_RESET || sDSPState == SIM_DSP_WAIT_ACK || sDSPState == SIM_DSP_WAIT_EXEC;
+}
+
+static s64 simNextDSPEvent(void) {
+    if (sToDSPFull && simExpectsWords()) {
+        return sToDSPWritten + sMailReadTicks;
+    }
+    if (sDSPState == SIM_DSP_LOADING || sDSPState == SIM_DSP_RUNNING) {
+        return sDSPEventAt;
+    }
+    return SIM_NEVER;
+}
+
+static void simAdvanceDSP(s64 time) {
+    s64 next;
+    u32 word;
+
+    while ((next = simNextDSPEvent()) <= time) {
+        if (sToDSPFull && simExpectsWords()) {
+            word = sToDSP;
+            sToDSPFull = false;
+            simReceive(word, next);
+        } else {
+            simEvent(next);
+        }
+    }
+}
+
+extern "C" {
+u32 DSPCheckMailToDSP(void) {
+    sNow += sPollTicks;
+    sResult.numPolls++;
+    simAdvanceDSP(sNow);
+    return sToDSPFull;
+}
+
+u32 DSPCheckMailFromDSP(void) {
+    sNow += sPollTicks;
+    simAdvanceDSP(sNow);
+    return sFromDSPFull;
+}
+
+u32 DSPReadMailFromDSP(void) {
+    sFromDSPFull = false;
+    return sFromDSP;
+}
+
+void DSPSendMailToDSP(u32 mail) {
+    if (sToDSPFull) {
+        sProtocolErrors++;
+    }
+
+    sToDSP = mail;
+    sToDSPFull = true;
+    sToDSPWritten = sNow;
+}
+}
+
+static void simDoneCallback(void* task) { ((SimTask*)task)->numDone++; }
+
+static void simBuildTasks(void) {
+    static const struct {
+        const char* name;
+        u32 priority;
+        f64 addAtUs;
+        f64 sliceUs;
+        f64 workUs;
+        u32 iramLength;
+        u32 dramLength;
+    } sSpecs[] = {
+        {"mix", 1, 0, 500, 40000, 0x2000, 0x2000},
+        {"decode", 1, 0, 1000, 30000, 0x1000, 0x4000},
+        {"effect", 2, 5000, 250, 10000, 0x800, 0x1000},
+        {"card", 3, 12000, 200, 4000, 0x1000, 0x800},
+    };
+    SimTask task;
+    size_t i;
+
+    sTasks.clear();
+    for (i = 0; i < sizeof(sSpecs) / sizeof(sSpecs[0]); i++) {
+        memset(&task, 0, sizeof(task));
+        task.name = sSpecs[i].name;
+        task.priority = sSpecs[i].priority;
+        task.addAt = SIM_US(sSpecs[i].addAtUs);
+        task.slice = SIM_US(sSpecs[i].sliceUs);
+        task.work = task.remaining = SIM_US(sSpecs[i].workUs);
+        task.info.iram_length = sSpecs[i].iramLength;
+        task.info.dram_length = sSpecs[i].dramLength;
+        sTasks.push_back(task);
+    }
+
+    // the DSPTaskInfo has to stay put once added, so fill in the self pointers after the vector is built
+    for (i = 0; i < sTasks.size(); i++) {
+        sTasks[i].info.priority = sTasks[i].priority;
+        sTasks[i].info.iram_mmem_addr = &sTasks[i].iram;
+        sTasks[i].info.done_cb = simDoneCallback;
+    }
+}
+
+static void legacyAddTask(DSPTaskInfo* task) {
+    // DSPAddTask from dsp.c
+    __DSP_insert_task(task);
+    task->state = DSP_TASK_STATE_INIT;
+    task->flags = DSP_TASK_FLAG_ATTACHED;
+    if (task == __DSP_first_task) {
+        __DSP_boot_task(task);
+    }
+}
+
+static void simCPU(void (*fn)(void)) {
+    s64 start = sNow;
+
+    sNow += sInterruptTicks;
+    fn();
+    sResult.cpuTicks += sNow - start;
+}
+
+static void simInterrupt(void) {
+    sResult.numInterrupts++;
+    sHandler(__OS_INTERRUPT_DSP_DSP, NULL);
+}
+
+static void simAlarm(void) {
+    OSAlarm* alarm = sAlarm;
+
+    sResult.numAlarms++;
+    sAlarm = NULL;
+    alarm->handler(alarm, NULL);
+}
+
+static bool run(bool extended) {
+    s64 next;
+    s64 addAt;
+    SimTask* add;
+    size_t i;
+    bool ok;
+
+    simBuildTasks();
+    memset(&sResult, 0, sizeof(sResult));
+    sNow = 1;
+    sProtocolErrors = 0;
+    sToDSPFull = false;
+    sFromDSPFull = false;
+    sInterruptPending = false;
+    sAlarm = NULL;
+    sDSPState = SIM_DSP_RESET;
+    sDSPIdleSince = -1;
+    sNumWords = 0;
+    __DSP_first_task = __DSP_last_task = __DSP_curr_task = NULL;
+    __DSP_rude_task = NULL;
+    __DSP_rude_task_pending = 0;
+
+    // the DSP comes out of reset with its ready mail posted, no interrupt
+    sFromDSP = SIM_DSP_READY_MAIL;
+    sFromDSPFull = true;
+
+    if (extended) {
+        DSPXInit();
+        DSPXResetStats();
+    } else {
+        sHandler = __DSPHandler;
+    }
+
+    while (sDSPState != SIM_DSP_HALTED) {
+        add = NULL;
+        addAt = SIM_NEVER;
+        for (i = 0; i < sTasks.size(); i++) {
+            if (sTasks[i].info.flags == 0 && sTasks[i].info.state == DSP_TASK_STATE_INIT &&
+                sTasks[i].addAt < addAt) {
+                add = &sTasks[i];
+                addAt = add->addAt;
+            }
+        }
+
+        next = simNextDSPEvent();
+        if (sInterruptPending && sInterruptAt < next) {
+            next = sInterruptAt;
+        }
+        if (sAlarm != NULL && sAlarm->fire < next) {
+            next = sAlarm->fire;
+        }
+        if (addAt < next) {
+            next = addAt;
+        }
+        if (next == SIM_NEVER || sNow > SIM_US(1e6)) {
+            sProtocolErrors++;
+            break;
+        }
+
+        if (next > sNow) {
+            sNow = next;
+        }
+        simAdvanceDSP(sNow);
+
+        if (sInterruptPending && sInterruptAt <= sNow) {
+            sInterruptPending = false;
+            simCPU(simInterrupt);
+        } else if (sAlarm != NULL && sAlarm->fire <= sNow) {
+            simCPU(simAlarm);
+        } else if (add != NULL && addAt <= sNow) {
+            if (extended) {
+                DSPXAddTask(&add->info);
+            } else {
+                legacyAddTask(&add->info);
+            }
+        }
+    }
+
+    ok = sProtocolErrors == 0;
+    for (i = 0; i < sTasks.size(); i++) {
+        ok &= sTasks[i].numDone == 1 && sTasks[i].ran == sTasks[i].work;
+    }
+    return ok;
+}
+
+static void report(const char* name, bool ok) {
+    printf("%-14s %8.2f ms, %3lu switches, DSP idle per switch avg %5.1f us max %5.1f us, CPU in handlers %7.1f us "
+           "(%lu interrupts, %lu alarms, %lu polls)%s\n",
+           name, sResult.end * 1000.0 / SIM_TIMER_CLOCK, sResult.numSwitches,
+           sResult.numSwitches ? sResult.idleTicks * 1e6 / SIM_TIMER_CLOCK / sResult.numSwitches : 0.0,
+           sResult.maxIdleTicks * 1e6 / SIM_TIMER_CLOCK, sResult.cpuTicks * 1e6 / SIM_TIMER_CLOCK,
+           sResult.numInterrupts, sResult.numAlarms, sResult.numPolls, ok ? "" : ", PROTOCOL ERROR");
+}
+
+// With the DSP not taking mail, DSPXSendMail takes words until only the scheduler's room is left, then turns them
+// away instead of waiting
+static bool checkFullQueue(void) {
+    u32 accepted;
+    u32 i;
+    bool ok;
+
+    sDSPState = SIM_DSP_HALTED;
+    sToDSPFull = true;
+    accepted = 0;
+    for (i = 0; i < DSPX_MAIL_QUEUE_SIZE; i++) {
+        accepted += DSPXSendMail(i) ? 1 : 0;
+    }
+    ok = accepted == DSPX_MAIL_QUEUE_SIZE - DSPX_MAIL_RESERVED;
+    printf("full queue: %lu of %d words taken%s\n", accepted, DSPX_MAIL_QUEUE_SIZE, ok ? "" : ", WRONG COUNT");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    static const u32 polls[] = {0, DSPX_MAIL_POLLS_DEFAULT, 64};
+    char name[32];
+    size_t i;
+    bool ok;
+
+    __OSBusClock = SIM_BUS_CLOCK;
+    sMailReadTicks = SIM_US(argc > 1 ? atof(argv[1]) : 1.0);
+    sPollTicks = SIM_US(argc > 2 ? atof(argv[2]) : 0.1);
+    sInterruptTicks = SIM_US(argc > 3 ? atof(argv[3]) : 2.0);
+    sDMABytesPerTick = 100.0 * 1024 * 1024 / SIM_TIMER_CLOCK;
+    if (sPollTicks <= 0) {
+        fprintf(stderr, "usage: dspsim [DSP mail pickup us] [mailbox poll us] [interrupt entry/exit us]\n");
+        return 1;
+    }
+
+    printf("mail pickup %.2f us, poll %.2f us, interrupt %.2f us, task DMA 100 MB/s\n",
+           sMailReadTicks * 1e6 / SIM_TIMER_CLOCK, sPollTicks * 1e6 / SIM_TIMER_CLOCK,
+           sInterruptTicks * 1e6 / SIM_TIMER_CLOCK);
+
+    ok = run(false);
+    report("dsp_task", ok);
+
+    // before DSPXSetMailPolls, DSPXInit sets the default
+    DSPXInit();
+
+    for (i = 0; i < sizeof(polls) / sizeof(polls[0]); i++) {
+        DSPXSetMailPolls(polls[i]);
+        ok &= run(true);
+        snprintf(name, sizeof(name), "dspx polls=%lu", polls[i]);
+        report(name, ok);
+    }
+    DSPXReport();
+    ok &= checkFullQueue();
+
+    return !ok;
+}
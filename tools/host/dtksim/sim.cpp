@@ -0,0 +1,426 @@
+// Host simulation of DTK track playback, driving the fixed track array in src/menu/dtk_stuff.cpp and the queue in
+// src/menu/dtkqueue.cpp with the same play list. Time is virtual and measured in OS timer ticks.
+// The DTK model plays the linked tracks in NOREPEAT order. When a track ends, the drive goes busy until the next
+// stream starts: a short handoff if that stream was prepared with DVDPrepareStreamAsync, a seek otherwise.
+// Every DTKGetState poll is charged to the CPU, so spinning while DTK is busy shows up as CPU time.
+
+#include "menu/dtkQueue.hpp"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_BUS_CLOCK 162000000
+#define SIM_TIMER_CLOCK (SIM_BUS_CLOCK / 4)
+#define SIM_US(us) ((s64)((us) * (SIM_TIMER_CLOCK / 1000000.0)))
+#define SIM_MS(ms) SIM_US((ms) * 1000.0)
+#define SIM_NEVER 0x7FFFFFFFFFFFFFFFLL
+
+#define SIM_NUM_TRACKS 40
+#define SIM_STREAM_BYTES_PER_MS 176 // 48 kHz ADPCM stream
+
+extern void Init_DTK_System();
+extern u32 Add_Track(char* filename, DTKCallback callback);
+extern void Play_Track();
+extern void Stop_Track();
+
+typedef struct SimResult {
+    u32 numAdded;
+    u32 numStarted;
+    u32 numEnded;
+    u32 numGaps;
+    s64 totalGap;
+    s64 maxGap;
+    s64 spinTicks;
+    u32 numPolls;
+    u32 numAlarms;
+} SimResult;
+
+// cost model
+static s64 sSeekTicks;
+static s64 sHandoffTicks;
+static s64 sStateTicks;
+static s64 sPollTicks;
+
+static s64 sNow;
+static SimResult sResult;
+
+// DTK side
+static DTKTrack* sFirst;
+static DTKTrack* sLast;
+static DTKTrack* sCurrent;
+static u32 sState;
+static u32 sTargetState; // what BUSY turns into
+static s64 sBusyUntil;
+static s64 sTrackEnd;
+static s64 sRemaining; // of the current track while stopped
+static s64 sEndedAt;
+static u32 sRepeat;
+
+// drive side
+static u32 sPreparedAddr;
+static s64 sPreparedAt;
+
+static OSAlarm* sAlarm;
+
+static char sNames[SIM_NUM_TRACKS][16];
+static u32 sNumLiveBlocks; // from the queue's allocator
+static u32 sNumHeapCallsDisabled;
+static BOOL sInterruptsEnabled = true;
+
+static void simEvent(DTKTrack* track, u32 event) {
+    if (track != NULL && track->callback != NULL && (track->eventMask & event)) {
+        track->callback(event);
+    }
+}
+
+static s64 simTrackTicks(DTKTrack* track) { return SIM_MS(track->dvdFileInfo.length / SIM_STREAM_BYTES_PER_MS); }
+
+static void simStart(void) {
+    s64 gap;
+
+    sState = DTK_STATE_RUN;
+    sBusyUntil = SIM_NEVER;
+    sTrackEnd = sNow + (sRemaining != 0 ? sRemaining : simTrackTicks(sCurrent));
+    sRemaining = 0;
+    sResult.numStarted++;
+
+    if (sEndedAt != 0) {
+        gap = sNow - sEndedAt;
+        sResult.numGaps++;
+        sResult.totalGap += gap;
+        if (gap > sResult.maxGap) {
+            sResult.maxGap = gap;
+        }
+        sEndedAt = 0;
+    }
+
+    simEvent(sCurrent, DTK_EVENT_PLAYBACK_STARTED);
+}
+
+static void simEndTrack(void) {
+    DTKTrack* ended = sCurrent;
+
+    sResult.numEnded++;
+    sEndedAt = sNow;
+    sTrackEnd = SIM_NEVER;
+    sCurrent = ended->next;
+    if (sCurrent == NULL && sRepeat == DTK_MODE_ALLREPEAT) {
+        sCurrent = sFirst;
+    }
+
+    if (sCurrent == NULL) {
+        sState = DTK_STATE_STOP;
+        sEndedAt = 0;
+    } else {
+        sState = DTK_STATE_BUSY;
+        sTargetState = DTK_STATE_RUN;
+        if (sPreparedAddr == sCurrent->dvdFileInfo.startAddr && sPreparedAt <= sNow) {
+            sBusyUntil = sNow + sHandoffTicks;
+        } else {
+            sBusyUntil = sNow + sSeekTicks;
+        }
+    }
+    sPreparedAddr = 0;
+
+    simEvent(ended, DTK_EVENT_TRACK_ENDED);
+}
+
+static void simBusyDone(void) {
+    if (sTargetState == DTK_STATE_RUN) {
+        simStart();
+    } else {
+        sState = sTargetState;
+        sBusyUntil = SIM_NEVER;
+        simEvent(sCurrent, DTK_EVENT_PLAYBACK_STOPPED);
+    }
+}
+
+// runs whatever is due at the current time, like the DI and AI interrupts would
+static void simUpdate(void) {
+    OSAlarm* alarm;
+
+    for (;;) {
+        if (sBusyUntil <= sNow) {
+            simBusyDone();
+        } else if (sTrackEnd <= sNow) {
+            simEndTrack();
+        } else if (sAlarm != NULL && sAlarm->fire <= sNow) {
+            alarm = sAlarm;
+            sAlarm = NULL;
+            sResult.numAlarms++;
+            alarm->handler(alarm, NULL);
+        } else {
+            break;
+        }
+    }
+}
+
+static s64 simNextEvent(void) {
+    s64 next = sBusyUntil < sTrackEnd ? sBusyUntil : sTrackEnd;
+
+    if (sAlarm != NULL && sAlarm->fire < next) {
+        next = sAlarm->fire;
+    }
+    return next;
+}
+
+extern "C" {
+s64 OSGetTime(void) { return sNow; }
+OSTick OSGetTick(void) { return (OSTick)sNow; }
+BOOL OSDisableInterrupts(void) {
+    BOOL level = sInterruptsEnabled;
+
+    sInterruptsEnabled = false;
+    return level;
+}
+
+BOOL OSRestoreInterrupts(BOOL level) {
+    BOOL old = sInterruptsEnabled;
+
+    sInterruptsEnabled = level;
+    return old;
+}
+
+void AIInit(u8* stack) {}
+
+void OSReport(const char* msg, ...) {
+    va_list args;
+
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+}
+
+void OSCreateAlarm(OSAlarm* alarm) { alarm->handler = NULL; }
+
+void OSSetAlarm(OSAlarm* alarm, OSTime tick, OSAlarmHandler handler) {
+    alarm->handler = handler;
+    alarm->fire = sNow + tick;
+    sAlarm = alarm;
+}
+
+void OSCancelAlarm(OSAlarm* alarm) {
+    if (sAlarm == alarm) {
+        sAlarm = NULL;
+    }
+}
+
+BOOL DVDPrepareStreamAsync(DVDFileInfo* fileInfo, u32 length, u32 offset, DVDCallback callback) {
+    // the drive seeks to the next stream while it keeps playing the buffered current one
+    sPreparedAddr = fileInfo->startAddr;
+    sPreparedAt = sNow + sSeekTicks;
+    callback(0, fileInfo);
+    return true;
+}
+
+void DTKInit(void) {
+    sFirst = sLast = sCurrent = NULL;
+    sState = DTK_STATE_STOP;
+    sBusyUntil = sTrackEnd = SIM_NEVER;
+    sRemaining = 0;
+    sEndedAt = 0;
+    sRepeat = DTK_MODE_NOREPEAT;
+    sPreparedAddr = 0;
+}
+
+u32 DTKQueueTrack(char* fileName, DTKTrack* track, u32 eventMask, DTKCallback callback) {
+    track->fileName = fileName;
+    track->eventMask = eventMask;
+    track->callback = callback;
+    track->dvdFileInfo.startAddr = (u32)(atoi(fileName + 5) + 1) << 20;
+    track->dvdFileInfo.length = (2000 + (atoi(fileName + 5) * 7919) % 2000) * SIM_STREAM_BYTES_PER_MS;
+    track->next = NULL;
+    track->prev = sLast;
+    if (sLast != NULL) {
+        sLast->next = track;
+    } else {
+        sFirst = track;
+    }
+    sLast = track;
+    if (sCurrent == NULL) {
+        sCurrent = track;
+    }
+
+    sResult.numAdded++;
+    simEvent(track, DTK_EVENT_TRACK_QUEUED);
+    return 0;
+}
+
+u32 DTKRemoveTrack(DTKTrack* track) {
+    if (track == sCurrent) {
+        return 1;
+    }
+
+    if (track->prev != NULL) {
+        track->prev->next = track->next;
+    } else {
+        sFirst = track->next;
+    }
+    if (track->next != NULL) {
+        track->next->prev = track->prev;
+    } else {
+        sLast = track->prev;
+    }
+    return 0;
+}
+
+void DTKSetRepeatMode(u32 repeat) { sRepeat = repeat; }
+DTKTrack* DTKGetCurrentTrack(void) { return sCurrent; }
+
+u32 DTKGetState(void) {
+    if (sState == DTK_STATE_BUSY) {
+        sNow += sPollTicks;
+        sResult.spinTicks += sPollTicks;
+        sResult.numPolls++;
+        simUpdate();
+    }
+    return sState;
+}
+
+void DTKSetState(u32 state) {
+    if (sState == DTK_STATE_BUSY || sState == state) {
+        return;
+    }
+
+    if (sState == DTK_STATE_RUN) {
+        sRemaining = sTrackEnd - sNow;
+        sTrackEnd = SIM_NEVER;
+    }
+    sState = DTK_STATE_BUSY;
+    sTargetState = state;
+    sBusyUntil = sNow + sStateTicks;
+}
+}
+
+static void simTrackCallback(u32 event) {}
+
+static void simInit(void) {
+    memset(&sResult, 0, sizeof(sResult));
+    sNow = 1;
+    sAlarm = NULL;
+}
+
+// the pause menu: stop the music on the way in, start it again on the way out. Every other time the menu is left
+// right away, so the restart finds DTK still busy with the stop.
+static void simRun(bool useQueue, DTKQueue* queue) {
+    s64 pauseAt;
+    s64 pauseTicks;
+    s64 next;
+    u32 numPauses;
+
+    pauseAt = SIM_MS(1500);
+    numPauses = 0;
+    if (useQueue) {
+        dtqPlay(queue);
+    } else {
+        Play_Track();
+    }
+
+    for (;;) {
+        next = simNextEvent();
+        if (pauseAt < next) {
+            next = pauseAt;
+        }
+        if (next == SIM_NEVER) {
+            break;
+        }
+        if (next > sNow) {
+            sNow = next;
+        }
+        simUpdate();
+
+        if (pauseAt <= sNow && sCurrent != NULL) {
+            pauseTicks = (numPauses++ & 1) ? 0 : SIM_MS(400);
+            if (useQueue) {
+                dtqStop(queue);
+                sNow += pauseTicks;
+                simUpdate();
+                dtqPlay(queue);
+            } else {
+                Stop_Track();
+                sNow += pauseTicks;
+                simUpdate();
+                Play_Track();
+            }
+            pauseAt = sNow + SIM_MS(7000);
+        } else if (sCurrent == NULL) {
+            break;
+        }
+    }
+}
+
+static void report(const char* name) {
+    printf("%-10s %2lu/%u tracks queued, %2lu played, gap avg %6.1f ms max %6.1f ms, CPU spinning on DTK %7.1f ms "
+           "(%lu polls), %lu alarms\n",
+           name, sResult.numAdded, SIM_NUM_TRACKS, sResult.numEnded,
+           sResult.numGaps ? sResult.totalGap * 1000.0 / SIM_TIMER_CLOCK / sResult.numGaps : 0.0,
+           sResult.maxGap * 1000.0 / SIM_TIMER_CLOCK, sResult.spinTicks * 1000.0 / SIM_TIMER_CLOCK,
+           sResult.numPolls, sResult.numAlarms);
+}
+
+// The queue's allocator, counting what it still holds and any use with interrupts disabled
+static void* simAlloc(u32 size) {
+    sNumLiveBlocks++;
+    sNumHeapCallsDisabled += sInterruptsEnabled ? 0 : 1;
+    return malloc(size);
+}
+
+static void simFree(void* ptr) {
+    sNumLiveBlocks--;
+    sNumHeapCallsDisabled += sInterruptsEnabled ? 0 : 1;
+    free(ptr);
+}
+
+int main(int argc, char** argv) {
+    static DTQSlot* ring[8];
+    static DTQSlot slots[8];
+    static DTKQueue queue;
+    u32 expectedBlocks;
+    u32 i;
+
+    __OSBusClock = SIM_BUS_CLOCK;
+    sSeekTicks = SIM_MS(argc > 1 ? atof(argv[1]) : 120.0);
+    sHandoffTicks = SIM_MS(argc > 2 ? atof(argv[2]) : 2.0);
+    sStateTicks = SIM_MS(argc > 3 ? atof(argv[3]) : 30.0);
+    sPollTicks = SIM_US(argc > 4 ? atof(argv[4]) : 0.5);
+    if (sSeekTicks <= 0 || sPollTicks <= 0) {
+        fprintf(stderr, "usage: dtksim [seek ms] [prepared handoff ms] [state change ms] [DTKGetState poll us]\n");
+        return 1;
+    }
+
+    printf("seek %.1f ms, prepared handoff %.1f ms, state change %.1f ms, poll %.2f us, %u tracks\n",
+           sSeekTicks * 1000.0 / SIM_TIMER_CLOCK, sHandoffTicks * 1000.0 / SIM_TIMER_CLOCK,
+           sStateTicks * 1000.0 / SIM_TIMER_CLOCK, sPollTicks * 1e6 / SIM_TIMER_CLOCK, SIM_NUM_TRACKS);
+
+    for (i = 0; i < SIM_NUM_TRACKS; i++) {
+        snprintf(sNames[i], sizeof(sNames[i]), "track%lu.dtk", i);
+    }
+
+    simInit();
+    Init_DTK_System();
+    for (i = 0; i < SIM_NUM_TRACKS; i++) {
+        Add_Track(sNames[i], simTrackCallback);
+    }
+    simRun(false, NULL);
+    report("dtk_stuff");
+
+    simInit();
+    DTKInit();
+    dtqInit(&queue, ring, slots, ARRAY_COUNTU(slots), simAlloc, simFree);
+    for (i = 0; i < SIM_NUM_TRACKS; i++) {
+        dtqAddTrack(&queue, sNames[i], 0, simTrackCallback);
+    }
+    simRun(true, &queue);
+    report("dtkqueue");
+    dtqReport(&queue);
+
+    // every grow leaves its slots behind, but only the latest ring
+    expectedBlocks = queue.stats.numGrown != 0 ? queue.stats.numGrown + 1 : 0;
+    printf("%lu grows, %lu blocks from the allocator still live, %lu expected, %lu allocator calls with interrupts "
+           "disabled\n",
+           queue.stats.numGrown, sNumLiveBlocks, expectedBlocks, sNumHeapCallsDisabled);
+
+    return sResult.numEnded != SIM_NUM_TRACKS || sNumLiveBlocks != expectedBlocks || sNumHeapCallsDisabled != 0;
+}
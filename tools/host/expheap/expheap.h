@@ -0,0 +1,46 @@
+#ifndef _EXPHEAP_EXPHEAP_H
+#define _EXPHEAP_EXPHEAP_H
+
+#include "../common/types.h"
+
+// A JKRExpHeap (src/JSystem/JKernel/JKRExpHeap.cpp) made in a 96 MB root heap, behind plain functions. heap.cpp and
+// stubs.cpp, which build it, don't include this: JKRHeap.h brings dolphin/types.h (see common/types.h) and declares
+// an operator delete the C++ library's <new> disagrees with.
+
+typedef struct ExpHeap ExpHeap;
+
+void expheapInit(void);
+// With bins, the heap indexes its free blocks if it's large enough
+ExpHeap* expheapCreate(u32 size, bool bins);
+void expheapDestroy(ExpHeap* heap);
+void expheapSetFirstFit(ExpHeap* heap);
+
+void* expheapAlloc(ExpHeap* heap, u32 size, s32 align);
+void expheapFree(ExpHeap* heap, void* ptr);
+s32 expheapResize(ExpHeap* heap, void* ptr, u32 size);
+s32 expheapGetSize(ExpHeap* heap, void* ptr);
+void expheapFreeAll(ExpHeap* heap);
+void expheapFreeTail(ExpHeap* heap);
+u8 expheapChangeGroupID(ExpHeap* heap, u8 groupId);
+
+bool expheapCheck(ExpHeap* heap);
+// dump and dump_sort
+bool expheapDump(ExpHeap* heap);
+// Whether allocating and freeing a block leaves state_register's record unchanged
+bool expheapCheckState(ExpHeap* heap);
+
+u8* expheapGetStart(ExpHeap* heap);
+u8* expheapGetFirstBlock(ExpHeap* heap); // start of the first free block when nothing is allocated
+u32 expheapGetHeapSize(ExpHeap* heap);
+u32 expheapGetFreeSize(ExpHeap* heap);
+u32 expheapGetTotalFreeSize(ExpHeap* heap);
+u32 expheapGetUsedSize(ExpHeap* heap, u8 groupId);
+u32 expheapGetTotalUsedSize(ExpHeap* heap);
+// Walks the free list
+void expheapGetFreeList(ExpHeap* heap, u32* numBlocks, u32* maxBlock, u32* total);
+
+// OSReport prints when verbose, and is counted either way
+void expheapSetReport(bool verbose);
+u32 expheapGetReportCount(void);
+
+#endif
@@ -0,0 +1,85 @@
+// The functions in expheap.h, on the JKernel side of that header.
+
+#include "JSystem/JKernel/JKRExpHeap.h"
+
+struct ExpHeap;
+
+static JKRExpHeap* sArenaHeap;
+
+static inline JKRExpHeap* getHeap(ExpHeap* heap) { return (JKRExpHeap*)heap; }
+
+void expheapInit(void) { sArenaHeap = JKRExpHeap::createRoot(1, false); }
+
+ExpHeap* expheapCreate(unsigned int size, bool bins) {
+    JKRExpHeap* heap;
+
+    JKRExpHeap::setDefaultFreeBins(bins);
+    heap = JKRExpHeap::create(size, sArenaHeap, false);
+    JKRExpHeap::setDefaultFreeBins(false);
+    return (ExpHeap*)heap;
+}
+
+void expheapDestroy(ExpHeap* heap) { getHeap(heap)->destroy(); }
+
+void expheapSetFirstFit(ExpHeap* heap) { getHeap(heap)->setAllocationMode(JKRExpHeap::ALLOC_MODE_1); }
+
+void* expheapAlloc(ExpHeap* heap, unsigned int size, int align) { return getHeap(heap)->alloc(size, align); }
+
+void expheapFree(ExpHeap* heap, void* ptr) { getHeap(heap)->free(ptr); }
+
+int expheapResize(ExpHeap* heap, void* ptr, unsigned int size) { return getHeap(heap)->resize(ptr, size); }
+
+int expheapGetSize(ExpHeap* heap, void* ptr) { return getHeap(heap)->do_getSize(ptr); }
+
+void expheapFreeAll(ExpHeap* heap) { getHeap(heap)->freeAll(); }
+
+void expheapFreeTail(ExpHeap* heap) { getHeap(heap)->freeTail(); }
+
+unsigned char expheapChangeGroupID(ExpHeap* heap, unsigned char groupId) {
+    return getHeap(heap)->do_changeGroupID(groupId);
+}
+
+bool expheapCheck(ExpHeap* heap) { return getHeap(heap)->check(); }
+
+bool expheapDump(ExpHeap* heap) { return getHeap(heap)->dump() && getHeap(heap)->dump_sort(); }
+
+bool expheapCheckState(ExpHeap* heap) {
+    JKRHeap::TState before;
+    JKRHeap::TState after;
+    void* ptr;
+
+    getHeap(heap)->state_register(&before, 0x100);
+    ptr = getHeap(heap)->alloc(0x40, 4);
+    getHeap(heap)->free(ptr);
+    getHeap(heap)->state_register(&after, 0x100);
+    return ptr != NULL && getHeap(heap)->state_compare(before, after);
+}
+
+unsigned char* expheapGetStart(ExpHeap* heap) { return (unsigned char*)getHeap(heap)->getStartAddr(); }
+
+unsigned char* expheapGetFirstBlock(ExpHeap* heap) { return (unsigned char*)getHeap(heap)->getHeadFreeList(); }
+
+unsigned int expheapGetHeapSize(ExpHeap* heap) { return getHeap(heap)->getSize(); }
+
+unsigned int expheapGetFreeSize(ExpHeap* heap) { return getHeap(heap)->getFreeSize(); }
+
+unsigned int expheapGetTotalFreeSize(ExpHeap* heap) { return getHeap(heap)->getTotalFreeSize(); }
+
+unsigned int expheapGetUsedSize(ExpHeap* heap, unsigned char groupId) { return getHeap(heap)->getUsedSize(groupId); }
+
+unsigned int expheapGetTotalUsedSize(ExpHeap* heap) { return getHeap(heap)->getTotalUsedSize(); }
+
+void expheapGetFreeList(ExpHeap* heap, unsigned int* numBlocks, unsigned int* maxBlock, unsigned int* total) {
+    JKRExpHeap::CMemBlock* block;
+
+    *numBlocks = 0;
+    *maxBlock = 0;
+    *total = 0;
+    for (block = getHeap(heap)->getHeadFreeList(); block != NULL; block = block->getNextBlock()) {
+        (*numBlocks)++;
+        *total += block->getSize();
+        if (block->getSize() > *maxBlock) {
+            *maxBlock = block->getSize();
+        }
+    }
+}
@@ -0,0 +1,677 @@
+// Host test and benchmark of JKRExpHeap's size-class bins. Allocation traces, made up here in the shape of what
+// the game does or read from a file, are replayed on a heap that indexes its free blocks and on one that doesn't
+// (JKRExpHeap::setDefaultFreeBins), and the two are compared for speed and for how fragmented they leave the heap.
+//
+// A trace is text, one operation per line:
+//   a <id> <size> <alignment>   allocate, negative alignments from the tail
+//   f <id>                      free
+//   r <id> <size>               resize
+
+#include "expheap.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define HEAP_SIZE (16 * 1024 * 1024)
+#define SMALL_HEAP_SIZE 0x8000
+#define CHECK_INTERVAL 97
+#define BENCH_SECONDS 0.25
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct TraceOp {
+    char type; // 'a', 'f' or 'r'
+    u32 id;
+    u32 size;
+    s32 align;
+} TraceOp;
+
+typedef std::vector<TraceOp> Trace;
+
+typedef struct TraceGen {
+    unsigned long long seed;
+    u32 nextId;
+    Trace* trace;
+} TraceGen;
+
+typedef struct RunResult {
+    u32 numFailed;
+    u32 numFreeBlocks;
+    u32 maxFreeBlock;
+    u32 totalFree;
+    bool ok;
+} RunResult;
+
+static u32 genRandom(TraceGen* gen, u32 range) {
+    gen->seed ^= gen->seed << 13;
+    gen->seed ^= gen->seed >> 7;
+    gen->seed ^= gen->seed << 17;
+    return (u32)(gen->seed >> 16) % range;
+}
+
+// Sizes spread evenly over their logarithm, as resource sizes are
+static u32 genSize(TraceGen* gen, u32 min, u32 max) {
+    double r = genRandom(gen, 0x10000) / 65536.0;
+
+    return (u32)(min * exp(r * log((double)max / min)));
+}
+
+static u32 genAlloc(TraceGen* gen, u32 size, s32 align) {
+    TraceOp op;
+
+    op.type = 'a';
+    op.id = gen->nextId++;
+    op.size = size;
+    op.align = align;
+    gen->trace->push_back(op);
+    return op.id;
+}
+
+static void genFree(TraceGen* gen, u32 id) {
+    TraceOp op;
+
+    op.type = 'f';
+    op.id = id;
+    op.size = 0;
+    op.align = 0;
+    gen->trace->push_back(op);
+}
+
+static void genResize(TraceGen* gen, u32 id, u32 size) {
+    TraceOp op;
+
+    op.type = 'r';
+    op.id = id;
+    op.size = size;
+    op.align = 0;
+    gen->trace->push_back(op);
+}
+
+// Frees a random id from live, or the oldest when oldest is set
+static void genFreeLive(TraceGen* gen, std::vector<u32>* live, bool oldest) {
+    u32 i;
+
+    i = oldest ? 0 : genRandom(gen, live->size());
+    genFree(gen, (*live)[i]);
+    if (oldest) {
+        live->erase(live->begin());
+    } else {
+        (*live)[i] = live->back();
+        live->pop_back();
+    }
+}
+
+// Actors spawning and dying: mostly small objects, a few buffers, some wanting 32-byte alignment
+static void genActorStep(TraceGen* gen, std::vector<u32>* live, u32 target) {
+    u32 r;
+    u32 size;
+
+    if (live->size() < target / 2 || (live->size() < target && genRandom(gen, 2) == 0)) {
+        r = genRandom(gen, 100);
+        if (r < 70) {
+            size = genSize(gen, 16, 256);
+        } else if (r < 95) {
+            size = genSize(gen, 256, 4096);
+        } else {
+            size = genSize(gen, 4096, 65536);
+        }
+        live->push_back(genAlloc(gen, size, genRandom(gen, 4) == 0 ? 32 : 4));
+    } else {
+        genFreeLive(gen, live, false);
+    }
+}
+
+// A resource read from disc: the compressed file in a buffer from the tail, decoded into one from the head, the
+// buffer given back
+static u32 genLoad(TraceGen* gen) {
+    u32 compressed;
+    u32 buffer;
+    u32 result;
+
+    compressed = ALIGN_NEXT(genSize(gen, 0x4000, 0x80000), 32);
+    buffer = genAlloc(gen, compressed, -32);
+    result = genAlloc(gen, compressed + compressed * genRandom(gen, 3) / 2, 32);
+    genFree(gen, buffer);
+    return result;
+}
+
+// A scene's resources, with scratch allocations coming and going while it loads and some of it shrunk once its size
+// is known, all freed when the scene ends
+static void genScene(TraceGen* gen, std::vector<u32>* persistent, u32 numResources, std::vector<u32>* actors) {
+    std::vector<u32> resources;
+    std::vector<u32> scratch;
+    u32 size;
+    u32 id;
+    u32 i;
+
+    for (i = 0; i < numResources; i++) {
+        size = genSize(gen, 32, 65536);
+        id = genAlloc(gen, size, genRandom(gen, 5) < 2 ? 32 : 4);
+        if (genRandom(gen, 50) == 0) {
+            genResize(gen, id, size / 2);
+        }
+        resources.push_back(id);
+
+        if (i % 3 == 0) {
+            scratch.push_back(genAlloc(gen, genSize(gen, 64, 8192), 4));
+            if (scratch.size() > 50) {
+                genFreeLive(gen, &scratch, false);
+            }
+        }
+        if (i % 40 == 0) {
+            persistent->push_back(genAlloc(gen, genSize(gen, 64, 16384), 4));
+        }
+        if (actors != NULL) {
+            genActorStep(gen, actors, 1500);
+            genActorStep(gen, actors, 1500);
+            if (i % 60 == 0) {
+                resources.push_back(genLoad(gen));
+            }
+        }
+    }
+
+    while (!scratch.empty()) {
+        genFreeLive(gen, &scratch, false);
+    }
+    while (!resources.empty()) {
+        genFreeLive(gen, &resources, false);
+    }
+}
+
+static bool genTrace(const char* kind, Trace* trace) {
+    std::vector<u32> live;
+    std::vector<u32> persistent;
+    TraceGen gen;
+    u32 i;
+    u32 j;
+
+    gen.seed = 0x2545F4914F6CDD1DULL;
+    gen.nextId = 0;
+    gen.trace = trace;
+    trace->clear();
+
+    if (strcmp(kind, "actors") == 0) {
+        for (i = 0; i < 200000; i++) {
+            genActorStep(&gen, &live, 3000);
+        }
+    } else if (strcmp(kind, "scenes") == 0) {
+        for (i = 0; i < 24; i++) {
+            genScene(&gen, &persistent, 1200, NULL);
+        }
+    } else if (strcmp(kind, "dvd") == 0) {
+        for (i = 0; i < 3000; i++) {
+            live.push_back(genLoad(&gen));
+            if (live.size() > 12) {
+                genFreeLive(&gen, &live, genRandom(&gen, 2) == 0);
+            }
+            for (j = 0; j < 5; j++) {
+                genActorStep(&gen, &persistent, 500);
+            }
+        }
+    } else if (strcmp(kind, "mixed") == 0) {
+        for (i = 0; i < 12; i++) {
+            genScene(&gen, &persistent, 600, &live);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool readTrace(const char* path, Trace* trace) {
+    TraceOp op;
+    char line[128];
+    unsigned int id;
+    unsigned int size;
+    int align;
+    FILE* file;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    trace->clear();
+    while (fgets(line, sizeof(line), file) != NULL) {
+        op.type = line[0];
+        op.size = 0;
+        op.align = 0;
+        if (op.type == 'a' && sscanf(line + 1, "%u %u %d", &id, &size, &align) == 3) {
+            op.size = size;
+            op.align = align;
+        } else if (op.type == 'r' && sscanf(line + 1, "%u %u", &id, &size) == 2) {
+            op.size = size;
+        } else if (op.type == 'f' && sscanf(line + 1, "%u", &id) == 1) {
+        } else if (op.type == '#' || op.type == '\n') {
+            continue;
+        } else {
+            fprintf(stderr, "bad trace line: %s", line);
+            fclose(file);
+            return false;
+        }
+        op.id = id;
+        trace->push_back(op);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool writeTrace(FILE* file, const Trace* trace) {
+    size_t i;
+
+    for (i = 0; i < trace->size(); i++) {
+        const TraceOp* op = &(*trace)[i];
+
+        if (op->type == 'a') {
+            fprintf(file, "a %u %u %d\n", (unsigned int)op->id, (unsigned int)op->size, (int)op->align);
+        } else if (op->type == 'r') {
+            fprintf(file, "r %u %u\n", (unsigned int)op->id, (unsigned int)op->size);
+        } else {
+            fprintf(file, "f %u\n", (unsigned int)op->id);
+        }
+    }
+    return ferror(file) == 0;
+}
+
+static u32 getNumIds(const Trace* trace) {
+    u32 numIds;
+    size_t i;
+
+    numIds = 0;
+    for (i = 0; i < trace->size(); i++) {
+        if ((*trace)[i].id >= numIds) {
+            numIds = (*trace)[i].id + 1;
+        }
+    }
+    return numIds;
+}
+
+static u8 getFillByte(u32 id) { return (u8)(id * 31 + 7); }
+
+static bool checkFill(const u8* ptr, u32 size, u32 id) {
+    u32 i;
+
+    for (i = 0; i < size; i++) {
+        if (ptr[i] != getFillByte(id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs trace on heap, leaving what it didn't free allocated. With verify, every allocation is filled and checked
+// when it goes, alignments are checked and so is the heap, every CHECK_INTERVAL operations.
+static void runTrace(ExpHeap* heap, const Trace* trace, std::vector<void*>* ptrs, bool verify, RunResult* result) {
+    std::vector<u32> sizes;
+    const TraceOp* op;
+    void* ptr;
+    s32 newSize;
+    u32 align;
+    size_t i;
+
+    ptrs->assign(getNumIds(trace), NULL);
+    if (verify) {
+        sizes.assign(ptrs->size(), 0);
+    }
+    result->numFailed = 0;
+    result->ok = true;
+
+    for (i = 0; i < trace->size(); i++) {
+        op = &(*trace)[i];
+        ptr = (*ptrs)[op->id];
+
+        if (op->type == 'a') {
+            ptr = expheapAlloc(heap, op->size, op->align);
+            (*ptrs)[op->id] = ptr;
+            if (ptr == NULL) {
+                result->numFailed++;
+            } else if (verify) {
+                align = op->align < 0 ? -op->align : op->align;
+                if (align < 4) {
+                    align = 4;
+                }
+                if ((uintptr_t)ptr % align != 0 || expheapGetSize(heap, ptr) < (s32)op->size) {
+                    fprintf(stderr, "op %u: %p for %u bytes aligned %d\n", (unsigned int)i, ptr,
+                            (unsigned int)op->size, (int)op->align);
+                    result->ok = false;
+                }
+                sizes[op->id] = op->size;
+                memset(ptr, getFillByte(op->id), op->size);
+            }
+        } else if (ptr == NULL) {
+            // what it was going to free or resize didn't fit
+        } else if (op->type == 'f') {
+            if (verify && !checkFill((u8*)ptr, sizes[op->id], op->id)) {
+                fprintf(stderr, "op %u: id %u was overwritten\n", (unsigned int)i, (unsigned int)op->id);
+                result->ok = false;
+            }
+            expheapFree(heap, ptr);
+            (*ptrs)[op->id] = NULL;
+        } else {
+            newSize = expheapResize(heap, ptr, op->size);
+            if (verify) {
+                if (newSize >= 0 && newSize < (s32)op->size) {
+                    fprintf(stderr, "op %u: resized to %d, not %u\n", (unsigned int)i, (int)newSize,
+                            (unsigned int)op->size);
+                    result->ok = false;
+                }
+                if (!checkFill((u8*)ptr, newSize >= 0 && (u32)newSize < sizes[op->id] ? newSize : sizes[op->id],
+                               op->id)) {
+                    fprintf(stderr, "op %u: resize lost id %u\n", (unsigned int)i, (unsigned int)op->id);
+                    result->ok = false;
+                }
+                if (newSize >= 0) {
+                    sizes[op->id] = op->size;
+                    memset(ptr, getFillByte(op->id), op->size);
+                }
+            }
+        }
+
+        if (verify && i % CHECK_INTERVAL == 0 && !expheapCheck(heap)) {
+            fprintf(stderr, "op %u: heap check failed\n", (unsigned int)i);
+            result->ok = false;
+        }
+        if (!result->ok) {
+            return;
+        }
+    }
+
+    if (verify && !expheapCheck(heap)) {
+        result->ok = false;
+    }
+    expheapGetFreeList(heap, &result->numFreeBlocks, &result->maxFreeBlock, &result->totalFree);
+}
+
+// A trace of random operations: any size, alignments either way, resizes
+static void genRandomTrace(u32 seed, u32 numOps, u32 maxLive, Trace* trace) {
+    static const s32 aligns[] = {4, 4, 4, 8, 16, 32, 64, 128, -4, -4, -32, -64};
+    std::vector<u32> live;
+    TraceGen gen;
+    u32 i;
+    u32 r;
+
+    gen.seed = 0x9E3779B97F4A7C15ULL ^ seed;
+    gen.nextId = 0;
+    gen.trace = trace;
+    trace->clear();
+
+    for (i = 0; i < numOps; i++) {
+        r = genRandom(&gen, 100);
+        if (live.empty() || (r < 55 && live.size() < maxLive)) {
+            live.push_back(genAlloc(&gen, genRandom(&gen, 8) == 0 ? genSize(&gen, 4096, 0x40000) : genRandom(&gen, 600),
+                                    aligns[genRandom(&gen, sizeof(aligns) / sizeof(aligns[0]))]));
+        } else if (r < 60) {
+            genResize(&gen, live[genRandom(&gen, live.size())], genRandom(&gen, 4096));
+        } else {
+            genFreeLive(&gen, &live, false);
+        }
+    }
+    while (!live.empty()) {
+        genFreeLive(&gen, &live, false);
+    }
+}
+
+static bool testRandom(void) {
+    std::vector<void*> ptrs;
+    RunResult result;
+    ExpHeap* heap;
+    Trace trace;
+    u32 seed;
+    int bins;
+
+    for (seed = 0; seed < 6; seed++) {
+        genRandomTrace(seed, 40000, 1000, &trace);
+        for (bins = 0; bins < 2; bins++) {
+            heap = expheapCreate(HEAP_SIZE / 4, bins != 0);
+            if (seed & 1) {
+                expheapSetFirstFit(heap);
+            }
+            runTrace(heap, &trace, &ptrs, true, &result);
+            if (!result.ok || result.numFreeBlocks != 1 || expheapGetTotalUsedSize(heap) != 0) {
+                fprintf(stderr, "random %u, bins %d: failed (%u free blocks at the end)\n", (unsigned int)seed, bins,
+                        (unsigned int)result.numFreeBlocks);
+                return false;
+            }
+            expheapDestroy(heap);
+        }
+    }
+    return true;
+}
+
+// The bins only speed things up, so blocks have to land exactly where they do without them: the best fit in
+// ALLOC_MODE_0, the first fit in ALLOC_MODE_1 and from the tail either way
+static bool testSamePlacement(bool firstFit) {
+    std::vector<void*> linearPtrs;
+    std::vector<void*> binsPtrs;
+    RunResult result;
+    ExpHeap* linear;
+    ExpHeap* bins;
+    Trace trace;
+    u8* linearBase;
+    u8* binsBase;
+    u32 binsSize;
+    size_t i;
+
+    bins = expheapCreate(HEAP_SIZE / 4, true);
+    binsBase = expheapGetFirstBlock(bins);
+    binsSize = binsBase - expheapGetStart(bins);
+    linear = expheapCreate(HEAP_SIZE / 4 - binsSize, false);
+    linearBase = expheapGetFirstBlock(linear);
+    if (binsSize == 0 || linearBase != expheapGetStart(linear) ||
+        expheapGetHeapSize(linear) != expheapGetHeapSize(bins) - binsSize) {
+        fprintf(stderr, "placement: bad heaps (bins %u bytes)\n", (unsigned int)binsSize);
+        return false;
+    }
+    if (firstFit) {
+        expheapSetFirstFit(linear);
+        expheapSetFirstFit(bins);
+    }
+
+    genRandomTrace(100, 40000, 1500, &trace);
+    trace.resize(trace.size() / 2); // stop with plenty allocated
+    // both heaps' blocks start on 16 bytes, but not the same distance from larger boundaries
+    for (i = 0; i < trace.size(); i++) {
+        if (trace[i].align > 16 || trace[i].align < -16) {
+            trace[i].align = trace[i].align > 0 ? 16 : -16;
+        }
+    }
+    runTrace(linear, &trace, &linearPtrs, true, &result);
+    if (!result.ok) {
+        return false;
+    }
+    runTrace(bins, &trace, &binsPtrs, true, &result);
+    if (!result.ok) {
+        return false;
+    }
+    for (i = 0; i < linearPtrs.size(); i++) {
+        if ((linearPtrs[i] == NULL) != (binsPtrs[i] == NULL) ||
+            (linearPtrs[i] != NULL && (u8*)linearPtrs[i] - linearBase != (u8*)binsPtrs[i] - binsBase)) {
+            fprintf(stderr, "placement, %s fit: id %u at %p and %p\n", firstFit ? "first" : "best", (unsigned int)i,
+                    linearPtrs[i], binsPtrs[i]);
+            return false;
+        }
+    }
+
+    expheapDestroy(linear);
+    expheapDestroy(bins);
+    return true;
+}
+
+// Group IDs, freeTail, freeAll, the state check and the dumps, on a heap with bins and a small one without
+static bool testHeapCalls(void) {
+    ExpHeap* heap;
+    void* tail[4];
+    void* head[4];
+    u32 reports;
+    u32 total;
+    int pass;
+    int i;
+
+    for (pass = 0; pass < 2; pass++) {
+        heap = expheapCreate(pass == 0 ? HEAP_SIZE / 4 : SMALL_HEAP_SIZE, true);
+        if ((expheapGetFirstBlock(heap) != expheapGetStart(heap)) != (pass == 0)) {
+            fprintf(stderr, "calls %d: bins %s\n", pass, pass == 0 ? "missing" : "in a small heap");
+            return false;
+        }
+        total = expheapGetTotalFreeSize(heap);
+
+        expheapChangeGroupID(heap, 3);
+        for (i = 0; i < 4; i++) {
+            head[i] = expheapAlloc(heap, 0x100 + i * 0x10, 4);
+            tail[i] = expheapAlloc(heap, 0x200, -32);
+        }
+        if (expheapChangeGroupID(heap, 0) != 3 || expheapGetUsedSize(heap, 3) != expheapGetTotalUsedSize(heap) ||
+            expheapGetUsedSize(heap, 0) != 0 || (u8*)tail[0] < (u8*)head[3]) {
+            fprintf(stderr, "calls %d: group ids or tail placement\n", pass);
+            return false;
+        }
+
+        if (!expheapCheckState(heap)) {
+            fprintf(stderr, "calls %d: state changed\n", pass);
+            return false;
+        }
+
+        expheapFreeTail(heap);
+        for (i = 0; i < 4; i++) {
+            expheapFree(heap, head[i]);
+        }
+        if (expheapGetTotalFreeSize(heap) != total || expheapGetFreeSize(heap) != total) {
+            fprintf(stderr, "calls %d: %u of %u bytes free after freeing everything\n", pass,
+                    (unsigned int)expheapGetTotalFreeSize(heap), (unsigned int)total);
+            return false;
+        }
+
+        for (i = 0; i < 4; i++) {
+            expheapAlloc(heap, 0x1000, i % 2 == 0 ? 64 : -64);
+        }
+        reports = expheapGetReportCount();
+        if (!expheapDump(heap) || expheapGetReportCount() - reports < 2 * (3 + 4 + 2)) {
+            fprintf(stderr, "calls %d: dump\n", pass);
+            return false;
+        }
+        expheapFreeAll(heap);
+        if (expheapGetTotalFreeSize(heap) != total || !expheapCheck(heap)) {
+            fprintf(stderr, "calls %d: freeAll\n", pass);
+            return false;
+        }
+        expheapDestroy(heap);
+    }
+    return true;
+}
+
+static int test(void) {
+    if (!testRandom() || !testSamePlacement(false) || !testSamePlacement(true) || !testHeapCalls()) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+static void printHeader(void) {
+    printf("%-8s %8s %7s %9s %10s %10s %10s %7s\n", "trace", "ops", "heap", "ns/op", "free blks", "largest",
+           "free", "failed");
+}
+
+// Replays trace on a fresh heap until BENCH_SECONDS have gone by and prints the time per operation, and the free
+// list as the first replay left it
+static bool benchTrace(const char* name, const Trace* trace, bool bins) {
+    std::vector<void*> ptrs;
+    RunResult result;
+    RunResult first;
+    ExpHeap* heap;
+    Clock::time_point start;
+    double seconds;
+    u32 runs;
+
+    heap = expheapCreate(HEAP_SIZE, bins);
+    runs = 0;
+    start = Clock::now();
+    do {
+        runTrace(heap, trace, &ptrs, false, &result);
+        if (runs++ == 0) {
+            first = result;
+        }
+        expheapFreeAll(heap);
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < BENCH_SECONDS);
+    expheapDestroy(heap);
+
+    printf("%-8s %8u %7s %9.1f %10u %10u %10u %7u\n", name, (unsigned int)trace->size(), bins ? "bins" : "linear",
+           seconds * 1e9 / ((double)runs * trace->size()), (unsigned int)first.numFreeBlocks,
+           (unsigned int)first.maxFreeBlock, (unsigned int)first.totalFree, (unsigned int)first.numFailed);
+    return true;
+}
+
+static int bench(void) {
+    static const char* kinds[] = {"actors", "scenes", "dvd", "mixed"};
+    Trace trace;
+    u32 i;
+
+    printf("%u byte heap; free blocks, largest and free as the trace leaves them\n", (unsigned int)HEAP_SIZE);
+    printHeader();
+    for (i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        genTrace(kinds[i], &trace);
+        benchTrace(kinds[i], &trace, false);
+        benchTrace(kinds[i], &trace, true);
+    }
+    return 0;
+}
+
+static int replay(const char* path) {
+    Trace trace;
+
+    if (!readTrace(path, &trace)) {
+        fprintf(stderr, "can't read %s\n", path);
+        return 1;
+    }
+    printHeader();
+    benchTrace("file", &trace, false);
+    benchTrace("file", &trace, true);
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: expheap test|bench\n"
+                    "       expheap trace actors|scenes|dvd|mixed [out]\n"
+                    "       expheap replay <trace>\n");
+}
+
+int main(int argc, char** argv) {
+    Trace trace;
+    FILE* file;
+    bool ok;
+
+    expheapInit();
+
+    if (argc == 2 && strcmp(argv[1], "test") == 0) {
+        return test();
+    }
+    if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+        return bench();
+    }
+    if ((argc == 3 || argc == 4) && strcmp(argv[1], "trace") == 0) {
+        if (!genTrace(argv[2], &trace)) {
+            usage();
+            return 1;
+        }
+        file = argc == 4 ? fopen(argv[3], "w") : stdout;
+        if (file == NULL) {
+            fprintf(stderr, "can't write %s\n", argv[3]);
+            return 1;
+        }
+        ok = writeTrace(file, &trace);
+        if (file != stdout) {
+            ok = fclose(file) == 0 && ok;
+        }
+        return ok ? 0 : 1;
+    }
+    if (argc == 3 && strcmp(argv[1], "replay") == 0) {
+        return replay(argv[2]);
+    }
+    usage();
+    return 1;
+}
@@ -0,0 +1,227 @@
+// The parts of JKRHeap, JSUList and the OS that JKRExpHeap.cpp, JKRSolidHeap.cpp and JKRHeapProfiler.cpp call,
+// enough to run them on the host: no disposers, no threads, a heap tree that only records parents, OSReport counted
+// and printed on request, and a stack pointer that is whatever back chain the caller made up.
+
+#include "JSystem/JKernel/JKRExpHeap.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_SIZE (96 * 1024 * 1024)
+
+static bool sReportVerbose;
+static unsigned int sReportCount;
+static FILE* sReportFile;
+static void* sStackPointer;
+
+void expheapSetReport(bool verbose) { sReportVerbose = verbose; }
+
+unsigned int expheapGetReportCount(void) { return sReportCount; }
+
+void expheapSetReportFile(FILE* file) { sReportFile = file; }
+
+void expheapSetStackPointer(void* sp) { sStackPointer = sp; }
+
+extern "C" {
+void OSReport(const char* msg, ...) {
+    va_list args;
+
+    sReportCount++;
+    if (sReportVerbose) {
+        va_start(args, msg);
+        vfprintf(sReportFile != NULL ? sReportFile : stdout, msg, args);
+        va_end(args);
+    }
+}
+
+void OSPanic(const char* file, int line, const char* msg, ...) {
+    va_list args;
+
+    fprintf(stderr, "%s:%d: ", file, line);
+    va_start(args, msg);
+    vfprintf(stderr, msg, args);
+    va_end(args);
+    abort();
+}
+
+void OSInitMutex(OSMutex* mutex) {}
+void OSLockMutex(OSMutex* mutex) {}
+void OSUnlockMutex(OSMutex* mutex) {}
+
+BOOL OSDisableInterrupts(void) { return 1; }
+BOOL OSRestoreInterrupts(BOOL level) { return level; }
+
+u32 OSGetStackPointer(void) { return (u32)sStackPointer; }
+}
+
+JSUPtrLink::JSUPtrLink(void* object) {
+    mList = NULL;
+    mObject = object;
+    mPrev = NULL;
+    mNext = NULL;
+}
+
+JSUPtrLink::~JSUPtrLink() {
+    if (mList != NULL) {
+        mList->remove(this);
+    }
+}
+
+JSUPtrList::JSUPtrList(bool init) {
+    if (init) {
+        initiate();
+    }
+}
+
+JSUPtrList::~JSUPtrList() {
+    while (mHead != NULL) {
+        remove(mHead);
+    }
+}
+
+void JSUPtrList::initiate() {
+    mHead = NULL;
+    mTail = NULL;
+    mLength = 0;
+}
+
+bool JSUPtrList::append(JSUPtrLink* ptr) {
+    if (ptr->mList != NULL) {
+        ptr->mList->remove(ptr);
+    }
+    ptr->mList = this;
+    ptr->mPrev = mTail;
+    ptr->mNext = NULL;
+    if (mTail != NULL) {
+        mTail->mNext = ptr;
+    } else {
+        mHead = ptr;
+    }
+    mTail = ptr;
+    mLength++;
+    return true;
+}
+
+bool JSUPtrList::remove(JSUPtrLink* ptr) {
+    if (ptr->mList != this) {
+        return false;
+    }
+    if (ptr->mPrev != NULL) {
+        ptr->mPrev->mNext = ptr->mNext;
+    } else {
+        mHead = ptr->mNext;
+    }
+    if (ptr->mNext != NULL) {
+        ptr->mNext->mPrev = ptr->mPrev;
+    } else {
+        mTail = ptr->mPrev;
+    }
+    ptr->mList = NULL;
+    mLength--;
+    return true;
+}
+
+JKRDisposer::JKRDisposer() : mLink(this) { mHeap = NULL; }
+
+JKRDisposer::~JKRDisposer() {}
+
+void* JKRHeap::mCodeStart;
+void* JKRHeap::mCodeEnd;
+void* JKRHeap::mUserRamStart;
+void* JKRHeap::mUserRamEnd;
+u32 JKRHeap::mMemorySize;
+JKRHeap* JKRHeap::sRootHeap;
+JKRHeap* JKRHeap::sSystemHeap;
+JKRHeap* JKRHeap::sCurrentHeap;
+bool JKRHeap::sDefaultFillFlag;
+JKRErrorHandler JKRHeap::mErrorHandler;
+
+JKRHeap::JKRHeap(void* data, u32 size, JKRHeap* parent, bool errorFlag)
+    : JKRDisposer(), mChildTree(this), mDisposerList() {
+    OSInitMutex(&mMutex);
+    mSize = size;
+    mStart = (u8*)data;
+    mEnd = (u8*)data + size;
+    if (parent != NULL) {
+        parent->mChildTree.appendChild(&mChildTree);
+    }
+    mDebugFill = sDefaultFillFlag;
+    mCheckMemoryFilled = sDefaultFillFlag;
+    mErrorFlag = errorFlag;
+    mInitFlag = false;
+}
+
+JKRHeap::~JKRHeap() {
+    JSUTree<JKRHeap>* parent = mChildTree.getParent();
+
+    if (parent != NULL) {
+        parent->removeChild(&mChildTree);
+    }
+}
+
+bool JKRHeap::initArena(char** memory, u32* size, int maxHeaps) {
+    *size = ARENA_SIZE;
+    *memory = (char*)malloc(*size);
+    return *memory != NULL;
+}
+
+void JKRHeap::fillMemory(void* dst, u32 size, u8 value) { memset(dst, value, size); }
+
+bool JKRHeap::checkMemoryFilled(void* src, u32 size, u8 value) {
+    u32 i;
+
+    for (i = 0; i < size; i++) {
+        if (((u8*)src)[i] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void JKRHeap::destroy() { do_destroy(); }
+
+void* JKRHeap::alloc(u32 size, int alignment) { return do_alloc(size, alignment); }
+
+void* JKRHeap::alloc(u32 size, int alignment, JKRHeap* heap) { return heap->alloc(size, alignment); }
+
+void JKRHeap::free(void* ptr) { do_free(ptr); }
+
+void JKRHeap::free(void* ptr, JKRHeap* heap) { heap->free(ptr); }
+
+void JKRHeap::freeAll() { do_freeAll(); }
+
+void JKRHeap::freeTail() { do_freeTail(); }
+
+s32 JKRHeap::resize(void* ptr, u32 size) { return do_resize(ptr, size); }
+
+s32 JKRHeap::getFreeSize() { return do_getFreeSize(); }
+
+void* JKRHeap::getMaxFreeBlock() { return do_getMaxFreeBlock(); }
+
+s32 JKRHeap::getTotalFreeSize() { return do_getTotalFreeSize(); }
+
+u32 JKRHeap::getMaxAllocatableSize(int alignment) { return getFreeSize(); }
+
+JKRHeap* JKRHeap::find(void* ptr) const { return mStart <= ptr && ptr < mEnd ? (JKRHeap*)this : NULL; }
+
+bool JKRHeap::dispose(void* ptr, u32 size) { return false; }
+
+void JKRHeap::dispose(void* begin, void* end) {}
+
+void JKRHeap::dispose() {}
+
+void JKRHeap::callAllDisposer() {}
+
+bool JKRHeap::dump_sort() { return true; }
+
+s32 JKRHeap::do_changeGroupID(u8 newGroupID) { return 0; }
+
+u8 JKRHeap::do_getCurrentGroupId() { return 0; }
+
+void JKRHeap::state_register(JKRHeap::TState* p, u32 id) const {}
+
+bool JKRHeap::state_compare(JKRHeap::TState const& r1, JKRHeap::TState const& r2) const { return true; }
+
+void JKRHeap::state_dump(JKRHeap::TState const& p) const {}
@@ -0,0 +1,20 @@
+#ifndef _HEAPPROF_HEAPPROF_H
+#define _HEAPPROF_HEAPPROF_H
+
+#include "../common/types.h"
+
+#include <stdio.h>
+
+// JKRHeapProfiler (src/JSystem/JKernel/JKRHeapProfiler.cpp) watching heaps made in a 96 MB root heap, behind plain
+// functions. sim.cpp, which builds them, doesn't include this, for the reasons given in ../expheap/expheap.h.
+
+void heapprofInit(void);
+// Runs a made-up game for numFrames frames with the profiler on and writes its dump and timeline to out. With leak,
+// one call site keeps every eighth block it allocates.
+bool heapprofSim(FILE* out, u32 numFrames, bool leak);
+// Checks the profiler's counts after a known run of heap calls
+bool heapprofTestCounts(void);
+// ns per allocate and free on a JKRExpHeap, with the profiler stopped and started
+void heapprofBench(double* off, double* on);
+
+#endif
@@ -0,0 +1,646 @@
+// Reads the "heapprof" lines JKRHeapProfiler writes through OSReport out of a log: report resolves its call sites
+// against a symbol map and ranks them, diff compares two runs' groups and timelines to catch memory growing between
+// builds. sim makes such a log from a made-up game, for the test and for trying the rest out.
+//
+// Call sites are charged to the first return address on their stack that isn't inside the heaps (or JKRHeap's
+// operator new), or that the map doesn't have; the rest of the stack is shown after it.
+
+#include "heapprof.h"
+#include "../common/test.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define DEFAULT_SYMBOLS "config/mq-j/symbols.txt" // under the repo root
+#define DEFAULT_FRAMES 600
+#define DEFAULT_THRESHOLD 1024
+#define REPORT_SITES 16
+#define MAX_STACK 16
+
+typedef struct Symbol {
+    u32 addr;
+    u32 size;
+    std::string name; // demangled
+} Symbol;
+
+typedef struct Group {
+    std::string key; // heap name/group
+    u32 allocs;
+    u32 frees;
+    u32 resizes;
+    u32 fails;
+    u32 bytes;
+    u32 liveBlocks;
+    u32 liveBytes;
+    u32 peakBytes;
+    u32 lifeAvg;
+    u32 lifeMax;
+} Group;
+
+typedef struct Site {
+    std::string key;
+    u32 allocs;
+    u32 bytes;
+    u32 liveBytes;
+    u32 peakBytes;
+    std::vector<u32> stack;
+} Site;
+
+typedef struct Sample {
+    u32 frame;
+    u32 liveBlocks;
+    u32 liveBytes;
+} Sample;
+
+typedef struct Profile {
+    std::map<u32, std::string> heaps;
+    std::vector<Group> groups;
+    std::vector<Site> sites;
+    std::map<std::string, std::vector<Sample> > timeline;
+    u32 dropped[3];
+} Profile;
+
+static std::vector<Symbol> sSymbols;
+
+// Enough of CodeWarrior's mangling for a readable name: name__<class>F<args>, the class possibly Q<n>-qualified
+static std::string demangle(const std::string& name) {
+    std::string base;
+    std::string cls;
+    size_t pos;
+    size_t i;
+    int count;
+    int len;
+
+    for (pos = name.find("__", 1); pos != std::string::npos; pos = name.find("__", pos + 1)) {
+        if (pos + 2 < name.size() && (isdigit((u8)name[pos + 2]) || name[pos + 2] == 'F' || name[pos + 2] == 'Q')) {
+            break;
+        }
+    }
+    if (pos == std::string::npos) {
+        return name;
+    }
+
+    base = name.substr(0, pos);
+    i = pos + 2;
+    count = 1;
+    if (name[i] == 'Q') {
+        count = name[i + 1] - '0';
+        i += 2;
+    }
+    for (; count > 0 && i < name.size() && isdigit((u8)name[i]); count--) {
+        len = atoi(name.c_str() + i);
+        while (isdigit((u8)name[i])) {
+            i++;
+        }
+        if (!cls.empty()) {
+            cls += "::";
+        }
+        cls += name.substr(i, len);
+        i += len;
+    }
+    if (cls.empty()) {
+        return base;
+    }
+    if (base == "__ct") {
+        base = cls.substr(cls.rfind(':') == std::string::npos ? 0 : cls.rfind(':') + 1);
+    } else if (base == "__dt") {
+        base = "~" + cls.substr(cls.rfind(':') == std::string::npos ? 0 : cls.rfind(':') + 1);
+    }
+    return cls + "::" + base;
+}
+
+static bool compareSymbols(const Symbol& a, const Symbol& b) { return a.addr < b.addr; }
+
+// name = .text:0x80005B9C; // type:function size:0x304 ...
+// DEFAULT_SYMBOLS in the nearest directory above the executable that has it, else above the current directory, so
+// the default works wherever the tool is run from
+static std::string findSymbols(void) {
+    std::string dir;
+    std::string path;
+    char buf[4096];
+    ssize_t len;
+    int pass;
+
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 0) {
+            len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+            if (len <= 0) {
+                continue;
+            }
+            buf[len] = '\0';
+            dir = buf;
+            dir.erase(dir.rfind('/'));
+        } else {
+            if (getcwd(buf, sizeof(buf)) == NULL) {
+                continue;
+            }
+            dir = buf;
+        }
+        while (true) {
+            path = dir + "/" + DEFAULT_SYMBOLS;
+            if (access(path.c_str(), R_OK) == 0) {
+                return path;
+            }
+            if (dir.empty() || dir == "/") {
+                break;
+            }
+            dir.erase(dir.rfind('/'));
+        }
+    }
+    return DEFAULT_SYMBOLS;
+}
+
+static bool loadSymbols(const char* path) {
+    FILE* file;
+    char line[1024];
+    char name[768];
+    char section[64];
+    const char* size;
+    unsigned int addr;
+    Symbol symbol;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "heapprof: cannot open %s, pass the map with -s\n", path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        size = strstr(line, "size:0x");
+        if (strstr(line, "type:function") == NULL || size == NULL ||
+            sscanf(line, "%767s = %63[^:]:0x%x;", name, section, &addr) != 3) {
+            continue;
+        }
+        symbol.addr = addr;
+        symbol.size = strtoul(size + 7, NULL, 16);
+        symbol.name = demangle(name);
+        sSymbols.push_back(symbol);
+    }
+    fclose(file);
+    std::sort(sSymbols.begin(), sSymbols.end(), compareSymbols);
+    return true;
+}
+
+static const Symbol* findSymbol(u32 addr) {
+    size_t lo = 0;
+    size_t hi = sSymbols.size();
+    size_t mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (sSymbols[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0 || addr >= sSymbols[lo - 1].addr + sSymbols[lo - 1].size) {
+        return NULL;
+    }
+    return &sSymbols[lo - 1];
+}
+
+static std::string getSymbolName(u32 addr) {
+    const Symbol* symbol = findSymbol(addr);
+    char buf[64];
+
+    if (symbol == NULL) {
+        snprintf(buf, sizeof(buf), "%08x", addr);
+        return buf;
+    }
+    snprintf(buf, sizeof(buf), "+0x%x", addr - symbol->addr);
+    return symbol->name + buf;
+}
+
+static bool isAllocator(const Symbol* symbol) {
+    static const char* const sPrefixes[] = {
+        "JKRHeap::", "JKRExpHeap::", "JKRSolidHeap::", "JKRStdHeap::", "JKRAssertHeap::", "JKRHeapProfiler::",
+        "__nw", "__nwa", "JKRAllocFromHeap",
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(sPrefixes) / sizeof(sPrefixes[0]); i++) {
+        if (symbol->name.compare(0, strlen(sPrefixes[i]), sPrefixes[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Index of the frame the site is charged to
+static size_t getCaller(const Site& site) {
+    const Symbol* symbol;
+    size_t i;
+
+    for (i = 0; i < site.stack.size(); i++) {
+        symbol = findSymbol(site.stack[i]);
+        if (symbol != NULL && !isAllocator(symbol)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static std::string getGroupKey(const Profile* profile, u32 heap, u32 group) {
+    std::map<u32, std::string>::const_iterator it = profile->heaps.find(heap);
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "/%u", group);
+    return (it != profile->heaps.end() ? it->second : "?") + buf;
+}
+
+static bool readProfile(const char* path, Profile* profile) {
+    FILE* file;
+    char line[1024];
+    char name[256];
+    const char* p;
+    u32 v[12];
+    Group group;
+    Site site;
+    Sample sample;
+    unsigned int addr;
+    int n;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "heapprof: cannot open %s, pass the map with -s\n", path);
+        return false;
+    }
+    memset(profile->dropped, 0, sizeof(profile->dropped));
+    while (fgets(line, sizeof(line), file) != NULL) {
+        // anything else in the log is someone else's
+        p = strstr(line, "heapprof ");
+        if (p == NULL) {
+            continue;
+        }
+        p += 9;
+        if (sscanf(p, "heap %u %255s", &v[0], name) == 2) {
+            profile->heaps[v[0]] = name;
+        } else if (sscanf(p, "group %u %u %u %u %u %u %u %u %u %u %u %u", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+                          &v[6], &v[7], &v[8], &v[9], &v[10], &v[11]) == 12) {
+            group.key = getGroupKey(profile, v[0], v[1]);
+            group.allocs = v[2];
+            group.frees = v[3];
+            group.resizes = v[4];
+            group.fails = v[5];
+            group.bytes = v[6];
+            group.liveBlocks = v[7];
+            group.liveBytes = v[8];
+            group.peakBytes = v[9];
+            group.lifeAvg = v[10];
+            group.lifeMax = v[11];
+            profile->groups.push_back(group);
+        } else if (sscanf(p, "site %u %u %u %u %u %u%n", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &n) == 6) {
+            site.key = getGroupKey(profile, v[0], v[1]);
+            site.allocs = v[2];
+            site.bytes = v[3];
+            site.liveBytes = v[4];
+            site.peakBytes = v[5];
+            site.stack.clear();
+            for (p += n; sscanf(p, " %x%n", &addr, &n) == 1 && site.stack.size() < MAX_STACK; p += n) {
+                site.stack.push_back(addr);
+            }
+            profile->sites.push_back(site);
+        } else if (sscanf(p, "sample %u %u %u %u %u", &v[0], &v[1], &v[2], &v[3], &v[4]) == 5) {
+            sample.frame = v[0];
+            sample.liveBlocks = v[3];
+            sample.liveBytes = v[4];
+            profile->timeline[getGroupKey(profile, v[1], v[2])].push_back(sample);
+        } else if (sscanf(p, "dropped %u %u %u", &v[0], &v[1], &v[2]) == 3) {
+            profile->dropped[0] = v[0];
+            profile->dropped[1] = v[1];
+            profile->dropped[2] = v[2];
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static bool compareSites(const Site& a, const Site& b) { return a.bytes > b.bytes; }
+
+// The sites merged by what they're charged to, most bytes first
+static void getCallers(const Profile* profile, std::vector<Site>* callers) {
+    std::map<std::string, size_t> index;
+    std::string key;
+    size_t caller;
+    size_t i;
+
+    for (i = 0; i < profile->sites.size(); i++) {
+        const Site& site = profile->sites[i];
+
+        caller = getCaller(site);
+        key = site.key + " " + (caller < site.stack.size() ? getSymbolName(site.stack[caller]) : "?");
+        if (index.find(key) == index.end()) {
+            index[key] = callers->size();
+            callers->push_back(site);
+            callers->back().stack.erase(callers->back().stack.begin(), callers->back().stack.begin() + caller);
+            continue;
+        }
+        Site& merged = (*callers)[index[key]];
+        merged.allocs += site.allocs;
+        merged.bytes += site.bytes;
+        merged.liveBytes += site.liveBytes;
+        merged.peakBytes = std::max(merged.peakBytes, site.peakBytes);
+    }
+    std::stable_sort(callers->begin(), callers->end(), compareSites);
+}
+
+static int report(const char* path) {
+    Profile profile;
+    std::vector<Site> callers;
+    size_t i;
+    size_t j;
+
+    if (!readProfile(path, &profile)) {
+        return 1;
+    }
+
+    printf("%-16s %8s %8s %5s %10s %8s %10s %10s %8s %8s\n", "heap/group", "allocs", "frees", "fails", "bytes",
+           "live", "live bytes", "peak bytes", "life avg", "life max");
+    for (i = 0; i < profile.groups.size(); i++) {
+        const Group& g = profile.groups[i];
+
+        printf("%-16s %8u %8u %5u %10u %8u %10u %10u %8u %8u\n", g.key.c_str(), g.allocs, g.frees, g.fails, g.bytes,
+               g.liveBlocks, g.liveBytes, g.peakBytes, g.lifeAvg, g.lifeMax);
+    }
+
+    getCallers(&profile, &callers);
+    printf("\n%-16s %8s %10s %10s  %s\n", "heap/group", "allocs", "bytes", "live bytes", "call site");
+    for (i = 0; i < callers.size() && i < REPORT_SITES; i++) {
+        const Site& s = callers[i];
+
+        printf("%-16s %8u %10u %10u  %s", s.key.c_str(), s.allocs, s.bytes, s.liveBytes,
+               s.stack.empty() ? "?" : getSymbolName(s.stack[0]).c_str());
+        for (j = 1; j < s.stack.size(); j++) {
+            printf(" < %s", getSymbolName(s.stack[j]).c_str());
+        }
+        printf("\n");
+    }
+    if (profile.dropped[0] != 0 || profile.dropped[1] != 0 || profile.dropped[2] != 0) {
+        printf("\nnot followed: %u blocks, %u call sites, %u samples\n", profile.dropped[0], profile.dropped[1],
+               profile.dropped[2]);
+    }
+    return 0;
+}
+
+static const Group* findGroup(const Profile* profile, const std::string& key) {
+    size_t i;
+
+    for (i = 0; i < profile->groups.size(); i++) {
+        if (profile->groups[i].key == key) {
+            return &profile->groups[i];
+        }
+    }
+    return NULL;
+}
+
+// Counts the groups whose peak or final live bytes grew by more than threshold, or whose live bytes did at some
+// frame both runs sampled
+static u32 diffProfiles(const Profile* oldProfile, const Profile* newProfile, u32 threshold, bool print) {
+    static const Group sEmpty = {"", 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    std::vector<std::string> keys;
+    std::map<std::string, std::vector<Sample> >::const_iterator it;
+    const Group* oldGroup;
+    const Group* newGroup;
+    const std::vector<Sample>* oldSamples;
+    const std::vector<Sample>* newSamples;
+    s64 delta;
+    s64 maxDelta;
+    u32 firstFrame;
+    u32 numRegressions;
+    bool regressed;
+    size_t i;
+    size_t j;
+    size_t k;
+
+    for (i = 0; i < oldProfile->groups.size(); i++) {
+        keys.push_back(oldProfile->groups[i].key);
+    }
+    for (i = 0; i < newProfile->groups.size(); i++) {
+        if (findGroup(oldProfile, newProfile->groups[i].key) == NULL) {
+            keys.push_back(newProfile->groups[i].key);
+        }
+    }
+
+    if (print) {
+        printf("%-16s %21s %21s %21s  %s\n", "heap/group", "allocs", "peak bytes", "live bytes at end",
+               "timeline");
+    }
+    numRegressions = 0;
+    for (i = 0; i < keys.size(); i++) {
+        oldGroup = findGroup(oldProfile, keys[i]);
+        newGroup = findGroup(newProfile, keys[i]);
+        oldGroup = oldGroup != NULL ? oldGroup : &sEmpty;
+        newGroup = newGroup != NULL ? newGroup : &sEmpty;
+
+        // both timelines are in frame order
+        maxDelta = 0;
+        firstFrame = 0;
+        it = oldProfile->timeline.find(keys[i]);
+        oldSamples = it != oldProfile->timeline.end() ? &it->second : NULL;
+        it = newProfile->timeline.find(keys[i]);
+        newSamples = it != newProfile->timeline.end() ? &it->second : NULL;
+        for (j = 0, k = 0; oldSamples != NULL && newSamples != NULL && j < oldSamples->size() &&
+                           k < newSamples->size();) {
+            if ((*oldSamples)[j].frame < (*newSamples)[k].frame) {
+                j++;
+            } else if ((*oldSamples)[j].frame > (*newSamples)[k].frame) {
+                k++;
+            } else {
+                delta = (s64)(*newSamples)[k].liveBytes - (*oldSamples)[j].liveBytes;
+                if (delta > (s64)threshold && firstFrame == 0 && maxDelta <= (s64)threshold) {
+                    firstFrame = (*newSamples)[k].frame;
+                }
+                maxDelta = std::max(maxDelta, delta);
+                j++;
+                k++;
+            }
+        }
+
+        regressed = newGroup->peakBytes > oldGroup->peakBytes + threshold ||
+                    newGroup->liveBytes > oldGroup->liveBytes + threshold || maxDelta > (s64)threshold;
+        numRegressions += regressed;
+        if (print) {
+            printf("%-16s %10u %+10d %10u %+10d %10u %+10d  ", keys[i].c_str(), newGroup->allocs,
+                   (int)(newGroup->allocs - oldGroup->allocs), newGroup->peakBytes,
+                   (int)(newGroup->peakBytes - oldGroup->peakBytes), newGroup->liveBytes,
+                   (int)(newGroup->liveBytes - oldGroup->liveBytes));
+            if (maxDelta > (s64)threshold) {
+                printf("up to %+lld from frame %u", (long long)maxDelta, firstFrame);
+            } else {
+                printf("same");
+            }
+            printf("%s\n", regressed ? "  REGRESSED" : "");
+        }
+    }
+    return numRegressions;
+}
+
+static int diff(const char* oldPath, const char* newPath, u32 threshold) {
+    Profile oldProfile;
+    Profile newProfile;
+    u32 numRegressions;
+
+    if (!readProfile(oldPath, &oldProfile) || !readProfile(newPath, &newProfile)) {
+        return 2;
+    }
+    numRegressions = diffProfiles(&oldProfile, &newProfile, threshold, true);
+    printf("%u group%s grew by more than %u bytes\n", numRegressions, numRegressions == 1 ? "" : "s", threshold);
+    return numRegressions != 0 ? 1 : 0;
+}
+
+static bool runSim(const char* path, bool leak) {
+    FILE* file = fopen(path, "w");
+    bool ok;
+
+    if (file == NULL) {
+        return false;
+    }
+    // what the profiler writes turns up in the middle of everything else
+    fprintf(file, "OSReport: boot\n");
+    ok = heapprofSim(file, DEFAULT_FRAMES, leak);
+    fprintf(file, "OSReport: done\n");
+    fclose(file);
+    return ok;
+}
+
+static int test(const char* symbolsPath) {
+    Profile base;
+    Profile again;
+    Profile leak;
+    std::vector<Site> callers;
+    const std::vector<Sample>* samples;
+    const Group* group;
+    char basePath[] = "/tmp/heapprofXXXXXX";
+    char leakPath[] = "/tmp/heapprofXXXXXX";
+    u32 numRegressions;
+    size_t i;
+    bool ok;
+
+    ok = true;
+    ok &= expect(heapprofTestCounts(), "profiler counts");
+    ok &= expect(loadSymbols(symbolsPath), "symbols");
+    ok &= expect(demangle("alloc__7JKRHeapFUliP7JKRHeap") == "JKRHeap::alloc", "demangle");
+    ok &= expect(demangle("__ct__Q28JUtility6TColorFUcUcUcUc") == "JUtility::TColor::TColor", "demangle Q");
+    ok &= expect(demangle("main") == "main", "demangle C");
+
+    close(mkstemp(basePath));
+    close(mkstemp(leakPath));
+    ok &= expect(runSim(basePath, false) && runSim(leakPath, true), "sim");
+    ok &= expect(readProfile(basePath, &base) && readProfile(basePath, &again) && readProfile(leakPath, &leak),
+                 "read");
+
+    ok &= expect(base.heaps.size() == 3 && base.groups.size() == 5, "heaps and groups");
+    for (i = 0; i < base.groups.size(); i++) {
+        ok &= expect(base.groups[i].allocs - base.groups[i].frees == base.groups[i].liveBlocks, "group counts");
+    }
+    group = findGroup(&base, "frame/0");
+    ok &= expect(group != NULL && group->liveBytes == 0 && group->allocs == group->frees, "frame scopes");
+    group = findGroup(&base, "game/1");
+    ok &= expect(group != NULL && group->resizes != 0 && group->lifeMax == 200, "resources");
+    // sampled every frame from the one after the first effect, up to the sample after the last frame
+    samples = &base.timeline["game/2"];
+    ok &= expect(!samples->empty() && samples->back().frame == DEFAULT_FRAMES &&
+                     samples->size() == DEFAULT_FRAMES - samples->front().frame + 1,
+                 "timeline");
+
+    // the frame's scratch is the most bytes, and the stacks are charged past the heaps and operator new
+    getCallers(&base, &callers);
+    ok &= expect(callers.size() == 6, "callers");
+    ok &= expect(!callers.empty() && getSymbolName(callers[0].stack[0]) == "rendering+0x1a40", "top caller");
+    for (i = 0; i < callers.size(); i++) {
+        ok &= expect(getSymbolName(callers[i].stack[0]).find("JKR") == std::string::npos &&
+                         getSymbolName(callers[i].stack[0]).find("__nw") == std::string::npos,
+                     "caller outside the heaps");
+    }
+
+    ok &= expect(diffProfiles(&base, &again, DEFAULT_THRESHOLD, false) == 0, "same run");
+    numRegressions = diffProfiles(&base, &leak, DEFAULT_THRESHOLD, false);
+    ok &= expect(numRegressions == 1, "leak found");
+    group = findGroup(&leak, "game/2");
+    ok &= expect(group != NULL && group->liveBytes > findGroup(&base, "game/2")->liveBytes, "leak in effects");
+
+    remove(basePath);
+    remove(leakPath);
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int bench(void) {
+    double off;
+    double on;
+
+    heapprofBench(&off, &on);
+    printf("JKRExpHeap free and alloc: %.1f ns stopped, %.1f ns profiled\n", off, on);
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: heapprof [-s symbols] report <log>\n"
+                    "       heapprof [-t bytes] diff <old log> <new log>\n"
+                    "       heapprof sim [leak] [frames]\n"
+                    "       heapprof [-s symbols] test|bench\n");
+}
+
+int main(int argc, char** argv) {
+    std::string defaultSymbols;
+    const char* symbolsPath = NULL;
+    u32 threshold = DEFAULT_THRESHOLD;
+    u32 numFrames = DEFAULT_FRAMES;
+    bool leak = false;
+    int i;
+
+    for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        if (strcmp(argv[i], "-s") == 0) {
+            symbolsPath = argv[i + 1];
+        } else if (strcmp(argv[i], "-t") == 0) {
+            threshold = strtoul(argv[i + 1], NULL, 0);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    argc -= i;
+    argv += i;
+    if (argc < 1) {
+        usage();
+        return 2;
+    }
+
+    if (symbolsPath == NULL) {
+        defaultSymbols = findSymbols();
+        symbolsPath = defaultSymbols.c_str();
+    }
+
+    heapprofInit();
+    if (strcmp(argv[0], "report") == 0 && argc == 2) {
+        return loadSymbols(symbolsPath) ? report(argv[1]) : 1;
+    }
+    if (strcmp(argv[0], "diff") == 0 && argc == 3) {
+        return diff(argv[1], argv[2], threshold);
+    }
+    if (strcmp(argv[0], "sim") == 0 && argc <= 3) {
+        for (i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "leak") == 0) {
+                leak = true;
+            } else {
+                numFrames = strtoul(argv[i], NULL, 0);
+            }
+        }
+        return heapprofSim(stdout, numFrames, leak) ? 0 : 1;
+    }
+    if (strcmp(argv[0], "test") == 0 && argc == 1) {
+        return test(symbolsPath);
+    }
+    if (strcmp(argv[0], "bench") == 0 && argc == 1) {
+        return bench();
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,355 @@
+// The functions in heapprof.h, on the JKernel side of that header.
+//
+// The call stacks the profiler sees are made up: before each allocation a back chain is laid out the way the
+// PowerPC ABI does it, with return addresses inside the functions of config/mq-j/symbols.txt that the allocation
+// is pretending to come from, so there is something for the host tool to resolve.
+
+#include "JSystem/JKernel/JKRExpHeap.h"
+#include "JSystem/JKernel/JKRHeapProfiler.h"
+#include "JSystem/JKernel/JKRSolidHeap.h"
+#include "../common/test.h"
+
+#include <stdio.h>
+#include <time.h>
+
+// In ../expheap/stubs.cpp
+void expheapSetReport(bool verbose);
+void expheapSetReportFile(FILE* file);
+void expheapSetStackPointer(void* sp);
+
+#define RET_PROFILER 0x80400010 // JKRHeapProfiler::onAlloc, which the map doesn't have yet; never kept
+#define RET_EXP_DO_ALLOC (0x80031B40 + 0x9C) // JKRExpHeap::do_alloc
+#define RET_SOLID_DO_ALLOC (0x80033608 + 0x60) // JKRSolidHeap::do_alloc
+#define RET_HEAP_ALLOC (0x800309B0 + 0x1C) // JKRHeap::alloc(u32, int)
+#define RET_HEAP_ALLOC_STATIC (0x80030950 + 0x44) // JKRHeap::alloc(u32, int, JKRHeap*)
+#define RET_NEW (0x80031198 + 0x40) // operator new(u32, JKRHeap*, int)
+#define RET_MAIN (0x80005B9C + 0x1F0)
+#define RET_LOADER (0x800068C8 + 0x34)
+#define RET_OPENING (0x80006930 + 0x2A4)
+#define RET_EMITTER (0x80007A50 + 0x2C) // my_createSimpleEmitter
+#define RET_BTK (0x80007B64 + 0x90) // setBtkAnime
+#define RET_RENDERING (0x80007DBC + 0x1A40)
+#define RET_SCREEN (0x8000C590 + 0x30) // J2DScreen::J2DScreen
+
+#define MAX_FRAMES 10
+#define MAX_EMITTERS 256
+#define MAX_RESOURCES 64
+#define SCENE_FRAMES 200
+#define SCREEN_FRAMES 100
+#define CHURN_OPS 20000
+#define CHURN_BLOCKS 512
+#define BENCH_OPS 200000
+
+#define GROUP_RESOURCE 1
+#define GROUP_EFFECT 2
+#define GROUP_SCREEN 3
+
+typedef struct Emitter {
+    void* ptr;
+    void* anim;
+    unsigned int death;
+} Emitter;
+
+static JKRExpHeap* sRootHeap;
+static unsigned long sFrames[MAX_FRAMES][2]; // back chain, then the return address saved by the callee
+static unsigned long long sSeed;
+
+void heapprofInit(void) { sRootHeap = JKRExpHeap::createRoot(1, false); }
+
+static unsigned int genRandom(unsigned int range) {
+    sSeed ^= sSeed << 13;
+    sSeed ^= sSeed >> 7;
+    sSeed ^= sSeed << 17;
+    return (unsigned int)(sSeed >> 16) % range;
+}
+
+static unsigned int genSize(unsigned int min, unsigned int max) { return (min + genRandom(max - min + 1)) & ~3; }
+
+// The stack of an allocation from caller, itself called from outer, that went through heapRet (the heap's
+// do_alloc), JKRHeap::alloc and, if viaNew, operator new
+static void setCallStack(unsigned long heapRet, bool viaNew, unsigned long caller, unsigned long outer) {
+    unsigned long rets[MAX_FRAMES];
+    int n;
+    int i;
+
+    n = 0;
+    rets[n++] = RET_PROFILER;
+    rets[n++] = heapRet;
+    rets[n++] = RET_HEAP_ALLOC;
+    rets[n++] = RET_HEAP_ALLOC_STATIC;
+    if (viaNew) {
+        rets[n++] = RET_NEW;
+    }
+    rets[n++] = caller;
+    rets[n++] = outer;
+
+    for (i = 0; i < n; i++) {
+        sFrames[i][0] = (unsigned long)sFrames[i + 1];
+        sFrames[i + 1][1] = rets[i];
+    }
+    sFrames[n][0] = 0;
+    expheapSetStackPointer(sFrames[0]);
+}
+
+static void loadScene(JKRExpHeap* heap, void** resources, int* numResources) {
+    unsigned int size;
+    int i;
+
+    for (i = 0; i < *numResources; i++) {
+        heap->free(resources[i]);
+    }
+
+    // decompressed into a buffer the size of the archive entry, then cut down to what it needed
+    heap->do_changeGroupID(GROUP_RESOURCE);
+    setCallStack(RET_EXP_DO_ALLOC, false, RET_LOADER, 0);
+    *numResources = 24 + genRandom(MAX_RESOURCES - 24);
+    for (i = 0; i < *numResources; i++) {
+        size = genSize(0x1000, 0x10000);
+        resources[i] = heap->alloc(size, 0x20);
+        heap->resize(resources[i], size - genSize(0, size / 4));
+    }
+}
+
+bool heapprofSim(FILE* out, unsigned int numFrames, bool leak) {
+    JKRExpHeap* systemHeap;
+    JKRExpHeap* gameHeap;
+    JKRSolidHeap* frameHeap;
+    Emitter emitters[MAX_EMITTERS];
+    void* resources[MAX_RESOURCES];
+    void* screen;
+    int numEmitters;
+    int numResources;
+    unsigned int numSpawned;
+    unsigned int frame;
+    unsigned int n;
+    int i;
+    bool ok;
+
+    sSeed = 0x2545F4914F6CDD1DULL;
+    systemHeap = JKRExpHeap::create(4 * 1024 * 1024, sRootHeap, false);
+    gameHeap = JKRExpHeap::create(16 * 1024 * 1024, sRootHeap, false);
+    frameHeap = JKRSolidHeap::create(0x80000, sRootHeap, false);
+    if (!JKRHeapProfiler::start(systemHeap, 0x2000, 256, numFrames * 8 + 8)) {
+        return false;
+    }
+    JKRHeapProfiler::setHeapName(systemHeap, "system");
+    JKRHeapProfiler::setHeapName(gameHeap, "game");
+    JKRHeapProfiler::setHeapName(frameHeap, "frame");
+
+    setCallStack(RET_EXP_DO_ALLOC, false, RET_OPENING, RET_MAIN);
+    for (i = 0; i < 24; i++) {
+        systemHeap->alloc(genSize(0x40, 0x2000), 4);
+    }
+
+    ok = true;
+    numEmitters = 0;
+    numResources = 0;
+    numSpawned = 0;
+    screen = NULL;
+    for (frame = 0; frame < numFrames; frame++) {
+        JKRHeapProfiler::sample(frame);
+        if (frame % SCENE_FRAMES == 0) {
+            loadScene(gameHeap, resources, &numResources);
+        }
+
+        if (frame % SCREEN_FRAMES == 0) {
+            gameHeap->do_changeGroupID(GROUP_SCREEN);
+            setCallStack(RET_EXP_DO_ALLOC, true, RET_SCREEN, RET_OPENING);
+            screen = gameHeap->alloc(0x800, 4);
+        } else if (frame % SCREEN_FRAMES == SCREEN_FRAMES / 2) {
+            gameHeap->free(screen);
+        }
+
+        gameHeap->do_changeGroupID(GROUP_EFFECT);
+        for (i = 0; i < numEmitters;) {
+            if (emitters[i].death != frame) {
+                i++;
+                continue;
+            }
+            gameHeap->free(emitters[i].ptr);
+            if (emitters[i].anim != NULL) {
+                gameHeap->free(emitters[i].anim);
+            }
+            emitters[i] = emitters[--numEmitters];
+        }
+        for (n = genRandom(4); n > 0 && numEmitters < MAX_EMITTERS; n--) {
+            Emitter* emitter = &emitters[numEmitters++];
+
+            setCallStack(RET_EXP_DO_ALLOC, true, RET_EMITTER, RET_RENDERING);
+            emitter->ptr = gameHeap->alloc(genSize(0x100, 0x800), 4);
+            setCallStack(RET_EXP_DO_ALLOC, false, RET_BTK, RET_EMITTER);
+            emitter->anim = gameHeap->alloc(genSize(0x40, 0x200), 4);
+            emitter->death = frame + 10 + genRandom(110);
+            ok &= emitter->ptr != NULL && emitter->anim != NULL;
+            if (leak && numSpawned++ % 8 == 0) {
+                emitter->anim = NULL;
+            }
+        }
+
+        {
+            JKRSolidHeap::CScope scope(frameHeap, JKRSolidHeap::MARK_TAIL);
+
+            setCallStack(RET_SOLID_DO_ALLOC, false, RET_RENDERING, RET_MAIN);
+            for (n = 16 + genRandom(48); n > 0; n--) {
+                ok &= frameHeap->alloc(genSize(0x40, 0x400), -4) != NULL;
+            }
+        }
+    }
+    JKRHeapProfiler::sample(numFrames);
+
+    expheapSetReportFile(out);
+    expheapSetReport(true);
+    JKRHeapProfiler::dump(16);
+    JKRHeapProfiler::dumpTimeline();
+    expheapSetReport(false);
+    expheapSetReportFile(NULL);
+
+    JKRHeapProfiler::stop();
+    frameHeap->destroy();
+    gameHeap->destroy();
+    systemHeap->destroy();
+    return ok;
+}
+
+static bool checkStat(const JKRHeapProfiler::TStat* stat, unsigned int allocs, unsigned int frees,
+                      unsigned int liveBytes, unsigned int peakBytes, const char* what) {
+    if (stat == NULL) {
+        return expect(false, what);
+    }
+    return expect(stat->mAllocCount == allocs && stat->mFreeCount == frees && stat->mLiveBytes == liveBytes &&
+                      stat->mPeakBytes == peakBytes && stat->mLiveBlocks == allocs - frees,
+                  what);
+}
+
+bool heapprofTestCounts(void) {
+    const JKRHeapProfiler::TStat* stat;
+    JKRExpHeap* heap;
+    JKRSolidHeap* solidHeap;
+    void* ptrs[CHURN_BLOCKS];
+    unsigned int sizes[CHURN_BLOCKS];
+    unsigned int liveBlocks;
+    unsigned int liveBytes;
+    void* a;
+    void* b;
+    void* c;
+    void* heapStart;
+    int op;
+    int i;
+    bool ok;
+
+    ok = true;
+    sSeed = 0x9E3779B97F4A7C15ULL;
+    heap = JKRExpHeap::create(0x100000, sRootHeap, false);
+    solidHeap = JKRSolidHeap::create(0x10000, sRootHeap, false);
+    ok &= expect(JKRHeapProfiler::start(sRootHeap, 0x1000, 64, 64), "start");
+    setCallStack(RET_EXP_DO_ALLOC, false, RET_LOADER, 0);
+
+    JKRHeapProfiler::sample(10);
+    a = heap->alloc(100, 4);
+    b = heap->alloc(200, 4);
+    c = heap->alloc(300, -4);
+    ok &= expect(a != NULL && b != NULL && c != NULL, "alloc");
+    JKRHeapProfiler::sample(15);
+    heap->free(a);
+    heap->resize(b, 400);
+    ok &= expect(heap->alloc(0x200000, 4) == NULL, "too large fails");
+
+    // a new exp heap's group is 0xFF
+    stat = JKRHeapProfiler::findStat(heap, 0xFF);
+    ok &= checkStat(stat, 3, 1, 700, 700, "alloc, free and resize");
+    ok &= expect(stat != NULL && stat->mResizeCount == 1 && stat->mFailCount == 1, "resize and fail counts");
+    ok &= expect(stat != NULL && stat->mLifetimeSum == 5 && stat->mLifetimeMax == 5, "lifetime in frames");
+
+    heap->freeTail();
+    ok &= checkStat(stat, 3, 2, 400, 700, "freeTail");
+    heap->freeAll();
+    ok &= checkStat(stat, 3, 3, 0, 700, "freeAll");
+
+    {
+        JKRSolidHeap::CScope scope(solidHeap);
+
+        solidHeap->alloc(64, 4);
+        solidHeap->alloc(64, -4);
+        solidHeap->alloc(64, 4);
+    }
+    ok &= checkStat(JKRHeapProfiler::findStat(solidHeap, 0), 3, 3, 0, 192, "rewind");
+
+    // enough blocks coming and going to move plenty of them around in the table
+    liveBlocks = 0;
+    liveBytes = 0;
+    for (i = 0; i < CHURN_BLOCKS; i++) {
+        ptrs[i] = NULL;
+    }
+    for (op = 0; op < CHURN_OPS; op++) {
+        i = genRandom(CHURN_BLOCKS);
+        if (ptrs[i] != NULL) {
+            heap->free(ptrs[i]);
+            liveBlocks--;
+            liveBytes -= sizes[i];
+            ptrs[i] = NULL;
+        } else {
+            sizes[i] = genSize(4, 0x400);
+            ptrs[i] = heap->alloc(sizes[i], genRandom(2) ? 4 : -4);
+            liveBlocks++;
+            liveBytes += sizes[i];
+        }
+    }
+    stat = JKRHeapProfiler::findStat(heap, 0xFF);
+    ok &= expect(stat->mLiveBlocks == liveBlocks && stat->mLiveBytes == liveBytes, "churn");
+    ok &= expect(stat->mAllocCount - stat->mFreeCount == liveBlocks, "churn counts");
+
+    // a heap made where one was destroyed is new to the profiler
+    heapStart = heap;
+    heap->destroy();
+    ok &= expect(stat->mLiveBlocks == 0 && stat->mLiveBytes == 0, "destroy");
+    heap = JKRExpHeap::create(0x100000, sRootHeap, false);
+    heap->alloc(16, 4);
+    ok &= expect((void*)heap == heapStart && JKRHeapProfiler::findStat(heap, 0xFF) != stat, "heap made again");
+    ok &= checkStat(JKRHeapProfiler::findStat(heap, 0xFF), 1, 0, 16, 16, "heap made again counts");
+
+    JKRHeapProfiler::stop();
+    solidHeap->destroy();
+    heap->destroy();
+    return ok;
+}
+
+static double getSeconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double benchPairs(JKRExpHeap* heap) {
+    void* ptrs[CHURN_BLOCKS];
+    double start;
+    int op;
+    int i;
+
+    for (i = 0; i < CHURN_BLOCKS; i++) {
+        ptrs[i] = heap->alloc(genSize(0x10, 0x400), 4);
+    }
+    start = getSeconds();
+    for (op = 0; op < BENCH_OPS; op++) {
+        i = genRandom(CHURN_BLOCKS);
+        heap->free(ptrs[i]);
+        ptrs[i] = heap->alloc(genSize(0x10, 0x400), 4);
+    }
+    start = (getSeconds() - start) * 1e9 / BENCH_OPS;
+    heap->freeAll();
+    return start;
+}
+
+void heapprofBench(double* off, double* on) {
+    JKRExpHeap* heap;
+
+    heap = JKRExpHeap::create(0x400000, sRootHeap, false);
+    setCallStack(RET_EXP_DO_ALLOC, true, RET_EMITTER, RET_RENDERING);
+    sSeed = 1;
+    *off = benchPairs(heap);
+    JKRHeapProfiler::start(sRootHeap, 0x1000, 64, 64);
+    sSeed = 1;
+    *on = benchPairs(heap);
+    JKRHeapProfiler::stop();
+    heap->destroy();
+}
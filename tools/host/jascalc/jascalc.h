@@ -0,0 +1,31 @@
+#ifndef JASCALC_HOST_H
+#define JASCALC_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// SSE2 and AVX2 versions of the JASystem::Calc mixing and copy kernels. They take the same arguments as the
+// portable versions in src/JSystem/JAudio/JASCalc.cpp and produce bit-identical output: imixadd multiplies and
+// adds in f32 in the same order and truncates before saturating.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int JASHostHaveAVX2(void);
+
+void JASHostImixcopySSE2(const int16_t* left, const int16_t* right, int16_t* out, int32_t count);
+void JASHostImixaddSSE2(const int16_t* src, int16_t* dst, int32_t count, float volume);
+void JASHostBcopySSE2(const void* src, void* dst, size_t size);
+void JASHostBzeroSSE2(void* dst, size_t size);
+
+void JASHostImixcopyAVX2(const int16_t* left, const int16_t* right, int16_t* out, int32_t count);
+void JASHostImixaddAVX2(const int16_t* src, int16_t* dst, int32_t count, float volume);
+void JASHostBcopyAVX2(const void* src, void* dst, size_t size);
+void JASHostBzeroAVX2(void* dst, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
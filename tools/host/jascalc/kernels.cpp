@@ -0,0 +1,86 @@
+#include "jascalc.h"
+
+#include <emmintrin.h>
+#include <string.h>
+
+// SSE2 is part of x86-64, so these need no detection; tails shorter than a vector use the scalar loop
+
+static inline int16_t JASHostMixSample(int16_t src, int16_t dst, float volume) {
+    float sample;
+    int32_t value;
+
+    sample = (float)src * volume;
+    sample = (float)dst + sample;
+    value = (int32_t)sample;
+    return (int16_t)(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+}
+
+extern "C" {
+int JASHostHaveAVX2(void) { return __builtin_cpu_supports("avx2"); }
+
+void JASHostImixcopySSE2(const int16_t* left, const int16_t* right, int16_t* out, int32_t count) {
+    __m128i l;
+    __m128i r;
+    int32_t i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        l = _mm_loadu_si128((const __m128i*)&left[i]);
+        r = _mm_loadu_si128((const __m128i*)&right[i]);
+        _mm_storeu_si128((__m128i*)&out[i * 2], _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128((__m128i*)&out[i * 2 + 8], _mm_unpackhi_epi16(l, r));
+    }
+    for (; i < count; i++) {
+        out[i * 2 + 0] = left[i];
+        out[i * 2 + 1] = right[i];
+    }
+}
+
+void JASHostImixaddSSE2(const int16_t* src, int16_t* dst, int32_t count, float volume) {
+    const __m128 gain = _mm_set1_ps(volume);
+    __m128i s;
+    __m128i d;
+    __m128 lo;
+    __m128 hi;
+    int32_t i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        s = _mm_loadu_si128((const __m128i*)&src[i]);
+        d = _mm_loadu_si128((const __m128i*)&dst[i]);
+        lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)), gain);
+        hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)), gain);
+        lo = _mm_add_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16)), lo);
+        hi = _mm_add_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16)), hi);
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi)));
+    }
+    for (; i < count; i++) {
+        dst[i] = JASHostMixSample(src[i], dst[i], volume);
+    }
+}
+
+void JASHostBcopySSE2(const void* src, void* dst, size_t size) {
+    const uint8_t* from;
+    uint8_t* to;
+    size_t i;
+
+    from = (const uint8_t*)src;
+    to = (uint8_t*)dst;
+    for (i = 0; i + 32 <= size; i += 32) {
+        _mm_storeu_si128((__m128i*)&to[i], _mm_loadu_si128((const __m128i*)&from[i]));
+        _mm_storeu_si128((__m128i*)&to[i + 16], _mm_loadu_si128((const __m128i*)&from[i + 16]));
+    }
+    memcpy(&to[i], &from[i], size - i);
+}
+
+void JASHostBzeroSSE2(void* dst, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    uint8_t* to;
+    size_t i;
+
+    to = (uint8_t*)dst;
+    for (i = 0; i + 32 <= size; i += 32) {
+        _mm_storeu_si128((__m128i*)&to[i], zero);
+        _mm_storeu_si128((__m128i*)&to[i + 16], zero);
+    }
+    memset(&to[i], 0, size - i);
+}
+}
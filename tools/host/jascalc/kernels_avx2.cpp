@@ -0,0 +1,76 @@
+#include "jascalc.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+// 256-bit versions of the kernels in kernels.cpp. The 16-bit unpacks and packs work within each 128-bit lane, so
+// the results are put back in order with a cross-lane permute.
+
+extern "C" {
+__attribute__((target("avx2"))) void JASHostImixcopyAVX2(const int16_t* left, const int16_t* right, int16_t* out,
+                                                         int32_t count) {
+    __m256i l;
+    __m256i r;
+    __m256i lo;
+    __m256i hi;
+    int32_t i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        l = _mm256_loadu_si256((const __m256i*)&left[i]);
+        r = _mm256_loadu_si256((const __m256i*)&right[i]);
+        lo = _mm256_unpacklo_epi16(l, r);
+        hi = _mm256_unpackhi_epi16(l, r);
+        _mm256_storeu_si256((__m256i*)&out[i * 2], _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)&out[i * 2 + 16], _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    JASHostImixcopySSE2(&left[i], &right[i], &out[i * 2], count - i);
+}
+
+__attribute__((target("avx2"))) void JASHostImixaddAVX2(const int16_t* src, int16_t* dst, int32_t count,
+                                                        float volume) {
+    const __m256 gain = _mm256_set1_ps(volume);
+    __m256 lo;
+    __m256 hi;
+    __m256i packed;
+    int32_t i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        lo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&src[i]))), gain);
+        hi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&src[i + 8]))),
+                           gain);
+        lo = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&dst[i]))), lo);
+        hi = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&dst[i + 8]))),
+                           hi);
+        packed = _mm256_packs_epi32(_mm256_cvttps_epi32(lo), _mm256_cvttps_epi32(hi));
+        _mm256_storeu_si256((__m256i*)&dst[i], _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    JASHostImixaddSSE2(&src[i], &dst[i], count - i, volume);
+}
+
+__attribute__((target("avx2"))) void JASHostBcopyAVX2(const void* src, void* dst, size_t size) {
+    const uint8_t* from;
+    uint8_t* to;
+    size_t i;
+
+    from = (const uint8_t*)src;
+    to = (uint8_t*)dst;
+    for (i = 0; i + 64 <= size; i += 64) {
+        _mm256_storeu_si256((__m256i*)&to[i], _mm256_loadu_si256((const __m256i*)&from[i]));
+        _mm256_storeu_si256((__m256i*)&to[i + 32], _mm256_loadu_si256((const __m256i*)&from[i + 32]));
+    }
+    JASHostBcopySSE2(&from[i], &to[i], size - i);
+}
+
+__attribute__((target("avx2"))) void JASHostBzeroAVX2(void* dst, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint8_t* to;
+    size_t i;
+
+    to = (uint8_t*)dst;
+    for (i = 0; i + 64 <= size; i += 64) {
+        _mm256_storeu_si256((__m256i*)&to[i], zero);
+        _mm256_storeu_si256((__m256i*)&to[i + 32], zero);
+    }
+    JASHostBzeroSSE2(&to[i], size - i);
+}
+}
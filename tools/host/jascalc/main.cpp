@@ -0,0 +1,267 @@
+#include "JSystem/JAudio/JASCalc.h"
+#include "jascalc.h"
+#include "../common/test.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define FRAME_SAMPLES 160 // 5 ms at 32 kHz
+#define FRAME_BYTES (FRAME_SAMPLES * 2 * sizeof(s16))
+#define NUM_VOICES 64
+#define VOICE_SAMPLES 4096 // stereo samples of PCM per voice, played as a loop
+
+// sinfT is documented to stay within this of sin(x * pi/2)
+#define SINFT_ERROR_BOUND 4e-7
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct Kernels {
+    const char* name;
+    void (*imixcopy)(const int16_t* left, const int16_t* right, int16_t* out, int32_t count);
+    void (*imixadd)(const int16_t* src, int16_t* dst, int32_t count, float volume);
+    void (*bcopy)(const void* src, void* dst, size_t size);
+    void (*bzero)(void* dst, size_t size);
+} Kernels;
+
+static void portableImixcopy(const int16_t* left, const int16_t* right, int16_t* out, int32_t count) {
+    JASystem::Calc::imixcopy(left, right, out, count);
+}
+
+static void portableImixadd(const int16_t* src, int16_t* dst, int32_t count, float volume) {
+    JASystem::Calc::imixadd(src, dst, count, volume);
+}
+
+static void portableBcopy(const void* src, void* dst, size_t size) {
+    JASystem::Calc::bcopyfast((const u32*)src, (u32*)dst, size);
+}
+
+static void portableBzero(void* dst, size_t size) { JASystem::Calc::bzerofast(dst, size); }
+
+static const Kernels sKernels[] = {
+    {"portable", portableImixcopy, portableImixadd, portableBcopy, portableBzero},
+    {"sse2", JASHostImixcopySSE2, JASHostImixaddSSE2, JASHostBcopySSE2, JASHostBzeroSSE2},
+    {"avx2", JASHostImixcopyAVX2, JASHostImixaddAVX2, JASHostBcopyAVX2, JASHostBzeroAVX2},
+};
+
+static u32 numKernels(void) {
+    return JASHostHaveAVX2() ? sizeof(sKernels) / sizeof(sKernels[0]) : sizeof(sKernels) / sizeof(sKernels[0]) - 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: jascalc bench [frames]\n"
+                    "       jascalc test\n");
+}
+
+// Every voice is a loud stereo loop: a different tone on each side plus some noise, so the mix saturates now and then
+static void buildVoices(const Kernels* kernels, std::vector<s16>& voices) {
+    std::vector<s16> left;
+    std::vector<s16> right;
+    u32 noise;
+    u32 v;
+    u32 i;
+
+    voices.resize(NUM_VOICES * VOICE_SAMPLES * 2);
+    left.resize(VOICE_SAMPLES);
+    right.resize(VOICE_SAMPLES);
+    noise = 1;
+    for (v = 0; v < NUM_VOICES; v++) {
+        for (i = 0; i < VOICE_SAMPLES; i++) {
+            noise = (noise * 1103515245 + 12345) & 0xFFFFFFFF;
+            left[i] = (s16)(20000.0 * sin(2.0 * M_PI * (v + 1) * i / VOICE_SAMPLES) + (s32)(noise >> 20) - 2048);
+            right[i] = (s16)(20000.0 * cos(2.0 * M_PI * (v + 3) * i / VOICE_SAMPLES) - (s32)(noise >> 21) + 1024);
+        }
+        kernels->imixcopy(left.data(), right.data(), &voices[v * VOICE_SAMPLES * 2], VOICE_SAMPLES);
+    }
+}
+
+typedef struct BenchResult {
+    double usPerFrame;
+    u32 crc;
+} BenchResult;
+
+// One frame is what a sequence-driven mixer does every 5 ms: clear the mix buffer, add each voice in at its own
+// volume and copy the finished frame out to the DMA buffer
+static void benchOnce(const Kernels* kernels, const std::vector<s16>& voices, u32 numFrames, BenchResult* result) {
+    alignas(32) s16 mix[FRAME_SAMPLES * 2];
+    alignas(32) s16 out[FRAME_SAMPLES * 2];
+    Clock::time_point start;
+    u32 position;
+    u32 crc;
+    u32 i;
+    u32 v;
+
+    crc = 0;
+    start = Clock::now();
+    for (i = 0; i < numFrames; i++) {
+        kernels->bzero(mix, FRAME_BYTES);
+        for (v = 0; v < NUM_VOICES; v++) {
+            position = (i * FRAME_SAMPLES + v * 97) % (VOICE_SAMPLES - FRAME_SAMPLES);
+            kernels->imixadd(&voices[(v * VOICE_SAMPLES + position) * 2], mix, FRAME_SAMPLES * 2,
+                             0.05f + 0.03f * (v % 7));
+        }
+        kernels->bcopy(mix, out, FRAME_BYTES);
+        crc ^= crc32((const u8*)out, FRAME_BYTES) + i;
+    }
+    result->usPerFrame = std::chrono::duration<double>(Clock::now() - start).count() * 1e6 / numFrames;
+    result->crc = crc;
+}
+
+static int bench(int argc, char** argv) {
+    std::vector<s16> voices;
+    BenchResult results[3];
+    u32 numFrames;
+    u32 i;
+    bool ok;
+
+    numFrames = argc > 2 ? (u32)atoi(argv[2]) : 20000;
+    if (numFrames == 0) {
+        numFrames = 1;
+    }
+
+    buildVoices(&sKernels[0], voices);
+    printf("%lu frames of %d voices x %d stereo samples, 5 ms budget per frame\n", numFrames, NUM_VOICES,
+           FRAME_SAMPLES);
+    printf("kernels   us/frame  of budget  speedup\n");
+
+    ok = true;
+    for (i = 0; i < numKernels(); i++) {
+        benchOnce(&sKernels[i], voices, numFrames, &results[i]);
+        ok &= results[i].crc == results[0].crc;
+        printf("%-8s  %8.2f  %8.2f%%  %6.2fx\n", sKernels[i].name, results[i].usPerFrame,
+               results[i].usPerFrame / 50.0, results[0].usPerFrame / results[i].usPerFrame);
+    }
+
+    if (!ok) {
+        printf("mixed output differs between the implementations\n");
+        return 1;
+    }
+    printf("all implementations mix identical output\n");
+    return 0;
+}
+
+// Largest error of table(x) against exact(x) over a dense sweep of [0, 1]
+static double sweepError(f32 (*table)(f32), double (*exact)(double)) {
+    double error;
+    double worst;
+    u32 i;
+    f32 x;
+
+    worst = 0.0;
+    for (i = 0; i <= 1000000; i++) {
+        x = (f32)(i / 1000000.0);
+        error = fabs(table(x) - exact(x));
+        worst = error > worst ? error : worst;
+    }
+    return worst;
+}
+
+static double exactSin(double x) { return sin(x * M_PI / 2); }
+
+static double exactDolby2(double x) {
+    double start;
+
+    start = atan(0.4899 / 0.8718);
+    return sin(start + x * (M_PI / 2 - 2 * start));
+}
+
+// The 256-entry table read without interpolation, for comparison
+static f32 nearest256(f32 x) { return (f32)sin((s32)(x * 255.0f + 0.5f) / 255.0 * M_PI / 2); }
+
+// Runs one kernel over every length up to 100 at every 2-byte misalignment and compares it with the portable one
+static bool compareKernels(const Kernels* kernels) {
+    std::vector<s16> a;
+    std::vector<s16> b;
+    std::vector<s16> expected;
+    std::vector<s16> actual;
+    u32 noise;
+    s32 count;
+    u32 offset;
+    u32 i;
+
+    a.resize(256);
+    b.resize(256);
+    noise = 7;
+    for (i = 0; i < 256; i++) {
+        noise = (noise * 1103515245 + 12345) & 0xFFFFFFFF;
+        a[i] = (s16)(noise >> 16);
+        b[i] = (s16)(noise >> 8);
+    }
+
+    for (count = 0; count <= 100; count++) {
+        for (offset = 0; offset < 4; offset++) {
+            expected.assign(512, 0x5555);
+            actual.assign(512, 0x5555);
+            portableImixcopy(&a[offset], &b[offset], &expected[offset], count);
+            kernels->imixcopy(&a[offset], &b[offset], &actual[offset], count);
+            if (expected != actual) {
+                return false;
+            }
+
+            expected.assign(b.begin(), b.end());
+            actual.assign(b.begin(), b.end());
+            portableImixadd(&a[offset], &expected[offset], count, 1.37f);
+            kernels->imixadd(&a[offset], &actual[offset], count, 1.37f);
+            if (expected != actual) {
+                return false;
+            }
+
+            actual.assign(512, 0x5555);
+            kernels->bcopy(&a[offset], &actual[offset], count * sizeof(s16));
+            if (memcmp(&actual[offset], &a[offset], count * sizeof(s16)) != 0 ||
+                actual[offset + count] != 0x5555) {
+                return false;
+            }
+
+            kernels->bzero(&actual[offset], count * sizeof(s16));
+            for (i = 0; i < (u32)count; i++) {
+                if (actual[offset + i] != 0) {
+                    return false;
+                }
+            }
+            if (actual[offset + count] != 0x5555) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int test(int argc, char** argv) {
+    double error;
+    bool same;
+    bool ok;
+    u32 i;
+
+    ok = true;
+    JASystem::Calc::initSinfT();
+
+    error = sweepError(JASystem::Calc::sinfT, exactSin);
+    printf("sinfT max error %.3g (bound %.0g)\n", error, SINFT_ERROR_BOUND);
+    ok &= error <= SINFT_ERROR_BOUND;
+    error = sweepError(JASystem::Calc::sinfDolby2, exactDolby2);
+    printf("sinfDolby2 max error %.3g (bound %.0g)\n", error, SINFT_ERROR_BOUND);
+    ok &= error <= SINFT_ERROR_BOUND;
+    printf("256-entry nearest lookup max error %.3g\n", sweepError(nearest256, exactSin));
+    ok &= JASystem::Calc::sinfT(-1.0f) == 0.0f && JASystem::Calc::sinfT(2.0f) == 1.0f;
+
+    for (i = 1; i < numKernels(); i++) {
+        same = compareKernels(&sKernels[i]);
+        printf("%s kernels %s the portable ones\n", sKernels[i].name, same ? "match" : "DIFFER from");
+        ok &= same;
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"bench", bench},
+    {"test", test},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
@@ -0,0 +1,37 @@
+// The archive side of the test and bench in main.cpp: a JKRArchive over tables main.cpp builds, so the real find
+// functions in JKRArchivePri.cpp run, with and without the index. The JKernel stubs are in stubs.cpp.
+
+#include "JSystem/JKernel/JKRArchive.h"
+
+class SimArchive : public JKRArchive {
+  public:
+    SimArchive(SArcDataInfo* info, SDIDirEntry* nodes, SDIFileEntry* files, char* strings)
+        : JKRArchive(0, MOUNT_MEM) {
+        mArcInfoBlock = info;
+        mNodes = nodes;
+        mFiles = files;
+        mStringTable = strings;
+        mExpandedSize = NULL;
+        mMountDirection = MOUNT_DIRECTION_HEAD;
+        mIsMounted = true;
+    }
+
+    virtual ~SimArchive() {}
+
+    virtual void* fetchResource(SDIFileEntry*, u32*) { return NULL; }
+    virtual void* fetchResource(void*, u32, SDIFileEntry*, u32*) { return NULL; }
+};
+
+// The archive, with an index if indexed
+JKRArchive* simMountArchive(SArcDataInfo* info, JKRArchive::SDIDirEntry* nodes, JKRArchive::SDIFileEntry* files,
+                            char* strings, bool indexed) {
+    JKRArchive* archive;
+
+    archive = new SimArchive(info, nodes, files, strings);
+    if (indexed) {
+        archive->createIndex();
+    }
+    return archive;
+}
+
+void simUnmountArchive(JKRArchive* archive) { delete (SimArchive*)archive; }
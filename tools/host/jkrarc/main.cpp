@@ -0,0 +1,462 @@
+// Host test and benchmark of JKRArchive's find functions (src/JSystem/JKernel/JKRArchivePri.cpp) with the JKRArcIndex
+// tables against the linear searches they fall back to without them. The archive is a synthetic RARC table set
+// (directories, file entries with CArcName hashes, a string table) of a few thousand files, mounted through
+// jkrarc/archive.cpp; the lookups are paths from the root, bare names as findNameResource takes them and type + name
+// as getResource(u32, const char*) takes them, with some misses. The test checks both against a plain model of the
+// RARC lookups here, and that several archives mounted at once each find their own index.
+
+#include "../common/test.h"
+#include "JSystem/JKernel/JKRArcIndex.h"
+
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+JKRArchive* simMountArchive(SArcDataInfo* info, JKRArchive::SDIDirEntry* nodes, JKRArchive::SDIFileEntry* files,
+                            char* strings, bool indexed);
+void simUnmountArchive(JKRArchive* archive);
+u32 simNumLiveBlocks(void);
+
+typedef struct Archive {
+    SArcDataInfo info;
+    std::vector<JKRArchive::SDIDirEntry> nodes;
+    std::vector<JKRArchive::SDIFileEntry> files;
+    std::string strings;
+} Archive;
+
+typedef struct Query {
+    std::string path; // from the root
+    std::string name; // last path component
+    u32 type;
+} Query;
+
+static const char* sTypes[] = {"timg", "bmd", "bck", "btk", "brk", "bpk", "bva", "blo", "bmg", "scr", "col", "dat"};
+
+// JKRArchive::CArcName
+static u16 hashName(const char* name, char* lower, char endChar) {
+    u16 hash;
+    u32 length;
+
+    hash = 0;
+    for (length = 0; name[length] != '\0' && name[length] != endChar; length++) {
+        lower[length] = tolower(name[length]);
+        hash = lower[length] + hash * 3;
+    }
+    lower[length] = '\0';
+    return hash;
+}
+
+static u32 addString(Archive* archive, const char* string) {
+    u32 offset;
+
+    offset = archive->strings.size();
+    archive->strings.append(string);
+    archive->strings.push_back('\0');
+    return offset;
+}
+
+// The first four characters in upper case, space padded
+static u32 makeType(const char* name) {
+    u32 type;
+    u32 length;
+    u32 i;
+
+    type = 0;
+    length = strlen(name);
+    for (i = 0; i < 4; i++) {
+        type = type << 8 | (i < length ? toupper(name[i]) : ' ');
+    }
+    return type;
+}
+
+static void addEntry(Archive* archive, const char* name, u32 flags, u32 dataOffset) {
+    JKRArchive::SDIFileEntry entry;
+    char lower[256];
+
+    memset(&entry, 0, sizeof(entry));
+    entry.file_id = flags & 0x02 ? 0xFFFF : archive->files.size();
+    entry.name_hash = hashName(name, lower, '\0');
+    entry.type_flags_and_name_offset = flags << 24 | addString(archive, name);
+    entry.data_offset = dataOffset;
+    archive->files.push_back(entry);
+}
+
+// A root holding numDirs directories of filesPerDir files each, laid out the way RARC does it: a directory's entries
+// are contiguous, subdirectories and "." and ".." included. Directory types repeat, as they do in real archives, and
+// names are lower case since CArcName lowers the name looked up.
+static void makeArchive(Archive* archive, std::vector<Query>& queries, u32 numDirs, u32 filesPerDir) {
+    JKRArchive::SDIDirEntry node;
+    Query query;
+    char name[64];
+    u32 d;
+    u32 f;
+
+    seedRandom32(1);
+    archive->nodes.clear();
+    archive->files.clear();
+    archive->strings.clear();
+    queries.clear();
+
+    // the root's entries first, then each directory's
+    memset(&node, 0, sizeof(node));
+    node.type = makeType("root");
+    node.name_offset = addString(archive, "archive");
+    node.num_entries = numDirs + 2;
+    archive->nodes.push_back(node);
+    for (d = 0; d < numDirs; d++) {
+        sprintf(name, "%s%u", sTypes[d % (sizeof(sTypes) / sizeof(sTypes[0]))], (unsigned)d);
+        addEntry(archive, name, 0x02, d + 1);
+
+        node.type = makeType(name);
+        node.name_offset = archive->files.back().getNameOffset();
+        node.field_0x8 = archive->files.back().getNameHash();
+        node.num_entries = filesPerDir + 2;
+        archive->nodes.push_back(node);
+    }
+    addEntry(archive, ".", 0x02, 0);
+    addEntry(archive, "..", 0x02, 0xFFFFFFFF);
+
+    for (d = 0; d < numDirs; d++) {
+        archive->nodes[d + 1].first_file_index = archive->files.size();
+        for (f = 0; f < filesPerDir; f++) {
+            sprintf(name, "%s_%04u.%s", f % 3 == 0 ? "obj" : f % 3 == 1 ? "map" : "eff", (unsigned)(f * 7 + d),
+                    sTypes[d % (sizeof(sTypes) / sizeof(sTypes[0]))]);
+            addEntry(archive, name, 0x01, f * 0x20);
+        }
+        addEntry(archive, ".", 0x02, d + 1);
+        addEntry(archive, "..", 0x02, 0);
+    }
+
+    memset(&archive->info, 0, sizeof(archive->info));
+    archive->info.num_nodes = archive->nodes.size();
+    archive->info.num_file_entries = archive->files.size();
+    archive->info.string_table_length = archive->strings.size();
+
+    // every file once plus a miss in each directory, in random order
+    for (d = 0; d < numDirs; d++) {
+        const JKRArchive::SDIFileEntry& dir = archive->files[d];
+        const JKRArchive::SDIFileEntry* files = archive->files.data() + archive->nodes[d + 1].first_file_index;
+        for (f = 0; f <= filesPerDir; f++) {
+            query.name = f < filesPerDir ? archive->strings.c_str() + files[f].getNameOffset() : "missing.bin";
+            query.path = std::string(archive->strings.c_str() + dir.getNameOffset()) + "/" + query.name;
+            query.type = archive->nodes[d + 1].type;
+            queries.push_back(query);
+        }
+    }
+    for (f = queries.size(); f > 1; f--) {
+        std::swap(queries[f - 1], queries[random32() % f]);
+    }
+}
+
+static bool isSameName(const Archive* archive, u32 file, const char* name, u16 hash) {
+    return archive->files[file].getNameHash() == hash &&
+           strcmp(archive->strings.c_str() + archive->files[file].getNameOffset(), name) == 0;
+}
+
+// JKRArchive::findFsResource
+static u32 findPath(const Archive* archive, const char* path) {
+    char lower[256];
+    const char* next;
+    u32 directory;
+    u32 file;
+    u32 end;
+    u16 hash;
+
+    directory = 0;
+    while (true) {
+        hash = hashName(path, lower, '/');
+        next = strchr(path, '/');
+        file = archive->nodes[directory].first_file_index;
+        end = file + archive->nodes[directory].num_entries;
+        for (; file < end && !isSameName(archive, file, lower, hash); file++) {
+        }
+        if (file == end) {
+            return JKR_ARC_INDEX_NONE;
+        }
+        if (!archive->files[file].isDirectory()) {
+            return next == NULL ? file : JKR_ARC_INDEX_NONE;
+        }
+        if (next == NULL) {
+            return JKR_ARC_INDEX_NONE;
+        }
+        directory = archive->files[file].data_offset;
+        path = next + 1;
+    }
+}
+
+// JKRArchive::findNameResource
+static u32 findName(const Archive* archive, const char* name) {
+    char lower[256];
+    u32 file;
+    u16 hash;
+
+    hash = hashName(name, lower, '\0');
+    for (file = 0; file < archive->files.size(); file++) {
+        if (isSameName(archive, file, lower, hash)) {
+            return file;
+        }
+    }
+    return JKR_ARC_INDEX_NONE;
+}
+
+// JKRArchive::findTypeResource: the first directory of the type, then the name in it
+static u32 findTypeName(const Archive* archive, u32 type, const char* name) {
+    char lower[256];
+    u32 directory;
+    u32 file;
+    u32 end;
+    u16 hash;
+
+    hash = hashName(name, lower, '\0');
+    for (directory = 0; directory < archive->nodes.size() && archive->nodes[directory].type != type; directory++) {
+    }
+    if (type == 0 || directory == archive->nodes.size()) {
+        return JKR_ARC_INDEX_NONE;
+    }
+    file = archive->nodes[directory].first_file_index;
+    end = file + archive->nodes[directory].num_entries;
+    for (; file < end; file++) {
+        if (isSameName(archive, file, lower, hash)) {
+            return file;
+        }
+    }
+    return JKR_ARC_INDEX_NONE;
+}
+
+static u32 lookup(const Archive* archive, const Query& query, u32 kind) {
+    switch (kind) {
+    case 0:
+        return findPath(archive, query.path.c_str());
+    case 1:
+        return findName(archive, query.name.c_str());
+    default:
+        return findTypeName(archive, query.type, query.name.c_str());
+    }
+}
+
+// The same through the real find functions
+static u32 lookup(JKRArchive* arc, const Query& query, u32 kind) {
+    JKRArchive::SDIFileEntry* entry;
+
+    switch (kind) {
+    case 0:
+        entry = arc->findFsResource(query.path.c_str(), 0);
+        break;
+    case 1:
+        entry = arc->findNameResource(query.name.c_str());
+        break;
+    default:
+        entry = arc->findTypeResource(query.type, query.name.c_str());
+        break;
+    }
+    return entry != NULL ? entry - arc->mFiles : JKR_ARC_INDEX_NONE;
+}
+
+static JKRArchive* mount(Archive* archive, bool indexed) {
+    return simMountArchive(&archive->info, archive->nodes.data(), archive->files.data(), &archive->strings[0],
+                           indexed);
+}
+
+static const char* sKindNames[] = {"path", "name", "type+name"};
+
+// Every lookup kind on a few archive shapes gives the model's entry with and without the index, and every directory
+// of the root is found by findDirectory
+static bool testShapes(void) {
+    static const u32 shapes[][2] = {{1, 1}, {1, 3000}, {12, 10}, {40, 100}, {300, 3}};
+    std::vector<Query> queries;
+    JKRArchive* plain;
+    JKRArchive* indexed;
+    Archive archive;
+    u32 expected;
+    u32 shape;
+    u32 kind;
+    u32 i;
+    bool ok;
+
+    ok = true;
+    for (shape = 0; shape < sizeof(shapes) / sizeof(shapes[0]); shape++) {
+        makeArchive(&archive, queries, shapes[shape][0], shapes[shape][1]);
+        plain = mount(&archive, false);
+        indexed = mount(&archive, true);
+        if (plain->getIndex() != NULL || indexed->getIndex() == NULL) {
+            printf("%u x %u: index %s\n", shapes[shape][0], shapes[shape][1],
+                   plain->getIndex() != NULL ? "on the plain archive" : "missing");
+            ok = false;
+        }
+
+        // some paths that only the walk itself can get wrong
+        queries.push_back(Query());
+        queries.back().path = "nowhere/file.bin";
+        queries.push_back(Query());
+        queries.back().path = std::string(archive.strings.c_str() + archive.files[0].getNameOffset()) + "/../" +
+                              queries[0].name;
+        queries.push_back(Query());
+        queries.back().path = std::string(archive.strings.c_str() + archive.files[0].getNameOffset());
+        queries.back().type = makeType("none");
+
+        for (kind = 0; kind < 3; kind++) {
+            for (i = 0; i < queries.size(); i++) {
+                expected = lookup(&archive, queries[i], kind);
+                if (lookup(plain, queries[i], kind) != expected || lookup(indexed, queries[i], kind) != expected) {
+                    printf("%u x %u, %s %s: FAILED\n", shapes[shape][0], shapes[shape][1], sKindNames[kind],
+                           queries[i].path.c_str());
+                    ok = false;
+                    break;
+                }
+            }
+        }
+
+        for (i = 0; i < shapes[shape][0]; i++) {
+            const char* name = archive.strings.c_str() + archive.files[i].getNameOffset();
+            if (plain->findDirectory(name, 0) != plain->mNodes + i + 1 ||
+                indexed->findDirectory(name, 0) != indexed->mNodes + i + 1) {
+                printf("%u x %u, directory %s: FAILED\n", shapes[shape][0], shapes[shape][1], name);
+                ok = false;
+                break;
+            }
+        }
+
+        simUnmountArchive(indexed);
+        simUnmountArchive(plain);
+    }
+
+    printf("%u archive shapes x 3 lookups and findDirectory, with and without the index: %s\n",
+           (unsigned)(sizeof(shapes) / sizeof(shapes[0])), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Archives mounted and unmounted in a shuffled order: each one has its own index, finds everything through it, and
+// unmounting frees every index
+static bool testMounts(void) {
+    std::vector<JKRArchive*> mounted;
+    std::vector<Query> queries;
+    JKRArchive* arc;
+    Archive archive;
+    u32 maxMounted;
+    u32 round;
+    u32 i;
+    u32 k;
+    bool ok;
+
+    makeArchive(&archive, queries, 4, 8);
+    ok = true;
+    maxMounted = 0;
+    for (round = 0; round < 200; round++) {
+        if (mounted.size() < 40 && (mounted.size() < 8 || random32() % 3 != 0)) {
+            mounted.push_back(mount(&archive, true));
+        } else {
+            k = random32() % mounted.size();
+            simUnmountArchive(mounted[k]);
+            mounted.erase(mounted.begin() + k);
+        }
+
+        for (i = 0; i < mounted.size(); i++) {
+            arc = mounted[i];
+            if (arc->getIndex() == NULL) {
+                printf("round %u: archive %u has no index\n", round, i);
+                ok = false;
+            }
+            k = random32() % queries.size();
+            if (lookup(arc, queries[k], 0) != lookup(&archive, queries[k], 0)) {
+                printf("round %u: archive %u, %s: FAILED\n", round, i, queries[k].path.c_str());
+                ok = false;
+            }
+        }
+        maxMounted = mounted.size() > maxMounted ? mounted.size() : maxMounted;
+        // every archive holds its index's heap block, and nothing else is allocated
+        ok &= simNumLiveBlocks() == mounted.size();
+    }
+
+    for (i = 0; i < mounted.size(); i++) {
+        simUnmountArchive(mounted[i]);
+    }
+    ok &= simNumLiveBlocks() == 0;
+    printf("200 mounts and unmounts, up to %u mounted at once: %s\n", maxMounted, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static int test(int, char**) {
+    bool ok;
+
+    ok = testShapes();
+    ok &= testMounts();
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static f64 nsPerLookup(JKRArchive* arc, const std::vector<Query>& queries, u32 kind, u32* found) {
+    Clock::time_point start;
+    u32 rounds;
+    u32 round;
+    u32 i;
+
+    // about the same number of lookups either way, so the linear search doesn't take minutes
+    rounds = arc->getIndex() != NULL ? 200 : 2;
+    *found = 0;
+    start = Clock::now();
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < queries.size(); i++) {
+            *found += lookup(arc, queries[i], kind) != JKR_ARC_INDEX_NONE ? 1 : 0;
+        }
+    }
+    *found /= rounds;
+    return std::chrono::duration<f64>(Clock::now() - start).count() * 1e9 / ((f64)rounds * queries.size());
+}
+
+static int bench(int, char**) {
+    static const u32 shapes[][2] = {{16, 64}, {64, 64}, {8, 1000}, {2, 6000}};
+    std::vector<Query> queries;
+    JKRArchive* plain;
+    JKRArchive* index;
+    Archive archive;
+    Clock::time_point start;
+    f64 buildUs;
+    f64 linear;
+    f64 indexed;
+    u32 linearFound;
+    u32 indexedFound;
+    u32 shape;
+    u32 kind;
+    bool ok;
+
+    ok = true;
+    printf("%-12s %7s %9s %-10s %7s %9s %10s %10s %8s\n", "archive", "files", "index", "lookup", "found", "build us",
+           "linear ns", "index ns", "speedup");
+    for (shape = 0; shape < sizeof(shapes) / sizeof(shapes[0]); shape++) {
+        makeArchive(&archive, queries, shapes[shape][0], shapes[shape][1]);
+        plain = mount(&archive, false);
+        start = Clock::now();
+        index = mount(&archive, true);
+        buildUs = std::chrono::duration<f64>(Clock::now() - start).count() * 1e6;
+
+        for (kind = 0; kind < 3; kind++) {
+            linear = nsPerLookup(plain, queries, kind, &linearFound);
+            indexed = nsPerLookup(index, queries, kind, &indexedFound);
+            ok &= linearFound == indexedFound;
+            printf("%4u x %-5u %7u %9u %-10s %7u %9.1f %10.1f %10.1f %7.1fx\n", shapes[shape][0], shapes[shape][1],
+                   (unsigned)archive.files.size(), (unsigned)JKRArcIndex::getWorkSize(&archive.info),
+                   sKindNames[kind], (unsigned)indexedFound, buildUs, linear, indexed, linear / indexed);
+        }
+        simUnmountArchive(index);
+        simUnmountArchive(plain);
+    }
+
+    printf("%s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+static void usage(void) { fprintf(stderr, "usage: jkrarc test|bench\n"); }
+
+static const HostCommand sCommands[] = {
+    {"test", test},
+    {"bench", bench},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
@@ -0,0 +1,63 @@
+// The JKernel stubs JKRArchive needs on the host, for jkrarc and rarcmap: heap allocations go to malloc and are
+// counted, so leaked blocks show up. JKRArchivePub.cpp isn't built, it would drag in every archive type through
+// mount, so the JKRArchive virtuals it defines are stubs here; nothing calls them. This lives apart from the tools'
+// main.cpp because the JKernel operator new and delete declarations clash with the host C++ library headers.
+
+#include "JSystem/JKernel/JKRArchive.h"
+#include "JSystem/JKernel/JKRHeap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static u32 sHeapStorage[(sizeof(JKRHeap) + 3) / 4];
+JKRHeap* JKRHeap::sCurrentHeap = (JKRHeap*)sHeapStorage;
+JKRFileLoader* JKRFileLoader::sCurrentVolume;
+
+static u32 sNumLiveBlocks;
+
+JKRHeap* JKRHeap::findFromRoot(void* ptr) { return NULL; }
+
+s32 JKRHeap::getFreeSize() { return 0x7FFFFFFF; }
+
+void* JKRHeap::alloc(u32 size, int alignment, JKRHeap* heap) {
+    sNumLiveBlocks++;
+    return malloc(size);
+}
+
+void JKRHeap::free(void* ptr, JKRHeap* heap) {
+    sNumLiveBlocks--;
+    ::free(ptr);
+}
+
+JSUPtrLink::JSUPtrLink(void* object) { memset(this, 0, sizeof(JSUPtrLink)); }
+
+JSUPtrLink::~JSUPtrLink() {}
+
+JKRDisposer::JKRDisposer() : mHeap(NULL), mLink(this) {}
+
+JKRDisposer::~JKRDisposer() {}
+
+JKRFileLoader::JKRFileLoader() : mFileLoaderLink(this) {
+    mVolumeName = NULL;
+    mVolumeType = 0;
+    mIsMounted = false;
+    mMountCount = 0;
+}
+
+JKRFileLoader::~JKRFileLoader() {}
+
+void JKRFileLoader::unmount(void) {}
+
+bool JKRArchive::becomeCurrent(const char*) { return false; }
+void* JKRArchive::getResource(const char*) { return NULL; }
+void* JKRArchive::getResource(u32, const char*) { return NULL; }
+u32 JKRArchive::readResource(void*, u32, const char*) { return 0; }
+u32 JKRArchive::readResource(void*, u32, u32, const char*) { return 0; }
+void JKRArchive::removeResourceAll(void) {}
+bool JKRArchive::removeResource(void*) { return false; }
+bool JKRArchive::detachResource(void*) { return false; }
+u32 JKRArchive::getResSize(const void*) const { return 0; }
+u32 JKRArchive::countFile(const char*) const { return 0; }
+JKRFileFinder* JKRArchive::getFirstFile(const char*) const { return NULL; }
+
+u32 simNumLiveBlocks(void) { return sNumLiveBlocks; }
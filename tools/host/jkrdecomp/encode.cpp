@@ -0,0 +1,154 @@
+#include "jkrdecomp.h"
+
+#include <string.h>
+
+#define WINDOW_SIZE 0x1000
+#define MIN_MATCH 3
+#define MAX_MATCH JKR_SZ_MAX_MATCH
+#define HASH_BITS 15
+#define MAX_CHAIN 64
+
+typedef struct Token {
+    u32 distance; // 0 for a literal
+    u32 count;
+    u8 value;
+} Token;
+
+static u32 hash3(const u8* data) {
+    return (((data[0] << 16 | data[1] << 8 | data[2]) * 2654435761u) & 0xFFFFFFFF) >> (32 - HASH_BITS);
+}
+
+static void put32(std::vector<u8>& out, u32 offset, u32 value) {
+    out[offset + 0] = (u8)(value >> 24);
+    out[offset + 1] = (u8)(value >> 16);
+    out[offset + 2] = (u8)(value >> 8);
+    out[offset + 3] = (u8)value;
+}
+
+// Longest match within the window at each position, taken greedily. Matches may run into themselves, which is how
+// runs of a byte or a short pattern come out.
+static void findTokens(const u8* data, u32 size, std::vector<Token>& tokens) {
+    std::vector<s32> head(1 << HASH_BITS, -1);
+    std::vector<s32> prev(size, -1);
+    Token token;
+    u32 pos;
+    u32 limit;
+    u32 len;
+    u32 h;
+    u32 i;
+    s32 candidate;
+    s32 chain;
+
+    tokens.clear();
+    pos = 0;
+    while (pos < size) {
+        token.distance = 0;
+        token.count = 1;
+        token.value = data[pos];
+
+        if (pos + MIN_MATCH <= size) {
+            limit = size - pos < MAX_MATCH ? size - pos : MAX_MATCH;
+            candidate = head[hash3(data + pos)];
+            for (chain = 0; candidate >= 0 && pos - candidate <= WINDOW_SIZE && chain < MAX_CHAIN; chain++) {
+                for (len = 0; len < limit && data[candidate + len] == data[pos + len]; len++) {
+                }
+                if (len >= MIN_MATCH && len > token.count) {
+                    token.distance = pos - candidate;
+                    token.count = len;
+                    if (len == limit) {
+                        break;
+                    }
+                }
+                candidate = prev[candidate];
+            }
+        }
+
+        tokens.push_back(token);
+        for (i = 0; i < token.count; i++, pos++) {
+            if (pos + MIN_MATCH <= size) {
+                h = hash3(data + pos);
+                prev[pos] = head[h];
+                head[h] = pos;
+            }
+        }
+    }
+}
+
+void JKRHostEncodeSZS(const u8* data, u32 size, std::vector<u8>& out) {
+    std::vector<Token> tokens;
+    u32 flagsPos;
+    u32 distance;
+    u32 i;
+
+    findTokens(data, size, tokens);
+    out.assign(JKR_SZS_HEADER_SIZE, 0);
+    memcpy(out.data(), "Yaz0", 4);
+    put32(out, 4, size);
+
+    flagsPos = 0;
+    for (i = 0; i < tokens.size(); i++) {
+        if (i % 8 == 0) {
+            flagsPos = out.size();
+            out.push_back(0);
+        }
+
+        if (tokens[i].distance == 0) {
+            out[flagsPos] |= 0x80 >> (i % 8);
+            out.push_back(tokens[i].value);
+            continue;
+        }
+
+        distance = tokens[i].distance - 1;
+        if (tokens[i].count < 0x12) {
+            out.push_back((u8)(((tokens[i].count - 2) << 4) | (distance >> 8)));
+            out.push_back((u8)distance);
+        } else {
+            out.push_back((u8)(distance >> 8));
+            out.push_back((u8)distance);
+            out.push_back((u8)(tokens[i].count - 0x12));
+        }
+    }
+}
+
+void JKRHostEncodeSZP(const u8* data, u32 size, std::vector<u8>& out) {
+    std::vector<Token> tokens;
+    std::vector<u8> flags;
+    std::vector<u8> links;
+    std::vector<u8> chunks;
+    u32 distance;
+    u32 word;
+    u32 i;
+
+    findTokens(data, size, tokens);
+    for (i = 0; i < tokens.size(); i++) {
+        if (i % 32 == 0) {
+            flags.insert(flags.end(), 4, 0);
+        }
+
+        if (tokens[i].distance == 0) {
+            word = flags.size() - 4;
+            flags[word + (i % 32) / 8] |= 0x80 >> (i % 8);
+            chunks.push_back(tokens[i].value);
+            continue;
+        }
+
+        distance = tokens[i].distance - 1;
+        if (tokens[i].count < 0x12) {
+            links.push_back((u8)(((tokens[i].count - 2) << 4) | (distance >> 8)));
+            links.push_back((u8)distance);
+        } else {
+            links.push_back((u8)(distance >> 8));
+            links.push_back((u8)distance);
+            chunks.push_back((u8)(tokens[i].count - 0x12));
+        }
+    }
+
+    out.assign(JKR_SZP_HEADER_SIZE, 0);
+    memcpy(out.data(), "Yay0", 4);
+    put32(out, 4, size);
+    put32(out, 8, JKR_SZP_HEADER_SIZE + flags.size());
+    put32(out, 12, JKR_SZP_HEADER_SIZE + flags.size() + links.size());
+    out.insert(out.end(), flags.begin(), flags.end());
+    out.insert(out.end(), links.begin(), links.end());
+    out.insert(out.end(), chunks.begin(), chunks.end());
+}
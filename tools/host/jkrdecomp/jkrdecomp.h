@@ -0,0 +1,16 @@
+#ifndef JKRDECOMP_HOST_H
+#define JKRDECOMP_HOST_H
+
+#include "JSystem/JKernel/JKRDecode.h"
+
+#include <vector>
+
+// Greedy hash-chain Yaz0 and Yay0 encoders, enough to make test files with every kind of token
+void JKRHostEncodeSZS(const u8* data, u32 size, std::vector<u8>& out);
+void JKRHostEncodeSZP(const u8* data, u32 size, std::vector<u8>& out);
+
+// The original byte-at-a-time decoders, kept to check the fast ones against
+void JKRHostDecodeSZSRef(u8* src, u8* dst, u32 size, u32 offset);
+void JKRHostDecodeSZPRef(u8* src, u8* dst, u32 size, u32 offset);
+
+#endif
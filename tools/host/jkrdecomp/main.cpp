@@ -0,0 +1,347 @@
+// Host harness for the Yaz0/Yay0 decoders in src/JSystem/JKernel/JKRDecode.cpp. It checks them byte for byte
+// against the original loops and the input they were encoded from, and times both over a corpus.
+
+#include "jkrdecomp.h"
+#include "../common/file.h"
+#include "../common/test.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define GUARD_SIZE 64
+#define WINDOW_GUARD_SIZE 0x1000
+#define GUARD_BYTE 0xA5
+#define BENCH_SECONDS 0.25
+
+typedef std::chrono::steady_clock Clock;
+typedef void (*DecodeFunc)(u8*, u8*, u32, u32);
+
+typedef struct Sample {
+    std::string name;
+    std::vector<u8> data;
+} Sample;
+
+typedef struct Format {
+    const char* name;
+    void (*encode)(const u8*, u32, std::vector<u8>&);
+    DecodeFunc reference;
+    DecodeFunc fast;
+} Format;
+
+static const Format sFormats[] = {
+    {"SZS", JKRHostEncodeSZS, JKRHostDecodeSZSRef, JKRDecodeSZS},
+    {"SZP", JKRHostEncodeSZP, JKRHostDecodeSZPRef, JKRDecodeSZP},
+};
+
+static u32 read32(const u8* data) {
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | data[3];
+}
+
+static const Format* formatOf(const std::vector<u8>& file) {
+    if (file.size() < 0x10 || file[0] != 'Y' || file[1] != 'a' || file[3] != '0') {
+        return NULL;
+    }
+    return file[2] == 'z' ? &sFormats[0] : file[2] == 'y' ? &sFormats[1] : NULL;
+}
+
+// Text, archive-like records, incompressible noise, long runs of a byte and short repeating patterns, so every
+// token kind and every copy distance under a word shows up
+static void makeCorpus(std::vector<Sample>& corpus) {
+    static const char* words[] = {"the",    "mario",  "party", "board", "star",  "coin", "minigame", "player",
+                                  "bowser", "dice",   "block", "space", "turn",  "item", "shop",     "boo",
+                                  "luigi",  "peach",  "yoshi", "wario", "daisy", "toad", "bonus",    "event"};
+    Sample sample;
+    u32 i;
+    u32 j;
+    u32 value;
+
+    seedRandom32(1);
+    corpus.clear();
+
+    sample.name = "text";
+    sample.data.clear();
+    while (sample.data.size() < 0x100000) {
+        for (i = 0; i < 12; i++) {
+            value = random32() % (sizeof(words) / sizeof(words[0]));
+            sample.data.insert(sample.data.end(), words[value], words[value] + strlen(words[value]));
+            sample.data.push_back(i == 11 ? '\n' : ' ');
+        }
+    }
+    corpus.push_back(sample);
+
+    // 32-byte records: an index, a small float-ish position and flags that mostly repeat
+    sample.name = "records";
+    sample.data.clear();
+    for (i = 0; sample.data.size() < 0x100000; i++) {
+        value = i;
+        for (j = 0; j < 4; j++) {
+            sample.data.push_back((u8)(value >> (24 - j * 8)));
+        }
+        for (j = 0; j < 6; j++) {
+            value = 0x42000000 | ((i * 37 + j * 1000) & 0xFFFF) << 4;
+            sample.data.push_back((u8)(value >> 24));
+            sample.data.push_back((u8)(value >> 16));
+            sample.data.push_back((u8)(value >> 8));
+            sample.data.push_back((u8)value);
+        }
+        for (j = 0; j < 4; j++) {
+            sample.data.push_back(random32() % 8 == 0 ? (u8)random32() : 0);
+        }
+    }
+    corpus.push_back(sample);
+
+    sample.name = "random";
+    sample.data.clear();
+    for (i = 0; i < 0x40000; i++) {
+        sample.data.push_back((u8)random32());
+    }
+    corpus.push_back(sample);
+
+    sample.name = "runs";
+    sample.data.clear();
+    while (sample.data.size() < 0x100000) {
+        sample.data.insert(sample.data.end(), 1 + random32() % 2000, (u8)random32());
+    }
+    corpus.push_back(sample);
+
+    // periods 2 to 7 with the odd changed byte
+    sample.name = "patterns";
+    sample.data.clear();
+    while (sample.data.size() < 0x100000) {
+        value = 2 + random32() % 6;
+        j = 20 + random32() % 600;
+        for (i = 0; i < j; i++) {
+            sample.data.push_back((u8)(i % value * 17));
+        }
+        sample.data.push_back((u8)random32());
+    }
+    corpus.push_back(sample);
+
+    sample.name = "tiny";
+    sample.data.assign(5, 'x');
+    corpus.push_back(sample);
+}
+
+// Decodes size bytes after skipping offset with decode into a buffer with guards around it. A skipped start makes
+// back-references reach before the buffer, so the front guard is a whole window. Returns false if anything past
+// the end was written.
+static bool decodeGuarded(DecodeFunc decode, std::vector<u8>& file, u32 size, u32 offset, std::vector<u8>& out) {
+    u32 i;
+
+    out.assign(WINDOW_GUARD_SIZE + size + GUARD_SIZE, GUARD_BYTE);
+    decode(file.data(), out.data() + WINDOW_GUARD_SIZE, size, offset);
+    for (i = WINDOW_GUARD_SIZE + size; i < out.size(); i++) {
+        if (out[i] != GUARD_BYTE) {
+            return false;
+        }
+    }
+    out.erase(out.begin(), out.begin() + WINDOW_GUARD_SIZE);
+    out.resize(size);
+    return true;
+}
+
+// Whole file, leading parts, and skipped starts (where only agreeing with the original loop counts)
+static bool checkFile(const Format* format, std::vector<u8>& file, const std::vector<u8>* original) {
+    static const u32 prefixes[] = {1, 2, 3, 7, 8, 9, 100, 0x1000, 0x1234};
+    std::vector<u8> expected;
+    std::vector<u8> actual;
+    u32 expandSize;
+    u32 size;
+    u32 offset;
+    u32 i;
+    bool ok;
+
+    expandSize = read32(file.data() + 4);
+    ok = decodeGuarded(format->reference, file, expandSize, 0, expected) &&
+         decodeGuarded(format->fast, file, expandSize, 0, actual) && actual == expected;
+    if (original != NULL) {
+        ok &= expected == *original;
+    }
+
+    for (i = 0; ok && i < sizeof(prefixes) / sizeof(prefixes[0]) + 4; i++) {
+        size = i < sizeof(prefixes) / sizeof(prefixes[0]) ? prefixes[i] : 1 + random32() % expandSize;
+        if (size > expandSize) {
+            continue;
+        }
+        ok &= decodeGuarded(format->fast, file, size, 0, actual) &&
+              memcmp(actual.data(), expected.data(), size) == 0;
+    }
+
+    for (i = 0; ok && i < 6; i++) {
+        offset = i < 2 ? i : random32() % expandSize;
+        size = 1 + random32() % (expandSize - offset);
+        ok &= decodeGuarded(format->reference, file, size, offset, expected) &&
+              decodeGuarded(format->fast, file, size, offset, actual) && actual == expected;
+    }
+    return ok;
+}
+
+static int test(int argc, char** argv) {
+    std::vector<Sample> corpus;
+    std::vector<u8> file;
+    const Format* format;
+    u32 i;
+    u32 f;
+    s32 arg;
+    bool ok;
+    bool passed;
+
+    makeCorpus(corpus);
+    ok = true;
+    for (arg = 2; arg < argc; arg++) {
+        if (!readFile(argv[arg], file)) {
+            fprintf(stderr, "can't read %s\n", argv[arg]);
+            return 1;
+        }
+
+        // compressed files are checked against the original loop, anything else joins the corpus
+        format = formatOf(file);
+        if (format == NULL) {
+            corpus.push_back(Sample());
+            corpus.back().name = argv[arg];
+            corpus.back().data = file;
+            continue;
+        }
+        passed = checkFile(format, file, NULL);
+        printf("%-10s %s %8lu bytes: %s\n", argv[arg], format->name, read32(file.data() + 4),
+               passed ? "ok" : "MISMATCH");
+        ok &= passed;
+    }
+
+    for (i = 0; i < corpus.size(); i++) {
+        for (f = 0; f < sizeof(sFormats) / sizeof(sFormats[0]); f++) {
+            sFormats[f].encode(corpus[i].data.data(), corpus[i].data.size(), file);
+            passed = checkFile(&sFormats[f], file, &corpus[i].data);
+            printf("%-10s %s %8lu -> %8lu bytes, crc %08lx: %s\n", corpus[i].name.c_str(), sFormats[f].name,
+                   (u32)corpus[i].data.size(), (u32)file.size(),
+                   (u32)crc32(corpus[i].data.data(), corpus[i].data.size()), passed ? "ok" : "MISMATCH");
+            ok &= passed;
+        }
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static f64 decodeRate(DecodeFunc decode, std::vector<u8>& file, std::vector<u8>& out) {
+    Clock::time_point start;
+    f64 seconds;
+    u32 runs;
+
+    start = Clock::now();
+    runs = 0;
+    do {
+        decode(file.data(), out.data(), out.size(), 0);
+        runs++;
+        seconds = std::chrono::duration<f64>(Clock::now() - start).count();
+    } while (seconds < BENCH_SECONDS);
+    return (f64)out.size() * runs / seconds / (1024 * 1024);
+}
+
+static int bench(int argc, char** argv) {
+    std::vector<Sample> corpus;
+    std::vector<u8> file;
+    std::vector<u8> out;
+    f64 reference;
+    f64 fast;
+    u32 i;
+    u32 f;
+    s32 arg;
+
+    makeCorpus(corpus);
+    corpus.pop_back();
+    for (arg = 2; arg < argc; arg++) {
+        corpus.push_back(Sample());
+        corpus.back().name = argv[arg];
+        if (!readFile(argv[arg], corpus.back().data)) {
+            fprintf(stderr, "can't read %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    printf("%-10s fmt    input   packed  original MB/s  fast MB/s\n", "");
+    for (i = 0; i < corpus.size(); i++) {
+        for (f = 0; f < sizeof(sFormats) / sizeof(sFormats[0]); f++) {
+            // compressed inputs are timed as they are, in their own format only
+            if (formatOf(corpus[i].data) != NULL) {
+                if (formatOf(corpus[i].data) != &sFormats[f]) {
+                    continue;
+                }
+                file = corpus[i].data;
+            } else {
+                sFormats[f].encode(corpus[i].data.data(), corpus[i].data.size(), file);
+            }
+
+            out.resize(read32(file.data() + 4));
+            reference = decodeRate(sFormats[f].reference, file, out);
+            fast = decodeRate(sFormats[f].fast, file, out);
+            printf("%-10s %s %8lu %8lu %12.1f %10.1f  x%.2f\n", corpus[i].name.c_str(), sFormats[f].name,
+                   (u32)out.size(), (u32)file.size(), reference, fast, fast / reference);
+        }
+    }
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: jkrdecomp test [files]\n"
+                    "       jkrdecomp bench [files]\n"
+                    "       jkrdecomp encode szs|szp <in> <out>\n"
+                    "       jkrdecomp decode <in> <out>\n");
+}
+
+static int encode(int argc, char** argv) {
+    std::vector<u8> in;
+    std::vector<u8> out;
+    const Format* format;
+
+    format = NULL;
+    if (argc == 5) {
+        format = strcmp(argv[2], "szs") == 0 ? &sFormats[0] : strcmp(argv[2], "szp") == 0 ? &sFormats[1] : NULL;
+    }
+    if (format == NULL || !readFile(argv[3], in)) {
+        usage();
+        return 1;
+    }
+    format->encode(in.data(), in.size(), out);
+    if (!writeFile(argv[4], out)) {
+        fprintf(stderr, "can't write %s\n", argv[4]);
+        return 1;
+    }
+    printf("%lu -> %lu bytes\n", (u32)in.size(), (u32)out.size());
+    return 0;
+}
+
+static int decode(int argc, char** argv) {
+    std::vector<u8> in;
+    std::vector<u8> out;
+    const Format* format;
+
+    if (argc != 4) {
+        usage();
+        return 1;
+    }
+    if (!readFile(argv[2], in) || (format = formatOf(in)) == NULL) {
+        fprintf(stderr, "%s isn't Yaz0 or Yay0\n", argv[2]);
+        return 1;
+    }
+    out.resize(read32(in.data() + 4));
+    format->fast(in.data(), out.data(), out.size(), 0);
+    if (!writeFile(argv[3], out)) {
+        fprintf(stderr, "can't write %s\n", argv[3]);
+        return 1;
+    }
+    return 0;
+}
+
+static const HostCommand sCommands[] = {
+    {"test", test},
+    {"bench", bench},
+    {"encode", encode},
+    {"decode", decode},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
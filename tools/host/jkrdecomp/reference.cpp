@@ -0,0 +1,143 @@
+#include "jkrdecomp.h"
+
+static u32 read32(const u8* data) {
+    return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | data[3];
+}
+
+void JKRHostDecodeSZSRef(u8* src, u8* dst, u32 size, u32 offset) {
+    u8* decompEnd;
+    u8* copyStart;
+    u8* curSrcPos;
+    u32 copyByteCount;
+    u32 chunkBitsLeft;
+    u32 chunkBits;
+    u32 expandSize;
+    u8 curVal;
+
+    expandSize = read32(src + 4);
+    if (size == 0 || offset >= expandSize) {
+        return;
+    }
+
+    decompEnd = dst + expandSize - offset;
+    curSrcPos = src + 0x10;
+    chunkBitsLeft = 0;
+    chunkBits = 0;
+    do {
+        if (chunkBitsLeft == 0) {
+            chunkBits = *curSrcPos++;
+            chunkBitsLeft = 8;
+        }
+
+        if (chunkBits & 0x80) {
+            if (offset == 0) {
+                *dst++ = *curSrcPos;
+                if (--size == 0) {
+                    return;
+                }
+            } else {
+                offset--;
+            }
+            curSrcPos++;
+        } else {
+            curVal = curSrcPos[0];
+            copyStart = dst - (((curVal & 0xF) << 8) | curSrcPos[1]);
+            curSrcPos += 2;
+            if ((curVal >> 4) == 0) {
+                copyByteCount = *curSrcPos++ + 0x12;
+            } else {
+                copyByteCount = (curVal >> 4) + 2;
+            }
+
+            do {
+                if (offset == 0) {
+                    *dst++ = copyStart[-1];
+                    if (--size == 0) {
+                        return;
+                    }
+                } else {
+                    offset--;
+                }
+                copyStart++;
+            } while (--copyByteCount != 0);
+        }
+
+        chunkBits <<= 1;
+        chunkBitsLeft--;
+    } while (dst != decompEnd);
+}
+
+void JKRHostDecodeSZPRef(u8* src, u8* dst, u32 size, u32 offset) {
+    u32 decodedSize;
+    u32 decodedEnd;
+    u32 linkTableOffset;
+    u32 srcDataOffset;
+    u32 srcChunkOffset;
+    u32 dstOffset;
+    u32 chunkBits;
+    u32 counter;
+    u32 linkInfo;
+    u32 count;
+    u32 i;
+    s32 from;
+
+    decodedSize = read32(src + 4);
+    linkTableOffset = read32(src + 8);
+    srcDataOffset = read32(src + 12);
+    if (size == 0 || offset >= decodedSize) {
+        return;
+    }
+
+    decodedEnd = decodedSize - offset;
+    srcChunkOffset = 0x10;
+    dstOffset = 0;
+    counter = 0;
+    chunkBits = 0;
+    do {
+        if (counter == 0) {
+            chunkBits = read32(src + srcChunkOffset);
+            srcChunkOffset += 4;
+            counter = 32;
+        }
+
+        if (chunkBits & 0x80000000) {
+            if (offset == 0) {
+                dst[dstOffset++] = src[srcDataOffset];
+                if (--size == 0) {
+                    return;
+                }
+            } else {
+                offset--;
+            }
+            srcDataOffset++;
+        } else {
+            linkInfo = (src[linkTableOffset] << 8) | src[linkTableOffset + 1];
+            linkTableOffset += 2;
+            from = (s32)dstOffset - (s32)(linkInfo & 0xFFF);
+            count = linkInfo >> 12;
+            if (count == 0) {
+                count = src[srcDataOffset++] + 0x12;
+            } else {
+                count += 2;
+            }
+            if (count > decodedSize - dstOffset) {
+                count = decodedSize - dstOffset;
+            }
+
+            for (i = 0; i < count; i++) {
+                if (offset == 0) {
+                    dst[dstOffset++] = dst[from - 1];
+                    if (--size == 0) {
+                        return;
+                    }
+                } else {
+                    offset--;
+                }
+                from++;
+            }
+        }
+
+        chunkBits <<= 1;
+        counter--;
+    } while (dstOffset < decodedEnd);
+}
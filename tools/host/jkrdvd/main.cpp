@@ -0,0 +1,444 @@
+// Host benchmark of the decompress-while-reading path (src/JSystem/JKernel/JKRDvdDecode.cpp) against loading the
+// whole Yaz0 file and decoding it afterwards, which is what JKRDvdRipper does with sStreamSzs off. The drive is the
+// streamload model, a thread completing reads after a per-command latency plus length/bandwidth; the OS calls come
+// from aramemu. The test also runs JKRDvdRipper::loadToMainRAM itself over that drive (jkrdvd/ripper.cpp).
+
+#include "../aramemu/aramemu.h"
+#include "../jkrdecomp/jkrdecomp.h"
+#include "JSystem/JKernel/JKRDvdDecode.h"
+#include "JSystem/JKernel/JKRDvdRipper.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define GUARD_SIZE 64
+#define GUARD_BYTE 0xA5
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct SimRead {
+    DVDFileInfo* fileInfo;
+    u8* addr;
+    u32 length;
+    u32 offset;
+    DVDCallback callback;
+} SimRead;
+
+u32 simRipperLoad(DVDFileInfo* fileInfo, u8* dst, u32 size, u32 offset, bool expand, bool stream, u32* numLive);
+
+static double sDVDBytesPerSecond;
+static double sDVDLatencyUs;
+static std::vector<u8>* sDisc;
+
+static std::mutex sDVDLock;
+static std::condition_variable sDVDCond;
+static std::deque<SimRead> sDVDQueue;
+static bool sDVDRunning;
+static u32 sNumReadErrors; // the next that many reads fail after the transfer time
+
+static void simDVDThread(void) {
+    std::unique_lock<std::mutex> lock(sDVDLock);
+    SimRead read;
+    Clock::time_point due;
+    bool failed;
+
+    while (true) {
+        sDVDCond.wait(lock, [] { return !sDVDRunning || !sDVDQueue.empty(); });
+        if (sDVDQueue.empty()) {
+            break;
+        }
+
+        read = sDVDQueue.front();
+        sDVDQueue.pop_front();
+        lock.unlock();
+
+        due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                                 sDVDLatencyUs / 1e6 + read.length / sDVDBytesPerSecond));
+        std::this_thread::sleep_until(due);
+        lock.lock();
+        failed = sNumReadErrors != 0;
+        if (failed) {
+            sNumReadErrors--;
+        }
+        lock.unlock();
+        if (!failed) {
+            memcpy(read.addr, sDisc->data() + read.offset, read.length);
+        }
+
+        // DVD callbacks run from the DI interrupt
+        OSDisableInterrupts();
+        read.fileInfo->cb.state = DVD_STATE_END;
+        read.callback(failed ? -1 : (s32)read.length, read.fileInfo);
+        OSEnableInterrupts();
+
+        lock.lock();
+    }
+}
+
+extern "C" {
+BOOL DVDReadAsyncPrio(DVDFileInfo* fileInfo, void* addr, s32 length, s32 offset, DVDCallback callback, s32 prio) {
+    SimRead read;
+
+    // the same checks the SDK asserts on
+    if (((u32)addr & 0x1F) || (length & 0x1F) || (offset & 3) || (u32)offset >= fileInfo->length ||
+        (u32)offset + length >= fileInfo->length + 32 || fileInfo->cb.state == DVD_STATE_BUSY) {
+        return false;
+    }
+
+    read.fileInfo = fileInfo;
+    read.addr = (u8*)addr;
+    read.offset = offset;
+    read.length = (u32)offset + length > fileInfo->length ? fileInfo->length - offset : length;
+    read.callback = callback;
+    fileInfo->cb.state = DVD_STATE_BUSY;
+
+    {
+        std::lock_guard<std::mutex> lock(sDVDLock);
+        sDVDQueue.push_back(read);
+    }
+    sDVDCond.notify_all();
+    return true;
+}
+
+void DCInvalidateRange(void* addr, u32 nBytes) {}
+}
+
+static OSThreadQueue sReadQueue;
+static volatile bool sReadDone;
+
+static void readCallback(s32 result, DVDFileInfo* fileInfo) {
+    sReadDone = true;
+    OSWakeupThread(&sReadQueue);
+}
+
+// JKRDvdRipper's reads, on the test's thread only
+extern "C" s32 DVDReadPrio(DVDFileInfo* fileInfo, void* addr, s32 length, s32 offset, s32 prio) {
+    BOOL enabled;
+
+    sReadDone = false;
+    if (!DVDReadAsyncPrio(fileInfo, addr, length, offset, readCallback, prio)) {
+        return -1;
+    }
+    enabled = OSDisableInterrupts();
+    while (!sReadDone) {
+        OSSleepThread(&sReadQueue);
+    }
+    OSRestoreInterrupts(enabled);
+    return length;
+}
+
+// The two-pass load: the whole file into a buffer, then JKRDecodeSZS
+static bool loadTwoPass(DVDFileInfo* fileInfo, u8* dst, u32 size) {
+    u8* compressed;
+    BOOL enabled;
+    bool ok;
+
+    compressed = (u8*)aligned_alloc(32, OSRoundUp32B(fileInfo->length));
+    sReadDone = false;
+    ok = DVDReadAsyncPrio(fileInfo, compressed, OSRoundUp32B(fileInfo->length), 0, readCallback, 2);
+    enabled = OSDisableInterrupts();
+    while (ok && !sReadDone) {
+        OSSleepThread(&sReadQueue);
+    }
+    OSRestoreInterrupts(enabled);
+    if (ok) {
+        JKRDecodeSZS(compressed, dst, size, 0);
+    }
+    free(compressed);
+    return ok;
+}
+
+// Mostly text and archive-like records with some incompressible stretches, about 2:1 with the tool's encoder
+static void makeFile(std::vector<u8>& data, u32 size) {
+    static const char* words[] = {"board", "star", "coin", "minigame", "player", "dice", "space", "bonus"};
+    u32 seed;
+    u32 value;
+    u32 i;
+
+    data.clear();
+    seed = 1;
+    while (data.size() < size) {
+        seed = (seed * 1103515245 + 12345) & 0xFFFFFFFF;
+        switch ((seed >> 16) % 4) {
+        case 0:
+            for (i = 0; i < 64; i++) {
+                seed = (seed * 1103515245 + 12345) & 0xFFFFFFFF;
+                value = (seed >> 16) % (sizeof(words) / sizeof(words[0]));
+                data.insert(data.end(), words[value], words[value] + strlen(words[value]));
+                data.push_back(' ');
+            }
+            break;
+        case 1:
+        case 2:
+            for (i = 0; i < 64; i++) {
+                seed = (seed * 1103515245 + 12345) & 0xFFFFFFFF;
+                value = 0x3F800000 + ((seed >> 20) & 0xFF);
+                data.push_back((u8)(value >> 24));
+                data.push_back((u8)(value >> 16));
+                data.push_back((u8)(value >> 8));
+                data.push_back((u8)value);
+            }
+            break;
+        default:
+            for (i = 0; i < 256; i++) {
+                seed = (seed * 1103515245 + 12345) & 0xFFFFFFFF;
+                data.push_back((u8)(seed >> 16));
+            }
+            break;
+        }
+    }
+    data.resize(size);
+}
+
+static void openDisc(DVDFileInfo* fileInfo, std::vector<u8>& file) {
+    memset(fileInfo, 0, sizeof(DVDFileInfo));
+    fileInfo->length = (u32)file.size();
+    sDisc = &file;
+}
+
+// Streamed loads of every window and skip case against the original data, with guard bytes after the output
+static bool test(const std::vector<u8>& data, std::vector<u8>& file) {
+    static const u32 workSizes[] = {JKR_DVD_DECODE_MIN_WORK, 0x1800, 0x4000, 0x10000};
+    DVDFileInfo fileInfo;
+    std::vector<u8> out;
+    u8* work;
+    u32 offsets[6];
+    u32 sizes[3];
+    u32 written;
+    u32 size;
+    u32 w;
+    u32 o;
+    u32 s;
+    u32 i;
+    bool ok;
+    bool retried;
+
+    offsets[0] = 0;
+    offsets[1] = 1;
+    offsets[2] = 0xFFF;
+    offsets[3] = 0x12345;
+    offsets[4] = data.size() / 2 + 3;
+    offsets[5] = data.size() - 1;
+    openDisc(&fileInfo, file);
+    work = (u8*)aligned_alloc(32, 0x10000);
+    ok = true;
+
+    for (w = 0; w < sizeof(workSizes) / sizeof(workSizes[0]); w++) {
+        for (o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            sizes[0] = data.size() - offsets[o];
+            sizes[1] = 1;
+            sizes[2] = 0x2001 < sizes[0] ? 0x2001 : sizes[0];
+            for (s = 0; s < 3; s++) {
+                size = sizes[s];
+                out.assign(size + GUARD_SIZE, GUARD_BYTE);
+                written = JKRDvdDecodeSZS(&fileInfo, out.data(), size, offsets[o], work, workSizes[w], NULL);
+                for (i = size; i < size + GUARD_SIZE && out[i] == GUARD_BYTE; i++) {
+                }
+
+                if (written != size || i != size + GUARD_SIZE ||
+                    memcmp(out.data(), data.data() + offsets[o], size) != 0) {
+                    printf("work 0x%lx, offset 0x%lx, size 0x%lx: MISMATCH (%lu written)\n", workSizes[w],
+                           offsets[o], size, written);
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    // past the end, and not Yaz0
+    ok &= JKRDvdDecodeSZS(&fileInfo, out.data(), 1, data.size(), work, 0x4000, NULL) == 0;
+    file[0] = 'X';
+    ok &= JKRDvdDecodeSZS(&fileInfo, out.data(), 1, 0, work, 0x4000, NULL) == 0;
+    file[0] = 'Y';
+
+    printf("%lu work sizes x %lu offsets x 3 sizes: %s\n", (u32)(sizeof(workSizes) / sizeof(workSizes[0])),
+           (u32)(sizeof(offsets) / sizeof(offsets[0])), ok ? "ok" : "FAILED");
+
+    // failed reads, retried and not
+    out.assign(data.size(), 0);
+    sNumReadErrors = 3;
+    retried = JKRDvdDecodeSZS(&fileInfo, out.data(), data.size(), 0, work, 0x4000, NULL) == data.size() && out == data;
+    JKRDvdRipper::errorRetry = false;
+    sNumReadErrors = 1;
+    retried &= JKRDvdDecodeSZS(&fileInfo, out.data(), data.size(), 0, work, 0x4000, NULL) == 0;
+    JKRDvdRipper::errorRetry = true;
+    printf("read errors with and without errorRetry: %s\n", retried ? "ok" : "FAILED");
+
+    free(work);
+    return ok && retried;
+}
+
+// JKRDvdRipper::loadToMainRAM at word-aligned and unaligned offsets, raw and through both Yaz0 paths, with guard
+// bytes after the output and no heap blocks left behind
+static bool testRipper(std::vector<u8>& data, std::vector<u8>& file) {
+    static const u32 offsets[] = {0, 1, 2, 3, 4, 0x1001, 0x12346};
+    DVDFileInfo fileInfo;
+    std::vector<u8> out;
+    u8* dst;
+    u32 numLive;
+    u32 loaded;
+    u32 size;
+    u32 mode;
+    u32 o;
+    u32 i;
+    bool ok;
+
+    dst = (u8*)aligned_alloc(32, OSRoundUp32B(data.size()) + 32 + GUARD_SIZE);
+    ok = true;
+    for (mode = 0; mode < 3; mode++) {
+        openDisc(&fileInfo, mode == 0 ? data : file);
+        for (o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            // JKRDecodeSZS, like the decoder it replaced, can't skip into the middle of a file whose
+            // back-references reach behind the skipped part, so the two-pass load only starts at 0
+            if (mode == 2 && offsets[o] != 0) {
+                continue;
+            }
+
+            // the raw load reads whole 32-byte blocks into dst, so only what follows those is a guard
+            size = 0x2001;
+            memset(dst, GUARD_BYTE, OSRoundUp32B(data.size()) + 32 + GUARD_SIZE);
+            loaded = simRipperLoad(&fileInfo, dst, size, offsets[o], mode != 0, mode == 1, &numLive);
+            for (i = OSRoundUp32B(size); i < OSRoundUp32B(size) + GUARD_SIZE && dst[i] == GUARD_BYTE; i++) {
+            }
+
+            if (loaded != size || numLive != 0 || i != OSRoundUp32B(size) + GUARD_SIZE ||
+                memcmp(dst, data.data() + offsets[o], size) != 0) {
+                printf("loadToMainRAM %s, offset 0x%lx: MISMATCH (%lu loaded, %lu blocks left)\n",
+                       mode == 0 ? "raw" : mode == 1 ? "streamed" : "two-pass", offsets[o], loaded, numLive);
+                ok = false;
+            }
+        }
+    }
+
+    free(dst);
+    printf("loadToMainRAM raw and streamed x %lu offsets, two-pass: %s\n",
+           (u32)(sizeof(offsets) / sizeof(offsets[0])), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static f64 msSince(Clock::time_point start) { return std::chrono::duration<f64>(Clock::now() - start).count() * 1e3; }
+
+// With consoleRate (decoded MB/s on the console) the drive runs that much faster than given, relative to the host's
+// decoder, and times are scaled back, which shows the overlap as the console would see it. Host thread wake-ups get
+// scaled too, so small work buffers, with many short reads, come out worse than they would be.
+static bool bench(const std::vector<u8>& data, std::vector<u8>& file, f64 consoleRate) {
+    static const u32 workSizes[] = {0x4000, 0x10000, 0x40000};
+    DVDFileInfo fileInfo;
+    JKRDvdDecodeStats stats;
+    std::vector<u8> out;
+    Clock::time_point start;
+    f64 scale;
+    f64 twoPassMs;
+    f64 decodeMs;
+    f64 ms;
+    u8* work;
+    u32 w;
+    bool ok;
+
+    openDisc(&fileInfo, file);
+    out.resize(data.size());
+
+    start = Clock::now();
+    JKRDecodeSZS(file.data(), out.data(), out.size(), 0);
+    decodeMs = msSince(start);
+    scale = consoleRate > 0.0 ? data.size() / (decodeMs / 1e3) / (consoleRate * 1024 * 1024) : 1.0;
+    printf("%lu KB Yaz0 file (%lu KB packed), DVD %.1f MB/s + %.0f us per read", (u32)data.size() / 1024,
+           (u32)file.size() / 1024, sDVDBytesPerSecond / (1024 * 1024), sDVDLatencyUs);
+    if (consoleRate > 0.0) {
+        printf(", decoding at %.1f MB/s (host time x%.1f)", consoleRate, scale);
+        sDVDBytesPerSecond *= scale;
+        sDVDLatencyUs /= scale;
+    }
+    printf("\n");
+
+    start = Clock::now();
+    ok = loadTwoPass(&fileInfo, out.data(), out.size()) && out == data;
+    twoPassMs = msSince(start) * scale;
+    printf("%-18s %9.1f ms, %7lu KB besides the destination (decode alone %.1f ms)\n", "two-pass", twoPassMs,
+           OSRoundUp32B(file.size()) / 1024, decodeMs * scale);
+
+    for (w = 0; w < sizeof(workSizes) / sizeof(workSizes[0]); w++) {
+        work = (u8*)aligned_alloc(32, workSizes[w]);
+        memset(out.data(), 0, out.size());
+        start = Clock::now();
+        ok &= JKRDvdDecodeSZS(&fileInfo, out.data(), out.size(), 0, work, workSizes[w], &stats) == out.size() &&
+              out == data;
+        ms = msSince(start) * scale;
+        printf("streamed, 0x%-6lx %9.1f ms, %7lu KB besides the destination, %lu reads, %.1f ms waiting: %.1f ms "
+               "sooner\n",
+               workSizes[w], ms, workSizes[w] / 1024, stats.numReads,
+               OSTicksToMicroseconds(stats.waitTime) * scale / 1e3, twoPassMs - ms);
+        free(work);
+    }
+    return ok;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: jkrdvd test\n"
+                    "       jkrdvd bench [DVD MB/s] [file MB] [console decode MB/s]\n");
+}
+
+int main(int argc, char** argv) {
+    AREmuConfig config;
+    std::vector<u8> data;
+    std::vector<u8> file;
+    std::thread dvd;
+    u32 size;
+    f64 consoleRate;
+    bool ok;
+
+    consoleRate = 0.0;
+    if (argc >= 2 && strcmp(argv[1], "test") == 0) {
+        sDVDBytesPerSecond = 1024.0 * 1024 * 1024;
+        sDVDLatencyUs = 0.0;
+        size = 0x60000;
+    } else if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        sDVDBytesPerSecond = (argc > 2 ? atof(argv[2]) : 3.0) * 1024 * 1024;
+        sDVDLatencyUs = 100.0;
+        size = (argc > 3 ? (u32)atoi(argv[3]) : 4) * 1024 * 1024;
+        consoleRate = argc > 4 ? atof(argv[4]) : 0.0;
+        if (sDVDBytesPerSecond <= 0.0 || size == 0 || consoleRate < 0.0) {
+            usage();
+            return 1;
+        }
+    } else {
+        usage();
+        return 1;
+    }
+
+    // only for the OS calls and the bus clock
+    config.bytesPerSecond = 80.0 * 1024 * 1024;
+    config.latencyUs = 2.0;
+    AREmuInit(&config);
+
+    makeFile(data, size);
+    JKRHostEncodeSZS(data.data(), data.size(), file);
+    OSInitThreadQueue(&sReadQueue);
+    sDVDRunning = true;
+    dvd = std::thread(simDVDThread);
+
+    if (strcmp(argv[1], "test") == 0) {
+        ok = test(data, file);
+        ok &= testRipper(data, file);
+    } else {
+        ok = bench(data, file, consoleRate);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sDVDLock);
+        sDVDRunning = false;
+    }
+    sDVDCond.notify_all();
+    dvd.join();
+    AREmuShutdown();
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return !ok;
+}
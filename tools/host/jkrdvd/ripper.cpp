@@ -0,0 +1,91 @@
+// The JKernel side of the JKRDvdRipper::loadToMainRAM checks in main.cpp: a JKRDvdFile over the simulated disc, heap
+// allocations that go to aligned_alloc and are counted so leaked buffers show up, and JKRDecomp backed by
+// JKRDecodeSZS. It lives apart from main.cpp because the JKernel operator new and delete declarations clash with the
+// host C++ library headers.
+
+#include "JSystem/JKernel/JKRDecode.h"
+#include "JSystem/JKernel/JKRDecomp.h"
+#include "JSystem/JKernel/JKRDvdFile.h"
+#include "JSystem/JKernel/JKRDvdRipper.h"
+#include "JSystem/JKernel/JKRHeap.h"
+#include "dolphin/os.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static u32 sHeapStorage[(sizeof(JKRHeap) + 3) / 4];
+JKRHeap* JKRHeap::sSystemHeap = (JKRHeap*)sHeapStorage;
+JKRHeap* JKRHeap::sCurrentHeap = (JKRHeap*)sHeapStorage;
+
+static u32 sNumLiveBlocks;
+
+void* JKRHeap::alloc(u32 size, int alignment, JKRHeap* heap) {
+    sNumLiveBlocks++;
+    return aligned_alloc(32, OSRoundUp32B(size));
+}
+
+void JKRHeap::free(void* ptr, JKRHeap* heap) {
+    sNumLiveBlocks--;
+    ::free(ptr);
+}
+
+void* JKRHeap::alloc(u32 size, int alignment) { return alloc(size, alignment, this); }
+
+void JKRHeap::free(void* ptr) { free(ptr, this); }
+
+JKRCompression JKRDecomp::checkCompressed(u8* src) {
+    if (src[0] == 'Y' && src[1] == 'a' && src[2] == 'z' && src[3] == '0') {
+        return COMPRESSION_YAZ0;
+    }
+    return COMPRESSION_NONE;
+}
+
+bool JKRDecomp::orderSync(u8* src, u8* dst, u32 size, u32 offset) {
+    JKRDecodeSZS(src, dst, size, offset);
+    return true;
+}
+
+JSUPtrLink::JSUPtrLink(void* object) { memset(this, 0, sizeof(JSUPtrLink)); }
+
+JSUPtrLink::~JSUPtrLink() {}
+
+void JSUPtrList::initiate() {}
+
+JSUPtrList::~JSUPtrList() {}
+
+JKRDisposer::JKRDisposer() : mHeap(NULL), mLink(this) {}
+
+JKRDisposer::~JKRDisposer() {}
+
+JKRDvdFile::JKRDvdFile() : mDvdLink(this) { memset(&mFileInfo, 0, sizeof(DVDFileInfo)); }
+
+JKRDvdFile::~JKRDvdFile() {}
+
+bool JKRDvdFile::open(const char* name) { return false; }
+
+bool JKRDvdFile::open(s32 entryNum) { return false; }
+
+void JKRDvdFile::close(void) {}
+
+s32 JKRDvdFile::readData(void* addr, s32 length, s32 offset) { return -1; }
+
+s32 JKRDvdFile::writeData(const void* addr, s32 length, s32 offset) { return -1; }
+
+s32 JKRDvdFile::getFileSize(void) const { return mFileInfo.length; }
+
+extern "C" void VIWaitForRetrace(void) {}
+
+// loadToMainRAM of fileInfo into dst; expand decodes Yaz0, stream picks JKRDvdDecodeSZS over the two-pass load.
+// numLive gets the heap blocks still allocated afterwards.
+u32 simRipperLoad(DVDFileInfo* fileInfo, u8* dst, u32 size, u32 offset, bool expand, bool stream, u32* numLive) {
+    JKRDvdFile file;
+    int loaded;
+
+    file.mFileInfo = *fileInfo;
+    JKRDvdRipper::setStreamSzs(stream);
+    sNumLiveBlocks = 0;
+    JKRDvdRipper::loadToMainRAM(&file, dst, expand ? EXPAND_SWITCH_UNKNOWN1 : EXPAND_SWITCH_UNKNOWN0, size, NULL,
+                                JKRDvdRipper::ALLOC_DIRECTION_FORWARD, offset, &loaded);
+    *numLive = sNumLiveBlocks;
+    return loaded;
+}
@@ -0,0 +1,22 @@
+#ifndef _JKRSTREAM_JKRSTREAM_H
+#define _JKRSTREAM_JKRSTREAM_H
+
+#include "dolphin/types.h"
+
+// A file on the simulated disc. JSUFileInputStream is handed one in place of its JKRFile, and its reads block for
+// latencyUs plus the length over bytesPerSecond, like JKRDvdFile::readData blocks the stream thread.
+typedef struct SimFile {
+    const u8* data;
+    u32 length;
+} SimFile;
+
+void simSetDisc(double bytesPerSecond, double latencyUs);
+u32 simGetNumReads(void);
+// JKRAramPiece::orderAsync calls; ARQ cuts each into DMAs of up to ARQ_CHUNK_SIZE
+u32 simGetNumPieces(void);
+
+// Transfer buffers the stream allocated and freed on the (malloc backed) heaps
+u32 simGetNumAllocs(void);
+u32 simGetNumFrees(void);
+
+#endif
@@ -0,0 +1,296 @@
+// Host test and benchmark of JKRAramStream's pipelined writes (src/JSystem/JKernel/JKRAramStream.cpp) on the
+// aramemu backend. The test checks what lands in ARAM and how the commands are answered for every buffer count and
+// a few transfer buffer sizes, one command at a time and in batches; the benchmark loads a file in pieces the way a
+// sound bank is, with one buffer and no batching as the old writeToAram did, and with more buffers and batches.
+
+#include "jkrstream.h"
+#include "../aramemu/aramemu.h"
+#include "JSystem/JKernel/JKRAramStream.h"
+#include "JSystem/JSupport/JSUFileStream.h"
+#include "dolphin/arq.h"
+#include "dolphin/os.h"
+#include "../common/test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_FILE_SIZE 0x80000
+#define TEST_ARAM_SIZE 0x80000
+#define NUM_TEST_COMMANDS 7
+#define MAX_BENCH_COMMANDS 1024
+
+typedef struct TestCommand {
+    u32 offset;
+    u32 size;
+    u32 aram; // from the start of the test area
+} TestCommand;
+
+// Two contiguous commands, one that isn't 32 byte aligned, one after it that can't share its DMA, an empty one, a
+// large one and one in front of it in ARAM
+static const TestCommand sTestCommands[NUM_TEST_COMMANDS] = {
+    {0x00000, 0x3000, 0x00000},  {0x03000, 0x2000, 0x03000}, {0x10000, 0x1234, 0x08000}, {0x11240, 0x6000, 0x0A000},
+    {0x00000, 0x0000, 0x20000}, {0x40000, 0x21000, 0x30000}, {0x20000, 0x8000, 0x28000},
+};
+
+static JKRAramStreamCommand sBenchCommands[MAX_BENCH_COMMANDS];
+static JKRAramStreamStats sBenchStats[MAX_BENCH_COMMANDS];
+static u8* sFile;
+static SimFile sSimFile;
+static u32 sAram;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What write_StreamToAram_Async fills in, without sending it to a stream thread
+static void initCommand(JKRAramStreamCommand* command, JSUFileInputStream* stream, u32 address, u32 size, u32 offset,
+                        u8* buffer, u32 bufferSize, JKRAramStreamStats* stats) {
+    command->mType = JKRAramStreamCommand::WRITE;
+    command->mAddress = address;
+    command->mSize = size;
+    command->mStream = stream;
+    command->mOffset = offset;
+    command->mTransferBuffer = buffer;
+    command->mTransferBufferSize = bufferSize;
+    command->mHeap = NULL;
+    command->mStats = stats;
+    memset(stats, 0, sizeof(JKRAramStreamStats));
+    OSInitMessageQueue(&command->mMessageQueue, &command->mMessage, 1);
+}
+
+// Writes the test commands count at a time and checks ARAM, the answers and the stats
+static bool testWrite(u32 numBuffers, u32 bufferSize, u8* buffer, u32 batch) {
+    JKRAramStreamCommand commands[NUM_TEST_COMMANDS];
+    JKRAramStreamCommand* list[NUM_TEST_COMMANDS];
+    JKRAramStreamStats stats[NUM_TEST_COMMANDS];
+    JSUFileInputStream stream((JKRFile*)&sSimFile);
+    const TestCommand* test;
+    OSMessage message;
+    char what[128];
+    u32 allocs;
+    u32 written;
+    u32 total;
+    u32 n;
+    u32 i;
+    bool ok;
+
+    JKRAramStream::setTransBufferCount(numBuffers);
+    memset(AREmuGetARAM() + sAram, 0, TEST_ARAM_SIZE);
+    allocs = simGetNumAllocs();
+    total = 0;
+    for (i = 0; i < NUM_TEST_COMMANDS; i++) {
+        test = &sTestCommands[i];
+        initCommand(&commands[i], &stream, sAram + test->aram, test->size, test->offset, buffer, bufferSize,
+                    &stats[i]);
+        list[i] = &commands[i];
+        total += test->size;
+    }
+
+    written = 0;
+    for (i = 0; i < NUM_TEST_COMMANDS; i += n) {
+        n = NUM_TEST_COMMANDS - i < batch ? NUM_TEST_COMMANDS - i : batch;
+        written += JKRAramStream::writeToAram(&list[i], n);
+    }
+
+    snprintf(what, sizeof(what), "%lu buffers of %lu bytes%s, batches of %lu", numBuffers, bufferSize,
+             buffer != NULL ? " (caller's)" : "", batch);
+    ok = expect(written == total, what);
+    for (i = 0; i < NUM_TEST_COMMANDS; i++) {
+        test = &sTestCommands[i];
+        ok &= expect(memcmp(AREmuGetARAM() + sAram + test->aram, sFile + test->offset, test->size) == 0, "ARAM data");
+        ok &= expect(OSReceiveMessage(&commands[i].mMessageQueue, &message, OS_MESSAGE_NOBLOCK), "answered");
+        ok &= expect((u32)message == test->size, "answer is the size");
+        ok &= expect(stats[i].mBytes == test->size && (stats[i].mChunks != 0) == (test->size != 0), "stats counts");
+        ok &= expect(stats[i].mEndTime >= stats[i].mStartTime, "stats times");
+        if (i != 0) {
+            ok &= expect(stats[i].mEndTime >= stats[i - 1].mEndTime || i % batch == 0, "answered in order");
+        }
+    }
+    // the gaps between the commands are still clear
+    ok &= expect(AREmuGetARAM()[sAram + 0x5000] == 0 && AREmuGetARAM()[sAram + 0x9234] == 0, "nothing in between");
+    ok &= expect(simGetNumFrees() == simGetNumAllocs() && (buffer == NULL || simGetNumAllocs() == allocs),
+                 "transfer buffers freed");
+    if (!ok) {
+        printf("      in: %s\n", what);
+    }
+    return ok;
+}
+
+// Contiguous commands share DMAs when they're written in one batch
+static bool testMerge(void) {
+    JKRAramStreamCommand commands[8];
+    JKRAramStreamCommand* list[8];
+    JKRAramStreamStats stats[8];
+    JSUFileInputStream stream((JKRFile*)&sSimFile);
+    u32 pieces[2];
+    u32 batch;
+    u32 i;
+    bool ok;
+
+    ok = true;
+    JKRAramStream::setTransBufferCount(2);
+    for (batch = 1; batch <= 4; batch += 3) {
+        memset(AREmuGetARAM() + sAram, 0, TEST_ARAM_SIZE);
+        for (i = 0; i < 8; i++) {
+            initCommand(&commands[i], &stream, sAram + i * 0x1000, 0x1000, i * 0x1000, NULL, 0x4000, &stats[i]);
+            list[i] = &commands[i];
+        }
+
+        pieces[0] = simGetNumPieces();
+        for (i = 0; i < 8; i += batch) {
+            JKRAramStream::writeToAram(&list[i], batch);
+        }
+        pieces[1] = simGetNumPieces();
+
+        ok &= expect(memcmp(AREmuGetARAM() + sAram, sFile, 0x8000) == 0, "merged data");
+        // 0x2000 byte chunks: one request a command alone, two commands a request in batches
+        ok &= expect(pieces[1] - pieces[0] == (batch == 1 ? 8 : 4), "requests per batch");
+        ok &= expect(stats[0].mChunks == 1 && stats[0].mBatchSize == batch, "merged stats");
+    }
+    return ok;
+}
+
+static int test(void) {
+    static const u32 bufferSizes[] = {0x8000, 0x1000, 0x60};
+    u8* buffer;
+    u32 numBuffers;
+    u32 size;
+    u32 batch;
+    u32 i;
+    bool ok;
+
+    simSetDisc(1024.0 * 1024 * 1024, 0.0);
+    buffer = (u8*)aligned_alloc(32, 0x8000);
+    ok = true;
+    for (numBuffers = 1; numBuffers <= JKR_ARAM_STREAM_MAX_BUFFERS; numBuffers++) {
+        for (i = 0; i < sizeof(bufferSizes) / sizeof(bufferSizes[0]); i++) {
+            size = bufferSizes[i];
+            for (batch = 1; batch <= JKR_ARAM_STREAM_MAX_BATCH; batch++) {
+                ok &= testWrite(numBuffers, size, NULL, batch);
+            }
+            ok &= testWrite(numBuffers, size, buffer, JKR_ARAM_STREAM_MAX_BATCH);
+        }
+    }
+    ok &= testMerge();
+    free(buffer);
+
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
+
+// The whole file as size byte pieces, batch at a time
+static void benchRun(u32 numBuffers, u32 batch, u32 size) {
+    JKRAramStreamCommand* list[MAX_BENCH_COMMANDS];
+    JSUFileInputStream stream((JKRFile*)&sSimFile);
+    double start;
+    double seconds;
+    u32 numCommands;
+    u32 pieces;
+    u32 reads;
+    u32 kbps;
+    OSTime wait;
+    u32 i;
+
+    numCommands = sSimFile.length / size;
+    for (i = 0; i < numCommands; i++) {
+        initCommand(&sBenchCommands[i], &stream, sAram + i * size, size, i * size, NULL, 0, &sBenchStats[i]);
+        list[i] = &sBenchCommands[i];
+    }
+
+    JKRAramStream::setTransBufferCount(numBuffers);
+    pieces = simGetNumPieces();
+    reads = simGetNumReads();
+    start = now();
+    for (i = 0; i < numCommands; i += batch) {
+        JKRAramStream::writeToAram(&list[i], numCommands - i < batch ? numCommands - i : batch);
+    }
+    seconds = now() - start;
+
+    kbps = 0;
+    wait = 0;
+    for (i = 0; i < numCommands; i++) {
+        kbps += JKRAramStream::getKBPerSecond(&sBenchStats[i]);
+        wait += sBenchStats[i].mWaitTime;
+    }
+    printf("%7lu %5lu %8.1f %6.2f %8lu %6lu %6lu %9.2f\n", numBuffers, batch, seconds * 1000.0,
+           sSimFile.length / seconds / (1024 * 1024), kbps / numCommands, simGetNumPieces() - pieces,
+           simGetNumReads() - reads, (double)OSTicksToMicroseconds(wait) / 1000.0);
+    if (memcmp(AREmuGetARAM() + sAram, sFile, sSimFile.length) != 0) {
+        printf("FAIL: ARAM data\n");
+    }
+}
+
+static int bench(u32 size, u32 fileSize) {
+    static const u32 configs[][2] = {{1, 1}, {2, 1}, {4, 1}, {2, 4}, {4, 4}};
+    u32 i;
+
+    if (fileSize / size > MAX_BENCH_COMMANDS) {
+        fprintf(stderr, "more than %d commands\n", MAX_BENCH_COMMANDS);
+        return 2;
+    }
+    sSimFile.length = fileSize / size * size;
+    simSetDisc(3.0 * 1024 * 1024, 100.0);
+
+    printf("DVD 3.0 MB/s + 100 us per read, ARAM DMA 80.0 MB/s, %lu KB in %lu KB pieces, 32 KB transfer buffer\n",
+           sSimFile.length / 1024, size / 1024);
+    printf("buffers batch       ms   MB/s cmd KB/s    ARQ  reads DMA wait ms\n");
+    for (i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        benchRun(configs[i][0], configs[i][1], size);
+    }
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: jkrstream test\n"
+                    "       jkrstream bench [KB per command] [file MB]\n");
+}
+
+int main(int argc, char** argv) {
+    static u32 stack[4];
+    AREmuConfig config;
+    u32 size;
+    u32 fileSize;
+    u32 i;
+    int result;
+
+    if (argc < 2 || (strcmp(argv[1], "test") != 0 && strcmp(argv[1], "bench") != 0)) {
+        usage();
+        return 2;
+    }
+    size = (argc > 2 ? (u32)atoi(argv[2]) : 64) * 1024;
+    fileSize = (argc > 3 ? (u32)atoi(argv[3]) : 2) * 1024 * 1024;
+    if (size == 0 || fileSize < size || fileSize > AREMU_ARAM_SIZE / 2) {
+        usage();
+        return 2;
+    }
+
+    config.bytesPerSecond = 80.0 * 1024 * 1024;
+    config.latencyUs = 2.0;
+    AREmuInit(&config);
+    ARInit(stack, 4);
+    ARQInit();
+    sAram = ARAlloc(AREMU_ARAM_SIZE / 2);
+
+    sFile = (u8*)malloc(fileSize > TEST_FILE_SIZE ? fileSize : TEST_FILE_SIZE);
+    srand(1);
+    for (i = 0; i < (fileSize > TEST_FILE_SIZE ? fileSize : TEST_FILE_SIZE); i++) {
+        sFile[i] = (u8)rand();
+    }
+    sSimFile.data = sFile;
+    sSimFile.length = TEST_FILE_SIZE;
+
+    if (strcmp(argv[1], "test") == 0) {
+        result = test();
+    } else {
+        result = bench(size, fileSize);
+    }
+
+    AREmuShutdown();
+    free(sFile);
+    return result;
+}
@@ -0,0 +1,283 @@
+// The parts of JKernel, JSupport and the OS that JKRAramStream.cpp and JKRAramHeap.cpp call and that aren't in
+// ../aramemu or OSMessage.c: JKRAramPiece on top of ARQ, heaps that are malloc, threads that are never started, JSU
+// lists, and a JSUFileInputStream reading from the simulated disc in jkrstream.h.
+
+#include "jkrstream.h"
+#include "JSystem/JKernel/JKRAramPiece.h"
+#include "JSystem/JKernel/JKRAramStream.h"
+#include "JSystem/JSupport/JSUFileStream.h"
+#include "dolphin/os.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double sDiscBytesPerSecond = 3.0 * 1024 * 1024;
+static double sDiscLatencyUs = 100.0;
+static u32 sNumReads;
+static u32 sNumPieces;
+static u32 sNumAllocs;
+static u32 sNumFrees;
+static u32 sSystemHeapStorage[0x80];
+
+void simSetDisc(double bytesPerSecond, double latencyUs) {
+    sDiscBytesPerSecond = bytesPerSecond;
+    sDiscLatencyUs = latencyUs;
+}
+
+u32 simGetNumReads(void) { return sNumReads; }
+
+u32 simGetNumPieces(void) { return sNumPieces; }
+
+u32 simGetNumAllocs(void) { return sNumAllocs; }
+
+u32 simGetNumFrees(void) { return sNumFrees; }
+
+extern "C" {
+void OSPanic(const char* file, int line, const char* msg, ...) {
+    va_list args;
+
+    fprintf(stderr, "%s:%d: ", file, line);
+    va_start(args, msg);
+    vfprintf(stderr, msg, args);
+    va_end(args);
+    abort();
+}
+
+s32 OSResumeThread(OSThread* thread) { return 0; }
+
+// The heaps are only used from one thread
+void OSInitMutex(OSMutex* mutex) {}
+void OSLockMutex(OSMutex* mutex) {}
+void OSUnlockMutex(OSMutex* mutex) {}
+
+// The emulated DMA reads and writes host memory directly, there is no cache to keep coherent
+void DCInvalidateRange(void* addr, u32 nBytes) {}
+}
+
+// JKRAramPiece, as in JKernel: each command is an ARQ request whose callback posts to the command's own queue
+
+JKRAMCommand* JKRAramPiece::orderAsync(int direction, u32 source, u32 destination, u32 length, JKRAramBlock* block,
+                                       JKRAMCommand::AsyncCallback callback) {
+    JKRAMCommand* command = (JKRAMCommand*)calloc(1, sizeof(JKRAMCommand));
+
+    command->mTransferDirection = direction;
+    command->mSrc = source;
+    command->mDst = destination;
+    command->mDataLength = length;
+    OSInitMessageQueue(&command->mMessageQueue, &command->mMessage, 1);
+    sNumPieces++;
+    ARQPostRequest(&command->mRequest, 0, direction, ARQ_PRIORITY_LOW, source, destination, length, doneDMA);
+    return command;
+}
+
+void JKRAramPiece::doneDMA(u32 requestAddress) {
+    JKRAMCommand* command = (JKRAMCommand*)requestAddress;
+
+    OSSendMessage(&command->mMessageQueue, (OSMessage)command, OS_MESSAGE_NOBLOCK);
+}
+
+BOOL JKRAramPiece::orderSync(int direction, u32 source, u32 destination, u32 length, JKRAramBlock* block) {
+    return sync(orderAsync(direction, source, destination, length, block, NULL), 0);
+}
+
+BOOL JKRAramPiece::sync(JKRAMCommand* command, int isNonBlocking) {
+    OSMessage message;
+
+    if (!OSReceiveMessage(&command->mMessageQueue, &message, isNonBlocking ? OS_MESSAGE_NOBLOCK : OS_MESSAGE_BLOCK)) {
+        return false;
+    }
+    free(command);
+    return true;
+}
+
+// Heaps
+
+JKRHeap* JKRHeap::sSystemHeap = (JKRHeap*)sSystemHeapStorage;
+JKRHeap* JKRHeap::sCurrentHeap = (JKRHeap*)sSystemHeapStorage;
+
+void* JKRHeap::alloc(u32 size, int alignment) {
+    sNumAllocs++;
+    if (alignment < 0) {
+        alignment = -alignment;
+    }
+    // 0 means the heap's default, as in the JKRHeaps
+    return aligned_alloc(alignment > 0x20 ? alignment : 0x20, ALIGN_NEXT(size, 0x20));
+}
+
+void* JKRHeap::alloc(u32 size, int alignment, JKRHeap* heap) {
+    return (heap != NULL ? heap : sCurrentHeap)->alloc(size, alignment);
+}
+
+void JKRHeap::free(void* ptr, JKRHeap* heap) {
+    sNumFrees++;
+    ::free(ptr);
+}
+
+JKRHeap* JKRHeap::findFromRoot(void* ptr) { return sSystemHeap; }
+
+void* operator new(size_t size, JKRHeap* heap, int alignment) { return JKRHeap::alloc(size, alignment, heap); }
+
+// Plain new and delete stay malloc and free, so the counts above are only the JKRHeap calls; delete also has to
+// take the blocks JKRAramHeap news from its heap
+void* operator new(size_t size) { return malloc(size); }
+
+void operator delete(void* ptr) { ::free(ptr); }
+
+// Lists
+
+JSUPtrLink::JSUPtrLink(void* object) {
+    mList = NULL;
+    mObject = object;
+    mPrev = NULL;
+    mNext = NULL;
+}
+
+JSUPtrLink::~JSUPtrLink() {
+    if (mList != NULL) {
+        mList->remove(this);
+    }
+}
+
+JSUPtrList::~JSUPtrList() {
+    while (mHead != NULL) {
+        remove(mHead);
+    }
+}
+
+void JSUPtrList::initiate() {
+    mHead = NULL;
+    mTail = NULL;
+    mLength = 0;
+}
+
+bool JSUPtrList::append(JSUPtrLink* ptr) { return insert(NULL, ptr); }
+
+// before NULL appends
+bool JSUPtrList::insert(JSUPtrLink* before, JSUPtrLink* ptr) {
+    if (before != NULL && before->mList != this) {
+        return false;
+    }
+    if (ptr->mList != NULL) {
+        ptr->mList->remove(ptr);
+    }
+    ptr->mList = this;
+    ptr->mNext = before;
+    ptr->mPrev = before != NULL ? before->mPrev : mTail;
+    if (ptr->mPrev != NULL) {
+        ptr->mPrev->mNext = ptr;
+    } else {
+        mHead = ptr;
+    }
+    if (before != NULL) {
+        before->mPrev = ptr;
+    } else {
+        mTail = ptr;
+    }
+    mLength++;
+    return true;
+}
+
+bool JSUPtrList::remove(JSUPtrLink* ptr) {
+    if (ptr->mList != this) {
+        return false;
+    }
+    if (ptr->mPrev != NULL) {
+        ptr->mPrev->mNext = ptr->mNext;
+    } else {
+        mHead = ptr->mNext;
+    }
+    if (ptr->mNext != NULL) {
+        ptr->mNext->mPrev = ptr->mPrev;
+    } else {
+        mTail = ptr->mPrev;
+    }
+    ptr->mList = NULL;
+    ptr->mPrev = NULL;
+    ptr->mNext = NULL;
+    mLength--;
+    return true;
+}
+
+// Threads, for JKRAramStream's constructor; the tool calls writeToAram itself
+
+JKRDisposer::JKRDisposer() : mLink(this) { mHeap = NULL; }
+
+JKRDisposer::~JKRDisposer() {}
+
+JKRThread::JKRThread(u32 stack_size, int message_count, int param_3) : mThreadListLink(this) {
+    OSPanic(__FILE__, __LINE__, "no threads on the host\n");
+}
+
+JKRThread::~JKRThread() {}
+
+// Streams
+
+JSUInputStream::~JSUInputStream() {}
+
+s32 JSUInputStream::read(void* buffer, s32 length) {
+    s32 result = readData(buffer, length);
+
+    if (result != length) {
+        setState(IOS_STATE_1);
+    }
+    return result;
+}
+
+s32 JSUInputStream::skip(s32 length) { return 0; }
+
+s32 JSURandomInputStream::skip(s32 length) { return seekPos(length, JSUStreamSeekFrom_CUR); }
+
+s32 JSURandomInputStream::seek(s32 offset, JSUStreamSeekFrom from) {
+    s32 result = seekPos(offset, from);
+
+    clrState(IOS_STATE_1);
+    return result;
+}
+
+JSUFileInputStream::JSUFileInputStream(JKRFile* file) {
+    mFile = file;
+    mPosition = 0;
+}
+
+u32 JSUFileInputStream::readData(void* buffer, s32 length) {
+    const SimFile* file = (const SimFile*)mFile;
+    struct timespec wait;
+    double seconds;
+
+    if (length > getLength() - mPosition) {
+        length = getLength() - mPosition;
+    }
+    seconds = sDiscLatencyUs / 1e6 + length / sDiscBytesPerSecond;
+    wait.tv_sec = (time_t)seconds;
+    wait.tv_nsec = (long)((seconds - wait.tv_sec) * 1e9);
+    nanosleep(&wait, NULL);
+
+    memcpy(buffer, file->data + mPosition, length);
+    mPosition += length;
+    sNumReads++;
+    return length;
+}
+
+s32 JSUFileInputStream::seekPos(s32 offset, JSUStreamSeekFrom from) {
+    s32 old = mPosition;
+
+    switch (from) {
+    case JSUStreamSeekFrom_SET:
+        mPosition = offset;
+        break;
+    case JSUStreamSeekFrom_CUR:
+        mPosition += offset;
+        break;
+    case JSUStreamSeekFrom_END:
+        mPosition = getLength() - offset;
+        break;
+    }
+    return mPosition - old;
+}
+
+s32 JSUFileInputStream::getLength() const { return ((const SimFile*)mFile)->length; }
+
+s32 JSUFileInputStream::getPosition() const { return mPosition; }
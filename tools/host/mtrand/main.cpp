@@ -0,0 +1,228 @@
+#include "menu/mtrand.hpp"
+#include "mtsimd.h"
+#include "../common/test.h"
+
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define CHECK_COUNT 100000
+#define BENCH_BLOCK 4096
+
+typedef std::chrono::steady_clock Clock;
+
+static const char* sImplNames[] = {"scalar", "sse2", "avx2"};
+
+static void usage(void) {
+    fprintf(stderr, "usage: mtrand bench [millions]\n"
+                    "       mtrand test\n");
+}
+
+static u32 numImpls(void) { return MTHostHaveAVX2() ? 3 : 2; }
+
+// std::mt19937 loaded with the seeded state is the reference the rest is checked against
+static void referenceSequence(u32 seed, std::vector<uint32_t>& out) {
+    std::stringstream text;
+    std::mt19937 engine;
+    MTHostState state;
+    u32 i;
+
+    MTHostSeed(&state, seed);
+    for (i = 0; i < MT_N; i++) {
+        text << state.mt[i] << ' ';
+    }
+    text << MT_N;
+    text >> engine;
+
+    for (i = 0; i < out.size(); i++) {
+        out[i] = engine();
+    }
+}
+
+static bool checkSeed(u32 seed) {
+    std::vector<uint32_t> expected(CHECK_COUNT);
+    std::vector<uint32_t> actual(CHECK_COUNT);
+    std::vector<u32> batch(CHECK_COUNT);
+    MTHostState state;
+    u32 chunk;
+    u32 i;
+    u32 n;
+    bool ok;
+
+    ok = true;
+    referenceSequence(seed, expected);
+
+    // one at a time
+    sgenrand(seed);
+    for (i = 0; i < CHECK_COUNT; i++) {
+        actual[i] = genrand();
+    }
+    if (actual != expected) {
+        printf("seed %u: genrand sequence differs\n", seed);
+        ok = false;
+    }
+
+    // batches of awkward sizes, mixed with single calls
+    sgenrand(seed);
+    for (i = 0, n = 0; i < CHECK_COUNT; i += chunk, n++) {
+        chunk = (n * 389 + 1) % 1500;
+        if (chunk > CHECK_COUNT - i) {
+            chunk = CHECK_COUNT - i;
+        }
+        if (n % 3 == 0 && chunk != 0) {
+            batch[i] = genrand();
+            genrand_fill(&batch[i + 1], chunk - 1);
+        } else {
+            genrand_fill(&batch[i], chunk);
+        }
+    }
+    for (i = 0; i < CHECK_COUNT; i++) {
+        actual[i] = batch[i];
+    }
+    if (actual != expected) {
+        printf("seed %u: genrand_fill sequence differs\n", seed);
+        ok = false;
+    }
+
+    for (i = 0; i < numImpls(); i++) {
+        MTHostSeed(&state, seed);
+        MTHostFill(&state, actual.data(), 1000, (MTHostImpl)i);
+        MTHostFill(&state, &actual[1000], 7, (MTHostImpl)i);
+        MTHostFill(&state, &actual[1007], CHECK_COUNT - 1007, (MTHostImpl)i);
+        if (actual != expected) {
+            printf("seed %u: host %s sequence differs\n", seed, sImplNames[i]);
+            ok = false;
+        }
+    }
+
+    printf("seed %u: %s\n", seed, ok ? "matches MT19937" : "DIFFERS");
+    return ok;
+}
+
+// An unseeded generator has to give what sgenrand(MT_DEFAULT_SEED) does
+static bool checkUnseeded(void) {
+    u32 expected[8];
+    u32 i;
+    bool ok;
+
+    sgenrand(MT_DEFAULT_SEED);
+    genrand_fill(expected, 8);
+    mti = MT_N + 1;
+    ok = true;
+    for (i = 0; i < 8; i++) {
+        ok &= genrand() == expected[i];
+    }
+    printf("unseeded: %s\n", ok ? "seeds with 4357" : "WRONG");
+    return ok;
+}
+
+static int test(int, char**) {
+    static const u32 seeds[] = {MT_DEFAULT_SEED, 1, 0x12345678, 0xFFFFFFFF, 0};
+    u32 counts[6];
+    double sum;
+    f32 value;
+    s32 roll;
+    u32 i;
+    bool ok;
+
+    ok = checkUnseeded();
+    for (i = 0; i < sizeof(seeds) / sizeof(seeds[0]); i++) {
+        ok &= checkSeed(seeds[i]);
+    }
+
+    sgenrand(1);
+    memset(counts, 0, sizeof(counts));
+    sum = 0.0;
+    for (i = 0; i < 600000; i++) {
+        roll = genrand_range(1, 6);
+        ok &= roll >= 1 && roll <= 6;
+        counts[(roll - 1) % 6]++;
+        value = genrand_float();
+        ok &= value >= 0.0f && value < 1.0f;
+        sum += value;
+    }
+    printf("genrand_range(1, 6):");
+    for (i = 0; i < 6; i++) {
+        printf(" %u", counts[i]);
+        ok &= counts[i] > 99000 && counts[i] < 101000;
+    }
+    printf("\ngenrand_float mean %.4f\n", sum / 600000);
+    ok &= sum / 600000 > 0.499 && sum / 600000 < 0.501;
+    ok &= genrand_range(-3, -3) == -3 && genrand_range(0x7FFFFFF0, 0x7FFFFFFF) >= 0x7FFFFFF0;
+    for (i = 0; i < 1000; i++) {
+        roll = genrand_range(-0x7FFFFFFF - 1, 0x7FFFFFFE);
+        ok &= roll != 0x7FFFFFFF;
+        roll = genrand_range(-0x7FFFFFFF - 1, -0x7FFFFFFF);
+        ok &= roll == -0x7FFFFFFF - 1 || roll == -0x7FFFFFFF;
+        roll = genrand_range(0x7FFFFFFE, 0x7FFFFFFF);
+        ok &= roll == 0x7FFFFFFE || roll == 0x7FFFFFFF;
+        roll = genrand_range(-0x7FFFFFFF - 1, 0x7FFFFFFF);
+        ok &= roll >= -0x7FFFFFFF - 1 && roll <= 0x7FFFFFFF;
+    }
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static double rate(Clock::time_point start, u32 count) {
+    return count / std::chrono::duration<double>(Clock::now() - start).count() / 1e6;
+}
+
+static int bench(int argc, char** argv) {
+    std::vector<u32> batch(BENCH_BLOCK);
+    std::vector<uint32_t> block(BENCH_BLOCK);
+    Clock::time_point start;
+    MTHostState state;
+    u32 count;
+    u32 sink;
+    u32 i;
+    u32 k;
+
+    count = (argc > 2 ? (u32)atoi(argv[2]) : 100) * 1000000;
+    if (count == 0) {
+        count = BENCH_BLOCK;
+    }
+    count -= count % BENCH_BLOCK;
+
+    sink = 0;
+    sgenrand(MT_DEFAULT_SEED);
+    start = Clock::now();
+    for (i = 0; i < count; i++) {
+        sink ^= genrand();
+    }
+    printf("genrand           %8.1f M/s\n", rate(start, count));
+
+    sgenrand(MT_DEFAULT_SEED);
+    start = Clock::now();
+    for (i = 0; i < count; i += BENCH_BLOCK) {
+        genrand_fill(batch.data(), BENCH_BLOCK);
+        sink ^= batch[i % BENCH_BLOCK];
+    }
+    printf("genrand_fill      %8.1f M/s\n", rate(start, count));
+
+    for (i = 0; i < numImpls(); i++) {
+        MTHostSeed(&state, MT_DEFAULT_SEED);
+        start = Clock::now();
+        for (k = 0; k < count; k += BENCH_BLOCK) {
+            MTHostFill(&state, block.data(), BENCH_BLOCK, (MTHostImpl)i);
+            sink ^= block[k % BENCH_BLOCK];
+        }
+        printf("host fill %-7s %8.1f M/s\n", sImplNames[i], rate(start, count));
+    }
+
+    // printed so the loops can't be optimized away
+    printf("checksum %08x\n", sink);
+    return 0;
+}
+
+static const HostCommand sCommands[] = {
+    {"bench", bench},
+    {"test", test},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
@@ -0,0 +1,153 @@
+#include "mtsimd.h"
+
+#include <emmintrin.h>
+
+#define MTHOST_MATRIX_A 0x9908B0DFu
+#define MTHOST_UPPER_MASK 0x80000000u
+#define MTHOST_LOWER_MASK 0x7FFFFFFFu
+#define MTHOST_MASK_B 0x9D2C5680u
+#define MTHOST_MASK_C 0xEFC60000u
+
+static inline uint32_t MTHostTwist(uint32_t upper, uint32_t lower, uint32_t shifted) {
+    uint32_t y;
+
+    y = (upper & MTHOST_UPPER_MASK) | (lower & MTHOST_LOWER_MASK);
+    return shifted ^ (y >> 1) ^ (-(y & 1) & MTHOST_MATRIX_A);
+}
+
+static inline uint32_t MTHostTemper(uint32_t y) {
+    y ^= y >> 11;
+    y ^= (y << 7) & MTHOST_MASK_B;
+    y ^= (y << 15) & MTHOST_MASK_C;
+    y ^= y >> 18;
+    return y;
+}
+
+// Twists the words from kk up to end with vectors of four; returns where it stopped. A vector reads the four words
+// after each of its own, which it only overwrites after the loads, and words MTHOST_M ahead or MTHOST_N - MTHOST_M
+// behind, which are either untouched or written by an earlier vector.
+static inline int MTHostTwistSSE2(uint32_t* mt, int kk, int end, int offset) {
+    const __m128i upper = _mm_set1_epi32((int)MTHOST_UPPER_MASK);
+    const __m128i lower = _mm_set1_epi32((int)MTHOST_LOWER_MASK);
+    const __m128i matrix = _mm_set1_epi32((int)MTHOST_MATRIX_A);
+    __m128i y;
+    __m128i mag;
+
+    for (; kk + 4 <= end; kk += 4) {
+        y = _mm_or_si128(_mm_and_si128(_mm_loadu_si128((const __m128i*)&mt[kk]), upper),
+                         _mm_and_si128(_mm_loadu_si128((const __m128i*)&mt[kk + 1]), lower));
+        mag = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(y, 31), 31), matrix);
+        y = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128((const __m128i*)&mt[kk + offset]), _mm_srli_epi32(y, 1)),
+                          mag);
+        _mm_storeu_si128((__m128i*)&mt[kk], y);
+    }
+    return kk;
+}
+
+extern "C" {
+int MTHostHaveAVX2(void) { return __builtin_cpu_supports("avx2"); }
+
+void MTHostSeed(MTHostState* state, uint32_t seed) {
+    int i;
+
+    for (i = 0; i < MTHOST_N; i++) {
+        state->mt[i] = seed & 0xFFFF0000u;
+        seed = seed * 69069 + 1;
+        state->mt[i] |= seed >> 16;
+        seed = seed * 69069 + 1;
+    }
+    state->index = MTHOST_N;
+}
+
+void MTHostTwistScalar(uint32_t* mt, int kk, int end, int offset) {
+    for (; kk < end; kk++) {
+        mt[kk] = MTHostTwist(mt[kk], mt[kk + 1], mt[kk + offset]);
+    }
+}
+
+void MTHostLastWord(uint32_t* mt) { mt[MTHOST_N - 1] = MTHostTwist(mt[MTHOST_N - 1], mt[0], mt[MTHOST_M - 1]); }
+
+void MTHostNextStateScalar(uint32_t* mt) {
+    MTHostTwistScalar(mt, 0, MTHOST_N - MTHOST_M, MTHOST_M);
+    MTHostTwistScalar(mt, MTHOST_N - MTHOST_M, MTHOST_N - 1, MTHOST_M - MTHOST_N);
+    MTHostLastWord(mt);
+}
+
+void MTHostTemperScalar(const uint32_t* in, uint32_t* out, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        out[i] = MTHostTemper(in[i]);
+    }
+}
+
+void MTHostNextStateSSE2(uint32_t* mt) {
+    int kk;
+
+    kk = MTHostTwistSSE2(mt, 0, MTHOST_N - MTHOST_M, MTHOST_M);
+    MTHostTwistScalar(mt, kk, MTHOST_N - MTHOST_M, MTHOST_M);
+    kk = MTHostTwistSSE2(mt, MTHOST_N - MTHOST_M, MTHOST_N - 1, MTHOST_M - MTHOST_N);
+    MTHostTwistScalar(mt, kk, MTHOST_N - 1, MTHOST_M - MTHOST_N);
+    MTHostLastWord(mt);
+}
+
+void MTHostTemperSSE2(const uint32_t* in, uint32_t* out, size_t n) {
+    const __m128i b = _mm_set1_epi32((int)MTHOST_MASK_B);
+    const __m128i c = _mm_set1_epi32((int)MTHOST_MASK_C);
+    __m128i y;
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        y = _mm_loadu_si128((const __m128i*)&in[i]);
+        y = _mm_xor_si128(y, _mm_srli_epi32(y, 11));
+        y = _mm_xor_si128(y, _mm_and_si128(_mm_slli_epi32(y, 7), b));
+        y = _mm_xor_si128(y, _mm_and_si128(_mm_slli_epi32(y, 15), c));
+        y = _mm_xor_si128(y, _mm_srli_epi32(y, 18));
+        _mm_storeu_si128((__m128i*)&out[i], y);
+    }
+    MTHostTemperScalar(&in[i], &out[i], n - i);
+}
+
+// Tempers whatever is left of the current state before regenerating, so any mix of chunk sizes gives one sequence
+void MTHostFill(MTHostState* state, uint32_t* out, size_t n, MTHostImpl impl) {
+    size_t count;
+
+    while (n != 0) {
+        if (state->index >= MTHOST_N) {
+            switch (impl) {
+                case MTHOST_IMPL_AVX2:
+                    MTHostNextStateAVX2(state->mt);
+                    break;
+                case MTHOST_IMPL_SSE2:
+                    MTHostNextStateSSE2(state->mt);
+                    break;
+                default:
+                    MTHostNextStateScalar(state->mt);
+                    break;
+            }
+            state->index = 0;
+        }
+
+        count = MTHOST_N - state->index;
+        if (count > n) {
+            count = n;
+        }
+
+        switch (impl) {
+            case MTHOST_IMPL_AVX2:
+                MTHostTemperAVX2(&state->mt[state->index], out, count);
+                break;
+            case MTHOST_IMPL_SSE2:
+                MTHostTemperSSE2(&state->mt[state->index], out, count);
+                break;
+            default:
+                MTHostTemperScalar(&state->mt[state->index], out, count);
+                break;
+        }
+
+        state->index += count;
+        out += count;
+        n -= count;
+    }
+}
+}
@@ -0,0 +1,50 @@
+#ifndef MTSIMD_H
+#define MTSIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MT19937 in blocks for the host: the state is regenerated eight (AVX2) or four (SSE2) words at a time and
+// tempered in bulk, the way SFMT generates, but on the plain MT19937 recurrence, so the numbers are the same ones
+// genrand gives for the same sgenrand seed.
+
+#define MTHOST_N 624
+#define MTHOST_M 397
+
+typedef enum MTHostImpl {
+    MTHOST_IMPL_SCALAR,
+    MTHOST_IMPL_SSE2,
+    MTHOST_IMPL_AVX2,
+} MTHostImpl;
+
+typedef struct MTHostState {
+    uint32_t mt[MTHOST_N];
+    uint32_t index; // next word to temper, MTHOST_N when the state has to be regenerated
+} MTHostState;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int MTHostHaveAVX2(void);
+
+// Same seeding as sgenrand in src/menu/mtrand.cpp
+void MTHostSeed(MTHostState* state, uint32_t seed);
+void MTHostFill(MTHostState* state, uint32_t* out, size_t n, MTHostImpl impl);
+
+// Twists mt[kk] up to mt[end - 1] against the words offset away; the vector versions finish their tails with it
+void MTHostTwistScalar(uint32_t* mt, int kk, int end, int offset);
+void MTHostLastWord(uint32_t* mt);
+
+void MTHostNextStateScalar(uint32_t* mt);
+void MTHostTemperScalar(const uint32_t* in, uint32_t* out, size_t n);
+void MTHostNextStateSSE2(uint32_t* mt);
+void MTHostTemperSSE2(const uint32_t* in, uint32_t* out, size_t n);
+void MTHostNextStateAVX2(uint32_t* mt);
+void MTHostTemperAVX2(const uint32_t* in, uint32_t* out, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#include "mtsimd.h"
+
+#include <immintrin.h>
+
+// Eight-word versions of the SSE2 loops in mtsimd.cpp; the scalar and SSE2 code there does the tails
+
+__attribute__((target("avx2"))) static inline int MTHostTwistAVX2(uint32_t* mt, int kk, int end, int offset) {
+    const __m256i upper = _mm256_set1_epi32((int)0x80000000u);
+    const __m256i lower = _mm256_set1_epi32(0x7FFFFFFF);
+    const __m256i matrix = _mm256_set1_epi32((int)0x9908B0DFu);
+    __m256i y;
+    __m256i mag;
+
+    for (; kk + 8 <= end; kk += 8) {
+        y = _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256((const __m256i*)&mt[kk]), upper),
+                            _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&mt[kk + 1]), lower));
+        mag = _mm256_and_si256(_mm256_srai_epi32(_mm256_slli_epi32(y, 31), 31), matrix);
+        y = _mm256_xor_si256(
+            _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&mt[kk + offset]), _mm256_srli_epi32(y, 1)), mag);
+        _mm256_storeu_si256((__m256i*)&mt[kk], y);
+    }
+    return kk;
+}
+
+extern "C" {
+__attribute__((target("avx2"))) void MTHostNextStateAVX2(uint32_t* mt) {
+    int kk;
+
+    kk = MTHostTwistAVX2(mt, 0, MTHOST_N - MTHOST_M, MTHOST_M);
+    MTHostTwistScalar(mt, kk, MTHOST_N - MTHOST_M, MTHOST_M);
+    kk = MTHostTwistAVX2(mt, MTHOST_N - MTHOST_M, MTHOST_N - 1, MTHOST_M - MTHOST_N);
+    MTHostTwistScalar(mt, kk, MTHOST_N - 1, MTHOST_M - MTHOST_N);
+    MTHostLastWord(mt);
+}
+
+__attribute__((target("avx2"))) void MTHostTemperAVX2(const uint32_t* in, uint32_t* out, size_t n) {
+    const __m256i b = _mm256_set1_epi32((int)0x9D2C5680u);
+    const __m256i c = _mm256_set1_epi32((int)0xEFC60000u);
+    __m256i y;
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        y = _mm256_loadu_si256((const __m256i*)&in[i]);
+        y = _mm256_xor_si256(y, _mm256_srli_epi32(y, 11));
+        y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_slli_epi32(y, 7), b));
+        y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_slli_epi32(y, 15), c));
+        y = _mm256_xor_si256(y, _mm256_srli_epi32(y, 18));
+        _mm256_storeu_si256((__m256i*)&out[i], y);
+    }
+    MTHostTemperSSE2(&in[i], &out[i], n - i);
+}
+}
@@ -0,0 +1,238 @@
+// Host stub for the PAD record/replay layer (src/menu/padrecord.cpp). PADRead is replaced by a scripted player
+// moving through menus, so recordings can be made, written out, replayed and compared without a console.
+
+#include "menu/padRecord.hpp"
+#include "../common/file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define DEFAULT_FRAMES 36000 // ten minutes at 60 Hz
+#define RAW_FRAME_SIZE (PAD_MAX_CONTROLLERS * 12)
+
+typedef struct ScriptState {
+    u32 frame;
+    u32 seed;
+    u16 held;
+    u32 holdLeft;
+    u32 idleLeft;
+    s32 sweep;
+} ScriptState;
+
+// what PADRead returns
+static ScriptState sScript;
+
+static u32 scriptRandom(ScriptState* script, u32 range) {
+    script->seed = script->seed * 1103515245 + 12345;
+    return (script->seed >> 16) % range;
+}
+
+static void scriptReset(ScriptState* script, u32 seed) {
+    memset(script, 0, sizeof(ScriptState));
+    script->seed = seed;
+    script->idleLeft = 30;
+}
+
+// Channel 0 taps the D-pad, A and B with pauses in between and sometimes sweeps the stick; its stick rests with
+// a little jitter like a worn controller. Channel 1 sits idle, is unplugged for a while and comes back through
+// PAD_ERR_NOT_READY. Channels 2 and 3 are empty.
+static void scriptRead(ScriptState* script, PADStatus* status) {
+    static const u16 taps[] = {PAD_BUTTON_UP,   PAD_BUTTON_DOWN, PAD_BUTTON_LEFT, PAD_BUTTON_RIGHT,
+                               PAD_BUTTON_DOWN, PAD_BUTTON_A,    PAD_BUTTON_B,    PAD_BUTTON_START};
+    u32 frame;
+    s32 chan;
+
+    memset(status, 0, sizeof(PADStatus) * PAD_MAX_CONTROLLERS);
+    frame = script->frame++;
+
+    if (script->holdLeft != 0) {
+        script->holdLeft--;
+    } else if (script->idleLeft != 0) {
+        script->held = 0;
+        script->idleLeft--;
+    } else {
+        script->held = taps[scriptRandom(script, sizeof(taps) / sizeof(taps[0]))];
+        script->holdLeft = 3 + scriptRandom(script, 6);
+        script->idleLeft = 10 + scriptRandom(script, 50);
+        if (scriptRandom(script, 8) == 0) {
+            script->sweep = 60;
+        }
+    }
+
+    status[0].button = script->held;
+    status[0].analogA = (script->held & PAD_BUTTON_A) ? 0xFF : 0;
+    status[0].analogB = (script->held & PAD_BUTTON_B) ? 0xFF : 0;
+    if (script->sweep != 0) {
+        script->sweep--;
+        status[0].stickX = (s8)((60 - script->sweep) * 2);
+        status[0].triggerLeft = (u8)(script->sweep * 3);
+    } else if (scriptRandom(script, 16) == 0) {
+        status[0].stickX = (s8)(scriptRandom(script, 3) - 1);
+        status[0].stickY = (s8)(scriptRandom(script, 3) - 1);
+    }
+
+    if (frame % 20000 >= 12000 && frame % 20000 < 12600) {
+        status[1].err = PAD_ERR_NO_CONTROLLER;
+    } else if (frame % 20000 >= 12600 && frame % 20000 < 12603) {
+        status[1].err = PAD_ERR_NOT_READY;
+    }
+    for (chan = 2; chan < PAD_MAX_CONTROLLERS; chan++) {
+        status[chan].err = PAD_ERR_NO_CONTROLLER;
+    }
+}
+
+extern "C" u32 PADRead(PADStatus* status) {
+    scriptRead(&sScript, status);
+    return 0;
+}
+
+static bool sameStatus(const PADStatus* a, const PADStatus* b) {
+    s32 chan;
+
+    for (chan = 0; chan < PAD_MAX_CONTROLLERS; chan++) {
+        if (a[chan].button != b[chan].button || a[chan].stickX != b[chan].stickX ||
+            a[chan].stickY != b[chan].stickY || a[chan].substickX != b[chan].substickX ||
+            a[chan].substickY != b[chan].substickY || a[chan].triggerLeft != b[chan].triggerLeft ||
+            a[chan].triggerRight != b[chan].triggerRight || a[chan].analogA != b[chan].analogA ||
+            a[chan].analogB != b[chan].analogB || a[chan].err != b[chan].err) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static u32 record(std::vector<u8>& file, u32 numFrames, u32 seed) {
+    PADStatus status[PAD_MAX_CONTROLLERS];
+    PadRecorder recorder;
+    u32 i;
+
+    scriptReset(&sScript, seed);
+    prStartRecord(&recorder, file.data(), file.size());
+    for (i = 0; i < numFrames && recorder.state == PR_STATE_RECORDING; i++) {
+        prRead(&recorder, status);
+    }
+    file.resize(prFinishRecord(&recorder));
+    return recorder.numFrames;
+}
+
+// Replays file through prRead while PADRead runs the script with another seed underneath, and checks every frame
+// against the script run with the recording seed. Returns the number of frames that came out exactly as recorded.
+static u32 replay(const std::vector<u8>& file, u32 seed, bool* matched) {
+    PADStatus status[PAD_MAX_CONTROLLERS];
+    PADStatus expected[PAD_MAX_CONTROLLERS];
+    ScriptState script;
+    PadRecorder recorder;
+    u32 exact;
+
+    *matched = false;
+    if (!prStartReplay(&recorder, file.data(), file.size())) {
+        return 0;
+    }
+
+    scriptReset(&sScript, seed ^ 0x5A5A5A5A);
+    scriptReset(&script, seed);
+    exact = 0;
+    while (true) {
+        prRead(&recorder, status);
+        if (recorder.state != PR_STATE_REPLAYING) {
+            break;
+        }
+        scriptRead(&script, expected);
+        exact += sameStatus(status, expected) ? 1 : 0;
+    }
+
+    *matched = prReplayMatched(&recorder);
+    return exact;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: padrec record <out.pad> [frames] [seed]\n"
+                    "       padrec replay <in.pad>\n"
+                    "       padrec test\n");
+}
+
+int main(int argc, char** argv) {
+    std::vector<u8> file;
+    std::vector<u8> saved;
+    PadRecorder recorder;
+    PADStatus status[PAD_MAX_CONTROLLERS];
+    u32 numFrames;
+    u32 seed;
+    u32 exact;
+    u32 recorded;
+    u32 finished;
+    bool matched;
+    bool ok;
+
+    if (argc >= 3 && strcmp(argv[1], "record") == 0) {
+        numFrames = argc > 3 ? (u32)atoi(argv[3]) : DEFAULT_FRAMES;
+        seed = argc > 4 ? (u32)strtoul(argv[4], NULL, 0) : 1;
+        file.resize(PR_HEADER_SIZE + (numFrames + 1) * PR_MAX_FRAME_SIZE);
+        recorded = record(file, numFrames, seed);
+
+        if (!writeFile(argv[2], file)) {
+            fprintf(stderr, "can't write %s\n", argv[2]);
+            return 1;
+        }
+        printf("%u frames in %u bytes, %.2f bytes per frame (%d raw)\n", recorded, (u32)file.size(),
+               (f64)file.size() / recorded, RAW_FRAME_SIZE);
+        return 0;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "replay") == 0) {
+        if (!readFile(argv[2], file) || !prStartReplay(&recorder, file.data(), file.size())) {
+            fprintf(stderr, "%s isn't a PAD recording\n", argv[2]);
+            return 1;
+        }
+        scriptReset(&sScript, 0x5A5A5A5A);
+        while (recorder.state == PR_STATE_REPLAYING) {
+            prRead(&recorder, status);
+        }
+        matched = prReplayMatched(&recorder);
+        printf("%u frames replayed, %s\n", recorder.frame, matched ? "bit-exact" : "MISMATCH");
+        return matched ? 0 : 1;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "test") == 0) {
+        ok = true;
+
+        file.resize(PR_HEADER_SIZE + (DEFAULT_FRAMES + 1) * PR_MAX_FRAME_SIZE);
+        recorded = record(file, DEFAULT_FRAMES, 7);
+        exact = replay(file, 7, &matched);
+        printf("%u frames, %u bytes (%.2f per frame): %u replayed exactly, crc %s\n", recorded, (u32)file.size(),
+               (f64)file.size() / recorded, exact, matched ? "matches" : "DIFFERS");
+        ok &= recorded == DEFAULT_FRAMES && exact == recorded && matched;
+
+        // a full buffer ends the recording cleanly at a frame boundary
+        file.resize(2000);
+        recorded = record(file, DEFAULT_FRAMES, 7);
+        exact = replay(file, 7, &matched);
+        printf("2000 byte buffer: %u frames kept in %u bytes, %u replayed exactly, crc %s\n", recorded,
+               (u32)file.size(), exact, matched ? "matches" : "DIFFERS");
+        ok &= recorded < DEFAULT_FRAMES && exact == recorded && matched && file.size() <= 2000;
+
+        // a cut-off file doesn't pass
+        file.resize(file.size() - 5);
+        replay(file, 7, &matched);
+        printf("truncated recording %s\n", matched ? "ACCEPTED" : "rejected");
+        ok &= !matched;
+
+        // finishing after a replay must not write a header into the replayed buffer
+        recorded = record(file, 100, 7);
+        saved = file;
+        prStartReplay(&recorder, file.data(), file.size());
+        while (prReplayFrame(&recorder, status)) {
+        }
+        finished = prFinishRecord(&recorder);
+        printf("prFinishRecord after replay: %s\n", finished == 0 && file == saved ? "ignored" : "WROTE");
+        ok &= finished == 0 && file == saved;
+
+        printf("%s\n", ok ? "ok" : "FAILED");
+        return ok ? 0 : 1;
+    }
+
+    usage();
+    return 1;
+}
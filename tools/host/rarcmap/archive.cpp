@@ -0,0 +1,132 @@
+// The JKRArchive side of rarcmap: an archive over a RARC image that stays where it is, like
+// JKRMemArchive::open(void*, u32, JKRMemBreakFlag) has it. The directory and file tables are big-endian, and the
+// host's SDIFileEntry is wider than the console's, so those two are converted into one block from the heap; the
+// string table is used in place. Lookups are the real ones in JKRArchivePri.cpp, through the index. The JKernel
+// stubs are jkrarc/stubs.cpp.
+
+#include "rarc.h"
+#include "JSystem/JKernel/JKRArchive.h"
+#include "JSystem/JKernel/JKRHeap.h"
+
+#include <string.h>
+
+class MappedArchive : public JKRArchive {
+  public:
+    MappedArchive() : JKRArchive(0, MOUNT_MEM) {
+        mArcInfoBlock = NULL;
+        mExpandedSize = NULL;
+        mMountDirection = MOUNT_DIRECTION_HEAD;
+    }
+
+    virtual ~MappedArchive() {
+        if (mArcInfoBlock != NULL) {
+            JKRFreeToHeap(mHeap, mArcInfoBlock);
+        }
+    }
+
+    bool open(u8* image, u32 size);
+
+    virtual void* fetchResource(SDIFileEntry*, u32*) { return NULL; }
+    virtual void* fetchResource(void*, u32, SDIFileEntry*, u32*) { return NULL; }
+};
+
+static bool isInImage(u32 imageSize, u64 offset, u64 size) { return offset + size <= imageSize; }
+
+// false if image isn't an archive, or its tables run off its end or point outside themselves
+bool MappedArchive::open(u8* image, u32 size) {
+    u8* info;
+    u8* node;
+    u8* file;
+    u32 infoOffset;
+    u32 numNodes;
+    u32 numFiles;
+    u32 stringsSize;
+    u32 i;
+
+    if (size < RARC_HEADER_SIZE + RARC_INFO_SIZE || memcmp(image, "RARC", 4) != 0) {
+        return false;
+    }
+    infoOffset = read_big_endian_u32(image + 0x08);
+    if (!isInImage(size, infoOffset, RARC_INFO_SIZE)) {
+        return false;
+    }
+    info = image + infoOffset;
+    numNodes = read_big_endian_u32(info + 0x00);
+    numFiles = read_big_endian_u32(info + 0x08);
+    stringsSize = read_big_endian_u32(info + 0x10);
+    if (numNodes == 0 || stringsSize == 0 ||
+        !isInImage(size, (u64)infoOffset + read_big_endian_u32(info + 0x04), (u64)numNodes * RARC_NODE_SIZE) ||
+        !isInImage(size, (u64)infoOffset + read_big_endian_u32(info + 0x0C), (u64)numFiles * RARC_FILE_SIZE) ||
+        !isInImage(size, (u64)infoOffset + read_big_endian_u32(info + 0x14), stringsSize) ||
+        !isInImage(size, (u64)infoOffset + read_big_endian_u32(image + 0x0C), 0)) {
+        return false;
+    }
+
+    mArcInfoBlock = (SArcDataInfo*)JKRAllocFromHeap(
+        mHeap, sizeof(SArcDataInfo) + numNodes * sizeof(SDIDirEntry) + numFiles * sizeof(SDIFileEntry), 4);
+    if (mArcInfoBlock == NULL) {
+        return false;
+    }
+    mArcInfoBlock->num_nodes = numNodes;
+    mArcInfoBlock->node_offset = read_big_endian_u32(info + 0x04);
+    mArcInfoBlock->num_file_entries = numFiles;
+    mArcInfoBlock->file_entry_offset = read_big_endian_u32(info + 0x0C);
+    mArcInfoBlock->string_table_length = stringsSize;
+    mArcInfoBlock->string_table_offset = read_big_endian_u32(info + 0x14);
+    mArcInfoBlock->next_free_file_id = read_big_endian_u16(info + 0x18);
+    mArcInfoBlock->sync_file_ids_and_indices = info[0x1A] != 0;
+    mNodes = (SDIDirEntry*)(mArcInfoBlock + 1);
+    mFiles = (SDIFileEntry*)(mNodes + numNodes);
+    mStringTable = (char*)info + mArcInfoBlock->string_table_offset;
+
+    // every name ends inside the string table
+    if (mStringTable[stringsSize - 1] != '\0') {
+        return false;
+    }
+
+    node = info + mArcInfoBlock->node_offset;
+    for (i = 0; i < numNodes; i++, node += RARC_NODE_SIZE) {
+        mNodes[i].type = read_big_endian_u32(node + 0x00);
+        mNodes[i].name_offset = read_big_endian_u32(node + 0x04);
+        mNodes[i].field_0x8 = read_big_endian_u16(node + 0x08);
+        mNodes[i].num_entries = read_big_endian_u16(node + 0x0A);
+        mNodes[i].first_file_index = read_big_endian_u32(node + 0x0C);
+        if (mNodes[i].name_offset >= stringsSize ||
+            (u64)mNodes[i].first_file_index + mNodes[i].num_entries > numFiles) {
+            return false;
+        }
+    }
+
+    // a directory's data_offset is its node; the root's ".." has none
+    file = info + mArcInfoBlock->file_entry_offset;
+    for (i = 0; i < numFiles; i++, file += RARC_FILE_SIZE) {
+        mFiles[i].file_id = read_big_endian_u16(file + 0x00);
+        mFiles[i].name_hash = read_big_endian_u16(file + 0x02);
+        mFiles[i].type_flags_and_name_offset = read_big_endian_u32(file + 0x04);
+        mFiles[i].data_offset = read_big_endian_u32(file + 0x08);
+        mFiles[i].data_size = read_big_endian_u32(file + 0x0C);
+        mFiles[i].data = NULL;
+        if (mFiles[i].getNameOffset() >= stringsSize ||
+            (mFiles[i].isDirectory() && mFiles[i].data_offset >= numNodes && mFiles[i].data_offset != 0xFFFFFFFF)) {
+            return false;
+        }
+    }
+
+    mIsMounted = true;
+    createIndex();
+    return true;
+}
+
+// The archive over image, which has to stay valid until rarcCloseArchive, or NULL
+JKRArchive* rarcOpenArchive(const u8* image, u32 size) {
+    MappedArchive* archive;
+
+    archive = new MappedArchive();
+    if (!archive->open((u8*)image, size)) {
+        delete archive;
+        return NULL;
+    }
+    return archive;
+}
+
+void rarcCloseArchive(JKRArchive* archive) { delete (MappedArchive*)archive; }
@@ -0,0 +1,673 @@
+// Browses RARC archives through the mapped mount, and checks and measures it on generated archives: every resource
+// and path against what was written, Yaz0/Yay0 entries and whole-archive SZS files included, and memory use when
+// walking an archive that is read into the heap first versus mapped.
+
+#include "rarcmap.h"
+#include "../common/file.h"
+#include "../common/test.h"
+#include "../yaz0enc/yaz0enc.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+u32 simNumLiveBlocks(void);
+
+// A file of the generated archive. Its contents come from its seed, so big archives never have to be in memory.
+typedef struct GenFile {
+    u32 dir;
+    std::string name;
+    u32 size;
+    u32 seed;
+    u32 compression; // 0, 'z' or 'y'
+    std::vector<u8> packed;
+    u32 index; // in the file entry table
+} GenFile;
+
+static const char* sDirNames[] = {"timg", "bmd", "bck", "scrn", "dat", "snd"};
+
+// Mostly repeats with the odd change for the compressed files, noise for the others
+static void genContents(const GenFile& file, u8* out) {
+    u32 state;
+    u32 i;
+
+    state = file.seed;
+    for (i = 0; i < file.size; i++) {
+        state = state * 1103515245 + 12345;
+        if (file.compression == 0) {
+            out[i] = state >> 16;
+        } else {
+            out[i] = i >= 32 && (state >> 16) % 8 != 0 ? out[i - 32] : "abcdefgh"[(state >> 20) % 8];
+        }
+    }
+}
+
+static u16 hashName(const char* name) {
+    u16 hash;
+
+    for (hash = 0; *name != '\0'; name++) {
+        hash = *name + hash * 3;
+    }
+    return hash;
+}
+
+static u32 addString(std::vector<u8>& strings, const char* string) {
+    u32 offset;
+
+    offset = strings.size();
+    strings.insert(strings.end(), string, string + strlen(string) + 1);
+    return offset;
+}
+
+static void putEntry(std::vector<u8>& entries, u32 id, const char* name, u32 nameOffset, u32 attr, u32 offset,
+                     u32 size) {
+    u8 entry[RARC_FILE_SIZE];
+
+    memset(entry, 0, sizeof(entry));
+    host_put_be16(entry + 0x00, id);
+    host_put_be16(entry + 0x02, hashName(name));
+    host_put_be32(entry + 0x04, attr << 24 | nameOffset);
+    host_put_be32(entry + 0x08, offset);
+    host_put_be32(entry + 0x0C, size);
+    entries.insert(entries.end(), entry, entry + sizeof(entry));
+}
+
+static bool writeAll(FILE* out, const void* data, size_t size) { return fwrite(data, 1, size, out) == size; }
+
+// The layout Nintendo's tools write: header, info block, nodes, file entries and strings each 32-byte aligned,
+// then the file data with every file 32-byte aligned. The root holds one directory per sDirNames entry.
+static bool writeArchive(FILE* out, std::vector<GenFile>& files) {
+    static const u8 zeros[0x20] = {0};
+    std::vector<u8> nodes;
+    std::vector<u8> entries;
+    std::vector<u8> strings;
+    std::vector<u8> contents;
+    u8 header[RARC_HEADER_SIZE + RARC_INFO_SIZE];
+    u32 dirNames[sizeof(sDirNames) / sizeof(sDirNames[0])];
+    u32 numDirs;
+    u32 numInDir;
+    u32 numNodes;
+    u32 numEntries;
+    u32 dataOffset;
+    u32 dataSize;
+    u32 nodesOffset;
+    u32 entriesOffset;
+    u32 stringsOffset;
+    u32 filesOffset;
+    u32 nameOffset;
+    u32 size;
+    u32 d;
+    u32 i;
+    u8 node[RARC_NODE_SIZE];
+
+    numDirs = sizeof(sDirNames) / sizeof(sDirNames[0]);
+    addString(strings, ".");
+    addString(strings, "..");
+
+    // the root's entries, then each directory's
+    memset(node, 0, sizeof(node));
+    host_put_be32(node + 0x00, 'R' << 24 | 'O' << 16 | 'O' << 8 | 'T');
+    host_put_be32(node + 0x04, addString(strings, "archive"));
+    host_put_be16(node + 0x08, hashName("archive"));
+    host_put_be16(node + 0x0A, numDirs + 2);
+    host_put_be32(node + 0x0C, 0);
+    nodes.insert(nodes.end(), node, node + sizeof(node));
+    for (d = 0; d < numDirs; d++) {
+        dirNames[d] = addString(strings, sDirNames[d]);
+        putEntry(entries, 0xFFFF, sDirNames[d], dirNames[d], RARC_ATTR_DIRECTORY, d + 1, RARC_NODE_SIZE);
+    }
+    putEntry(entries, 0xFFFF, ".", 0, RARC_ATTR_DIRECTORY, 0, RARC_NODE_SIZE);
+    putEntry(entries, 0xFFFF, "..", 2, RARC_ATTR_DIRECTORY, 0xFFFFFFFF, RARC_NODE_SIZE);
+
+    dataSize = 0;
+    for (d = 0; d < numDirs; d++) {
+        memset(node, 0, sizeof(node));
+        for (i = 0; i < 4; i++) {
+            node[i] = i < strlen(sDirNames[d]) ? sDirNames[d][i] - 'a' + 'A' : ' ';
+        }
+        host_put_be32(node + 0x04, dirNames[d]);
+        host_put_be16(node + 0x08, hashName(sDirNames[d]));
+        host_put_be32(node + 0x0C, entries.size() / RARC_FILE_SIZE);
+
+        numInDir = 0;
+        for (i = 0; i < files.size(); i++) {
+            GenFile& file = files[i];
+            if (file.dir != d) {
+                continue;
+            }
+            size = file.compression != 0 ? file.packed.size() : file.size;
+            file.index = entries.size() / RARC_FILE_SIZE;
+            nameOffset = addString(strings, file.name.c_str());
+            putEntry(entries, file.index, file.name.c_str(), nameOffset,
+                     RARC_ATTR_FILE | (file.compression != 0 ? RARC_ATTR_COMPRESSED : 0) |
+                         (file.compression == 'z' ? RARC_ATTR_YAZ0 : 0),
+                     dataSize, size);
+            dataSize += ALIGN_NEXT(size, 0x20);
+            numInDir++;
+        }
+        putEntry(entries, 0xFFFF, ".", 0, RARC_ATTR_DIRECTORY, d + 1, RARC_NODE_SIZE);
+        putEntry(entries, 0xFFFF, "..", 2, RARC_ATTR_DIRECTORY, 0, RARC_NODE_SIZE);
+        host_put_be16(node + 0x0A, numInDir + 2);
+        nodes.insert(nodes.end(), node, node + sizeof(node));
+    }
+    numNodes = nodes.size() / RARC_NODE_SIZE;
+    numEntries = entries.size() / RARC_FILE_SIZE;
+    nodes.resize(ALIGN_NEXT(nodes.size(), 0x20));
+    entries.resize(ALIGN_NEXT(entries.size(), 0x20));
+    strings.resize(ALIGN_NEXT(strings.size(), 0x20));
+    nodesOffset = RARC_INFO_SIZE;
+    entriesOffset = nodesOffset + nodes.size();
+    stringsOffset = entriesOffset + entries.size();
+    filesOffset = stringsOffset + strings.size();
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, "RARC", 4);
+    host_put_be32(header + 0x04, RARC_HEADER_SIZE + filesOffset + dataSize);
+    host_put_be32(header + 0x08, RARC_HEADER_SIZE);
+    host_put_be32(header + 0x0C, filesOffset);
+    host_put_be32(header + 0x10, dataSize);
+    host_put_be32(header + 0x14, dataSize);
+    host_put_be32(header + 0x20, numNodes);
+    host_put_be32(header + 0x24, nodesOffset);
+    host_put_be32(header + 0x28, numEntries);
+    host_put_be32(header + 0x2C, entriesOffset);
+    host_put_be32(header + 0x30, strings.size());
+    host_put_be32(header + 0x34, stringsOffset);
+    host_put_be16(header + 0x38, numEntries);
+    header[0x3A] = 1;
+
+    if (!writeAll(out, header, sizeof(header)) || !writeAll(out, nodes.data(), nodes.size()) ||
+        !writeAll(out, entries.data(), entries.size()) || !writeAll(out, strings.data(), strings.size())) {
+        return false;
+    }
+
+    // data in directory order, as the entries have it
+    dataOffset = 0;
+    for (d = 0; d < numDirs; d++) {
+        for (i = 0; i < files.size(); i++) {
+            const GenFile& file = files[i];
+            if (file.dir != d) {
+                continue;
+            }
+            if (file.compression != 0) {
+                size = file.packed.size();
+                if (!writeAll(out, file.packed.data(), size)) {
+                    return false;
+                }
+            } else {
+                size = file.size;
+                contents.resize(size);
+                genContents(file, contents.data());
+                if (!writeAll(out, contents.data(), size)) {
+                    return false;
+                }
+            }
+            if (!writeAll(out, zeros, ALIGN_NEXT(size, 0x20) - size)) {
+                return false;
+            }
+            dataOffset += ALIGN_NEXT(size, 0x20);
+        }
+    }
+    return dataOffset == dataSize;
+}
+
+static void packFile(GenFile& file) {
+    std::vector<u8> contents;
+    Yaz0Options options;
+
+    if (file.compression == 0) {
+        return;
+    }
+    contents.resize(file.size);
+    genContents(file, contents.data());
+    yaz0DefaultOptions(&options);
+    options.level = YAZ0_LEVEL_GREEDY;
+    options.numThreads = 1;
+    options.format = file.compression == 'z' ? YAZ0_FORMAT_SZS : YAZ0_FORMAT_SZP;
+    yaz0Encode(contents.data(), contents.size(), &options, file.packed);
+}
+
+// numFiles files of up to maxSize bytes spread over the directories; every fourth one is Yaz0 and every eighth Yay0
+static void makeFiles(std::vector<GenFile>& files, u32 numFiles, u32 maxSize, bool compress) {
+    GenFile file;
+    char name[64];
+    u32 i;
+
+    seedRandom32(1);
+    files.clear();
+    for (i = 0; i < numFiles; i++) {
+        file.dir = random32() % (sizeof(sDirNames) / sizeof(sDirNames[0]));
+        sprintf(name, "res_%05u.%s", (unsigned)i, sDirNames[file.dir]);
+        file.name = name;
+        file.size = i % 5 == 0 ? random32() % 64 : maxSize / 2 + random32() % (maxSize / 2);
+        file.seed = random32();
+        file.compression = !compress ? 0 : i % 4 == 1 ? 'z' : i % 8 == 2 ? 'y' : 0;
+        file.packed.clear();
+        packFile(file);
+        files.push_back(file);
+    }
+    // the archive's last file compressed, so some data ends right at the end of the file
+    if (compress && !files.empty()) {
+        files.back().dir = sizeof(sDirNames) / sizeof(sDirNames[0]) - 1;
+        files.back().compression = 'z';
+        files.back().size = maxSize;
+        packFile(files.back());
+    }
+}
+
+static std::string pathOf(const GenFile& file) { return std::string(sDirNames[file.dir]) + "/" + file.name; }
+
+// Every file by path, through the cache, against what was written
+static bool checkArchive(RarcArchive* archive, const std::vector<GenFile>& files) {
+    std::vector<u8> expected;
+    std::string path;
+    const u8* data;
+    u32 index;
+    u32 size;
+    u32 i;
+
+    for (i = 0; i < files.size(); i++) {
+        path = pathOf(files[i]);
+        for (size_t c = 0; c < path.size(); c += 3) {
+            path[c] = toupper(path[c]); // CArcName lowers what is looked up
+        }
+        index = rarcFindFsResource(archive, path.c_str());
+        if (index != files[i].index) {
+            printf("  %s: found at %lu, not %lu\n", path.c_str(), (unsigned long)index, (unsigned long)files[i].index);
+            return false;
+        }
+        data = rarcGetResource(archive, index, &size);
+        expected.resize(files[i].size);
+        genContents(files[i], expected.data());
+        if (data == NULL || size != files[i].size || (size != 0 && memcmp(data, expected.data(), size) != 0)) {
+            printf("  %s: wrong contents\n", path.c_str());
+            return false;
+        }
+        rarcRemoveResource(archive, data);
+    }
+
+    return rarcFindFsResource(archive, "timg/missing.timg") == RARC_NONE &&
+           rarcFindFsResource(archive, "timg") == RARC_NONE &&
+           rarcFindFsResource(archive, "nowhere/x") == RARC_NONE &&
+           rarcFindFsResource(archive, (pathOf(files[0]) + "/x").c_str()) == RARC_NONE &&
+           rarcFindFsResource(archive, (std::string("timg/../") + pathOf(files[0])).c_str()) == files[0].index;
+}
+
+static bool testCache(const std::vector<GenFile>& files, const char* path) {
+    RarcArchive archive;
+    RarcStats stats;
+    const u8* pinned;
+    const u8* data;
+    u32 pinnedIndex;
+    u32 cacheSize;
+    u32 size;
+    u32 i;
+    bool ok;
+
+    // room for about three files; one stays pinned across all the others
+    cacheSize = 3 * 0x2000;
+    if (!rarcMount(&archive, path, cacheSize)) {
+        return false;
+    }
+    pinnedIndex = RARC_NONE;
+    for (i = 0; i < files.size() && pinnedIndex == RARC_NONE; i++) {
+        if (files[i].compression != 0 && files[i].size > 0x100) {
+            pinnedIndex = files[i].index;
+        }
+    }
+    pinned = rarcGetResource(&archive, pinnedIndex, &size);
+    ok = pinned != NULL;
+    for (i = 0; ok && i < files.size(); i++) {
+        data = rarcGetResource(&archive, files[i].index, &size);
+        ok = data != NULL;
+        if (ok && files[i].index != pinnedIndex) {
+            rarcRemoveResource(&archive, data);
+        }
+        rarcGetStats(&archive, &stats);
+        ok &= stats.cacheBytes <= cacheSize + 0x2000; // the pinned one can be on top
+    }
+    data = rarcGetResource(&archive, pinnedIndex, &size);
+    ok &= data == pinned;
+    rarcRemoveResource(&archive, data);
+    rarcRemoveResource(&archive, pinned);
+    rarcRemoveResource(&archive, pinned);
+
+    rarcGetStats(&archive, &stats);
+    printf("  cache of %lu bytes: %lu decodes, %lu hits, %lu evictions, peak %llu bytes\n", (unsigned long)cacheSize,
+           (unsigned long)stats.numDecodes, (unsigned long)stats.numHits, (unsigned long)stats.numEvictions,
+           (unsigned long long)stats.peakCacheBytes);
+    ok &= stats.numEvictions != 0 && stats.numHits != 0 && stats.cacheBytes <= cacheSize;
+    rarcUnmount(&archive);
+    return ok;
+}
+
+static bool writeFileTo(const char* path, std::vector<GenFile>& files) {
+    FILE* out;
+    bool ok;
+
+    out = fopen(path, "wb");
+    if (out == NULL) {
+        return false;
+    }
+    ok = writeArchive(out, files);
+    return fclose(out) == 0 && ok;
+}
+
+static bool testCorrupt(const char* path, const std::vector<u8>& image) {
+    std::vector<u8> bad;
+    RarcArchive archive;
+    JKRArchive::SDIFileEntry* entry;
+    const u8* data;
+    u8* p;
+    u32 filesOffset;
+    u32 dataOffset;
+    u32 size;
+    u32 i;
+    bool ok;
+
+    bad.assign(image.begin(), image.begin() + 0x40);
+    ok = !rarcMountImage(&archive, bad.data(), bad.size(), 0);
+
+    // uncompressed entries pointing past the end, and compressed ones whose data claims far more than it holds
+    bad = image;
+    filesOffset = RARC_HEADER_SIZE + host_be32(bad.data() + 0x2C);
+    dataOffset = RARC_HEADER_SIZE + host_be32(bad.data() + 0x0C);
+    for (i = 0; i < host_be32(bad.data() + 0x28); i++) {
+        p = bad.data() + filesOffset + i * RARC_FILE_SIZE;
+        if (p[4] & RARC_ATTR_COMPRESSED) {
+            host_put_be32(bad.data() + dataOffset + host_be32(p + 0x08) + 4, 0x100000);
+        } else if (p[4] & RARC_ATTR_FILE) {
+            host_put_be32(p + 0x08, 0x7FFFFFF0);
+        }
+    }
+    ok &= rarcMountImage(&archive, bad.data(), bad.size(), 0x10000);
+    for (i = 0; ok && i < archive.archive->countFile(); i++) {
+        entry = archive.archive->findIdxResource(i);
+        if (!entry->isDirectory()) {
+            data = rarcGetResource(&archive, i, &size);
+            ok &= entry->isCompressed() ? data != NULL && size == 0x100000 : data == NULL;
+            rarcRemoveResource(&archive, data);
+        }
+    }
+    rarcUnmount(&archive);
+    unlink(path);
+    return ok;
+}
+
+static int test(int, char**) {
+    static const char* path = "rarcmap_test.arc";
+    static const char* szsPath = "rarcmap_test.szs";
+    std::vector<GenFile> files;
+    std::vector<u8> image;
+    std::vector<u8> packed;
+    RarcArchive archive;
+    Yaz0Options options;
+    bool passed;
+    bool ok;
+
+    makeFiles(files, 300, 0x2000, true);
+    if (!writeFileTo(path, files) || !readFile(path, image)) {
+        printf("can't write %s\n", path);
+        return 1;
+    }
+
+    ok = true;
+    passed = rarcMount(&archive, path, 0x10000) && archive.mapped && checkArchive(&archive, files);
+    printf("mapped: %s\n", passed ? "ok" : "FAILED");
+    rarcUnmount(&archive);
+    ok &= passed;
+
+    passed = rarcMountImage(&archive, image.data(), image.size(), 0x10000) && checkArchive(&archive, files);
+    printf("in memory: %s\n", passed ? "ok" : "FAILED");
+    rarcUnmount(&archive);
+    ok &= passed;
+
+    // the whole archive compressed, the way the disc stores most of them
+    yaz0DefaultOptions(&options);
+    options.level = YAZ0_LEVEL_GREEDY;
+    yaz0Encode(image.data(), image.size(), &options, packed);
+    FILE* out = fopen(szsPath, "wb");
+    passed = out != NULL && fwrite(packed.data(), 1, packed.size(), out) == packed.size();
+    if (out != NULL) {
+        fclose(out);
+    }
+    passed = passed && rarcMount(&archive, szsPath, 0x10000) && !archive.mapped && checkArchive(&archive, files);
+    printf("SZS: %s\n", passed ? "ok" : "FAILED");
+    rarcUnmount(&archive);
+    unlink(szsPath);
+    ok &= passed;
+
+    passed = testCache(files, path);
+    printf("bounded cache: %s\n", passed ? "ok" : "FAILED");
+    ok &= passed;
+
+    passed = testCorrupt(path, image);
+    printf("corrupt archives: %s\n", passed ? "ok" : "FAILED");
+    ok &= passed;
+
+    // the converted tables and the index of every archive mounted above
+    passed = simNumLiveBlocks() == 0;
+    printf("tables freed: %s\n", passed ? "ok" : "FAILED");
+    ok &= passed;
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static u64 residentBytes(void) {
+    unsigned long size;
+    unsigned long resident;
+    FILE* file;
+
+    file = fopen("/proc/self/statm", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return (u64)resident * sysconf(_SC_PAGESIZE);
+}
+
+// Reads every file once and hands it back, sampling the resident size as it goes
+static u64 walk(RarcArchive* archive, u64* peakResident) {
+    const u8* data;
+    u64 sum;
+    u64 resident;
+    u32 size;
+    u32 i;
+    u32 j;
+
+    sum = 0;
+    for (i = 0; i < archive->archive->countFile(); i++) {
+        data = rarcGetResource(archive, i, &size);
+        if (data == NULL) {
+            continue;
+        }
+        for (j = 0; j < size; j += 64) {
+            sum += data[j];
+        }
+        rarcRemoveResource(archive, data);
+        if (i % 16 == 0) {
+            resident = residentBytes();
+            if (resident > *peakResident) {
+                *peakResident = resident;
+            }
+        }
+    }
+    return sum;
+}
+
+static f64 secondsSince(Clock::time_point start) { return std::chrono::duration<f64>(Clock::now() - start).count(); }
+
+static void usage(void) {
+    fprintf(stderr, "usage: rarcmap list <archive>\n"
+                    "       rarcmap cat <archive> <path> [out]\n"
+                    "       rarcmap test\n"
+                    "       rarcmap bench [MB] [scratch file]\n");
+}
+
+static int bench(int argc, char** argv) {
+    std::vector<GenFile> files;
+    std::vector<u8> image;
+    RarcArchive archive;
+    Clock::time_point start;
+    const char* path;
+    u64 sums[2];
+    u64 base;
+    u64 peak;
+    u32 megabytes;
+    f64 mountSeconds;
+    f64 walkSeconds;
+
+    if (argc > 4) {
+        usage();
+        return 1;
+    }
+    megabytes = argc >= 3 ? (u32)atoi(argv[2]) : 1024;
+    path = argc >= 4 ? argv[3] : "rarcmap_bench.arc";
+
+    // 1 MB files on average, some of them compressed
+    makeFiles(files, megabytes * 4 / 3, 0x100000 * 3 / 2, false);
+    for (u32 i = 0; i < files.size(); i += 16) {
+        files[i].compression = 'z';
+        files[i].size = 0x40000;
+        packFile(files[i]);
+    }
+    printf("writing %s, %lu files...\n", path, (unsigned long)files.size());
+    if (!writeFileTo(path, files)) {
+        printf("can't write %s\n", path);
+        return 1;
+    }
+
+    printf("%-12s %10s %10s %14s %16s\n", "mount", "mount s", "walk s", "walk MB/s", "peak RSS MB");
+
+    // mapped first, since freeing the heap copy doesn't always give the memory back
+    base = residentBytes();
+    peak = base;
+    start = Clock::now();
+    if (!rarcMount(&archive, path, 16 << 20)) {
+        printf("can't mount %s\n", path);
+        return 1;
+    }
+    mountSeconds = secondsSince(start);
+    start = Clock::now();
+    sums[0] = walk(&archive, &peak);
+    walkSeconds = secondsSince(start);
+    printf("%-12s %10.4f %10.2f %14.1f %16.1f\n", "mmap", mountSeconds, walkSeconds,
+           archive.imageSize / walkSeconds / (1 << 20), (peak - base) / (f64)(1 << 20));
+    rarcUnmount(&archive);
+
+    base = residentBytes();
+    peak = base;
+    start = Clock::now();
+    if (!readFile(path, image) || !rarcMountImage(&archive, image.data(), image.size(), 16 << 20)) {
+        printf("can't read %s\n", path);
+        return 1;
+    }
+    mountSeconds = secondsSince(start);
+    start = Clock::now();
+    sums[1] = walk(&archive, &peak);
+    walkSeconds = secondsSince(start);
+    printf("%-12s %10.4f %10.2f %14.1f %16.1f\n", "read + heap", mountSeconds, walkSeconds,
+           image.size() / walkSeconds / (1 << 20), (peak - base) / (f64)(1 << 20));
+    rarcUnmount(&archive);
+
+    unlink(path);
+    printf("%s\n", sums[0] == sums[1] ? "ok" : "MISMATCH");
+    return sums[0] == sums[1] ? 0 : 1;
+}
+
+static int list(int argc, char** argv) {
+    const char* path;
+    RarcArchive archive;
+    JKRArchive::SDIDirEntry* node;
+    JKRArchive::SDIFileEntry* entry;
+    const char* strings;
+    u32 i;
+    u32 j;
+
+    if (argc != 3) {
+        usage();
+        return 1;
+    }
+    path = argv[2];
+    if (!rarcMount(&archive, path, 0)) {
+        fprintf(stderr, "can't mount %s\n", path);
+        return 1;
+    }
+    strings = archive.archive->mStringTable;
+    for (i = 0; i < (u32)archive.archive->countDirectory(); i++) {
+        node = archive.archive->mNodes + i;
+        printf("%c%c%c%c %s/\n", (char)(node->type >> 24), (char)(node->type >> 16), (char)(node->type >> 8),
+               (char)node->type, strings + node->name_offset);
+        for (j = node->first_file_index; j < node->first_file_index + node->num_entries; j++) {
+            entry = archive.archive->mFiles + j;
+            if (!entry->isDirectory()) {
+                printf("     %5u %10u %-4s %s\n", entry->getFileID(), entry->getSize(),
+                       !entry->isCompressed()      ? ""
+                       : entry->isYAZ0Compressed() ? "SZS"
+                                                   : "SZP",
+                       strings + entry->getNameOffset());
+            }
+        }
+    }
+    rarcUnmount(&archive);
+    return 0;
+}
+
+static int cat(int argc, char** argv) {
+    const char* path;
+    const char* resource;
+    const char* outPath;
+    RarcArchive archive;
+    const u8* data;
+    FILE* out;
+    u32 index;
+    u32 size;
+    bool ok;
+
+    if (argc != 4 && argc != 5) {
+        usage();
+        return 1;
+    }
+    path = argv[2];
+    resource = argv[3];
+    outPath = argc == 5 ? argv[4] : NULL;
+    if (!rarcMount(&archive, path, 0)) {
+        fprintf(stderr, "can't mount %s\n", path);
+        return 1;
+    }
+    index = rarcFindFsResource(&archive, resource[0] == '/' ? resource + 1 : resource);
+    data = index != RARC_NONE ? rarcGetResource(&archive, index, &size) : NULL;
+    if (data == NULL) {
+        fprintf(stderr, "%s: no %s\n", path, resource);
+        rarcUnmount(&archive);
+        return 1;
+    }
+    out = outPath != NULL ? fopen(outPath, "wb") : stdout;
+    ok = out != NULL && fwrite(data, 1, size, out) == size;
+    if (out != NULL && out != stdout) {
+        ok &= fclose(out) == 0;
+    }
+    rarcRemoveResource(&archive, data);
+    rarcUnmount(&archive);
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"test", test},
+    {"bench", bench},
+    {"list", list},
+    {"cat", cat},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
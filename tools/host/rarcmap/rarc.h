@@ -0,0 +1,16 @@
+#ifndef _RARCMAP_RARC_H
+#define _RARCMAP_RARC_H
+
+// The RARC file layout, for archive.cpp, which reads it, and main.cpp, which writes test archives
+
+#define RARC_ATTR_FILE 0x01
+#define RARC_ATTR_DIRECTORY 0x02
+#define RARC_ATTR_COMPRESSED 0x04
+#define RARC_ATTR_YAZ0 0x80
+
+#define RARC_HEADER_SIZE 0x20
+#define RARC_INFO_SIZE 0x20
+#define RARC_NODE_SIZE 0x10
+#define RARC_FILE_SIZE 0x14
+
+#endif
@@ -0,0 +1,288 @@
+#include "rarcmap.h"
+#include "JSystem/JKernel/JKRDecode.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void rarcReset(RarcArchive* archive) {
+    archive->archive = NULL;
+    archive->image = NULL;
+    archive->imageSize = 0;
+    archive->mapped = false;
+    archive->decoded = NULL;
+    archive->fileData = NULL;
+    archive->cache.clear();
+    archive->cachePtrs.clear();
+    archive->mappedPtrs.clear();
+    archive->lru.clear();
+    memset(&archive->stats, 0, sizeof(archive->stats));
+}
+
+static bool rarcInRange(const RarcArchive* archive, const u8* start, u64 size) {
+    return start >= archive->image && (u64)(start - archive->image) + size <= archive->imageSize;
+}
+
+static bool rarcDecodeSize(const u8* src, u32 srcSize, u32* size) {
+    if (srcSize < JKR_SZS_HEADER_SIZE || (memcmp(src, "Yaz0", 4) != 0 && memcmp(src, "Yay0", 4) != 0)) {
+        return false;
+    }
+    *size = host_be32(src + 4);
+    return true;
+}
+
+// The most either decoder can read for size output bytes, whatever the data: a token per byte, each at most a
+// literal byte (SZS) or a link and a count (SZP), the flags, and a group read ahead
+static u32 rarcDecodeReadBound(const u8* src, u32 srcSize) {
+    u64 size;
+    u64 bound;
+    u64 linkOffset;
+    u64 chunkOffset;
+
+    size = host_be32(src + 4);
+    if (src[2] == 'z') {
+        bound = JKR_SZS_HEADER_SIZE + size + size / 8 + JKR_SZS_MAX_GROUP_SIZE + JKR_DECODE_SLACK;
+    } else {
+        linkOffset = host_be32(src + 8);
+        chunkOffset = host_be32(src + 12);
+        bound = (linkOffset > chunkOffset ? linkOffset : chunkOffset) + size * 2 + JKR_SZP_HEADER_SIZE +
+                JKR_DECODE_SLACK;
+    }
+    if (bound < srcSize) {
+        bound = srcSize;
+    }
+    return bound > 0xFFFFFFFF ? 0xFFFFFFFF : (u32)bound;
+}
+
+// dst has to have RARC_WINDOW_GUARD bytes in front of it
+static void rarcDecode(const u8* src, u8* dst, u32 size) {
+    if (src[2] == 'z') {
+        JKRDecodeSZS((u8*)src, dst, size, 0);
+    } else {
+        JKRDecodeSZP((u8*)src, dst, size, 0);
+    }
+}
+
+// Decodes src, which lies in image, straight from there when the decoder can't read past the end of image, and from
+// a zero-padded copy otherwise
+static bool rarcDecodeFrom(const u8* image, size_t imageSize, const u8* src, u32 srcSize, u8* dst, u32 size) {
+    u8* copy;
+    u32 bound;
+
+    bound = rarcDecodeReadBound(src, srcSize);
+    if ((u64)(src - image) + bound <= imageSize) {
+        rarcDecode(src, dst, size);
+        return true;
+    }
+
+    copy = (u8*)calloc(bound, 1);
+    if (copy == NULL) {
+        return false;
+    }
+    memcpy(copy, src, srcSize);
+    rarcDecode(copy, dst, size);
+    free(copy);
+    return true;
+}
+
+bool rarcMountImage(RarcArchive* archive, const u8* image, size_t size, u64 cacheSize) {
+    rarcReset(archive);
+    archive->image = image;
+    archive->imageSize = size;
+    archive->cacheSize = cacheSize;
+    archive->archive = size <= 0xFFFFFFFF ? rarcOpenArchive(image, size) : NULL;
+    if (archive->archive == NULL) {
+        rarcReset(archive);
+        return false;
+    }
+    // the file data starts where the header says, from the info block
+    archive->fileData = image + host_be32(image + 0x08) + host_be32(image + 0x0C);
+    return true;
+}
+
+bool rarcMount(RarcArchive* archive, const char* path, u64 cacheSize) {
+    struct stat st;
+    void* map;
+    u8* decoded;
+    u32 size;
+    int fd;
+
+    rarcReset(archive);
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    // a compressed archive, as JKRCompArchive and the SZS files on the disc have them
+    if (rarcDecodeSize((const u8*)map, st.st_size, &size)) {
+        decoded = (u8*)malloc(RARC_WINDOW_GUARD + size);
+        if (decoded == NULL || !rarcDecodeFrom((const u8*)map, st.st_size, (const u8*)map, st.st_size,
+                                               decoded + RARC_WINDOW_GUARD, size) ||
+            !rarcMountImage(archive, decoded + RARC_WINDOW_GUARD, size, cacheSize)) {
+            free(decoded);
+            munmap(map, st.st_size);
+            return false;
+        }
+        munmap(map, st.st_size);
+        archive->decoded = decoded;
+        return true;
+    }
+
+    if (!rarcMountImage(archive, (const u8*)map, st.st_size, cacheSize)) {
+        munmap(map, st.st_size);
+        return false;
+    }
+    archive->mapped = true;
+    return true;
+}
+
+void rarcUnmount(RarcArchive* archive) {
+    std::map<u32, RarcCacheEntry>::iterator it;
+
+    if (archive->archive != NULL) {
+        rarcCloseArchive(archive->archive);
+    }
+    for (it = archive->cache.begin(); it != archive->cache.end(); ++it) {
+        free(it->second.buffer);
+    }
+    if (archive->mapped) {
+        munmap((void*)archive->image, archive->imageSize);
+    }
+    free(archive->decoded);
+    rarcReset(archive);
+}
+
+u32 rarcFindFsResource(const RarcArchive* archive, const char* path) {
+    JKRArchive::SDIFileEntry* entry;
+
+    entry = archive->archive->findFsResource(path, 0);
+    return entry != NULL ? entry - archive->archive->mFiles : RARC_NONE;
+}
+
+// Drops the pages under [start, start + size) from the process; they read back from the file if touched again
+static void rarcDropPages(const RarcArchive* archive, const u8* start, u64 size) {
+    static long pageSize;
+    uintptr_t begin;
+    uintptr_t end;
+
+    if (!archive->mapped || size == 0) {
+        return;
+    }
+    if (pageSize == 0) {
+        pageSize = sysconf(_SC_PAGESIZE);
+    }
+    begin = ALIGN_PREV((uintptr_t)start, (uintptr_t)pageSize);
+    end = ALIGN_NEXT((uintptr_t)start + size, (uintptr_t)pageSize);
+    madvise((void*)begin, end - begin, MADV_DONTNEED);
+}
+
+static void rarcEvict(RarcArchive* archive, u64 needed) {
+    std::map<u32, RarcCacheEntry>::iterator it;
+
+    while (!archive->lru.empty() && archive->stats.cacheBytes + needed > archive->cacheSize) {
+        it = archive->cache.find(archive->lru.front());
+        archive->lru.pop_front();
+        archive->stats.cacheBytes -= it->second.size;
+        archive->stats.numEvictions++;
+        archive->cachePtrs.erase(it->second.data);
+        free(it->second.buffer);
+        archive->cache.erase(it);
+    }
+}
+
+const u8* rarcGetResource(RarcArchive* archive, u32 index, u32* size) {
+    std::map<u32, RarcCacheEntry>::iterator it;
+    JKRArchive::SDIFileEntry* entry;
+    RarcCacheEntry cached;
+    const u8* src;
+    u32 expanded;
+
+    entry = archive->archive->findIdxResource(index);
+    if (entry == NULL || entry->isDirectory()) {
+        return NULL;
+    }
+    src = archive->fileData + entry->data_offset;
+    if (!rarcInRange(archive, src, entry->getSize())) {
+        return NULL;
+    }
+
+    if (!entry->isCompressed()) {
+        archive->mappedPtrs[src] = entry->getSize();
+        *size = entry->getSize();
+        return src;
+    }
+
+    it = archive->cache.find(index);
+    if (it != archive->cache.end()) {
+        if (it->second.numPins++ == 0) {
+            archive->lru.erase(it->second.lru);
+        }
+        archive->stats.numHits++;
+        *size = it->second.size;
+        return it->second.data;
+    }
+
+    if (!rarcDecodeSize(src, entry->getSize(), &expanded)) {
+        return NULL;
+    }
+    rarcEvict(archive, expanded);
+    cached.buffer = (u8*)malloc(RARC_WINDOW_GUARD + expanded);
+    if (cached.buffer == NULL) {
+        return NULL;
+    }
+    cached.data = cached.buffer + RARC_WINDOW_GUARD;
+    cached.size = expanded;
+    cached.numPins = 1;
+    if (!rarcDecodeFrom(archive->image, archive->imageSize, src, entry->getSize(), cached.data, expanded)) {
+        free(cached.buffer);
+        return NULL;
+    }
+    rarcDropPages(archive, src, entry->getSize());
+
+    archive->cache[index] = cached;
+    archive->cachePtrs[cached.data] = index;
+    archive->stats.cacheBytes += expanded;
+    if (archive->stats.cacheBytes > archive->stats.peakCacheBytes) {
+        archive->stats.peakCacheBytes = archive->stats.cacheBytes;
+    }
+    archive->stats.numDecodes++;
+    *size = expanded;
+    return cached.data;
+}
+
+void rarcRemoveResource(RarcArchive* archive, const u8* resource) {
+    std::map<const u8*, u32>::iterator ptr;
+    std::map<u32, RarcCacheEntry>::iterator it;
+
+    ptr = archive->cachePtrs.find(resource);
+    if (ptr != archive->cachePtrs.end()) {
+        it = archive->cache.find(ptr->second);
+        if (it->second.numPins != 0 && --it->second.numPins == 0) {
+            it->second.lru = archive->lru.insert(archive->lru.end(), ptr->second);
+            // one bigger than the whole cache goes right away
+            rarcEvict(archive, 0);
+        }
+        return;
+    }
+
+    ptr = archive->mappedPtrs.find(resource);
+    if (ptr != archive->mappedPtrs.end()) {
+        rarcDropPages(archive, resource, ptr->second);
+        archive->mappedPtrs.erase(ptr);
+        archive->stats.numReleased++;
+    }
+}
+
+void rarcGetStats(const RarcArchive* archive, RarcStats* stats) { *stats = archive->stats; }
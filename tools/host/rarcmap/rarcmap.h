@@ -0,0 +1,76 @@
+#ifndef _RARCMAP_RARCMAP_H
+#define _RARCMAP_RARCMAP_H
+
+#include "../common/types.h"
+#include "JSystem/JKernel/JKRArchive.h"
+#include "rarc.h"
+
+#include <list>
+#include <map>
+
+// Host mount of JKRArchive for asset tools. The archive is mapped, not read, and mounted through a JKRArchive
+// subclass (archive.cpp), so paths, names and types are looked up with the real find functions. Uncompressed
+// resources are returned as pointers into the mapping. Compressed resources are decoded with JKRDecomp's decoder on
+// first use into a cache of at most cacheSize bytes, least recently used first out. Handing a resource back with
+// rarcRemoveResource unpins it and drops its pages from the process, so walking an archive larger than memory needs
+// the cache and the tables, not the archive.
+//
+// A Yaz0/Yay0 file holding a whole archive can't be mapped usefully; it is decoded into memory instead.
+
+#define RARC_NONE 0xFFFFFFFF
+
+#define RARC_WINDOW_GUARD 0x1000
+
+typedef struct RarcStats {
+    u64 cacheBytes;
+    u64 peakCacheBytes;
+    u32 numHits;
+    u32 numDecodes;
+    u32 numEvictions;
+    u32 numReleased; // uncompressed resources whose pages were dropped
+} RarcStats;
+
+typedef struct RarcCacheEntry {
+    u8* buffer; // data behind RARC_WINDOW_GUARD bytes, so a corrupt back-reference can't reach outside it
+    u8* data;
+    u32 size;
+    u32 numPins;
+    std::list<u32>::iterator lru;
+} RarcCacheEntry;
+
+typedef struct RarcArchive {
+    JKRArchive* archive; // the tables, over image
+    const u8* image;
+    size_t imageSize;
+    bool mapped; // false when image was decoded or handed in
+    u8* decoded;
+    const u8* fileData;
+    u64 cacheSize;
+    std::map<u32, RarcCacheEntry> cache; // by file index
+    std::map<const u8*, u32> cachePtrs;  // data pointer back to file index
+    std::map<const u8*, u32> mappedPtrs; // sizes of the uncompressed resources handed out
+    std::list<u32> lru;                  // unpinned cache entries, oldest first
+    RarcStats stats;
+} RarcArchive;
+
+// Mounts the file at path, or an image already in memory which has to stay valid until rarcUnmount. false if it
+// isn't an archive or its tables run off its end.
+bool rarcMount(RarcArchive* archive, const char* path, u64 cacheSize);
+bool rarcMountImage(RarcArchive* archive, const u8* image, size_t size, u64 cacheSize);
+void rarcUnmount(RarcArchive* archive);
+
+// JKRArchive::findFsResource from the root, as a file index, or RARC_NONE
+u32 rarcFindFsResource(const RarcArchive* archive, const char* path);
+
+// The decoded contents of file index and their size, or NULL. Each call pins the resource once; hand it back with
+// rarcRemoveResource.
+const u8* rarcGetResource(RarcArchive* archive, u32 index, u32* size);
+void rarcRemoveResource(RarcArchive* archive, const u8* resource);
+
+void rarcGetStats(const RarcArchive* archive, RarcStats* stats);
+
+// archive.cpp, which is kept apart because JKRHeap.h's operator new and delete clash with the C++ library headers
+JKRArchive* rarcOpenArchive(const u8* image, u32 size);
+void rarcCloseArchive(JKRArchive* archive);
+
+#endif
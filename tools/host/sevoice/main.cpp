@@ -0,0 +1,418 @@
+// Host model of the menu sound effect path, before and after SEVoiceMgr. The legacy path is soundeffect.cpp as it
+// is linked: seInit, sePlaySE and ax_se_callback. The new path is sevoicemgr.cpp: sevmInitSound, sevmPlayMenuSE and
+// the sevmUpdate callback that sevmInit registers. Both run on the axmix AX, MIX and SP emulation with the same
+// synthetic sound bank and the same request sequence.
+//
+// OSDisableInterrupts and OSRestoreInterrupts time every section that runs with interrupts disabled and charge it to
+// the call that opened it. The AX user callback is run inside such a section at the end of every 5 ms frame, the way
+// the AX interrupt runs it, so "callback" is the time the registered callback holds the interrupt. Times are host
+// nanoseconds: compare the two paths, not the absolute numbers.
+
+#include "../axmix/axmix.h"
+#include "../common/test.h"
+#include "dolphin/am.h"
+#include "dolphin/os.h"
+#include "menu/seVoiceMgr.hpp"
+#include "menu/soundEffect.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <x86intrin.h>
+
+#define ARAM_SIZE (16 * 1024 * 1024)
+#define ARAM_ZERO_BASE 0x0000 // 256 bytes of silence the one-shots loop into
+#define ARAM_USER_BASE 0x1000 // the .spd goes here
+#define SIM_BUS_CLOCK 162000000
+#define NUM_SOUNDS SEVM_NUM_MENU_SE
+#define SP_TYPE_PCM16_ONESHOT 2
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct Section {
+    std::vector<double> ns;
+} Section;
+
+typedef struct RunResult {
+    Section play;
+    Section callback;
+    u32 requests;
+    u32 started;
+    u32 failures;
+    u32 steals;
+    u32 peakVoices;
+} RunResult;
+
+typedef struct Scenario {
+    const char* name;
+    u32 playsPerSecond;
+} Scenario;
+
+extern SEVoice se_voice[NUM_VOICE];
+
+void simInitAram(void);
+
+static std::vector<u8> sSpt;
+static std::vector<u8> sSpd;
+static std::vector<u8> sARAM;
+static SPSoundTable* sTable;
+static bool sInterruptsEnabled = true;
+static Clock::time_point sDisabledAt;
+static Section* sSection; // charged with the next interrupts-disabled section
+static AXUserCallback sInnerCallback;
+static u32 sNumReports;
+
+static void usage(void) {
+    fprintf(stderr, "usage: sevoice test\n"
+                    "       sevoice bench [frames]\n");
+}
+
+// The SDK calls seInit and sevmInitSound make. Nothing here touches hardware: the bank is already built in host
+// memory, AMLoadFile hands out the table and __AMPushBuffered puts the sample data at ARAM_USER_BASE.
+
+extern "C" {
+void DVDInit(void) {}
+
+u32 ARInit(u32* stack_index_addr, u32 num_entries) { return ARAM_USER_BASE; }
+
+void ARQInit(void) {}
+
+void AIInit(u8* stack) {}
+
+void AMInit(u32 aramBase, u32 aramBytes) {}
+
+u32 AMGetZeroBuffer(void) { return ARAM_ZERO_BASE; }
+
+// Each init loads the table again; the previous one is no longer in use by then
+void* AMLoadFile(char* path, u32* length) {
+    free(sTable);
+    sTable = SPEmuLoadTable(sSpt.data(), (u32)sSpt.size());
+    return sTable;
+}
+
+u32 __AMPushBuffered(char* path, void* buffer, u32 buffer_size, AMCallback callback, BOOL async_flag) {
+    sARAM.assign(ARAM_SIZE, 0);
+    memcpy(&sARAM[ARAM_USER_BASE], sSpd.data(), sSpd.size());
+    AXEmuSetARAM(sARAM.data(), ARAM_SIZE);
+    return ARAM_USER_BASE;
+}
+
+void OSReport(const char* msg, ...) { sNumReports++; }
+
+BOOL OSDisableInterrupts(void) {
+    BOOL level;
+
+    level = sInterruptsEnabled;
+    if (level) {
+        sDisabledAt = Clock::now();
+    }
+    sInterruptsEnabled = false;
+    return level;
+}
+
+BOOL OSRestoreInterrupts(BOOL level) {
+    BOOL old;
+
+    old = sInterruptsEnabled;
+    if (level && !old && sSection != NULL) {
+        sSection->ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - sDisabledAt).count());
+    }
+    sInterruptsEnabled = level ? true : false;
+    return old;
+}
+
+// The console reads the time base with one instruction; the host's closest match is the TSC. Its rate isn't the
+// time base rate, so the manager's own tick statistics aren't in console units here.
+OSTick OSGetTick(void) { return (OSTick)__rdtsc(); }
+}
+
+static void putBE(std::vector<u8>& data, u32 value, u32 size) {
+    u32 i;
+
+    for (i = size; i > 0; i--) {
+        data.push_back((u8)(value >> ((i - 1) * 8)));
+    }
+}
+
+// Four PCM16 one-shots in the disc format, as long as the menu's cancel, okai, select and start sounds roughly are
+static void buildBank(void) {
+    static const u32 lengthsMs[NUM_SOUNDS] = {150, 300, 80, 1200};
+    static const u32 sampleRate = 32000;
+    u32 offsets[NUM_SOUNDS];
+    u32 lengths[NUM_SOUNDS];
+    u32 i;
+    u32 k;
+
+    sSpd.clear();
+    for (i = 0; i < NUM_SOUNDS; i++) {
+        offsets[i] = (u32)sSpd.size();
+        lengths[i] = sampleRate * lengthsMs[i] / 1000;
+        for (k = 0; k < lengths[i]; k++) {
+            putBE(sSpd, (u16)(s16)((s32)(k * (440 + 110 * i) * 65536 / sampleRate % 65536) / 6 - 5461), 2);
+        }
+        sSpd.resize((sSpd.size() + 31) & ~31);
+    }
+
+    sSpt.clear();
+    putBE(sSpt, NUM_SOUNDS, 4);
+    for (i = 0; i < NUM_SOUNDS; i++) {
+        putBE(sSpt, SP_TYPE_PCM16_ONESHOT, 4);
+        putBE(sSpt, sampleRate, 4);
+        putBE(sSpt, offsets[i] / 2, 4);
+        putBE(sSpt, offsets[i] / 2 + lengths[i] - 1, 4);
+        putBE(sSpt, offsets[i] / 2 + lengths[i] - 1, 4);
+        putBE(sSpt, offsets[i] / 2, 4);
+        putBE(sSpt, 0, 4);
+    }
+}
+
+// Runs the callback seInit or sevmInit registered the way the AX interrupt does, with interrupts disabled
+static void timedCallback(void) {
+    BOOL interrupts;
+
+    interrupts = OSDisableInterrupts();
+    if (sInnerCallback != NULL) {
+        sInnerCallback();
+    }
+    OSRestoreInterrupts(interrupts);
+}
+
+static void startAudio(SEStatus* status, SEVoiceMgr* mgr) {
+    memset(status, 0, sizeof(*status));
+    status->cancelVolume = -30;
+    status->okaiVolume = -60;
+    status->selectVolume = -90;
+    status->startVolume = -120;
+
+    if (mgr != NULL) {
+        sevmInitSound(mgr, status);
+    } else {
+        seInit(status);
+    }
+    sInnerCallback = AXRegisterCallback(timedCallback);
+    sSection = NULL;
+}
+
+static void renderFrame(Section* callback) {
+    s16 out[AX_SAMPLES_PER_FRAME * 2];
+
+    sSection = callback;
+    AXEmuRenderFrame(out);
+    sSection = NULL;
+}
+
+static u32 countLegacyVoices(void) {
+    u32 count;
+    u32 i;
+
+    count = 0;
+    for (i = 0; i < NUM_VOICE; i++) {
+        count += se_voice[i].axvpb != NULL;
+    }
+    return count;
+}
+
+// The same pseudo-random request sequence for both paths: plays spread over the frames at the given rate, menu
+// sound indices drawn uniformly
+static void runScenario(const Scenario* scenario, u32 numFrames, bool useMgr, RunResult* result) {
+    static SEVoiceMgr mgr;
+    SEStatus status;
+    u32 random;
+    u32 credit;
+    u32 reports;
+    u32 voices;
+    u32 index;
+    u32 i;
+
+    startAudio(&status, useMgr ? &mgr : NULL);
+    result->play.ns.clear();
+    result->callback.ns.clear();
+    result->requests = 0;
+    result->started = 0;
+    result->failures = 0;
+    result->steals = 0;
+    result->peakVoices = 0;
+
+    random = 12345;
+    credit = 0;
+    for (i = 0; i < numFrames; i++) {
+        credit += scenario->playsPerSecond;
+        while (credit >= 200) {
+            credit -= 200;
+            random = (random * 1103515245 + 12345) & 0xFFFFFFFF;
+            index = (random >> 16) % NUM_SOUNDS;
+            result->requests++;
+
+            sSection = &result->play;
+            if (useMgr) {
+                sevmPlayMenuSE(&mgr, index);
+            } else {
+                reports = sNumReports;
+                sePlaySE(index);
+                result->failures += sNumReports != reports;
+            }
+            sSection = NULL;
+        }
+
+        voices = useMgr ? mgr.numActive : countLegacyVoices();
+        result->peakVoices = std::max(result->peakVoices, voices);
+        renderFrame(&result->callback);
+    }
+
+    if (useMgr) {
+        result->failures = mgr.stats.numFailures;
+        result->steals = mgr.stats.numSteals;
+    }
+    result->started = result->requests - result->failures;
+}
+
+static double average(const Section* section) {
+    double sum;
+    size_t i;
+
+    sum = 0.0;
+    for (i = 0; i < section->ns.size(); i++) {
+        sum += section->ns[i];
+    }
+    return section->ns.empty() ? 0.0 : sum / section->ns.size();
+}
+
+static double percentile(const Section* section, double p) {
+    std::vector<double> sorted;
+
+    if (section->ns.empty()) {
+        return 0.0;
+    }
+    sorted = section->ns;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(size_t)(p * (sorted.size() - 1))];
+}
+
+static void printSection(const char* path, const char* name, const Section* section) {
+    printf("  %-7s %-8s %8lu  %8.0f  %8.0f  %8.0f\n", path, name, (u32)section->ns.size(), average(section),
+           percentile(section, 0.99), percentile(section, 1.0));
+}
+
+static int bench(int argc, char** argv) {
+    static const Scenario scenarios[] = {
+        {"menu", 10},   // a cursor move or a confirm every 100 ms
+        {"busy", 200},  // a sound every frame: at the average length that's more than the 64 voices hold
+        {"flood", 800}, // four sounds a frame: nearly every request finds all 64 voices playing
+    };
+    RunResult legacy;
+    RunResult mgr;
+    u32 numFrames;
+    u32 i;
+
+    numFrames = argc > 2 ? (u32)atoi(argv[2]) : 12000;
+    if (numFrames == 0) {
+        numFrames = 1;
+    }
+
+    buildBank();
+    printf("%lu frames (%.0f s of audio) per run, interrupts-disabled time in host ns\n", numFrames, numFrames / 200.0);
+    for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        runScenario(&scenarios[i], numFrames, false, &legacy);
+        runScenario(&scenarios[i], numFrames, true, &mgr);
+
+        printf("%s: %lu plays/s\n", scenarios[i].name, scenarios[i].playsPerSecond);
+        printf("  path    section     calls       avg       p99       max\n");
+        printSection("legacy", "play", &legacy.play);
+        printSection("legacy", "callback", &legacy.callback);
+        printSection("mgr", "play", &mgr.play);
+        printSection("mgr", "callback", &mgr.callback);
+        printf("  legacy: %lu of %lu started, peak %lu voices\n", legacy.started, legacy.requests, legacy.peakVoices);
+        printf("  mgr:    %lu of %lu started, %lu by stealing, peak %lu voices\n", mgr.started, mgr.requests,
+               mgr.steals, mgr.peakVoices);
+    }
+    return 0;
+}
+
+static u32 countFree(SEVoiceMgr* mgr) {
+    SEVoiceNode* node;
+    u32 count;
+
+    count = 0;
+    for (node = mgr->freeList; node != NULL; node = node->next) {
+        count++;
+    }
+    return count;
+}
+
+static int test(int argc, char** argv) {
+    static SEVoiceMgr mgr;
+    static SEVoiceMgr other;
+    SEVoiceNode* nodes[NUM_SOUNDS];
+    SEVoiceNode* node;
+    SEStatus status;
+    Section callback;
+    bool ok;
+    u32 i;
+
+    ok = true;
+    buildBank();
+    startAudio(&status, &mgr);
+
+    // the menu sounds get sePlaySE's volumes
+    for (i = 0; i < NUM_SOUNDS; i++) {
+        nodes[i] = sevmPlayMenuSE(&mgr, i);
+        ok &= expect(nodes[i] != NULL, "menu sound starts");
+    }
+    ok &= expect(nodes[0] != NULL && MIXGetInput(nodes[0]->voice.axvpb) == status.cancelVolume, "cancel volume");
+    ok &= expect(nodes[1] != NULL && MIXGetInput(nodes[1]->voice.axvpb) == status.okaiVolume, "okai volume");
+    ok &= expect(nodes[2] != NULL && MIXGetInput(nodes[2]->voice.axvpb) == status.selectVolume, "select volume");
+    ok &= expect(nodes[3] != NULL && MIXGetInput(nodes[3]->voice.axvpb) == status.startVolume, "start volume");
+
+    // a node from another manager is left alone, the manager's own node is stopped and reclaimed in the callback
+    memset(&other, 0, sizeof(other));
+    other.nodes[0].voice.axvpb = nodes[3]->voice.axvpb;
+    sevmStop(&mgr, &other.nodes[0]);
+    ok &= expect(nodes[3]->voice.axvpb->pb.state == AX_PB_STATE_RUN, "foreign node ignored by sevmStop");
+    sevmStop(&mgr, nodes[3]);
+    renderFrame(&callback);
+    ok &= expect(mgr.numActive == 3 && countFree(&mgr) == NUM_VOICE - 3, "stopped voice reclaimed by the callback");
+    sevmStopAll(&mgr);
+    renderFrame(&callback);
+    ok &= expect(mgr.numActive == 0 && countFree(&mgr) == NUM_VOICE, "sevmStopAll");
+
+    // finished one-shots come back through the registered callback without sevmUpdate being called directly
+    for (i = 0; i < NUM_VOICE; i++) {
+        sevmPlayMenuSE(&mgr, i % NUM_SOUNDS);
+    }
+    ok &= expect(mgr.numActive == NUM_VOICE && mgr.freeList == NULL, "all voices playing");
+    for (i = 0; i < 300; i++) {
+        renderFrame(&callback);
+    }
+    ok &= expect(mgr.numActive == 0 && countFree(&mgr) == NUM_VOICE, "finished voices reclaimed");
+    ok &= expect(callback.ns.size() == 302, "callback runs every frame");
+
+    // stealing: a higher priority request takes the oldest low priority voice, a lower one fails
+    nodes[0] = sevmPlaySE(&mgr, 3, 0, 5);
+    for (i = 1; i < NUM_VOICE; i++) {
+        sevmPlaySE(&mgr, 3, 0, 5);
+    }
+    node = sevmPlaySE(&mgr, 3, 0, 10);
+    ok &= expect(node == nodes[0] && node->priority == 10 && mgr.stats.numSteals == 1, "oldest voice stolen");
+    ok &= expect(sevmPlaySE(&mgr, 3, 0, 1) == NULL && mgr.stats.numFailures == 1, "lower priority fails");
+    sevmStopAll(&mgr);
+    renderFrame(&callback);
+    ok &= expect(mgr.numActive == 0 && countFree(&mgr) == NUM_VOICE, "stolen voices all reclaimed");
+
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"test", test},
+    {"bench", bench},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) {
+    __OSBusClock = SIM_BUS_CLOCK;
+    simInitAram();
+    return runCommand(sCommands, argc, argv, usage);
+}
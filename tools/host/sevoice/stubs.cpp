@@ -0,0 +1,17 @@
+// The JKernel side of seInit and sevmInitSound. JKRAllocFromAram is inline and goes through JKRAram::sAramObject;
+// neither JKRAram nor its heap is ever constructed here, the manager is storage of the right size whose heap pointer
+// simInitAram sets, and JKRAramHeap::alloc doesn't look at the heap. It lives apart from main.cpp because the
+// JKernel operator new and delete declarations clash with the host C++ library headers.
+
+#include "JSystem/JKernel/JKRAram.h"
+
+#define ARAM_USER_BASE 0x1000 // as in main.cpp
+
+static u32 sAramStorage[(sizeof(JKRAram) + 3) / 4];
+static u32 sAramHeapStorage[(sizeof(JKRAramHeap) + 3) / 4];
+JKRAram* JKRAram::sAramObject = (JKRAram*)sAramStorage;
+
+void simInitAram(void) { JKRAram::getManager()->mAramHeap = (JKRAramHeap*)sAramHeapStorage; }
+
+// The address the callers get back is only handed to AMInit
+JKRAramBlock* JKRAramHeap::alloc(u32 size, EAllocMode allocMode) { return (JKRAramBlock*)ARAM_USER_BASE; }
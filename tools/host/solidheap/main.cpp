@@ -0,0 +1,344 @@
+// Host test and benchmark of JKRSolidHeap's marks. The test sets, nests and rewinds marks and checks where the head
+// and tail end up; the benchmark compares three ways of giving a frame scratch memory: a scope on a solid heap that
+// lives for the whole run, a solid heap made and destroyed every frame, and allocating and freeing on a JKRExpHeap.
+
+#include "JSystem/JKernel/JKRExpHeap.h"
+#include "JSystem/JKernel/JKRSolidHeap.h"
+#include "../common/test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_HEAP_SIZE 0x10000
+#define BENCH_HEAP_SIZE (16 * 1024 * 1024)
+#define FRAME_HEAP_SIZE 0x30000
+#define FRAME_ALLOCS 256
+#define NUM_SIZES 4096
+#define BENCH_FRAMES 20000
+
+// In ../expheap/stubs.cpp
+void expheapSetReport(bool verbose);
+unsigned int expheapGetReportCount(void);
+
+typedef JKRSolidHeap::CMark CMark;
+typedef JKRSolidHeap::CScope CScope;
+
+static JKRExpHeap* sRootHeap;
+static u32 sSizes[NUM_SIZES];
+
+static u8* getHead(JKRSolidHeap* heap) { return (u8*)heap->getMaxFreeBlock(); }
+
+static u8* getTail(JKRSolidHeap* heap) { return getHead(heap) + heap->getFreeSize(); }
+
+static JKRSolidHeap* createTestHeap(void) { return JKRSolidHeap::create(TEST_HEAP_SIZE, sRootHeap, false); }
+
+static bool testNested(void) {
+    JKRSolidHeap* heap;
+    CMark outer;
+    CMark headMark;
+    CMark tailMark;
+    u8* start;
+    u8* end;
+    u8* head;
+    u8* tail;
+    bool ok;
+
+    heap = createTestHeap();
+    start = getHead(heap);
+    end = getTail(heap);
+    ok = true;
+
+    heap->setMark(&outer, JKRSolidHeap::MARK_BOTH);
+    heap->alloc(0x100, 4);
+    heap->alloc(0x100, -4);
+    head = getHead(heap);
+    tail = getTail(heap);
+
+    heap->setMark(&headMark, JKRSolidHeap::MARK_HEAD);
+    heap->alloc(0x80, 4);
+    heap->alloc(0x40, -4);
+    heap->setMark(&tailMark, JKRSolidHeap::MARK_TAIL);
+    heap->alloc(0x20, 4);
+    heap->alloc(0x20, -4);
+    ok &= expect(heap->getMark() == &tailMark && tailMark.mDepth == 2, "marks nest");
+    ok &= expect(heap->check(), "check with three marks set");
+
+    // the tail mark leaves what was allocated from the head alone
+    ok &= expect(heap->rewind(&tailMark), "rewind tail mark");
+    ok &= expect(getHead(heap) == head + 0xa0 && getTail(heap) == tail - 0x40, "tail mark rewinds the tail only");
+
+    // and the head mark what was allocated from the tail
+    ok &= expect(heap->rewind(&headMark), "rewind head mark");
+    ok &= expect(getHead(heap) == head && getTail(heap) == tail - 0x40, "head mark rewinds the head only");
+
+    ok &= expect(heap->rewind(&outer), "rewind outer mark");
+    ok &= expect(getHead(heap) == start && getTail(heap) == end, "outer mark rewinds both");
+    ok &= expect(heap->getFreeSize() == (s32)heap->getSize(), "everything free again");
+    ok &= expect(heap->getMark() == NULL && heap->check(), "no marks left");
+
+    heap->destroy();
+    return ok;
+}
+
+static bool testOutOfOrder(void) {
+    JKRSolidHeap* heap;
+    CMark outer;
+    CMark inner;
+    unsigned int reports;
+    bool ok;
+
+    heap = createTestHeap();
+    ok = true;
+
+    heap->setMark(&outer, JKRSolidHeap::MARK_BOTH);
+    heap->alloc(0x100, 4);
+    heap->setMark(&inner, JKRSolidHeap::MARK_BOTH);
+    heap->alloc(0x100, 4);
+
+    // rewinding the outer mark first unsets the inner one too, and says so
+    reports = expheapGetReportCount();
+    ok &= expect(heap->rewind(&outer), "rewind outer mark first");
+    ok &= expect(expheapGetReportCount() == reports + 1, "inner mark still set is reported");
+    ok &= expect(heap->getMark() == NULL && getHead(heap) == heap->getStartAddr(), "both marks unset");
+
+    reports = expheapGetReportCount();
+    ok &= expect(!heap->rewind(&inner), "inner mark is no longer set");
+    ok &= expect(expheapGetReportCount() == reports + 1, "rewinding a mark that isn't set is reported");
+    ok &= expect(heap->check(), "check after rewinding out of order");
+
+    heap->destroy();
+    return ok;
+}
+
+static bool testFreeTailAndAll(void) {
+    JKRSolidHeap* heap;
+    CMark mark;
+    u8* head;
+    bool ok;
+
+    heap = createTestHeap();
+    ok = true;
+
+    heap->alloc(0x100, -4);
+    heap->setMark(&mark, JKRSolidHeap::MARK_BOTH);
+    heap->alloc(0x100, 4);
+    heap->alloc(0x100, -4);
+    head = getHead(heap);
+
+    // freeTail moves the tail of every mark to the end with it
+    heap->freeTail();
+    ok &= expect(getTail(heap) == heap->getEndAddr() && mark.mTail == heap->getEndAddr(), "freeTail moves marks");
+    ok &= expect(heap->check(), "check after freeTail");
+    ok &= expect(heap->rewind(&mark), "rewind after freeTail");
+    ok &= expect(getHead(heap) == head - 0x100 && getTail(heap) == heap->getEndAddr(), "rewind after freeTail");
+
+    heap->setMark(&mark, JKRSolidHeap::MARK_BOTH);
+    heap->alloc(0x100, 4);
+    heap->freeAll();
+    ok &= expect(heap->getMark() == NULL, "freeAll unsets marks");
+    ok &= expect(!heap->rewind(&mark), "mark unset by freeAll");
+    ok &= expect(heap->getFreeSize() == (s32)heap->getSize(), "freeAll frees everything");
+
+    heap->destroy();
+    return ok;
+}
+
+static bool testScope(void) {
+    JKRSolidHeap* heap;
+    JKRHeap::TState before;
+    JKRHeap::TState after;
+    u8* head;
+    u8* tail;
+    void* ptr;
+    bool ok;
+
+    heap = createTestHeap();
+    ok = true;
+
+    heap->alloc(0x40, 4);
+    head = getHead(heap);
+    tail = getTail(heap);
+    heap->state_register(&before, 0x100);
+    {
+        CScope frame(heap);
+
+        heap->alloc(0x100, 4);
+        {
+            CScope inner(heap, JKRSolidHeap::MARK_TAIL);
+
+            heap->alloc(0x100, -4);
+            heap->alloc(0x100, 4);
+        }
+        ok &= expect(getHead(heap) == head + 0x200 && getTail(heap) == tail, "inner scope rewinds the tail");
+    }
+    heap->state_register(&after, 0x100);
+    ok &= expect(getHead(heap) == head && getTail(heap) == tail, "scope rewinds both");
+    ok &= expect(heap->state_compare(before, after), "state unchanged by a scope");
+
+    // what is left over the allocations that fit
+    ok &= expect(heap->alloc(heap->getFreeSize() + 4, 4) == NULL, "too large fails");
+    ok &= expect(heap->getMark() == NULL, "no marks left after scopes");
+    ptr = heap->alloc(0x10, 0x20);
+    ok &= expect(ptr != NULL && ((unsigned long)ptr & 0x1f) == 0, "head alignment");
+    ptr = heap->alloc(0x10, -0x40);
+    ok &= expect(ptr != NULL && ((unsigned long)ptr & 0x3f) == 0, "tail alignment");
+    ok &= expect(heap->check(), "check after aligned allocations");
+
+    heap->destroy();
+    return ok;
+}
+
+static bool testDebugFill(void) {
+    JKRSolidHeap* heap;
+    CMark mark;
+    unsigned int reports;
+    u8* ptr;
+    bool ok;
+
+    JKRHeap::setDefaultDebugFill(true);
+    heap = createTestHeap();
+    JKRHeap::setDefaultDebugFill(false);
+    ok = true;
+
+    heap->setMark(&mark, JKRSolidHeap::MARK_BOTH);
+    ptr = (u8*)heap->alloc(0x40, 4);
+    memset(ptr, 0, 0x40);
+    ptr = (u8*)heap->alloc(0x40, -4);
+    memset(ptr, 0, 0x40);
+    heap->rewind(&mark);
+
+    // the rewound memory is filled again, so allocating it is quiet...
+    reports = expheapGetReportCount();
+    heap->setMark(&mark, JKRSolidHeap::MARK_BOTH);
+    heap->alloc(0x40, 4);
+    heap->alloc(0x40, -4);
+    ok &= expect(expheapGetReportCount() == reports, "rewound memory is filled");
+    heap->rewind(&mark);
+
+    // ...until something writes to it through a pointer it kept
+    ptr[8] = 1;
+    reports = expheapGetReportCount();
+    heap->alloc(0x40, -4);
+    ok &= expect(expheapGetReportCount() == reports + 1, "write after rewind is reported");
+
+    heap->destroy();
+    return ok;
+}
+
+static int test(int, char**) {
+    bool ok = true;
+
+    ok &= testNested();
+    ok &= testOutOfOrder();
+    ok &= testFreeTailAndAll();
+    ok &= testScope();
+    ok &= testDebugFill();
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static double getSeconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void initSizes(void) {
+    unsigned long long seed = 0x9e3779b97f4a7c15ULL;
+    u32 i;
+
+    for (i = 0; i < NUM_SIZES; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        sSizes[i] = 16 + (u32)(seed >> 16) % (512 - 16 + 1);
+    }
+}
+
+static void printBench(const char* name, double seconds, bool ok) {
+    printf("%-16s %10.1f %10.2f%s\n", name, seconds * 1e9 / BENCH_FRAMES, seconds * 1e9 / BENCH_FRAMES / FRAME_ALLOCS,
+           ok ? "" : "  FAILED");
+}
+
+static int bench(int, char**) {
+    JKRExpHeap* expHeap;
+    JKRSolidHeap* solidHeap;
+    JKRSolidHeap* frameHeap;
+    void* ptrs[FRAME_ALLOCS];
+    double start;
+    u32 frame;
+    u32 next;
+    u32 i;
+    bool ok;
+
+    initSizes();
+    expHeap = JKRExpHeap::create(BENCH_HEAP_SIZE, sRootHeap, false);
+    solidHeap = JKRSolidHeap::create(FRAME_HEAP_SIZE, sRootHeap, false);
+    printf("%d frames of %d allocations of 16-512 bytes\n", BENCH_FRAMES, FRAME_ALLOCS);
+    printf("%-16s %10s %10s\n", "", "ns/frame", "ns/alloc");
+
+    ok = true;
+    next = 0;
+    start = getSeconds();
+    for (frame = 0; frame < BENCH_FRAMES; frame++) {
+        CScope scope(solidHeap, JKRSolidHeap::MARK_TAIL);
+
+        for (i = 0; i < FRAME_ALLOCS; i++) {
+            ok &= solidHeap->alloc(sSizes[next++ % NUM_SIZES], -4) != NULL;
+        }
+    }
+    printBench("solid scope", getSeconds() - start, ok && solidHeap->getFreeSize() == (s32)solidHeap->getSize());
+
+    ok = true;
+    next = 0;
+    start = getSeconds();
+    for (frame = 0; frame < BENCH_FRAMES; frame++) {
+        frameHeap = JKRSolidHeap::create(FRAME_HEAP_SIZE, expHeap, false);
+        for (i = 0; i < FRAME_ALLOCS; i++) {
+            ok &= frameHeap->alloc(sSizes[next++ % NUM_SIZES], -4) != NULL;
+        }
+        frameHeap->destroy();
+    }
+    printBench("solid per frame", getSeconds() - start, ok);
+
+    ok = true;
+    next = 0;
+    start = getSeconds();
+    for (frame = 0; frame < BENCH_FRAMES; frame++) {
+        for (i = 0; i < FRAME_ALLOCS; i++) {
+            ptrs[i] = expHeap->alloc(sSizes[next++ % NUM_SIZES], -4);
+            ok &= ptrs[i] != NULL;
+        }
+        for (i = 0; i < FRAME_ALLOCS; i++) {
+            expHeap->free(ptrs[i]);
+        }
+    }
+    printBench("exp alloc/free", getSeconds() - start, ok && expHeap->check());
+
+    solidHeap->destroy();
+    expHeap->destroy();
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: solidheap [-v] test\n"
+                    "       solidheap bench\n");
+}
+
+static const HostCommand sCommands[] = {
+    {"test", test},
+    {"bench", bench},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        expheapSetReport(true);
+        argc--;
+        argv++;
+    }
+    sRootHeap = JKRExpHeap::createRoot(1, false);
+    return runCommand(sCommands, argc, argv, usage);
+}
@@ -0,0 +1,481 @@
+#include "adpcm.h"
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define ADPCM_HAVE_SSE2_BUILD 1
+#endif
+
+static inline s32 clamp16(s32 v) {
+    if (v > 32767) {
+        return 32767;
+    }
+    if (v < -32768) {
+        return -32768;
+    }
+    return v;
+}
+
+bool AdpcmHaveSSE2(void) {
+#ifdef ADPCM_HAVE_SSE2_BUILD
+    return __builtin_cpu_supports("sse2");
+#else
+    return false;
+#endif
+}
+
+// Per-sample input term of the predictor: the scaled residual in 21.11 fixed point plus the rounding bias
+static void AdpcmFrameTermsScalar(const u8* frame, s32 terms[ADPCM_SAMPLES_PER_FRAME]) {
+    s32 scale = 1 << (frame[0] & 0xF);
+    s32 nibble;
+    s32 i;
+
+    for (i = 0; i < ADPCM_SAMPLES_PER_FRAME; i++) {
+        nibble = (i & 1) ? (frame[1 + i / 2] & 0xF) : (frame[1 + i / 2] >> 4);
+        nibble = (nibble ^ 8) - 8;
+        terms[i] = nibble * scale * 2048 + 1024;
+    }
+}
+
+#ifdef ADPCM_HAVE_SSE2_BUILD
+__attribute__((target("sse2"))) static void AdpcmFrameTermsSSE2(const u8* frame, s32 terms[16]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = _mm_set1_epi16(0xF);
+    const __m128i eight = _mm_set1_epi16(8);
+    const __m128i shift = _mm_cvtsi32_si128((frame[0] & 0xF) + 11);
+    const __m128i bias = _mm_set1_epi32(1024);
+
+    // drop the header byte; 7 data bytes widen to 16 bits, then split into high and low nibbles
+    __m128i bytes = _mm_unpacklo_epi8(_mm_srli_si128(_mm_loadl_epi64((const __m128i*)frame), 1), zero);
+    __m128i hi = _mm_srli_epi16(bytes, 4);
+    __m128i lo = _mm_and_si128(bytes, low);
+    __m128i first = _mm_sub_epi16(_mm_xor_si128(_mm_unpacklo_epi16(hi, lo), eight), eight);
+    __m128i second = _mm_sub_epi16(_mm_xor_si128(_mm_unpackhi_epi16(hi, lo), eight), eight);
+
+    _mm_storeu_si128((__m128i*)&terms[0],
+                     _mm_add_epi32(_mm_sll_epi32(_mm_unpacklo_epi16(first, _mm_srai_epi16(first, 15)), shift), bias));
+    _mm_storeu_si128((__m128i*)&terms[4],
+                     _mm_add_epi32(_mm_sll_epi32(_mm_unpackhi_epi16(first, _mm_srai_epi16(first, 15)), shift), bias));
+    _mm_storeu_si128((__m128i*)&terms[8],
+                     _mm_add_epi32(_mm_sll_epi32(_mm_unpacklo_epi16(second, _mm_srai_epi16(second, 15)), shift), bias));
+    _mm_storeu_si128((__m128i*)&terms[12],
+                     _mm_add_epi32(_mm_sll_epi32(_mm_unpackhi_epi16(second, _mm_srai_epi16(second, 15)), shift), bias));
+}
+#endif
+
+static void AdpcmDecodeFrame(const u8* frame, const s16* coefs, AdpcmState* state, s16* out, AdpcmImpl impl) {
+    s32 terms[16];
+    s32 c1;
+    s32 c2;
+    s32 h1;
+    s32 h2;
+    s32 sample;
+    s32 i;
+
+#ifdef ADPCM_HAVE_SSE2_BUILD
+    if (impl == ADPCM_IMPL_SSE2) {
+        AdpcmFrameTermsSSE2(frame, terms);
+    } else
+#endif
+    {
+        AdpcmFrameTermsScalar(frame, terms);
+    }
+
+    // the predictor recurrence is inherently serial
+    c1 = coefs[(frame[0] >> 4 & 7) * 2];
+    c2 = coefs[(frame[0] >> 4 & 7) * 2 + 1];
+    h1 = state->hist1;
+    h2 = state->hist2;
+
+    for (i = 0; i < ADPCM_SAMPLES_PER_FRAME; i++) {
+        sample = clamp16((terms[i] + c1 * h1 + c2 * h2) >> 11);
+        out[i] = (s16)sample;
+        h2 = h1;
+        h1 = sample;
+    }
+
+    state->hist1 = h1;
+    state->hist2 = h2;
+}
+
+u32 AdpcmDecode(const u8* data, const AdpcmInfo* info, u32 startNibble, u32 endNibble, u32 loopNibble, s16* out,
+                u32 numSamples, AdpcmImpl impl) {
+    AdpcmState state;
+    u32 addr;
+    u32 written;
+    u32 ps;
+    s32 nibble;
+    s32 sample;
+    s32 c1;
+    s32 c2;
+
+    state.hist1 = info->yn1;
+    state.hist2 = info->yn2;
+    ps = info->predScale;
+    addr = startNibble;
+    written = 0;
+
+    while (written < numSamples) {
+        if (addr > endNibble) {
+            if (loopNibble == ~0u) {
+                break;
+            }
+
+            // history carries over, the predictor/scale comes from the loop context until the next frame header
+            addr = loopNibble;
+            ps = info->loopPredScale;
+        }
+
+        if ((addr % ADPCM_NIBBLES_PER_FRAME) < 2) {
+            addr = ALIGN_PREV(addr, ADPCM_NIBBLES_PER_FRAME);
+            ps = data[addr / 2];
+            addr += 2;
+
+            if (addr + ADPCM_SAMPLES_PER_FRAME - 1 <= endNibble && numSamples - written >= ADPCM_SAMPLES_PER_FRAME) {
+                AdpcmDecodeFrame(&data[(addr - 2) / 2], info->coefs, &state, &out[written], impl);
+                written += ADPCM_SAMPLES_PER_FRAME;
+                addr += ADPCM_SAMPLES_PER_FRAME;
+                continue;
+            }
+        }
+
+        nibble = (addr & 1) ? (data[addr / 2] & 0xF) : (data[addr / 2] >> 4);
+        nibble = (nibble ^ 8) - 8;
+        c1 = info->coefs[(ps >> 4 & 7) * 2];
+        c2 = info->coefs[(ps >> 4 & 7) * 2 + 1];
+        sample = clamp16((nibble * (1 << (ps & 0xF)) * 2048 + 1024 + c1 * state.hist1 + c2 * state.hist2) >> 11);
+
+        out[written++] = (s16)sample;
+        state.hist2 = state.hist1;
+        state.hist1 = sample;
+        addr++;
+    }
+
+    return written;
+}
+
+// Autocorrelation of a frame against its two predecessors: r[i][j] = sum x[n-i] * x[n-j]
+typedef struct AdpcmFrameStats {
+    f64 r[3][3];
+} AdpcmFrameStats;
+
+static void AdpcmComputeStats(const s16* pcm, u32 numSamples, u32 frame, AdpcmFrameStats* stats) {
+    f64 x[3];
+    u32 n;
+    u32 i;
+    u32 j;
+    s32 k;
+
+    memset(stats, 0, sizeof(*stats));
+    for (n = frame * ADPCM_SAMPLES_PER_FRAME; n < (frame + 1) * ADPCM_SAMPLES_PER_FRAME && n < numSamples; n++) {
+        for (k = 0; k < 3; k++) {
+            x[k] = n >= (u32)k ? pcm[n - k] : 0.0;
+        }
+        for (i = 0; i < 3; i++) {
+            for (j = 0; j < 3; j++) {
+                stats->r[i][j] += x[i] * x[j];
+            }
+        }
+    }
+}
+
+static f64 AdpcmPredictionError(const AdpcmFrameStats* s, const f64 c[2]) {
+    return s->r[0][0] - 2.0 * c[0] * s->r[0][1] - 2.0 * c[1] * s->r[0][2] + c[0] * c[0] * s->r[1][1] +
+           2.0 * c[0] * c[1] * s->r[1][2] + c[1] * c[1] * s->r[2][2];
+}
+
+// Least-squares predictor for summed statistics, with a little ridge so silent frames stay well conditioned
+static void AdpcmSolve(const AdpcmFrameStats* s, f64 c[2]) {
+    f64 a = s->r[1][1] + 1.0;
+    f64 b = s->r[1][2];
+    f64 d = s->r[2][2] + 1.0;
+    f64 det = a * d - b * b;
+
+    if (fabs(det) < 1e-9) {
+        c[0] = c[1] = 0.0;
+        return;
+    }
+
+    c[0] = (s->r[0][1] * d - s->r[0][2] * b) / det;
+    c[1] = (s->r[0][2] * a - s->r[0][1] * b) / det;
+
+    // keep the filter inside the range 4.11 coefficients can express
+    c[0] = c[0] > 15.99 ? 15.99 : (c[0] < -16.0 ? -16.0 : c[0]);
+    c[1] = c[1] > 15.99 ? 15.99 : (c[1] < -16.0 ? -16.0 : c[1]);
+}
+
+static void AdpcmAssign(const std::vector<AdpcmFrameStats>& stats, const f64 centroids[8][2], std::vector<u8>& labels,
+                        u32 begin, u32 end) {
+    f64 best;
+    f64 err;
+    u32 f;
+    s32 k;
+
+    for (f = begin; f < end; f++) {
+        best = AdpcmPredictionError(&stats[f], centroids[0]);
+        labels[f] = 0;
+        for (k = 1; k < 8; k++) {
+            err = AdpcmPredictionError(&stats[f], centroids[k]);
+            if (err < best) {
+                best = err;
+                labels[f] = (u8)k;
+            }
+        }
+    }
+}
+
+static void AdpcmFindCoefs(const s16* pcm, u32 numSamples, u32 numThreads, s16 coefs[16]) {
+    std::vector<AdpcmFrameStats> stats;
+    std::vector<u8> labels;
+    std::vector<std::thread> threads;
+    AdpcmFrameStats sums[8];
+    f64 centroids[8][2];
+    f64 c[2];
+    u32 numFrames;
+    u32 chunk;
+    u32 f;
+    u32 t;
+    s32 iter;
+    s32 k;
+    s32 i;
+    s32 j;
+
+    numFrames = (numSamples + ADPCM_SAMPLES_PER_FRAME - 1) / ADPCM_SAMPLES_PER_FRAME;
+    stats.resize(numFrames);
+    labels.resize(numFrames);
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    chunk = (numFrames + numThreads - 1) / numThreads;
+
+    for (t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (u32 fr = t * chunk; fr < (t + 1) * chunk && fr < numFrames; fr++) {
+                AdpcmComputeStats(pcm, numSamples, fr, &stats[fr]);
+            }
+        });
+    }
+    for (t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+    threads.clear();
+
+    // seed with per-frame solutions spread evenly over the sound, plus the zero predictor
+    for (k = 0; k < 8; k++) {
+        if (k == 0 || numFrames == 0) {
+            centroids[k][0] = centroids[k][1] = 0.0;
+        } else {
+            AdpcmSolve(&stats[(u64)numFrames * k / 8], centroids[k]);
+        }
+    }
+
+    for (iter = 0; iter < 16; iter++) {
+        for (t = 0; t < numThreads; t++) {
+            threads.emplace_back(AdpcmAssign, std::cref(stats), centroids, std::ref(labels), t * chunk,
+                                 (t + 1) * chunk < numFrames ? (t + 1) * chunk : numFrames);
+        }
+        for (t = 0; t < threads.size(); t++) {
+            threads[t].join();
+        }
+        threads.clear();
+
+        memset(sums, 0, sizeof(sums));
+        for (f = 0; f < numFrames; f++) {
+            for (i = 0; i < 3; i++) {
+                for (j = 0; j < 3; j++) {
+                    sums[labels[f]].r[i][j] += stats[f].r[i][j];
+                }
+            }
+        }
+
+        for (k = 1; k < 8; k++) {
+            if (sums[k].r[0][0] > 0.0) {
+                AdpcmSolve(&sums[k], c);
+                centroids[k][0] = c[0];
+                centroids[k][1] = c[1];
+            }
+        }
+    }
+
+    for (k = 0; k < 8; k++) {
+        coefs[k * 2] = (s16)clamp16((s32)lrint(centroids[k][0] * 2048.0));
+        coefs[k * 2 + 1] = (s16)clamp16((s32)lrint(centroids[k][1] * 2048.0));
+    }
+}
+
+// Encodes one frame with a given predictor and scale, simulating the decoder so history stays exact
+static f64 AdpcmTryFrame(const s16* pcm, u32 count, const s16* coefs, u32 pred, u32 shift, const AdpcmState* in,
+                         AdpcmState* out, u8 nibbles[ADPCM_SAMPLES_PER_FRAME]) {
+    s32 c1 = coefs[pred * 2];
+    s32 c2 = coefs[pred * 2 + 1];
+    s32 h1 = in->hist1;
+    s32 h2 = in->hist2;
+    s32 scale = 1 << shift;
+    s32 step = 2048 << shift;
+    s32 residual;
+    s32 predicted;
+    s32 nibble;
+    s32 sample;
+    f64 err;
+    f64 diff;
+    u32 i;
+
+    err = 0.0;
+    for (i = 0; i < ADPCM_SAMPLES_PER_FRAME; i++) {
+        sample = i < count ? pcm[i] : 0;
+        predicted = c1 * h1 + c2 * h2 + 1024;
+
+        // round the residual to the nearest representable step
+        residual = sample * 2048 - predicted;
+        nibble = (residual + (residual >= 0 ? step / 2 : -step / 2)) / step;
+        nibble = nibble > 7 ? 7 : (nibble < -8 ? -8 : nibble);
+
+        sample = clamp16((nibble * scale * 2048 + predicted) >> 11);
+        if (i < count) {
+            diff = (f64)pcm[i] - sample;
+            err += diff * diff;
+        }
+
+        nibbles[i] = (u8)(nibble & 0xF);
+        h2 = h1;
+        h1 = sample;
+    }
+
+    out->hist1 = h1;
+    out->hist2 = h2;
+    return err;
+}
+
+// Tries all eight predictors at every scale on frame f and keeps the one with the least squared error
+static void AdpcmEncodeFrame(const s16* pcm, u32 numSamples, u32 f, const s16* coefs, const AdpcmState* in, u8* frame,
+                             AdpcmState* out) {
+    AdpcmState trial;
+    u8 nibbles[ADPCM_SAMPLES_PER_FRAME];
+    u8 bestNibbles[ADPCM_SAMPLES_PER_FRAME];
+    u32 bestPs;
+    u32 count;
+    u32 pred;
+    u32 shift;
+    u32 i;
+    f64 bestErr;
+    f64 err;
+
+    count = numSamples - f * ADPCM_SAMPLES_PER_FRAME;
+    if (count > ADPCM_SAMPLES_PER_FRAME) {
+        count = ADPCM_SAMPLES_PER_FRAME;
+    }
+
+    bestErr = -1.0;
+    bestPs = 0;
+    for (pred = 0; pred < 8; pred++) {
+        for (shift = 0; shift <= 12; shift++) {
+            err = AdpcmTryFrame(&pcm[f * ADPCM_SAMPLES_PER_FRAME], count, coefs, pred, shift, in, &trial, nibbles);
+            if (bestErr < 0.0 || err < bestErr) {
+                bestErr = err;
+                bestPs = (pred << 4) | shift;
+                *out = trial;
+                memcpy(bestNibbles, nibbles, sizeof(nibbles));
+            }
+        }
+    }
+
+    frame[0] = (u8)bestPs;
+    for (i = 0; i < ADPCM_SAMPLES_PER_FRAME; i += 2) {
+        frame[1 + i / 2] = (u8)((bestNibbles[i] << 4) | bestNibbles[i + 1]);
+    }
+}
+
+// Encodes frames [begin, end) starting from the history in; ends[f] receives the decoder history after frame f
+static void AdpcmEncodeRange(const s16* pcm, u32 numSamples, const s16* coefs, u32 begin, u32 end, AdpcmState in,
+                             u8* out, AdpcmState* ends) {
+    u32 f;
+
+    for (f = begin; f < end; f++) {
+        AdpcmEncodeFrame(pcm, numSamples, f, coefs, f == begin ? &in : &ends[f - 1], &out[f * ADPCM_BYTES_PER_FRAME],
+                         &ends[f]);
+    }
+}
+
+// What a range starting at frame f assumes the decoder history to be: the source samples, which the decoded ones
+// are usually within a few LSBs of
+static AdpcmState AdpcmGuessHistory(const s16* pcm, u32 f) {
+    AdpcmState state;
+
+    state.hist1 = f > 0 ? pcm[f * ADPCM_SAMPLES_PER_FRAME - 1] : 0;
+    state.hist2 = f > 0 ? pcm[f * ADPCM_SAMPLES_PER_FRAME - 2] : 0;
+    return state;
+}
+
+static inline bool AdpcmSameState(const AdpcmState* a, const AdpcmState* b) {
+    return a->hist1 == b->hist1 && a->hist2 == b->hist2;
+}
+
+void AdpcmEncode(const s16* pcm, u32 numSamples, u32 loopStart, u32 numThreads, std::vector<u8>& out,
+                 AdpcmInfo* info) {
+    std::vector<AdpcmState> ends;
+    std::vector<std::thread> threads;
+    AdpcmState state;
+    u32 numFrames;
+    u32 chunk;
+    u32 begin;
+    u32 end;
+    u32 f;
+    u32 t;
+    std::vector<s16> decoded;
+
+    memset(info, 0, sizeof(*info));
+    AdpcmFindCoefs(pcm, numSamples, numThreads, info->coefs);
+
+    numFrames = (numSamples + ADPCM_SAMPLES_PER_FRAME - 1) / ADPCM_SAMPLES_PER_FRAME;
+    out.assign(numFrames * ADPCM_BYTES_PER_FRAME, 0);
+    ends.resize(numFrames);
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    chunk = (numFrames + numThreads - 1) / numThreads;
+
+    // Each frame's search depends on the history the previous frame leaves, so the ranges after the first start
+    // from a guess and are encoded speculatively, all at once
+    for (t = 0; t < numThreads && t * chunk < numFrames; t++) {
+        begin = t * chunk;
+        end = begin + chunk < numFrames ? begin + chunk : numFrames;
+        threads.emplace_back(AdpcmEncodeRange, pcm, numSamples, (const s16*)info->coefs, begin, end,
+                             AdpcmGuessHistory(pcm, begin), out.data(), ends.data());
+    }
+    for (t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+
+    // then, in order, each range is re-encoded from the real history until it reaches a history the speculative
+    // pass also reached; from there on its frames are already what a serial encode gives
+    for (t = 1; t < threads.size(); t++) {
+        begin = t * chunk;
+        end = begin + chunk < numFrames ? begin + chunk : numFrames;
+        state = AdpcmGuessHistory(pcm, begin);
+        if (AdpcmSameState(&ends[begin - 1], &state)) {
+            continue;
+        }
+
+        for (f = begin; f < end; f++) {
+            AdpcmEncodeFrame(pcm, numSamples, f, info->coefs, &ends[f - 1], &out[f * ADPCM_BYTES_PER_FRAME], &state);
+            if (AdpcmSameState(&state, &ends[f])) {
+                break;
+            }
+            ends[f] = state;
+        }
+    }
+
+    info->predScale = numFrames > 0 ? out[0] : 0;
+
+    if (loopStart != ~0u && loopStart < numSamples) {
+        decoded.resize(loopStart + 1);
+        AdpcmDecode(out.data(), info, 2, AdpcmSampleToNibble(numSamples - 1), ~0u, decoded.data(), loopStart,
+                    ADPCM_IMPL_SCALAR);
+        info->loopPredScale = out[(loopStart / ADPCM_SAMPLES_PER_FRAME) * ADPCM_BYTES_PER_FRAME];
+        info->loopYn1 = loopStart >= 1 ? decoded[loopStart - 1] : 0;
+        info->loopYn2 = loopStart >= 2 ? decoded[loopStart - 2] : 0;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef _SPADPCM_ADPCM_H
+#define _SPADPCM_ADPCM_H
+
+#include "../common/types.h"
+
+#include <vector>
+
+// DSP-ADPCM as consumed by AX: 8-byte frames holding a predictor/scale byte and 14 4-bit samples. Addresses are in
+// nibbles, the first sample of a frame sits at nibble 2.
+
+#define ADPCM_SAMPLES_PER_FRAME 14
+#define ADPCM_NIBBLES_PER_FRAME 16
+#define ADPCM_BYTES_PER_FRAME 8
+
+typedef struct AdpcmInfo {
+    s16 coefs[16];
+    u16 gain;
+    u16 predScale;
+    s16 yn1;
+    s16 yn2;
+    u16 loopPredScale;
+    s16 loopYn1;
+    s16 loopYn2;
+} AdpcmInfo;
+
+typedef struct AdpcmState {
+    s32 hist1;
+    s32 hist2;
+} AdpcmState;
+
+typedef enum AdpcmImpl {
+    ADPCM_IMPL_SCALAR,
+    ADPCM_IMPL_SSE2,
+} AdpcmImpl;
+
+static inline u32 AdpcmNibbleToSample(u32 nibble) {
+    return (nibble / ADPCM_NIBBLES_PER_FRAME) * ADPCM_SAMPLES_PER_FRAME + (nibble % ADPCM_NIBBLES_PER_FRAME) - 2;
+}
+
+static inline u32 AdpcmSampleToNibble(u32 sample) {
+    return (sample / ADPCM_SAMPLES_PER_FRAME) * ADPCM_NIBBLES_PER_FRAME + (sample % ADPCM_SAMPLES_PER_FRAME) + 2;
+}
+
+// Decodes the nibble range [startNibble, endNibble] (inclusive, the way AX end addresses work). When loopNibble is
+// not ~0 the decoder jumps back there after endNibble until numSamples samples have been produced; like a
+// non-streaming AX voice it keeps its history and takes the predictor/scale from info->loopPredScale. Returns the
+// number of samples written.
+u32 AdpcmDecode(const u8* data, const AdpcmInfo* info, u32 startNibble, u32 endNibble, u32 loopNibble, s16* out,
+                u32 numSamples, AdpcmImpl impl);
+
+// Encodes PCM into DSP-ADPCM. The eight predictor pairs are found with a k-means search over per-frame linear
+// prediction statistics, and each frame takes the predictor and scale with the least error. Both passes are split
+// across numThreads threads; the output is the same for any thread count. loopStart is a sample index or ~0.
+void AdpcmEncode(const s16* pcm, u32 numSamples, u32 loopStart, u32 numThreads, std::vector<u8>& out,
+                 AdpcmInfo* info);
+
+bool AdpcmHaveSSE2(void);
+
+#endif
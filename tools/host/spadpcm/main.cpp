@@ -0,0 +1,513 @@
+#include "soundtable.h"
+#include "../common/file.h"
+#include "../common/test.h"
+
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+// CRC-32 of the bytes and the AdpcmInfo AdpcmEncode produces for makeEncoderInput, from the serial encoder
+#define ENCODER_REFERENCE_CRC 0xCB8D3F15u
+
+static void usage(void) {
+    fprintf(stderr, "usage: spadpcm list <table.spt>\n"
+                    "       spadpcm decode <table.spt> <data.spd> <outdir> [threads] [--scalar]\n"
+                    "       spadpcm encode <in.wav> <out.dsp> [loopStart] [threads]\n"
+                    "       spadpcm bench [seconds of audio] [threads]\n"
+                    "       spadpcm test\n");
+}
+
+static inline void putLE16(u8* p, u16 v) {
+    p[0] = (u8)v;
+    p[1] = (u8)(v >> 8);
+}
+
+static inline void putLE32(u8* p, u32 v) {
+    putLE16(p, (u16)v);
+    putLE16(p + 2, (u16)(v >> 16));
+}
+
+static inline u32 getLE32(const u8* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24); }
+
+static bool writeWav(const char* path, const s16* pcm, u32 numSamples, u32 sampleRate) {
+    u8 header[44];
+    std::vector<u8> body(numSamples * 2);
+    FILE* file;
+    u32 i;
+
+    memcpy(&header[0], "RIFF", 4);
+    putLE32(&header[4], 36 + numSamples * 2);
+    memcpy(&header[8], "WAVEfmt ", 8);
+    putLE32(&header[16], 16);
+    putLE16(&header[20], 1);
+    putLE16(&header[22], 1);
+    putLE32(&header[24], sampleRate);
+    putLE32(&header[28], sampleRate * 2);
+    putLE16(&header[32], 2);
+    putLE16(&header[34], 16);
+    memcpy(&header[36], "data", 4);
+    putLE32(&header[40], numSamples * 2);
+
+    for (i = 0; i < numSamples; i++) {
+        putLE16(&body[i * 2], (u16)pcm[i]);
+    }
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header) || fwrite(body.data(), 1, body.size(), file) !=
+                                                                          body.size()) {
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+// Mono 16-bit PCM only; stereo input keeps the left channel
+static bool readWav(const char* path, std::vector<s16>& pcm, u32* sampleRate) {
+    std::vector<u8> data;
+    u32 channels;
+    u32 bits;
+    u32 offset;
+    u32 size;
+    u32 i;
+
+    channels = 0;
+    bits = 0;
+    if (!readFile(path, data) || data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 ||
+        memcmp(&data[8], "WAVE", 4) != 0) {
+        return false;
+    }
+
+    for (offset = 12; offset + 8 <= data.size(); offset += 8 + ALIGN_NEXT(size, 2)) {
+        size = getLE32(&data[offset + 4]);
+        if (offset + 8 + size > data.size()) {
+            return false;
+        }
+
+        if (memcmp(&data[offset], "fmt ", 4) == 0 && size >= 16) {
+            channels = data[offset + 10] | (data[offset + 11] << 8);
+            *sampleRate = getLE32(&data[offset + 12]);
+            bits = data[offset + 22] | (data[offset + 23] << 8);
+        } else if (memcmp(&data[offset], "data", 4) == 0) {
+            if (channels == 0 || bits != 16) {
+                return false;
+            }
+            pcm.resize(size / (2 * channels));
+            for (i = 0; i < pcm.size(); i++) {
+                pcm[i] = (s16)(data[offset + 8 + i * channels * 2] | (data[offset + 9 + i * channels * 2] << 8));
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static const char* sTypeNames[] = {
+    "adpcm", "adpcm loop", "pcm16", "pcm16 loop", "pcm8", "pcm8 loop",
+};
+
+static int list(int argc, char** argv) {
+    std::vector<u8> spt;
+    std::vector<SpSound> sounds;
+    u32 i;
+
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    if (!readFile(argv[2], spt) || !SpParseTable(spt.data(), (u32)spt.size(), sounds)) {
+        fprintf(stderr, "spadpcm: %s is not a sound table\n", argv[2]);
+        return 1;
+    }
+
+    for (i = 0; i < sounds.size(); i++) {
+        printf("%3u: %-10s %5u Hz %7u samples, addr %08X-%08X", i, sTypeNames[sounds[i].type], sounds[i].sampleRate,
+               SpGetNumSamples(&sounds[i]), sounds[i].currentAddr, sounds[i].endAddr);
+        if (SpIsLooped(&sounds[i])) {
+            printf(", loop %08X", sounds[i].loopAddr);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+static int decode(int argc, char** argv) {
+    std::vector<u8> spt;
+    std::vector<u8> spd;
+    std::vector<SpSound> sounds;
+    std::vector<std::thread> threads;
+    std::atomic<u32> next(0);
+    std::atomic<u32> failures(0);
+    std::chrono::steady_clock::time_point start;
+    AdpcmImpl impl;
+    u32 numThreads;
+    u32 totalSamples;
+    double seconds;
+    u32 i;
+    int arg;
+
+    if (argc < 5) {
+        usage();
+        return 1;
+    }
+
+    numThreads = std::thread::hardware_concurrency();
+    impl = AdpcmHaveSSE2() ? ADPCM_IMPL_SSE2 : ADPCM_IMPL_SCALAR;
+    for (arg = 5; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--scalar") == 0) {
+            impl = ADPCM_IMPL_SCALAR;
+        } else {
+            numThreads = (u32)atoi(argv[arg]);
+        }
+    }
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+
+    if (!readFile(argv[2], spt) || !SpParseTable(spt.data(), (u32)spt.size(), sounds)) {
+        fprintf(stderr, "spadpcm: %s is not a sound table\n", argv[2]);
+        return 1;
+    }
+    if (!readFile(argv[3], spd)) {
+        fprintf(stderr, "spadpcm: can't read %s\n", argv[3]);
+        return 1;
+    }
+
+    totalSamples = 0;
+    for (i = 0; i < sounds.size(); i++) {
+        totalSamples += SpGetNumSamples(&sounds[i]);
+    }
+
+    // entries are independent, so the table is split dynamically across the workers
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < numThreads; i++) {
+        threads.emplace_back([&]() {
+            std::vector<s16> pcm;
+            std::string path;
+            char name[16];
+            u32 index;
+
+            while ((index = next++) < sounds.size()) {
+                snprintf(name, sizeof(name), "/%03u.wav", index);
+                path = std::string(argv[4]) + name;
+                if (!SpDecodeSound(&sounds[index], spd.data(), (u32)spd.size(), pcm, impl) ||
+                    !writeWav(path.c_str(), pcm.data(), (u32)pcm.size(), sounds[index].sampleRate)) {
+                    fprintf(stderr, "spadpcm: failed to decode entry %u\n", index);
+                    failures++;
+                }
+            }
+        });
+    }
+    for (i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%u sounds, %u samples in %.3f s on %u threads (%.1f Msamples/s)\n", (u32)sounds.size(), totalSamples,
+           seconds, numThreads, totalSamples / seconds / 1e6);
+    return failures != 0;
+}
+
+static int encode(int argc, char** argv) {
+    std::vector<s16> pcm;
+    std::vector<u8> adpcm;
+    AdpcmInfo info;
+    u8 header[0x60];
+    u32 sampleRate = 0;
+    u32 loopStart;
+    u32 numThreads;
+    u32 numNibbles;
+    FILE* file;
+    s32 i;
+
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+
+    loopStart = argc > 4 ? (u32)atoi(argv[4]) : ~0u;
+    numThreads = argc > 5 ? (u32)atoi(argv[5]) : std::thread::hardware_concurrency();
+
+    if (!readWav(argv[2], pcm, &sampleRate) || pcm.empty()) {
+        fprintf(stderr, "spadpcm: %s is not a 16-bit PCM wav file\n", argv[2]);
+        return 1;
+    }
+
+    AdpcmEncode(pcm.data(), (u32)pcm.size(), loopStart, numThreads, adpcm, &info);
+    numNibbles = AdpcmSampleToNibble((u32)pcm.size() - 1) + 1;
+
+    // standard 0x60-byte DSP header, big-endian
+    memset(header, 0, sizeof(header));
+    host_put_be32(&header[0x00], (u32)pcm.size());
+    host_put_be32(&header[0x04], numNibbles);
+    host_put_be32(&header[0x08], sampleRate);
+    host_put_be16(&header[0x0C], loopStart != ~0u);
+    host_put_be32(&header[0x10], loopStart != ~0u ? AdpcmSampleToNibble(loopStart) : 2);
+    host_put_be32(&header[0x14], numNibbles - 1);
+    host_put_be32(&header[0x18], 2);
+    for (i = 0; i < 16; i++) {
+        host_put_be16(&header[0x1C + i * 2], (u16)info.coefs[i]);
+    }
+    host_put_be16(&header[0x3C], info.gain);
+    host_put_be16(&header[0x3E], info.predScale);
+    host_put_be16(&header[0x40], (u16)info.yn1);
+    host_put_be16(&header[0x42], (u16)info.yn2);
+    host_put_be16(&header[0x44], info.loopPredScale);
+    host_put_be16(&header[0x46], (u16)info.loopYn1);
+    host_put_be16(&header[0x48], (u16)info.loopYn2);
+
+    file = fopen(argv[3], "wb");
+    if (file == NULL || fwrite(header, 1, sizeof(header), file) != sizeof(header) ||
+        fwrite(adpcm.data(), 1, adpcm.size(), file) != adpcm.size()) {
+        fprintf(stderr, "spadpcm: can't write %s\n", argv[3]);
+        return 1;
+    }
+    fclose(file);
+
+    printf("%u samples -> %u bytes\n", (u32)pcm.size(), (u32)adpcm.size());
+    return 0;
+}
+
+static double benchDecode(const u8* data, const AdpcmInfo* info, u32 numSamples, s16* out, AdpcmImpl impl) {
+    std::chrono::steady_clock::time_point start;
+    double seconds;
+    u32 iterations;
+    u32 i;
+
+    iterations = 20;
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        AdpcmDecode(data, info, 2, AdpcmSampleToNibble(numSamples - 1), ~0u, out, numSamples, impl);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return (double)numSamples * iterations / seconds / 1e6;
+}
+
+static double benchEncode(const s16* pcm, u32 numSamples, u32 numThreads, std::vector<u8>& out, AdpcmInfo* info) {
+    std::chrono::steady_clock::time_point start;
+    double seconds;
+
+    start = std::chrono::steady_clock::now();
+    AdpcmEncode(pcm, numSamples, ~0u, numThreads, out, info);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return numSamples / seconds / 1e6;
+}
+
+static int bench(int argc, char** argv) {
+    std::vector<s16> pcm;
+    std::vector<s16> scalarOut;
+    std::vector<s16> sse2Out;
+    std::vector<u8> adpcm;
+    AdpcmInfo info;
+    u32 numSamples;
+    u32 numThreads;
+    u32 loopNibble;
+    double error;
+    double signal;
+    double diff;
+    u32 i;
+
+    numSamples = (u32)((argc > 2 ? atof(argv[2]) : 10.0) * 32000);
+    numThreads = argc > 3 ? (u32)atoi(argv[3]) : std::thread::hardware_concurrency();
+    if (numSamples == 0) {
+        usage();
+        return 1;
+    }
+
+    // a few decaying partials plus noise, roughly what the sound effect banks hold
+    pcm.resize(numSamples);
+    srand(1);
+    for (i = 0; i < numSamples; i++) {
+        double t = i / 32000.0;
+        double env = 0.5 + 0.5 * sin(t * 1.7);
+        double v = env * (8000.0 * sin(t * 2 * M_PI * 440.0) + 3000.0 * sin(t * 2 * M_PI * 1230.0)) +
+                   (rand() % 1024 - 512);
+        pcm[i] = (s16)v;
+    }
+
+    printf("encode, 1 thread:   %.2f Msamples/s\n", benchEncode(pcm.data(), numSamples, 1, adpcm, &info));
+    printf("encode, %u threads: %.2f Msamples/s\n", numThreads,
+           benchEncode(pcm.data(), numSamples, numThreads, adpcm, &info));
+
+    scalarOut.resize(numSamples);
+    sse2Out.resize(numSamples);
+    printf("decode, scalar:     %.1f Msamples/s\n",
+           benchDecode(adpcm.data(), &info, numSamples, scalarOut.data(), ADPCM_IMPL_SCALAR));
+
+    error = 0.0;
+    signal = 0.0;
+    for (i = 0; i < numSamples; i++) {
+        diff = (double)pcm[i] - scalarOut[i];
+        error += diff * diff;
+        signal += (double)pcm[i] * pcm[i];
+    }
+    printf("round trip SNR:     %.1f dB\n", 10.0 * log10(signal / (error > 0.0 ? error : 1.0)));
+
+    if (!AdpcmHaveSSE2()) {
+        printf("decode, sse2: not supported on this CPU\n");
+        return 0;
+    }
+
+    printf("decode, sse2:       %.1f Msamples/s\n",
+           benchDecode(adpcm.data(), &info, numSamples, sse2Out.data(), ADPCM_IMPL_SSE2));
+    if (scalarOut != sse2Out) {
+        printf("sse2 output differs from the scalar reference\n");
+        return 1;
+    }
+
+    // loop back mid-frame and run through the end twice, which exercises the partial-frame paths
+    loopNibble = AdpcmSampleToNibble(numSamples / 3);
+    scalarOut.resize(numSamples * 2);
+    sse2Out.resize(numSamples * 2);
+    AdpcmDecode(adpcm.data(), &info, 2, AdpcmSampleToNibble(numSamples - 1), loopNibble, scalarOut.data(),
+                numSamples * 2, ADPCM_IMPL_SCALAR);
+    AdpcmDecode(adpcm.data(), &info, 2, AdpcmSampleToNibble(numSamples - 1), loopNibble, sse2Out.data(),
+                numSamples * 2, ADPCM_IMPL_SSE2);
+    if (scalarOut != sse2Out) {
+        printf("sse2 looped output differs from the scalar reference\n");
+        return 1;
+    }
+    printf("sse2 output matches the scalar reference bit for bit\n");
+
+    return 0;
+}
+
+// Five frames whose output follows by hand from the DSP-ADPCM recurrence, out = (n << shift << 11 + 1024 +
+// c1 * h1 + c2 * h2) >> 11 clamped to 16 bits: a bare scale, an accumulator, a linear extrapolator, a rounding
+// halver and saturation both ways
+static const u8 sRefFrames[5 * ADPCM_BYTES_PER_FRAME] = {
+    0x02, 0x1F, 0x78, 0x02, 0xE3, 0xD4, 0xC5, 0xB6, // pred 0, scale 4: 4 * n
+    0x10, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, // pred 1 (1.0), n = 7: +7 a sample
+    0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // pred 2 (2.0, -1.0), n = 0: keeps going up by 7
+    0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // pred 3 (0.5), n = 0: (h + 1) / 2
+    0x1C, 0x77, 0x78, 0x88, 0x80, 0x00, 0x00, 0x00, // pred 1, scale 4096: clamps at both ends
+};
+
+static const s16 sRefSamples[5 * ADPCM_SAMPLES_PER_FRAME + 5] = {
+    4,      -4,     28,     -32,    0,      8,      -8,     12,     -12,    16,     -16,    20,     -20,    24,
+    31,     38,     45,     52,     59,     66,     73,     80,     87,     94,     101,    108,    115,    122,
+    129,    136,    143,    150,    157,    164,    171,    178,    185,    192,    199,    206,    213,    220,
+    110,    55,     28,     14,     7,      4,      2,      1,      1,      1,      1,      1,      1,      1,
+    28673,  32767,  32767,  -1,     -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768,
+    // looped back to the fourth sample of the second frame with loopPredScale 0x10 and the history carried over
+    -32761, -32754, -32747, -32740, -32733,
+};
+
+// Source for the encoder reference: a chirp over a slow envelope plus a click and a stretch of silence, from an LCG
+// so it's the same with every C library
+static void makeEncoderInput(std::vector<s16>& pcm) {
+    u32 random;
+    double phase;
+    double v;
+    u32 i;
+
+    pcm.resize(20000);
+    random = 1;
+    phase = 0.0;
+    for (i = 0; i < pcm.size(); i++) {
+        random = random * 1664525 + 1013904223;
+        phase += 2 * M_PI * (200.0 + i * 0.1) / 32000.0;
+        v = (0.6 + 0.4 * sin(i / 3000.0)) * 12000.0 * sin(phase) + (s32)((random >> 22) % 512) - 256;
+        if (i >= 9000 && i < 11000) {
+            v = 0.0;
+        }
+        if (i == 15000) {
+            v = 32767.0;
+        }
+        pcm[i] = (s16)v;
+    }
+}
+
+static int test(int argc, char** argv) {
+    static const u32 threadCounts[] = {1, 2, 3, 4, 7, 16};
+    std::vector<s16> pcm;
+    std::vector<u8> reference;
+    std::vector<u8> adpcm;
+    AdpcmInfo refInfo;
+    AdpcmInfo info;
+    s16 out[5 * ADPCM_SAMPLES_PER_FRAME + 5];
+    const char* name;
+    u32 numSamples;
+    u32 decoded;
+    u32 crc;
+    u32 impl;
+    u32 i;
+    bool ok;
+
+    ok = true;
+    memset(&info, 0, sizeof(info));
+    info.coefs[2] = 2048;
+    info.coefs[4] = 4096;
+    info.coefs[5] = -2048;
+    info.coefs[6] = 1024;
+    info.predScale = sRefFrames[0];
+    info.loopPredScale = 0x10;
+
+    numSamples = 5 * ADPCM_SAMPLES_PER_FRAME;
+    for (impl = ADPCM_IMPL_SCALAR; impl <= ADPCM_IMPL_SSE2; impl++) {
+        if (impl == ADPCM_IMPL_SSE2 && !AdpcmHaveSSE2()) {
+            continue;
+        }
+        name = impl == ADPCM_IMPL_SCALAR ? "scalar" : "sse2";
+
+        memset(out, 0, sizeof(out));
+        decoded = AdpcmDecode(sRefFrames, &info, 2, AdpcmSampleToNibble(numSamples - 1), ~0u, out, numSamples,
+                              (AdpcmImpl)impl);
+        if (!expect(decoded == numSamples && memcmp(out, sRefSamples, numSamples * sizeof(s16)) == 0,
+                    "decode of the reference frames")) {
+            ok = false;
+            printf("  with the %s decoder\n", name);
+        }
+
+        decoded = AdpcmDecode(sRefFrames, &info, 2, AdpcmSampleToNibble(numSamples - 1),
+                              AdpcmSampleToNibble(ADPCM_SAMPLES_PER_FRAME + 3), out, numSamples + 5, (AdpcmImpl)impl);
+        if (!expect(decoded == numSamples + 5 && memcmp(out, sRefSamples, sizeof(sRefSamples)) == 0,
+                    "looped decode of the reference frames")) {
+            ok = false;
+            printf("  with the %s decoder\n", name);
+        }
+    }
+
+    // the encoder output is pinned, and must not depend on the thread count
+    makeEncoderInput(pcm);
+    AdpcmEncode(pcm.data(), (u32)pcm.size(), 4000, 1, reference, &refInfo);
+    crc = crc32(reference.data(), reference.size());
+    crc = crc32((const u8*)&refInfo, sizeof(refInfo), crc);
+    ok &= expect(crc == ENCODER_REFERENCE_CRC, "encoder output matches the reference");
+    if (crc != ENCODER_REFERENCE_CRC) {
+        printf("  crc %08X, expected %08X\n", crc, ENCODER_REFERENCE_CRC);
+    }
+
+    for (i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        AdpcmEncode(pcm.data(), (u32)pcm.size(), 4000, threadCounts[i], adpcm, &info);
+        ok &= expect(adpcm == reference && memcmp(&info, &refInfo, sizeof(info)) == 0,
+                     "encoder output is the same for every thread count");
+    }
+
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"list", list},
+    {"decode", decode},
+    {"encode", encode},
+    {"bench", bench},
+    {"test", test},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
@@ -0,0 +1,114 @@
+#include "soundtable.h"
+
+#include <string.h>
+
+static void SpParseAdpcm(const u8* p, AdpcmInfo* info) {
+    s32 i;
+
+    for (i = 0; i < 16; i++) {
+        info->coefs[i] = (s16)host_be16(&p[i * 2]);
+    }
+    info->gain = host_be16(&p[0x20]);
+    info->predScale = host_be16(&p[0x22]);
+    info->yn1 = (s16)host_be16(&p[0x24]);
+    info->yn2 = (s16)host_be16(&p[0x26]);
+    info->loopPredScale = host_be16(&p[0x28]);
+    info->loopYn1 = (s16)host_be16(&p[0x2A]);
+    info->loopYn2 = (s16)host_be16(&p[0x2C]);
+}
+
+bool SpParseTable(const u8* data, u32 size, std::vector<SpSound>& sounds) {
+    SpSound sound;
+    const u8* entry;
+    u32 numEntries;
+    u32 offset;
+    u32 i;
+
+    sounds.clear();
+    if (size < 4) {
+        return false;
+    }
+
+    numEntries = host_be32(data);
+    if ((u64)numEntries * SP_SOUND_ENTRY_SIZE + 4 > size) {
+        return false;
+    }
+
+    for (i = 0; i < numEntries; i++) {
+        entry = &data[4 + i * SP_SOUND_ENTRY_SIZE];
+
+        memset(&sound, 0, sizeof(sound));
+        sound.type = host_be32(&entry[0x00]);
+        sound.sampleRate = host_be32(&entry[0x04]);
+        sound.loopAddr = host_be32(&entry[0x08]);
+        sound.loopEndAddr = host_be32(&entry[0x0C]);
+        sound.endAddr = host_be32(&entry[0x10]);
+        sound.currentAddr = host_be32(&entry[0x14]);
+
+        if (sound.type > SP_TYPE_PCM8_LOOPED || sound.endAddr < sound.currentAddr) {
+            sounds.clear();
+            return false;
+        }
+
+        if (SpIsAdpcm(&sound)) {
+            offset = host_be32(&entry[0x18]);
+            if ((u64)offset + SP_ADPCM_ENTRY_SIZE > size) {
+                sounds.clear();
+                return false;
+            }
+            SpParseAdpcm(&data[offset], &sound.adpcm);
+        }
+
+        sounds.push_back(sound);
+    }
+
+    return true;
+}
+
+u32 SpGetNumSamples(const SpSound* sound) {
+    if (SpIsAdpcm(sound)) {
+        return AdpcmNibbleToSample(sound->endAddr) - AdpcmNibbleToSample(sound->currentAddr) + 1;
+    }
+
+    return sound->endAddr - sound->currentAddr + 1;
+}
+
+bool SpDecodeSound(const SpSound* sound, const u8* spd, u32 spdSize, std::vector<s16>& pcm, AdpcmImpl impl) {
+    std::vector<u8> padded;
+    u32 numSamples;
+    u32 numBytes;
+    u32 addr;
+    u32 i;
+
+    numSamples = SpGetNumSamples(sound);
+    pcm.assign(numSamples, 0);
+
+    switch (sound->type) {
+        case SP_TYPE_ADPCM_ONESHOT:
+        case SP_TYPE_ADPCM_LOOPED:
+            numBytes = sound->endAddr / 2 + 1;
+            if (numBytes > spdSize) {
+                padded.assign(numBytes, 0);
+                memcpy(padded.data(), spd, spdSize);
+                spd = padded.data();
+            }
+            return AdpcmDecode(spd, &sound->adpcm, sound->currentAddr, sound->endAddr, ~0u, pcm.data(), numSamples,
+                               impl) == numSamples;
+        case SP_TYPE_PCM16_ONESHOT:
+        case SP_TYPE_PCM16_LOOPED:
+            for (i = 0; i < numSamples; i++) {
+                addr = (sound->currentAddr + i) * 2;
+                pcm[i] = addr + 1 < spdSize ? (s16)host_be16(&spd[addr]) : 0;
+            }
+            return true;
+        case SP_TYPE_PCM8_ONESHOT:
+        case SP_TYPE_PCM8_LOOPED:
+            for (i = 0; i < numSamples; i++) {
+                addr = sound->currentAddr + i;
+                pcm[i] = addr < spdSize ? (s16)((s8)spd[addr] << 8) : 0;
+            }
+            return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,42 @@
+#ifndef _SPADPCM_SOUNDTABLE_H
+#define _SPADPCM_SOUNDTABLE_H
+
+#include "adpcm.h"
+
+// Host view of the .spt sound tables loaded by SPInitSoundTable. On disc the table is a big-endian entry count
+// followed by 0x1C-byte sound entries; the adpcm field of each entry is an offset from the start of the table.
+// Addresses are relative to the start of the matching .spd sample data, in nibbles for ADPCM, in samples for PCM16
+// and in bytes for PCM8.
+
+#define SP_TYPE_ADPCM_ONESHOT 0
+#define SP_TYPE_ADPCM_LOOPED 1
+#define SP_TYPE_PCM16_ONESHOT 2
+#define SP_TYPE_PCM16_LOOPED 3
+#define SP_TYPE_PCM8_ONESHOT 4
+#define SP_TYPE_PCM8_LOOPED 5
+
+#define SP_SOUND_ENTRY_SIZE 0x1C
+#define SP_ADPCM_ENTRY_SIZE 0x2E
+
+typedef struct SpSound {
+    u32 type;
+    u32 sampleRate;
+    u32 loopAddr;
+    u32 loopEndAddr;
+    u32 endAddr;
+    u32 currentAddr;
+    AdpcmInfo adpcm;
+} SpSound;
+
+static inline bool SpIsAdpcm(const SpSound* sound) { return sound->type <= SP_TYPE_ADPCM_LOOPED; }
+static inline bool SpIsLooped(const SpSound* sound) { return sound->type & 1; }
+
+// Returns false and leaves sounds empty if the table is truncated or an entry has an unknown type
+bool SpParseTable(const u8* data, u32 size, std::vector<SpSound>& sounds);
+
+u32 SpGetNumSamples(const SpSound* sound);
+
+// Decodes one sound to 16-bit PCM. Sample data that runs past the end of the .spd is treated as silence.
+bool SpDecodeSound(const SpSound* sound, const u8* spd, u32 spdSize, std::vector<s16>& pcm, AdpcmImpl impl);
+
+#endif
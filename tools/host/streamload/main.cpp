@@ -0,0 +1,252 @@
+// Host benchmark of the pipelined DVD to ARAM loader (src/menu/streamloader.cpp) on the aramemu backend, with a
+// DVD drive modeled by a thread that completes reads after a per-command latency plus length/bandwidth. One staging
+// buffer is the __AMPushBuffered baseline seInit uses for multiple_se.spd; the filtered runs read 4-bit delta coded
+// data and expand it to 8 bits on the CPU between the DVD read and the DMA.
+
+#include "../aramemu/aramemu.h"
+#include "menu/streamLoader.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct SimRead {
+    DVDFileInfo* fileInfo;
+    u8* addr;
+    u32 length;
+    u32 offset;
+    DVDCallback callback;
+} SimRead;
+
+static double sDVDBytesPerSecond;
+static double sDVDLatencyUs;
+static std::vector<u8>* sDisc;
+
+static std::mutex sDVDLock;
+static std::condition_variable sDVDCond;
+static std::deque<SimRead> sDVDQueue;
+static bool sDVDRunning;
+
+static void simDVDThread(void) {
+    std::unique_lock<std::mutex> lock(sDVDLock);
+    SimRead read;
+    Clock::time_point due;
+
+    while (true) {
+        sDVDCond.wait(lock, [] { return !sDVDRunning || !sDVDQueue.empty(); });
+        if (sDVDQueue.empty()) {
+            break;
+        }
+
+        read = sDVDQueue.front();
+        sDVDQueue.pop_front();
+        lock.unlock();
+
+        due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                                 sDVDLatencyUs / 1e6 + read.length / sDVDBytesPerSecond));
+        std::this_thread::sleep_until(due);
+        memcpy(read.addr, sDisc->data() + read.offset, read.length);
+
+        // DVD callbacks run from the DI interrupt
+        OSDisableInterrupts();
+        read.fileInfo->cb.state = DVD_STATE_END;
+        read.callback((s32)read.length, read.fileInfo);
+        OSEnableInterrupts();
+
+        lock.lock();
+    }
+}
+
+extern "C" {
+BOOL DVDOpen(const char* fileName, DVDFileInfo* fileInfo) {
+    memset(fileInfo, 0, sizeof(*fileInfo));
+    fileInfo->length = (u32)sDisc->size();
+    return true;
+}
+
+BOOL DVDClose(DVDFileInfo* fileInfo) { return true; }
+
+BOOL DVDReadAsyncPrio(DVDFileInfo* fileInfo, void* addr, s32 length, s32 offset, DVDCallback callback, s32 prio) {
+    SimRead read;
+
+    // the same checks the SDK asserts on
+    if (((u32)addr & 0x1F) || (length & 0x1F) || (offset & 3) || (u32)offset >= fileInfo->length ||
+        (u32)offset + length >= fileInfo->length + 32) {
+        return false;
+    }
+
+    read.fileInfo = fileInfo;
+    read.addr = (u8*)addr;
+    read.offset = offset;
+    read.length = (u32)offset + length > fileInfo->length ? fileInfo->length - offset : length;
+    read.callback = callback;
+    fileInfo->cb.state = DVD_STATE_BUSY;
+
+    {
+        std::lock_guard<std::mutex> lock(sDVDLock);
+        sDVDQueue.push_back(read);
+    }
+    sDVDCond.notify_all();
+    return true;
+}
+
+void DCFlushRange(void* addr, u32 nBytes) {}
+}
+
+typedef struct DeltaState {
+    u8 last;
+} DeltaState;
+
+// 4-bit signed deltas, low nibble first, expanded to 8-bit samples. dst and src overlap with src in the upper half
+// of the buffer; every source byte is read before the two bytes it expands to are written.
+static u32 deltaFilter(void* dst, u32 dstSize, const void* src, u32 srcLength, void* userData) {
+    DeltaState* state = (DeltaState*)userData;
+    const u8* in = (const u8*)src;
+    u8* out = (u8*)dst;
+    u8 last = state->last;
+    u8 packed;
+    u32 i;
+
+    if (srcLength * 2 > dstSize) {
+        return dstSize + 1;
+    }
+
+    for (i = 0; i < srcLength; i++) {
+        packed = in[i];
+        last += (u8)((s8)(packed << 4) >> 4);
+        out[i * 2] = last;
+        last += (u8)((s8)packed >> 4);
+        out[i * 2 + 1] = last;
+    }
+
+    state->last = last;
+    return srcLength * 2;
+}
+
+typedef struct BenchResult {
+    double seconds;
+    bool ok;
+} BenchResult;
+
+static BenchResult runLoad(const std::vector<u8>& expected, u32 numBuffers, u32 bufferSize, bool filtered,
+                           u32 aram) {
+    static DeltaState state;
+    StreamLoader loader;
+    SLConfig config;
+    BenchResult result;
+    void* work;
+    u32 written;
+    Clock::time_point start;
+
+    config.numBuffers = numBuffers;
+    config.bufferSize = bufferSize;
+    config.readSize = filtered ? bufferSize / 2 : 0;
+    config.filter = filtered ? deltaFilter : NULL;
+    config.userData = &state;
+    state.last = 0;
+
+    work = aligned_alloc(32, numBuffers * bufferSize);
+    memset(AREmuGetARAM() + aram, 0, expected.size());
+    result.ok = slInit(&loader, &config, work);
+
+    start = Clock::now();
+    written = result.ok ? slLoad(&loader, (char*)"multiple_se.spd", aram) : 0;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    result.ok = written >= expected.size() && memcmp(AREmuGetARAM() + aram, expected.data(), expected.size()) == 0;
+    printf("%s, %lu x %luK%s\n", filtered ? "4-bit delta" : "raw", numBuffers, bufferSize / 1024,
+           result.ok ? "" : ": DATA MISMATCH");
+    slReport(&loader);
+
+    free(work);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    static u32 stack[4];
+    AREmuConfig config;
+    std::vector<u8> samples;
+    std::vector<u8> packed;
+    std::thread dvd;
+    BenchResult serial;
+    BenchResult piped;
+    u32 numBuffers;
+    u32 bufferSize;
+    u32 size;
+    u32 aram;
+    u32 i;
+    u8 last;
+    s32 delta[2];
+    bool ok;
+    s32 filtered;
+
+    numBuffers = argc > 1 ? (u32)atoi(argv[1]) : 4;
+    bufferSize = (argc > 2 ? (u32)atoi(argv[2]) : 16) * 1024;
+    sDVDBytesPerSecond = (argc > 3 ? atof(argv[3]) : 3.0) * 1024 * 1024;
+    size = (argc > 4 ? (u32)atoi(argv[4]) : 2) * 1024 * 1024;
+    sDVDLatencyUs = 100.0;
+    if (numBuffers == 0 || numBuffers > SL_MAX_BUFFERS || bufferSize == 0 || sDVDBytesPerSecond <= 0.0 || size == 0 ||
+        size > AREMU_ARAM_SIZE / 2) {
+        fprintf(stderr, "usage: streamload [buffers, up to %d] [KB per buffer] [DVD MB/s] [file MB, up to 8]\n",
+                SL_MAX_BUFFERS);
+        return 1;
+    }
+
+    config.bytesPerSecond = 80.0 * 1024 * 1024;
+    config.latencyUs = 2.0;
+    AREmuInit(&config);
+    ARInit(stack, 4);
+    ARQInit();
+    aram = ARAlloc(size);
+
+    // a random walk of small steps, so the same samples can also be stored as 4-bit deltas
+    samples.resize(size);
+    packed.resize(size / 2);
+    srand(1);
+    last = 0;
+    for (i = 0; i < size / 2; i++) {
+        delta[0] = rand() % 16 - 8;
+        delta[1] = rand() % 16 - 8;
+        samples[i * 2] = last += (u8)delta[0];
+        samples[i * 2 + 1] = last += (u8)delta[1];
+        packed[i] = (u8)((delta[0] & 0xF) | (delta[1] << 4));
+    }
+
+    sDVDRunning = true;
+    dvd = std::thread(simDVDThread);
+
+    printf("DVD %.1f MB/s + %.0f us per read, ARAM DMA %.1f MB/s, %lu MB of samples\n",
+           sDVDBytesPerSecond / (1024 * 1024), sDVDLatencyUs, config.bytesPerSecond / (1024 * 1024),
+           size / (1024 * 1024));
+
+    ok = true;
+    for (filtered = 0; filtered < 2; filtered++) {
+        sDisc = filtered ? &packed : &samples;
+
+        printf("\n");
+        serial = runLoad(samples, 1, bufferSize, filtered, aram);
+        piped = runLoad(samples, numBuffers, bufferSize, filtered, aram);
+        printf("=> %.1f -> %.1f MB/s effective, %.1f ms of boot time saved\n",
+               size / serial.seconds / (1024 * 1024), size / piped.seconds / (1024 * 1024),
+               (serial.seconds - piped.seconds) * 1000.0);
+        ok &= serial.ok && piped.ok;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sDVDLock);
+        sDVDRunning = false;
+    }
+    sDVDCond.notify_all();
+    dvd.join();
+    AREmuShutdown();
+
+    return !ok;
+}
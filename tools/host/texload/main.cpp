@@ -0,0 +1,534 @@
+// Host test and benchmark of the streaming TPL loader (src/dolphin/tex/texLoader.c) against the current path, which
+// reads the whole palette into one buffer and turns every offset in it into a pointer before anything is used. The
+// drive is a blocking read that takes a per-command latency plus length/bandwidth; ARAM and the OS calls come from
+// aramemu. The palette is built here in the host layout of the tex.h structures, with TexConv's ordering: header,
+// descriptors, one texture and CLUT header per descriptor, then the image and CLUT data.
+
+#include "../aramemu/aramemu.h"
+#include "../common/test.h"
+#include "dolphin/tex.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define PALETTE_VERSION 0x20AF30
+#define NUM_TEXTURES 96
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct Palette {
+    std::vector<u8> file;
+    u32 numDescriptors;
+    u32 clutOnly; // descriptor with a CLUT and no texture
+} Palette;
+
+typedef struct LoadResult {
+    double ms;
+    u32 peak;
+    u32 reads;
+    u32 bytesRead;
+    bool ok;
+} LoadResult;
+
+static double sDVDBytesPerSecond = 3.0 * 1024 * 1024;
+static double sDVDLatencyUs = 100.0;
+static const Palette* sDisc;
+static u32 sNumReads;
+static u32 sBytesRead;
+static u32 sAllocated;
+static u32 sPeak;
+
+extern "C" {
+s32 DVDReadPrio(DVDFileInfo* fileInfo, void* addr, s32 length, s32 offset, s32 prio) {
+    const u8* file = sDisc->file.data();
+
+    // the same checks the SDK asserts on
+    if (((u32)addr & 0x1F) || (length & 0x1F) || (offset & 3) || (u32)offset >= fileInfo->length) {
+        return -1;
+    }
+    if ((u32)offset + length > fileInfo->length) {
+        length = fileInfo->length - offset;
+    }
+
+    std::this_thread::sleep_for(
+        std::chrono::duration<double>(sDVDLatencyUs / 1e6 + length / sDVDBytesPerSecond));
+    memcpy(addr, file + offset, length);
+    sNumReads++;
+    sBytesRead += length;
+    return length;
+}
+
+void DCInvalidateRange(void* addr, u32 nBytes) {}
+
+// From GXTexture.c, which can't be built without the GX registers
+void __GetImageTileCount(GXTexFmt format, u16 width, u16 height, u32* a, u32* b, u32* c) {
+    u32 widthTiles;
+    u32 heightTiles;
+
+    switch (format) {
+    case GX_TF_I4:
+    case GX_TF_C4:
+    case GX_TF_CMPR:
+        widthTiles = 3;
+        heightTiles = 3;
+        break;
+    case GX_TF_I8:
+    case GX_TF_IA4:
+    case GX_TF_C8:
+        widthTiles = 3;
+        heightTiles = 2;
+        break;
+    default:
+        widthTiles = 2;
+        heightTiles = 2;
+        break;
+    }
+
+    *a = (MAX(width, 1) + (1 << widthTiles) - 1) >> widthTiles;
+    *b = (MAX(height, 1) + (1 << heightTiles) - 1) >> heightTiles;
+    *c = format == GX_TF_RGBA8 ? 2 : 1;
+}
+
+// The object only needs to remember where its image is, for the checks
+void GXInitTexObj(GXTexObj* obj, void* imagePtr, u16 width, u16 height, GXTexFmt format, GXTexWrapMode sWrap,
+                  GXTexWrapMode tWrap, GXBool useMIPmap) {
+    memset(obj, 0, sizeof(*obj));
+    obj->dummy[0] = (u32)imagePtr;
+}
+
+void GXInitTexObjLOD(GXTexObj* obj, GXTexFilter minFilter, GXTexFilter maxFilter, f32 minLOD, f32 maxLOD, f32 lodBias,
+                     GXBool doBiasClamp, GXBool doEdgeLOD, GXAnisotropy maxAniso) {}
+}
+
+// Both paths allocate through here, so their peaks are measured the same way
+static void* trackedAlloc(u32 size) {
+    u8* ptr = (u8*)aligned_alloc(32, ALIGN_NEXT(size, 32) + 32);
+
+    *(u32*)ptr = size;
+    sAllocated += size;
+    if (sAllocated > sPeak) {
+        sPeak = sAllocated;
+    }
+    return ptr + 32;
+}
+
+static void trackedFree(void* ptr) {
+    u8* base = (u8*)ptr - 32;
+
+    sAllocated -= *(u32*)base;
+    free(base);
+}
+
+static u32 nextRandom(u32* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+static u32 imageSize(GXTexFmt format, u16 width, u16 height, u32 numLevels) {
+    u32 size;
+    u32 tilesX;
+    u32 tilesY;
+    u32 cacheLines;
+    u32 i;
+
+    size = 0;
+    for (i = 0; i < numLevels; i++) {
+        __GetImageTileCount(format, width, height, &tilesX, &tilesY, &cacheLines);
+        size += tilesX * tilesY * cacheLines * 32;
+        width = width > 1 ? width >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
+    }
+    return size;
+}
+
+// Offsets are stored in the pointer fields, as in the file
+static void buildPalette(Palette* palette, u32 numTextures) {
+    static const GXTexFmt formats[] = {GX_TF_I4,     GX_TF_I8,    GX_TF_IA8,  GX_TF_RGB565,
+                                       GX_TF_RGB5A3, GX_TF_RGBA8, GX_TF_CMPR, (GXTexFmt)GX_TF_C8};
+    std::vector<u8>& file = palette->file;
+    TEXPalette* pal;
+    TEXDescriptor* tdp;
+    TEXHeader* header;
+    CLUTHeader* clut;
+    u32 headerOffset;
+    u32 dataOffset;
+    u32 numLevels;
+    u32 seed;
+    u32 i;
+
+    palette->numDescriptors = numTextures + 1;
+    palette->clutOnly = numTextures;
+    headerOffset = sizeof(TEXPalette) + palette->numDescriptors * sizeof(TEXDescriptor);
+    dataOffset = ALIGN_NEXT(headerOffset + palette->numDescriptors * (sizeof(TEXHeader) + sizeof(CLUTHeader)), 32);
+    file.assign(dataOffset, 0);
+
+    pal = (TEXPalette*)file.data();
+    pal->versionNumber = PALETTE_VERSION;
+    pal->numDescriptors = palette->numDescriptors;
+    pal->descriptorArray = (TEXDescriptor*)sizeof(TEXPalette);
+
+    seed = 7;
+    for (i = 0; i < palette->numDescriptors; i++) {
+        tdp = (TEXDescriptor*)(file.data() + sizeof(TEXPalette)) + i;
+
+        if (i != palette->clutOnly) {
+            header = (TEXHeader*)(file.data() + headerOffset);
+            tdp->textureHeader = (TEXHeader*)headerOffset;
+            headerOffset += sizeof(TEXHeader);
+
+            header->format = formats[i % ARRAY_COUNT(formats)];
+            header->width = 32 << nextRandom(&seed) % 4;
+            header->height = 32 << nextRandom(&seed) % 4;
+            numLevels = 1 + nextRandom(&seed) % 4;
+            header->minLOD = 0;
+            header->maxLOD = numLevels - 1;
+            header->data = (char*)dataOffset;
+            dataOffset +=
+                ALIGN_NEXT(imageSize((GXTexFmt)header->format, header->width, header->height, numLevels), 32);
+        }
+
+        if (i == palette->clutOnly || formats[i % ARRAY_COUNT(formats)] == (GXTexFmt)GX_TF_C8) {
+            clut = (CLUTHeader*)(file.data() + headerOffset);
+            tdp->CLUTHeader = (CLUTHeader*)headerOffset;
+            headerOffset += sizeof(CLUTHeader);
+
+            clut->numEntries = 256;
+            clut->format = GX_TL_RGB5A3;
+            clut->data = (char*)dataOffset;
+            dataOffset += 256 * sizeof(u16);
+        }
+    }
+
+    file.resize(ALIGN_NEXT(dataOffset, 32));
+    for (i = ALIGN_NEXT(sizeof(TEXPalette) + palette->numDescriptors * (sizeof(TEXDescriptor) + sizeof(TEXHeader) +
+                                                                        sizeof(CLUTHeader)),
+                        32);
+         i < file.size(); i++) {
+        file[i] = (u8)nextRandom(&seed);
+    }
+}
+
+static const TEXDescriptor* fileDescriptor(const Palette* palette, u32 id) {
+    return (const TEXDescriptor*)(palette->file.data() + sizeof(TEXPalette)) + id;
+}
+
+// Compares what a descriptor points at with the bytes at its offsets in the file
+static bool checkDescriptor(const Palette* palette, u32 id, const TEXDescriptor* tdp) {
+    const TEXDescriptor* fdp = fileDescriptor(palette, id);
+    const u8* file = palette->file.data();
+    const TEXHeader* header;
+    const CLUTHeader* clut;
+
+    if (fdp->textureHeader != NULL) {
+        header = (const TEXHeader*)(file + (u32)fdp->textureHeader);
+        if (tdp->textureHeader == NULL || tdp->textureHeader->data == NULL ||
+            memcmp(tdp->textureHeader->data, file + (u32)header->data,
+                   imageSize((GXTexFmt)header->format, header->width, header->height,
+                             header->maxLOD - header->minLOD + 1)) != 0) {
+            return false;
+        }
+    }
+    if (fdp->CLUTHeader != NULL) {
+        clut = (const CLUTHeader*)(file + (u32)fdp->CLUTHeader);
+        if (tdp->CLUTHeader == NULL || tdp->CLUTHeader->data == NULL ||
+            memcmp(tdp->CLUTHeader->data, file + (u32)clut->data, clut->numEntries * sizeof(u16)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void copyToAram(const Palette* palette, u32 aramAddr) {
+    memcpy(AREmuGetARAM() + aramAddr, palette->file.data(), palette->file.size());
+}
+
+static OSMessageQueue sAramQueue;
+static OSMessage sAramMessage;
+
+static void aramCallback(u32 request) { OSSendMessage(&sAramQueue, (OSMessage)request, OS_MESSAGE_NOBLOCK); }
+
+// The current path: the whole file in one buffer, then every offset in it made a pointer
+static TEXPalette* loadFull(DVDFileInfo* fileInfo, u32 aramAddr, u32 length) {
+    ARQRequest request;
+    OSMessage message;
+    TEXPalette* pal;
+    TEXDescriptor* tdp;
+    u32 i;
+
+    pal = (TEXPalette*)trackedAlloc(ALIGN_NEXT(length, 32));
+    if (fileInfo != NULL) {
+        DVDReadPrio(fileInfo, pal, ALIGN_NEXT(length, 32), 0, 2);
+    } else {
+        ARQPostRequest(&request, 0, ARAM_DIR_ARAM_TO_MRAM, ARQ_PRIORITY_HIGH, aramAddr, (u32)pal,
+                       ALIGN_NEXT(length, 32), aramCallback);
+        OSReceiveMessage(&sAramQueue, &message, OS_MESSAGE_BLOCK);
+    }
+
+    pal->descriptorArray = (TEXDescriptor*)((u32)pal->descriptorArray + (u32)pal);
+    for (i = 0; i < pal->numDescriptors; i++) {
+        tdp = &pal->descriptorArray[i];
+        if (tdp->textureHeader != NULL) {
+            tdp->textureHeader = (TEXHeader*)((u32)tdp->textureHeader + (u32)pal);
+            tdp->textureHeader->data = tdp->textureHeader->data + (u32)pal;
+            tdp->textureHeader->unpacked = true;
+        }
+        if (tdp->CLUTHeader != NULL) {
+            tdp->CLUTHeader = (CLUTHeader*)((u32)tdp->CLUTHeader + (u32)pal);
+            tdp->CLUTHeader->data = tdp->CLUTHeader->data + (u32)pal;
+            tdp->CLUTHeader->unpacked = true;
+        }
+    }
+    return pal;
+}
+
+static void resetCounters(void) {
+    sNumReads = 0;
+    sBytesRead = 0;
+    sPeak = sAllocated;
+}
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Loads the palette and makes a texture object for each of the first numUsed ids in order
+static LoadResult runFull(const Palette* palette, bool fromAram, u32 aramAddr, const u32* order, u32 numUsed) {
+    DVDFileInfo fileInfo;
+    LoadResult result;
+    TEXPalette* pal;
+    GXTexObj texObj;
+    Clock::time_point start;
+    u32 i;
+
+    memset(&fileInfo, 0, sizeof(fileInfo));
+    fileInfo.length = palette->file.size();
+    resetCounters();
+    result.ok = true;
+
+    start = Clock::now();
+    pal = loadFull(fromAram ? NULL : &fileInfo, aramAddr, palette->file.size());
+    for (i = 0; i < numUsed; i++) {
+        if (TEXGet(pal, order[i])->textureHeader != NULL) {
+            TEXGetGXTexObjFromPalette(pal, &texObj, order[i]);
+        }
+    }
+    result.ms = elapsedMs(start);
+
+    for (i = 0; i < numUsed; i++) {
+        result.ok &= checkDescriptor(palette, order[i], TEXGet(pal, order[i]));
+    }
+    trackedFree(pal);
+    result.peak = sPeak;
+    result.reads = sNumReads;
+    result.bytesRead = sBytesRead;
+    return result;
+}
+
+static LoadResult runStreamed(const Palette* palette, bool fromAram, u32 aramAddr, const u32* order, u32 numUsed) {
+    DVDFileInfo fileInfo;
+    TEXLoader loader;
+    LoadResult result;
+    Clock::time_point start;
+    u32 i;
+
+    memset(&fileInfo, 0, sizeof(fileInfo));
+    fileInfo.length = palette->file.size();
+    resetCounters();
+    result.ok = true;
+
+    start = Clock::now();
+    if (fromAram) {
+        result.ok &= TEXLoaderOpenARAM(&loader, aramAddr, palette->file.size(), trackedAlloc, trackedFree);
+    } else {
+        result.ok &= TEXLoaderOpenDVD(&loader, &fileInfo, trackedAlloc, trackedFree);
+    }
+    for (i = 0; i < numUsed && result.ok; i++) {
+        if (order[i] == palette->clutOnly) {
+            TEXLoaderGet(&loader, order[i]);
+        } else {
+            result.ok &= TEXLoaderGetGXTexObj(&loader, order[i]) != NULL;
+        }
+    }
+    result.ms = elapsedMs(start);
+
+    for (i = 0; i < numUsed && result.ok; i++) {
+        result.ok &= checkDescriptor(palette, order[i], TEXGet(loader.palette, order[i]));
+    }
+    TEXLoaderClose(&loader);
+    result.peak = sPeak;
+    result.reads = sNumReads;
+    result.bytesRead = sBytesRead;
+    return result;
+}
+
+static int test(u32 aramAddr) {
+    Palette palette;
+    Palette corrupt;
+    DVDFileInfo fileInfo;
+    TEXLoader loader;
+    TEXLoaderStats stats;
+    GXTexObj* texObj;
+    u32 order[NUM_TEXTURES + 1];
+    u32 fromAram;
+    u32 i;
+    bool ok;
+
+    buildPalette(&palette, NUM_TEXTURES);
+    sDisc = &palette;
+    copyToAram(&palette, aramAddr);
+    memset(&fileInfo, 0, sizeof(fileInfo));
+    fileInfo.length = palette.file.size();
+    ok = true;
+
+    for (fromAram = 0; fromAram < 2; fromAram++) {
+        if (fromAram) {
+            ok &= expect(TEXLoaderOpenARAM(&loader, aramAddr, palette.file.size(), trackedAlloc, trackedFree),
+                         "open from ARAM");
+        } else {
+            ok &= expect(TEXLoaderOpenDVD(&loader, &fileInfo, trackedAlloc, trackedFree), "open from DVD");
+        }
+        TEXLoaderGetStats(&loader, &stats);
+        ok &= expect(stats.residentSize == stats.headerSize + palette.numDescriptors * sizeof(TEXLoaderEntry) &&
+                         stats.headerSize < palette.file.size() / 8,
+                     "only the headers resident after open");
+
+        // one in three textures, then every one
+        for (i = 0; i < NUM_TEXTURES; i += 3) {
+            texObj = TEXLoaderGetGXTexObj(&loader, i);
+            ok &= expect(texObj != NULL && checkDescriptor(&palette, i, TEXGet(loader.palette, i)), "fetched data");
+            ok &= expect(texObj != NULL && texObj->dummy[0] == (u32)TEXGet(loader.palette, i)->textureHeader->data,
+                         "texture object");
+        }
+        TEXLoaderGetStats(&loader, &stats);
+        ok &= expect(stats.numFetches == (NUM_TEXTURES + 2) / 3 && stats.peakSize < palette.file.size() / 2,
+                     "partial residency");
+        ok &= expect(TEXLoaderGetGXTexObj(&loader, palette.clutOnly) == NULL, "no object without a texture");
+        ok &= expect(TEXLoaderGet(&loader, palette.clutOnly) != NULL &&
+                         checkDescriptor(&palette, palette.clutOnly, TEXGet(loader.palette, palette.clutOnly)),
+                     "CLUT-only descriptor");
+
+        for (i = 0; i < NUM_TEXTURES; i++) {
+            TEXLoaderEvict(&loader, i);
+        }
+        TEXLoaderEvict(&loader, palette.clutOnly);
+        TEXLoaderGetStats(&loader, &stats);
+        ok &= expect(stats.residentSize == stats.headerSize + palette.numDescriptors * sizeof(TEXLoaderEntry),
+                     "evicted");
+        ok &= expect(TEXLoaderGet(&loader, 3) != NULL && checkDescriptor(&palette, 3, TEXGet(loader.palette, 3)),
+                     "fetched again");
+        TEXLoaderClose(&loader);
+        ok &= expect(sAllocated == 0, "everything freed");
+    }
+
+    // a descriptor count or descriptor array the file can't hold is rejected before it sizes anything
+    corrupt = palette;
+    ((TEXPalette*)corrupt.file.data())->numDescriptors = 0x7FFFFFFF;
+    sDisc = &corrupt;
+    sPeak = 0;
+    ok &= expect(!TEXLoaderOpenDVD(&loader, &fileInfo, trackedAlloc, trackedFree) && sPeak == 0, "descriptor count");
+    corrupt = palette;
+    ((TEXPalette*)corrupt.file.data())->descriptorArray = (TEXDescriptor*)(corrupt.file.size() - 8);
+    ok &= expect(!TEXLoaderOpenDVD(&loader, &fileInfo, trackedAlloc, trackedFree) && sPeak == 0, "descriptor array");
+    sDisc = &palette;
+
+    // the current path sees the same data
+    for (i = 0; i < palette.numDescriptors; i++) {
+        order[i] = i;
+    }
+    ok &= expect(runFull(&palette, false, aramAddr, order, palette.numDescriptors).ok, "full load");
+
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
+
+static int bench(u32 aramAddr) {
+    static const u32 percentages[] = {10, 25, 50, 100};
+    Palette palette;
+    LoadResult full;
+    LoadResult streamed;
+    u32 order[NUM_TEXTURES + 1];
+    u32 numUsed;
+    u32 seed;
+    u32 swap;
+    u32 fromAram;
+    u32 i;
+    u32 j;
+    bool ok;
+
+    buildPalette(&palette, NUM_TEXTURES);
+    sDisc = &palette;
+    copyToAram(&palette, aramAddr);
+    for (i = 0; i < palette.numDescriptors; i++) {
+        order[i] = i;
+    }
+    seed = 3;
+    for (i = palette.numDescriptors - 1; i > 0; i--) {
+        j = nextRandom(&seed) % (i + 1);
+        swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+
+    printf("%lu descriptors, %lu KB; DVD %.1f MB/s + %.0f us per read\n", palette.numDescriptors,
+           (u32)palette.file.size() / 1024, sDVDBytesPerSecond / (1024 * 1024), sDVDLatencyUs);
+    printf("source  used   full: ms   peak KB  |  streamed: ms   peak KB  reads  KB read\n");
+    ok = true;
+    for (fromAram = 0; fromAram < 2; fromAram++) {
+        for (i = 0; i < ARRAY_COUNT(percentages); i++) {
+            numUsed = (palette.numDescriptors * percentages[i] + 99) / 100;
+            full = runFull(&palette, fromAram, aramAddr, order, numUsed);
+            streamed = runStreamed(&palette, fromAram, aramAddr, order, numUsed);
+            printf("%-6s %4lu%% %10.2f %9lu  | %12.2f %9lu %6lu %8lu\n", fromAram ? "ARAM" : "DVD", percentages[i],
+                   full.ms, full.peak / 1024, streamed.ms, streamed.peak / 1024, streamed.reads,
+                   streamed.bytesRead / 1024);
+            ok &= full.ok && streamed.ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: texload test\n"
+                    "       texload bench [DVD MB/s]\n");
+}
+
+int main(int argc, char** argv) {
+    static u32 stack[4];
+    AREmuConfig config;
+    u32 aramAddr;
+    int result;
+
+    if (argc < 2 || (strcmp(argv[1], "test") != 0 && strcmp(argv[1], "bench") != 0)) {
+        usage();
+        return 2;
+    }
+    if (argc > 2) {
+        sDVDBytesPerSecond = atof(argv[2]) * 1024 * 1024;
+        if (sDVDBytesPerSecond <= 0.0) {
+            usage();
+            return 2;
+        }
+    }
+
+    // about what ARAM DMA manages on the console
+    config.bytesPerSecond = 80.0 * 1024 * 1024;
+    config.latencyUs = 5.0;
+    AREmuInit(&config);
+    ARInit(stack, 4);
+    ARQInit();
+    aramAddr = ARAlloc(8 * 1024 * 1024);
+    OSInitMessageQueue(&sAramQueue, &sAramMessage, 1);
+
+    if (strcmp(argv[1], "test") == 0) {
+        result = test(aramAddr);
+    } else {
+        result = bench(aramAddr);
+    }
+
+    AREmuShutdown();
+    return result;
+}
@@ -0,0 +1,386 @@
+#include "thp.h"
+#include "../common/test.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#define TEST_WIDTH 176
+#define TEST_HEIGHT 144
+#define TEST_FRAMES 6
+#define TEST_QUALITY 75
+
+// CRC32 of the RGBA output of each test frame, from the scalar decoder
+static const u32 sTestFrameCRCs[TEST_FRAMES] = {
+    0x0B9048FC, 0x59624F78, 0x5CB5F7DA, 0xB1213FE8, 0xA50345F9, 0x069FA40B,
+};
+
+static void usage(void) {
+    fprintf(stderr, "usage: thpdec info <movie.thp>\n"
+                    "       thpdec decode <movie.thp> <outdir> [threads] [--scalar]\n"
+                    "       thpdec thumb <movie.thp> <frame> <out.ppm> [--scalar]\n"
+                    "       thpdec bench [width height frames] [threads]\n"
+                    "       thpdec test\n");
+}
+
+static bool writePPM(const char* path, const ThpPicture* picture) {
+    std::vector<u8> rgb;
+    FILE* file;
+    u32 i;
+
+    rgb.resize(picture->rgba.size() * 3);
+    for (i = 0; i < picture->rgba.size(); i++) {
+        rgb[i * 3 + 0] = (u8)picture->rgba[i];
+        rgb[i * 3 + 1] = (u8)(picture->rgba[i] >> 8);
+        rgb[i * 3 + 2] = (u8)(picture->rgba[i] >> 16);
+    }
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "P6\n%u %u\n255\n", picture->width, picture->height);
+    if (fwrite(rgb.data(), 1, rgb.size(), file) != rgb.size()) {
+        fclose(file);
+        return false;
+    }
+    return fclose(file) == 0;
+}
+
+static int info(int argc, char** argv) {
+    ThpReader reader;
+    std::vector<u8> frame;
+    u32 numFrames;
+    u32 i;
+
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    if (!ThpOpen(&reader, argv[2])) {
+        fprintf(stderr, "thpdec: can't open %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("version %u.%u, %ux%u, %u frames at %.2f fps, largest frame %u bytes\n", reader.header.version >> 16,
+           (reader.header.version >> 12) & 0xF, reader.header.width, reader.header.height, reader.header.numFrames,
+           reader.header.frameRate, reader.header.bufSize);
+    printf("components:");
+    for (i = 0; i < reader.header.numComponents; i++) {
+        printf(" %s", reader.header.frameComp[i] == THP_COMPONENT_VIDEO   ? "video"
+                      : reader.header.frameComp[i] == THP_COMPONENT_AUDIO ? "audio"
+                                                                          : "none");
+    }
+    printf("\n");
+
+    for (numFrames = 0; ThpReadFrame(&reader, frame); numFrames++) {}
+    if (numFrames != reader.header.numFrames) {
+        printf("frame chain ends after %u frames\n", numFrames);
+    }
+
+    ThpClose(&reader);
+    return numFrames == reader.header.numFrames ? 0 : 1;
+}
+
+typedef struct DecodeOutput {
+    const char* dir;
+    u32 numErrors;
+} DecodeOutput;
+
+static void decodeFrame(u32 frame, const ThpPicture* picture, void* userData) {
+    DecodeOutput* output = (DecodeOutput*)userData;
+    char path[1024];
+
+    snprintf(path, sizeof(path), "%s/frame%04u.ppm", output->dir, frame);
+    if (!writePPM(path, picture)) {
+        fprintf(stderr, "thpdec: can't write %s\n", path);
+        output->numErrors++;
+    }
+}
+
+static int decode(int argc, char** argv) {
+    std::chrono::steady_clock::time_point start;
+    DecodeOutput output;
+    ThpReader reader;
+    ThpImpl impl;
+    u32 numThreads;
+    u32 numFrames;
+    double seconds;
+    int arg;
+
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+
+    impl = THP_IMPL_AUTO;
+    numThreads = std::thread::hardware_concurrency();
+    for (arg = 4; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--scalar") == 0) {
+            impl = THP_IMPL_SCALAR;
+        } else {
+            numThreads = (u32)atoi(argv[arg]);
+        }
+    }
+
+    if (!ThpOpen(&reader, argv[2])) {
+        fprintf(stderr, "thpdec: can't open %s\n", argv[2]);
+        return 1;
+    }
+
+    output.dir = argv[3];
+    output.numErrors = 0;
+    start = std::chrono::steady_clock::now();
+    numFrames = ThpDecodeMovie(&reader, numThreads, true, impl, decodeFrame, &output);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%u of %u frames in %.3f s on %u threads\n", numFrames, reader.header.numFrames, seconds, numThreads);
+    ThpClose(&reader);
+    return numFrames == reader.header.numFrames && output.numErrors == 0 ? 0 : 1;
+}
+
+static int thumb(int argc, char** argv) {
+    ThpReader reader;
+    ThpPicture picture;
+    ThpImpl impl;
+    std::vector<u8> frame;
+    const u8* video;
+    u32 videoSize;
+    u32 index;
+    u32 i;
+
+    if (argc < 5) {
+        usage();
+        return 1;
+    }
+
+    impl = argc > 5 && strcmp(argv[5], "--scalar") == 0 ? THP_IMPL_SCALAR : THP_IMPL_AUTO;
+    index = (u32)atoi(argv[3]);
+    if (!ThpOpen(&reader, argv[2])) {
+        fprintf(stderr, "thpdec: can't open %s\n", argv[2]);
+        return 1;
+    }
+
+    // frames are chained, but only the one asked for is decoded
+    for (i = 0; i <= index; i++) {
+        if (!ThpReadFrame(&reader, frame)) {
+            fprintf(stderr, "thpdec: movie has no frame %u\n", index);
+            ThpClose(&reader);
+            return 1;
+        }
+    }
+
+    if (!ThpGetVideo(&reader.header, frame.data(), (u32)frame.size(), &video, &videoSize) ||
+        !ThpDecodeVideo(video, videoSize, &picture, impl)) {
+        fprintf(stderr, "thpdec: can't decode frame %u\n", index);
+        ThpClose(&reader);
+        return 1;
+    }
+
+    ThpConvertRGB(&picture, impl);
+    ThpClose(&reader);
+    if (!writePPM(argv[4], &picture)) {
+        fprintf(stderr, "thpdec: can't write %s\n", argv[4]);
+        return 1;
+    }
+    return 0;
+}
+
+static inline u32 hash(u32 x, u32 y, u32 frame) {
+    u32 h = x * 0x9E3779B1 ^ y * 0x85EBCA77 ^ frame * 0xC2B2AE3D;
+
+    h ^= h >> 15;
+    h *= 0x2C1B3C6D;
+    h ^= h >> 12;
+    return h;
+}
+
+// A scrolling gradient with hard wrap edges, a moving disc and some grain, all in integer math so the test frames
+// come out the same on every host
+static void syntheticFrame(u32 frame, u32 width, u32 height, u8* y, u8* u, u8* v, void* userData) {
+    s32 discX = (s32)((frame * 5) % width);
+    s32 discY = (s32)(height / 2);
+    s32 radius = (s32)(height / 5);
+    s32 dx;
+    s32 dy;
+    s32 luma;
+    u32 px;
+    u32 py;
+
+    for (py = 0; py < height; py++) {
+        for (px = 0; px < width; px++) {
+            dx = (s32)px - discX;
+            dy = (s32)py - discY;
+            if (dx * dx + dy * dy < radius * radius) {
+                luma = 235;
+            } else {
+                luma = (s32)((px * 3 + py * 2 + frame * 8) & 0xFF);
+            }
+            luma += (s32)(hash(px, py, frame) & 15) - 8;
+            y[py * width + px] = (u8)(luma < 0 ? 0 : luma > 255 ? 255 : luma);
+            u[py * width + px] = (u8)(128 + ((s32)px - (s32)width / 2) * 100 / (s32)width + (s32)(frame % 16));
+            v[py * width + px] = (u8)(128 + ((s32)py - (s32)height / 2) * 100 / (s32)height - (s32)(frame % 16));
+        }
+    }
+}
+
+typedef struct BenchOutput {
+    std::vector<u32> crcs;
+} BenchOutput;
+
+static void collectFrame(u32 frame, const ThpPicture* picture, void* userData) {
+    BenchOutput* output = (BenchOutput*)userData;
+
+    output->crcs.push_back(crc32((const u8*)picture->rgba.data(), picture->rgba.size() * sizeof(u32)));
+}
+
+static double benchOnce(ThpReader* reader, u32 numThreads, ThpImpl impl, BenchOutput* output) {
+    std::chrono::steady_clock::time_point start;
+    double seconds;
+    u32 numFrames;
+
+    output->crcs.clear();
+    ThpRewind(reader);
+    start = std::chrono::steady_clock::now();
+    numFrames = ThpDecodeMovie(reader, numThreads, true, impl, collectFrame, output);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return numFrames / seconds;
+}
+
+static int bench(int argc, char** argv) {
+    static const char* path = "thpdec_bench.thp";
+    ThpReader reader;
+    BenchOutput scalar;
+    BenchOutput avx2;
+    BenchOutput threaded;
+    u32 width;
+    u32 height;
+    u32 numFrames;
+    u32 numThreads;
+    bool ok;
+
+    width = argc > 4 ? (u32)atoi(argv[2]) : 640;
+    height = argc > 4 ? (u32)atoi(argv[3]) : 480;
+    numFrames = argc > 4 ? (u32)atoi(argv[4]) : 120;
+    numThreads = argc > 5 ? (u32)atoi(argv[5]) : argc == 3 ? (u32)atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+
+    if (!ThpWriteMovie(path, width, height, numFrames, 29.97f, 80, syntheticFrame, NULL) ||
+        !ThpOpen(&reader, path)) {
+        fprintf(stderr, "thpdec: can't write %ux%u test movie to %s\n", width, height, path);
+        return 1;
+    }
+    printf("%ux%u, %u frames, %u bytes per frame\n", width, height, numFrames,
+           reader.header.movieDataSize / numFrames);
+
+    printf("scalar, 1 thread:   %7.1f fps\n", benchOnce(&reader, 1, THP_IMPL_SCALAR, &scalar));
+    ok = scalar.crcs.size() == numFrames;
+
+    if (ThpHaveAVX2()) {
+        printf("avx2, 1 thread:     %7.1f fps\n", benchOnce(&reader, 1, THP_IMPL_AVX2, &avx2));
+        ok &= avx2.crcs == scalar.crcs;
+    } else {
+        printf("avx2: not supported on this CPU\n");
+    }
+
+    printf("auto, %2u threads:   %7.1f fps\n", numThreads, benchOnce(&reader, numThreads, THP_IMPL_AUTO, &threaded));
+    ok &= threaded.crcs == scalar.crcs;
+
+    ThpClose(&reader);
+    remove(path);
+
+    if (!ok) {
+        printf("decoded frames differ between the implementations\n");
+        return 1;
+    }
+    printf("all implementations decode identical frames\n");
+    return 0;
+}
+
+static int test(int argc, char** argv) {
+    static const char* path = "thpdec_test.thp";
+    ThpReader reader;
+    ThpPicture picture;
+    BenchOutput scalar;
+    BenchOutput threaded;
+    std::vector<u8> frame;
+    std::vector<u8> y;
+    std::vector<u8> u;
+    std::vector<u8> v;
+    const u8* video;
+    u32 videoSize;
+    double error;
+    double diff;
+    double psnr;
+    bool ok;
+    u32 i;
+    u32 k;
+
+    if (!ThpWriteMovie(path, TEST_WIDTH, TEST_HEIGHT, TEST_FRAMES, 29.97f, TEST_QUALITY, syntheticFrame, NULL) ||
+        !ThpOpen(&reader, path)) {
+        fprintf(stderr, "thpdec: can't write test movie to %s\n", path);
+        return 1;
+    }
+
+    ok = true;
+    y.resize(TEST_WIDTH * TEST_HEIGHT);
+    u.resize(TEST_WIDTH * TEST_HEIGHT);
+    v.resize(TEST_WIDTH * TEST_HEIGHT);
+    for (i = 0; ThpReadFrame(&reader, frame); i++) {
+        if (!ThpGetVideo(&reader.header, frame.data(), (u32)frame.size(), &video, &videoSize) ||
+            !ThpDecodeVideo(video, videoSize, &picture, THP_IMPL_SCALAR)) {
+            printf("frame %u: decode failed\n", i);
+            ok = false;
+            continue;
+        }
+        ThpConvertRGB(&picture, THP_IMPL_SCALAR);
+
+        // the luma has to come back close to what went in, independent of the stored checksums
+        syntheticFrame(i, TEST_WIDTH, TEST_HEIGHT, y.data(), u.data(), v.data(), NULL);
+        error = 0.0;
+        for (k = 0; k < y.size(); k++) {
+            diff = (double)y[k] - picture.y[k];
+            error += diff * diff;
+        }
+        psnr = 10.0 * log10(255.0 * 255.0 / (error / y.size() > 0.0 ? error / y.size() : 1e-9));
+
+        scalar.crcs.push_back(crc32((const u8*)picture.rgba.data(), picture.rgba.size() * sizeof(u32)));
+        printf("frame %u: crc %08X, luma PSNR %.1f dB%s\n", i, scalar.crcs.back(), psnr,
+               i < TEST_FRAMES && scalar.crcs.back() != sTestFrameCRCs[i] ? ", CRC MISMATCH" : "");
+        if (psnr < 30.0 || i >= TEST_FRAMES || scalar.crcs.back() != sTestFrameCRCs[i]) {
+            ok = false;
+        }
+    }
+    ok &= i == TEST_FRAMES;
+
+    ThpRewind(&reader);
+    if (ThpDecodeMovie(&reader, 4, true, THP_IMPL_AUTO, collectFrame, &threaded) != TEST_FRAMES ||
+        threaded.crcs != scalar.crcs) {
+        printf("threaded decode differs from the scalar reference\n");
+        ok = false;
+    }
+
+    ThpClose(&reader);
+    remove(path);
+
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"info", info},
+    {"decode", decode},
+    {"thumb", thumb},
+    {"bench", bench},
+    {"test", test},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
@@ -0,0 +1,843 @@
+#include "thp.h"
+
+#include <condition_variable>
+#include <limits.h>
+#include <mutex>
+#include <string.h>
+#include <thread>
+
+#define THP_HUFF_LOOKUP_BITS 9
+
+#define CONST_BITS 13
+#define PASS1_BITS 2
+
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+
+#define DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+// dequantized coefficients of an 8-bit stream stay well inside this; clamping keeps the IDCT from overflowing
+#define THP_COEF_LIMIT 4095
+
+static const u8 sZigzag[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+typedef struct ThpHuffman {
+    u16 lookup[1 << THP_HUFF_LOOKUP_BITS]; // (length << 8) | value, 0 for codes longer than the lookup
+    s32 maxCode[18];
+    s32 valOffset[18];
+    u8 values[256];
+    bool valid;
+} ThpHuffman;
+
+typedef struct ThpComponentInfo {
+    u8 id;
+    u8 sampling;
+    u8 quant;
+    u8 dcTable;
+    u8 acTable;
+} ThpComponentInfo;
+
+typedef struct ThpJpeg {
+    u16 quant[4][64]; // zigzag order, as stored
+    bool quantValid[4];
+    ThpHuffman huffman[4]; // DC 0, DC 1, AC 0, AC 1
+    ThpComponentInfo components[3];
+    u32 width;
+    u32 height;
+    u32 restartInterval;
+} ThpJpeg;
+
+typedef struct ThpBits {
+    const u8* p;
+    const u8* end;
+    u64 buffer; // next bit in the top bit
+    s32 count;
+} ThpBits;
+
+bool ThpHaveAVX2(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static bool ThpUseAVX2(ThpImpl impl) {
+    if (impl == THP_IMPL_AUTO) {
+        return ThpHaveAVX2();
+    }
+    return impl == THP_IMPL_AVX2;
+}
+
+bool ThpOpen(ThpReader* reader, const char* path) {
+    u8 header[THP_HEADER_SIZE];
+    u8 compInfo[4 + THP_MAX_COMPONENTS];
+    u8 info[16];
+    u32 infoSize;
+    u32 bits;
+    u32 i;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        return false;
+    }
+
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) || memcmp(header, "THP\0", 4) != 0) {
+        ThpClose(reader);
+        return false;
+    }
+
+    reader->header.version = host_be32(&header[0x04]);
+    reader->header.bufSize = host_be32(&header[0x08]);
+    reader->header.audioMaxSamples = host_be32(&header[0x0C]);
+    bits = host_be32(&header[0x10]);
+    memcpy(&reader->header.frameRate, &bits, sizeof(bits));
+    reader->header.numFrames = host_be32(&header[0x14]);
+    reader->header.firstFrameSize = host_be32(&header[0x18]);
+    reader->header.movieDataSize = host_be32(&header[0x1C]);
+    reader->header.compInfoOffset = host_be32(&header[0x20]);
+    reader->header.offsetDataOffset = host_be32(&header[0x24]);
+    reader->header.movieDataOffset = host_be32(&header[0x28]);
+    reader->header.finalFrameOffset = host_be32(&header[0x2C]);
+
+    if (fseek(reader->file, reader->header.compInfoOffset, SEEK_SET) != 0 ||
+        fread(compInfo, 1, sizeof(compInfo), reader->file) != sizeof(compInfo)) {
+        ThpClose(reader);
+        return false;
+    }
+
+    reader->header.numComponents = host_be32(compInfo);
+    memcpy(reader->header.frameComp, &compInfo[4], THP_MAX_COMPONENTS);
+    if (reader->header.numComponents == 0 || reader->header.numComponents > THP_MAX_COMPONENTS) {
+        ThpClose(reader);
+        return false;
+    }
+
+    // version 1.1 appends the video type and the number of audio tracks to the component infos
+    for (i = 0; i < reader->header.numComponents; i++) {
+        if (reader->header.frameComp[i] == THP_COMPONENT_VIDEO) {
+            infoSize = reader->header.version >= 0x11000 ? 12 : 8;
+        } else if (reader->header.frameComp[i] == THP_COMPONENT_AUDIO) {
+            infoSize = reader->header.version >= 0x11000 ? 16 : 12;
+        } else {
+            continue;
+        }
+
+        if (fread(info, 1, infoSize, reader->file) != infoSize) {
+            ThpClose(reader);
+            return false;
+        }
+        if (reader->header.frameComp[i] == THP_COMPONENT_VIDEO && reader->header.width == 0) {
+            reader->header.width = host_be32(&info[0]);
+            reader->header.height = host_be32(&info[4]);
+        }
+    }
+
+    if (reader->header.width == 0) {
+        ThpClose(reader);
+        return false;
+    }
+
+    ThpRewind(reader);
+    return true;
+}
+
+void ThpClose(ThpReader* reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
+
+void ThpRewind(ThpReader* reader) {
+    reader->frame = 0;
+    reader->offset = reader->header.movieDataOffset;
+    reader->nextSize = reader->header.firstFrameSize;
+}
+
+bool ThpReadFrame(ThpReader* reader, std::vector<u8>& frame) {
+    u32 size = reader->nextSize;
+
+    if (reader->frame >= reader->header.numFrames || size < 8 + reader->header.numComponents * 4) {
+        return false;
+    }
+
+    frame.resize(size);
+    if (fseek(reader->file, reader->offset, SEEK_SET) != 0 || fread(frame.data(), 1, size, reader->file) != size) {
+        return false;
+    }
+
+    reader->frame++;
+    reader->offset += size;
+    reader->nextSize = host_be32(frame.data());
+    return true;
+}
+
+bool ThpGetVideo(const ThpHeader* header, const u8* frame, u32 frameSize, const u8** video, u32* videoSize) {
+    u32 offset;
+    u32 size;
+    u32 i;
+
+    offset = 8 + header->numComponents * 4;
+    for (i = 0; i < header->numComponents; i++) {
+        size = host_be32(&frame[8 + i * 4]);
+        if (offset + size > frameSize) {
+            return false;
+        }
+        if (header->frameComp[i] == THP_COMPONENT_VIDEO) {
+            *video = &frame[offset];
+            *videoSize = size;
+            return true;
+        }
+        offset += size;
+    }
+
+    return false;
+}
+
+static bool ThpBuildHuffman(ThpHuffman* table, const u8 bits[16], const u8* values, u32 numValues) {
+    u32 code;
+    u32 fill;
+    u32 i;
+    u32 k;
+    u32 l;
+
+    memset(table->lookup, 0, sizeof(table->lookup));
+    memcpy(table->values, values, numValues);
+
+    code = 0;
+    k = 0;
+    for (l = 1; l <= 16; l++) {
+        table->valOffset[l] = (s32)k - (s32)code;
+        for (i = 0; i < bits[l - 1]; i++, k++, code++) {
+            if (l <= THP_HUFF_LOOKUP_BITS) {
+                for (fill = 0; fill < (1u << (THP_HUFF_LOOKUP_BITS - l)); fill++) {
+                    table->lookup[(code << (THP_HUFF_LOOKUP_BITS - l)) | fill] = (u16)((l << 8) | values[k]);
+                }
+            }
+        }
+        if (code > (1u << l)) {
+            return false;
+        }
+        table->maxCode[l] = bits[l - 1] != 0 ? (s32)code - 1 : -1;
+        code <<= 1;
+    }
+    table->maxCode[17] = INT_MAX;
+
+    table->valid = true;
+    return true;
+}
+
+// Fills the bit buffer up to at least 57 bits. Stuffed 0xFF 0x00 pairs yield 0xFF, a marker stops the reader and
+// zeros are shifted in instead.
+static inline void ThpFillBits(ThpBits* bits) {
+    u32 byte;
+
+    while (bits->count <= 56) {
+        byte = 0;
+        if (bits->p < bits->end) {
+            byte = bits->p[0];
+            if (byte == 0xFF) {
+                if (bits->p + 1 < bits->end && bits->p[1] == 0x00) {
+                    bits->p += 2;
+                } else {
+                    byte = 0;
+                }
+            } else {
+                bits->p++;
+            }
+        }
+        bits->buffer |= (u64)byte << (56 - bits->count);
+        bits->count += 8;
+    }
+}
+
+static inline u32 ThpGetBits(ThpBits* bits, u32 n) {
+    u32 value = (u32)(bits->buffer >> (64 - n));
+
+    bits->buffer <<= n;
+    bits->count -= n;
+    return value;
+}
+
+static inline s32 ThpExtend(u32 value, u32 n) {
+    return value < (1u << (n - 1)) ? (s32)value - (s32)((1u << n) - 1) : (s32)value;
+}
+
+static inline s32 ThpDecodeHuffman(ThpBits* bits, const ThpHuffman* table) {
+    u32 entry;
+    s32 code;
+    u32 l;
+
+    entry = table->lookup[bits->buffer >> (64 - THP_HUFF_LOOKUP_BITS)];
+    if (entry != 0) {
+        ThpGetBits(bits, entry >> 8);
+        return entry & 0xFF;
+    }
+
+    for (l = THP_HUFF_LOOKUP_BITS + 1; l <= 17; l++) {
+        code = (s32)(bits->buffer >> (64 - l));
+        if (code <= table->maxCode[l]) {
+            break;
+        }
+    }
+    if (l > 16) {
+        return -1;
+    }
+
+    ThpGetBits(bits, l);
+    return table->values[table->valOffset[l] + code];
+}
+
+static inline s32 ThpDequantize(s32 value, u16 quant) {
+    value *= quant;
+    if (value > THP_COEF_LIMIT) {
+        return THP_COEF_LIMIT;
+    }
+    if (value < -THP_COEF_LIMIT) {
+        return -THP_COEF_LIMIT;
+    }
+    return value;
+}
+
+static bool ThpDecodeBlock(ThpBits* bits, const ThpHuffman* dc, const ThpHuffman* ac, const u16 quant[64],
+                           s32* pred, s32 coef[64]) {
+    s32 symbol;
+    u32 run;
+    u32 size;
+    u32 k;
+
+    memset(coef, 0, 64 * sizeof(s32));
+
+    ThpFillBits(bits);
+    symbol = ThpDecodeHuffman(bits, dc);
+    if (symbol < 0 || symbol > 11) {
+        return false;
+    }
+    if (symbol != 0) {
+        *pred += ThpExtend(ThpGetBits(bits, symbol), symbol);
+    }
+    coef[0] = ThpDequantize(*pred, quant[0]);
+
+    for (k = 1; k < 64;) {
+        ThpFillBits(bits);
+        symbol = ThpDecodeHuffman(bits, ac);
+        if (symbol < 0) {
+            return false;
+        }
+
+        run = (u32)symbol >> 4;
+        size = (u32)symbol & 0xF;
+        if (size == 0) {
+            if (run != 15) {
+                break; // EOB
+            }
+            k += 16;
+            continue;
+        }
+
+        k += run;
+        if (k > 63) {
+            return false;
+        }
+        coef[sZigzag[k]] = ThpDequantize(ThpExtend(ThpGetBits(bits, size), size), quant[k]);
+        k++;
+    }
+
+    return true;
+}
+
+static bool ThpDecodeScan(ThpJpeg* jpeg, const u8* p, const u8* end, ThpPicture* picture, bool useAVX2) {
+    void (*idct)(const s32*, u8*, u32) = useAVX2 ? ThpIdctAVX2 : ThpIdctScalar;
+    s32 coef[64];
+    ThpBits bits;
+    s32 pred[3];
+    u32 mcusPerRow;
+    u32 mcuRows;
+    u32 mcusLeft;
+    u32 chromaWidth;
+    u32 mx;
+    u32 my;
+    u32 c;
+    u32 b;
+    u8* out;
+
+    memset(&bits, 0, sizeof(bits));
+    bits.p = p;
+    bits.end = end;
+    memset(pred, 0, sizeof(pred));
+    mcusPerRow = jpeg->width / 16;
+    mcuRows = jpeg->height / 16;
+    mcusLeft = jpeg->restartInterval;
+    chromaWidth = jpeg->width / 2;
+
+    for (my = 0; my < mcuRows; my++) {
+        for (mx = 0; mx < mcusPerRow; mx++) {
+            if (jpeg->restartInterval != 0) {
+                if (mcusLeft == 0) {
+                    // the reader stops in front of the RSTn marker, whatever is left in the buffer is padding
+                    if (bits.p + 1 >= end || bits.p[0] != 0xFF || (bits.p[1] & 0xF8) != 0xD0) {
+                        return false;
+                    }
+                    bits.p += 2;
+                    bits.buffer = 0;
+                    bits.count = 0;
+                    memset(pred, 0, sizeof(pred));
+                    mcusLeft = jpeg->restartInterval;
+                }
+                mcusLeft--;
+            }
+
+            for (b = 0; b < 4; b++) {
+                if (!ThpDecodeBlock(&bits, &jpeg->huffman[jpeg->components[0].dcTable],
+                                    &jpeg->huffman[2 + jpeg->components[0].acTable],
+                                    jpeg->quant[jpeg->components[0].quant], &pred[0], coef)) {
+                    return false;
+                }
+                out = &picture->y[(my * 16 + (b >> 1) * 8) * jpeg->width + mx * 16 + (b & 1) * 8];
+                idct(coef, out, jpeg->width);
+            }
+
+            for (c = 1; c < 3; c++) {
+                if (!ThpDecodeBlock(&bits, &jpeg->huffman[jpeg->components[c].dcTable],
+                                    &jpeg->huffman[2 + jpeg->components[c].acTable],
+                                    jpeg->quant[jpeg->components[c].quant], &pred[c], coef)) {
+                    return false;
+                }
+                out = c == 1 ? picture->u.data() : picture->v.data();
+                idct(coef, &out[my * 8 * chromaWidth + mx * 8], chromaWidth);
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool ThpParseFrameHeader(ThpJpeg* jpeg, const u8* p, u32 length) {
+    u32 i;
+
+    if (length < 6 + 3 * 3 || p[0] != 8 || p[5] != 3) {
+        return false;
+    }
+
+    jpeg->height = host_be16(&p[1]);
+    jpeg->width = host_be16(&p[3]);
+    if (jpeg->width == 0 || jpeg->height == 0 || jpeg->width % 16 != 0 || jpeg->height % 16 != 0) {
+        return false;
+    }
+
+    for (i = 0; i < 3; i++) {
+        jpeg->components[i].id = p[6 + i * 3];
+        jpeg->components[i].sampling = p[7 + i * 3];
+        jpeg->components[i].quant = p[8 + i * 3];
+        if (jpeg->components[i].quant > 3 || !jpeg->quantValid[jpeg->components[i].quant]) {
+            return false;
+        }
+    }
+
+    // THP only writes 4:2:0
+    return jpeg->components[0].sampling == 0x22 && jpeg->components[1].sampling == 0x11 &&
+           jpeg->components[2].sampling == 0x11;
+}
+
+static bool ThpParseScanHeader(ThpJpeg* jpeg, const u8* p, u32 length) {
+    u32 i;
+    u32 c;
+
+    if (length < 1 + 3 * 2 + 3 || p[0] != 3) {
+        return false;
+    }
+
+    for (i = 0; i < 3; i++) {
+        for (c = 0; c < 3 && jpeg->components[c].id != p[1 + i * 2]; c++) {}
+        if (c == 3) {
+            return false;
+        }
+        jpeg->components[c].dcTable = p[2 + i * 2] >> 4;
+        jpeg->components[c].acTable = p[2 + i * 2] & 0xF;
+        if (jpeg->components[c].dcTable > 1 || jpeg->components[c].acTable > 1 ||
+            !jpeg->huffman[jpeg->components[c].dcTable].valid ||
+            !jpeg->huffman[2 + jpeg->components[c].acTable].valid) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ThpDecodeVideo(const u8* data, u32 size, ThpPicture* picture, ThpImpl impl) {
+    ThpJpeg jpeg;
+    const u8* p;
+    const u8* end;
+    const u8* segment;
+    u32 numValues;
+    u32 length;
+    u32 marker;
+    u32 table;
+    u32 i;
+
+    p = data;
+    end = data + size;
+    memset(&jpeg, 0, sizeof(jpeg));
+
+    if (size < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+        return false;
+    }
+    p += 2;
+
+    for (;;) {
+        while (p < end && *p == 0xFF && p + 1 < end && p[1] == 0xFF) {
+            p++;
+        }
+        if (p + 4 > end || p[0] != 0xFF) {
+            return false;
+        }
+
+        marker = p[1];
+        length = host_be16(&p[2]);
+        segment = p + 4;
+        if (length < 2 || segment + length - 2 > end) {
+            return false;
+        }
+        p = segment + length - 2;
+        length -= 2;
+
+        switch (marker) {
+            case 0xDB: // DQT
+                while (segment < p) {
+                    table = segment[0] & 0xF;
+                    if ((segment[0] >> 4) != 0 || table > 3 || segment + 65 > p) {
+                        return false;
+                    }
+                    for (i = 0; i < 64; i++) {
+                        jpeg.quant[table][i] = segment[1 + i];
+                    }
+                    jpeg.quantValid[table] = true;
+                    segment += 65;
+                }
+                break;
+            case 0xC4: // DHT
+                while (segment < p) {
+                    if (segment + 17 > p || (segment[0] >> 4) > 1 || (segment[0] & 0xF) > 1) {
+                        return false;
+                    }
+                    table = (segment[0] >> 4) * 2 + (segment[0] & 0xF);
+                    for (numValues = 0, i = 0; i < 16; i++) {
+                        numValues += segment[1 + i];
+                    }
+                    if (numValues > 256 || segment + 17 + numValues > p ||
+                        !ThpBuildHuffman(&jpeg.huffman[table], &segment[1], &segment[17], numValues)) {
+                        return false;
+                    }
+                    segment += 17 + numValues;
+                }
+                break;
+            case 0xC0: // SOF0
+                if (!ThpParseFrameHeader(&jpeg, segment, length)) {
+                    return false;
+                }
+                break;
+            case 0xDD: // DRI
+                if (length < 2) {
+                    return false;
+                }
+                jpeg.restartInterval = host_be16(segment);
+                break;
+            case 0xDA: // SOS, the entropy coded data follows the header
+                if (jpeg.width == 0 || !ThpParseScanHeader(&jpeg, segment, length)) {
+                    return false;
+                }
+                picture->width = jpeg.width;
+                picture->height = jpeg.height;
+                picture->y.resize(jpeg.width * jpeg.height);
+                picture->u.resize(jpeg.width * jpeg.height / 4);
+                picture->v.resize(jpeg.width * jpeg.height / 4);
+                return ThpDecodeScan(&jpeg, p, end, picture, ThpUseAVX2(impl));
+            case 0xC1:
+            case 0xC2:
+            case 0xC3:
+            case 0xD9:
+                return false;
+            default: // APPn, COM
+                break;
+        }
+    }
+}
+
+void ThpIdctScalar(const s32 coef[64], u8* out, u32 stride) {
+    s32 tmp0, tmp1, tmp2, tmp3;
+    s32 tmp10, tmp11, tmp12, tmp13;
+    s32 z1, z2, z3, z4, z5;
+    s32 workspace[64];
+    const s32* in;
+    s32* ws;
+    s32 value;
+    u32 i;
+
+    // pass 1: columns into the workspace, scaled up by PASS1_BITS
+    for (i = 0; i < 8; i++) {
+        in = &coef[i];
+        ws = &workspace[i];
+
+        if ((in[8] | in[16] | in[24] | in[32] | in[40] | in[48] | in[56]) == 0) {
+            value = in[0] << PASS1_BITS;
+            ws[0] = ws[8] = ws[16] = ws[24] = ws[32] = ws[40] = ws[48] = ws[56] = value;
+            continue;
+        }
+
+        z2 = in[16];
+        z3 = in[48];
+        z1 = (z2 + z3) * FIX_0_541196100;
+        tmp2 = z1 + z3 * -FIX_1_847759065;
+        tmp3 = z1 + z2 * FIX_0_765366865;
+        tmp0 = (in[0] + in[32]) << CONST_BITS;
+        tmp1 = (in[0] - in[32]) << CONST_BITS;
+        tmp10 = tmp0 + tmp3;
+        tmp13 = tmp0 - tmp3;
+        tmp11 = tmp1 + tmp2;
+        tmp12 = tmp1 - tmp2;
+
+        tmp0 = in[56];
+        tmp1 = in[40];
+        tmp2 = in[24];
+        tmp3 = in[8];
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        z4 = tmp1 + tmp3;
+        z5 = (z3 + z4) * FIX_1_175875602;
+        tmp0 *= FIX_0_298631336;
+        tmp1 *= FIX_2_053119869;
+        tmp2 *= FIX_3_072711026;
+        tmp3 *= FIX_1_501321110;
+        z1 *= -FIX_0_899976223;
+        z2 *= -FIX_2_562915447;
+        z3 = z3 * -FIX_1_961570560 + z5;
+        z4 = z4 * -FIX_0_390180644 + z5;
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        ws[0] = DESCALE(tmp10 + tmp3, CONST_BITS - PASS1_BITS);
+        ws[56] = DESCALE(tmp10 - tmp3, CONST_BITS - PASS1_BITS);
+        ws[8] = DESCALE(tmp11 + tmp2, CONST_BITS - PASS1_BITS);
+        ws[48] = DESCALE(tmp11 - tmp2, CONST_BITS - PASS1_BITS);
+        ws[16] = DESCALE(tmp12 + tmp1, CONST_BITS - PASS1_BITS);
+        ws[40] = DESCALE(tmp12 - tmp1, CONST_BITS - PASS1_BITS);
+        ws[24] = DESCALE(tmp13 + tmp0, CONST_BITS - PASS1_BITS);
+        ws[32] = DESCALE(tmp13 - tmp0, CONST_BITS - PASS1_BITS);
+    }
+
+    // pass 2: rows, removing the PASS1_BITS and the factor of 8 and undoing the level shift
+    for (i = 0; i < 8; i++, out += stride) {
+        ws = &workspace[i * 8];
+
+        z2 = ws[2];
+        z3 = ws[6];
+        z1 = (z2 + z3) * FIX_0_541196100;
+        tmp2 = z1 + z3 * -FIX_1_847759065;
+        tmp3 = z1 + z2 * FIX_0_765366865;
+        tmp0 = (ws[0] + ws[4]) << CONST_BITS;
+        tmp1 = (ws[0] - ws[4]) << CONST_BITS;
+        tmp10 = tmp0 + tmp3;
+        tmp13 = tmp0 - tmp3;
+        tmp11 = tmp1 + tmp2;
+        tmp12 = tmp1 - tmp2;
+
+        tmp0 = ws[7];
+        tmp1 = ws[5];
+        tmp2 = ws[3];
+        tmp3 = ws[1];
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        z4 = tmp1 + tmp3;
+        z5 = (z3 + z4) * FIX_1_175875602;
+        tmp0 *= FIX_0_298631336;
+        tmp1 *= FIX_2_053119869;
+        tmp2 *= FIX_3_072711026;
+        tmp3 *= FIX_1_501321110;
+        z1 *= -FIX_0_899976223;
+        z2 *= -FIX_2_562915447;
+        z3 = z3 * -FIX_1_961570560 + z5;
+        z4 = z4 * -FIX_0_390180644 + z5;
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+#define THP_OUT(x) ((value = DESCALE(x, CONST_BITS + PASS1_BITS + 3) + 128) < 0 ? 0 : value > 255 ? 255 : value)
+        out[0] = (u8)THP_OUT(tmp10 + tmp3);
+        out[7] = (u8)THP_OUT(tmp10 - tmp3);
+        out[1] = (u8)THP_OUT(tmp11 + tmp2);
+        out[6] = (u8)THP_OUT(tmp11 - tmp2);
+        out[2] = (u8)THP_OUT(tmp12 + tmp1);
+        out[5] = (u8)THP_OUT(tmp12 - tmp1);
+        out[3] = (u8)THP_OUT(tmp13 + tmp0);
+        out[4] = (u8)THP_OUT(tmp13 - tmp0);
+#undef THP_OUT
+    }
+}
+
+static inline u32 ThpClamp8(s32 value) { return value < 0 ? 0 : value > 255 ? 255 : (u32)value; }
+
+// JFIF full range conversion in 16.16 fixed point, chroma is replicated over its 2x2 pixels
+void ThpYUVToRGBRowScalar(const u8* y, const u8* u, const u8* v, u32* out, u32 width) {
+    s32 luma;
+    s32 cb;
+    s32 cr;
+    u32 x;
+
+    for (x = 0; x < width; x++) {
+        luma = y[x];
+        cb = u[x >> 1] - 128;
+        cr = v[x >> 1] - 128;
+        out[x] = ThpClamp8(luma + ((91881 * cr + 32768) >> 16)) |
+                 (ThpClamp8(luma + ((-22554 * cb - 46802 * cr + 32768) >> 16)) << 8) |
+                 (ThpClamp8(luma + ((116130 * cb + 32768) >> 16)) << 16) | 0xFF000000;
+    }
+}
+
+void ThpConvertRGB(ThpPicture* picture, ThpImpl impl) {
+    void (*row)(const u8*, const u8*, const u8*, u32*, u32);
+    u32 chromaWidth;
+    u32 i;
+
+    row = ThpUseAVX2(impl) ? ThpYUVToRGBRowAVX2 : ThpYUVToRGBRowScalar;
+    chromaWidth = picture->width / 2;
+    picture->rgba.resize(picture->width * picture->height);
+    for (i = 0; i < picture->height; i++) {
+        row(&picture->y[i * picture->width], &picture->u[(i / 2) * chromaWidth], &picture->v[(i / 2) * chromaWidth],
+            &picture->rgba[i * picture->width], picture->width);
+    }
+}
+
+typedef enum ThpSlotState {
+    THP_SLOT_EMPTY,
+    THP_SLOT_READ,
+    THP_SLOT_DECODED,
+} ThpSlotState;
+
+typedef struct ThpSlot {
+    std::vector<u8> data;
+    ThpPicture picture;
+    ThpSlotState state;
+    bool ok;
+} ThpSlot;
+
+u32 ThpDecodeMovie(ThpReader* reader, u32 numThreads, bool convertRGB, ThpImpl impl, ThpFrameCallback callback,
+                   void* userData) {
+    std::vector<ThpSlot> slots;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable frameDone;
+    u32 numRead;
+    u32 numTaken;
+    u32 numDelivered;
+    bool quit;
+    bool eof;
+    ThpSlot* slot;
+    u32 i;
+
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+
+    slots.resize(numThreads * 2);
+    numRead = 0;
+    numTaken = 0;
+    numDelivered = 0;
+    quit = false;
+    eof = false;
+
+    for (i = 0; i < numThreads; i++) {
+        threads.emplace_back([&]() {
+            const u8* video;
+            u32 videoSize;
+            ThpSlot* work;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                workReady.wait(lock, [&]() { return quit || numTaken < numRead; });
+                if (quit) {
+                    return;
+                }
+
+                work = &slots[numTaken++ % slots.size()];
+                lock.unlock();
+
+                work->ok = ThpGetVideo(&reader->header, work->data.data(), (u32)work->data.size(), &video,
+                                       &videoSize) &&
+                           ThpDecodeVideo(video, videoSize, &work->picture, impl);
+                if (work->ok && convertRGB) {
+                    ThpConvertRGB(&work->picture, impl);
+                }
+
+                lock.lock();
+                work->state = THP_SLOT_DECODED;
+                frameDone.notify_all();
+            }
+        });
+    }
+
+    for (;;) {
+        // keep every slot busy; only empty slots are touched here, so reading needs no lock
+        while (!eof && numRead < numDelivered + slots.size()) {
+            slot = &slots[numRead % slots.size()];
+            if (!ThpReadFrame(reader, slot->data)) {
+                eof = true;
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->state = THP_SLOT_READ;
+            numRead++;
+            workReady.notify_one();
+        }
+
+        if (numDelivered == numRead) {
+            break;
+        }
+
+        slot = &slots[numDelivered % slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameDone.wait(lock, [&]() { return slot->state == THP_SLOT_DECODED; });
+        }
+        if (!slot->ok) {
+            break;
+        }
+
+        callback(numDelivered, &slot->picture, userData);
+        slot->state = THP_SLOT_EMPTY;
+        numDelivered++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        workReady.notify_all();
+    }
+    for (i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    return numDelivered;
+}
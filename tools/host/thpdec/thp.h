@@ -0,0 +1,100 @@
+#ifndef _THPDEC_THP_H
+#define _THPDEC_THP_H
+
+#include "../common/types.h"
+
+#include <stdio.h>
+#include <vector>
+
+// Host decoder for the THP movies the menu plays (movie1 ... movie12). A THP file is a big-endian header, a
+// component table and a chain of 32-byte aligned frames; every frame lists the sizes of its components and the
+// total size of the next frame. Video components are baseline JPEG images with 4:2:0 sampling (two 8-bit
+// Huffman table pairs, up to three quantization tables). Audio components are skipped.
+
+#define THP_MAX_COMPONENTS 16
+#define THP_COMPONENT_VIDEO 0
+#define THP_COMPONENT_AUDIO 1
+#define THP_COMPONENT_NONE 0xFF
+
+#define THP_HEADER_SIZE 0x30
+#define THP_FRAME_ALIGN 32
+
+typedef struct ThpHeader {
+    u32 version;
+    u32 bufSize; // largest frame
+    u32 audioMaxSamples;
+    f32 frameRate;
+    u32 numFrames;
+    u32 firstFrameSize;
+    u32 movieDataSize;
+    u32 compInfoOffset;
+    u32 offsetDataOffset;
+    u32 movieDataOffset;
+    u32 finalFrameOffset;
+    u32 numComponents;
+    u8 frameComp[THP_MAX_COMPONENTS];
+    u32 width;
+    u32 height;
+} ThpHeader;
+
+typedef enum ThpImpl {
+    THP_IMPL_AUTO,
+    THP_IMPL_SCALAR,
+    THP_IMPL_AVX2,
+} ThpImpl;
+
+// Decoded frame. U and V are at half resolution in both directions. rgba is only filled when asked for.
+typedef struct ThpPicture {
+    u32 width;
+    u32 height;
+    std::vector<u8> y;
+    std::vector<u8> u;
+    std::vector<u8> v;
+    std::vector<u32> rgba; // R, G, B, 0xFF bytes in memory order
+} ThpPicture;
+
+// Reads the file one frame at a time into a caller-owned buffer, so memory use doesn't depend on the movie length.
+typedef struct ThpReader {
+    FILE* file;
+    ThpHeader header;
+    u32 frame;
+    u32 offset;
+    u32 nextSize;
+} ThpReader;
+
+bool ThpOpen(ThpReader* reader, const char* path);
+void ThpClose(ThpReader* reader);
+void ThpRewind(ThpReader* reader);
+// Returns false at the end of the movie or on a read error.
+bool ThpReadFrame(ThpReader* reader, std::vector<u8>& frame);
+// Finds the video component of a frame read by ThpReadFrame.
+bool ThpGetVideo(const ThpHeader* header, const u8* frame, u32 frameSize, const u8** video, u32* videoSize);
+
+bool ThpDecodeVideo(const u8* data, u32 size, ThpPicture* picture, ThpImpl impl);
+void ThpConvertRGB(ThpPicture* picture, ThpImpl impl);
+
+typedef void (*ThpFrameCallback)(u32 frame, const ThpPicture* picture, void* userData);
+
+// Decodes the whole movie on numThreads workers, one frame per worker at a time. Frames are handed to the
+// callback in order on the calling thread. At most 2 * numThreads frames are held at once. Returns the number of
+// frames decoded; a frame that fails to decode stops the movie.
+u32 ThpDecodeMovie(ThpReader* reader, u32 numThreads, bool convertRGB, ThpImpl impl, ThpFrameCallback callback,
+                   void* userData);
+
+bool ThpHaveAVX2(void);
+
+// Internal kernels, shared between the scalar and AVX2 translation units. Coefficients are dequantized and in
+// natural order; the IDCT is the libjpeg "islow" integer transform, so both versions give identical output.
+void ThpIdctScalar(const s32 coef[64], u8* out, u32 stride);
+void ThpIdctAVX2(const s32 coef[64], u8* out, u32 stride);
+void ThpYUVToRGBRowScalar(const u8* y, const u8* u, const u8* v, u32* out, u32 width);
+void ThpYUVToRGBRowAVX2(const u8* y, const u8* u, const u8* v, u32* out, u32 width);
+
+// Test movie writer (thpenc.cpp): baseline JPEG at the given quality with the standard tables, video only. The
+// source callback fills each frame's Y, U and V planes at full resolution; chroma is averaged down to 4:2:0.
+typedef void (*ThpSourceCallback)(u32 frame, u32 width, u32 height, u8* y, u8* u, u8* v, void* userData);
+
+bool ThpWriteMovie(const char* path, u32 width, u32 height, u32 numFrames, f32 frameRate, u32 quality,
+                   ThpSourceCallback source, void* userData);
+
+#endif
@@ -0,0 +1,175 @@
+#include "thp.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+// AVX2 versions of the IDCT and the color conversion. Both produce output identical to the scalar kernels in
+// thp.cpp: the IDCT does the same 32-bit integer arithmetic on eight columns (then eight rows) at once.
+
+#define CONST_BITS 13
+#define PASS1_BITS 2
+
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+
+#define MUL(a, c) _mm256_mullo_epi32(a, _mm256_set1_epi32(c))
+
+// One 1-D pass over eight vectors; v[i] holds input i of eight independent transforms
+__attribute__((target("avx2"))) static inline void ThpIdctPass(__m256i v[8], s32 shift) {
+    const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+    __m256i tmp0, tmp1, tmp2, tmp3;
+    __m256i tmp10, tmp11, tmp12, tmp13;
+    __m256i z1, z2, z3, z4, z5;
+
+    z1 = MUL(_mm256_add_epi32(v[2], v[6]), FIX_0_541196100);
+    tmp2 = _mm256_add_epi32(z1, MUL(v[6], -FIX_1_847759065));
+    tmp3 = _mm256_add_epi32(z1, MUL(v[2], FIX_0_765366865));
+    tmp0 = _mm256_slli_epi32(_mm256_add_epi32(v[0], v[4]), CONST_BITS);
+    tmp1 = _mm256_slli_epi32(_mm256_sub_epi32(v[0], v[4]), CONST_BITS);
+    tmp10 = _mm256_add_epi32(tmp0, tmp3);
+    tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+    tmp11 = _mm256_add_epi32(tmp1, tmp2);
+    tmp12 = _mm256_sub_epi32(tmp1, tmp2);
+
+    z1 = _mm256_add_epi32(v[7], v[1]);
+    z2 = _mm256_add_epi32(v[5], v[3]);
+    z3 = _mm256_add_epi32(v[7], v[3]);
+    z4 = _mm256_add_epi32(v[5], v[1]);
+    z5 = MUL(_mm256_add_epi32(z3, z4), FIX_1_175875602);
+    tmp0 = MUL(v[7], FIX_0_298631336);
+    tmp1 = MUL(v[5], FIX_2_053119869);
+    tmp2 = MUL(v[3], FIX_3_072711026);
+    tmp3 = MUL(v[1], FIX_1_501321110);
+    z1 = MUL(z1, -FIX_0_899976223);
+    z2 = MUL(z2, -FIX_2_562915447);
+    z3 = _mm256_add_epi32(MUL(z3, -FIX_1_961570560), z5);
+    z4 = _mm256_add_epi32(MUL(z4, -FIX_0_390180644), z5);
+    tmp0 = _mm256_add_epi32(tmp0, _mm256_add_epi32(z1, z3));
+    tmp1 = _mm256_add_epi32(tmp1, _mm256_add_epi32(z2, z4));
+    tmp2 = _mm256_add_epi32(tmp2, _mm256_add_epi32(z2, z3));
+    tmp3 = _mm256_add_epi32(tmp3, _mm256_add_epi32(z1, z4));
+
+#define DESCALE(x) _mm256_srai_epi32(_mm256_add_epi32(x, round), shift)
+    v[0] = DESCALE(_mm256_add_epi32(tmp10, tmp3));
+    v[7] = DESCALE(_mm256_sub_epi32(tmp10, tmp3));
+    v[1] = DESCALE(_mm256_add_epi32(tmp11, tmp2));
+    v[6] = DESCALE(_mm256_sub_epi32(tmp11, tmp2));
+    v[2] = DESCALE(_mm256_add_epi32(tmp12, tmp1));
+    v[5] = DESCALE(_mm256_sub_epi32(tmp12, tmp1));
+    v[3] = DESCALE(_mm256_add_epi32(tmp13, tmp0));
+    v[4] = DESCALE(_mm256_sub_epi32(tmp13, tmp0));
+#undef DESCALE
+}
+
+__attribute__((target("avx2"))) static inline void ThpTranspose(__m256i v[8]) {
+    __m256i t[8];
+    __m256i u[8];
+    s32 i;
+
+    for (i = 0; i < 8; i += 2) {
+        t[i] = _mm256_unpacklo_epi32(v[i], v[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(v[i], v[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4) {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (i = 0; i < 4; i++) {
+        v[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        v[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+__attribute__((target("avx2"))) void ThpIdctAVX2(const s32 coef[64], u8* out, u32 stride) {
+    const __m256i bias = _mm256_set1_epi32(128);
+    __m256i v[8];
+    __m256i rows01;
+    __m256i rows23;
+    __m256i bytes;
+    __m128i half;
+    s32 i;
+
+    for (i = 0; i < 8; i++) {
+        v[i] = _mm256_loadu_si256((const __m256i*)&coef[i * 8]);
+    }
+
+    // each vector is a row, so the first pass runs down all eight columns at once
+    ThpIdctPass(v, CONST_BITS - PASS1_BITS);
+    ThpTranspose(v);
+    ThpIdctPass(v, CONST_BITS + PASS1_BITS + 3);
+    ThpTranspose(v);
+
+    for (i = 0; i < 8; i += 4) {
+        // the two saturating packs clamp to 0..255; the permutes undo their per-lane interleave
+        rows01 = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(_mm256_add_epi32(v[i], bias), _mm256_add_epi32(v[i + 1], bias)), 0xD8);
+        rows23 = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(_mm256_add_epi32(v[i + 2], bias), _mm256_add_epi32(v[i + 3], bias)), 0xD8);
+        bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(rows01, rows23), 0xD8);
+
+        half = _mm256_castsi256_si128(bytes);
+        _mm_storel_epi64((__m128i*)&out[(i + 0) * stride], half);
+        _mm_storel_epi64((__m128i*)&out[(i + 1) * stride], _mm_srli_si128(half, 8));
+        half = _mm256_extracti128_si256(bytes, 1);
+        _mm_storel_epi64((__m128i*)&out[(i + 2) * stride], half);
+        _mm_storel_epi64((__m128i*)&out[(i + 3) * stride], _mm_srli_si128(half, 8));
+    }
+}
+
+__attribute__((target("avx2"))) void ThpYUVToRGBRowAVX2(const u8* y, const u8* u, const u8* v, u32* out, u32 width) {
+    const __m256i bias = _mm256_set1_epi32(128);
+    const __m256i round = _mm256_set1_epi32(32768);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255);
+    __m256i luma;
+    __m256i cb;
+    __m256i cr;
+    __m256i r;
+    __m256i g;
+    __m256i b;
+    __m128i chroma;
+    u32 bits;
+    u32 x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        luma = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&y[x]));
+
+        // four chroma samples, each doubled to cover two pixels
+        memcpy(&bits, &u[x / 2], sizeof(bits));
+        chroma = _mm_cvtsi32_si128((s32)bits);
+        cb = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_unpacklo_epi8(chroma, chroma)), bias);
+        memcpy(&bits, &v[x / 2], sizeof(bits));
+        chroma = _mm_cvtsi32_si128((s32)bits);
+        cr = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_unpacklo_epi8(chroma, chroma)), bias);
+
+        r = _mm256_add_epi32(luma, _mm256_srai_epi32(_mm256_add_epi32(MUL(cr, 91881), round), 16));
+        g = _mm256_add_epi32(MUL(cb, -22554), MUL(cr, -46802));
+        g = _mm256_add_epi32(luma, _mm256_srai_epi32(_mm256_add_epi32(g, round), 16));
+        b = _mm256_add_epi32(luma, _mm256_srai_epi32(_mm256_add_epi32(MUL(cb, 116130), round), 16));
+
+        r = _mm256_min_epi32(_mm256_max_epi32(r, zero), max);
+        g = _mm256_min_epi32(_mm256_max_epi32(g, zero), max);
+        b = _mm256_min_epi32(_mm256_max_epi32(b, zero), max);
+
+        _mm256_storeu_si256((__m256i*)&out[x],
+                            _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                                            _mm256_or_si256(_mm256_slli_epi32(b, 16),
+                                                            _mm256_set1_epi32((s32)0xFF000000))));
+    }
+
+    if (x < width) {
+        ThpYUVToRGBRowScalar(&y[x], &u[x / 2], &v[x / 2], &out[x], width - x);
+    }
+}
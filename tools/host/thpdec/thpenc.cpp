@@ -0,0 +1,499 @@
+#include "thp.h"
+
+#include <string.h>
+
+// Baseline JPEG encoder for test movies. It uses the integer forward DCT from libjpeg and the example tables from
+// Annex K of the JPEG standard, so a movie written here decodes to the same pixels everywhere.
+
+#define CONST_BITS 13
+#define PASS1_BITS 2
+
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+
+#define DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+static const u8 sZigzag[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// natural order
+static const u8 sLumaQuant[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,  14, 13, 16, 24, 40,  57,
+    69, 56, 14, 17, 22,  29,  51,  87,  80, 62, 18, 22, 37,  56,  68,  109, 103, 77, 24, 35, 55,  64,
+    81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+static const u8 sChromaQuant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+    99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+static const u8 sDCLumaBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const u8 sDCChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const u8 sDCValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const u8 sACLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+static const u8 sACLumaValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3,
+    0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA,
+};
+
+static const u8 sACChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const u8 sACChromaValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15, 0x62, 0x72, 0xD1,
+    0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A,
+    0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA,
+    0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA,
+};
+
+typedef struct ThpHuffCode {
+    u16 code[256];
+    u8 size[256]; // 0 for symbols without a code
+} ThpHuffCode;
+
+typedef struct ThpEncoder {
+    u32 width;
+    u32 height;
+    u8 quant[2][64]; // natural order
+    ThpHuffCode dc[2];
+    ThpHuffCode ac[2];
+    std::vector<u8> out;
+    u32 bitBuffer;
+    s32 bitCount;
+} ThpEncoder;
+
+static void ThpBuildHuffCode(ThpHuffCode* table, const u8 bits[16], const u8* values) {
+    u32 code;
+    u32 i;
+    u32 k;
+    u32 l;
+
+    memset(table, 0, sizeof(*table));
+    code = 0;
+    k = 0;
+    for (l = 1; l <= 16; l++) {
+        for (i = 0; i < bits[l - 1]; i++, k++, code++) {
+            table->code[values[k]] = (u16)code;
+            table->size[values[k]] = (u8)l;
+        }
+        code <<= 1;
+    }
+}
+
+static void ThpPutBits(ThpEncoder* enc, u32 value, u32 size) {
+    u8 byte;
+
+    enc->bitBuffer = (enc->bitBuffer << size) | (value & ((1u << size) - 1));
+    enc->bitCount += size;
+    while (enc->bitCount >= 8) {
+        byte = (u8)(enc->bitBuffer >> (enc->bitCount - 8));
+        enc->out.push_back(byte);
+        if (byte == 0xFF) {
+            enc->out.push_back(0x00);
+        }
+        enc->bitCount -= 8;
+    }
+}
+
+static void ThpPutMarker(ThpEncoder* enc, u8 marker, u32 length) {
+    enc->out.push_back(0xFF);
+    enc->out.push_back(marker);
+    if (length != 0) {
+        enc->out.push_back((u8)(length >> 8));
+        enc->out.push_back((u8)length);
+    }
+}
+
+static void ThpPutHuffTable(ThpEncoder* enc, u8 id, const u8 bits[16], const u8* values, u32 numValues) {
+    enc->out.push_back(id);
+    enc->out.insert(enc->out.end(), bits, bits + 16);
+    enc->out.insert(enc->out.end(), values, values + numValues);
+}
+
+static void ThpForwardDCT(s32 block[64]) {
+    s32 tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+    s32 tmp10, tmp11, tmp12, tmp13;
+    s32 z1, z2, z3, z4, z5;
+    u32 pass;
+    u32 step;
+    u32 i;
+    s32* d;
+
+    for (pass = 0; pass < 2; pass++) {
+        step = pass == 0 ? 1 : 8;
+        for (i = 0; i < 8; i++) {
+            d = pass == 0 ? &block[i * 8] : &block[i];
+
+            tmp0 = d[0 * step] + d[7 * step];
+            tmp7 = d[0 * step] - d[7 * step];
+            tmp1 = d[1 * step] + d[6 * step];
+            tmp6 = d[1 * step] - d[6 * step];
+            tmp2 = d[2 * step] + d[5 * step];
+            tmp5 = d[2 * step] - d[5 * step];
+            tmp3 = d[3 * step] + d[4 * step];
+            tmp4 = d[3 * step] - d[4 * step];
+
+            tmp10 = tmp0 + tmp3;
+            tmp13 = tmp0 - tmp3;
+            tmp11 = tmp1 + tmp2;
+            tmp12 = tmp1 - tmp2;
+
+            if (pass == 0) {
+                d[0] = (tmp10 + tmp11) << PASS1_BITS;
+                d[4] = (tmp10 - tmp11) << PASS1_BITS;
+            } else {
+                d[0] = DESCALE(tmp10 + tmp11, PASS1_BITS);
+                d[32] = DESCALE(tmp10 - tmp11, PASS1_BITS);
+            }
+
+            z1 = (tmp12 + tmp13) * FIX_0_541196100;
+            z2 = z1 + tmp13 * FIX_0_765366865;
+            z3 = z1 + tmp12 * -FIX_1_847759065;
+            if (pass == 0) {
+                d[2] = DESCALE(z2, CONST_BITS - PASS1_BITS);
+                d[6] = DESCALE(z3, CONST_BITS - PASS1_BITS);
+            } else {
+                d[16] = DESCALE(z2, CONST_BITS + PASS1_BITS);
+                d[48] = DESCALE(z3, CONST_BITS + PASS1_BITS);
+            }
+
+            z1 = tmp4 + tmp7;
+            z2 = tmp5 + tmp6;
+            z3 = tmp4 + tmp6;
+            z4 = tmp5 + tmp7;
+            z5 = (z3 + z4) * FIX_1_175875602;
+            tmp4 *= FIX_0_298631336;
+            tmp5 *= FIX_2_053119869;
+            tmp6 *= FIX_3_072711026;
+            tmp7 *= FIX_1_501321110;
+            z1 *= -FIX_0_899976223;
+            z2 *= -FIX_2_562915447;
+            z3 = z3 * -FIX_1_961570560 + z5;
+            z4 = z4 * -FIX_0_390180644 + z5;
+
+            if (pass == 0) {
+                d[7] = DESCALE(tmp4 + z1 + z3, CONST_BITS - PASS1_BITS);
+                d[5] = DESCALE(tmp5 + z2 + z4, CONST_BITS - PASS1_BITS);
+                d[3] = DESCALE(tmp6 + z2 + z3, CONST_BITS - PASS1_BITS);
+                d[1] = DESCALE(tmp7 + z1 + z4, CONST_BITS - PASS1_BITS);
+            } else {
+                d[56] = DESCALE(tmp4 + z1 + z3, CONST_BITS + PASS1_BITS);
+                d[40] = DESCALE(tmp5 + z2 + z4, CONST_BITS + PASS1_BITS);
+                d[24] = DESCALE(tmp6 + z2 + z3, CONST_BITS + PASS1_BITS);
+                d[8] = DESCALE(tmp7 + z1 + z4, CONST_BITS + PASS1_BITS);
+            }
+        }
+    }
+}
+
+static inline u32 ThpBitLength(s32 value) {
+    u32 magnitude = (u32)(value < 0 ? -value : value);
+    u32 n = 0;
+
+    while (magnitude != 0) {
+        n++;
+        magnitude >>= 1;
+    }
+    return n;
+}
+
+static void ThpEncodeBlock(ThpEncoder* enc, const u8* src, u32 stride, u32 table, s32* pred) {
+    const ThpHuffCode* dc = &enc->dc[table];
+    const ThpHuffCode* ac = &enc->ac[table];
+    s32 block[64];
+    s32 coef[64];
+    s32 divisor;
+    s32 value;
+    u32 run;
+    u32 size;
+    u32 x;
+    u32 y;
+    u32 k;
+
+    for (y = 0; y < 8; y++) {
+        for (x = 0; x < 8; x++) {
+            block[y * 8 + x] = src[y * stride + x] - 128;
+        }
+    }
+    ThpForwardDCT(block);
+
+    // the DCT output is scaled up by 8
+    for (k = 0; k < 64; k++) {
+        divisor = enc->quant[table][sZigzag[k]] * 8;
+        value = block[sZigzag[k]];
+        coef[k] = value >= 0 ? (value + divisor / 2) / divisor : -((-value + divisor / 2) / divisor);
+    }
+
+    value = coef[0] - *pred;
+    *pred = coef[0];
+    size = ThpBitLength(value);
+    ThpPutBits(enc, dc->code[size], dc->size[size]);
+    if (size != 0) {
+        ThpPutBits(enc, value < 0 ? value - 1 : value, size);
+    }
+
+    run = 0;
+    for (k = 1; k < 64; k++) {
+        if (coef[k] == 0) {
+            run++;
+            continue;
+        }
+        while (run >= 16) {
+            ThpPutBits(enc, ac->code[0xF0], ac->size[0xF0]);
+            run -= 16;
+        }
+        size = ThpBitLength(coef[k]);
+        ThpPutBits(enc, ac->code[(run << 4) | size], ac->size[(run << 4) | size]);
+        ThpPutBits(enc, coef[k] < 0 ? coef[k] - 1 : coef[k], size);
+        run = 0;
+    }
+    if (run != 0) {
+        ThpPutBits(enc, ac->code[0x00], ac->size[0x00]);
+    }
+}
+
+static void ThpEncodeImage(ThpEncoder* enc, const u8* y, const u8* u, const u8* v) {
+    s32 pred[3];
+    u32 chromaWidth;
+    u32 mx;
+    u32 my;
+    u32 i;
+    u32 k;
+
+    enc->out.clear();
+    enc->bitBuffer = 0;
+    enc->bitCount = 0;
+    chromaWidth = enc->width / 2;
+
+    ThpPutMarker(enc, 0xD8, 0);
+
+    ThpPutMarker(enc, 0xDB, 2 + 65 * 2);
+    for (i = 0; i < 2; i++) {
+        enc->out.push_back((u8)i);
+        for (k = 0; k < 64; k++) {
+            enc->out.push_back(enc->quant[i][sZigzag[k]]);
+        }
+    }
+
+    ThpPutMarker(enc, 0xC0, 2 + 6 + 3 * 3);
+    enc->out.push_back(8);
+    enc->out.push_back((u8)(enc->height >> 8));
+    enc->out.push_back((u8)enc->height);
+    enc->out.push_back((u8)(enc->width >> 8));
+    enc->out.push_back((u8)enc->width);
+    enc->out.push_back(3);
+    for (i = 0; i < 3; i++) {
+        enc->out.push_back((u8)(i + 1));
+        enc->out.push_back(i == 0 ? 0x22 : 0x11);
+        enc->out.push_back(i == 0 ? 0 : 1);
+    }
+
+    ThpPutMarker(enc, 0xC4, 2 + (17 + 12) * 2 + (17 + 162) * 2);
+    ThpPutHuffTable(enc, 0x00, sDCLumaBits, sDCValues, 12);
+    ThpPutHuffTable(enc, 0x01, sDCChromaBits, sDCValues, 12);
+    ThpPutHuffTable(enc, 0x10, sACLumaBits, sACLumaValues, 162);
+    ThpPutHuffTable(enc, 0x11, sACChromaBits, sACChromaValues, 162);
+
+    ThpPutMarker(enc, 0xDA, 2 + 1 + 3 * 2 + 3);
+    enc->out.push_back(3);
+    for (i = 0; i < 3; i++) {
+        enc->out.push_back((u8)(i + 1));
+        enc->out.push_back(i == 0 ? 0x00 : 0x11);
+    }
+    enc->out.push_back(0);
+    enc->out.push_back(63);
+    enc->out.push_back(0);
+
+    memset(pred, 0, sizeof(pred));
+    for (my = 0; my < enc->height / 16; my++) {
+        for (mx = 0; mx < enc->width / 16; mx++) {
+            for (i = 0; i < 4; i++) {
+                ThpEncodeBlock(enc, &y[(my * 16 + (i >> 1) * 8) * enc->width + mx * 16 + (i & 1) * 8], enc->width, 0,
+                               &pred[0]);
+            }
+            ThpEncodeBlock(enc, &u[my * 8 * chromaWidth + mx * 8], chromaWidth, 1, &pred[1]);
+            ThpEncodeBlock(enc, &v[my * 8 * chromaWidth + mx * 8], chromaWidth, 1, &pred[2]);
+        }
+    }
+
+    // pad the last byte with ones
+    if (enc->bitCount != 0) {
+        ThpPutBits(enc, 0x7F, 8 - enc->bitCount);
+    }
+    ThpPutMarker(enc, 0xD9, 0);
+}
+
+static void ThpDownsample(const u8* src, u8* dst, u32 width, u32 height) {
+    u32 x;
+    u32 y;
+
+    for (y = 0; y < height / 2; y++) {
+        for (x = 0; x < width / 2; x++) {
+            dst[y * (width / 2) + x] = (u8)((src[y * 2 * width + x * 2] + src[y * 2 * width + x * 2 + 1] +
+                                             src[(y * 2 + 1) * width + x * 2] +
+                                             src[(y * 2 + 1) * width + x * 2 + 1] + 2) >>
+                                            2);
+        }
+    }
+}
+
+static bool ThpPutFrame(FILE* file, const std::vector<u8>& frame, u32 nextSize) {
+    u8 next[4];
+
+    host_put_be32(next, nextSize);
+    return fwrite(next, 1, 4, file) == 4 && fwrite(&frame[4], 1, frame.size() - 4, file) == frame.size() - 4;
+}
+
+bool ThpWriteMovie(const char* path, u32 width, u32 height, u32 numFrames, f32 frameRate, u32 quality,
+                   ThpSourceCallback source, void* userData) {
+    ThpEncoder enc;
+    std::vector<u8> y;
+    std::vector<u8> u;
+    std::vector<u8> v;
+    std::vector<u8> chromaU;
+    std::vector<u8> chromaV;
+    std::vector<u8> frame;
+    std::vector<u8> prevFrame;
+    u8 header[THP_HEADER_SIZE + 4 + THP_MAX_COMPONENTS + 8];
+    u8 word[4];
+    u32 movieDataOffset;
+    u32 firstFrameSize;
+    u32 finalFrameOffset;
+    u32 prevSize;
+    u32 maxSize;
+    u32 offset;
+    u32 compSize;
+    u32 scale;
+    u32 bits;
+    u32 i;
+    FILE* file;
+
+    if (width == 0 || height == 0 || width % 16 != 0 || height % 16 != 0 || numFrames == 0) {
+        return false;
+    }
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    // libjpeg's quality scaling
+    quality = quality < 1 ? 1 : quality > 100 ? 100 : quality;
+    scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (i = 0; i < 64; i++) {
+        bits = (sLumaQuant[i] * scale + 50) / 100;
+        enc.quant[0][i] = (u8)(bits < 1 ? 1 : bits > 255 ? 255 : bits);
+        bits = (sChromaQuant[i] * scale + 50) / 100;
+        enc.quant[1][i] = (u8)(bits < 1 ? 1 : bits > 255 ? 255 : bits);
+    }
+    ThpBuildHuffCode(&enc.dc[0], sDCLumaBits, sDCValues);
+    ThpBuildHuffCode(&enc.dc[1], sDCChromaBits, sDCValues);
+    ThpBuildHuffCode(&enc.ac[0], sACLumaBits, sACLumaValues);
+    ThpBuildHuffCode(&enc.ac[1], sACChromaBits, sACChromaValues);
+    enc.width = width;
+    enc.height = height;
+
+    y.resize(width * height);
+    u.resize(width * height);
+    v.resize(width * height);
+    chromaU.resize(width * height / 4);
+    chromaV.resize(width * height / 4);
+
+    movieDataOffset = ALIGN_NEXT(sizeof(header), THP_FRAME_ALIGN);
+    memset(header, 0, sizeof(header));
+    fwrite(header, 1, movieDataOffset, file);
+
+    // a frame's first word is the size of the one after it, so each frame is written once the next is encoded
+    firstFrameSize = 0;
+    finalFrameOffset = 0;
+    prevSize = 0;
+    maxSize = 0;
+    offset = movieDataOffset;
+    for (i = 0; i <= numFrames; i++) {
+        if (i < numFrames) {
+            source(i, width, height, y.data(), u.data(), v.data(), userData);
+            ThpDownsample(u.data(), chromaU.data(), width, height);
+            ThpDownsample(v.data(), chromaV.data(), width, height);
+            ThpEncodeImage(&enc, y.data(), chromaU.data(), chromaV.data());
+
+            compSize = ALIGN_NEXT((u32)enc.out.size(), 4);
+            frame.assign(ALIGN_NEXT(12 + compSize, THP_FRAME_ALIGN), 0);
+            host_put_be32(&frame[4], prevSize);
+            host_put_be32(&frame[8], compSize);
+            memcpy(&frame[12], enc.out.data(), enc.out.size());
+            prevSize = (u32)frame.size();
+            if (frame.size() > maxSize) {
+                maxSize = (u32)frame.size();
+            }
+            if (i == 0) {
+                firstFrameSize = (u32)frame.size();
+            }
+        }
+
+        if (i != 0) {
+            // the last frame points back at the first, the player loops
+            if (!ThpPutFrame(file, prevFrame, i < numFrames ? (u32)frame.size() : firstFrameSize)) {
+                fclose(file);
+                return false;
+            }
+            finalFrameOffset = offset;
+            offset += (u32)prevFrame.size();
+        }
+        prevFrame.swap(frame);
+    }
+
+    memcpy(header, "THP\0", 4);
+    host_put_be32(&header[0x04], 0x10000);
+    host_put_be32(&header[0x08], maxSize);
+    host_put_be32(&header[0x0C], 0);
+    memcpy(&bits, &frameRate, sizeof(bits));
+    host_put_be32(&header[0x10], bits);
+    host_put_be32(&header[0x14], numFrames);
+    host_put_be32(&header[0x18], firstFrameSize);
+    host_put_be32(&header[0x1C], offset - movieDataOffset);
+    host_put_be32(&header[0x20], THP_HEADER_SIZE);
+    host_put_be32(&header[0x24], 0);
+    host_put_be32(&header[0x28], movieDataOffset);
+    host_put_be32(&header[0x2C], finalFrameOffset);
+    host_put_be32(&header[0x30], 1);
+    memset(&header[0x34], THP_COMPONENT_NONE, THP_MAX_COMPONENTS);
+    header[0x34] = THP_COMPONENT_VIDEO;
+    host_put_be32(&header[0x44], width);
+    host_put_be32(&header[0x48], height);
+
+    // the first frame's previous frame is the last one
+    host_put_be32(word, prevSize);
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, sizeof(header), file) != sizeof(header) ||
+        fseek(file, movieDataOffset + 4, SEEK_SET) != 0 || fwrite(word, 1, 4, file) != 4) {
+        fclose(file);
+        return false;
+    }
+
+    return fclose(file) == 0;
+}
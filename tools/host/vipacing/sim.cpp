@@ -0,0 +1,149 @@
+// Host simulation of the menu frame pacer (src/menu/framepacer.cpp) against virtual retraces derived from the VI
+// timing tables. Timestamps are in nanoseconds. The loop starts a frame whenever the pacer has an XFB free for it,
+// so the buffer count the pacer picks is the one the simulation runs with.
+
+#include "menu/framePacer.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Subset of VITimingInfo from vi.c: half lines per field and half-line width in VI clocks
+typedef struct SimTiming {
+    const char* name;
+    u16 numHalfLines;
+    u16 hlw;
+    bool progressive;
+} SimTiming;
+
+static const SimTiming sTimings[] = {
+    {"ntsc-int", 525, 429, false},
+    {"pal-int", 625, 432, false},
+    {"mpal-int", 525, 429, false},
+    {"ntsc-prog", 1050, 429, true},
+};
+
+// The VI runs at 13.5 MHz, or 27 MHz in progressive modes
+static s64 fieldPeriodNs(const SimTiming* timing) {
+    f64 clock = timing->progressive ? 27e6 : 13.5e6;
+
+    return (s64)((f64)timing->numHalfLines * timing->hlw * 1e9 / clock + 0.5);
+}
+
+static f64 gaussian(void) {
+    f64 u1 = (rand() + 1.0) / ((f64)RAND_MAX + 2.0);
+    f64 u2 = (rand() + 1.0) / ((f64)RAND_MAX + 2.0);
+
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: vipacing <ntsc-int|pal-int|mpal-int|ntsc-prog> <frames> <mean%%> <stddev%%> "
+                    "[spike%% spikeChance%%] [retraceJitterNs]\n"
+                    "  draw times are given as a percentage of the field period\n");
+}
+
+int main(int argc, char** argv) {
+    const SimTiming* timing;
+    FramePacer pacer;
+    s64 period;
+    s64 nextRetrace;
+    s64 drawDoneAt;
+    s64 jitterNs;
+    f64 mean;
+    f64 stddev;
+    f64 spike;
+    f64 spikeChance;
+    f64 work;
+    u32 frames;
+    unsigned fields;
+    s32 i;
+
+    if (argc < 5) {
+        usage();
+        return 1;
+    }
+
+    timing = NULL;
+    for (i = 0; i < (s32)(sizeof(sTimings) / sizeof(sTimings[0])); i++) {
+        if (strcmp(argv[1], sTimings[i].name) == 0) {
+            timing = &sTimings[i];
+        }
+    }
+    if (timing == NULL) {
+        usage();
+        return 1;
+    }
+
+    frames = (u32)atoi(argv[2]);
+    mean = atof(argv[3]) / 100.0;
+    stddev = atof(argv[4]) / 100.0;
+    spike = argc > 6 ? atof(argv[5]) / 100.0 : 0.0;
+    spikeChance = argc > 6 ? atof(argv[6]) / 100.0 : 0.0;
+    jitterNs = argc > 7 ? atoll(argv[7]) : 0;
+
+    period = fieldPeriodNs(timing);
+    fpInit(&pacer, period);
+    srand(1);
+
+    nextRetrace = period;
+    drawDoneAt = -1;
+    fields = 0;
+    fpBeginFrame(&pacer, 0);
+
+    while (pacer.stats.numFrames < frames) {
+        if (pacer.drawPending && drawDoneAt < 0) {
+            work = mean + stddev * gaussian();
+            if ((f64)rand() / RAND_MAX < spikeChance) {
+                work += spike;
+            }
+            drawDoneAt = pacer.frameStart + (s64)(work > 0.0 ? work * period : 0.0);
+        }
+
+        if (pacer.drawPending && drawDoneAt < nextRetrace) {
+            fpDrawDone(&pacer, drawDoneAt);
+            if (fpCanBeginFrame(&pacer)) {
+                fpBeginFrame(&pacer, drawDoneAt);
+            }
+            drawDoneAt = -1;
+        } else {
+            fpRetrace(&pacer, nextRetrace);
+            if (fpCanBeginFrame(&pacer)) {
+                fpBeginFrame(&pacer, nextRetrace);
+            }
+
+            fields++;
+            nextRetrace += period;
+            if (jitterNs > 0) {
+                nextRetrace += (s64)(gaussian() * jitterNs);
+            }
+        }
+    }
+
+    printf("%s: field %lld ns, %u fields, %u frames drawn, %u presented\n", timing->name, (long long)period, fields,
+           (unsigned)pacer.stats.numFrames, (unsigned)pacer.stats.numPresented);
+    printf("missed %u (longest run %u), buffers %u, switches %u\n", (unsigned)pacer.stats.numMissed,
+           (unsigned)pacer.stats.longestMissRun, (unsigned)pacer.numBuffers, (unsigned)pacer.stats.numBufferSwitches);
+    printf("worst interval %lld ns, start delay %lld ns\n", (long long)fpGetWorstInterval(&pacer),
+           (long long)fpGetStartDelay(&pacer, 0));
+
+    printf("interval (1/8 field):");
+    for (i = 0; i < FP_HISTOGRAM_SIZE; i++) {
+        printf(" %u", (unsigned)pacer.stats.intervalHistogram[i]);
+    }
+    printf("\njitter (1/64 field): ");
+    for (i = 0; i < FP_HISTOGRAM_SIZE; i++) {
+        printf(" %u", (unsigned)pacer.stats.jitterHistogram[i]);
+    }
+    printf("\n");
+
+    // each field shows one frame, either a new one or the previous one again
+    if (pacer.stats.numPresented + pacer.stats.numMissed > fields ||
+        pacer.stats.numFrames - pacer.stats.numPresented > pacer.numBuffers - 1) {
+        printf("FAIL: more frames presented than fields, or more queued than there are free XFBs\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,335 @@
+#include "xfbcopy.h"
+#include "../common/file.h"
+#include "../common/test.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static void usage(void) {
+    fprintf(stderr, "usage: xfbcopy convert <efb.rgba> <width> <height> <out.yuv> [options]\n"
+                    "       xfbcopy bench <width> <height> [iterations]\n"
+                    "       xfbcopy test\n"
+                    "options:\n"
+                    "  --aa                  input holds three RGBA samples per pixel, copied with the SDK AA pattern\n"
+                    "  --pattern x,y,...     24 sample coordinates (12 x,y pairs) instead of the SDK AA pattern\n"
+                    "  --noaafilter          AA input, copied with AA off (first sample of each pixel)\n"
+                    "  --vfilter a,b,c,d,e,f,g  7-tap vertical filter (default 0,0,21,22,21,0,0)\n"
+                    "  --yscale <f>          vertical scale as passed to GXSetDispCopyYScale\n"
+                    "  --gamma <0|1|2>       GX_GM_1_0, GX_GM_1_7 or GX_GM_2_2\n"
+                    "  --noclamp             read rows outside the copy rectangle from the EFB\n"
+                    "  --scalar              disable the AVX2 kernels\n"
+                    "  --check <golden.yuv>  compare the result against a captured frame\n");
+}
+
+static int convert(int argc, char** argv) {
+    XfbCopyParams params;
+    XfbEfb efb;
+    XfbImpl impl;
+    std::vector<u8> input;
+    std::vector<u8> golden;
+    std::vector<u32> pixels;
+    std::vector<u8> xfb;
+    const char* checkPath;
+    u32 numLines;
+    u32 samples;
+    u32 mismatches;
+    u32 i;
+    int arg;
+    FILE* out;
+
+    if (argc < 6) {
+        usage();
+        return 1;
+    }
+
+    efb.width = (u16)atoi(argv[3]);
+    efb.height = (u16)atoi(argv[4]);
+    efb.multisample = false;
+    XfbInitDefaultParams(&params, efb.width & ~1, efb.height);
+    impl = XFB_IMPL_AUTO;
+    checkPath = NULL;
+
+    for (arg = 6; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--aa") == 0) {
+            efb.multisample = true;
+            XfbSetDefaultAA(&params);
+        } else if (strcmp(argv[arg], "--pattern") == 0 && arg + 1 < argc) {
+            const char* p = argv[++arg];
+            char* end;
+
+            for (i = 0; i < 24; i++) {
+                params.samplePattern[i / 2][i % 2] = (u8)(strtoul(p, &end, 10) & 0xF);
+                if (end == p || (i < 23 && *end != ',')) {
+                    usage();
+                    return 1;
+                }
+                p = end + 1;
+            }
+        } else if (strcmp(argv[arg], "--noaafilter") == 0) {
+            params.useAA = false;
+        } else if (strcmp(argv[arg], "--vfilter") == 0 && arg + 1 < argc) {
+            u32 v[7];
+
+            if (sscanf(argv[++arg], "%u,%u,%u,%u,%u,%u,%u", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) != 7) {
+                usage();
+                return 1;
+            }
+            for (i = 0; i < 7; i++) {
+                params.vFilter[i] = (u8)(v[i] & 0x3F);
+            }
+        } else if (strcmp(argv[arg], "--yscale") == 0 && arg + 1 < argc) {
+            params.yScale = XfbYScaleFromFloat((f32)atof(argv[++arg]));
+        } else if (strcmp(argv[arg], "--gamma") == 0 && arg + 1 < argc) {
+            params.gamma = (u32)atoi(argv[++arg]) % 3;
+        } else if (strcmp(argv[arg], "--noclamp") == 0) {
+            params.clamp = 0;
+        } else if (strcmp(argv[arg], "--scalar") == 0) {
+            impl = XFB_IMPL_SCALAR;
+        } else if (strcmp(argv[arg], "--check") == 0 && arg + 1 < argc) {
+            checkPath = argv[++arg];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    samples = (u32)efb.width * efb.height * (efb.multisample ? 3 : 1);
+    if (!readFile(argv[2], input) || input.size() < samples * 4) {
+        fprintf(stderr, "xfbcopy: can't read %u pixels from %s\n", samples, argv[2]);
+        return 1;
+    }
+
+    pixels.resize(samples);
+    memcpy(pixels.data(), input.data(), samples * 4);
+    efb.pixels = pixels.data();
+
+    xfb.resize((size_t)XfbGetNumXfbLines(params.srcHeight, params.yScale) * params.srcWidth * 2);
+    numLines = XfbCopyDisp(&efb, &params, xfb.data(), impl);
+
+    out = fopen(argv[5], "wb");
+    if (out == NULL || fwrite(xfb.data(), 1, xfb.size(), out) != xfb.size()) {
+        fprintf(stderr, "xfbcopy: can't write %s\n", argv[5]);
+        return 1;
+    }
+    fclose(out);
+    printf("%u x %u XFB lines written\n", params.srcWidth, numLines);
+
+    if (checkPath != NULL) {
+        if (!readFile(checkPath, golden) || golden.size() != xfb.size()) {
+            fprintf(stderr, "xfbcopy: %s doesn't match the output size\n", checkPath);
+            return 1;
+        }
+
+        mismatches = 0;
+        for (i = 0; i < xfb.size(); i++) {
+            if (xfb[i] != golden[i]) {
+                if (mismatches < 8) {
+                    printf("mismatch at line %u byte %u: %02X != %02X\n", i / (params.srcWidth * 2),
+                           i % (params.srcWidth * 2), xfb[i], golden[i]);
+                }
+                mismatches++;
+            }
+        }
+
+        printf("%u mismatching bytes\n", mismatches);
+        return mismatches != 0;
+    }
+
+    return 0;
+}
+
+static double benchOnce(const XfbEfb* efb, const XfbCopyParams* params, u8* xfb, XfbImpl impl, u32 iterations) {
+    std::chrono::steady_clock::time_point start;
+    double seconds;
+    u32 i;
+
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        XfbCopyDisp(efb, params, xfb, impl);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return (double)params->srcWidth * params->srcHeight * iterations / seconds / 1e6;
+}
+
+static int bench(int argc, char** argv) {
+    XfbCopyParams params;
+    XfbEfb efb;
+    std::vector<u32> pixels;
+    std::vector<u8> scalarOut;
+    std::vector<u8> avx2Out;
+    u32 iterations;
+    u32 i;
+
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+
+    efb.width = (u16)atoi(argv[2]);
+    efb.height = (u16)atoi(argv[3]);
+    efb.multisample = false;
+    iterations = argc > 4 ? (u32)atoi(argv[4]) : 200;
+
+    pixels.resize((size_t)efb.width * efb.height);
+    srand(1);
+    for (i = 0; i < pixels.size(); i++) {
+        pixels[i] = ((u32)rand() << 16) ^ (u32)rand();
+    }
+    efb.pixels = pixels.data();
+
+    XfbInitDefaultParams(&params, efb.width & ~1, efb.height);
+    params.vFilter[1] = 8;
+    params.vFilter[5] = 8;
+    scalarOut.resize((size_t)params.srcWidth * 2 * XfbGetNumXfbLines(params.srcHeight, params.yScale));
+    avx2Out.resize(scalarOut.size());
+
+    printf("scalar: %.1f Mpixel/s\n", benchOnce(&efb, &params, scalarOut.data(), XFB_IMPL_SCALAR, iterations));
+
+    if (!XfbHaveAVX2()) {
+        printf("avx2: not supported on this CPU\n");
+        return 0;
+    }
+
+    printf("avx2:   %.1f Mpixel/s\n", benchOnce(&efb, &params, avx2Out.data(), XFB_IMPL_AVX2, iterations));
+    if (scalarOut != avx2Out) {
+        printf("avx2 output differs from the scalar reference\n");
+        return 1;
+    }
+
+    // the same frame with three samples per pixel
+    pixels.resize(pixels.size() * 3);
+    for (i = 0; i < pixels.size(); i++) {
+        pixels[i] = ((u32)rand() << 16) ^ (u32)rand();
+    }
+    efb.pixels = pixels.data();
+    efb.multisample = true;
+    XfbSetDefaultAA(&params);
+
+    printf("aa scalar: %.1f Mpixel/s\n", benchOnce(&efb, &params, scalarOut.data(), XFB_IMPL_SCALAR, iterations));
+    printf("aa avx2:   %.1f Mpixel/s\n", benchOnce(&efb, &params, avx2Out.data(), XFB_IMPL_AVX2, iterations));
+    if (scalarOut != avx2Out) {
+        printf("aa avx2 output differs from the scalar reference\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+static void copyFrame(const XfbEfb* efb, const XfbCopyParams* params, XfbImpl impl, std::vector<u8>& xfb) {
+    xfb.assign((size_t)params->srcWidth * 2 * XfbGetNumXfbLines(params->srcHeight, params->yScale), 0);
+    XfbCopyDisp(efb, params, xfb.data(), impl);
+}
+
+static u32 grey(u32 value) { return value | (value << 8) | (value << 16) | 0xFF000000; }
+
+static int test(int, char**) {
+    static const XfbImpl impls[2] = {XFB_IMPL_SCALAR, XFB_IMPL_AVX2};
+    XfbCopyParams params;
+    XfbEfb efb;
+    std::vector<u32> single;
+    std::vector<u32> samples;
+    std::vector<u8> expected;
+    std::vector<u8> xfb;
+    u32 numImpls;
+    u32 impl;
+    u32 x;
+    u32 y;
+    u32 s;
+    u32 i;
+    u32 value;
+    bool ok;
+
+    efb.width = 16;
+    efb.height = 8;
+    numImpls = XfbHaveAVX2() ? 2 : 1;
+    ok = true;
+
+    single.resize(efb.width * efb.height);
+    samples.resize(single.size() * 3);
+    srand(2);
+    for (i = 0; i < single.size(); i++) {
+        single[i] = ((u32)rand() << 16) ^ (u32)rand();
+    }
+
+    for (impl = 0; impl < numImpls; impl++) {
+        XfbInitDefaultParams(&params, efb.width, efb.height);
+        params.vFilter[0] = 4;
+        params.vFilter[6] = 4;
+        efb.multisample = false;
+        efb.pixels = single.data();
+        copyFrame(&efb, &params, impls[impl], expected);
+
+        // three equal samples give the single-sample result, whatever the pattern
+        for (i = 0; i < single.size(); i++) {
+            samples[i * 3] = samples[i * 3 + 1] = samples[i * 3 + 2] = single[i];
+        }
+        efb.multisample = true;
+        efb.pixels = samples.data();
+        XfbSetDefaultAA(&params);
+        copyFrame(&efb, &params, impls[impl], xfb);
+        ok &= expect(xfb == expected, "equal samples");
+
+        // with AA off only the first sample is read
+        for (i = 0; i < single.size(); i++) {
+            samples[i * 3 + 1] = ~single[i];
+            samples[i * 3 + 2] = single[i] ^ 0x00FF00FF;
+        }
+        params.useAA = false;
+        copyFrame(&efb, &params, impls[impl], xfb);
+        ok &= expect(xfb == expected, "AA off");
+    }
+
+    // Each sample a different grey, one tap at a time at full weight: the Y of each output pixel tells which sample
+    // the tap read. Pattern: sample 0 at the bottom, 1 at the top, 2 in the middle for even pixels, the reverse
+    // order for odd ones.
+    for (i = 0; i < efb.width * efb.height; i++) {
+        for (s = 0; s < 3; s++) {
+            samples[i * 3 + s] = grey(40 + s * 80);
+        }
+    }
+    efb.pixels = samples.data();
+    for (impl = 0; impl < numImpls; impl++) {
+        static const u8 sTopToBottom[2][3] = {{1, 2, 0}, {0, 2, 1}};
+        static const u8 sTapSample[7] = {1, 2, 0, 1, 2, 0, 1};
+        u32 tap;
+
+        XfbInitDefaultParams(&params, efb.width, efb.height);
+        params.useAA = true;
+        for (i = 0; i < 4; i++) {
+            params.samplePattern[i * 3 + 0][1] = (i & 1) ? 1 : 11;
+            params.samplePattern[i * 3 + 1][1] = (i & 1) ? 11 : 1;
+            params.samplePattern[i * 3 + 2][1] = 6;
+        }
+
+        for (tap = 0; tap < 7; tap++) {
+            memset(params.vFilter, 0, sizeof(params.vFilter));
+            params.vFilter[tap] = 63;
+            copyFrame(&efb, &params, impls[impl], xfb);
+
+            for (y = 1; y < (u32)efb.height - 1; y++) {
+                for (x = 0; x < efb.width; x++) {
+                    s = sTopToBottom[x & 1][sTapSample[tap]];
+                    value = (40 + s * 80) * 63 >> 6;
+                    ok &= expect(xfb[(y * efb.width + x) * 2] == (u8)((((66 + 129 + 25) * value + 128) >> 8) + 16),
+                                 "tap sample");
+                }
+            }
+        }
+    }
+
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
+
+static const HostCommand sCommands[] = {
+    {"convert", convert},
+    {"bench", bench},
+    {"test", test},
+    {NULL, NULL},
+};
+
+int main(int argc, char** argv) { return runCommand(sCommands, argc, argv, usage); }
@@ -0,0 +1,301 @@
+#include "xfbcopy.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Same defaults GXSetCopyFilter loads when AA and the vertical filter are disabled
+static const u8 sDefaultVFilter[7] = {0, 0, 21, 22, 21, 0, 0};
+
+void XfbInitDefaultParams(XfbCopyParams* params, u16 width, u16 height) {
+    memset(params, 0, sizeof(*params));
+    params->srcWidth = width;
+    params->srcHeight = height;
+    params->useAA = false;
+    memset(params->samplePattern, 6, sizeof(params->samplePattern));
+    memcpy(params->vFilter, sDefaultVFilter, sizeof(params->vFilter));
+    params->yScale = 0x100;
+    params->gamma = XFB_GAMMA_1_0;
+    params->clamp = XFB_CLAMP_TOP | XFB_CLAMP_BOTTOM;
+}
+
+void XfbSetDefaultAA(XfbCopyParams* params) {
+    static const u8 sAASamplePattern[12][2] = {
+        {3, 2}, {9, 6}, {3, 10}, {3, 2}, {9, 6}, {3, 10}, {9, 2}, {3, 6}, {9, 10}, {9, 2}, {3, 6}, {9, 10},
+    };
+
+    params->useAA = true;
+    memcpy(params->samplePattern, sAASamplePattern, sizeof(params->samplePattern));
+}
+
+u32 XfbYScaleFromFloat(f32 vertScale) { return (u32)(256.0f / vertScale) & 0x1FF; }
+
+u32 XfbGetNumXfbLines(u32 efbHeight, u32 yScale) {
+    u32 numLines;
+    u32 actualHeight;
+    u32 newScale;
+
+    numLines = (efbHeight - 1) * 0x100;
+    actualHeight = (numLines / yScale) + 1;
+
+    newScale = yScale;
+    if (newScale > 0x80 && newScale < 0x100) {
+        while (newScale % 2 == 0) {
+            newScale /= 2;
+        }
+
+        if (efbHeight % newScale == 0) {
+            actualHeight++;
+        }
+    }
+
+    if (actualHeight > 0x400) {
+        actualHeight = 0x400;
+    }
+
+    return actualHeight;
+}
+
+bool XfbHaveAVX2(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void XfbFilterRowScalar(const u32* prev, const u32* cur, const u32* next, u32* out, u32 width,
+                        const u32 weights[3]) {
+    u32 x;
+    u32 shift;
+    u32 result;
+    u32 value;
+
+    for (x = 0; x < width; x++) {
+        result = 0;
+        for (shift = 0; shift < 32; shift += 8) {
+            value = ((prev[x] >> shift) & 0xFF) * weights[0] + ((cur[x] >> shift) & 0xFF) * weights[1] +
+                    ((next[x] >> shift) & 0xFF) * weights[2];
+            value >>= 6;
+            if (value > 0xFF) {
+                value = 0xFF;
+            }
+            result |= value << shift;
+        }
+        out[x] = result;
+    }
+}
+
+void XfbFilterTapsScalar(const u32* const taps[7], u32* out, u32 width, const u8 weights[7]) {
+    u32 x;
+    u32 shift;
+    u32 result;
+    u32 value;
+    u32 t;
+
+    for (x = 0; x < width; x++) {
+        result = 0;
+        for (shift = 0; shift < 32; shift += 8) {
+            value = 0;
+            for (t = 0; t < 7; t++) {
+                value += ((taps[t][x] >> shift) & 0xFF) * weights[t];
+            }
+            value >>= 6;
+            if (value > 0xFF) {
+                value = 0xFF;
+            }
+            result |= value << shift;
+        }
+        out[x] = result;
+    }
+}
+
+// BT.601 studio-swing conversion in 8.8 fixed point. Chroma is taken from the sum of each horizontal pixel pair.
+void XfbPackYUVRowScalar(const u32* rgb, u8* out, u32 width) {
+    u32 x;
+    s32 r0, g0, b0;
+    s32 r1, g1, b1;
+    s32 rs, gs, bs;
+
+    for (x = 0; x < width; x += 2) {
+        r0 = rgb[x] & 0xFF;
+        g0 = (rgb[x] >> 8) & 0xFF;
+        b0 = (rgb[x] >> 16) & 0xFF;
+        r1 = rgb[x + 1] & 0xFF;
+        g1 = (rgb[x + 1] >> 8) & 0xFF;
+        b1 = (rgb[x + 1] >> 16) & 0xFF;
+        rs = r0 + r1;
+        gs = g0 + g1;
+        bs = b0 + b1;
+
+        out[x * 2 + 0] = (u8)(((66 * r0 + 129 * g0 + 25 * b0 + 128) >> 8) + 16);
+        out[x * 2 + 1] = (u8)(((-38 * rs - 74 * gs + 112 * bs + 256) >> 9) + 128);
+        out[x * 2 + 2] = (u8)(((66 * r1 + 129 * g1 + 25 * b1 + 128) >> 8) + 16);
+        out[x * 2 + 3] = (u8)(((112 * rs - 94 * gs - 18 * bs + 256) >> 9) + 128);
+    }
+}
+
+static void XfbBuildGammaTable(u32 gamma, u8 table[256]) {
+    static const f64 sExponents[3] = {1.0, 1.0 / 1.7, 1.0 / 2.2};
+    s32 i;
+
+    for (i = 0; i < 256; i++) {
+        table[i] = (u8)floor(pow(i / 255.0, sExponents[gamma]) * 255.0 + 0.5);
+    }
+}
+
+static void XfbApplyGamma(u32* row, u32 width, const u8 table[256]) {
+    u32 x;
+    u32 p;
+
+    for (x = 0; x < width; x++) {
+        p = row[x];
+        row[x] = table[p & 0xFF] | (table[(p >> 8) & 0xFF] << 8) | (table[(p >> 16) & 0xFF] << 16) | (p & 0xFF000000);
+    }
+}
+
+// Orders the three samples of each quad pixel from top to bottom by their pattern y, ties by sample index. The
+// taps above the line read the two lowest samples of the pixel above, the middle taps the three samples of the pixel
+// itself and the taps below the two highest samples of the pixel below, so each tap reads the nearest samples.
+static void XfbSortSamples(const XfbCopyParams* params, u8 order[4][3]) {
+    u32 q;
+    u32 i;
+    u32 j;
+    u8 swap;
+
+    for (q = 0; q < 4; q++) {
+        for (i = 0; i < 3; i++) {
+            order[q][i] = (u8)i;
+        }
+        for (i = 1; i < 3; i++) {
+            for (j = i; j > 0 && params->samplePattern[q * 3 + order[q][j - 1]][1] >
+                                     params->samplePattern[q * 3 + order[q][j]][1];
+                 j--) {
+                swap = order[q][j];
+                order[q][j] = order[q][j - 1];
+                order[q][j - 1] = swap;
+            }
+        }
+    }
+}
+
+// Gathers the sample each tap reads for one output line of an AA copy
+static void XfbGatherTaps(const XfbEfb* efb, const XfbCopyParams* params, const u8 order[4][3], const u32 rows[3],
+                          std::vector<u32> taps[7]) {
+    static const u8 sTapRow[7] = {0, 0, 1, 1, 1, 2, 2};
+    static const u8 sTapSample[7] = {1, 2, 0, 1, 2, 0, 1};
+    const u32* src;
+    u32 column;
+    u32 quad;
+    u32 sample;
+    u32 x;
+    u32 t;
+
+    for (t = 0; t < 7; t++) {
+        src = &efb->pixels[(size_t)rows[sTapRow[t]] * efb->width * 3];
+        for (x = 0; x < params->srcWidth; x++) {
+            column = params->srcLeft + x;
+            quad = (rows[sTapRow[t]] & 1) * 2 + (column & 1);
+            sample = params->useAA ? order[quad][sTapSample[t]] : 0;
+            taps[t][x] = src[column * 3 + sample];
+        }
+    }
+}
+
+u32 XfbCopyDisp(const XfbEfb* efb, const XfbCopyParams* params, u8* xfb, XfbImpl impl) {
+    std::vector<u32> taps[7];
+    std::vector<u32> row;
+    const u32* tapRows[7];
+    u8 order[4][3];
+    u32 rows[3];
+    const u32* pixels;
+    u32 weights[3];
+    u8 gammaTable[256];
+    u32 numLines;
+    u32 line;
+    u32 srcRow;
+    s32 prevRow;
+    s32 nextRow;
+    s32 top;
+    s32 bottom;
+    bool useAVX2;
+    const u8* vf;
+
+    if (impl == XFB_IMPL_AUTO) {
+        useAVX2 = XfbHaveAVX2();
+    } else {
+        useAVX2 = impl == XFB_IMPL_AVX2;
+    }
+
+    pixels = efb->pixels;
+    if (efb->multisample) {
+        XfbSortSamples(params, order);
+        for (line = 0; line < 7; line++) {
+            taps[line].resize(params->srcWidth);
+            tapRows[line] = taps[line].data();
+        }
+    }
+
+    vf = params->vFilter;
+    weights[0] = vf[0] + vf[1];
+    weights[1] = vf[2] + vf[3] + vf[4];
+    weights[2] = vf[5] + vf[6];
+
+    if (params->gamma != XFB_GAMMA_1_0) {
+        XfbBuildGammaTable(params->gamma, gammaTable);
+    }
+
+    // Rows outside the copy rectangle come from the rest of the EFB unless the copy clamps that edge
+    top = (params->clamp & XFB_CLAMP_TOP) ? params->srcTop : 0;
+    bottom = (params->clamp & XFB_CLAMP_BOTTOM) ? params->srcTop + params->srcHeight - 1 : efb->height - 1;
+
+    numLines = XfbGetNumXfbLines(params->srcHeight, params->yScale);
+    row.resize(params->srcWidth);
+
+    for (line = 0; line < numLines; line++) {
+        srcRow = params->srcTop + ((line * params->yScale) >> 8);
+        if (srcRow >= (u32)params->srcTop + params->srcHeight) {
+            srcRow = params->srcTop + params->srcHeight - 1;
+        }
+
+        prevRow = (s32)srcRow - 1 < top ? top : (s32)srcRow - 1;
+        nextRow = (s32)srcRow + 1 > bottom ? bottom : (s32)srcRow + 1;
+
+        u8* out = &xfb[line * params->srcWidth * 2];
+
+        if (efb->multisample) {
+            rows[0] = (u32)prevRow;
+            rows[1] = srcRow;
+            rows[2] = (u32)nextRow;
+            XfbGatherTaps(efb, params, order, rows, taps);
+            if (useAVX2) {
+                XfbFilterTapsAVX2(tapRows, row.data(), params->srcWidth, vf);
+            } else {
+                XfbFilterTapsScalar(tapRows, row.data(), params->srcWidth, vf);
+            }
+        } else {
+            const u32* prev = &pixels[(u32)prevRow * efb->width + params->srcLeft];
+            const u32* cur = &pixels[srcRow * efb->width + params->srcLeft];
+            const u32* next = &pixels[(u32)nextRow * efb->width + params->srcLeft];
+
+            if (useAVX2) {
+                XfbFilterRowAVX2(prev, cur, next, row.data(), params->srcWidth, weights);
+            } else {
+                XfbFilterRowScalar(prev, cur, next, row.data(), params->srcWidth, weights);
+            }
+        }
+
+        if (params->gamma != XFB_GAMMA_1_0) {
+            XfbApplyGamma(row.data(), params->srcWidth, gammaTable);
+        }
+
+        if (useAVX2) {
+            XfbPackYUVRowAVX2(row.data(), out, params->srcWidth);
+        } else {
+            XfbPackYUVRowScalar(row.data(), out, params->srcWidth);
+        }
+    }
+
+    return numLines;
+}
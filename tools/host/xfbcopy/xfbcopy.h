@@ -0,0 +1,72 @@
+#ifndef _XFBCOPY_H
+#define _XFBCOPY_H
+
+// Host model of the GX display copy (GXCopyDisp): EFB RGB -> AA resolve -> 7-tap vertical filter -> Y scale ->
+// gamma -> YUYV 4:2:2 external framebuffer. Parameters use the same encodings as the values GXFrameBuf.c writes
+// to the BP registers, so a frame can be reproduced from a register dump.
+
+#include "../common/types.h"
+
+typedef enum XfbGamma {
+    XFB_GAMMA_1_0,
+    XFB_GAMMA_1_7,
+    XFB_GAMMA_2_2,
+} XfbGamma;
+
+#define XFB_CLAMP_TOP (1 << 0)
+#define XFB_CLAMP_BOTTOM (1 << 1)
+
+typedef struct XfbCopyParams {
+    u16 srcLeft;
+    u16 srcTop;
+    u16 srcWidth; // must be a multiple of 2
+    u16 srcHeight;
+    bool useAA;              // multisample EFBs only; when off every tap reads a pixel's first sample
+    u8 samplePattern[12][2]; // x, y in 1/12 pixel for the 3 samples of each pixel of a 2x2 quad
+    u8 vFilter[7];
+    u32 yScale;  // 9-bit register value, 0x100 = 1:1 (see GXSetDispCopyYScale)
+    u32 gamma;   // XfbGamma
+    u32 clamp;   // XFB_CLAMP_*
+} XfbCopyParams;
+
+// The EFB as seen by the copy unit. Non-AA EFBs hold one RGBA8 pixel per position; AA EFBs hold three samples per
+// position, stored consecutively in the order of the pixel's samplePattern entries.
+typedef struct XfbEfb {
+    const u32* pixels; // R, G, B, A bytes in memory order
+    u16 width;
+    u16 height;
+    bool multisample;
+} XfbEfb;
+
+typedef enum XfbImpl {
+    XFB_IMPL_AUTO,
+    XFB_IMPL_SCALAR,
+    XFB_IMPL_AVX2,
+} XfbImpl;
+
+// Fills params with the values GXSetCopyFilter(GX_FALSE, ..., GX_FALSE, ...) and GXSetDispCopyYScale(1.0f) program.
+void XfbInitDefaultParams(XfbCopyParams* params, u16 width, u16 height);
+
+// Turns on AA with the sample pattern of the SDK's AA render modes (GXNtsc480IntAa and friends).
+void XfbSetDefaultAA(XfbCopyParams* params);
+
+// Register encodings, matching GXSetDispCopyYScale and __GXGetNumXfbLines in GXFrameBuf.c.
+u32 XfbYScaleFromFloat(f32 vertScale);
+u32 XfbGetNumXfbLines(u32 efbHeight, u32 yScale);
+
+// Returns the number of XFB lines written. The XFB stride is srcWidth * 2 bytes.
+u32 XfbCopyDisp(const XfbEfb* efb, const XfbCopyParams* params, u8* xfb, XfbImpl impl);
+
+bool XfbHaveAVX2(void);
+
+// Internal row kernels, shared between the scalar and AVX2 translation units.
+void XfbFilterRowScalar(const u32* prev, const u32* cur, const u32* next, u32* out, u32 width, const u32 weights[3]);
+void XfbPackYUVRowScalar(const u32* rgb, u8* out, u32 width);
+void XfbFilterRowAVX2(const u32* prev, const u32* cur, const u32* next, u32* out, u32 width, const u32 weights[3]);
+void XfbPackYUVRowAVX2(const u32* rgb, u8* out, u32 width);
+
+// AA copies read a different sample for each tap, so all seven taps get their own row
+void XfbFilterTapsScalar(const u32* const taps[7], u32* out, u32 width, const u8 weights[7]);
+void XfbFilterTapsAVX2(const u32* const taps[7], u32* out, u32 width, const u8 weights[7]);
+
+#endif
@@ -0,0 +1,145 @@
+#include "xfbcopy.h"
+
+#include <immintrin.h>
+
+// AVX2 versions of the row kernels. Both produce output identical to the scalar kernels in xfbcopy.cpp; the tail
+// of each row that doesn't fill a full vector is handed to the scalar code.
+
+__attribute__((target("avx2"))) void XfbFilterRowAVX2(const u32* prev, const u32* cur, const u32* next, u32* out,
+                                                      u32 width, const u32 weights[3]) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i wPrevCur = _mm256_set1_epi32((s32)(weights[0] | (weights[1] << 16)));
+    const __m256i wNext = _mm256_set1_epi32((s32)weights[2]);
+    u32 x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)&prev[x]);
+        __m256i c = _mm256_loadu_si256((const __m256i*)&cur[x]);
+        __m256i n = _mm256_loadu_si256((const __m256i*)&next[x]);
+        __m256i half[2];
+        s32 i;
+
+        for (i = 0; i < 2; i++) {
+            __m256i p16 = i == 0 ? _mm256_unpacklo_epi8(p, zero) : _mm256_unpackhi_epi8(p, zero);
+            __m256i c16 = i == 0 ? _mm256_unpacklo_epi8(c, zero) : _mm256_unpackhi_epi8(c, zero);
+            __m256i n16 = i == 0 ? _mm256_unpacklo_epi8(n, zero) : _mm256_unpackhi_epi8(n, zero);
+
+            // prev * w0 + cur * w1 in one madd, next * w2 in another; 32-bit sums can't overflow
+            __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(p16, c16), wPrevCur),
+                                          _mm256_madd_epi16(_mm256_unpacklo_epi16(n16, zero), wNext));
+            __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(p16, c16), wPrevCur),
+                                          _mm256_madd_epi16(_mm256_unpackhi_epi16(n16, zero), wNext));
+
+            half[i] = _mm256_packus_epi32(_mm256_srli_epi32(lo, 6), _mm256_srli_epi32(hi, 6));
+        }
+
+        // unsigned saturation to 8 bits is the clamp to 0xFF
+        _mm256_storeu_si256((__m256i*)&out[x], _mm256_packus_epi16(half[0], half[1]));
+    }
+
+    if (x < width) {
+        XfbFilterRowScalar(&prev[x], &cur[x], &next[x], &out[x], width - x, weights);
+    }
+}
+
+__attribute__((target("avx2"))) void XfbFilterTapsAVX2(const u32* const taps[7], u32* out, u32 width,
+                                                       const u8 weights[7]) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i w[4];
+    u32 x;
+    s32 i;
+    s32 t;
+
+    // taps in pairs, one madd per pair; the seventh is paired with zero
+    for (t = 0; t < 4; t++) {
+        w[t] = _mm256_set1_epi32((s32)(weights[t * 2] | (t < 3 ? weights[t * 2 + 1] << 16 : 0)));
+    }
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i v[8];
+        __m256i half[2];
+
+        for (t = 0; t < 7; t++) {
+            v[t] = _mm256_loadu_si256((const __m256i*)&taps[t][x]);
+        }
+        v[7] = zero;
+
+        for (i = 0; i < 2; i++) {
+            __m256i lo = zero;
+            __m256i hi = zero;
+
+            for (t = 0; t < 4; t++) {
+                __m256i a16 = i == 0 ? _mm256_unpacklo_epi8(v[t * 2], zero) : _mm256_unpackhi_epi8(v[t * 2], zero);
+                __m256i b16 =
+                    i == 0 ? _mm256_unpacklo_epi8(v[t * 2 + 1], zero) : _mm256_unpackhi_epi8(v[t * 2 + 1], zero);
+
+                lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a16, b16), w[t]));
+                hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a16, b16), w[t]));
+            }
+
+            half[i] = _mm256_packus_epi32(_mm256_srli_epi32(lo, 6), _mm256_srli_epi32(hi, 6));
+        }
+
+        _mm256_storeu_si256((__m256i*)&out[x], _mm256_packus_epi16(half[0], half[1]));
+    }
+
+    if (x < width) {
+        const u32* rest[7];
+
+        for (t = 0; t < 7; t++) {
+            rest[t] = &taps[t][x];
+        }
+        XfbFilterTapsScalar(rest, &out[x], width - x, weights);
+    }
+}
+
+__attribute__((target("avx2"))) void XfbPackYUVRowAVX2(const u32* rgb, u8* out, u32 width) {
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const __m256i evenLanes = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    u32 x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)&rgb[x]);
+        __m256i r = _mm256_and_si256(v, mask);
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), mask);
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 16), mask);
+
+        __m256i y = _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(66)),
+                                     _mm256_mullo_epi32(g, _mm256_set1_epi32(129)));
+        y = _mm256_add_epi32(y, _mm256_mullo_epi32(b, _mm256_set1_epi32(25)));
+        y = _mm256_add_epi32(_mm256_srli_epi32(_mm256_add_epi32(y, _mm256_set1_epi32(128)), 8),
+                             _mm256_set1_epi32(16));
+        y = _mm256_and_si256(y, mask);
+
+        // pair sums land in both lanes of each pixel pair
+        __m256i rs = _mm256_add_epi32(r, _mm256_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m256i gs = _mm256_add_epi32(g, _mm256_shuffle_epi32(g, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m256i bs = _mm256_add_epi32(b, _mm256_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        __m256i u = _mm256_sub_epi32(_mm256_mullo_epi32(bs, _mm256_set1_epi32(112)),
+                                     _mm256_mullo_epi32(rs, _mm256_set1_epi32(38)));
+        u = _mm256_sub_epi32(u, _mm256_mullo_epi32(gs, _mm256_set1_epi32(74)));
+        u = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(u, _mm256_set1_epi32(256)), 9),
+                             _mm256_set1_epi32(128));
+        u = _mm256_and_si256(u, mask);
+
+        __m256i vv = _mm256_sub_epi32(_mm256_mullo_epi32(rs, _mm256_set1_epi32(112)),
+                                      _mm256_mullo_epi32(gs, _mm256_set1_epi32(94)));
+        vv = _mm256_sub_epi32(vv, _mm256_mullo_epi32(bs, _mm256_set1_epi32(18)));
+        vv = _mm256_add_epi32(_mm256_srai_epi32(_mm256_add_epi32(vv, _mm256_set1_epi32(256)), 9),
+                              _mm256_set1_epi32(128));
+        vv = _mm256_and_si256(vv, mask);
+
+        // Y0 U Y1 V in memory order, assembled in the even lane of each pair
+        __m256i ySwap = _mm256_shuffle_epi32(y, _MM_SHUFFLE(2, 3, 0, 1));
+        __m256i word = _mm256_or_si256(_mm256_or_si256(y, _mm256_slli_epi32(u, 8)),
+                                       _mm256_or_si256(_mm256_slli_epi32(ySwap, 16), _mm256_slli_epi32(vv, 24)));
+
+        word = _mm256_permutevar8x32_epi32(word, evenLanes);
+        _mm_storeu_si128((__m128i*)&out[x * 2], _mm256_castsi256_si128(word));
+    }
+
+    if (x < width) {
+        XfbPackYUVRowScalar(&rgb[x], &out[x * 2], width - x);
+    }
+}
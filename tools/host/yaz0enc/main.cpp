@@ -0,0 +1,283 @@
+// Yaz0/Yay0 compressor for archives headed for JKRMemArchive/JKRCompArchive, with a round-trip test through
+// JKRDecomp's decoder and a ratio/speed benchmark of the three parse levels.
+
+#include "yaz0enc.h"
+#include "../common/file.h"
+#include "../common/test.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct Sample {
+    std::string name;
+    std::vector<u8> data;
+} Sample;
+
+static const char* sLevelNames[] = {"naive", "greedy", "optimal"};
+
+// Stand-ins for archive contents: a RARC-like table of names and offsets, big-endian vertex-ish records, text and
+// some incompressible texture-like noise
+static void makeCorpus(std::vector<Sample>& corpus, u32 size) {
+    static const char* words[] = {"board", "star",  "coin",  "minigame", "player", "dice",  "space", "bonus",
+                                  "bowser", "item", "shop", "event",    "turn",   "block", "mario", "party"};
+    Sample sample;
+    u32 value;
+    u32 i;
+    u32 j;
+
+    seedRandom32(1);
+    corpus.clear();
+
+    sample.name = "names";
+    sample.data.clear();
+    for (i = 0; sample.data.size() < size; i++) {
+        for (j = 0; j < 3; j++) {
+            value = random32() % (sizeof(words) / sizeof(words[0]));
+            sample.data.insert(sample.data.end(), words[value], words[value] + strlen(words[value]));
+            sample.data.push_back(j == 2 ? '\0' : '_');
+        }
+        value = i * 0x20;
+        sample.data.push_back((u8)(value >> 24));
+        sample.data.push_back((u8)(value >> 16));
+        sample.data.push_back((u8)(value >> 8));
+        sample.data.push_back((u8)value);
+    }
+    sample.data.resize(size);
+    corpus.push_back(sample);
+
+    sample.name = "vertices";
+    sample.data.clear();
+    for (i = 0; sample.data.size() < size; i++) {
+        for (j = 0; j < 3; j++) {
+            value = 0x43000000 | (((i / 4) * 7 + j * 100 + random32() % 4) & 0xFFFF) << 4;
+            sample.data.push_back((u8)(value >> 24));
+            sample.data.push_back((u8)(value >> 16));
+            sample.data.push_back((u8)(value >> 8));
+            sample.data.push_back((u8)value);
+        }
+        sample.data.push_back(0);
+        sample.data.push_back((u8)(i % 16));
+    }
+    sample.data.resize(size);
+    corpus.push_back(sample);
+
+    sample.name = "text";
+    sample.data.clear();
+    while (sample.data.size() < size) {
+        value = random32() % (sizeof(words) / sizeof(words[0]));
+        sample.data.insert(sample.data.end(), words[value], words[value] + strlen(words[value]));
+        sample.data.push_back(random32() % 10 == 0 ? '\n' : ' ');
+    }
+    sample.data.resize(size);
+    corpus.push_back(sample);
+
+    // 4-bit texels in 8x8 tiles with some flat areas
+    sample.name = "texture";
+    sample.data.clear();
+    while (sample.data.size() < size) {
+        value = random32() % 3 == 0 ? (u8)random32() : 0x11 * (random32() % 16);
+        for (i = 0; i < 32; i++) {
+            sample.data.push_back(value == 0 || value % 0x11 != 0 ? (u8)random32() : (u8)value);
+        }
+    }
+    sample.data.resize(size);
+    corpus.push_back(sample);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: yaz0enc [-p] [-l naive|greedy|optimal] [-j threads] [-b KB per block] <in> <out>\n"
+                    "       yaz0enc test\n"
+                    "       yaz0enc bench [-j threads] [files]\n"
+                    "-p writes Yay0 (SZP) instead of Yaz0 (SZS)\n");
+}
+
+// Parses the options in front of the file names; returns the index of the first name or -1
+static s32 parseOptions(int argc, char** argv, s32 arg, Yaz0Options* options) {
+    u32 i;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-p") == 0) {
+            options->format = YAZ0_FORMAT_SZP;
+            continue;
+        }
+        if (arg + 1 == argc) {
+            return -1;
+        }
+
+        if (strcmp(argv[arg], "-l") == 0) {
+            for (i = 0; i < sizeof(sLevelNames) / sizeof(sLevelNames[0]); i++) {
+                if (strcmp(argv[arg + 1], sLevelNames[i]) == 0) {
+                    break;
+                }
+            }
+            if (i == sizeof(sLevelNames) / sizeof(sLevelNames[0])) {
+                return -1;
+            }
+            options->level = (Yaz0Level)i;
+        } else if (strcmp(argv[arg], "-j") == 0) {
+            options->numThreads = (u32)atoi(argv[arg + 1]);
+        } else if (strcmp(argv[arg], "-b") == 0) {
+            options->blockSize = (u32)atoi(argv[arg + 1]) * 1024;
+        } else {
+            return -1;
+        }
+        arg++;
+    }
+    return arg;
+}
+
+// Every level and format through the decoder, on the corpus and on sizes around the window and block edges; the
+// output mustn't depend on the number of threads
+static int test(void) {
+    static const u32 edgeSizes[] = {0, 1, 2, 3, 4, 0x11, 0x12, 0x111, 0x112, 0xFFF, 0x1000, 0x1001, 0x2345};
+    std::vector<Sample> corpus;
+    std::vector<u8> one;
+    std::vector<u8> many;
+    Yaz0Options options;
+    u32 level;
+    u32 format;
+    u32 i;
+    bool passed;
+    bool ok;
+
+    makeCorpus(corpus, 0x30000);
+    for (i = 0; i < sizeof(edgeSizes) / sizeof(edgeSizes[0]); i++) {
+        corpus.push_back(Sample());
+        corpus.back().name = "edge " + std::to_string(edgeSizes[i]);
+        corpus.back().data.assign(corpus[i % 4].data.begin(), corpus[i % 4].data.begin() + edgeSizes[i]);
+    }
+    corpus.push_back(Sample());
+    corpus.back().name = "run";
+    corpus.back().data.assign(0x20000, 0x5A);
+
+    ok = true;
+    for (i = 0; i < corpus.size(); i++) {
+        for (level = 0; level < sizeof(sLevelNames) / sizeof(sLevelNames[0]); level++) {
+            for (format = 0; format < 2; format++) {
+                yaz0DefaultOptions(&options);
+                options.format = (Yaz0Format)format;
+                options.level = (Yaz0Level)level;
+                options.blockSize = 0x1800; // many blocks, boundaries inside matches
+                options.numThreads = 1;
+                yaz0Encode(corpus[i].data.data(), corpus[i].data.size(), &options, one);
+                options.numThreads = 4;
+                yaz0Encode(corpus[i].data.data(), corpus[i].data.size(), &options, many);
+
+                passed = one == many && yaz0Verify(one.data(), one.size(), corpus[i].data.data(),
+                                                   corpus[i].data.size());
+                if (!passed) {
+                    printf("%s, %s %s: FAILED\n", corpus[i].name.c_str(), sLevelNames[level],
+                           format == YAZ0_FORMAT_SZS ? "SZS" : "SZP");
+                }
+                ok &= passed;
+            }
+        }
+    }
+
+    printf("%u samples x 3 levels x 2 formats: %s\n", (unsigned)corpus.size(), ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static f64 secondsSince(Clock::time_point start) { return std::chrono::duration<f64>(Clock::now() - start).count(); }
+
+static int bench(int argc, char** argv) {
+    std::vector<Sample> corpus;
+    std::vector<u8> out;
+    Yaz0Options options;
+    Clock::time_point start;
+    f64 seconds;
+    u32 numThreads;
+    u32 run;
+    u32 i;
+    s32 arg;
+    bool ok;
+
+    yaz0DefaultOptions(&options);
+    arg = parseOptions(argc, argv, 2, &options);
+    if (arg < 0) {
+        usage();
+        return 1;
+    }
+    numThreads = options.numThreads != 0 ? options.numThreads : std::thread::hardware_concurrency();
+
+    if (arg == argc) {
+        makeCorpus(corpus, 0x100000);
+    }
+    for (; arg < argc; arg++) {
+        corpus.push_back(Sample());
+        corpus.back().name = argv[arg];
+        if (!readFile(argv[arg], corpus.back().data)) {
+            fprintf(stderr, "can't read %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    ok = true;
+    printf("%-10s %-20s %9s %9s %7s %9s\n", "", "", "input", "packed", "ratio", "MB/s");
+    for (i = 0; i < corpus.size(); i++) {
+        // naive greedy, then the hash-chain greedy and optimal parses on one thread and on all of them
+        for (run = 0; run < 4; run++) {
+            options.level = run == 0 ? YAZ0_LEVEL_NAIVE : run == 1 ? YAZ0_LEVEL_GREEDY : YAZ0_LEVEL_OPTIMAL;
+            options.numThreads = run == 3 ? numThreads : 1;
+            if (run == 3 && numThreads == 1) {
+                continue;
+            }
+
+            start = Clock::now();
+            yaz0Encode(corpus[i].data.data(), corpus[i].data.size(), &options, out);
+            seconds = secondsSince(start);
+            ok &= yaz0Verify(out.data(), out.size(), corpus[i].data.data(), corpus[i].data.size());
+            printf("%-10s %-9s %2u thread%s %9u %9u %6.2f%% %9.2f\n", corpus[i].name.c_str(),
+                   sLevelNames[options.level], (unsigned)options.numThreads, options.numThreads == 1 ? " " : "s",
+                   (unsigned)corpus[i].data.size(), (unsigned)out.size(), 100.0 * out.size() / corpus[i].data.size(),
+                   corpus[i].data.size() / seconds / (1024 * 1024));
+        }
+    }
+
+    printf("%s\n", ok ? "ok" : "DECODE MISMATCH");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::vector<u8> in;
+    std::vector<u8> out;
+    Yaz0Options options;
+    s32 arg;
+
+    if (argc >= 2 && strcmp(argv[1], "test") == 0) {
+        return test();
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return bench(argc, argv);
+    }
+
+    yaz0DefaultOptions(&options);
+    arg = parseOptions(argc, argv, 1, &options);
+    if (arg < 0 || arg + 2 != argc) {
+        usage();
+        return 1;
+    }
+    if (!readFile(argv[arg], in)) {
+        fprintf(stderr, "can't read %s\n", argv[arg]);
+        return 1;
+    }
+
+    yaz0Encode(in.data(), in.size(), &options, out);
+    if (!yaz0Verify(out.data(), out.size(), in.data(), in.size())) {
+        fprintf(stderr, "%s doesn't decode back, not written\n", argv[arg + 1]);
+        return 1;
+    }
+    if (!writeFile(argv[arg + 1], out)) {
+        fprintf(stderr, "can't write %s\n", argv[arg + 1]);
+        return 1;
+    }
+    printf("%u -> %u bytes (%.2f%%)\n", (unsigned)in.size(), (unsigned)out.size(),
+           in.empty() ? 0.0 : 100.0 * out.size() / in.size());
+    return 0;
+}
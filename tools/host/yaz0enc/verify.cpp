@@ -0,0 +1,36 @@
+// Kept apart from the encoder, which is on common/types.h: the decoder's header brings dolphin/types.h.
+
+#include "JSystem/JKernel/JKRDecode.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool yaz0Verify(const unsigned char* file, size_t fileSize, const unsigned char* data, size_t size) {
+    unsigned char* copy;
+    unsigned char* out;
+    bool szs;
+    bool ok;
+
+    if (fileSize < JKR_SZS_HEADER_SIZE || file[0] != 'Y' || file[1] != 'a' || file[3] != '0') {
+        return false;
+    }
+    szs = file[2] == 'z';
+    if (((u32)file[4] << 24 | (u32)file[5] << 16 | (u32)file[6] << 8 | file[7]) != size) {
+        return false;
+    }
+
+    // the decoders take a mutable source and may read a little past a truncated one
+    copy = (unsigned char*)calloc(fileSize + 0x40, 1);
+    out = (unsigned char*)malloc(size + 1);
+    memcpy(copy, file, fileSize);
+    if (szs) {
+        JKRDecodeSZS(copy, out, size, 0);
+    } else {
+        JKRDecodeSZP(copy, out, size, 0);
+    }
+    ok = size == 0 || memcmp(out, data, size) == 0;
+
+    free(copy);
+    free(out);
+    return ok;
+}
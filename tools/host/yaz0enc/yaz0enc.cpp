@@ -0,0 +1,373 @@
+#include "yaz0enc.h"
+
+#include <atomic>
+#include <string.h>
+#include <thread>
+
+#define HASH_BITS 16
+#define DEFAULT_BLOCK_SIZE 0x40000
+#define GREEDY_MAX_CHAIN 32
+#define OPTIMAL_MAX_CHAIN 256
+#define NICE_MATCH 0x80 // carried over from the previous position, long enough not to look for better
+
+// bits per token, the flag included
+#define LITERAL_COST 9
+#define SHORT_MATCH_COST 17 // up to 0x11 bytes
+#define LONG_MATCH_COST 25
+
+typedef struct Token {
+    u16 count; // 1 for a literal
+    u16 distance;
+} Token;
+
+typedef struct Block {
+    u32 start;
+    u32 end;
+    std::vector<Token> tokens;
+} Block;
+
+typedef struct MatchFinder {
+    const u8* data;
+    u32 size;
+    u32 base; // first position in prev
+    u32 maxChain;
+    std::vector<s32> head;
+    std::vector<s32> prev;
+} MatchFinder;
+
+void yaz0DefaultOptions(Yaz0Options* options) {
+    options->format = YAZ0_FORMAT_SZS;
+    options->level = YAZ0_LEVEL_OPTIMAL;
+    options->numThreads = 0;
+    options->blockSize = 0;
+    options->maxChain = 0;
+}
+
+static inline u32 hash3(const u8* data) {
+    return (((u32)data[0] << 16 | (u32)data[1] << 8 | data[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void finderInit(MatchFinder* finder, const u8* data, u32 size, u32 base, u32 end, u32 maxChain) {
+    finder->data = data;
+    finder->size = size;
+    finder->base = base;
+    finder->maxChain = maxChain;
+    finder->head.assign(1 << HASH_BITS, -1);
+    finder->prev.assign(end - base, -1);
+}
+
+static inline void finderInsert(MatchFinder* finder, u32 pos) {
+    u32 h;
+
+    if (pos + YAZ0_MIN_MATCH <= finder->size) {
+        h = hash3(finder->data + pos);
+        finder->prev[pos - finder->base] = finder->head[h];
+        finder->head[h] = pos;
+    }
+}
+
+// Longest match at pos of at most limit bytes, nearest first on ties; returns its length, 0 if under 3 bytes. A
+// match of known bytes at *distance only needs beating.
+static u32 finderFind(MatchFinder* finder, u32 pos, u32 limit, u32 known, u32* distance) {
+    const u8* data = finder->data;
+    const u8* cur = data + pos;
+    s32 candidate;
+    u32 chain;
+    u32 best;
+    u32 len;
+
+    if (limit < YAZ0_MIN_MATCH) {
+        return 0;
+    }
+    best = known < limit ? known : limit;
+    if (best >= NICE_MATCH || best == limit) {
+        return best;
+    }
+
+    candidate = finder->head[hash3(cur)];
+    for (chain = 0; candidate >= 0 && pos - candidate <= YAZ0_WINDOW_SIZE && chain < finder->maxChain; chain++) {
+        // the byte that would make it longer than the best so far decides quickest
+        if (data[candidate + best] == cur[best]) {
+            for (len = 0; len < limit && data[candidate + len] == cur[len]; len++) {
+            }
+            if (len > best) {
+                best = len;
+                *distance = pos - candidate;
+                if (len == limit) {
+                    break;
+                }
+            }
+        }
+        candidate = finder->prev[candidate - finder->base];
+    }
+    return best >= YAZ0_MIN_MATCH ? best : 0;
+}
+
+static void parseNaive(const u8* data, Block* block) {
+    Token token;
+    u32 pos;
+    u32 limit;
+    u32 distance;
+    u32 len;
+
+    pos = block->start;
+    while (pos < block->end) {
+        token.count = 1;
+        token.distance = 0;
+        limit = block->end - pos < YAZ0_MAX_MATCH ? block->end - pos : YAZ0_MAX_MATCH;
+        for (distance = 1; distance <= YAZ0_WINDOW_SIZE && distance <= pos; distance++) {
+            for (len = 0; len < limit && data[pos - distance + len] == data[pos + len]; len++) {
+            }
+            if (len >= YAZ0_MIN_MATCH && len > token.count) {
+                token.count = (u16)len;
+                token.distance = (u16)distance;
+                if (len == limit) {
+                    break;
+                }
+            }
+        }
+        block->tokens.push_back(token);
+        pos += token.count;
+    }
+}
+
+static void parseGreedy(const u8* data, u32 size, Block* block, u32 maxChain) {
+    MatchFinder finder;
+    Token token;
+    u32 base;
+    u32 pos;
+    u32 limit;
+    u32 distance;
+    u32 len;
+    u32 i;
+
+    base = block->start > YAZ0_WINDOW_SIZE ? block->start - YAZ0_WINDOW_SIZE : 0;
+    finderInit(&finder, data, size, base, block->end, maxChain);
+    for (pos = base; pos < block->start; pos++) {
+        finderInsert(&finder, pos);
+    }
+
+    pos = block->start;
+    while (pos < block->end) {
+        limit = block->end - pos < YAZ0_MAX_MATCH ? block->end - pos : YAZ0_MAX_MATCH;
+        len = finderFind(&finder, pos, limit, 0, &distance);
+        token.count = len != 0 ? (u16)len : 1;
+        token.distance = len != 0 ? (u16)distance : 0;
+        block->tokens.push_back(token);
+        for (i = 0; i < token.count; i++) {
+            finderInsert(&finder, pos++);
+        }
+    }
+}
+
+static void parseOptimal(const u8* data, u32 size, Block* block, u32 maxChain) {
+    MatchFinder finder;
+    std::vector<u16> longest;
+    std::vector<u16> distances;
+    std::vector<u32> cost;
+    std::vector<u16> choice;
+    Token token;
+    u32 base;
+    u32 length;
+    u32 pos;
+    u32 limit;
+    u32 distance;
+    u32 best;
+    u32 bestLen;
+    u32 len;
+    u32 c;
+    u32 i;
+
+    base = block->start > YAZ0_WINDOW_SIZE ? block->start - YAZ0_WINDOW_SIZE : 0;
+    length = block->end - block->start;
+    finderInit(&finder, data, size, base, block->end, maxChain);
+    for (pos = base; pos < block->start; pos++) {
+        finderInsert(&finder, pos);
+    }
+
+    longest.resize(length);
+    distances.resize(length);
+    distance = 0;
+    for (i = 0; i < length; i++) {
+        // a match at i - 1 is still one byte shorter at i
+        pos = block->start + i;
+        limit = length - i < YAZ0_MAX_MATCH ? length - i : YAZ0_MAX_MATCH;
+        longest[i] = (u16)finderFind(&finder, pos, limit, i != 0 && longest[i - 1] > 0 ? longest[i - 1] - 1 : 0,
+                                     &distance);
+        distances[i] = (u16)distance;
+        finderInsert(&finder, pos);
+    }
+
+    // cheapest coding of everything from i to the end of the block
+    cost.resize(length + 1);
+    choice.resize(length);
+    cost[length] = 0;
+    for (i = length; i-- != 0;) {
+        best = LITERAL_COST + cost[i + 1];
+        bestLen = 1;
+        for (len = YAZ0_MIN_MATCH; len <= longest[i]; len++) {
+            c = (len < 0x12 ? SHORT_MATCH_COST : LONG_MATCH_COST) + cost[i + len];
+            if (c <= best) {
+                best = c;
+                bestLen = len;
+            }
+        }
+        cost[i] = best;
+        choice[i] = (u16)bestLen;
+    }
+
+    for (i = 0; i < length; i += token.count) {
+        token.count = choice[i];
+        token.distance = token.count > 1 ? distances[i] : 0;
+        block->tokens.push_back(token);
+    }
+}
+
+static void writeSZS(const u8* data, const std::vector<Block>& blocks, u32 size, std::vector<u8>& out) {
+    u32 flagsPos;
+    u32 numTokens;
+    u32 pos;
+    u32 distance;
+    u32 b;
+    u32 i;
+
+    out.assign(YAZ0_HEADER_SIZE, 0);
+    memcpy(out.data(), "Yaz0", 4);
+    host_put_be32(out.data() + 4, size);
+
+    flagsPos = 0;
+    numTokens = 0;
+    for (b = 0; b < blocks.size(); b++) {
+        pos = blocks[b].start;
+        for (i = 0; i < blocks[b].tokens.size(); i++, numTokens++) {
+            const Token& token = blocks[b].tokens[i];
+
+            if (numTokens % 8 == 0) {
+                flagsPos = out.size();
+                out.push_back(0);
+            }
+
+            if (token.count == 1) {
+                out[flagsPos] |= 0x80 >> (numTokens % 8);
+                out.push_back(data[pos++]);
+                continue;
+            }
+
+            distance = token.distance - 1;
+            if (token.count < 0x12) {
+                out.push_back((u8)(((token.count - 2) << 4) | (distance >> 8)));
+                out.push_back((u8)distance);
+            } else {
+                out.push_back((u8)(distance >> 8));
+                out.push_back((u8)distance);
+                out.push_back((u8)(token.count - 0x12));
+            }
+            pos += token.count;
+        }
+    }
+}
+
+static void writeSZP(const u8* data, const std::vector<Block>& blocks, u32 size, std::vector<u8>& out) {
+    std::vector<u8> flags;
+    std::vector<u8> links;
+    std::vector<u8> chunks;
+    u32 numTokens;
+    u32 pos;
+    u32 distance;
+    u32 b;
+    u32 i;
+
+    numTokens = 0;
+    for (b = 0; b < blocks.size(); b++) {
+        pos = blocks[b].start;
+        for (i = 0; i < blocks[b].tokens.size(); i++, numTokens++) {
+            const Token& token = blocks[b].tokens[i];
+
+            if (numTokens % 32 == 0) {
+                flags.insert(flags.end(), 4, 0);
+            }
+
+            if (token.count == 1) {
+                flags[flags.size() - 4 + (numTokens % 32) / 8] |= 0x80 >> (numTokens % 8);
+                chunks.push_back(data[pos++]);
+                continue;
+            }
+
+            distance = token.distance - 1;
+            if (token.count < 0x12) {
+                links.push_back((u8)(((token.count - 2) << 4) | (distance >> 8)));
+                links.push_back((u8)distance);
+            } else {
+                links.push_back((u8)(distance >> 8));
+                links.push_back((u8)distance);
+                chunks.push_back((u8)(token.count - 0x12));
+            }
+            pos += token.count;
+        }
+    }
+
+    out.assign(YAZ0_HEADER_SIZE, 0);
+    memcpy(out.data(), "Yay0", 4);
+    host_put_be32(out.data() + 4, size);
+    host_put_be32(out.data() + 8, YAZ0_HEADER_SIZE + flags.size());
+    host_put_be32(out.data() + 12, YAZ0_HEADER_SIZE + flags.size() + links.size());
+    out.insert(out.end(), flags.begin(), flags.end());
+    out.insert(out.end(), links.begin(), links.end());
+    out.insert(out.end(), chunks.begin(), chunks.end());
+}
+
+void yaz0Encode(const u8* data, u32 size, const Yaz0Options* options, std::vector<u8>& out) {
+    std::vector<Block> blocks;
+    std::vector<std::thread> threads;
+    std::atomic<u32> next(0);
+    u32 blockSize;
+    u32 numThreads;
+    u32 maxChain;
+    u32 pos;
+    u32 i;
+
+    blockSize = options->blockSize != 0 ? options->blockSize : DEFAULT_BLOCK_SIZE;
+    numThreads = options->numThreads != 0 ? options->numThreads : std::thread::hardware_concurrency();
+    maxChain = options->level == YAZ0_LEVEL_OPTIMAL ? OPTIMAL_MAX_CHAIN : GREEDY_MAX_CHAIN;
+    if (options->maxChain != 0) {
+        maxChain = options->maxChain;
+    }
+
+    for (pos = 0; pos < size; pos += blockSize) {
+        blocks.push_back(Block());
+        blocks.back().start = pos;
+        blocks.back().end = size - pos < blockSize ? size : pos + blockSize;
+    }
+    if (numThreads == 0) {
+        numThreads = 1;
+    }
+    if (numThreads > blocks.size()) {
+        numThreads = blocks.size();
+    }
+
+    // the data is only read, so any thread can take any block
+    for (i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread([&] {
+            u32 b;
+
+            while ((b = next++) < blocks.size()) {
+                if (options->level == YAZ0_LEVEL_NAIVE) {
+                    parseNaive(data, &blocks[b]);
+                } else if (options->level == YAZ0_LEVEL_GREEDY) {
+                    parseGreedy(data, size, &blocks[b], maxChain);
+                } else {
+                    parseOptimal(data, size, &blocks[b], maxChain);
+                }
+            }
+        }));
+    }
+    for (i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    if (options->format == YAZ0_FORMAT_SZS) {
+        writeSZS(data, blocks, size, out);
+    } else {
+        writeSZP(data, blocks, size, out);
+    }
+}
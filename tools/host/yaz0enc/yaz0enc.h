@@ -0,0 +1,50 @@
+#ifndef _YAZ0ENC_YAZ0ENC_H
+#define _YAZ0ENC_YAZ0ENC_H
+
+#include "../common/types.h"
+
+#include <vector>
+
+// Yaz0 (SZS) and Yay0 (SZP) encoder for the archive build. Both formats code the same tokens, a literal byte or a
+// back-reference of 3 to 0x111 bytes up to 0x1000 bytes back, so they share one parse:
+//
+//   YAZ0_LEVEL_NAIVE    greedy, every distance in the window tried at every token; the reference for ratio
+//   YAZ0_LEVEL_GREEDY   greedy over hash chains
+//   YAZ0_LEVEL_OPTIMAL  the longest match at every position from hash chains, then the cheapest tokens by dynamic
+//                       programming; a token costs 9, 17 or 25 bits whatever its distance, so the longest match is
+//                       all a position needs
+//
+// The input is split into blocks searched on separate threads. A block's matches may reach into the bytes before
+// it, so the window carries across blocks and only the parse restarts at each boundary.
+
+#define YAZ0_WINDOW_SIZE 0x1000
+#define YAZ0_MIN_MATCH 3
+#define YAZ0_MAX_MATCH (0xFF + 0x12)
+#define YAZ0_HEADER_SIZE 0x10
+
+typedef enum Yaz0Format {
+    YAZ0_FORMAT_SZS,
+    YAZ0_FORMAT_SZP,
+} Yaz0Format;
+
+typedef enum Yaz0Level {
+    YAZ0_LEVEL_NAIVE,
+    YAZ0_LEVEL_GREEDY,
+    YAZ0_LEVEL_OPTIMAL,
+} Yaz0Level;
+
+typedef struct Yaz0Options {
+    Yaz0Format format;
+    Yaz0Level level;
+    u32 numThreads; // 0 for one per core
+    u32 blockSize;  // bytes per thread task, 0 for the default
+    u32 maxChain;   // hash chain entries tried per position, 0 for the level's default
+} Yaz0Options;
+
+void yaz0DefaultOptions(Yaz0Options* options);
+void yaz0Encode(const u8* data, u32 size, const Yaz0Options* options, std::vector<u8>& out);
+
+// Decodes file with JKRDecomp's decoder (src/JSystem/JKernel/JKRDecode.cpp) and compares it with data
+bool yaz0Verify(const u8* file, size_t fileSize, const u8* data, size_t size);
+
+#endif